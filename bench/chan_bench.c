@@ -0,0 +1,243 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+// 虚拟机之间的消息通道 (kchan): 两个线程各有一个虚拟机, 经匿名通道传递消息。
+//
+//   chan_bench [消息数]
+//
+// 吞吐: 一个线程连续发送, 另一个线程接收并核对每条消息, 输出每秒的消息数。消息为
+//   int                 直接存放在槽位中
+//   冻结的 4 KB 字符串  共享区的引用, 接收者不复制
+//   4 KB 字符串         发送时复制到随消息一起的共享区, 接收时不再复制
+//   64 个 int 的数组    编码后在接收者的堆中重建
+//   16 个字符串的数组   同上, 每个元素是一个新的字符串
+// 延迟: 两个通道上的乒乓, 一方发出一个 int, 另一方收到后发回, 输出往返时间的 p50 / p99。
+// 至少有两个 CPU 时两个线程分别绑定到不同的 CPU 上; 只有一个 CPU 时两者轮流运行, 延迟
+// 主要是线程切换的开销。通道容量为 CAPACITY。
+
+#define _GNU_SOURCE
+
+#include "../src/kapi.h"
+#include "../src/kvm.h"
+#include "../src/libs/kchannel.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MESSAGES 1000000
+#define ROUND_TRIPS 100000
+#define CAPACITY 1024
+#define STRING_SIZE 4096
+
+typedef enum {
+    PAYLOAD_INT,
+    PAYLOAD_FROZEN_STRING,
+    PAYLOAD_STRING,
+    PAYLOAD_INT_ARRAY,
+    PAYLOAD_STRING_ARRAY,
+} Payload;
+
+static const char* payload_names[] = {
+    "int", "frozen 4 KB string", "4 KB string", "array of 64 ints", "array of 16 strings",
+};
+
+typedef struct Peer {
+    pthread_t thread;
+    KorelinVM* vm;
+    KChan* in;
+    KChan* out;
+    Payload payload;
+    size_t count;
+    int cpu;                // 绑定的 CPU, -1 表示不绑定
+    size_t errors;
+} Peer;
+
+// 辅助函数：获取单调时钟 (纳秒)
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void bind_cpu(int cpu) {
+    if (cpu < 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// 辅助函数：在发送者的堆中创建消息, 放入已登记为根的 holder 中
+static KValue make_payload(KGCHeap* heap, KArray* holder, Payload payload) {
+    char text[STRING_SIZE];
+    memset(text, 'k', sizeof(text));
+    KValue value = KVALUE_INT(42);
+    switch (payload) {
+        case PAYLOAD_INT:
+            return value;
+        case PAYLOAD_FROZEN_STRING:
+        case PAYLOAD_STRING:
+            value = KVALUE_OBJECT(kstring_new(heap, text, sizeof(text)));
+            karray_push(heap, holder, value);
+            if (payload == PAYLOAD_STRING) return value;
+            if (!kvalue_freeze(heap, value, &value)) return KVALUE_NULL;
+            karray_push(heap, holder, value);
+            return value;
+        case PAYLOAD_INT_ARRAY: {
+            KArray* array = karray_new(heap, 64);
+            value = KVALUE_OBJECT(array);
+            karray_push(heap, holder, value);
+            for (long long i = 0; i < 64; i++) karray_push(heap, array, KVALUE_INT(i));
+            return value;
+        }
+        case PAYLOAD_STRING_ARRAY: {
+            KArray* array = karray_new(heap, 16);
+            value = KVALUE_OBJECT(array);
+            karray_push(heap, holder, value);
+            for (int i = 0; i < 16; i++) karray_push(heap, array, KVALUE_OBJECT(kstring_new(heap, text, 32)));
+            return value;
+        }
+    }
+    return value;
+}
+
+// 辅助函数：核对收到的消息
+static bool check_payload(KValue value, Payload payload, size_t index) {
+    switch (payload) {
+        case PAYLOAD_INT:
+            return value.type == KVAL_INT && value.as.integer == (long long)index;
+        case PAYLOAD_FROZEN_STRING:
+        case PAYLOAD_STRING:
+            return value.type == KVAL_OBJECT && value.as.object->type == KOBJ_STRING &&
+                   ((KString*)value.as.object)->length == STRING_SIZE;
+        case PAYLOAD_INT_ARRAY:
+            return value.type == KVAL_OBJECT && value.as.object->type == KOBJ_ARRAY &&
+                   ((KArray*)value.as.object)->count == 64;
+        case PAYLOAD_STRING_ARRAY:
+            return value.type == KVAL_OBJECT && value.as.object->type == KOBJ_ARRAY &&
+                   ((KArray*)value.as.object)->count == 16;
+    }
+    return false;
+}
+
+static void* send_thread(void* arg) {
+    Peer* self = arg;
+    bind_cpu(self->cpu);
+    KGCHeap* heap = self->vm->heap;
+    KArray* holder = karray_new(heap, 4);
+    kgc_push_root(heap, &holder->obj);
+    KValue value = make_payload(heap, holder, self->payload);
+    for (size_t i = 0; i < self->count; i++) {
+        if (self->payload == PAYLOAD_INT) value = KVALUE_INT((long long)i);
+        if (kchan_send(self->out, heap, value, true) != KCHAN_OK) self->errors++;
+    }
+    kgc_pop_roots(heap, 1);
+    return NULL;
+}
+
+static void* receive_thread(void* arg) {
+    Peer* self = arg;
+    bind_cpu(self->cpu);
+    for (size_t i = 0; i < self->count; i++) {
+        KValue value;
+        if (kchan_recv(self->in, self->vm->heap, &value, true) != KCHAN_OK ||
+            !check_payload(value, self->payload, i)) {
+            self->errors++;
+        }
+    }
+    return NULL;
+}
+
+// 乒乓的应答方: 收到什么就发回什么
+static void* echo_thread(void* arg) {
+    Peer* self = arg;
+    bind_cpu(self->cpu);
+    for (size_t i = 0; i < self->count; i++) {
+        KValue value;
+        if (kchan_recv(self->in, self->vm->heap, &value, true) != KCHAN_OK) self->errors++;
+        if (kchan_send(self->out, self->vm->heap, value, true) != KCHAN_OK) self->errors++;
+    }
+    return NULL;
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+int main(int argc, char** argv) {
+    size_t messages = argc > 1 ? (size_t)atoll(argv[1]) : MESSAGES;
+    if (messages < 100) messages = 100;
+    cpu_set_t allowed;
+    int cpus[2] = {-1, -1};
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0 && CPU_COUNT(&allowed) >= 2) {
+        for (int cpu = 0, found = 0; cpu < CPU_SETSIZE && found < 2; cpu++) {
+            if (CPU_ISSET(cpu, &allowed)) cpus[found++] = cpu;
+        }
+        printf("threads on CPUs %d and %d\n", cpus[0], cpus[1]);
+    } else {
+        printf("one CPU: the two threads share it\n");
+    }
+    KorelinVM* sender_vm = korelin_new();
+    KorelinVM* receiver_vm = korelin_new();
+    size_t errors = 0;
+
+    for (Payload payload = PAYLOAD_INT; payload <= PAYLOAD_STRING_ARRAY; payload++) {
+        KChan* chan = kchan_open(NULL, CAPACITY);
+        Peer sender = {.vm = sender_vm, .out = chan, .payload = payload, .count = messages, .cpu = cpus[0]};
+        Peer receiver = {.vm = receiver_vm, .in = chan, .payload = payload, .count = messages, .cpu = cpus[1]};
+        uint64_t start = now_ns();
+        pthread_create(&receiver.thread, NULL, receive_thread, &receiver);
+        pthread_create(&sender.thread, NULL, send_thread, &sender);
+        pthread_join(sender.thread, NULL);
+        pthread_join(receiver.thread, NULL);
+        double seconds = (double)(now_ns() - start) / 1e9;
+        printf("%-20s %10.0f messages/s\n", payload_names[payload], (double)messages / seconds);
+        errors += sender.errors + receiver.errors;
+        kchan_release(chan);
+        korelin_gc_collect(sender_vm);
+        korelin_gc_collect(receiver_vm);
+    }
+
+    // 乒乓: 发起方在本线程中运行
+    KChan* ping = kchan_open(NULL, CAPACITY);
+    KChan* pong = kchan_open(NULL, CAPACITY);
+    uint64_t* latencies = malloc(ROUND_TRIPS * sizeof(uint64_t));
+    if (!latencies) {
+        fprintf(stderr, "Error: malloc failed in main\n");
+        exit(EXIT_FAILURE);
+    }
+    Peer echo = {.vm = receiver_vm, .in = ping, .out = pong, .count = ROUND_TRIPS, .cpu = cpus[1]};
+    pthread_create(&echo.thread, NULL, echo_thread, &echo);
+    bind_cpu(cpus[0]);
+    for (size_t i = 0; i < ROUND_TRIPS; i++) {
+        uint64_t start = now_ns();
+        KValue value;
+        if (kchan_send(ping, sender_vm->heap, KVALUE_INT((long long)i), true) != KCHAN_OK ||
+            kchan_recv(pong, sender_vm->heap, &value, true) != KCHAN_OK || value.type != KVAL_INT ||
+            value.as.integer != (long long)i) {
+            errors++;
+        }
+        latencies[i] = now_ns() - start;
+    }
+    pthread_join(echo.thread, NULL);
+    errors += echo.errors;
+    qsort(latencies, ROUND_TRIPS, sizeof(uint64_t), compare_u64);
+    printf("ping-pong round trip: p50 %.2f us, p99 %.2f us\n", (double)latencies[ROUND_TRIPS / 2] / 1e3,
+           (double)latencies[ROUND_TRIPS * 99 / 100] / 1e3);
+    free(latencies);
+    kchan_release(ping);
+    kchan_release(pong);
+    korelin_free(sender_vm);
+    korelin_free(receiver_vm);
+    if (errors > 0) {
+        printf("%zu messages were lost or changed\n", errors);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,156 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+// 并发哈希表 (KCMap, 脚本中的 ConcurrentMap) 在读多写少与读写各半两种负载下随线程数的
+// 扩展性, 并与用一把互斥锁保护同一张表的做法对比。
+//
+//   cmap_bench [最大线程数]
+//
+// 表中预先放入 KEYS 个整数键; 每种配置共执行 OPERATIONS 次操作, 平均分给各线程。
+// 读是 kcmap_get, 写是对随机键的 kcmap_set (四分之三) 或 kcmap_remove (四分之一),
+// 键取自 2 * KEYS 的范围, 因此表的大小大致稳定, 更新与删除都会经过纪元回收。
+// 线程数为 1、2、4 ... 直到最大线程数 (默认 32), 输出总吞吐量 (百万次操作每秒)。
+//
+// 同时检查正确性: 值是 (键 << 32) | 序号, 读者检查读出的值属于这个键; 每个线程只写
+// 模线程数等于自己编号的键并记录期望的状态, 全部结束后逐个键核对表的内容。出错时
+// 退出码为 1。
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../src/kgc.h"
+#include "../src/libs/kmap.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define KEYS 65536
+#define OPERATIONS 4000000
+#define MAX_THREADS 32
+
+typedef struct BenchThread {
+    pthread_t thread;
+    KCMap* map;
+    pthread_mutex_t* lock;  // 不为 NULL 时每次操作都持有这把锁
+    int read_percent;
+    int id;
+    int threads;
+    size_t operations;
+    uint64_t seed;
+    size_t found;
+    size_t errors;
+} BenchThread;
+
+// 每个键期望的值 (-1 表示不在表中), 只由拥有这个键的线程写入
+static long long expected[2 * KEYS];
+
+// 辅助函数：获取单调时钟 (纳秒)
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// 辅助函数：xorshift 伪随机数
+static uint64_t next_random(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+static void* bench_thread(void* arg) {
+    BenchThread* self = arg;
+    // 整数值读出时不在堆中分配, 但 kcmap_get 需要一个堆
+    KGCHeap* heap = kgc_heap_new(NULL);
+    for (size_t i = 0; i < self->operations; i++) {
+        uint64_t r = next_random(&self->seed);
+        long long k = (long long)((r >> 16) % (2 * KEYS));
+        int kind = (int)(r % 100);
+        if (kind >= self->read_percent) {
+            // 写自己的键
+            k = k - k % self->threads + self->id;
+            if (k >= 2 * KEYS) k -= self->threads;
+        }
+        KValue key = KVALUE_INT(k);
+        KValue value;
+        if (self->lock) pthread_mutex_lock(self->lock);
+        if (kind < self->read_percent) {
+            if (kcmap_get(self->map, heap, key, &value)) {
+                self->found++;
+                self->errors += value.as.integer >> 32 != k;
+            }
+        } else if ((r >> 8) % 4 != 0) {
+            expected[k] = (long long)((uint64_t)k << 32 | i);
+            kcmap_set(self->map, key, KVALUE_INT(expected[k]));
+        } else {
+            expected[k] = -1;
+            self->found += kcmap_remove(self->map, key);
+        }
+        if (self->lock) pthread_mutex_unlock(self->lock);
+    }
+    kgc_heap_free(heap);
+    return NULL;
+}
+
+static size_t errors;
+
+static double run(int threads, int read_percent, bool locked) {
+    KCMap* map = kcmap_open(NULL);
+    for (long long k = 0; k < 2 * KEYS; k++) {
+        expected[k] = k % 2 == 0 ? k << 32 : -1;
+        if (k % 2 == 0) kcmap_set(map, KVALUE_INT(k), KVALUE_INT(expected[k]));
+    }
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    BenchThread workers[MAX_THREADS];
+    uint64_t start = now_ns();
+    for (int i = 0; i < threads; i++) {
+        workers[i].map = map;
+        workers[i].lock = locked ? &lock : NULL;
+        workers[i].read_percent = read_percent;
+        workers[i].id = i;
+        workers[i].threads = threads;
+        workers[i].operations = OPERATIONS / (size_t)threads;
+        workers[i].seed = 0x9E3779B97F4A7C15ull * (uint64_t)(i + 1);
+        workers[i].found = 0;
+        workers[i].errors = 0;
+        pthread_create(&workers[i].thread, NULL, bench_thread, &workers[i]);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+        errors += workers[i].errors;
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    KGCHeap* heap = kgc_heap_new(NULL);
+    KValue value;
+    for (long long k = 0; k < 2 * KEYS; k++) {
+        bool found = kcmap_get(map, heap, KVALUE_INT(k), &value);
+        errors += found ? value.as.integer != expected[k] : expected[k] != -1;
+    }
+    kgc_heap_free(heap);
+    kcmap_release(map);
+    return (double)(OPERATIONS / (size_t)threads * (size_t)threads) * 1000.0 / (double)elapsed;
+}
+
+int main(int argc, char** argv) {
+    int max_threads = argc > 1 ? atoi(argv[1]) : MAX_THREADS;
+    if (max_threads < 1) max_threads = 1;
+    if (max_threads > MAX_THREADS) max_threads = MAX_THREADS;
+    static const int read_percents[] = {90, 50};
+    for (size_t mix = 0; mix < sizeof(read_percents) / sizeof(read_percents[0]); mix++) {
+        for (int threads = 1; threads <= max_threads; threads *= 2) {
+            int reads = read_percents[mix];
+            printf("%d%% reads, threads %2d: ConcurrentMap %6.2f Mops/s, one mutex %6.2f Mops/s\n", reads, threads,
+                   run(threads, reads, false), run(threads, reads, true));
+        }
+    }
+    if (errors > 0) {
+        printf("%zu wrong values\n", errors);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,210 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+// knet 事件循环的回环回显基准: 启动回显服务器脚本, 建立大量并发连接, 每个连接依次发送
+// ROUNDS 条消息, 每条等回显完整收到后再发下一条。
+//
+//   echo_load korelin bench/net_echo.kri [连接数] [每个连接的消息数]
+//
+// 负载端是单线程的非阻塞 epoll 客户端, 与服务器在不同的进程中 (各自占用一半的文件描述符;
+// 启动时把软限制提高到硬限制)。先建立全部连接 (同时进行中的连接不超过 CONNECTING 个),
+// 报告每秒建立的连接数; 再报告每秒完成的请求数与请求延迟的 p50 / p99。服务器的事件
+// 循环后端由 KORELIN_NET_BACKEND 选择 (环境变量传给子进程)。
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PORT 18642
+#define CLIENTS 10000
+#define ROUNDS 20
+#define MESSAGE_SIZE 64
+#define CONNECTING 512
+
+extern char** environ;
+
+typedef struct Client {
+    int fd;
+    int sent;               // 已发送的消息数
+    size_t received;        // 当前消息已收到的字节数
+    uint64_t sent_at;
+} Client;
+
+// 辅助函数：获取单调时钟 (纳秒)
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void fail(const char* what) {
+    perror(what);
+    exit(EXIT_FAILURE);
+}
+
+static int connect_socket(void) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0) fail("socket");
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct sockaddr_in address = {.sin_family = AF_INET, .sin_port = htons(PORT)};
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0 && errno != EINPROGRESS) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 辅助函数：等待服务器开始监听 (最多 10 秒)
+static bool wait_for_server(void) {
+    for (int attempt = 0; attempt < 1000; attempt++) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in address = {.sin_family = AF_INET, .sin_port = htons(PORT)};
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bool ok = connect(fd, (struct sockaddr*)&address, sizeof(address)) == 0;
+        close(fd);
+        if (ok) return true;
+        usleep(10000);
+    }
+    return false;
+}
+
+static void send_message(Client* client) {
+    char message[MESSAGE_SIZE];
+    memset(message, 'a' + client->sent % 26, sizeof(message));
+    client->sent_at = now_ns();
+    client->received = 0;
+    if (write(client->fd, message, sizeof(message)) != (ssize_t)sizeof(message)) fail("write");
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: echo_load korelin net_echo.kri [clients] [rounds]\n");
+        return 64;
+    }
+    int clients = argc > 3 ? atoi(argv[3]) : CLIENTS;
+    int rounds = argc > 4 ? atoi(argv[4]) : ROUNDS;
+    if (clients < 1) clients = 1;
+    if (rounds < 1) rounds = 1;
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    pid_t server;
+    char* server_argv[] = {argv[1], "run", argv[2], NULL};
+    if (posix_spawn(&server, argv[1], NULL, NULL, server_argv, environ) != 0) fail("posix_spawn");
+    if (!wait_for_server()) {
+        fprintf(stderr, "echo_load: the server did not start listening on port %d\n", PORT);
+        kill(server, SIGKILL);
+        return 1;
+    }
+
+    Client* all = calloc((size_t)clients, sizeof(Client));
+    uint64_t* latencies = malloc((size_t)clients * (size_t)rounds * sizeof(uint64_t));
+    struct epoll_event* events = malloc(1024 * sizeof(struct epoll_event));
+    if (!all || !latencies || !events) {
+        fprintf(stderr, "Error: malloc failed in main\n");
+        exit(EXIT_FAILURE);
+    }
+    int epoll_fd = epoll_create1(0);
+    if (epoll_fd < 0) fail("epoll_create1");
+
+    // 建立连接: 连接完成 (可写) 后改为等待可读
+    uint64_t start = now_ns();
+    int started = 0;
+    int connected = 0;
+    while (connected < clients) {
+        while (started < clients && started - connected < CONNECTING) {
+            Client* client = &all[started];
+            client->fd = connect_socket();
+            if (client->fd < 0) fail("connect");
+            struct epoll_event event = {.events = EPOLLOUT, .data.ptr = client};
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client->fd, &event) < 0) fail("epoll_ctl");
+            started++;
+        }
+        int count = epoll_wait(epoll_fd, events, 1024, 5000);
+        if (count <= 0) fail("epoll_wait (connect)");
+        for (int i = 0; i < count; i++) {
+            Client* client = events[i].data.ptr;
+            int error = 0;
+            socklen_t length = sizeof(error);
+            getsockopt(client->fd, SOL_SOCKET, SO_ERROR, &error, &length);
+            if (error != 0 || (events[i].events & (EPOLLERR | EPOLLHUP))) {
+                errno = error;
+                fail("connect");
+            }
+            struct epoll_event event = {.events = EPOLLIN, .data.ptr = client};
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, client->fd, &event);
+            connected++;
+        }
+    }
+    double connect_seconds = (double)(now_ns() - start) / 1e9;
+
+    // 回显: 所有连接同时发出第一条消息
+    size_t completed = 0;
+    size_t total = (size_t)clients * (size_t)rounds;
+    start = now_ns();
+    for (int i = 0; i < clients; i++) send_message(&all[i]);
+    char buffer[4096];
+    while (completed < total) {
+        int count = epoll_wait(epoll_fd, events, 1024, 5000);
+        if (count <= 0) fail("epoll_wait (echo)");
+        for (int i = 0; i < count; i++) {
+            Client* client = events[i].data.ptr;
+            ssize_t n = read(client->fd, buffer, sizeof(buffer));
+            if (n <= 0) {
+                if (n < 0 && errno == EAGAIN) continue;
+                fprintf(stderr, "echo_load: the server closed a connection\n");
+                return 1;
+            }
+            client->received += (size_t)n;
+            if (client->received < MESSAGE_SIZE) continue;
+            latencies[completed++] = now_ns() - client->sent_at;
+            if (++client->sent < rounds) send_message(client);
+        }
+    }
+    double echo_seconds = (double)(now_ns() - start) / 1e9;
+    qsort(latencies, total, sizeof(uint64_t), compare_u64);
+    printf("%d clients: %.0f connections/s; %zu requests, %.0f requests/s, p50 %.0f us, p99 %.0f us\n", clients,
+           clients / connect_seconds, total, (double)total / echo_seconds, (double)latencies[total / 2] / 1e3,
+           (double)latencies[total * 99 / 100] / 1e3);
+
+    // 以 RST 关闭, 不留下 TIME_WAIT: 否则连续运行时本地端口逐渐耗尽, 建立连接变慢甚至被重置
+    struct linger linger = {.l_onoff = 1, .l_linger = 0};
+    for (int i = 0; i < clients; i++) {
+        setsockopt(all[i].fd, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+        close(all[i].fd);
+    }
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+    free(all);
+    free(latencies);
+    free(events);
+    return 0;
+}
@@ -0,0 +1,280 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+// knet HTTP/1.1 服务器的回环负载基准: 启动服务器脚本, 以若干个保持连接的客户端发送 GET
+// 请求, 报告每秒请求数与延迟的 p50 / p99。
+//
+//   http_load korelin bench/http_server.kri [libsyscall_count.so]
+//
+// 每个连接一个线程, 使用阻塞套接字: 一次写出 depth 个请求 (depth > 1 时为流水线), 全部
+// 响应读完后再发下一批, 延迟按批计算。依次运行:
+//   1 个连接, depth 1      单个请求的往返
+//   32 个连接, depth 1     并发的短响应
+//   32 个连接, depth 16    流水线
+//   32 个连接, /file       16 KB 的文件 (sendfile)
+// 文件在临时目录中创建, 路径经标准输入传给服务器。服务器的事件循环后端由
+// KORELIN_NET_BACKEND 选择 (环境变量传给子进程)。
+//
+// 给出系统调用计数器 (bench/syscall_count.c) 时, 以 LD_PRELOAD 把它载入服务器, 并为每种
+// 负载输出服务器端每个请求的系统调用次数。
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PORT 18643
+#define REQUESTS 40000          // 每种配置的请求总数
+#define MAX_CONNECTIONS 64
+#define FILE_SIZE 16384
+
+extern char** environ;
+
+static volatile uint64_t* syscalls;    // 服务器的系统调用计数, 未启用计数器时为 NULL
+
+typedef struct LoadConfig {
+    const char* name;
+    int connections;
+    int depth;
+    const char* target;
+} LoadConfig;
+
+typedef struct LoadThread {
+    pthread_t thread;
+    const LoadConfig* config;
+    int batches;
+    uint64_t* latencies;        // 每批一个
+} LoadThread;
+
+// 辅助函数：获取单调时钟 (纳秒)
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void fail(const char* what) {
+    perror(what);
+    exit(EXIT_FAILURE);
+}
+
+static int connect_server(void) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) fail("socket");
+    struct sockaddr_in address = {.sin_family = AF_INET, .sin_port = htons(PORT)};
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+// 辅助函数：等待服务器开始监听 (最多 10 秒)
+static bool wait_for_server(void) {
+    for (int attempt = 0; attempt < 1000; attempt++) {
+        int fd = connect_server();
+        if (fd >= 0) {
+            close(fd);
+            return true;
+        }
+        usleep(10000);
+    }
+    return false;
+}
+
+// 辅助函数：等待端口不再接受连接 (最多 10 秒)。io_uring 在进程退出后异步地释放环, 上一次
+// 运行的服务器的监听套接字可能在 waitpid 返回后还存在一会儿
+static bool wait_for_port(void) {
+    for (int attempt = 0; attempt < 1000; attempt++) {
+        int fd = connect_server();
+        if (fd < 0) return true;
+        close(fd);
+        usleep(10000);
+    }
+    return false;
+}
+
+// 辅助函数：buffer 开头的一个完整响应的长度, 不完整时返回 0
+static size_t response_length(const char* buffer, size_t length) {
+    const char* end = memmem(buffer, length, "\r\n\r\n", 4);
+    if (!end) return 0;
+    size_t header = (size_t)(end - buffer) + 4;
+    size_t body = 0;
+    for (const char* line = buffer; line < end; line = memchr(line, '\n', (size_t)(end - line)) + 1) {
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            body = strtoul(line + 15, NULL, 10);
+            break;
+        }
+        if (!memchr(line, '\n', (size_t)(end - line))) break;
+    }
+    return length >= header + body ? header + body : 0;
+}
+
+static void* load_thread(void* arg) {
+    LoadThread* self = arg;
+    const LoadConfig* config = self->config;
+    int fd = connect_server();
+    if (fd < 0) fail("connect");
+    char request[256];
+    int length = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: localhost\r\n\r\n", config->target);
+    size_t batch_size = (size_t)length * (size_t)config->depth;
+    char* batch = malloc(batch_size);
+    size_t capacity = 4 * FILE_SIZE * (size_t)config->depth;
+    char* buffer = malloc(capacity);
+    if (!batch || !buffer) {
+        fprintf(stderr, "Error: malloc failed in load_thread\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < config->depth; i++) memcpy(batch + (size_t)i * (size_t)length, request, (size_t)length);
+
+    size_t have = 0;
+    for (int b = 0; b < self->batches; b++) {
+        uint64_t start = now_ns();
+        if (write(fd, batch, batch_size) != (ssize_t)batch_size) fail("write");
+        int responses = 0;
+        while (responses < config->depth) {
+            size_t used;
+            while ((used = response_length(buffer, have)) > 0) {
+                if (strncmp(buffer, "HTTP/1.1 200", 12) != 0) {
+                    fprintf(stderr, "http_load: unexpected response: %.40s\n", buffer);
+                    exit(EXIT_FAILURE);
+                }
+                memmove(buffer, buffer + used, have - used);
+                have -= used;
+                responses++;
+            }
+            if (responses == config->depth) break;
+            ssize_t n = read(fd, buffer + have, capacity - have);
+            if (n <= 0) fail("read");
+            have += (size_t)n;
+        }
+        self->latencies[b] = now_ns() - start;
+    }
+    close(fd);
+    free(batch);
+    free(buffer);
+    return NULL;
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void run(const LoadConfig* config) {
+    int batches = REQUESTS / (config->connections * config->depth);
+    size_t total = (size_t)batches * (size_t)config->connections;
+    uint64_t* latencies = malloc(total * sizeof(uint64_t));
+    if (!latencies) {
+        fprintf(stderr, "Error: malloc failed in run\n");
+        exit(EXIT_FAILURE);
+    }
+    LoadThread threads[MAX_CONNECTIONS];
+    uint64_t calls = syscalls ? *syscalls : 0;
+    uint64_t start = now_ns();
+    for (int i = 0; i < config->connections; i++) {
+        threads[i].config = config;
+        threads[i].batches = batches;
+        threads[i].latencies = latencies + (size_t)i * (size_t)batches;
+        pthread_create(&threads[i].thread, NULL, load_thread, &threads[i]);
+    }
+    for (int i = 0; i < config->connections; i++) {
+        pthread_join(threads[i].thread, NULL);
+    }
+    double seconds = (double)(now_ns() - start) / 1e9;
+    calls = syscalls ? *syscalls - calls : 0;
+    qsort(latencies, total, sizeof(uint64_t), compare_u64);
+    double requests = (double)total * config->depth;
+    printf("%-22s %8.0f requests/s, p50 %7.1f us, p99 %7.1f us", config->name, requests / seconds,
+           (double)latencies[total / 2] / 1e3, (double)latencies[total * 99 / 100] / 1e3);
+    if (syscalls) printf(", %5.2f syscalls/request", (double)calls / requests);
+    printf("\n");
+    free(latencies);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: http_load korelin http_server.kri [libsyscall_count.so]\n");
+        return 64;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    if (!wait_for_port()) {
+        fprintf(stderr, "http_load: port %d is still in use\n", PORT);
+        return 1;
+    }
+
+    char path[] = "/tmp/korelin_http_XXXXXX";
+    int file = mkstemp(path);
+    if (file < 0) fail("mkstemp");
+    char content[FILE_SIZE];
+    memset(content, 'k', sizeof(content));
+    if (write(file, content, sizeof(content)) != (ssize_t)sizeof(content)) fail("write");
+    close(file);
+
+    char counter_path[] = "/tmp/korelin_syscalls_XXXXXX";
+    if (argc > 3) {
+        int counter = mkstemp(counter_path);
+        if (counter < 0 || ftruncate(counter, sizeof(uint64_t)) < 0) fail("counter");
+        void* map = mmap(NULL, sizeof(uint64_t), PROT_READ, MAP_SHARED, counter, 0);
+        if (map == MAP_FAILED) fail("mmap");
+        close(counter);
+        syscalls = map;
+        setenv("LD_PRELOAD", argv[3], 1);
+        setenv("KORELIN_SYSCALL_COUNTER", counter_path, 1);
+    }
+
+    // 服务器的标准输入是管道, 第一行是文件路径
+    int input[2];
+    if (pipe(input) < 0) fail("pipe");
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, input[0], STDIN_FILENO);
+    posix_spawn_file_actions_addclose(&actions, input[1]);
+    pid_t server;
+    char* server_argv[] = {argv[1], "run", argv[2], NULL};
+    if (posix_spawn(&server, argv[1], &actions, NULL, server_argv, environ) != 0) fail("posix_spawn");
+    posix_spawn_file_actions_destroy(&actions);
+    close(input[0]);
+    dprintf(input[1], "%s\n", path);
+    close(input[1]);
+
+    int status = 0;
+    if (wait_for_server()) {
+        static const LoadConfig configs[] = {
+            {"1 conn, depth 1:", 1, 1, "/"},
+            {"32 conns, depth 1:", 32, 1, "/"},
+            {"32 conns, depth 16:", 32, 16, "/"},
+            {"32 conns, 16 KB file:", 32, 1, "/file"},
+        };
+        for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++) run(&configs[i]);
+    } else {
+        fprintf(stderr, "http_load: the server did not start listening on port %d\n", PORT);
+        status = 1;
+    }
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+    unlink(path);
+    if (syscalls) unlink(counter_path);
+    return status;
+}
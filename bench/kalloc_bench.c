@@ -0,0 +1,165 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+// kalloc 与 glibc malloc 在分配抖动负载下的对比。
+//
+//   kalloc_bench kalloc|malloc [线程数]
+//
+// 每个线程执行 ROUNDS 轮, 每轮分配 PER_ROUND 个 16-256 字节的对象; 其中十分之一再存活
+// SURVIVE_ROUNDS 轮, 其余在本轮结束时死亡。kalloc 模式下每轮结束时清扫整个分配器
+// (死亡由单元中记录的轮次判断, 与回收器的清扫回调相同), malloc 模式下逐个 free。
+// 输出每次分配 (含释放或清扫) 的平均耗时与进程的峰值 RSS。
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../src/kalloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#define ROUNDS 50
+#define PER_ROUND 200000
+#define SURVIVE_ROUNDS 5
+#define MAX_THREADS 16
+
+// 对象: 第一个字记录死亡的轮次 (非 0, 满足 kalloc 的约定)
+typedef struct BenchCell {
+    uint64_t dies;
+    uint64_t payload[];
+} BenchCell;
+
+typedef struct BenchThread {
+    pthread_t thread;
+    bool use_kalloc;
+    uint64_t seed;
+    BenchCell** live;       // malloc 模式: 尚未释放的对象
+    size_t live_count;
+} BenchThread;
+
+static const size_t sizes[] = {16, 24, 32, 48, 64, 96, 128, 256};
+
+static KAllocator allocator;
+static uint64_t current_round;
+static pthread_barrier_t round_barrier;
+
+// 辅助函数：获取单调时钟 (纳秒)
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// 辅助函数：xorshift 伪随机数
+static uint64_t next_random(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+// kalloc 的清扫回调
+static bool sweep_cell(void* cell, void* userdata) {
+    (void)userdata;
+    return ((BenchCell*)cell)->dies <= current_round;
+}
+
+// 辅助函数：malloc 模式下释放本轮死亡的对象
+static void free_dead(BenchThread* self, uint64_t round) {
+    size_t kept = 0;
+    for (size_t i = 0; i < self->live_count; i++) {
+        if (self->live[i]->dies <= round) {
+            free(self->live[i]);
+        } else {
+            self->live[kept++] = self->live[i];
+        }
+    }
+    self->live_count = kept;
+}
+
+static void* bench_thread(void* arg) {
+    BenchThread* self = arg;
+    for (uint64_t round = 1; round <= ROUNDS; round++) {
+        for (size_t i = 0; i < PER_ROUND; i++) {
+            uint64_t r = next_random(&self->seed);
+            size_t size = sizes[r % (sizeof(sizes) / sizeof(sizes[0]))];
+            BenchCell* cell;
+            if (self->use_kalloc) {
+                cell = kalloc_alloc(&allocator, size, NULL);
+            } else {
+                cell = malloc(size);
+                if (!cell) {
+                    fprintf(stderr, "Error: malloc failed in bench_thread\n");
+                    exit(EXIT_FAILURE);
+                }
+                self->live[self->live_count++] = cell;
+            }
+            cell->dies = (r >> 32) % 10 == 0 ? round + SURVIVE_ROUNDS : round;
+            cell->payload[0] = r;
+        }
+        if (self->use_kalloc) {
+            // 所有线程分配完本轮之后, 由第一个线程清扫 (与回收器相同, 清扫期间不分配)
+            if (pthread_barrier_wait(&round_barrier) == PTHREAD_BARRIER_SERIAL_THREAD) {
+                current_round = round;
+                size_t freed = 0;
+                kalloc_begin_sweep(&allocator);
+                while (!kalloc_sweep_some(&allocator, SIZE_MAX, &freed)) {
+                }
+                kalloc_end_sweep(&allocator);
+            }
+            pthread_barrier_wait(&round_barrier);
+        } else {
+            free_dead(self, round);
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || (strcmp(argv[1], "kalloc") != 0 && strcmp(argv[1], "malloc") != 0)) {
+        fprintf(stderr, "usage: kalloc_bench kalloc|malloc [threads]\n");
+        return 64;
+    }
+    bool use_kalloc = strcmp(argv[1], "kalloc") == 0;
+    int threads = argc > 2 ? atoi(argv[2]) : 1;
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+
+    kalloc_init(&allocator, sweep_cell, NULL);
+    pthread_barrier_init(&round_barrier, NULL, (unsigned)threads);
+
+    BenchThread workers[MAX_THREADS];
+    size_t live_capacity = (size_t)PER_ROUND * (SURVIVE_ROUNDS + 1);
+    uint64_t start = now_ns();
+    for (int i = 0; i < threads; i++) {
+        workers[i].use_kalloc = use_kalloc;
+        workers[i].seed = 0x9E3779B97F4A7C15ull * (uint64_t)(i + 1);
+        workers[i].live = use_kalloc ? NULL : malloc(live_capacity * sizeof(BenchCell*));
+        workers[i].live_count = 0;
+        pthread_create(&workers[i].thread, NULL, bench_thread, &workers[i]);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double allocations = (double)ROUNDS * PER_ROUND * threads;
+    printf("%s, %d thread(s): %.1f ns per allocation, peak RSS %ld MB\n",
+           argv[1], threads, (double)elapsed / allocations, usage.ru_maxrss / 1024);
+
+    for (int i = 0; i < threads; i++) {
+        if (!use_kalloc) {
+            free_dead(&workers[i], UINT64_MAX);
+            free(workers[i].live);
+        }
+    }
+    pthread_barrier_destroy(&round_barrier);
+    kalloc_destroy(&allocator);
+    return 0;
+}
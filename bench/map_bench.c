@@ -0,0 +1,284 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+// 字典 (kmap) 与链式哈希表的对比: 插入、命中查找、未命中查找与遍历, 大小从 10 到
+// 一千万个键, 整数键与字符串键各一组。
+//
+//   map_bench [最大键数]
+//
+// 链式哈希表是常见的基线实现: 桶数组加单链表节点 (每个节点单独 malloc, 缓存哈希值),
+// 装载因子达到 1 时桶数加倍。两者使用相同的哈希函数与键比较 (kmap_hash_key 与
+// kmap_keys_equal), 差别只在表的组织方式。查找按打乱的顺序进行: 按插入顺序查找时,
+// 链表节点恰好按分配顺序排在内存中, 会让基线得到实际负载中没有的局部性。每种大小执行
+// 约 OPERATIONS 次操作 (小表重复多次), 输出每次操作的平均耗时。一千万个键时进程的
+// RSS 峰值约 3 GB。
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../src/kapi.h"
+#include "../src/kvm.h"
+#include "../src/libs/kmap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define OPERATIONS 10000000
+#define MAX_SIZE 10000000
+
+// 链式哈希表的节点
+typedef struct ChainNode {
+    KValue key;
+    KValue value;
+    uint32_t hash;
+    struct ChainNode* next;
+} ChainNode;
+
+typedef struct ChainMap {
+    ChainNode** buckets;
+    size_t bucket_count;    // 2 的幂
+    size_t count;
+} ChainMap;
+
+// 辅助函数：获取单调时钟 (纳秒)
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void* checked_calloc(size_t count, size_t size, const char* fn) {
+    void* ptr = calloc(count, size);
+    if (!ptr) {
+        fprintf(stderr, "Error: calloc failed in %s\n", fn);
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+static void chain_init(ChainMap* map) {
+    map->bucket_count = 8;
+    map->buckets = checked_calloc(map->bucket_count, sizeof(ChainNode*), "chain_init");
+    map->count = 0;
+}
+
+static void chain_free(ChainMap* map) {
+    for (size_t i = 0; i < map->bucket_count; i++) {
+        ChainNode* node = map->buckets[i];
+        while (node) {
+            ChainNode* next = node->next;
+            free(node);
+            node = next;
+        }
+    }
+    free(map->buckets);
+}
+
+// 辅助函数：桶数加倍, 把节点重新挂到新的桶上
+static void chain_grow(ChainMap* map) {
+    size_t new_count = map->bucket_count * 2;
+    ChainNode** new_buckets = checked_calloc(new_count, sizeof(ChainNode*), "chain_grow");
+    for (size_t i = 0; i < map->bucket_count; i++) {
+        ChainNode* node = map->buckets[i];
+        while (node) {
+            ChainNode* next = node->next;
+            size_t index = node->hash & (new_count - 1);
+            node->next = new_buckets[index];
+            new_buckets[index] = node;
+            node = next;
+        }
+    }
+    free(map->buckets);
+    map->buckets = new_buckets;
+    map->bucket_count = new_count;
+}
+
+static ChainNode* chain_find(const ChainMap* map, KValue key, uint32_t hash) {
+    ChainNode* node = map->buckets[hash & (map->bucket_count - 1)];
+    while (node) {
+        if (node->hash == hash && kmap_keys_equal(node->key, key)) return node;
+        node = node->next;
+    }
+    return NULL;
+}
+
+static void chain_set(ChainMap* map, KValue key, KValue value) {
+    uint32_t hash = kmap_hash_key(key);
+    ChainNode* node = chain_find(map, key, hash);
+    if (node) {
+        node->value = value;
+        return;
+    }
+    if (map->count >= map->bucket_count) chain_grow(map);
+    node = malloc(sizeof(ChainNode));
+    if (!node) {
+        fprintf(stderr, "Error: malloc failed in chain_set\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t index = hash & (map->bucket_count - 1);
+    node->key = key;
+    node->value = value;
+    node->hash = hash;
+    node->next = map->buckets[index];
+    map->buckets[index] = node;
+    map->count++;
+}
+
+static bool chain_get(const ChainMap* map, KValue key, KValue* out) {
+    ChainNode* node = chain_find(map, key, kmap_hash_key(key));
+    if (!node) return false;
+    *out = node->value;
+    return true;
+}
+
+// 测试键: hits 是插入的键 (按插入顺序), misses 是不在表中的键;
+// lookups 与 lookup_misses 是打乱顺序后的同一批键
+typedef struct BenchKeys {
+    KValue* hits;
+    KValue* misses;
+    KValue* lookups;
+    KValue* lookup_misses;
+    size_t count;
+} BenchKeys;
+
+// 辅助函数：生成 count 个键; 字符串键放进一个作为根的数组, 避免被回收
+static void make_keys(KorelinVM* vm, BenchKeys* keys, size_t count, bool strings, KArray* holder) {
+    keys->hits = checked_calloc(count, sizeof(KValue), "make_keys");
+    keys->misses = checked_calloc(count, sizeof(KValue), "make_keys");
+    keys->lookups = checked_calloc(count, sizeof(KValue), "make_keys");
+    keys->lookup_misses = checked_calloc(count, sizeof(KValue), "make_keys");
+    keys->count = count;
+    char buffer[32];
+    for (size_t i = 0; i < count; i++) {
+        long long n = (long long)i * 7919;
+        if (strings) {
+            int length = snprintf(buffer, sizeof(buffer), "key%lld", n);
+            keys->hits[i] = KVALUE_OBJECT(kstring_new(vm->heap, buffer, (size_t)length));
+            karray_push(vm->heap, holder, keys->hits[i]);
+            length = snprintf(buffer, sizeof(buffer), "miss%lld", n);
+            keys->misses[i] = KVALUE_OBJECT(kstring_new(vm->heap, buffer, (size_t)length));
+            karray_push(vm->heap, holder, keys->misses[i]);
+        } else {
+            keys->hits[i] = KVALUE_INT(n);
+            keys->misses[i] = KVALUE_INT(n + 1);
+        }
+    }
+    // Fisher-Yates 洗牌 (xorshift 伪随机数)
+    memcpy(keys->lookups, keys->hits, count * sizeof(KValue));
+    memcpy(keys->lookup_misses, keys->misses, count * sizeof(KValue));
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    for (size_t i = count - 1; i > 0; i--) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        size_t j = (size_t)(seed % (i + 1));
+        KValue tmp = keys->lookups[i];
+        keys->lookups[i] = keys->lookups[j];
+        keys->lookups[j] = tmp;
+        tmp = keys->lookup_misses[i];
+        keys->lookup_misses[i] = keys->lookup_misses[j];
+        keys->lookup_misses[j] = tmp;
+    }
+}
+
+static void print_result(const char* label, size_t size, const char* op, uint64_t kmap_ns, uint64_t chain_ns,
+                         size_t ops) {
+    printf("%s %zu: %-11s kmap %6.1f ns/op, chained %6.1f ns/op\n", label, size, op,
+           (double)kmap_ns / (double)ops, (double)chain_ns / (double)ops);
+}
+
+static void run(KorelinVM* vm, const char* label, size_t size, bool strings) {
+    KGCHeap* heap = vm->heap;
+    KArray* holder = karray_new(heap, strings ? size * 2 : 0);
+    kgc_push_root(heap, &holder->obj);
+    BenchKeys keys;
+    make_keys(vm, &keys, size, strings, holder);
+    size_t rounds = OPERATIONS / size > 0 ? OPERATIONS / size : 1;
+    size_t ops = rounds * size;
+    KValue value;
+    long long found = 0;
+
+    // 插入: 每轮建一张新表
+    KMap* map = NULL;
+    ChainMap chain = {0};
+    uint64_t start = now_ns();
+    for (size_t r = 0; r < rounds; r++) {
+        if (map) kgc_pop_roots(heap, 1);
+        map = kmap_new(heap, 0);
+        kgc_push_root(heap, &map->obj);
+        for (size_t i = 0; i < size; i++) kmap_set(heap, map, keys.hits[i], KVALUE_INT((long long)i));
+    }
+    uint64_t kmap_ns = now_ns() - start;
+    start = now_ns();
+    for (size_t r = 0; r < rounds; r++) {
+        if (chain.buckets) chain_free(&chain);
+        chain_init(&chain);
+        for (size_t i = 0; i < size; i++) chain_set(&chain, keys.hits[i], KVALUE_INT((long long)i));
+    }
+    print_result(label, size, "insert", kmap_ns, now_ns() - start, ops);
+
+    start = now_ns();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < size; i++) {
+            if (kmap_get(map, keys.lookups[i], &value)) found += value.as.integer;
+        }
+    }
+    kmap_ns = now_ns() - start;
+    start = now_ns();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < size; i++) {
+            if (chain_get(&chain, keys.lookups[i], &value)) found += value.as.integer;
+        }
+    }
+    print_result(label, size, "lookup hit", kmap_ns, now_ns() - start, ops);
+
+    start = now_ns();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < size; i++) found += kmap_get(map, keys.lookup_misses[i], &value);
+    }
+    kmap_ns = now_ns() - start;
+    start = now_ns();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < size; i++) found += chain_get(&chain, keys.lookup_misses[i], &value);
+    }
+    print_result(label, size, "lookup miss", kmap_ns, now_ns() - start, ops);
+
+    start = now_ns();
+    for (size_t r = 0; r < rounds; r++) {
+        size_t cursor = 0;
+        KValue key;
+        while (kmap_next(map, &cursor, &key, &value)) found += value.as.integer;
+    }
+    kmap_ns = now_ns() - start;
+    start = now_ns();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t b = 0; b < chain.bucket_count; b++) {
+            for (ChainNode* node = chain.buckets[b]; node; node = node->next) found += node->value.as.integer;
+        }
+    }
+    print_result(label, size, "iterate", kmap_ns, now_ns() - start, ops);
+
+    // 防止编译器把查找优化掉
+    if (found == -1) printf("%lld\n", found);
+    chain_free(&chain);
+    free(keys.hits);
+    free(keys.misses);
+    free(keys.lookups);
+    free(keys.lookup_misses);
+    kgc_pop_roots(heap, 2);
+}
+
+int main(int argc, char** argv) {
+    size_t max_size = argc > 1 ? (size_t)atoll(argv[1]) : MAX_SIZE;
+    if (max_size < 10) max_size = 10;
+    KorelinVM* vm = korelin_new();
+    for (int strings = 0; strings <= 1; strings++) {
+        for (size_t size = 10; size <= max_size; size *= 10) {
+            run(vm, strings ? "string" : "int", size, strings);
+            korelin_gc_collect(vm);
+        }
+    }
+    korelin_free(vm);
+    return 0;
+}
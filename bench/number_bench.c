@@ -0,0 +1,197 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+// 数值的格式化与解析 (knumber) 的正确性与速度, 与 snprintf("%.17g") 和 strtod 对比。
+//
+//   number_bench [数值个数]
+//
+// 测试数据各占三分之一: 随机位模式的有限浮点数、三位小数 (k / 1000, 导出 CSV 时常见)、
+// 整数值的浮点数。检查:
+//   往返: knumber_format_double 的输出经 knumber_parse 还原为同一个值 (逐位比较)
+//   最短: 有效数字不多于能够还原的最短 "%.Ng" (每 16 个值抽查一个)
+//   解析: knumber_parse 与 strtod 对 "%.17g" 的输出及随机的十进制字面量 (最多 19 位
+//         有效数字、指数 -330 到 310, 经过 Clinger 快速路径与 Eisel-Lemire) 结果相同
+// 之后输出每个数值的平均耗时。出错时退出码为 1。
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../src/knumber.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define COUNT 2000000
+
+// 辅助函数：获取单调时钟 (纳秒)
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// 辅助函数：xorshift 伪随机数
+static uint64_t next_random(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+static bool same_bits(double a, double b) {
+    return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+// 辅助函数：十进制表示中的有效数字个数
+static int significant_digits(const char* text) {
+    int count = 0;
+    int zeros = 0;     // 尚未确定是否在末尾的 0
+    bool leading = true;
+    for (const char* p = text; *p && *p != 'e'; p++) {
+        if (*p < '0' || *p > '9') continue;
+        if (*p == '0') {
+            if (!leading) zeros++;
+            continue;
+        }
+        leading = false;
+        count += zeros + 1;
+        zeros = 0;
+    }
+    return count > 0 ? count : 1;
+}
+
+// 辅助函数：能够还原 value 的最短 "%.Ng" 的 N
+static int shortest_printf(double value) {
+    char buffer[64];
+    for (int digits = 1; digits < 17; digits++) {
+        snprintf(buffer, sizeof(buffer), "%.*g", digits, value);
+        if (strtod(buffer, NULL) == value) return digits;
+    }
+    return 17;
+}
+
+static double* make_values(size_t count) {
+    double* values = malloc(count * sizeof(double));
+    if (!values) {
+        fprintf(stderr, "Error: malloc failed in make_values\n");
+        exit(EXIT_FAILURE);
+    }
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t r = next_random(&seed);
+        switch (i % 3) {
+            case 0: {
+                double value;
+                do {
+                    r = next_random(&seed);
+                    memcpy(&value, &r, sizeof(double));
+                } while (!isfinite(value));
+                values[i] = value;
+                break;
+            }
+            case 1:
+                values[i] = (double)(long long)(r % 2000000000) / 1000.0 - 1000000.0;
+                break;
+            default:
+                values[i] = (double)(long long)(r >> 11) - (double)(1ll << 52);
+                break;
+        }
+    }
+    return values;
+}
+
+// 辅助函数：随机的十进制字面量, 返回长度
+static size_t random_literal(uint64_t* seed, char* buffer) {
+    uint64_t r = next_random(seed);
+    int digits = 1 + (int)(r % 19);
+    size_t length = 0;
+    if ((r >> 8) & 1) buffer[length++] = '-';
+    for (int i = 0; i < digits; i++) {
+        buffer[length++] = (char)('0' + next_random(seed) % 10);
+        if (i == 0 && digits > 1) buffer[length++] = '.';
+    }
+    int exponent = (int)((r >> 16) % 641) - 330;
+    length += (size_t)snprintf(buffer + length, 16, "e%d", exponent);
+    return length;
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? (size_t)atoll(argv[1]) : COUNT;
+    if (count < 3) count = 3;
+    double* values = make_values(count);
+    char buffer[64];
+    size_t errors = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        size_t length = knumber_format_double(values[i], buffer);
+        long long integer;
+        double parsed;
+        if (knumber_parse(buffer, length, &integer, &parsed) != KNUMBER_DOUBLE || !same_bits(parsed, values[i])) {
+            if (errors++ < 10) printf("round trip: %.17g -> %s\n", values[i], buffer);
+            continue;
+        }
+        if (i % 16 == 0 && significant_digits(buffer) > shortest_printf(values[i])) {
+            if (errors++ < 10) printf("not shortest: %.17g -> %s\n", values[i], buffer);
+        }
+        length = (size_t)snprintf(buffer, sizeof(buffer), "%.17g", values[i]);
+        KNumberKind kind = knumber_parse(buffer, length, &integer, &parsed);
+        double expected = strtod(buffer, NULL);
+        bool ok = kind == KNUMBER_DOUBLE ? same_bits(parsed, expected) : kind == KNUMBER_INT && integer == expected;
+        if (!ok && errors++ < 10) printf("parse: %s\n", buffer);
+    }
+    uint64_t seed = 12345;
+    for (size_t i = 0; i < count; i++) {
+        size_t length = random_literal(&seed, buffer);
+        long long integer;
+        double parsed;
+        if (knumber_parse(buffer, length, &integer, &parsed) != KNUMBER_DOUBLE ||
+            !same_bits(parsed, strtod(buffer, NULL))) {
+            if (errors++ < 10) printf("parse: %s\n", buffer);
+        }
+    }
+    printf("%zu values checked, %zu errors\n", count * 2, errors);
+
+    size_t total = 0;
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < count; i++) total += knumber_format_double(values[i], buffer);
+    uint64_t knumber_ns = now_ns() - start;
+    start = now_ns();
+    for (size_t i = 0; i < count; i++) total += (size_t)snprintf(buffer, sizeof(buffer), "%.17g", values[i]);
+    printf("format: knumber %.1f ns/value, snprintf %%.17g %.1f ns/value\n", (double)knumber_ns / (double)count,
+           (double)(now_ns() - start) / (double)count);
+
+    // 解析 knumber 自己的输出 (最短形式)
+    char* texts = malloc(count * KNUMBER_BUFFER_SIZE);
+    size_t* lengths = malloc(count * sizeof(size_t));
+    if (!texts || !lengths) {
+        fprintf(stderr, "Error: malloc failed in main\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < count; i++) {
+        lengths[i] = knumber_format_double(values[i], texts + i * KNUMBER_BUFFER_SIZE);
+    }
+    double sum = 0;
+    start = now_ns();
+    for (size_t i = 0; i < count; i++) {
+        long long integer;
+        double parsed = 0;
+        knumber_parse(texts + i * KNUMBER_BUFFER_SIZE, lengths[i], &integer, &parsed);
+        sum += parsed;
+    }
+    knumber_ns = now_ns() - start;
+    start = now_ns();
+    for (size_t i = 0; i < count; i++) sum += strtod(texts + i * KNUMBER_BUFFER_SIZE, NULL);
+    printf("parse: knumber %.1f ns/value, strtod %.1f ns/value\n", (double)knumber_ns / (double)count,
+           (double)(now_ns() - start) / (double)count);
+
+    // 防止编译器把循环优化掉
+    if (total == 0 && sum == 0) printf("\n");
+    free(texts);
+    free(lengths);
+    free(values);
+    return errors > 0;
+}
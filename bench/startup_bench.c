@@ -0,0 +1,125 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+// 启动镜像的效果: 同一个脚本从源文件启动与从镜像启动, 到第一条语句执行完的时间。
+//
+//   startup_bench korelin bench/startup_init.kri
+//
+// 脚本在初始化之后执行第一条语句 (输出一行摘要) 就结束, 因此以从启动进程到进程退出的
+// 时间作为到第一条语句的时间 (print 在标准输出是管道时不刷新, 无法在中途观察)。先运行
+// 一次写出镜像, 然后两种方式各运行 RUNS 次, 取中位数, 并核对两者输出的摘要相同。
+// 镜像写在临时目录中, 结束时删除。
+
+#define _GNU_SOURCE
+
+#include <signal.h>
+#include <spawn.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RUNS 7
+
+extern char** environ;
+
+// 辅助函数：获取单调时钟 (纳秒)
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void fail(const char* what) {
+    perror(what);
+    exit(EXIT_FAILURE);
+}
+
+// 辅助函数：运行 korelin run target, 标准输入为 input 一行, 输出读入 output; 返回耗时 (纳秒),
+// 进程失败时返回 0
+static uint64_t run(const char* korelin, const char* target, const char* input, char* output, size_t size) {
+    int in[2], out[2];
+    if (pipe(in) < 0 || pipe(out) < 0) fail("pipe");
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, in[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, in[1]);
+    posix_spawn_file_actions_addclose(&actions, out[0]);
+    char* argv[] = {(char*)korelin, "run", (char*)target, NULL};
+    pid_t child;
+    uint64_t start = now_ns();
+    if (posix_spawn(&child, korelin, &actions, NULL, argv, environ) != 0) fail("posix_spawn");
+    posix_spawn_file_actions_destroy(&actions);
+    close(in[0]);
+    close(out[1]);
+    dprintf(in[1], "%s\n", input);
+    close(in[1]);
+    size_t length = 0;
+    ssize_t n;
+    while (length + 1 < size && (n = read(out[0], output + length, size - 1 - length)) > 0) length += (size_t)n;
+    output[length] = '\0';
+    close(out[0]);
+    int status;
+    waitpid(child, &status, 0);
+    uint64_t elapsed = now_ns() - start;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? elapsed : 0;
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// 辅助函数：运行 RUNS 次, 返回耗时的中位数, 任何一次失败或输出与 expected 不同时返回 0
+static uint64_t median_run(const char* korelin, const char* target, const char* input, const char* expected) {
+    uint64_t times[RUNS];
+    char output[4096];
+    for (int i = 0; i < RUNS; i++) {
+        times[i] = run(korelin, target, input, output, sizeof(output));
+        if (times[i] == 0 || strcmp(output, expected) != 0) {
+            fprintf(stderr, "startup_bench: '%s' failed or printed: %s\n", target, output);
+            return 0;
+        }
+    }
+    qsort(times, RUNS, sizeof(uint64_t), compare_u64);
+    return times[RUNS / 2];
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: startup_bench korelin startup_init.kri\n");
+        return 64;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    char image[] = "/tmp/korelin_startup_XXXXXX";
+    int fd = mkstemp(image);
+    if (fd < 0) fail("mkstemp");
+    close(fd);
+
+    char expected[4096];
+    int status = 1;
+    if (run(argv[1], argv[2], image, expected, sizeof(expected)) == 0) {
+        fprintf(stderr, "startup_bench: writing the image failed: %s\n", expected);
+    } else {
+        struct stat info;
+        stat(image, &info);
+        uint64_t source = median_run(argv[1], argv[2], "", expected);
+        uint64_t resumed = median_run(argv[1], image, "", expected);
+        if (source && resumed) {
+            printf("time to first statement: source %.1f ms, image %.1f ms (%.1fx), image %.1f MB\n",
+                   (double)source / 1e6, (double)resumed / 1e6, (double)source / (double)resumed,
+                   (double)info.st_size / (1024 * 1024));
+            status = 0;
+        }
+    }
+    unlink(image);
+    return status;
+}
@@ -0,0 +1,91 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+// 系统调用计数器: 以 LD_PRELOAD 载入服务器进程, 包装 knet 与 kuring 用到的系统调用入口,
+// 每次调用把共享计数加一。计数放在 KORELIN_SYSCALL_COUNTER 给出的文件的前 8 个字节,
+// 以 MAP_SHARED 映射, 负载端 (bench/http_load.c) 映射同一个文件, 在每种负载前后读取。
+// 未设置该变量时不计数。
+//
+//   LD_PRELOAD=libsyscall_count.so KORELIN_SYSCALL_COUNTER=文件 korelin run 脚本
+//
+// clock_gettime 走 vDSO, 不进入内核, 不计入。
+
+#define _GNU_SOURCE
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uint64_t* counter;
+
+static void __attribute__((constructor)) counter_open(void) {
+    const char* path = getenv("KORELIN_SYSCALL_COUNTER");
+    if (!path) return;
+    int fd = open(path, O_RDWR);
+    if (fd < 0) return;
+    void* map = mmap(NULL, sizeof(uint64_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map != MAP_FAILED) counter = map;
+}
+
+static void count(void) {
+    if (counter) __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+}
+
+// 定义一个包装函数: 第一次调用时找到 libc 中的实现, 计数后转发
+#define WRAP(ret, name, params, args)                                   \
+    ret name params {                                                   \
+        static ret (*real) params;                                      \
+        if (!real) real = (ret (*) params)dlsym(RTLD_NEXT, #name);      \
+        count();                                                        \
+        return real args;                                               \
+    }
+
+WRAP(ssize_t, read, (int fd, void* buffer, size_t size), (fd, buffer, size))
+WRAP(ssize_t, sendmsg, (int fd, const struct msghdr* message, int flags), (fd, message, flags))
+WRAP(ssize_t, sendfile, (int out, int in, off_t* offset, size_t size), (out, in, offset, size))
+WRAP(int, accept4, (int fd, struct sockaddr* address, socklen_t* length, int flags), (fd, address, length, flags))
+WRAP(int, close, (int fd), (fd))
+WRAP(int, shutdown, (int fd, int how), (fd, how))
+WRAP(int, setsockopt, (int fd, int level, int name, const void* value, socklen_t length),
+     (fd, level, name, value, length))
+WRAP(int, getsockopt, (int fd, int level, int name, void* value, socklen_t* length), (fd, level, name, value, length))
+WRAP(int, fstat, (int fd, struct stat* status), (fd, status))
+WRAP(int, epoll_wait, (int epoll, struct epoll_event* events, int max, int timeout), (epoll, events, max, timeout))
+WRAP(int, epoll_ctl, (int epoll, int op, int fd, struct epoll_event* event), (epoll, op, fd, event))
+
+int open(const char* path, int flags, ...) {
+    static int (*real)(const char*, int, ...);
+    if (!real) real = (int (*)(const char*, int, ...))dlsym(RTLD_NEXT, "open");
+    mode_t mode = 0;
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, mode_t);
+        va_end(args);
+    }
+    count();
+    return real(path, flags, mode);
+}
+
+// kuring 经 syscall() 调用 io_uring_setup / io_uring_enter / io_uring_register, 最多六个参数
+long syscall(long number, ...) {
+    static long (*real)(long, ...);
+    if (!real) real = (long (*)(long, ...))dlsym(RTLD_NEXT, "syscall");
+    va_list args;
+    va_start(args, number);
+    long a = va_arg(args, long), b = va_arg(args, long), c = va_arg(args, long);
+    long d = va_arg(args, long), e = va_arg(args, long), f = va_arg(args, long);
+    va_end(args);
+    count();
+    return real(number, a, b, c, d, e, f);
+}
@@ -0,0 +1,258 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+// 分层时间轮 (kwheel) 的正确性与速度, 与带下标的二叉堆对比。
+//
+//   wheel_bench
+//
+// 检查: TIMERS 个定时器, ROUNDS 轮, 每轮随机插入或取消 CHANGES 个 (到期时间从 0 到
+// 10^10 个刻度, 覆盖全部四层与最高层之外), 再把时间推进随机的一段。每个定时器恰好
+// 到期一次, 按到期时间的顺序, 不早于到期时间, 取消的不会到期; 每 64 轮核对所有仍在
+// 等待的定时器都还没有到期, 并且 kwheel_next 不晚于最早的到期时间。出错时退出码为 1。
+//
+// 速度: TIMERS 个空闲超时 (10 到 60 秒, 1 刻度为 1 毫秒) 的插入、重置 (取消后重新插入,
+// 连接每收到一次数据就重置一次) 与取消, 以及全部到期, 输出每次操作的平均耗时。
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../src/kwheel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define TIMERS 200000
+#define ROUNDS 20000
+#define CHANGES 20
+
+// 基线: 按到期时间排列的二叉堆, 定时器记录自己在堆中的下标以便取消
+typedef struct HeapTimer {
+    uint64_t expires;
+    size_t index;       // 不在堆中时为 SIZE_MAX
+} HeapTimer;
+
+typedef struct TimerHeap {
+    HeapTimer** items;
+    size_t count;
+} TimerHeap;
+
+static KTimer timers[TIMERS];
+static HeapTimer heap_timers[TIMERS];
+static int states[TIMERS];          // 1 表示正在等待
+static uint64_t deadlines[TIMERS];
+
+// 辅助函数：获取单调时钟 (纳秒)
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// 辅助函数：xorshift 伪随机数
+static uint64_t next_random(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+static void heap_place(TimerHeap* heap, HeapTimer* timer, size_t index) {
+    heap->items[index] = timer;
+    timer->index = index;
+}
+
+static void heap_sift_up(TimerHeap* heap, size_t index) {
+    HeapTimer* timer = heap->items[index];
+    while (index > 0 && heap->items[(index - 1) / 2]->expires > timer->expires) {
+        heap_place(heap, heap->items[(index - 1) / 2], index);
+        index = (index - 1) / 2;
+    }
+    heap_place(heap, timer, index);
+}
+
+static void heap_sift_down(TimerHeap* heap, size_t index) {
+    HeapTimer* timer = heap->items[index];
+    for (;;) {
+        size_t child = index * 2 + 1;
+        if (child >= heap->count) break;
+        if (child + 1 < heap->count && heap->items[child + 1]->expires < heap->items[child]->expires) child++;
+        if (heap->items[child]->expires >= timer->expires) break;
+        heap_place(heap, heap->items[child], index);
+        index = child;
+    }
+    heap_place(heap, timer, index);
+}
+
+static void heap_add(TimerHeap* heap, HeapTimer* timer, uint64_t expires) {
+    timer->expires = expires;
+    heap_place(heap, timer, heap->count++);
+    heap_sift_up(heap, timer->index);
+}
+
+static void heap_remove(TimerHeap* heap, HeapTimer* timer) {
+    size_t index = timer->index;
+    timer->index = SIZE_MAX;
+    HeapTimer* last = heap->items[--heap->count];
+    if (last == timer) return;
+    heap_place(heap, last, index);
+    heap_sift_up(heap, index);
+    heap_sift_down(heap, last->index);
+}
+
+// 辅助函数：检查时间轮, 返回错误个数
+static int check(void) {
+    static KWheel wheel;
+    uint64_t seed = 88172645463325252ull;
+    uint64_t now = 123456789;
+    kwheel_init(&wheel, now);
+    for (size_t round = 0; round < ROUNDS; round++) {
+        for (int change = 0; change < CHANGES; change++) {
+            size_t i = next_random(&seed) % TIMERS;
+            if (states[i]) {
+                kwheel_remove(&wheel, &timers[i]);
+                states[i] = 0;
+                continue;
+            }
+            static const uint64_t ranges[] = {300, 70000, 20000000, 10000000000ull};
+            uint64_t delta = next_random(&seed) % ranges[next_random(&seed) % 4];
+            kwheel_add(&wheel, &timers[i], now + delta);
+            deadlines[i] = delta == 0 ? now + 1 : now + delta;
+            states[i] = 1;
+        }
+        uint64_t step = next_random(&seed) % 4 == 0 ? next_random(&seed) % 50000000 : next_random(&seed) % 600;
+        uint64_t target = now + step;
+        KTimer expired;
+        kwheel_list_init(&expired);
+        kwheel_advance(&wheel, target, &expired);
+        uint64_t last = 0;
+        while (expired.next != &expired) {
+            KTimer* timer = expired.next;
+            kwheel_remove(&wheel, timer);
+            size_t i = (size_t)(timer - timers);
+            if (!states[i] || deadlines[i] <= now || deadlines[i] > target || timer->expires < last) {
+                printf("timer %zu fired wrongly: deadline %llu, advanced from %llu to %llu\n", i,
+                       (unsigned long long)deadlines[i], (unsigned long long)now, (unsigned long long)target);
+                return 1;
+            }
+            last = timer->expires;
+            states[i] = 0;
+        }
+        now = target;
+        if (round % 64 != 0) continue;
+        uint64_t earliest = UINT64_MAX;
+        for (size_t i = 0; i < TIMERS; i++) {
+            if (!states[i]) continue;
+            if (deadlines[i] <= now) {
+                printf("timer %zu missed its deadline %llu\n", i, (unsigned long long)deadlines[i]);
+                return 1;
+            }
+            if (deadlines[i] < earliest) earliest = deadlines[i];
+        }
+        uint64_t tick;
+        if (earliest != UINT64_MAX && (!kwheel_next(&wheel, &tick) || tick > earliest)) {
+            printf("kwheel_next is later than the earliest deadline %llu\n", (unsigned long long)earliest);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void print_result(const char* op, uint64_t wheel_ns, uint64_t heap_ns) {
+    printf("%-8s wheel %6.1f ns/timer, binary heap %6.1f ns/timer\n", op, (double)wheel_ns / TIMERS,
+           (double)heap_ns / TIMERS);
+}
+
+// 辅助函数：在 [10 秒, 60 秒) 之间的随机超时
+static uint64_t idle_timeout(uint64_t* seed) {
+    return 10000 + next_random(seed) % 50000;
+}
+
+static void measure(void) {
+    static KWheel wheel;
+    TimerHeap heap = {malloc(TIMERS * sizeof(HeapTimer*)), 0};
+    if (!heap.items) {
+        fprintf(stderr, "Error: malloc failed in measure\n");
+        exit(EXIT_FAILURE);
+    }
+    uint64_t now = 0;
+    kwheel_init(&wheel, now);
+    for (size_t i = 0; i < TIMERS; i++) timers[i].next = NULL;
+
+    uint64_t seed = 1;
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < TIMERS; i++) kwheel_add(&wheel, &timers[i], now + idle_timeout(&seed));
+    uint64_t wheel_ns = now_ns() - start;
+    seed = 1;
+    start = now_ns();
+    for (size_t i = 0; i < TIMERS; i++) heap_add(&heap, &heap_timers[i], now + idle_timeout(&seed));
+    print_result("insert", wheel_ns, now_ns() - start);
+
+    // 时间前进 5 秒, 随机的一半连接收到数据
+    now += 5000;
+    uint64_t order = 7;
+    start = now_ns();
+    for (size_t n = 0; n < TIMERS; n++) {
+        size_t i = next_random(&order) % TIMERS;
+        kwheel_remove(&wheel, &timers[i]);
+        kwheel_add(&wheel, &timers[i], now + idle_timeout(&seed));
+    }
+    wheel_ns = now_ns() - start;
+    order = 7;
+    start = now_ns();
+    for (size_t n = 0; n < TIMERS; n++) {
+        size_t i = next_random(&order) % TIMERS;
+        heap_remove(&heap, &heap_timers[i]);
+        heap_add(&heap, &heap_timers[i], now + idle_timeout(&seed));
+    }
+    print_result("reset", wheel_ns, now_ns() - start);
+
+    // 全部到期: 时间轮按毫秒推进, 堆逐个弹出堆顶
+    size_t fired = 0;
+    start = now_ns();
+    KTimer expired;
+    kwheel_list_init(&expired);
+    uint64_t tick;
+    while (kwheel_next(&wheel, &tick)) {
+        kwheel_advance(&wheel, tick, &expired);
+        while (expired.next != &expired) {
+            kwheel_remove(&wheel, expired.next);
+            fired++;
+        }
+    }
+    wheel_ns = now_ns() - start;
+    start = now_ns();
+    while (heap.count > 0) {
+        heap_remove(&heap, heap.items[0]);
+        fired++;
+    }
+    print_result("expire", wheel_ns, now_ns() - start);
+
+    // 取消: 重新插入后按随机顺序逐个取消
+    for (size_t i = 0; i < TIMERS; i++) {
+        kwheel_add(&wheel, &timers[i], tick + idle_timeout(&seed));
+        heap_add(&heap, &heap_timers[i], tick + idle_timeout(&seed));
+    }
+    order = 11;
+    start = now_ns();
+    for (size_t n = 0; n < TIMERS; n++) kwheel_remove(&wheel, &timers[next_random(&order) % TIMERS]);
+    wheel_ns = now_ns() - start;
+    order = 11;
+    start = now_ns();
+    for (size_t n = 0; n < TIMERS; n++) {
+        HeapTimer* timer = &heap_timers[next_random(&order) % TIMERS];
+        if (timer->index != SIZE_MAX) heap_remove(&heap, timer);
+    }
+    print_result("cancel", wheel_ns, now_ns() - start);
+
+    if (fired != 2 * TIMERS) printf("%zu timers fired, expected %d\n", fired, 2 * TIMERS);
+    free(heap.items);
+}
+
+int main(void) {
+    if (check() != 0) return 1;
+    printf("%d timers, %d rounds: every timer fired once, in order and on time\n", TIMERS, ROUNDS);
+    measure();
+    return 0;
+}
@@ -29,8 +29,10 @@ const char* node_type_to_string(NodeType type) {
         case NODE_WHILE_STATEMENT: return "WhileStatement";
         case NODE_BREAK_STATEMENT: return "BreakStatement";
         case NODE_CONTINUE_STATEMENT: return "ContinueStatement";
+        case NODE_STRUCT_DECLARATION: return "StructDeclaration";
         case NODE_IDENTIFIER: return "Identifier";
         case NODE_INTEGER_LITERAL: return "IntegerLiteral";
+        case NODE_DOUBLE_LITERAL: return "DoubleLiteral";
         case NODE_STRING_LITERAL: return "StringLiteral";
         case NODE_BOOLEAN_LITERAL: return "BooleanLiteral";
         case NODE_PREFIX_EXPRESSION: return "PrefixExpression";
@@ -39,6 +41,7 @@ const char* node_type_to_string(NodeType type) {
         case NODE_FUNCTION_LITERAL: return "FunctionLiteral";
         case NODE_CALL_EXPRESSION: return "CallExpression";
         case NODE_ARRAY_LITERAL: return "ArrayLiteral";
+        case NODE_MAP_LITERAL: return "MapLiteral";
         case NODE_INDEX_EXPRESSION: return "IndexExpression";
         case NODE_CLASS_LITERAL: return "ClassLiteral";
         case NODE_MEMBER_ACCESS_EXPRESSION: return "MemberAccessExpression";
@@ -67,6 +70,11 @@ void print_ast(Node* node, int indent_level) {
             printf(" (value: %lld)\n", lit->value);
             break;
         }
+        case NODE_DOUBLE_LITERAL: {
+            DoubleLiteral* lit = (DoubleLiteral*)node;
+            printf(" (value: %g)\n", lit->value);
+            break;
+        }
         case NODE_STRING_LITERAL: {
             StringLiteral* lit = (StringLiteral*)node;
             printf(" (value: \"%s\")\n", lit->value);
@@ -142,6 +150,81 @@ void print_ast(Node* node, int indent_level) {
             }
             break;
         }
+        case NODE_FOR_STATEMENT: {
+            ForStatement* stmt = (ForStatement*)node;
+            printf("\n");
+            print_ast(stmt->initializer, indent_level + 1);
+            print_ast(stmt->condition, indent_level + 1);
+            print_ast(stmt->update, indent_level + 1);
+            print_ast(stmt->body, indent_level + 1);
+            break;
+        }
+        case NODE_WHILE_STATEMENT: {
+            WhileStatement* stmt = (WhileStatement*)node;
+            printf("\n");
+            print_ast(stmt->condition, indent_level + 1);
+            print_ast(stmt->body, indent_level + 1);
+            break;
+        }
+        case NODE_STRUCT_DECLARATION: {
+            StructDeclaration* decl = (StructDeclaration*)node;
+            printf(" (name: '%.*s')\n", (int)decl->name.length, decl->name.value);
+            for (size_t i = 0; i < decl->field_count; i++) {
+                print_indent(indent_level + 1);
+                printf("%.*s %.*s\n", (int)decl->fields[i].type.length, decl->fields[i].type.value,
+                       (int)decl->fields[i].name.length, decl->fields[i].name.value);
+            }
+            break;
+        }
+        case NODE_FUNCTION_LITERAL: {
+            FunctionLiteral* func = (FunctionLiteral*)node;
+            printf(" (name: '%s', params:", func->name.value ? func->name.value : "");
+            for (size_t i = 0; i < func->param_count; i++) {
+                printf(" %.*s", (int)func->parameters[i].length, func->parameters[i].value);
+            }
+            printf(")\n");
+            print_ast(func->body, indent_level + 1);
+            break;
+        }
+        case NODE_CALL_EXPRESSION: {
+            CallExpression* call = (CallExpression*)node;
+            printf("\n");
+            print_ast(call->function, indent_level + 1);
+            for (size_t i = 0; i < call->arg_count; i++) {
+                print_ast(call->arguments[i], indent_level + 1);
+            }
+            break;
+        }
+        case NODE_ARRAY_LITERAL: {
+            ArrayLiteral* array = (ArrayLiteral*)node;
+            printf("\n");
+            for (size_t i = 0; i < array->element_count; i++) {
+                print_ast(array->elements[i], indent_level + 1);
+            }
+            break;
+        }
+        case NODE_MAP_LITERAL: {
+            MapLiteral* map = (MapLiteral*)node;
+            printf("\n");
+            for (size_t i = 0; i < map->pair_count; i++) {
+                print_ast(map->keys[i], indent_level + 1);
+                print_ast(map->values[i], indent_level + 1);
+            }
+            break;
+        }
+        case NODE_INDEX_EXPRESSION: {
+            IndexExpression* expr = (IndexExpression*)node;
+            printf("\n");
+            print_ast(expr->left, indent_level + 1);
+            print_ast(expr->index, indent_level + 1);
+            break;
+        }
+        case NODE_MEMBER_ACCESS_EXPRESSION: {
+            MemberAccessExpression* expr = (MemberAccessExpression*)node;
+            printf(" (property: '%.*s')\n", (int)expr->property.length, expr->property.value);
+            print_ast(expr->object, indent_level + 1);
+            break;
+        }
         case NODE_PROGRAM: {
             Program* program = (Program*)node;
             printf("\n");
@@ -177,6 +260,12 @@ void free_ast(Node* node) {
             free(lit);
             break;
         }
+        case NODE_DOUBLE_LITERAL: {
+            DoubleLiteral* lit = (DoubleLiteral*)node;
+            free_korelin_token(&lit->token);
+            free(lit);
+            break;
+        }
         case NODE_STRING_LITERAL: {
             StringLiteral* lit = (StringLiteral*)node;
             free((void*)lit->value); // 释放字符串内容
@@ -256,6 +345,88 @@ void free_ast(Node* node) {
             free(stmt);
             break;
         }
+        case NODE_FOR_STATEMENT: {
+            ForStatement* stmt = (ForStatement*)node;
+            free_ast(stmt->initializer);
+            free_ast(stmt->condition);
+            free_ast(stmt->update);
+            free_ast(stmt->body);
+            free(stmt);
+            break;
+        }
+        case NODE_WHILE_STATEMENT: {
+            WhileStatement* stmt = (WhileStatement*)node;
+            free_ast(stmt->condition);
+            free_ast(stmt->body);
+            free(stmt);
+            break;
+        }
+        case NODE_STRUCT_DECLARATION: {
+            StructDeclaration* decl = (StructDeclaration*)node;
+            for (size_t i = 0; i < decl->field_count; i++) {
+                free_korelin_token(&decl->fields[i].type);
+                free_korelin_token(&decl->fields[i].name);
+            }
+            free(decl->fields);
+            free_korelin_token(&decl->name);
+            free(decl);
+            break;
+        }
+        case NODE_FUNCTION_LITERAL: {
+            FunctionLiteral* func = (FunctionLiteral*)node;
+            for (size_t i = 0; i < func->param_count; i++) {
+                free_korelin_token(&func->parameters[i]);
+            }
+            free(func->parameters);
+            if (func->name.value) free_korelin_token(&func->name);
+            free_ast(func->body);
+            free(func);
+            break;
+        }
+        case NODE_CALL_EXPRESSION: {
+            CallExpression* call = (CallExpression*)node;
+            free_ast(call->function);
+            for (size_t i = 0; i < call->arg_count; i++) {
+                free_ast(call->arguments[i]);
+            }
+            free(call->arguments);
+            free(call);
+            break;
+        }
+        case NODE_ARRAY_LITERAL: {
+            ArrayLiteral* array = (ArrayLiteral*)node;
+            for (size_t i = 0; i < array->element_count; i++) {
+                free_ast(array->elements[i]);
+            }
+            free(array->elements);
+            free(array);
+            break;
+        }
+        case NODE_MAP_LITERAL: {
+            MapLiteral* map = (MapLiteral*)node;
+            for (size_t i = 0; i < map->pair_count; i++) {
+                free_ast(map->keys[i]);
+                free_ast(map->values[i]);
+            }
+            free(map->keys);
+            free(map->values);
+            free(map);
+            break;
+        }
+        case NODE_INDEX_EXPRESSION: {
+            IndexExpression* expr = (IndexExpression*)node;
+            free_ast(expr->left);
+            free_ast(expr->index);
+            free(expr);
+            break;
+        }
+        case NODE_MEMBER_ACCESS_EXPRESSION: {
+            MemberAccessExpression* expr = (MemberAccessExpression*)node;
+            free_ast(expr->object);
+            free_korelin_token(&expr->property);
+            free(expr);
+            break;
+        }
         case NODE_PROGRAM: {
             Program* program = (Program*)node;
             for (size_t i = 0; i < program->statement_count; i++) {
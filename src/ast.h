@@ -22,10 +22,12 @@ typedef enum {
     NODE_WHILE_STATEMENT,
     NODE_BREAK_STATEMENT,
     NODE_CONTINUE_STATEMENT,
+    NODE_STRUCT_DECLARATION, // e.g., struct Point { double x; double y; }
 
     // 表达式 (Expressions)
     NODE_IDENTIFIER,
     NODE_INTEGER_LITERAL,
+    NODE_DOUBLE_LITERAL,
     NODE_STRING_LITERAL,
     NODE_BOOLEAN_LITERAL,
 
@@ -38,6 +40,7 @@ typedef enum {
 
     NODE_ARRAY_LITERAL,      // e.g., [1, "two", x]
     NODE_INDEX_EXPRESSION,   // e.g., myArray[0]
+    NODE_MAP_LITERAL,        // e.g., {"a": 1, 2: x}
 
     NODE_CLASS_LITERAL,      // e.g., class MyClass { ... }
     NODE_MEMBER_ACCESS_EXPRESSION, // e.g., obj.property, obj.method()
@@ -46,6 +49,7 @@ typedef enum {
 
 typedef struct Node {
     NodeType type;
+    int line;           // 节点起始 Token 所在的行号, 0 表示未知
 } Node;
 
 // 程序根节点，包含一个语句列表。
@@ -53,6 +57,7 @@ typedef struct Program {
     Node node;
     Node** statements;
     size_t statement_count;
+    size_t error_count;     // 解析错误数, 不为 0 时不应继续编译
 } Program;
 
 // let 语句，例如: let x = 42;
@@ -122,6 +127,20 @@ typedef struct ContinueStatement {
     Node node;
 } ContinueStatement;
 
+// 结构体字段，例如: double x
+typedef struct StructField {
+    KorelinToken type;          // 字段类型: 类型关键字, 或另一个结构体的名字 (KORELIN_IDENT)
+    KorelinToken name;
+} StructField;
+
+// 结构体声明，例如: struct Point { double x; double y; }
+typedef struct StructDeclaration {
+    Node node;
+    KorelinToken name;
+    StructField* fields;
+    size_t field_count;
+} StructDeclaration;
+
 // 标识符，例如: x, myVariable, add
 typedef struct Identifier {
     Node node;
@@ -134,8 +153,16 @@ typedef struct IntegerLiteral {
     Node node;
     KorelinToken token; // KORELIN_INT 类型的 Token
     long long value; // 使用 long long 以支持更大范围的整数
+    bool big;        // 超出 64 位的整数 (value 无效), 值由 token 中的字面量得到
 } IntegerLiteral;
 
+// 浮点数字面量，例如: 3.14
+typedef struct DoubleLiteral {
+    Node node;
+    KorelinToken token; // KORELIN_DOUBLE 类型的 Token
+    double value;
+} DoubleLiteral;
+
 // 字符串字面量，例如: "hello world"
 typedef struct StringLiteral {
     Node node;
@@ -177,6 +204,7 @@ typedef struct AssignmentExpression {
 typedef struct FunctionLiteral {
     Node node;
     KorelinToken token;         // 'func' 关键字的 Token
+    KorelinToken name;          // 函数声明的名字, 匿名函数的 value 为 NULL
     KorelinToken* parameters;   // 参数列表 (Token 数组)
     size_t param_count;  // 参数数量
     Node* body;          // 函数体 (BlockStatement)
@@ -197,6 +225,14 @@ typedef struct ArrayLiteral {
     size_t element_count; // 元素数量
 } ArrayLiteral;
 
+// 字典字面量，例如: {"a": 1, 2: x}
+typedef struct MapLiteral {
+    Node node;
+    Node** keys;         // 键表达式列表
+    Node** values;       // 值表达式列表, 与 keys 一一对应
+    size_t pair_count;   // 键值对数量
+} MapLiteral;
+
 // 索引表达式，例如: myArray[0], obj["key"]
 typedef struct IndexExpression {
     Node node;
@@ -204,6 +240,13 @@ typedef struct IndexExpression {
     Node* index;         // 索引表达式
 } IndexExpression;
 
+// 成员访问表达式，例如: point.x
+typedef struct MemberAccessExpression {
+    Node node;
+    Node* object;        // 被访问的对象
+    KorelinToken property; // 成员名 (KORELIN_IDENT)
+} MemberAccessExpression;
+
 /**
  * @brief 递归地释放 AST 节点及其所有子节点占用的内存。
  * @param node 指向要释放的根节点的指针。
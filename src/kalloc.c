@@ -0,0 +1,599 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#define _GNU_SOURCE
+
+#include "kalloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// 空闲单元: 第一个字为 0, 第二个字为下一个空闲单元
+typedef struct KAllocFreeCell {
+    uint64_t tag;
+    struct KAllocFreeCell* next;
+} KAllocFreeCell;
+
+_Static_assert(sizeof(KAllocPage) <= KALLOC_PAGE_HEADER, "KAllocPage must fit in the page header");
+
+// 各尺寸类的单元大小
+static const size_t class_sizes[KALLOC_CLASS_COUNT] = {
+    16, 32, 48, 64, 80, 96, 112, 128,
+    160, 192, 224, 256,
+    320, 384, 448, 512,
+    640, 768, 896, 1024,
+    1280, 1536, 1792, 2048,
+    2560, 3072, 3584, 4096,
+    5120, 6144, 7168, 8192,
+};
+
+// 以 16 字节为粒度的尺寸 -> 尺寸类查找表
+static uint8_t class_of_granule[KALLOC_MAX_SMALL / 16 + 1];
+static pthread_once_t class_table_once = PTHREAD_ONCE_INIT;
+
+// 当前线程最近使用的分配缓存及其分配器的编号: 先比较编号, 不解引用可能已被其他线程
+// 销毁的分配器的缓存
+static _Thread_local KAllocCache* tl_cache;
+static _Thread_local uint64_t tl_cache_owner;
+static uint64_t next_allocator_id = 1;
+
+// =============================================================================
+// 辅助函数
+// =============================================================================
+
+static void build_class_table(void) {
+    unsigned cls = 0;
+    for (size_t granule = 0; granule <= KALLOC_MAX_SMALL / 16; granule++) {
+        while (class_sizes[cls] < granule * 16) cls++;
+        class_of_granule[granule] = (uint8_t)cls;
+    }
+}
+
+// 辅助函数：从操作系统映射内存
+static void* map_memory(size_t size) {
+    void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        fprintf(stderr, "Error: mmap failed in kalloc\n");
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+// 辅助函数：映射一个按 KALLOC_PAGE_SIZE 对齐的页面 (多映射一页, 再裁掉首尾)
+static void* map_aligned_page(void) {
+    char* raw = map_memory(KALLOC_PAGE_SIZE * 2);
+    uintptr_t aligned = ((uintptr_t)raw + KALLOC_PAGE_SIZE - 1) & ~(uintptr_t)(KALLOC_PAGE_SIZE - 1);
+    size_t head = aligned - (uintptr_t)raw;
+    size_t tail = KALLOC_PAGE_SIZE - head;
+    if (head) munmap(raw, head);
+    if (tail) munmap((char*)aligned + KALLOC_PAGE_SIZE, tail);
+    return (void*)aligned;
+}
+
+// 获取一个空页面 (优先复用空页面池)
+static KAllocPage* acquire_page(KAllocator* allocator) {
+    pthread_mutex_lock(&allocator->pool_lock);
+    KAllocPage* page = allocator->empty_pool;
+    if (page) {
+        allocator->empty_pool = page->next;
+        allocator->empty_count--;
+    }
+    pthread_mutex_unlock(&allocator->pool_lock);
+
+    if (!page) {
+        page = map_aligned_page();
+        pthread_mutex_lock(&allocator->pool_lock);
+        allocator->mapped_bytes += KALLOC_PAGE_SIZE;
+        pthread_mutex_unlock(&allocator->pool_lock);
+    }
+    return page;
+}
+
+// 归还一个完全空闲的页面: 池未满时保留, 否则归还给操作系统
+static void release_page(KAllocator* allocator, KAllocPage* page) {
+    pthread_mutex_lock(&allocator->pool_lock);
+    if (allocator->empty_count < KALLOC_EMPTY_POOL_MAX) {
+        page->next = allocator->empty_pool;
+        allocator->empty_pool = page;
+        allocator->empty_count++;
+        page = NULL;
+    } else {
+        allocator->mapped_bytes -= KALLOC_PAGE_SIZE;
+        allocator->pages_released++;
+    }
+    pthread_mutex_unlock(&allocator->pool_lock);
+
+    if (page) {
+        munmap(page, KALLOC_PAGE_SIZE);
+    }
+}
+
+// 把页面格式化为指定尺寸类, 所有单元串成空闲链表
+static void format_page(KAllocPage* page, unsigned size_class) {
+    size_t cell_size = class_sizes[size_class];
+    page->size_class = (uint16_t)size_class;
+    page->cell_size = cell_size;
+    page->mapped_size = KALLOC_PAGE_SIZE;
+    page->cell_count = (uint32_t)((KALLOC_PAGE_SIZE - KALLOC_PAGE_HEADER) / cell_size);
+    page->next_partial = NULL;
+
+    char* base = (char*)page + KALLOC_PAGE_HEADER;
+    KAllocFreeCell* free_list = NULL;
+    for (uint32_t i = page->cell_count; i-- > 0;) {
+        KAllocFreeCell* cell = (KAllocFreeCell*)(base + i * cell_size);
+        cell->tag = 0;
+        cell->next = free_list;
+        free_list = cell;
+    }
+    page->free_list = free_list;
+    page->free_count = page->cell_count;
+}
+
+// 查找 (或创建) 当前线程在该分配器上的缓存
+static KAllocCache* find_cache(KAllocator* allocator) {
+    pthread_t self = pthread_self();
+    pthread_mutex_lock(&allocator->lock);
+    KAllocCache* cache = allocator->caches;
+    while (cache && !pthread_equal(cache->thread, self)) {
+        cache = cache->next;
+    }
+    if (!cache) {
+        cache = calloc(1, sizeof(KAllocCache));
+        if (!cache) {
+            fprintf(stderr, "Error: calloc failed in find_cache\n");
+            exit(EXIT_FAILURE);
+        }
+        cache->owner = allocator;
+        cache->thread = self;
+        cache->next = allocator->caches;
+        allocator->caches = cache;
+    }
+    pthread_mutex_unlock(&allocator->lock);
+    tl_cache = cache;
+    tl_cache_owner = allocator->id;
+    return cache;
+}
+
+// 清空所有线程缓存 (缓存中的单元仍标记为空闲, 重建页面空闲链表时会被重新收集)
+static void flush_caches(KAllocator* allocator) {
+    for (KAllocCache* cache = allocator->caches; cache; cache = cache->next) {
+        memset(cache->free, 0, sizeof(cache->free));
+    }
+}
+
+// =============================================================================
+// 清扫
+// =============================================================================
+
+// 清扫一个小对象页面, 重建其空闲链表, 返回释放的字节数
+static size_t sweep_page(KAllocator* allocator, KAllocPage* page) {
+    char* base = (char*)page + KALLOC_PAGE_HEADER;
+    size_t cell_size = page->cell_size;
+    KAllocFreeCell* free_list = NULL;
+    uint32_t free_count = 0;
+    size_t freed = 0;
+
+    // 倒序遍历, 使空闲链表按地址升序排列
+    for (uint32_t i = page->cell_count; i-- > 0;) {
+        KAllocFreeCell* cell = (KAllocFreeCell*)(base + i * cell_size);
+        if (cell->tag != 0) {
+            if (!allocator->sweep_fn(cell, allocator->sweep_userdata)) continue;
+            cell->tag = 0;
+            freed += cell_size;
+        }
+        cell->next = free_list;
+        free_list = cell;
+        free_count++;
+    }
+    page->free_list = free_list;
+    page->free_count = free_count;
+    return freed;
+}
+
+// 清扫尺寸类的下一个页面; 返回 false 表示该尺寸类已清扫完。klass 是 allocator 中的尺寸类,
+// 或并行清扫时承接一段页面的局部尺寸类
+static bool sweep_next_page(KAllocator* allocator, KAllocClass* klass, unsigned size_class, size_t* freed,
+                            size_t* work) {
+    KAllocPage** cursor = klass->sweep_cursor;
+    if (!cursor) return false;
+    KAllocPage* page = *cursor;
+    if (!page) {
+        klass->sweep_cursor = NULL;
+        return false;
+    }
+    *work += page->mapped_size;
+
+    if (size_class == KALLOC_LARGE_CLASS) {
+        void* obj = (char*)page + KALLOC_PAGE_HEADER;
+        if (allocator->sweep_fn(obj, allocator->sweep_userdata)) {
+            *cursor = page->next;
+            klass->page_count--;
+            *freed += page->cell_size;
+            pthread_mutex_lock(&allocator->pool_lock);
+            allocator->mapped_bytes -= page->mapped_size;
+            allocator->large_bytes -= page->cell_size;
+            pthread_mutex_unlock(&allocator->pool_lock);
+            munmap(page, page->mapped_size);
+        } else {
+            klass->sweep_cursor = &page->next;
+        }
+        return true;
+    }
+
+    *freed += sweep_page(allocator, page);
+    if (page->free_count == page->cell_count) {
+        *cursor = page->next;
+        klass->page_count--;
+        release_page(allocator, page);
+    } else {
+        if (page->free_count > 0) {
+            page->next_partial = klass->partial;
+            klass->partial = page;
+        }
+        klass->sweep_cursor = &page->next;
+    }
+    return true;
+}
+
+// 为线程缓存补充一个尺寸类的空闲单元 (调用者持有 allocator->lock)
+static KAllocFreeCell* refill(KAllocator* allocator, unsigned size_class) {
+    KAllocClass* klass = &allocator->classes[size_class];
+
+    // 惰性清扫: 没有可用页面时, 先清扫该尺寸类中尚未清扫的页面
+    while (!klass->partial && allocator->sweeping && klass->sweep_cursor) {
+        size_t work = 0;
+        sweep_next_page(allocator, klass, size_class, &allocator->pending_freed, &work);
+    }
+
+    KAllocPage* page = klass->partial;
+    if (page) {
+        klass->partial = page->next_partial;
+    } else {
+        page = acquire_page(allocator);
+        format_page(page, size_class);
+        page->next = klass->pages;
+        klass->pages = page;
+        klass->page_count++;
+    }
+
+    KAllocFreeCell* cells = page->free_list;
+    page->free_list = NULL;
+    page->free_count = 0;
+    page->next_partial = NULL;
+    return cells;
+}
+
+// 分配一个大对象 (单独映射)
+static void* large_alloc(KAllocator* allocator, size_t size, size_t* usable) {
+    size_t usable_size = (size + 15) & ~(size_t)15;
+    size_t mapped = (KALLOC_PAGE_HEADER + usable_size + 4095) & ~(size_t)4095;
+    KAllocPage* page = map_memory(mapped);
+    page->size_class = KALLOC_LARGE_CLASS;
+    page->cell_size = usable_size;
+    page->mapped_size = mapped;
+    page->cell_count = 1;
+    page->free_count = 0;
+    page->free_list = NULL;
+    page->next_partial = NULL;
+
+    pthread_mutex_lock(&allocator->lock);
+    KAllocClass* klass = &allocator->classes[KALLOC_LARGE_CLASS];
+    page->next = klass->pages;
+    klass->pages = page;
+    klass->page_count++;
+    pthread_mutex_unlock(&allocator->lock);
+
+    pthread_mutex_lock(&allocator->pool_lock);
+    allocator->mapped_bytes += mapped;
+    allocator->large_bytes += usable_size;
+    pthread_mutex_unlock(&allocator->pool_lock);
+
+    if (usable) *usable = usable_size;
+    return (char*)page + KALLOC_PAGE_HEADER;
+}
+
+// =============================================================================
+// 公共接口
+// =============================================================================
+
+void kalloc_init(KAllocator* allocator, KAllocSweepFn sweep_fn, void* userdata) {
+    pthread_once(&class_table_once, build_class_table);
+    memset(allocator, 0, sizeof(KAllocator));
+    allocator->id = __atomic_fetch_add(&next_allocator_id, 1, __ATOMIC_RELAXED);
+    pthread_mutex_init(&allocator->lock, NULL);
+    pthread_mutex_init(&allocator->pool_lock, NULL);
+    allocator->sweep_fn = sweep_fn;
+    allocator->sweep_userdata = userdata;
+}
+
+void kalloc_destroy(KAllocator* allocator) {
+    for (unsigned i = 0; i <= KALLOC_CLASS_COUNT; i++) {
+        KAllocPage* page = allocator->classes[i].pages;
+        while (page) {
+            KAllocPage* next = page->next;
+            munmap(page, page->mapped_size);
+            page = next;
+        }
+    }
+    KAllocPage* page = allocator->empty_pool;
+    while (page) {
+        KAllocPage* next = page->next;
+        munmap(page, KALLOC_PAGE_SIZE);
+        page = next;
+    }
+    KAllocCache* cache = allocator->caches;
+    while (cache) {
+        KAllocCache* next = cache->next;
+        if (tl_cache == cache) tl_cache = NULL;
+        free(cache);
+        cache = next;
+    }
+    pthread_mutex_destroy(&allocator->lock);
+    pthread_mutex_destroy(&allocator->pool_lock);
+    memset(allocator, 0, sizeof(KAllocator));
+}
+
+unsigned kalloc_size_class(size_t size) {
+    if (size > KALLOC_MAX_SMALL) return KALLOC_LARGE_CLASS;
+    return class_of_granule[(size + 15) / 16];
+}
+
+size_t kalloc_class_size(unsigned size_class) {
+    return size_class < KALLOC_CLASS_COUNT ? class_sizes[size_class] : 0;
+}
+
+size_t kalloc_usable_size(size_t size) {
+    if (size > KALLOC_MAX_SMALL) return (size + 15) & ~(size_t)15;
+    return class_sizes[class_of_granule[(size + 15) / 16]];
+}
+
+void* kalloc_alloc(KAllocator* allocator, size_t size, size_t* usable) {
+    if (size > KALLOC_MAX_SMALL) {
+        return large_alloc(allocator, size, usable);
+    }
+
+    unsigned size_class = class_of_granule[(size + 15) / 16];
+    KAllocCache* cache = tl_cache;
+    if (!cache || tl_cache_owner != allocator->id) {
+        cache = find_cache(allocator);
+    }
+
+    KAllocFreeCell* cell = cache->free[size_class];
+    if (!cell) {
+        pthread_mutex_lock(&allocator->lock);
+        cell = refill(allocator, size_class);
+        pthread_mutex_unlock(&allocator->lock);
+    }
+    cache->free[size_class] = cell->next;
+
+    if (usable) *usable = class_sizes[size_class];
+    return cell;
+}
+
+void kalloc_begin_sweep(KAllocator* allocator) {
+    flush_caches(allocator);
+    for (unsigned i = 0; i <= KALLOC_CLASS_COUNT; i++) {
+        KAllocClass* klass = &allocator->classes[i];
+        klass->partial = NULL;
+        klass->sweep_cursor = &klass->pages;
+    }
+    allocator->sweep_class = 0;
+    allocator->sweeping = true;
+}
+
+bool kalloc_sweep_some(KAllocator* allocator, size_t budget, size_t* freed) {
+    size_t work = 0;
+    pthread_mutex_lock(&allocator->lock);
+    while (allocator->sweep_class <= KALLOC_CLASS_COUNT) {
+        unsigned size_class = (unsigned)allocator->sweep_class;
+        if (!sweep_next_page(allocator, &allocator->classes[size_class], size_class, freed, &work)) {
+            allocator->sweep_class++;
+            continue;
+        }
+        if (work >= budget) break;
+    }
+    bool done = allocator->sweep_class > KALLOC_CLASS_COUNT;
+    pthread_mutex_unlock(&allocator->lock);
+    return done;
+}
+
+KAllocSweepRange* kalloc_split_sweep(KAllocator* allocator, size_t pages_per_range, size_t* count) {
+    size_t total = 0;
+    for (unsigned i = 0; i <= KALLOC_CLASS_COUNT; i++) {
+        KAllocPage** cursor = allocator->classes[i].sweep_cursor;
+        if (!cursor) continue;
+        size_t pages = 0;
+        for (KAllocPage* page = *cursor; page; page = page->next) pages++;
+        total += (pages + pages_per_range - 1) / pages_per_range;
+    }
+    *count = total;
+    if (total == 0) return NULL;
+
+    KAllocSweepRange* ranges = calloc(total, sizeof(KAllocSweepRange));
+    if (!ranges) {
+        fprintf(stderr, "Error: calloc failed in kalloc_split_sweep\n");
+        exit(EXIT_FAILURE);
+    }
+    // 各段的页面链表在段尾断开, 尺寸类的链表在第一段之前断开, 由 kalloc_join_ranges 重新接上
+    KAllocSweepRange* range = ranges;
+    for (unsigned i = 0; i <= KALLOC_CLASS_COUNT; i++) {
+        KAllocPage** cursor = allocator->classes[i].sweep_cursor;
+        if (!cursor || !*cursor) continue;
+        KAllocPage* page = *cursor;
+        *cursor = NULL;
+        range->link = cursor;
+        while (page) {
+            range->size_class = i;
+            range->first = page;
+            KAllocPage* last = page;
+            for (range->count = 1; range->count < pages_per_range && last->next; range->count++) {
+                last = last->next;
+            }
+            page = last->next;
+            last->next = NULL;
+            range++;
+        }
+    }
+    return ranges;
+}
+
+size_t kalloc_sweep_range(KAllocator* allocator, KAllocSweepRange* range) {
+    // 段的页面由局部的尺寸类承接, 与其他段互不影响; 空页面池与映射统计有各自的锁
+    KAllocClass local = {.pages = range->first, .page_count = range->count};
+    local.sweep_cursor = &local.pages;
+    size_t freed = 0;
+    size_t work = 0;
+    while (sweep_next_page(allocator, &local, range->size_class, &freed, &work)) {
+    }
+
+    range->kept = local.pages;
+    for (KAllocPage* page = local.pages; page; page = page->next) range->kept_last = page;
+    range->partial = local.partial;
+    for (KAllocPage* page = local.partial; page; page = page->next_partial) range->partial_last = page;
+    range->removed = range->count - local.page_count;
+    return freed;
+}
+
+void kalloc_join_ranges(KAllocator* allocator, KAllocSweepRange* ranges, size_t count) {
+    KAllocPage** tail = NULL;
+    for (size_t i = 0; i < count; i++) {
+        KAllocSweepRange* range = &ranges[i];
+        KAllocClass* klass = &allocator->classes[range->size_class];
+        if (range->link) tail = range->link;
+        *tail = range->kept;
+        if (range->kept) tail = &range->kept_last->next;
+        if (range->partial) {
+            range->partial_last->next_partial = klass->partial;
+            klass->partial = range->partial;
+        }
+        klass->page_count -= range->removed;
+    }
+    for (unsigned i = 0; i <= KALLOC_CLASS_COUNT; i++) {
+        allocator->classes[i].sweep_cursor = NULL;
+    }
+    free(ranges);
+}
+
+void kalloc_end_sweep(KAllocator* allocator) {
+    allocator->sweeping = false;
+    allocator->sweep_class = KALLOC_CLASS_COUNT + 1;
+}
+
+void kalloc_for_each_in_page(KAllocPage* page, KAllocCellFn fn, void* userdata) {
+    char* base = (char*)page + KALLOC_PAGE_HEADER;
+    for (uint32_t j = 0; j < page->cell_count; j++) {
+        KAllocFreeCell* cell = (KAllocFreeCell*)(base + j * page->cell_size);
+        if (cell->tag != 0) {
+            fn(cell, page->cell_size, userdata);
+        }
+    }
+}
+
+void kalloc_for_each(KAllocator* allocator, KAllocCellFn fn, void* userdata) {
+    for (unsigned i = 0; i < KALLOC_CLASS_COUNT; i++) {
+        for (KAllocPage* page = allocator->classes[i].pages; page; page = page->next) {
+            kalloc_for_each_in_page(page, fn, userdata);
+        }
+    }
+    for (KAllocPage* page = allocator->classes[KALLOC_LARGE_CLASS].pages; page; page = page->next) {
+        fn((char*)page + KALLOC_PAGE_HEADER, page->cell_size, userdata);
+    }
+}
+
+void kalloc_class_stats(KAllocator* allocator, unsigned size_class, KAllocClassStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (size_class == KALLOC_LARGE_CLASS) {
+        stats->pages = allocator->classes[KALLOC_LARGE_CLASS].page_count;
+        stats->cells = stats->pages;
+        stats->cells_used = stats->pages;
+        stats->bytes_used = allocator->large_bytes;
+        return;
+    }
+
+    stats->cell_size = class_sizes[size_class];
+    for (KAllocPage* page = allocator->classes[size_class].pages; page; page = page->next) {
+        char* base = (char*)page + KALLOC_PAGE_HEADER;
+        stats->pages++;
+        stats->cells += page->cell_count;
+        for (uint32_t j = 0; j < page->cell_count; j++) {
+            if (((KAllocFreeCell*)(base + j * page->cell_size))->tag != 0) {
+                stats->cells_used++;
+            }
+        }
+    }
+    stats->bytes_used = stats->cells_used * stats->cell_size;
+}
+
+// =============================================================================
+// 整理 (疏散稀疏页面)
+// =============================================================================
+
+size_t kalloc_small_capacity(KAllocator* allocator) {
+    size_t capacity = 0;
+    for (unsigned i = 0; i < KALLOC_CLASS_COUNT; i++) {
+        size_t per_page = (KALLOC_PAGE_SIZE - KALLOC_PAGE_HEADER) / class_sizes[i] * class_sizes[i];
+        capacity += allocator->classes[i].page_count * per_page;
+    }
+    return capacity;
+}
+
+KAllocPage* kalloc_begin_compaction(KAllocator* allocator, double max_live_ratio,
+                                    KAllocMovableFn movable, void* userdata) {
+    KAllocPage* evacuate = NULL;
+    flush_caches(allocator);
+
+    for (unsigned i = 0; i < KALLOC_CLASS_COUNT; i++) {
+        KAllocClass* klass = &allocator->classes[i];
+        klass->partial = NULL;
+
+        KAllocPage** cursor = &klass->pages;
+        while (*cursor) {
+            KAllocPage* page = *cursor;
+            char* base = (char*)page + KALLOC_PAGE_HEADER;
+            KAllocFreeCell* free_list = NULL;
+            uint32_t free_count = 0;
+            bool all_movable = true;
+
+            for (uint32_t j = page->cell_count; j-- > 0;) {
+                KAllocFreeCell* cell = (KAllocFreeCell*)(base + j * page->cell_size);
+                if (cell->tag != 0) {
+                    if (all_movable && !movable(cell, userdata)) all_movable = false;
+                    continue;
+                }
+                cell->next = free_list;
+                free_list = cell;
+                free_count++;
+            }
+            page->free_list = free_list;
+            page->free_count = free_count;
+
+            uint32_t live = page->cell_count - free_count;
+            if (all_movable && live > 0 && (double)live <= max_live_ratio * page->cell_count) {
+                *cursor = page->next;
+                klass->page_count--;
+                page->next = evacuate;
+                evacuate = page;
+                continue;
+            }
+            if (free_count > 0) {
+                page->next_partial = klass->partial;
+                klass->partial = page;
+            }
+            cursor = &page->next;
+        }
+    }
+    return evacuate;
+}
+
+size_t kalloc_release_pages(KAllocator* allocator, KAllocPage* pages) {
+    size_t count = 0;
+    while (pages) {
+        KAllocPage* next = pages->next;
+        release_page(allocator, pages);
+        pages = next;
+        count++;
+    }
+    return count;
+}
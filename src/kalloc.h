@@ -0,0 +1,263 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#ifndef KORELIN_KALLOC_H
+#define KORELIN_KALLOC_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// =============================================================================
+// Korelin 运行时对象分配器 (按尺寸分类的 slab 分配器)
+//
+//   - 小对象按尺寸类 (size class) 分配在 64 KB 对齐的页面中, 每个页面只存放
+//     同一尺寸的单元 (cell);
+//   - 空闲单元串成链表, 链表指针直接存放在空闲单元内部;
+//   - 每个线程有自己的分配缓存, 一次从页面取走整条空闲链表, 快路径无锁; 线程局部的
+//     缓存指针按分配器的编号 (而不是地址) 识别, 分配器释放后地址被新的分配器复用时不会
+//     误用已释放的缓存;
+//   - 超过 KALLOC_MAX_SMALL 的大对象单独用 mmap 分配;
+//   - 清扫时完全空闲的页面会归还给操作系统 (保留少量页面以备复用)。
+//
+// 约定: 已分配单元的第一个机器字必须非 0 (KGCObject 对象头满足该条件),
+//       第一个字为 0 的单元即为空闲单元。
+// =============================================================================
+
+#define KALLOC_PAGE_SIZE (64 * 1024)
+#define KALLOC_PAGE_HEADER 128          // 页面头部大小, 单元从该偏移开始
+#define KALLOC_MAX_SMALL 8192           // 小对象的最大尺寸
+#define KALLOC_CLASS_COUNT 32           // 小对象尺寸类数量
+#define KALLOC_LARGE_CLASS KALLOC_CLASS_COUNT   // 大对象使用的"尺寸类"编号
+#define KALLOC_EMPTY_POOL_MAX 16        // 保留以备复用的空页面数量上限
+
+// 页面 (小对象页面, 或单个大对象的映射区域)
+typedef struct KAllocPage {
+    struct KAllocPage* next;            // 同一尺寸类的所有页面 (大对象: 所有大对象)
+    struct KAllocPage* next_partial;    // 有空闲单元的页面链表
+    void* free_list;                    // 空闲单元链表
+    size_t cell_size;                   // 单元大小 (大对象: 对象的可用大小)
+    size_t mapped_size;                 // 映射的字节数
+    uint32_t cell_count;
+    uint32_t free_count;                // free_list 中的单元数
+    uint16_t size_class;
+} KAllocPage;
+
+// 一个尺寸类的所有页面
+typedef struct KAllocClass {
+    KAllocPage* pages;
+    KAllocPage* partial;                // 已清扫且有空闲单元的页面
+    KAllocPage** sweep_cursor;          // 惰性清扫位置, NULL 表示已清扫完
+    size_t page_count;
+} KAllocClass;
+
+typedef struct KAllocator KAllocator;
+
+// 单个尺寸类的使用情况
+typedef struct KAllocClassStats {
+    size_t cell_size;                   // 单元大小 (大对象为 0)
+    size_t pages;                       // 页面数 (大对象: 对象数)
+    size_t cells;                       // 单元总数
+    size_t cells_used;                  // 已分配的单元数 (含尚未清扫的死对象)
+    size_t bytes_used;                  // 已分配单元占用的字节数
+} KAllocClassStats;
+
+// 并行清扫的一段页面: 同一尺寸类中连续的若干个尚未清扫的页面 (见 kalloc_split_sweep)
+typedef struct KAllocSweepRange {
+    unsigned size_class;
+    KAllocPage** link;                  // 指向段的第一个页面的指针 (尺寸类中第一段才有, 其余为 NULL)
+    KAllocPage* first;
+    size_t count;
+    KAllocPage* kept;                   // 清扫后保留的页面, 保持原来的顺序
+    KAllocPage* kept_last;
+    KAllocPage* partial;                // 其中有空闲单元的页面
+    KAllocPage* partial_last;
+    size_t removed;                     // 归还的页面数
+} KAllocSweepRange;
+
+// 线程分配缓存
+typedef struct KAllocCache {
+    struct KAllocCache* next;           // 分配器的缓存链表
+    KAllocator* owner;
+    pthread_t thread;
+    void* free[KALLOC_CLASS_COUNT];
+} KAllocCache;
+
+// 清扫回调: 单元已死亡时负责终结并返回 true, 存活时返回 false
+typedef bool (*KAllocSweepFn)(void* cell, void* userdata);
+
+// 遍历回调
+typedef void (*KAllocCellFn)(void* cell, size_t cell_size, void* userdata);
+
+// 整理回调: 判断单元是否允许移动
+typedef bool (*KAllocMovableFn)(void* cell, void* userdata);
+
+struct KAllocator {
+    KAllocClass classes[KALLOC_CLASS_COUNT + 1];    // 最后一项存放大对象
+    uint64_t id;                        // 进程内唯一的编号 (分配器的地址在释放后可能被复用)
+    pthread_mutex_t lock;               // 保护页面链表与缓存注册 (多线程共享一个堆时)
+    pthread_mutex_t pool_lock;          // 保护空页面池与映射统计 (并行清扫时)
+    KAllocCache* caches;
+
+    KAllocPage* empty_pool;             // 保留的空页面
+    size_t empty_count;
+
+    size_t mapped_bytes;                // 当前从操作系统映射的字节数
+    size_t large_bytes;                 // 大对象的可用字节数
+    size_t pages_released;              // 累计归还给操作系统的页面数
+
+    size_t pending_freed;               // 分配路径上按需清扫释放的字节数, 由使用者取走并清零
+
+    bool sweeping;                      // 惰性清扫进行中
+    size_t sweep_class;                 // kalloc_sweep_some 的当前尺寸类
+    KAllocSweepFn sweep_fn;
+    void* sweep_userdata;
+};
+
+// --- 函数声明 ---
+
+/**
+ * @brief 初始化分配器。
+ * @param allocator 要初始化的分配器。
+ * @param sweep_fn 清扫时判断单元是否死亡的回调。
+ * @param userdata 传给回调的用户数据。
+ */
+void kalloc_init(KAllocator* allocator, KAllocSweepFn sweep_fn, void* userdata);
+
+/**
+ * @brief 释放分配器映射的全部内存 (不调用清扫回调)。
+ * @param allocator 分配器。
+ */
+void kalloc_destroy(KAllocator* allocator);
+
+/**
+ * @brief 分配一个单元。调用者必须立即写入非 0 的第一个机器字。
+ * @param allocator 分配器。
+ * @param size 需要的字节数。
+ * @param usable 输出实际占用的字节数 (单元大小), 可为 NULL。
+ * @return 16 字节对齐的内存。
+ */
+void* kalloc_alloc(KAllocator* allocator, size_t size, size_t* usable);
+
+/**
+ * @brief 返回尺寸对应的尺寸类, 大对象返回 KALLOC_LARGE_CLASS。
+ */
+unsigned kalloc_size_class(size_t size);
+
+/**
+ * @brief 返回尺寸类的单元大小。
+ */
+size_t kalloc_class_size(unsigned size_class);
+
+/**
+ * @brief 返回分配 size 字节时实际占用的字节数 (与 kalloc_alloc 输出的 usable 相同)。
+ */
+size_t kalloc_usable_size(size_t size);
+
+/**
+ * @brief 返回小对象所在的页面 (页面按 KALLOC_PAGE_SIZE 对齐)。
+ */
+static inline KAllocPage* kalloc_page_of(const void* cell) {
+    return (KAllocPage*)((uintptr_t)cell & ~(uintptr_t)(KALLOC_PAGE_SIZE - 1));
+}
+
+/**
+ * @brief 开始一轮清扫: 清空各线程缓存与空闲页面链表, 此后分配会按需清扫页面。
+ *        调用时其他线程不得在该分配器上分配。
+ * @param allocator 分配器。
+ */
+void kalloc_begin_sweep(KAllocator* allocator);
+
+/**
+ * @brief 按预算清扫一部分页面。
+ * @param allocator 分配器。
+ * @param budget 本次清扫的最大字节数 (按页面映射大小计)。
+ * @param freed 累加释放的字节数。
+ * @return 所有页面是否都已清扫完毕。
+ */
+bool kalloc_sweep_some(KAllocator* allocator, size_t budget, size_t* freed);
+
+/**
+ * @brief 把所有尚未清扫的页面按尺寸类切分为若干段, 用于并行清扫: 各段由 kalloc_sweep_range
+ *        在任意线程上清扫 (不同的段互不影响), 全部完成后由 kalloc_join_ranges 接回分配器。
+ *        期间不得在该分配器上分配或调用其他清扫函数。
+ * @param allocator 分配器, 处于清扫中。
+ * @param pages_per_range 每段的页面数 (大对象: 对象数)。
+ * @param count 输出段数。
+ * @return 段的数组, 由 kalloc_join_ranges 释放; 没有待清扫的页面时返回 NULL。
+ */
+KAllocSweepRange* kalloc_split_sweep(KAllocator* allocator, size_t pages_per_range, size_t* count);
+
+/**
+ * @brief 清扫一段页面。
+ * @return 释放的字节数。
+ */
+size_t kalloc_sweep_range(KAllocator* allocator, KAllocSweepRange* range);
+
+/**
+ * @brief 把清扫完的各段按原来的顺序接回分配器, 此后所有页面都已清扫。
+ * @param ranges kalloc_split_sweep 返回的数组, 随后被释放。
+ */
+void kalloc_join_ranges(KAllocator* allocator, KAllocSweepRange* ranges, size_t count);
+
+/**
+ * @brief 结束一轮清扫, 必须在所有页面都清扫完毕之后调用。
+ * @param allocator 分配器。
+ */
+void kalloc_end_sweep(KAllocator* allocator);
+
+/**
+ * @brief 遍历所有已分配的单元。
+ * @param allocator 分配器。
+ * @param fn 对每个已分配单元调用的回调。
+ * @param userdata 传给回调的用户数据。
+ */
+void kalloc_for_each(KAllocator* allocator, KAllocCellFn fn, void* userdata);
+
+/**
+ * @brief 遍历单个页面中所有已分配的单元。
+ * @param page 页面。
+ * @param fn 对每个已分配单元调用的回调。
+ * @param userdata 传给回调的用户数据。
+ */
+void kalloc_for_each_in_page(KAllocPage* page, KAllocCellFn fn, void* userdata);
+
+/**
+ * @brief 返回小对象页面的可用总容量 (字节)。
+ * @param allocator 分配器。
+ */
+size_t kalloc_small_capacity(KAllocator* allocator);
+
+/**
+ * @brief 统计一个尺寸类的使用情况 (需要扫描该尺寸类的所有页面)。
+ *        调用时其他线程不得在该分配器上分配。
+ * @param allocator 分配器。
+ * @param size_class 尺寸类, KALLOC_LARGE_CLASS 表示大对象。
+ * @param stats 输出统计结果。
+ */
+void kalloc_class_stats(KAllocator* allocator, unsigned size_class, KAllocClassStats* stats);
+
+/**
+ * @brief 开始整理: 清空线程缓存, 重建所有页面的空闲链表, 并把存活率不超过
+ *        max_live_ratio 且所有单元都可移动的页面从尺寸类中摘下作为疏散页。
+ *        此后的分配不会落在疏散页中。调用时其他线程不得在该分配器上分配。
+ * @param allocator 分配器。
+ * @param max_live_ratio 疏散页的最大存活率 (0 ~ 1)。
+ * @param movable 判断单元是否可移动的回调。
+ * @param userdata 传给回调的用户数据。
+ * @return 疏散页链表 (通过 next 串联), 没有可疏散的页面时返回 NULL。
+ */
+KAllocPage* kalloc_begin_compaction(KAllocator* allocator, double max_live_ratio,
+                                    KAllocMovableFn movable, void* userdata);
+
+/**
+ * @brief 释放疏散完毕的页面。
+ * @param allocator 分配器。
+ * @param pages kalloc_begin_compaction 返回的页面链表。
+ * @return 释放的页面数。
+ */
+size_t kalloc_release_pages(KAllocator* allocator, KAllocPage* pages);
+
+#endif //KORELIN_KALLOC_H
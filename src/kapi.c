@@ -2,4 +2,91 @@
 // Created by Helix on 2025/12/28.
 //
 
-#include "kapi.h"
\ No newline at end of file
+#include "kapi.h"
+#include "kvm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 程序拥有编译单元与它的常量
+struct KorelinProgram {
+    KModule* module;
+    KProgram* program;
+};
+
+KorelinVM* korelin_new(void) {
+    return kvm_new(NULL);
+}
+
+void korelin_free(KorelinVM* vm) {
+    kvm_free(vm);
+}
+
+KorelinProgram* korelin_compile(const char* source, const char* file_name) {
+    KModule* module = kric_compile(source, file_name);
+    if (!module) return NULL;
+    KorelinProgram* program = malloc(sizeof(KorelinProgram));
+    if (!program) {
+        fprintf(stderr, "Error: malloc failed in korelin_compile\n");
+        exit(EXIT_FAILURE);
+    }
+    program->module = module;
+    program->program = kvm_program_new(module);
+    return program;
+}
+
+void korelin_program_free(KorelinProgram* program) {
+    if (!program) return;
+    kvm_program_free(program->program);
+    kric_module_free(program->module);
+    free(program);
+}
+
+KorelinVM* korelin_isolate_new(const KorelinProgram* program) {
+    KorelinVM* vm = kvm_new(NULL);
+    kvm_bind(vm, program->program);
+    return vm;
+}
+
+bool korelin_run(KorelinVM* vm) {
+    return kvm_execute(vm);
+}
+
+bool korelin_call(KorelinVM* vm, const char* name, int argc, const KValue* argv, KValue* result) {
+    const KModule* module = vm->module;
+    for (size_t i = 0; module && i < module->global_count; i++) {
+        if (strcmp(module->globals[i], name) == 0) {
+            return kvm_call(vm, kvm_get_global(vm, i), argc, argv, result);
+        }
+    }
+    fprintf(stderr, "Error: undefined global '%s'\n", name);
+    return false;
+}
+
+void korelin_gc_collect(KorelinVM* vm) {
+    kgc_collect(vm->heap);
+}
+
+void korelin_gc_stats(KorelinVM* vm, KGCStats* stats, bool per_class) {
+    kgc_get_stats(vm->heap, stats, per_class);
+}
+
+void korelin_gc_set_sampling(KorelinVM* vm, size_t interval) {
+    kgc_set_sampling(vm->heap, interval);
+}
+
+size_t korelin_gc_alloc_sites(KorelinVM* vm, KGCAllocSite* sites, size_t max) {
+    return kgc_alloc_sites(vm->heap, sites, max);
+}
+
+bool korelin_gc_snapshot(KorelinVM* vm, const char* path) {
+    return kgc_write_snapshot(vm->heap, path);
+}
+
+pid_t korelin_gc_snapshot_async(KorelinVM* vm, const char* path) {
+    return kgc_write_snapshot_async(vm->heap, path);
+}
+
+bool korelin_gc_snapshot_wait(pid_t pid) {
+    return kgc_snapshot_wait(pid);
+}
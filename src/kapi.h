@@ -5,4 +5,127 @@
 #ifndef KORELIN_KAPI_H
 #define KORELIN_KAPI_H
 
-#endif //KORELIN_KAPI_H
\ No newline at end of file
+#include "kgc.h"
+#include "kobject.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// =============================================================================
+// Korelin 嵌入 API: 供宿主程序创建虚拟机并查询运行时状态
+//
+// 多线程的宿主可以把脚本编译一次 (korelin_compile), 再为每个工作线程创建一个隔离实例
+// (korelin_isolate_new)。隔离实例是拥有独立堆与回收器的虚拟机, 与其他实例共享只读的
+// 字节码、常量与驻留字符串, 创建时不复制也不重新加载代码, 开销与程序的大小无关。
+// 不同的隔离实例可以在不同的线程中同时执行, 同一个实例同时只能被一个线程使用。
+// =============================================================================
+
+typedef struct KorelinVM KorelinVM;
+
+// 编译好的程序, 可以被多个线程中的隔离实例同时使用
+typedef struct KorelinProgram KorelinProgram;
+
+/**
+ * @brief 使用默认配置创建一个虚拟机。
+ * @return 新的虚拟机, 需要调用 korelin_free 释放。
+ */
+KorelinVM* korelin_new(void);
+
+/**
+ * @brief 释放虚拟机。
+ * @param vm 虚拟机。
+ */
+void korelin_free(KorelinVM* vm);
+
+/**
+ * @brief 编译脚本, 实例化其中的常量并冻结为只读。
+ * @param source 源代码。
+ * @param file_name 源文件名, 用于错误信息。
+ * @return 编译好的程序, 有编译错误时向 stderr 输出并返回 NULL。需要调用 korelin_program_free 释放。
+ */
+KorelinProgram* korelin_compile(const char* source, const char* file_name);
+
+/**
+ * @brief 释放程序。在它上面创建的隔离实例必须先被释放。
+ * @param program 程序, 可以为 NULL。
+ */
+void korelin_program_free(KorelinProgram* program);
+
+/**
+ * @brief 在程序上创建一个隔离实例 (使用默认的回收器配置), 不执行任何代码。
+ * @param program 程序。
+ * @return 新的虚拟机, 需要调用 korelin_free 释放。
+ */
+KorelinVM* korelin_isolate_new(const KorelinProgram* program);
+
+/**
+ * @brief 执行隔离实例的程序的顶层代码 (定义函数与全局变量)。
+ * @param vm korelin_isolate_new 创建的虚拟机。
+ * @return 执行成功返回 true; 运行时错误会连同调用栈输出到 stderr 并返回 false。
+ */
+bool korelin_run(KorelinVM* vm);
+
+/**
+ * @brief 按名字调用全局函数 (脚本函数或原生函数)。
+ * @param vm 已经执行过 korelin_run 的虚拟机。
+ * @param name 全局变量名。
+ * @param argc 参数个数。
+ * @param argv 参数, 其中的对象必须属于 vm 的堆。
+ * @param result 写入返回值, 可以为 NULL。
+ * @return 成功返回 true; 没有这个全局变量或发生运行时错误时向 stderr 输出并返回 false。
+ */
+bool korelin_call(KorelinVM* vm, const char* name, int argc, const KValue* argv, KValue* result);
+
+/**
+ * @brief 执行一次完整的垃圾回收。
+ * @param vm 虚拟机。
+ */
+void korelin_gc_collect(KorelinVM* vm);
+
+/**
+ * @brief 获取 GC 与堆的统计信息。
+ * @param vm 虚拟机。
+ * @param stats 输出统计信息。
+ * @param per_class 是否统计各尺寸类的使用情况 (需要扫描整个堆)。
+ */
+void korelin_gc_stats(KorelinVM* vm, KGCStats* stats, bool per_class);
+
+/**
+ * @brief 开启或关闭分配点采样。
+ * @param vm 虚拟机。
+ * @param interval 平均采样间隔 (字节), 0 表示关闭。
+ */
+void korelin_gc_set_sampling(KorelinVM* vm, size_t interval);
+
+/**
+ * @brief 读取分配点采样结果, 按估算字节数从大到小排序。
+ * @param vm 虚拟机。
+ * @param sites 输出数组, 可为 NULL。
+ * @param max sites 的容量。
+ * @return 采样到的分配点总数。
+ */
+size_t korelin_gc_alloc_sites(KorelinVM* vm, KGCAllocSite* sites, size_t max);
+
+/**
+ * @brief 把堆快照写入文件 (写入期间停顿), 可用 kric heap 分析。
+ * @param vm 虚拟机。
+ * @param path 输出文件路径。
+ * @return 成功返回 true。
+ */
+bool korelin_gc_snapshot(KorelinVM* vm, const char* path);
+
+/**
+ * @brief 在子进程中写入堆快照, 本函数立即返回。
+ * @param vm 虚拟机。
+ * @param path 输出文件路径。
+ * @return 子进程 pid, 失败时返回 -1; 需要调用 korelin_gc_snapshot_wait。
+ */
+pid_t korelin_gc_snapshot_async(KorelinVM* vm, const char* path);
+
+/**
+ * @brief 等待后台快照写入结束。
+ * @param pid korelin_gc_snapshot_async 返回的 pid。
+ * @return 写入成功返回 true。
+ */
+bool korelin_gc_snapshot_wait(pid_t pid);
+
+#endif //KORELIN_KAPI_H
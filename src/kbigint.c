@@ -0,0 +1,913 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#include "kbigint.h"
+#include "knumber.h"
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+__extension__ typedef unsigned __int128 KUint128;
+
+#define DIGITS_PER_LIMB 19                      // 10^19 是不超过 2^64 的最大的 10 的幂
+#define LIMB_POW10 10000000000000000000ull
+#define DECIMAL_BASECASE 32                     // 十进制转换在这个 limb 数以下逐块进行
+#define MAX_POW_BITS (1ull << 36)               // 乘方结果的位数上限 (8 GiB)
+#define MAX_POW10_LEVELS 64
+
+// =============================================================================
+// limb 数组 (绝对值) 的运算
+// =============================================================================
+
+// 辅助函数：分配 count 个 limb
+static uint64_t* limbs_alloc(size_t count) {
+    uint64_t* limbs = malloc((count ? count : 1) * sizeof(uint64_t));
+    if (!limbs) {
+        fprintf(stderr, "Error: malloc failed in limbs_alloc\n");
+        exit(EXIT_FAILURE);
+    }
+    return limbs;
+}
+
+// 辅助函数：去掉高位的 0 limb 之后的长度
+static size_t mag_trim(const uint64_t* a, size_t n) {
+    while (n > 0 && a[n - 1] == 0) n--;
+    return n;
+}
+
+// 辅助函数：比较两个已去掉高位 0 的绝对值
+static int mag_cmp(const uint64_t* a, size_t an, const uint64_t* b, size_t bn) {
+    if (an != bn) return an > bn ? 1 : -1;
+    while (an-- > 0) {
+        if (a[an] != b[an]) return a[an] > b[an] ? 1 : -1;
+    }
+    return 0;
+}
+
+// r = a + b (各 n 个 limb), 返回进位。r 可以与 a 或 b 相同, 以下各函数同理
+static uint64_t mag_add_n(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t s = a[i] + carry;
+        carry = s < carry;
+        uint64_t t = s + b[i];
+        carry += t < s;
+        r[i] = t;
+    }
+    return carry;
+}
+
+// r = a + b (b 为单个 limb), 返回进位
+static uint64_t mag_add_1(uint64_t* r, const uint64_t* a, size_t n, uint64_t b) {
+    for (size_t i = 0; i < n; i++) {
+        uint64_t s = a[i] + b;
+        b = s < b;
+        r[i] = s;
+    }
+    return b;
+}
+
+// r = a + b, an >= bn, r 有 an 个 limb, 返回进位
+static uint64_t mag_add(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b, size_t bn) {
+    uint64_t carry = mag_add_n(r, a, b, bn);
+    return mag_add_1(r + bn, a + bn, an - bn, carry);
+}
+
+// r = a - b (各 n 个 limb), 返回借位
+static uint64_t mag_sub_n(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n) {
+    uint64_t borrow = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t x = a[i];
+        uint64_t d = x - b[i];
+        uint64_t next = x < b[i];
+        next += d < borrow;
+        r[i] = d - borrow;
+        borrow = next;
+    }
+    return borrow;
+}
+
+// r = a - b, an >= bn, r 有 an 个 limb, 返回借位
+static uint64_t mag_sub(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b, size_t bn) {
+    uint64_t borrow = mag_sub_n(r, a, b, bn);
+    for (size_t i = bn; i < an; i++) {
+        uint64_t x = a[i];
+        r[i] = x - borrow;
+        borrow = x < borrow;
+    }
+    return borrow;
+}
+
+// r = a * m, 返回最高的进位 limb
+static uint64_t mag_mul_1(uint64_t* r, const uint64_t* a, size_t n, uint64_t m) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n; i++) {
+        KUint128 p = (KUint128)a[i] * m + carry;
+        r[i] = (uint64_t)p;
+        carry = (uint64_t)(p >> 64);
+    }
+    return carry;
+}
+
+// r += a * m, 返回进位
+static uint64_t mag_addmul_1(uint64_t* r, const uint64_t* a, size_t n, uint64_t m) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < n; i++) {
+        KUint128 p = (KUint128)a[i] * m + r[i] + carry;
+        r[i] = (uint64_t)p;
+        carry = (uint64_t)(p >> 64);
+    }
+    return carry;
+}
+
+// r -= a * m, 返回借位
+static uint64_t mag_submul_1(uint64_t* r, const uint64_t* a, size_t n, uint64_t m) {
+    uint64_t borrow = 0;
+    for (size_t i = 0; i < n; i++) {
+        KUint128 p = (KUint128)a[i] * m + borrow;
+        uint64_t low = (uint64_t)p;
+        uint64_t high = (uint64_t)(p >> 64);
+        uint64_t x = r[i];
+        r[i] = x - low;
+        borrow = high + (x < low);
+    }
+    return borrow;
+}
+
+// 辅助函数：r = |x - y|, xn >= yn, r 有 xn 个 limb; 返回 x < y
+static bool mag_diff(uint64_t* r, const uint64_t* x, size_t xn, const uint64_t* y, size_t yn) {
+    if (mag_cmp(x, mag_trim(x, xn), y, mag_trim(y, yn)) >= 0) {
+        mag_sub(r, x, xn, y, yn);
+        return false;
+    }
+    // y 更大时 x 超出 yn 的 limb 都是 0
+    mag_sub_n(r, y, x, yn);
+    memset(r + yn, 0, (xn - yn) * sizeof(uint64_t));
+    return true;
+}
+
+// =============================================================================
+// 乘法
+// =============================================================================
+
+static void mul_n(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n);
+
+// 逐位乘法: r = a * b, r 有 an + bn 个 limb, an >= 1
+static void mul_basecase(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b, size_t bn) {
+    r[an] = mag_mul_1(r, a, an, b[0]);
+    for (size_t j = 1; j < bn; j++) {
+        r[an + j] = mag_addmul_1(r + j, a, an, b[j]);
+    }
+}
+
+// Karatsuba: a = a0 + a1·B^h, b = b0 + b1·B^h,
+// a·b = z0 + (z0 + z2 + (a0 - a1)(b1 - b0))·B^h + z2·B^2h, 其中 z0 = a0·b0, z2 = a1·b1
+static void karatsuba(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n) {
+    size_t h = (n + 1) / 2;
+    size_t l = n - h;
+    uint64_t* tmp = limbs_alloc(6 * h + 2);
+    uint64_t* da = tmp;
+    uint64_t* db = tmp + h;
+    uint64_t* d = tmp + 2 * h;
+    uint64_t* middle = tmp + 4 * h;
+
+    bool da_negative = mag_diff(da, a, h, a + h, l);           // 符号为 a0 - a1 的符号
+    bool db_negative = !mag_diff(db, b, h, b + h, l);          // b0 < b1 时 b1 - b0 为正
+    mul_n(r, a, b, h);
+    mul_n(r + 2 * h, a + h, b + h, l);
+    mul_n(d, da, db, h);
+
+    // middle = z0 + z2 ± d, 恒为非负
+    memcpy(middle, r, 2 * h * sizeof(uint64_t));
+    middle[2 * h] = mag_add(middle, middle, 2 * h, r + 2 * h, 2 * l);
+    if (da_negative != db_negative) {
+        mag_sub(middle, middle, 2 * h + 1, d, 2 * h);
+    } else {
+        middle[2 * h] += mag_add_n(middle, middle, d, 2 * h);
+    }
+    mag_add(r + h, r + h, 2 * n - h, middle, mag_trim(middle, 2 * h + 1));
+    free(tmp);
+}
+
+// Toom-3 求值与插值用的定宽有符号数
+typedef struct Signed {
+    uint64_t* limbs;
+    bool negative;
+} Signed;
+
+// 辅助函数：r = x ± y (定宽 width 个 limb, r 可以与 x 或 y 相同)
+static void signed_add(Signed* r, const Signed* x, const Signed* y, size_t width, bool subtract) {
+    bool y_negative = y->negative != subtract;
+    if (x->negative == y_negative) {
+        mag_add_n(r->limbs, x->limbs, y->limbs, width);
+        r->negative = x->negative;
+    } else if (mag_cmp(x->limbs, width, y->limbs, width) >= 0) {
+        mag_sub_n(r->limbs, x->limbs, y->limbs, width);
+        r->negative = x->negative;
+    } else {
+        mag_sub_n(r->limbs, y->limbs, x->limbs, width);
+        r->negative = y_negative;
+    }
+}
+
+// 辅助函数：绝对值右移一位 (整除 2)
+static void signed_half(Signed* x, size_t width) {
+    for (size_t i = 0; i < width; i++) {
+        x->limbs[i] = (x->limbs[i] >> 1) | (i + 1 < width ? x->limbs[i + 1] << 63 : 0);
+    }
+}
+
+// 辅助函数：绝对值整除 3 (已知能整除): 乘以 3 模 2^64 的逆元, 从低位到高位逐个 limb 求商
+static void signed_third(Signed* x, size_t width) {
+    const uint64_t inverse = 0xAAAAAAAAAAAAAAABull;
+    uint64_t borrow = 0;
+    for (size_t i = 0; i < width; i++) {
+        uint64_t s = x->limbs[i];
+        uint64_t next = s < borrow;
+        s -= borrow;
+        uint64_t q = s * inverse;
+        x->limbs[i] = q;
+        borrow = next + (uint64_t)(((KUint128)q * 3) >> 64);
+    }
+}
+
+// Toom-3: a = a0 + a1·x + a2·x², x = B^k, 在 0、1、-1、-2、∞ 处求值并相乘, 按 Bodrato 的
+// 顺序插值出乘积的 5 个系数
+static void toom3(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n) {
+    size_t k = (n + 2) / 3;
+    size_t top = n - 2 * k;             // a2 与 b2 的 limb 数, 1 <= top <= k
+    size_t w = k + 1;                   // 求值结果的宽度
+    size_t width = 2 * w;               // 乘积与插值的宽度
+    uint64_t* tmp = limbs_alloc(6 * w + 5 * width);
+    memset(tmp, 0, (6 * w + 5 * width) * sizeof(uint64_t));
+
+    Signed pa[3], pb[3];                // 在 1、-1、-2 处的值
+    for (int i = 0; i < 3; i++) {
+        pa[i] = (Signed){tmp + (size_t)i * w, false};
+        pb[i] = (Signed){tmp + (size_t)(3 + i) * w, false};
+    }
+    Signed r0 = {tmp + 6 * w, false};
+    Signed r1 = {tmp + 6 * w + width, false};
+    Signed rm1 = {tmp + 6 * w + 2 * width, false};
+    Signed rm2 = {tmp + 6 * w + 3 * width, false};
+    Signed rinf = {tmp + 6 * w + 4 * width, false};
+
+    for (int side = 0; side < 2; side++) {
+        const uint64_t* x = side == 0 ? a : b;
+        Signed* p = side == 0 ? pa : pb;
+        // t = x0 + x2 (暂存在 p[0]), p(1) = t + x1, p(-1) = t - x1, p(-2) = 2(p(-1) + x2) - x0
+        p[0].limbs[k] = mag_add(p[0].limbs, x, k, x + 2 * k, top);
+        Signed x0 = {p[2].limbs, false};
+        memcpy(x0.limbs, x + k, k * sizeof(uint64_t));
+        x0.limbs[k] = 0;
+        signed_add(&p[1], &p[0], &x0, w, true);
+        signed_add(&p[0], &p[0], &x0, w, false);
+        memset(x0.limbs, 0, w * sizeof(uint64_t));
+        memcpy(x0.limbs, x + 2 * k, top * sizeof(uint64_t));
+        signed_add(&p[2], &p[1], &x0, w, false);
+        mag_add_n(p[2].limbs, p[2].limbs, p[2].limbs, w);
+        Signed low = {rinf.limbs, false};   // rinf 此时还未使用, 借用为 x0 的定宽副本
+        memset(low.limbs, 0, w * sizeof(uint64_t));
+        memcpy(low.limbs, x, k * sizeof(uint64_t));
+        signed_add(&p[2], &p[2], &low, w, true);
+    }
+    memset(rinf.limbs, 0, width * sizeof(uint64_t));
+
+    mul_n(r0.limbs, a, b, k);
+    mul_n(rinf.limbs, a + 2 * k, b + 2 * k, top);
+    Signed* products[3] = {&r1, &rm1, &rm2};
+    for (int i = 0; i < 3; i++) {
+        mul_n(products[i]->limbs, pa[i].limbs, pb[i].limbs, w);
+        products[i]->negative = pa[i].negative != pb[i].negative;
+    }
+
+    // r3 = (r(-2) - r(1)) / 3, r1 = (r(1) - r(-1)) / 2, r2 = r(-1) - r(0),
+    // r3 = (r2 - r3) / 2 + 2·r(∞), r2 = r2 + r1 - r(∞), r1 = r1 - r3
+    Signed* c3 = &rm2;
+    signed_add(c3, &rm2, &r1, width, true);
+    signed_third(c3, width);
+    Signed* c1 = &r1;
+    signed_add(c1, &r1, &rm1, width, true);
+    signed_half(c1, width);
+    Signed* c2 = &rm1;
+    signed_add(c2, &rm1, &r0, width, true);
+    signed_add(c3, c2, c3, width, true);
+    signed_half(c3, width);
+    signed_add(c3, c3, &rinf, width, false);
+    signed_add(c3, c3, &rinf, width, false);
+    signed_add(c2, c2, c1, width, false);
+    signed_add(c2, c2, &rinf, width, true);
+    signed_add(c1, c1, c3, width, true);
+
+    // 按 x = B^k 合并系数
+    memset(r, 0, 2 * n * sizeof(uint64_t));
+    const Signed* coefficients[5] = {&r0, c1, c2, c3, &rinf};
+    for (size_t i = 0; i < 5; i++) {
+        size_t offset = i * k;
+        size_t length = mag_trim(coefficients[i]->limbs, width);
+        if (length > 2 * n - offset) length = 2 * n - offset;   // 超出部分一定为 0
+        mag_add(r + offset, r + offset, 2 * n - offset, coefficients[i]->limbs, length);
+    }
+    free(tmp);
+}
+
+// 等长乘法: r = a * b, 各 n 个 limb, r 有 2n 个 limb 且不与 a、b 重叠
+static void mul_n(uint64_t* r, const uint64_t* a, const uint64_t* b, size_t n) {
+    if (n < KBIGINT_KARATSUBA_THRESHOLD) {
+        mul_basecase(r, a, n, b, n);
+    } else if (n < KBIGINT_TOOM3_THRESHOLD) {
+        karatsuba(r, a, b, n);
+    } else {
+        toom3(r, a, b, n);
+    }
+}
+
+// 通用乘法: r = a * b, an >= bn >= 1, r 有 an + bn 个 limb 且不与 a、b 重叠。
+// 长度相差较大时把 a 切成 bn 个 limb 的段, 每段与 b 做等长乘法
+static void mag_mul(uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b, size_t bn) {
+    if (bn < KBIGINT_KARATSUBA_THRESHOLD) {
+        mul_basecase(r, a, an, b, bn);
+        return;
+    }
+    if (an == bn) {
+        mul_n(r, a, b, an);
+        return;
+    }
+    uint64_t* tmp = limbs_alloc(2 * bn);
+    memset(r, 0, (an + bn) * sizeof(uint64_t));
+    for (size_t offset = 0; offset < an; offset += bn) {
+        size_t length = an - offset < bn ? an - offset : bn;
+        if (length == bn) {
+            mul_n(tmp, a + offset, b, bn);
+        } else {
+            mag_mul(tmp, b, bn, a + offset, length);
+        }
+        mag_add(r + offset, r + offset, an + bn - offset, tmp, length + bn);
+    }
+    free(tmp);
+}
+
+// =============================================================================
+// 除法
+// =============================================================================
+
+// 辅助函数：规格化 (最高位为 1) 的除数 d 的倒数 floor((B² - 1) / d) - B
+static uint64_t reciprocal(uint64_t d) {
+    return (uint64_t)((((KUint128)~d) << 64 | ~(uint64_t)0) / d);
+}
+
+// 用倒数代替硬件除法的 2/1 除法 (Möller-Granlund): (u1·B + u0) / d, 要求 u1 < d
+static inline uint64_t div_2by1(uint64_t* remainder, uint64_t u1, uint64_t u0, uint64_t d, uint64_t v) {
+    KUint128 q = (KUint128)v * u1 + ((KUint128)u1 << 64 | u0);
+    uint64_t q1 = (uint64_t)(q >> 64) + 1;
+    uint64_t q0 = (uint64_t)q;
+    uint64_t r = u0 - q1 * d;
+    if (r > q0) {
+        q1--;
+        r += d;
+    }
+    if (r >= d) {
+        q1++;
+        r -= d;
+    }
+    *remainder = r;
+    return q1;
+}
+
+// q = a / d, 返回余数; q 有 n 个 limb, 可以与 a 相同
+static uint64_t mag_divmod_1(uint64_t* q, const uint64_t* a, size_t n, uint64_t d) {
+    int shift = __builtin_clzll(d);
+    uint64_t dn = d << shift;
+    uint64_t v = reciprocal(dn);
+    uint64_t r = 0;
+    if (n == 0) return 0;
+    if (shift == 0) {
+        for (size_t i = n; i-- > 0;) {
+            q[i] = div_2by1(&r, r, a[i], dn, v);
+        }
+        return r;
+    }
+    // 被除数同样左移 shift 位, 余数最后右移回来
+    r = a[n - 1] >> (64 - shift);
+    for (size_t i = n; i-- > 0;) {
+        uint64_t low = a[i] << shift | (i > 0 ? a[i - 1] >> (64 - shift) : 0);
+        q[i] = div_2by1(&r, r, low, dn, v);
+    }
+    return r >> shift;
+}
+
+// Knuth 算法 D: q = a / b (an - bn + 1 个 limb), r = a % b (bn 个 limb); an >= bn >= 2, b 的最高 limb 不为 0
+static void mag_divmod(uint64_t* q, uint64_t* r, const uint64_t* a, size_t an, const uint64_t* b, size_t bn) {
+    int shift = __builtin_clzll(b[bn - 1]);
+    uint64_t* u = limbs_alloc(an + 1 + bn);
+    uint64_t* d = u + an + 1;
+    // 把除数规格化为最高位为 1, 被除数同样左移
+    for (size_t i = bn; i-- > 0;) {
+        d[i] = b[i] << shift | (shift && i > 0 ? b[i - 1] >> (64 - shift) : 0);
+    }
+    u[an] = shift ? a[an - 1] >> (64 - shift) : 0;
+    for (size_t i = an; i-- > 0;) {
+        u[i] = a[i] << shift | (shift && i > 0 ? a[i - 1] >> (64 - shift) : 0);
+    }
+
+    uint64_t d1 = d[bn - 1];
+    uint64_t d0 = d[bn - 2];
+    uint64_t v = reciprocal(d1);
+    for (size_t j = an - bn + 1; j-- > 0;) {
+        uint64_t u2 = u[j + bn];
+        uint64_t u1 = u[j + bn - 1];
+        uint64_t u0 = u[j + bn - 2];
+        // 用最高的两个 limb 估计商, 再用次高 limb 修正, 估计值最多大 1
+        uint64_t qhat, rhat;
+        bool check = true;
+        if (u2 >= d1) {
+            qhat = ~(uint64_t)0;
+            rhat = u1 + d1;
+            check = rhat >= d1;     // rhat 溢出时不需要修正
+        } else {
+            qhat = div_2by1(&rhat, u2, u1, d1, v);
+        }
+        while (check && (KUint128)qhat * d0 > ((KUint128)rhat << 64 | u0)) {
+            qhat--;
+            rhat += d1;
+            check = rhat >= d1;
+        }
+        uint64_t borrow = mag_submul_1(u + j, d, bn, qhat);
+        uint64_t top = u[j + bn];
+        u[j + bn] = top - borrow;
+        if (top < borrow) {
+            qhat--;
+            u[j + bn] += mag_add_n(u + j, u + j, d, bn);
+        }
+        q[j] = qhat;
+    }
+
+    for (size_t i = 0; i < bn; i++) {
+        r[i] = u[i] >> shift | (shift && i + 1 < bn ? u[i + 1] << (64 - shift) : 0);
+    }
+    free(u);
+}
+
+// =============================================================================
+// 十进制转换
+// =============================================================================
+
+// 10 的幂表: 第 k 项为 10^(19·2^k), 由上一项平方得到
+typedef struct Pow10 {
+    uint64_t* limbs;
+    size_t length;
+    size_t digits;
+} Pow10;
+
+// 辅助函数：生成幂表, 直到某一项的位数不少于 digits; 返回项数
+static int pow10_build(Pow10* powers, size_t digits) {
+    int count = 1;
+    powers[0].limbs = limbs_alloc(1);
+    powers[0].limbs[0] = LIMB_POW10;
+    powers[0].length = 1;
+    powers[0].digits = DIGITS_PER_LIMB;
+    while (powers[count - 1].digits < digits && count < MAX_POW10_LEVELS) {
+        const Pow10* last = &powers[count - 1];
+        Pow10* next = &powers[count];
+        next->limbs = limbs_alloc(2 * last->length);
+        mag_mul(next->limbs, last->limbs, last->length, last->limbs, last->length);
+        next->length = mag_trim(next->limbs, 2 * last->length);
+        next->digits = 2 * last->digits;
+        count++;
+    }
+    return count;
+}
+
+static void pow10_free(Pow10* powers, int count) {
+    for (int i = 0; i < count; i++) free(powers[i].limbs);
+}
+
+// 辅助函数：写入 19 位以内的十进制数字 (高位补 0)
+static void write_chunk(char* out, size_t width, uint64_t chunk) {
+    for (size_t i = width; i-- > 0;) {
+        out[i] = (char)('0' + chunk % 10);
+        chunk /= 10;
+    }
+}
+
+// 把 a 写成恰好 width 位的十进制 (高位补 0), 要求 a < 10^width 且 a < powers[level]²。
+// 较大时除以 powers[level] 分成高低两半分别转换
+static void write_decimal(char* out, size_t width, const uint64_t* a, size_t n, const Pow10* powers, int level) {
+    n = mag_trim(a, n);
+    while (level >= 0 && mag_cmp(a, n, powers[level].limbs, powers[level].length) < 0) level--;
+    if (n <= DECIMAL_BASECASE || level < 0) {
+        // 逐块除以 10^19
+        uint64_t* tmp = limbs_alloc(n);
+        memcpy(tmp, a, n * sizeof(uint64_t));
+        size_t pos = width;
+        while (n > 0) {
+            uint64_t chunk = mag_divmod_1(tmp, tmp, n, LIMB_POW10);
+            n = mag_trim(tmp, n);
+            size_t length = pos < DIGITS_PER_LIMB ? pos : DIGITS_PER_LIMB;
+            write_chunk(out + pos - length, length, chunk);
+            pos -= length;
+        }
+        memset(out, '0', pos);
+        free(tmp);
+        return;
+    }
+
+    const Pow10* power = &powers[level];
+    size_t qn = n - power->length + 1;
+    uint64_t* q = limbs_alloc(qn + power->length);
+    uint64_t* r = q + qn;
+    if (power->length == 1) {
+        r[0] = mag_divmod_1(q, a, n, power->limbs[0]);
+    } else {
+        mag_divmod(q, r, a, n, power->limbs, power->length);
+    }
+    write_decimal(out, width - power->digits, q, qn, powers, level - 1);
+    write_decimal(out + width - power->digits, power->digits, r, power->length, powers, level - 1);
+    free(q);
+}
+
+// 辅助函数：按十进制数字串 (只含 '0'-'9') 计算值, out 至少有 length / 19 + 3 个 limb; 返回 limb 数。
+// 较长时分成高位与低位 (低位为 19·2^k 位) 两半, 结果为 高位 · 10^(19·2^k) + 低位
+static size_t read_decimal(uint64_t* out, const char* digits, size_t length, const Pow10* powers, int level) {
+    while (level >= 0 && powers[level].digits >= length) level--;
+    if (length <= DECIMAL_BASECASE * DIGITS_PER_LIMB || level < 0) {
+        size_t n = 0;
+        size_t first = length % DIGITS_PER_LIMB ? length % DIGITS_PER_LIMB : DIGITS_PER_LIMB;
+        for (size_t pos = 0; pos < length;) {
+            size_t chunk_length = pos == 0 ? first : DIGITS_PER_LIMB;
+            uint64_t chunk = 0;
+            uint64_t scale = 1;
+            for (size_t i = 0; i < chunk_length; i++) {
+                chunk = chunk * 10 + (uint64_t)(digits[pos + i] - '0');
+                scale *= 10;
+            }
+            pos += chunk_length;
+            uint64_t carry = mag_mul_1(out, out, n, scale);
+            if (carry) out[n++] = carry;
+            carry = mag_add_1(out, out, n, chunk);
+            if (carry) out[n++] = carry;
+        }
+        return n;
+    }
+
+    const Pow10* power = &powers[level];
+    size_t high_length = length - power->digits;
+    uint64_t* high = limbs_alloc(high_length / DIGITS_PER_LIMB + 3 + power->digits / DIGITS_PER_LIMB + 3);
+    uint64_t* low = high + high_length / DIGITS_PER_LIMB + 3;
+    size_t hn = read_decimal(high, digits, high_length, powers, level - 1);
+    size_t ln = read_decimal(low, digits + high_length, power->digits, powers, level - 1);
+    size_t n = ln;
+    if (hn == 0) {
+        memcpy(out, low, ln * sizeof(uint64_t));
+    } else {
+        if (hn >= power->length) {
+            mag_mul(out, high, hn, power->limbs, power->length);
+        } else {
+            mag_mul(out, power->limbs, power->length, high, hn);
+        }
+        n = hn + power->length;
+        mag_add(out, out, n, low, ln);
+    }
+    free(high);
+    return mag_trim(out, n);
+}
+
+// =============================================================================
+// 大整数对象
+// =============================================================================
+
+// 整数值的绝对值与符号, int 也以单个 limb 的形式参与运算
+typedef struct BigView {
+    const uint64_t* limbs;
+    size_t length;
+    bool negative;
+    uint64_t small;
+} BigView;
+
+static void view_of(KValue value, BigView* view) {
+    if (value.type == KVAL_INT) {
+        long long x = value.as.integer;
+        view->negative = x < 0;
+        view->small = x < 0 ? 0 - (uint64_t)x : (uint64_t)x;
+        view->limbs = &view->small;
+        view->length = view->small != 0;
+        return;
+    }
+    const KBigInt* big = (const KBigInt*)value.as.object;
+    view->limbs = big->limbs;
+    view->length = big->length;
+    view->negative = big->negative;
+}
+
+// 辅助函数：由绝对值与符号创建整数值, 在 64 位范围内时为 int。
+// 接管 malloc 分配的 limbs (成为大整数的缓冲区, 或者被释放)
+static KValue take_value(KGCHeap* heap, uint64_t* limbs, size_t n, bool negative) {
+    n = mag_trim(limbs, n);
+    KValue result = KVALUE_NULL;
+    if (n == 0) {
+        result = KVALUE_INT(0);
+    } else if (n == 1 && limbs[0] <= (uint64_t)LLONG_MAX) {
+        result = KVALUE_INT(negative ? -(long long)limbs[0] : (long long)limbs[0]);
+    } else if (n == 1 && negative && limbs[0] == (uint64_t)LLONG_MAX + 1) {
+        result = KVALUE_INT(LLONG_MIN);
+    }
+    if (result.type == KVAL_INT) {
+        free(limbs);
+        return result;
+    }
+    KBigInt* big = (KBigInt*)kgc_alloc(heap, KOBJ_BIGINT, sizeof(KBigInt));
+    big->length = n;
+    big->negative = negative;
+    big->limbs = limbs;
+    kgc_account_external(heap, (ptrdiff_t)(n * sizeof(uint64_t)));
+    return KVALUE_OBJECT(big);
+}
+
+// 辅助函数：同上, 复制 limbs 的内容
+static KValue make_value(KGCHeap* heap, const uint64_t* limbs, size_t n, bool negative) {
+    n = mag_trim(limbs, n);
+    uint64_t* copy = limbs_alloc(n);
+    memcpy(copy, limbs, n * sizeof(uint64_t));
+    return take_value(heap, copy, n, negative);
+}
+
+KValue kbigint_from_limbs(KGCHeap* heap, const uint64_t* limbs, size_t length, bool negative) {
+    return make_value(heap, limbs, length, negative);
+}
+
+KValue kbigint_from_bytes(KGCHeap* heap, const void* bytes, size_t length, bool negative) {
+    uint64_t* limbs = limbs_alloc(length);
+    if (length) memcpy(limbs, bytes, length * sizeof(uint64_t));
+    return take_value(heap, limbs, length, negative);
+}
+
+// 辅助函数：a + b 或 a - b
+static KValue add_values(KGCHeap* heap, KValue a, KValue b, bool subtract) {
+    BigView x, y;
+    view_of(a, &x);
+    view_of(b, &y);
+    bool x_negative = x.negative;
+    bool y_negative = y.negative != subtract;
+    const BigView* big = &x;
+    const BigView* small = &y;
+    bool big_negative = x_negative;
+    if (mag_cmp(x.limbs, x.length, y.limbs, y.length) < 0) {
+        big = &y;
+        small = &x;
+        big_negative = y_negative;
+    }
+    uint64_t* r = limbs_alloc(big->length + 1);
+    if (x_negative == y_negative) {
+        r[big->length] = mag_add(r, big->limbs, big->length, small->limbs, small->length);
+    } else {
+        mag_sub(r, big->limbs, big->length, small->limbs, small->length);
+        r[big->length] = 0;
+    }
+    return take_value(heap, r, big->length + 1, big_negative);
+}
+
+KValue kbigint_add(KGCHeap* heap, KValue a, KValue b) {
+    return add_values(heap, a, b, false);
+}
+
+KValue kbigint_sub(KGCHeap* heap, KValue a, KValue b) {
+    return add_values(heap, a, b, true);
+}
+
+KValue kbigint_mul(KGCHeap* heap, KValue a, KValue b) {
+    BigView x, y;
+    view_of(a, &x);
+    view_of(b, &y);
+    if (x.length == 0 || y.length == 0) return KVALUE_INT(0);
+    uint64_t* r = limbs_alloc(x.length + y.length);
+    if (x.length >= y.length) {
+        mag_mul(r, x.limbs, x.length, y.limbs, y.length);
+    } else {
+        mag_mul(r, y.limbs, y.length, x.limbs, x.length);
+    }
+    return take_value(heap, r, x.length + y.length, x.negative != y.negative);
+}
+
+bool kbigint_divmod(KGCHeap* heap, KValue a, KValue b, KValue* quotient, KValue* remainder) {
+    BigView x, y;
+    view_of(a, &x);
+    view_of(b, &y);
+    if (y.length == 0) return false;
+    if (mag_cmp(x.limbs, x.length, y.limbs, y.length) < 0) {
+        if (quotient) *quotient = KVALUE_INT(0);
+        if (remainder) *remainder = a;
+        return true;
+    }
+
+    size_t qn = x.length - y.length + 1;
+    uint64_t* q = limbs_alloc(qn);
+    uint64_t* r = limbs_alloc(y.length);
+    if (y.length == 1) {
+        r[0] = mag_divmod_1(q, x.limbs, x.length, y.limbs[0]);
+    } else {
+        mag_divmod(q, r, x.limbs, x.length, y.limbs, y.length);
+    }
+    KValue q_value = KVALUE_INT(0);
+    if (quotient) {
+        q_value = take_value(heap, q, qn, x.negative != y.negative);
+    } else {
+        free(q);
+    }
+    if (remainder) {
+        // 创建余数时商必须可达
+        bool rooted = q_value.type == KVAL_OBJECT;
+        if (rooted) kgc_push_root(heap, q_value.as.object);
+        *remainder = take_value(heap, r, y.length, x.negative);
+        if (rooted) kgc_pop_roots(heap, 1);
+    } else {
+        free(r);
+    }
+    if (quotient) *quotient = q_value;
+    return true;
+}
+
+KValue kbigint_neg(KGCHeap* heap, KValue a) {
+    BigView x;
+    view_of(a, &x);
+    return make_value(heap, x.limbs, x.length, !x.negative);
+}
+
+const char* kbigint_pow(KGCHeap* heap, KValue base, long long exponent, KValue* out) {
+    BigView x;
+    view_of(base, &x);
+    bool negative = x.negative && (exponent & 1);
+    if (exponent == 0) {
+        *out = KVALUE_INT(1);
+        return NULL;
+    }
+    if (x.length == 0 || (x.length == 1 && x.limbs[0] == 1)) {
+        *out = x.length == 0 ? KVALUE_INT(0) : KVALUE_INT(negative ? -1 : 1);
+        return NULL;
+    }
+
+    uint64_t top = x.limbs[x.length - 1];
+    uint64_t bits = (uint64_t)x.length * 64 - (uint64_t)__builtin_clzll(top);
+    if ((uint64_t)exponent > MAX_POW_BITS / (bits - 1)) return "result of '^' is too large";
+
+    // 2 的幂只需要移位
+    if (x.length == 1 && (top & (top - 1)) == 0) {
+        uint64_t shift = (uint64_t)__builtin_ctzll(top) * (uint64_t)exponent;
+        size_t n = (size_t)(shift / 64) + 1;
+        uint64_t* r = limbs_alloc(n);
+        memset(r, 0, n * sizeof(uint64_t));
+        r[n - 1] = 1ull << (shift % 64);
+        *out = take_value(heap, r, n, negative);
+        return NULL;
+    }
+
+    // 从高位到低位的平方-乘算法
+    size_t capacity = (size_t)(bits * (uint64_t)exponent / 64) + 2;
+    uint64_t* result = limbs_alloc(capacity);
+    uint64_t* tmp = limbs_alloc(capacity);
+    memcpy(result, x.limbs, x.length * sizeof(uint64_t));
+    size_t n = x.length;
+    for (int bit = 62 - __builtin_clzll((unsigned long long)exponent); bit >= 0; bit--) {
+        mag_mul(tmp, result, n, result, n);
+        n = mag_trim(tmp, 2 * n);
+        uint64_t* swap = result;
+        result = tmp;
+        tmp = swap;
+        if ((exponent >> bit) & 1) {
+            mag_mul(tmp, result, n, x.limbs, x.length);
+            n = mag_trim(tmp, n + x.length);
+            swap = result;
+            result = tmp;
+            tmp = swap;
+        }
+    }
+    *out = take_value(heap, result, n, negative);
+    free(tmp);
+    return NULL;
+}
+
+int kbigint_compare(KValue a, KValue b) {
+    BigView x, y;
+    view_of(a, &x);
+    view_of(b, &y);
+    if (x.negative != y.negative) return x.negative ? -1 : 1;
+    int order = mag_cmp(x.limbs, x.length, y.limbs, y.length);
+    return x.negative ? -order : order;
+}
+
+double kbigint_to_double(const KBigInt* value) {
+    // 取最高的 64 位, 其余位是否非 0 记在最低位上, 转换时按就近舍入
+    size_t n = value->length;
+    int shift = __builtin_clzll(value->limbs[n - 1]);
+    uint64_t high = value->limbs[n - 1] << shift;
+    if (shift && n > 1) high |= value->limbs[n - 2] >> (64 - shift);
+    bool sticky = n > 1 && (value->limbs[n - 2] << shift) != 0;
+    for (size_t i = 0; !sticky && i + 2 < n; i++) sticky = value->limbs[i] != 0;
+    double result = ldexp((double)(high | sticky), (int)(n * 64) - shift - 64);
+    return value->negative ? -result : result;
+}
+
+char* kbigint_to_chars(const KBigInt* value, size_t* length) {
+    size_t bits = value->length * 64 - (size_t)__builtin_clzll(value->limbs[value->length - 1]);
+    size_t digits = bits / 3 + 1;       // 不少于十进制位数 (log10(2) < 1/3)
+    Pow10 powers[MAX_POW10_LEVELS];
+    int count = pow10_build(powers, digits);
+    size_t width = powers[count - 1].digits > digits ? powers[count - 1].digits : digits;
+
+    char* buffer = malloc(width + 2);
+    if (!buffer) {
+        fprintf(stderr, "Error: malloc failed in kbigint_to_chars\n");
+        exit(EXIT_FAILURE);
+    }
+    write_decimal(buffer + 1, width, value->limbs, value->length, powers, count - 2);
+    pow10_free(powers, count);
+
+    // 去掉高位补的 0 (值不为 0, 至少剩一位)
+    size_t start = 1;
+    while (buffer[start] == '0') start++;
+    if (value->negative) buffer[--start] = '-';
+    size_t size = width + 1 - start;
+    memmove(buffer, buffer + start, size);
+    buffer[size] = '\0';
+    if (length) *length = size;
+    return buffer;
+}
+
+KValue kbigint_parse(KGCHeap* heap, const char* text, size_t length) {
+    long long integer;
+    double number;
+    KNumberKind kind = knumber_parse(text, length, &integer, &number);
+    if (kind == KNUMBER_INT) return KVALUE_INT(integer);
+    if (kind != KNUMBER_OVERFLOW) return KVALUE_NULL;
+
+    // 字面量已确认合法, 只需去掉符号、前缀与 '_'
+    bool negative = text[0] == '-';
+    if (text[0] == '-' || text[0] == '+') {
+        text++;
+        length--;
+    }
+    int radix_bits = 0;
+    if (length > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) radix_bits = 4;
+    if (length > 2 && text[0] == '0' && (text[1] == 'b' || text[1] == 'B')) radix_bits = 1;
+    if (radix_bits) {
+        text += 2;
+        length -= 2;
+    }
+    char* digits = malloc(length + 1);
+    if (!digits) {
+        fprintf(stderr, "Error: malloc failed in kbigint_parse\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t count = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] != '_') digits[count++] = text[i];
+    }
+
+    size_t capacity = radix_bits ? count * (size_t)radix_bits / 64 + 1 : count / DIGITS_PER_LIMB + 3;
+    uint64_t* limbs = limbs_alloc(capacity);
+    size_t n;
+    if (radix_bits) {
+        // 十六进制与二进制直接按位拼装
+        memset(limbs, 0, capacity * sizeof(uint64_t));
+        size_t bit = 0;
+        for (size_t i = count; i-- > 0; bit += (size_t)radix_bits) {
+            char c = digits[i];
+            uint64_t digit = c <= '9' ? (uint64_t)(c - '0') : (uint64_t)((c | 0x20) - 'a' + 10);
+            limbs[bit / 64] |= digit << (bit % 64);
+        }
+        n = capacity;
+    } else {
+        Pow10 powers[MAX_POW10_LEVELS];
+        int levels = pow10_build(powers, count);
+        n = read_decimal(limbs, digits, count, powers, levels - 1);
+        pow10_free(powers, levels);
+    }
+    free(digits);
+    return take_value(heap, limbs, n, negative);
+}
+
+// =============================================================================
+// 类型注册
+// =============================================================================
+
+static size_t bigint_external_size(const KGCObject* obj) {
+    return ((const KBigInt*)obj)->length * sizeof(uint64_t);
+}
+
+static void bigint_finalize(KGCHeap* heap, KGCObject* obj) {
+    kgc_account_external(heap, -(ptrdiff_t)bigint_external_size(obj));
+    free(((KBigInt*)obj)->limbs);
+}
+
+static const KGCTypeInfo bigint_type = {
+    .name = "bigint",
+    .trace = NULL,
+    .finalize = bigint_finalize,
+    .external_size = bigint_external_size,
+};
+
+void kbigint_init_types(void) {
+    kgc_register_type(KOBJ_BIGINT, &bigint_type);
+}
@@ -0,0 +1,115 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#ifndef KORELIN_KBIGINT_H
+#define KORELIN_KBIGINT_H
+
+#include "kobject.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// =============================================================================
+// 任意精度整数
+//
+// 脚本中只有一种整数: 能放进 64 位的值始终是 KVAL_INT, 运算溢出时 (用
+// __builtin_*_overflow 检查) 结果提升为 KBigInt; 大整数运算的结果重新落回 64 位
+// 范围时也还原为 KVAL_INT。因此 KBigInt 的值一定超出 long long 的范围, 同一个数值
+// 只有一种表示。
+//
+// 绝对值以 64 位 limb 的小端序数组存放。乘法按规模选择算法: 较小时为逐位乘法,
+// 超过 KBIGINT_KARATSUBA_THRESHOLD 个 limb 时为 Karatsuba, 超过
+// KBIGINT_TOOM3_THRESHOLD 时为 Toom-3 (取值点 0、1、-1、-2、∞)。除法为 Knuth
+// 算法 D, 除数只有一个 limb 时用预先计算的倒数代替硬件除法。十进制转换按
+// 10^(19·2^k) 分治, 输出与解析都不是逐位的平方复杂度。
+//
+// 除法与取余与 int 相同, 向零截断 (余数与被除数同号)。
+// =============================================================================
+
+#define KBIGINT_KARATSUBA_THRESHOLD 32
+#define KBIGINT_TOOM3_THRESHOLD 160
+
+// 大整数对象 (不可变)
+typedef struct KBigInt {
+    KGCObject obj;
+    size_t length;          // limb 个数, 最高的 limb 不为 0
+    bool negative;
+    uint64_t* limbs;        // 绝对值, 小端序; 单独分配, 运算结果的缓冲区直接交给对象, 不再复制
+} KBigInt;
+
+// --- 函数声明 ---
+
+/**
+ * @brief 注册大整数对象类型, 由 kobject_init_types 调用。
+ */
+void kbigint_init_types(void);
+
+/**
+ * @brief 判断值是否为整数 (int 或大整数)。
+ */
+static inline bool kvalue_is_integer(KValue value) {
+    return value.type == KVAL_INT || kvalue_is_object_type(value, KOBJ_BIGINT);
+}
+
+/**
+ * @brief 解析整数字面量: 可以带正负号, 十进制、0x 十六进制或 0b 二进制, 数字之间可以有 '_'。
+ * @return 值在 64 位范围内时为 int, 否则为大整数; 不合法时返回 null。
+ */
+KValue kbigint_parse(KGCHeap* heap, const char* text, size_t length);
+
+/**
+ * @brief 由绝对值 (小端序的 limb) 与符号创建整数, 复制 limbs 的内容。
+ * @return 值在 64 位范围内时为 int, 否则为大整数。
+ */
+KValue kbigint_from_limbs(KGCHeap* heap, const uint64_t* limbs, size_t length, bool negative);
+
+/**
+ * @brief 同 kbigint_from_limbs, limbs 以原生字节序存放在 bytes 中, 不要求对齐 (如消息或文件中的数据)。
+ */
+KValue kbigint_from_bytes(KGCHeap* heap, const void* bytes, size_t length, bool negative);
+
+/**
+ * @brief 整数的加、减、乘。a 与 b 是 int 或大整数, 计算期间必须可达 (如位于虚拟机栈上)。
+ */
+KValue kbigint_add(KGCHeap* heap, KValue a, KValue b);
+KValue kbigint_sub(KGCHeap* heap, KValue a, KValue b);
+KValue kbigint_mul(KGCHeap* heap, KValue a, KValue b);
+
+/**
+ * @brief 整数除法, 商向零截断。
+ * @param quotient 写入商, 可以为 NULL。
+ * @param remainder 写入余数 (与 a 同号), 可以为 NULL。
+ * @return 除数为 0 时返回 false。
+ */
+bool kbigint_divmod(KGCHeap* heap, KValue a, KValue b, KValue* quotient, KValue* remainder);
+
+/**
+ * @brief 取相反数。
+ */
+KValue kbigint_neg(KGCHeap* heap, KValue a);
+
+/**
+ * @brief 整数的乘方, exponent 必须非负。
+ * @return 出错时返回错误信息 (指数或结果过大), 否则返回 NULL 并写入 out。
+ */
+const char* kbigint_pow(KGCHeap* heap, KValue base, long long exponent, KValue* out);
+
+/**
+ * @brief 比较两个整数, 返回 -1、0 或 1。
+ */
+int kbigint_compare(KValue a, KValue b);
+
+/**
+ * @brief 转换为最接近的 double (超出范围时为 ±inf)。
+ */
+double kbigint_to_double(const KBigInt* value);
+
+/**
+ * @brief 十进制形式 (负数带 '-')。
+ * @param length 写入字符数, 可以为 NULL。
+ * @return malloc 分配、以 '\0' 结尾的字符串, 由调用者释放。
+ */
+char* kbigint_to_chars(const KBigInt* value, size_t* length);
+
+#endif //KORELIN_KBIGINT_H
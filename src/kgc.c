@@ -2,4 +2,1584 @@
 // Created by Helix on 2025/12/28.
 //
 
-#include "kgc.h"
\ No newline at end of file
+#define _POSIX_C_SOURCE 200809L
+
+#include "kgc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// 已注册的对象类型
+static const KGCTypeInfo* kgc_types[KGC_MAX_TYPES];
+
+// 每隔多少个对象检查一次时间预算 (读时钟本身也有开销)
+#define KGC_TIME_CHECK_INTERVAL 64
+
+// 每个扫描的引用槽计入的工作量 (字节, 与一个值槽的大小相当)
+#define KGC_SLOT_WORK 16
+
+// 增量回收的原子阶段中, 剩余灰色对象达到该数量时才值得唤醒工作线程
+#define KGC_PARALLEL_MIN_GRAY 4096
+
+// 惰性清扫每次推进的页面字节数
+#define KGC_SWEEP_SLICE KALLOC_PAGE_SIZE
+
+// 并行清扫时每段的页面数 (1 MB 的小对象页面), 单一尺寸类占满堆时也能分给所有工作线程
+#define KGC_SWEEP_RANGE_PAGES 16
+
+// 共享区向系统申请的块大小: 第一块至少 KGC_REGION_FIRST_CHUNK 字节, 之后随共享区的大小
+// 翻倍, 直到 KGC_REGION_CHUNK; 超过它四分之一的分配单独成块
+#define KGC_REGION_FIRST_CHUNK 1024
+#define KGC_REGION_CHUNK (64 * 1024)
+
+// 共享区的内存块
+typedef struct KGCRegionChunk {
+    struct KGCRegionChunk* next;
+    size_t size;
+    _Alignas(16) char data[];
+} KGCRegionChunk;
+
+struct KGCRegion {
+    int refs;
+    size_t bytes;               // 所有块的总字节数
+    KGCRegionChunk* chunks;
+    char* cursor;               // 当前块中下一个可分配的位置
+    char* limit;
+};
+
+// 共享区中每个对象之前的 16 字节, 记录所属的共享区
+typedef struct KGCRegionPrefix {
+    KGCRegion* region;
+    uint64_t reserved;
+} KGCRegionPrefix;
+
+// 堆引用的共享区
+struct KGCHeld {
+    KGCRegion* region;          // NULL 表示空槽
+    uint32_t epoch;             // 最近一次被标记到的回收轮次
+    size_t bytes;               // 登记时计入外部内存的字节数
+};
+
+// 分配点采样结果表中的一项 (site 与 type 共同作为键)
+struct KGCSiteEntry {
+    const char* site;
+    uint16_t type;
+    bool used;
+    uint64_t samples;
+    uint64_t bytes;
+};
+
+// =============================================================================
+// 辅助函数
+// =============================================================================
+
+// 辅助函数：获取单调时钟 (纳秒)
+static uint64_t kgc_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// 辅助函数：另一种白色, 清扫时该颜色的对象即为死对象
+static uint8_t other_white(const KGCHeap* heap) {
+    return (uint8_t)(heap->current_white ^ 1);
+}
+
+static bool is_white(const KGCObject* obj) {
+    return obj->color <= KGC_WHITE1;
+}
+
+// 辅助函数：把对象压入灰色栈
+static void push_gray(KGCHeap* heap, KGCObject* obj) {
+    if (heap->gray_count == heap->gray_capacity) {
+        size_t new_capacity = heap->gray_capacity ? heap->gray_capacity * 2 : 256;
+        KGCObject** new_gray = realloc(heap->gray, new_capacity * sizeof(KGCObject*));
+        if (!new_gray) {
+            fprintf(stderr, "Error: realloc failed in push_gray\n");
+            exit(EXIT_FAILURE);
+        }
+        heap->gray = new_gray;
+        heap->gray_capacity = new_capacity;
+    }
+    obj->color = KGC_GRAY;
+    heap->gray[heap->gray_count++] = obj;
+}
+
+// 辅助函数：共享区在表中的起始槽位
+static size_t held_start(const KGCRegion* region, size_t mask) {
+    return (size_t)(((uintptr_t)region >> 4) * 0x9E3779B97F4A7C15ull >> 32) & mask;
+}
+
+// 辅助函数：在堆引用的共享区表中查找, 不存在时返回 NULL
+static KGCHeld* find_held(const KGCHeap* heap, const KGCRegion* region) {
+    if (heap->held_capacity == 0) return NULL;
+    size_t mask = heap->held_capacity - 1;
+    size_t index = held_start(region, mask);
+    for (;;) {
+        KGCHeld* held = &heap->held[index];
+        if (held->region == region) return held;
+        if (!held->region) return NULL;
+        index = (index + 1) & mask;
+    }
+}
+
+// 辅助函数：容纳 count 项 (负载不超过 1/2) 的容量
+static size_t held_capacity_for(size_t count) {
+    size_t capacity = 16;
+    while (capacity < count * 2) capacity *= 2;
+    return capacity;
+}
+
+// 辅助函数：插入一项 (表中没有该共享区, 且容量足够)
+static void held_insert(KGCHeap* heap, KGCHeld entry) {
+    size_t mask = heap->held_capacity - 1;
+    size_t index = held_start(entry.region, mask);
+    while (heap->held[index].region) index = (index + 1) & mask;
+    heap->held[index] = entry;
+    heap->held_count++;
+}
+
+// 辅助函数：扩容并重新插入所有项
+static void held_resize(KGCHeap* heap, size_t capacity) {
+    KGCHeld* old = heap->held;
+    size_t old_capacity = heap->held_capacity;
+    heap->held = calloc(capacity, sizeof(KGCHeld));
+    if (!heap->held) {
+        fprintf(stderr, "Error: calloc failed in held_resize\n");
+        exit(EXIT_FAILURE);
+    }
+    heap->held_capacity = capacity;
+    heap->held_count = 0;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old[i].region) held_insert(heap, old[i]);
+    }
+    free(old);
+}
+
+// 辅助函数：记录本轮标记到了共享区中的对象 (并行标记时多个线程可能同时写入同一项)
+static void reach_region(KGCHeap* heap, const KGCObject* obj) {
+    KGCHeld* held = find_held(heap, kgc_region_of(obj));
+    if (held) __atomic_store_n(&held->epoch, heap->held_epoch, __ATOMIC_RELAXED);
+}
+
+// 辅助函数：标记一个对象 (白 -> 灰; 没有引用的对象直接变黑)
+static void mark_object(KGCHeap* heap, KGCObject* obj) {
+    if (!obj) return;
+    if (!is_white(obj)) {
+        if (obj->flags & KGC_FLAG_COUNTED) reach_region(heap, obj);
+        return;
+    }
+    const KGCTypeInfo* info = kgc_types[obj->type];
+    if (info && info->trace) {
+        push_gray(heap, obj);
+    } else {
+        obj->color = KGC_BLACK;
+        heap->bytes_marked += kalloc_usable_size(obj->size);
+    }
+}
+
+// 辅助函数：对象是否分段扫描 (引用槽数超过 KGC_SCAN_CHUNK)
+static bool is_large(const KGCObject* obj) {
+    const KGCTypeInfo* info = kgc_types[obj->type];
+    return info->slot_count && info->slot_count(obj) > KGC_SCAN_CHUNK;
+}
+
+// 辅助函数：终结单个对象 (内存由 kalloc 在清扫页面时回收)
+static void finalize_object(KGCHeap* heap, KGCObject* obj) {
+    const KGCTypeInfo* info = kgc_types[obj->type];
+    if (info && info->finalize) {
+        info->finalize(heap, obj);
+    }
+}
+
+// =============================================================================
+// 并行标记: Chase-Lev 工作窃取队列
+// =============================================================================
+
+// 队列缓冲区 (容量为 2 的幂)
+typedef struct KGCDequeBuffer {
+    size_t capacity;
+    struct KGCDequeBuffer* retired;     // 扩容时被替换的旧缓冲区, 窃取者可能仍在读取, 本轮结束后释放
+    _Atomic(KGCObject*) items[];
+} KGCDequeBuffer;
+
+// 所有者在 bottom 端压入/弹出, 窃取者从 top 端窃取
+typedef struct KGCDeque {
+    atomic_long top;
+    atomic_long bottom;
+    _Atomic(KGCDequeBuffer*) buffer;
+} KGCDeque;
+
+// 每个 GC 工作线程的标记状态
+struct KGCMarker {
+    KGCHeap* heap;
+    KGCDeque deque;
+    size_t bytes_marked;        // 本线程标记到的存活字节数
+    size_t bytes_freed;         // 本线程清扫释放的字节数
+    unsigned seed;              // 选择窃取目标用的随机数种子
+};
+
+// GC 工作线程池; 调用线程作为 0 号线程参与每个并行任务
+struct KGCWorkers {
+    int count;                  // 成功启动的线程总数 (含调用线程)
+    int marker_count;           // markers 数组的长度 (请求的线程数)
+    pthread_t* threads;         // count - 1 个后台线程
+    KGCMarker* markers;         // 每个线程一个标记器
+    pthread_mutex_t lock;
+    pthread_cond_t start_cond;
+    pthread_cond_t done_cond;
+    unsigned long generation;   // 每发布一个任务加一
+    int pending;                // 尚未完成当前任务的后台线程数
+    bool shutdown;
+    void (*job)(KGCHeap* heap, KGCMarker* marker);
+    atomic_int active;          // 终止检测: 仍可能产生标记工作的线程数
+    KAllocSweepRange* ranges;   // 并行清扫: 切分好的页面段
+    size_t range_count;
+    atomic_size_t next_range;   // 并行清扫: 下一个待领取的段
+};
+
+static KGCDequeBuffer* deque_buffer_new(size_t capacity) {
+    KGCDequeBuffer* buffer = malloc(sizeof(KGCDequeBuffer) + capacity * sizeof(_Atomic(KGCObject*)));
+    if (!buffer) {
+        fprintf(stderr, "Error: malloc failed in deque_buffer_new\n");
+        exit(EXIT_FAILURE);
+    }
+    buffer->capacity = capacity;
+    buffer->retired = NULL;
+    return buffer;
+}
+
+static void deque_init(KGCDeque* deque) {
+    atomic_init(&deque->top, 0);
+    atomic_init(&deque->bottom, 0);
+    atomic_init(&deque->buffer, deque_buffer_new(1024));
+}
+
+// 释放扩容时留下的旧缓冲区 (只能在没有窃取者时调用)
+static void deque_release_retired(KGCDeque* deque) {
+    KGCDequeBuffer* buffer = atomic_load_explicit(&deque->buffer, memory_order_relaxed);
+    KGCDequeBuffer* old = buffer->retired;
+    buffer->retired = NULL;
+    while (old) {
+        KGCDequeBuffer* next = old->retired;
+        free(old);
+        old = next;
+    }
+}
+
+static void deque_destroy(KGCDeque* deque) {
+    deque_release_retired(deque);
+    free(atomic_load_explicit(&deque->buffer, memory_order_relaxed));
+}
+
+// 仅所有者调用
+static void deque_push(KGCDeque* deque, KGCObject* obj) {
+    long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    KGCDequeBuffer* buffer = atomic_load_explicit(&deque->buffer, memory_order_relaxed);
+    if (b - t >= (long)buffer->capacity) {
+        KGCDequeBuffer* grown = deque_buffer_new(buffer->capacity * 2);
+        for (long i = t; i < b; i++) {
+            KGCObject* item = atomic_load_explicit(&buffer->items[(size_t)i & (buffer->capacity - 1)],
+                                                   memory_order_relaxed);
+            atomic_store_explicit(&grown->items[(size_t)i & (grown->capacity - 1)], item, memory_order_relaxed);
+        }
+        grown->retired = buffer;
+        atomic_store_explicit(&deque->buffer, grown, memory_order_release);
+        buffer = grown;
+    }
+    atomic_store_explicit(&buffer->items[(size_t)b & (buffer->capacity - 1)], obj, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+}
+
+// 仅所有者调用; 队列为空时返回 NULL
+static KGCObject* deque_take(KGCDeque* deque) {
+    long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    KGCDequeBuffer* buffer = atomic_load_explicit(&deque->buffer, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    KGCObject* obj = NULL;
+    if (t <= b) {
+        obj = atomic_load_explicit(&buffer->items[(size_t)b & (buffer->capacity - 1)], memory_order_relaxed);
+        if (t == b) {
+            // 最后一个元素: 与窃取者竞争
+            if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+                                                         memory_order_seq_cst, memory_order_relaxed)) {
+                obj = NULL;
+            }
+            atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+        }
+    } else {
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+    }
+    return obj;
+}
+
+// 任意线程调用; 队列为空或竞争失败时返回 NULL
+static KGCObject* deque_steal(KGCDeque* deque) {
+    long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (t >= b) return NULL;
+
+    KGCDequeBuffer* buffer = atomic_load_explicit(&deque->buffer, memory_order_acquire);
+    KGCObject* obj = atomic_load_explicit(&buffer->items[(size_t)t & (buffer->capacity - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed)) {
+        return NULL;
+    }
+    return obj;
+}
+
+static bool deque_is_empty(KGCDeque* deque) {
+    long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    long b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    return t >= b;
+}
+
+// =============================================================================
+// GC 工作线程池
+// =============================================================================
+
+static void* worker_main(void* arg) {
+    KGCMarker* marker = arg;
+    KGCWorkers* workers = marker->heap->workers;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&workers->lock);
+    for (;;) {
+        while (!workers->shutdown && workers->generation == seen) {
+            pthread_cond_wait(&workers->start_cond, &workers->lock);
+        }
+        if (workers->shutdown) break;
+        seen = workers->generation;
+        void (*job)(KGCHeap*, KGCMarker*) = workers->job;
+        pthread_mutex_unlock(&workers->lock);
+
+        job(marker->heap, marker);
+
+        pthread_mutex_lock(&workers->lock);
+        if (--workers->pending == 0) {
+            pthread_cond_signal(&workers->done_cond);
+        }
+    }
+    pthread_mutex_unlock(&workers->lock);
+    return NULL;
+}
+
+// 创建工作线程池; 线程创建失败时按实际创建成功的数量运行
+static KGCWorkers* workers_new(KGCHeap* heap, int count) {
+    KGCWorkers* workers = calloc(1, sizeof(KGCWorkers));
+    if (!workers) {
+        fprintf(stderr, "Error: calloc failed in workers_new\n");
+        exit(EXIT_FAILURE);
+    }
+    workers->threads = calloc((size_t)count, sizeof(pthread_t));
+    workers->markers = calloc((size_t)count, sizeof(KGCMarker));
+    if (!workers->threads || !workers->markers) {
+        fprintf(stderr, "Error: calloc failed in workers_new\n");
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_init(&workers->lock, NULL);
+    pthread_cond_init(&workers->start_cond, NULL);
+    pthread_cond_init(&workers->done_cond, NULL);
+
+    workers->marker_count = count;
+    for (int i = 0; i < count; i++) {
+        workers->markers[i].heap = heap;
+        workers->markers[i].seed = (unsigned)i * 2654435761u + 1;
+        deque_init(&workers->markers[i].deque);
+    }
+
+    heap->workers = workers;
+    workers->count = 1;
+    for (int i = 1; i < count; i++) {
+        if (pthread_create(&workers->threads[i - 1], NULL, worker_main, &workers->markers[i]) != 0) {
+            fprintf(stderr, "Warning: failed to start GC worker thread, using %d thread(s)\n", workers->count);
+            break;
+        }
+        workers->count++;
+    }
+    return workers;
+}
+
+static void workers_free(KGCWorkers* workers) {
+    pthread_mutex_lock(&workers->lock);
+    workers->shutdown = true;
+    pthread_cond_broadcast(&workers->start_cond);
+    pthread_mutex_unlock(&workers->lock);
+    for (int i = 0; i < workers->count - 1; i++) {
+        pthread_join(workers->threads[i], NULL);
+    }
+    for (int i = 0; i < workers->marker_count; i++) {
+        deque_destroy(&workers->markers[i].deque);
+    }
+    pthread_mutex_destroy(&workers->lock);
+    pthread_cond_destroy(&workers->start_cond);
+    pthread_cond_destroy(&workers->done_cond);
+    free(workers->threads);
+    free(workers->markers);
+    free(workers);
+}
+
+// 在所有工作线程 (含调用线程) 上运行同一个任务, 全部完成后返回
+static void run_parallel(KGCHeap* heap, void (*job)(KGCHeap*, KGCMarker*)) {
+    KGCWorkers* workers = heap->workers;
+    pthread_mutex_lock(&workers->lock);
+    workers->job = job;
+    workers->pending = workers->count - 1;
+    workers->generation++;
+    pthread_cond_broadcast(&workers->start_cond);
+    pthread_mutex_unlock(&workers->lock);
+
+    job(heap, &workers->markers[0]);
+
+    pthread_mutex_lock(&workers->lock);
+    while (workers->pending > 0) {
+        pthread_cond_wait(&workers->done_cond, &workers->lock);
+    }
+    pthread_mutex_unlock(&workers->lock);
+}
+
+// 是否使用并行回收
+static bool use_parallel(KGCHeap* heap) {
+    if (heap->config.threads <= 1) return false;
+    if (!heap->workers) {
+        workers_new(heap, heap->config.threads);
+    }
+    return heap->workers->count > 1;
+}
+
+// 并行标记一个对象: 通过 CAS 抢占 白 -> 灰 的转换, 成功者负责扫描
+static void parallel_mark(KGCMarker* marker, KGCObject* obj) {
+    if (!obj) return;
+    uint8_t color = __atomic_load_n(&obj->color, __ATOMIC_RELAXED);
+    if (color > KGC_WHITE1) {
+        // 共享对象的标志不会再改变; 其他对象的标志只在变灰之前读取, 与扫描它的线程无关
+        if (color == KGC_BLACK && (obj->flags & KGC_FLAG_COUNTED)) reach_region(marker->heap, obj);
+        return;
+    }
+    if (!__atomic_compare_exchange_n(&obj->color, &color, KGC_GRAY, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        return;
+    }
+    const KGCTypeInfo* info = kgc_types[obj->type];
+    if (info && info->trace) {
+        deque_push(&marker->deque, obj);
+    } else {
+        __atomic_store_n(&obj->color, KGC_BLACK, __ATOMIC_RELAXED);
+        marker->bytes_marked += kalloc_usable_size(obj->size);
+    }
+}
+
+// 从其他线程的队列窃取一个对象
+static KGCObject* steal_work(KGCWorkers* workers, KGCMarker* self) {
+    int count = workers->count;
+    self->seed = self->seed * 1103515245u + 12345u;
+    int start = (int)((self->seed >> 16) % (unsigned)count);
+    for (int attempt = 0; attempt < 2; attempt++) {
+        for (int i = 0; i < count; i++) {
+            KGCMarker* victim = &workers->markers[(start + i) % count];
+            if (victim == self) continue;
+            KGCObject* obj = deque_steal(&victim->deque);
+            if (obj) return obj;
+        }
+    }
+    return NULL;
+}
+
+static bool any_work_left(KGCWorkers* workers) {
+    for (int i = 0; i < workers->count; i++) {
+        if (!deque_is_empty(&workers->markers[i].deque)) return true;
+    }
+    return false;
+}
+
+// 并行标记任务: 处理自己的队列, 空了就去窃取, 所有线程都空闲时结束
+static void parallel_mark_job(KGCHeap* heap, KGCMarker* marker) {
+    KGCWorkers* workers = heap->workers;
+    KGCTracer tracer = {.heap = heap, .marker = marker};
+
+    for (;;) {
+        KGCObject* obj = deque_take(&marker->deque);
+        if (!obj) obj = steal_work(workers, marker);
+        if (obj) {
+            __atomic_store_n(&obj->color, KGC_BLACK, __ATOMIC_RELAXED);
+            marker->bytes_marked += kalloc_usable_size(obj->size);
+            kgc_types[obj->type]->trace(&tracer, obj);
+            continue;
+        }
+
+        // 没有可做的工作: 退出活跃状态, 直到其他线程产生新工作或全部结束
+        atomic_fetch_sub(&workers->active, 1);
+        for (;;) {
+            if (atomic_load(&workers->active) == 0) return;
+            if (any_work_left(workers)) {
+                atomic_fetch_add(&workers->active, 1);
+                break;
+            }
+            sched_yield();
+        }
+    }
+}
+
+// 并行排空灰色栈
+static void parallel_drain(KGCHeap* heap) {
+    KGCWorkers* workers = heap->workers;
+    for (size_t i = 0; i < heap->gray_count; i++) {
+        deque_push(&workers->markers[i % (size_t)workers->count].deque, heap->gray[i]);
+    }
+    heap->gray_count = 0;
+    for (int i = 0; i < workers->count; i++) {
+        workers->markers[i].bytes_marked = 0;
+    }
+    atomic_store(&workers->active, workers->count);
+
+    run_parallel(heap, parallel_mark_job);
+
+    for (int i = 0; i < workers->count; i++) {
+        heap->bytes_marked += workers->markers[i].bytes_marked;
+        deque_release_retired(&workers->markers[i].deque);
+    }
+}
+
+// =============================================================================
+// 标记阶段
+// =============================================================================
+
+// 标记根集合 (根来源 + 临时根)
+static void mark_roots(KGCHeap* heap) {
+    KGCTracer tracer = {.heap = heap, .marker = NULL};
+    for (size_t i = 0; i < heap->root_source_count; i++) {
+        heap->root_sources[i].fn(&tracer, heap->root_sources[i].userdata);
+    }
+    for (size_t i = 0; i < heap->temp_root_count; i++) {
+        mark_object(heap, heap->temp_roots[i]);
+    }
+    for (KGCHandle* handle = heap->handles; handle; handle = handle->next) {
+        mark_object(heap, handle->object);
+    }
+}
+
+// 扫描分段扫描中的大对象的下一段, 返回完成的工作量
+static size_t scan_chunk(KGCHeap* heap) {
+    KGCObject* obj = heap->scan_object;
+    const KGCTypeInfo* info = kgc_types[obj->type];
+    // 扫描期间对象可能变大或变小; 变大的部分由前向屏障负责
+    size_t count = info->slot_count(obj);
+    size_t begin = heap->scan_next < count ? heap->scan_next : count;
+    size_t end = count - begin > KGC_SCAN_CHUNK ? begin + KGC_SCAN_CHUNK : count;
+    KGCTracer tracer = {.heap = heap, .marker = NULL};
+    info->trace_range(&tracer, obj, begin, end);
+    if (end == count) {
+        heap->scan_object = NULL;
+    } else {
+        heap->scan_next = end;
+    }
+    return (end - begin) * KGC_SLOT_WORK;
+}
+
+// 扫描一个灰色对象 (大对象只扫描第一段), 返回完成的工作量: 对象大小加上扫描的引用槽
+static size_t propagate_one(KGCHeap* heap) {
+    if (heap->scan_object) return scan_chunk(heap);
+    KGCObject* obj = heap->gray[--heap->gray_count];
+    obj->color = KGC_BLACK;
+    heap->bytes_marked += kalloc_usable_size(obj->size);
+    if (is_large(obj)) {
+        heap->scan_object = obj;
+        heap->scan_next = 0;
+        return obj->size + scan_chunk(heap);
+    }
+    KGCTracer tracer = {.heap = heap, .marker = NULL};
+    kgc_types[obj->type]->trace(&tracer, obj);
+    return obj->size + tracer.slots * KGC_SLOT_WORK;
+}
+
+// 是否还有标记工作 (灰色对象或未扫描完的大对象)
+static bool gray_work_left(const KGCHeap* heap) {
+    return heap->gray_count > 0 || heap->scan_object;
+}
+
+// 开始新一轮回收: 标记根集合, 进入增量标记阶段
+static void start_cycle(KGCHeap* heap) {
+    heap->bytes_marked = 0;
+    heap->held_epoch++;
+    heap->remarks = 0;
+    heap->phase = KGC_PHASE_MARK;
+    mark_roots(heap);
+}
+
+// 辅助函数：释放本轮没有标记到的共享区, 并重建表 (线性探测的表不能直接删除)
+static void release_unreached(KGCHeap* heap) {
+    if (heap->held_count == 0) return;
+    KGCHeld* old = heap->held;
+    size_t old_capacity = heap->held_capacity;
+    size_t kept = 0;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (!old[i].region) continue;
+        if (old[i].epoch == heap->held_epoch) {
+            kept++;
+            continue;
+        }
+        kgc_account_external(heap, -(ptrdiff_t)old[i].bytes);
+        kgc_region_release(old[i].region);
+        old[i].region = NULL;
+    }
+    if (kept == heap->held_count) return;
+    heap->held = NULL;
+    heap->held_count = 0;
+    heap->held_capacity = 0;
+    if (kept > 0) held_resize(heap, held_capacity_for(kept));
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old[i].region) held_insert(heap, old[i]);
+    }
+    free(old);
+}
+
+// 原子阶段: 重新扫描根集合 (根的写入没有屏障)。增量回收中若由此产生了新的灰色对象
+// (通常是标记期间新分配、只被根引用的对象), 先回到增量标记并返回 false, 最多
+// KGC_MAX_REMARKS 次; 否则排空灰色栈, 翻转白色, 进入惰性清扫阶段, 返回 true。
+// full 为 true (完整回收) 时总是排空; 完整回收或剩余灰色对象较多时使用并行标记。
+static bool atomic_phase(KGCHeap* heap, bool full) {
+    mark_roots(heap);
+    if (!full && gray_work_left(heap) && heap->remarks < KGC_MAX_REMARKS) {
+        heap->remarks++;
+        return false;
+    }
+    // 并行标记总是扫描整个对象, 先串行扫描完分段扫描中的对象
+    while (heap->scan_object) {
+        scan_chunk(heap);
+    }
+    if ((full || heap->gray_count >= KGC_PARALLEL_MIN_GRAY) && use_parallel(heap)) {
+        parallel_drain(heap);
+    } else {
+        while (gray_work_left(heap)) {
+            propagate_one(heap);
+        }
+    }
+    release_unreached(heap);
+    heap->current_white = other_white(heap);
+    kalloc_begin_sweep(&heap->allocator);
+    heap->phase = KGC_PHASE_SWEEP;
+    return true;
+}
+
+// =============================================================================
+// 清扫阶段
+// =============================================================================
+
+// kalloc 的清扫回调: 另一种白色的对象已死亡, 存活对象重置为当前白色
+static bool sweep_cell(void* cell, void* userdata) {
+    KGCHeap* heap = userdata;
+    KGCObject* obj = cell;
+    if (obj->color == other_white(heap)) {
+        finalize_object(heap, obj);
+        return true;
+    }
+    obj->color = heap->current_white;
+    return false;
+}
+
+// 并行清扫任务: 各线程按顺序领取页面段 (同一尺寸类的页面也分布在多个段中)
+static void parallel_sweep_job(KGCHeap* heap, KGCMarker* marker) {
+    KGCWorkers* workers = heap->workers;
+    for (;;) {
+        size_t index = atomic_fetch_add(&workers->next_range, 1);
+        if (index >= workers->range_count) return;
+        marker->bytes_freed += kalloc_sweep_range(&heap->allocator, &workers->ranges[index]);
+    }
+}
+
+// 并行清扫剩余的全部页面
+static void parallel_sweep(KGCHeap* heap) {
+    KGCWorkers* workers = heap->workers;
+    for (int i = 0; i < workers->count; i++) {
+        workers->markers[i].bytes_freed = 0;
+    }
+    workers->ranges = kalloc_split_sweep(&heap->allocator, KGC_SWEEP_RANGE_PAGES, &workers->range_count);
+    atomic_store(&workers->next_range, 0);
+    run_parallel(heap, parallel_sweep_job);
+    kalloc_join_ranges(&heap->allocator, workers->ranges, workers->range_count);
+    workers->ranges = NULL;
+    for (int i = 0; i < workers->count; i++) {
+        heap->bytes_allocated -= workers->markers[i].bytes_freed;
+    }
+}
+
+// =============================================================================
+// 整理
+// =============================================================================
+
+// kalloc 整理回调: 被固定的对象不可移动
+static bool cell_movable(void* cell, void* userdata) {
+    (void)userdata;
+    return !(((KGCObject*)cell)->flags & KGC_FLAG_PINNED);
+}
+
+// 疏散一个对象: 复制到新单元, 原位置改为转发记录
+static void evacuate_cell(void* cell, size_t cell_size, void* userdata) {
+    (void)cell_size;
+    KGCHeap* heap = userdata;
+    KGCObject* obj = cell;
+    KGCObject* copy = kalloc_alloc(&heap->allocator, obj->size, NULL);
+    memcpy(copy, obj, obj->size);
+    obj->flags |= KGC_FLAG_FORWARDED;
+    ((KGCForward*)obj)->to = copy;
+    heap->bytes_moved += obj->size;
+}
+
+// 更新一个对象中指向已疏散对象的引用
+static void update_cell(void* cell, size_t cell_size, void* userdata) {
+    (void)cell_size;
+    KGCTracer* tracer = userdata;
+    KGCObject* obj = cell;
+    const KGCTypeInfo* info = kgc_types[obj->type];
+    if (info && info->trace) {
+        info->trace(tracer, obj);
+    }
+}
+
+// 更新根集合、临时根、句柄以及所有存活对象中的引用
+static void update_references(KGCHeap* heap) {
+    KGCTracer tracer = {.heap = heap, .marker = NULL, .mode = KGC_TRACE_UPDATE};
+    for (size_t i = 0; i < heap->root_source_count; i++) {
+        heap->root_sources[i].fn(&tracer, heap->root_sources[i].userdata);
+    }
+    for (size_t i = 0; i < heap->temp_root_count; i++) {
+        kgc_visit_object(&tracer, &heap->temp_roots[i]);
+    }
+    for (KGCHandle* handle = heap->handles; handle; handle = handle->next) {
+        kgc_visit_object(&tracer, &handle->object);
+    }
+    kalloc_for_each(&heap->allocator, update_cell, &tracer);
+}
+
+// 整理堆 (必须在空闲阶段调用), 返回释放的页面数
+static size_t compact_heap(KGCHeap* heap) {
+    heap->compact_pending = false;
+    KAllocPage* pages = kalloc_begin_compaction(&heap->allocator, heap->config.compact_page_live,
+                                                cell_movable, NULL);
+    if (!pages) return 0;
+
+    for (KAllocPage* page = pages; page; page = page->next) {
+        kalloc_for_each_in_page(page, evacuate_cell, heap);
+    }
+    update_references(heap);
+    heap->compactions++;
+    return kalloc_release_pages(&heap->allocator, pages);
+}
+
+// 结束本轮回收, 根据本轮标记到的存活字节数计算下一轮的触发阈值
+// (不使用 bytes_allocated: 它包含回收期间新分配的对象, 会让阈值逐轮膨胀)
+static void finish_cycle(KGCHeap* heap) {
+    kalloc_end_sweep(&heap->allocator);
+    heap->phase = KGC_PHASE_IDLE;
+    heap->debt = 0;
+    heap->cycles++;
+    heap->cycle_end_ns = kgc_now_ns();
+    heap->cycle_end_allocated = heap->total_allocated;
+    heap->mark_ns = heap->cycle_mark_ns;
+    heap->cycle_mark_ns = 0;
+
+    // 分配路径上不能移动对象 (调用者可能持有裸指针), 只登记, 由安全点执行
+    if (heap->config.compact_threshold > 0 &&
+        kalloc_small_capacity(&heap->allocator) >= heap->config.compact_min_bytes &&
+        kgc_fragmentation(heap) > heap->config.compact_threshold) {
+        heap->compact_pending = true;
+    }
+
+    // 阈值与 bytes_allocated 比较, 两者按同样的方式计量: 存活对象的单元大小加上它们持有的
+    // 外部内存 (清扫完成时, 死对象的外部内存已由终结器扣除, 剩下的即存活对象持有的部分)
+    heap->live_bytes = heap->bytes_marked + heap->bytes_external;
+    size_t threshold = heap->live_bytes / 100 * (size_t)heap->config.pause_percent;
+    heap->threshold = threshold > heap->config.min_threshold ? threshold : heap->config.min_threshold;
+}
+
+// 以给定的预算推进回收; budget 为 0 表示不限工作量, 直到本轮回收结束
+static bool run_steps(KGCHeap* heap, size_t budget, uint32_t time_us) {
+    uint64_t start = kgc_now_ns();
+    // 标记阶段的耗时单独累计 (gcStats 的 mark_ns), 为 0 表示本片已不在标记阶段
+    uint64_t mark_start = heap->phase != KGC_PHASE_SWEEP ? start : 0;
+    if (heap->phase == KGC_PHASE_IDLE) {
+        start_cycle(heap);
+    }
+
+    uint64_t deadline = time_us ? start + (uint64_t)time_us * 1000ull : 0;
+    size_t work = 0;
+    unsigned ticks = 0;
+
+    while (budget == 0 || work < budget) {
+        if (heap->phase == KGC_PHASE_MARK) {
+            if (budget == 0 || !gray_work_left(heap)) {
+                if (atomic_phase(heap, budget == 0)) {
+                    heap->cycle_mark_ns += kgc_now_ns() - mark_start;
+                    mark_start = 0;
+                }
+            } else {
+                work += propagate_one(heap);
+            }
+        } else {
+            if (budget == 0 && use_parallel(heap)) {
+                parallel_sweep(heap);
+                finish_cycle(heap);
+                return true;
+            }
+            size_t freed = 0;
+            size_t slice = budget == 0 ? SIZE_MAX : KGC_SWEEP_SLICE;
+            bool done = kalloc_sweep_some(&heap->allocator, slice, &freed);
+            heap->bytes_allocated -= freed;
+            work += slice == SIZE_MAX ? 0 : slice;
+            if (done) {
+                finish_cycle(heap);
+                return true;
+            }
+        }
+
+        if (deadline && ++ticks % KGC_TIME_CHECK_INTERVAL == 0 && kgc_now_ns() >= deadline) {
+            break;
+        }
+    }
+    if (mark_start) heap->cycle_mark_ns += kgc_now_ns() - mark_start;
+    return false;
+}
+
+// 辅助函数：记录一次停顿 (从 start_ns 到现在)
+static void record_pause(KGCHeap* heap, uint64_t start_ns) {
+    uint64_t ns = kgc_now_ns() - start_ns;
+    uint64_t us = ns / 1000;
+    unsigned bucket = 0;
+    while (us > 0 && bucket < KGC_PAUSE_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    heap->pause_histogram[bucket]++;
+    heap->pause_count++;
+    heap->pause_total_ns += ns;
+    if (ns > heap->pause_max_ns) heap->pause_max_ns = ns;
+}
+
+// 推进一个增量片并记录停顿
+static bool timed_steps(KGCHeap* heap, size_t budget, uint32_t time_us) {
+    uint64_t start = kgc_now_ns();
+    bool done = run_steps(heap, budget, time_us);
+    record_pause(heap, start);
+    return done;
+}
+
+// 完整回收 (不记录停顿, 由调用者计时)
+static void collect(KGCHeap* heap) {
+    // 先完成进行中的一轮 (它开始之后变成垃圾的对象可能仍被保留), 再完整执行一轮
+    if (heap->phase != KGC_PHASE_IDLE) {
+        run_steps(heap, 0, 0);
+    }
+    run_steps(heap, 0, 0);
+    heap->full_collections++;
+}
+
+// =============================================================================
+// 分配点采样
+// =============================================================================
+
+// 辅助函数：下一次采样前还需分配的字节数, 在 [1, 2 * interval] 内均匀分布,
+// 避免固定间隔与程序的分配模式同步
+static ptrdiff_t next_sample_countdown(KGCHeap* heap) {
+    if (heap->config.sample_interval == 0) return PTRDIFF_MAX;
+    uint64_t x = heap->sample_seed;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    heap->sample_seed = x;
+    return (ptrdiff_t)(x % (2 * (uint64_t)heap->config.sample_interval)) + 1;
+}
+
+// 辅助函数：在采样结果表中查找 (site, type), 不存在时插入
+static KGCSiteEntry* find_site(KGCHeap* heap, const char* site, uint16_t type) {
+    if ((heap->site_count + 1) * 4 > heap->site_capacity * 3) {
+        size_t new_capacity = heap->site_capacity ? heap->site_capacity * 2 : 64;
+        KGCSiteEntry* new_sites = calloc(new_capacity, sizeof(KGCSiteEntry));
+        if (!new_sites) {
+            fprintf(stderr, "Error: calloc failed in find_site\n");
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = 0; i < heap->site_capacity; i++) {
+            KGCSiteEntry* old = &heap->sites[i];
+            if (!old->used) continue;
+            size_t j = (((uintptr_t)old->site >> 3) ^ old->type) & (new_capacity - 1);
+            while (new_sites[j].used) j = (j + 1) & (new_capacity - 1);
+            new_sites[j] = *old;
+        }
+        free(heap->sites);
+        heap->sites = new_sites;
+        heap->site_capacity = new_capacity;
+    }
+
+    size_t mask = heap->site_capacity - 1;
+    size_t i = (((uintptr_t)site >> 3) ^ type) & mask;
+    while (heap->sites[i].used) {
+        if (heap->sites[i].site == site && heap->sites[i].type == type) {
+            return &heap->sites[i];
+        }
+        i = (i + 1) & mask;
+    }
+    heap->sites[i].used = true;
+    heap->sites[i].site = site;
+    heap->sites[i].type = type;
+    heap->site_count++;
+    return &heap->sites[i];
+}
+
+// 分配路径的慢路径: 计数器减到负数时记录一次采样
+// (大于采样间隔的对象可能跨越多个采样点, 按跨越的次数计入)
+static void sample_allocation(KGCHeap* heap, uint16_t type) {
+    if (heap->config.sample_interval == 0) {
+        heap->sample_countdown = PTRDIFF_MAX;
+        return;
+    }
+    KGCSiteEntry* entry = find_site(heap, heap->alloc_site, type);
+    while (heap->sample_countdown < 0) {
+        entry->samples++;
+        entry->bytes += heap->config.sample_interval;
+        heap->sample_countdown += next_sample_countdown(heap);
+    }
+}
+
+static int compare_sites(const void* a, const void* b) {
+    const KGCAllocSite* x = a;
+    const KGCAllocSite* y = b;
+    if (x->bytes != y->bytes) return x->bytes < y->bytes ? 1 : -1;
+    return 0;
+}
+
+// =============================================================================
+// 堆快照
+// =============================================================================
+
+typedef struct KGCSnapshotWriter {
+    FILE* file;
+    uint8_t root_kind;          // 正在写入的根的种类
+    KGCObject** edges;          // 当前对象的引用 (写入对象记录前需要知道边数)
+    size_t edge_count;
+    size_t edge_capacity;
+    uint64_t object_count;
+} KGCSnapshotWriter;
+
+static uint64_t snapshot_id(const KGCObject* obj) {
+    return (uint64_t)(uintptr_t)obj >> 4;
+}
+
+static void write_varint(FILE* file, uint64_t value) {
+    while (value >= 0x80) {
+        putc((int)(value & 0x7f) | 0x80, file);
+        value >>= 7;
+    }
+    putc((int)value, file);
+}
+
+// 根引用: 直接写出一条根记录
+static void snapshot_root_edge(KGCTracer* tracer, KGCObject* child) {
+    KGCSnapshotWriter* writer = tracer->userdata;
+    putc('R', writer->file);
+    putc(writer->root_kind, writer->file);
+    write_varint(writer->file, snapshot_id(child));
+}
+
+// 对象引用: 先收集到缓冲区
+static void snapshot_object_edge(KGCTracer* tracer, KGCObject* child) {
+    KGCSnapshotWriter* writer = tracer->userdata;
+    if (writer->edge_count == writer->edge_capacity) {
+        size_t new_capacity = writer->edge_capacity ? writer->edge_capacity * 2 : 64;
+        KGCObject** new_edges = realloc(writer->edges, new_capacity * sizeof(KGCObject*));
+        if (!new_edges) {
+            fprintf(stderr, "Error: realloc failed in snapshot_object_edge\n");
+            exit(EXIT_FAILURE);
+        }
+        writer->edges = new_edges;
+        writer->edge_capacity = new_capacity;
+    }
+    writer->edges[writer->edge_count++] = child;
+}
+
+// kalloc 遍历回调: 写出一个对象记录
+static void snapshot_cell(void* cell, size_t cell_size, void* userdata) {
+    (void)cell_size;
+    KGCSnapshotWriter* writer = userdata;
+    KGCObject* obj = cell;
+    if (obj->flags & KGC_FLAG_FORWARDED) return;
+
+    const KGCTypeInfo* info = kgc_types[obj->type];
+    writer->edge_count = 0;
+    if (info && info->trace) {
+        KGCTracer tracer = {.mode = KGC_TRACE_EDGES, .edge = snapshot_object_edge, .userdata = writer};
+        info->trace(&tracer, obj);
+    }
+    uint64_t size = obj->size;
+    if (info && info->external_size) {
+        size += info->external_size(obj);
+    }
+
+    uint64_t id = snapshot_id(obj);
+    putc('O', writer->file);
+    write_varint(writer->file, id);
+    write_varint(writer->file, obj->type);
+    write_varint(writer->file, size);
+    write_varint(writer->file, writer->edge_count);
+    uint64_t prev = id;
+    for (size_t i = 0; i < writer->edge_count; i++) {
+        uint64_t target = snapshot_id(writer->edges[i]);
+        int64_t delta = (int64_t)(target - prev);
+        write_varint(writer->file, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+        prev = target;
+    }
+    writer->object_count++;
+}
+
+// 写出整个快照, 只读访问堆
+static bool write_snapshot(KGCHeap* heap, const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+    setvbuf(file, NULL, _IOFBF, 1 << 20);
+
+    KGCSnapshotWriter writer = {.file = file};
+    fwrite(KGC_SNAPSHOT_MAGIC, 1, 8, file);
+
+    for (uint16_t i = 1; i < KGC_MAX_TYPES; i++) {
+        if (!kgc_types[i]) continue;
+        const char* name = kgc_types[i]->name ? kgc_types[i]->name : "";
+        size_t length = strlen(name);
+        putc('T', file);
+        write_varint(file, i);
+        write_varint(file, length);
+        fwrite(name, 1, length, file);
+    }
+
+    KGCTracer tracer = {.heap = heap, .mode = KGC_TRACE_EDGES, .edge = snapshot_root_edge, .userdata = &writer};
+    writer.root_kind = KGC_SNAPSHOT_ROOT_SOURCE;
+    for (size_t i = 0; i < heap->root_source_count; i++) {
+        heap->root_sources[i].fn(&tracer, heap->root_sources[i].userdata);
+    }
+    writer.root_kind = KGC_SNAPSHOT_ROOT_TEMP;
+    for (size_t i = 0; i < heap->temp_root_count; i++) {
+        kgc_visit_object(&tracer, &heap->temp_roots[i]);
+    }
+    writer.root_kind = KGC_SNAPSHOT_ROOT_HANDLE;
+    for (KGCHandle* handle = heap->handles; handle; handle = handle->next) {
+        kgc_visit_object(&tracer, &handle->object);
+    }
+
+    kalloc_for_each(&heap->allocator, snapshot_cell, &writer);
+    putc('E', file);
+    write_varint(file, writer.object_count);
+    free(writer.edges);
+
+    bool ok = !ferror(file);
+    if (fclose(file) != 0) ok = false;
+    return ok;
+}
+
+// =============================================================================
+// 公共接口
+// =============================================================================
+
+void kgc_register_type(uint16_t id, const KGCTypeInfo* info) {
+    if (id == 0 || id >= KGC_MAX_TYPES) {
+        fprintf(stderr, "Error: invalid GC type id %u\n", id);
+        exit(EXIT_FAILURE);
+    }
+    kgc_types[id] = info;
+}
+
+void kgc_default_config(KGCConfig* config) {
+    config->incremental = true;
+    config->step_work = 64 * 1024;
+    config->step_time_us = 1000;
+    config->pause_percent = 200;
+    config->step_multiplier = 200;
+    config->min_threshold = 1024 * 1024;
+
+    config->compact_threshold = 0.5;
+    config->compact_page_live = 0.3;
+    config->compact_min_bytes = 4 * 1024 * 1024;
+
+    config->sample_interval = 0;
+    const char* sample = getenv("KORELIN_GC_SAMPLE");
+    if (sample && *sample) {
+        long long value = atoll(sample);
+        config->sample_interval = value > 0 ? (size_t)value : 0;
+    }
+
+    config->threads = 1;
+    const char* threads = getenv("KORELIN_GC_THREADS");
+    if (threads && *threads) {
+        int value = atoi(threads);
+        if (value < 1) value = 1;
+        if (value > KGC_MAX_THREADS) value = KGC_MAX_THREADS;
+        config->threads = value;
+    }
+}
+
+KGCHeap* kgc_heap_new(const KGCConfig* config) {
+    KGCHeap* heap = calloc(1, sizeof(KGCHeap));
+    if (!heap) {
+        fprintf(stderr, "Error: calloc failed in kgc_heap_new\n");
+        exit(EXIT_FAILURE);
+    }
+    if (config) {
+        heap->config = *config;
+    } else {
+        kgc_default_config(&heap->config);
+    }
+    if (heap->config.step_work == 0) heap->config.step_work = 1;
+    if (heap->config.step_multiplier <= 0) heap->config.step_multiplier = 100;
+    if (heap->config.threads < 1) heap->config.threads = 1;
+    if (heap->config.threads > KGC_MAX_THREADS) heap->config.threads = KGC_MAX_THREADS;
+
+    heap->phase = KGC_PHASE_IDLE;
+    heap->current_white = KGC_WHITE0;
+    heap->threshold = heap->config.min_threshold;
+    heap->created_ns = kgc_now_ns();
+    heap->cycle_end_ns = heap->created_ns;
+    heap->sample_seed = heap->created_ns | 1;
+    heap->sample_countdown = next_sample_countdown(heap);
+    kalloc_init(&heap->allocator, sweep_cell, heap);
+    return heap;
+}
+
+// kalloc 遍历回调: 销毁堆时终结所有对象
+static void finalize_cell(void* cell, size_t cell_size, void* userdata) {
+    (void)cell_size;
+    finalize_object(userdata, cell);
+}
+
+void kgc_heap_free(KGCHeap* heap) {
+    if (!heap) return;
+    if (heap->workers) {
+        workers_free(heap->workers);
+    }
+    kalloc_for_each(&heap->allocator, finalize_cell, heap);
+    kalloc_destroy(&heap->allocator);
+    free(heap->gray);
+    free(heap->root_sources);
+    free(heap->temp_roots);
+    free(heap->sites);
+    for (size_t i = 0; i < heap->held_capacity; i++) {
+        if (heap->held[i].region) kgc_region_release(heap->held[i].region);
+    }
+    free(heap->held);
+    KGCHandle* handle = heap->handles;
+    while (handle) {
+        KGCHandle* next = handle->next;
+        free(handle);
+        handle = next;
+    }
+    free(heap);
+}
+
+void kgc_add_root_source(KGCHeap* heap, KGCRootFn fn, void* userdata) {
+    size_t new_count = heap->root_source_count + 1;
+    void* new_sources = realloc(heap->root_sources, new_count * sizeof(*heap->root_sources));
+    if (!new_sources) {
+        fprintf(stderr, "Error: realloc failed in kgc_add_root_source\n");
+        exit(EXIT_FAILURE);
+    }
+    heap->root_sources = new_sources;
+    heap->root_sources[heap->root_source_count].fn = fn;
+    heap->root_sources[heap->root_source_count].userdata = userdata;
+    heap->root_source_count = new_count;
+}
+
+// 辅助函数：即将新增 size 字节时, 按债务推进增量回收或在超过阈值时回收
+static void pay_debt(KGCHeap* heap, size_t size) {
+    if (heap->config.incremental) {
+        if (heap->phase != KGC_PHASE_IDLE) {
+            heap->debt += (ptrdiff_t)(size * (size_t)heap->config.step_multiplier / 100);
+            if (heap->debt >= (ptrdiff_t)heap->config.step_work) {
+                heap->debt = 0;
+                timed_steps(heap, heap->config.step_work, heap->config.step_time_us);
+            }
+        } else if (heap->bytes_allocated >= heap->threshold) {
+            timed_steps(heap, heap->config.step_work, heap->config.step_time_us);
+        }
+    } else if (heap->bytes_allocated >= heap->threshold) {
+        kgc_collect(heap);
+    }
+}
+
+KGCObject* kgc_alloc(KGCHeap* heap, uint16_t type, size_t size) {
+    // 先偿还分配债务, 再分配新对象: 新对象不会在本次调用中被误回收
+    pay_debt(heap, size);
+
+    size_t usable = 0;
+    KGCObject* obj = kalloc_alloc(&heap->allocator, size, &usable);
+    obj->size = (uint32_t)size;
+    obj->type = type;
+    obj->color = heap->current_white;
+    obj->flags = 0;
+    heap->bytes_allocated += usable;
+    heap->total_allocated += usable;
+    heap->total_objects++;
+
+    // 未开启采样时计数器从 PTRDIFF_MAX 开始, 实际上不会进入慢路径
+    heap->sample_countdown -= (ptrdiff_t)usable;
+    if (heap->sample_countdown < 0) {
+        sample_allocation(heap, type);
+    }
+
+    // 分配路径上的按需清扫也会释放内存
+    if (heap->allocator.pending_freed) {
+        heap->bytes_allocated -= heap->allocator.pending_freed;
+        heap->allocator.pending_freed = 0;
+    }
+    return obj;
+}
+
+void kgc_account_external(KGCHeap* heap, ptrdiff_t delta) {
+    // 并行清扫时终结器会在多个线程上调用
+    __atomic_fetch_add(&heap->bytes_allocated, (size_t)delta, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&heap->bytes_external, (size_t)delta, __ATOMIC_RELAXED);
+    // 外部内存的增长 (只发生在分配线程上) 同样计入分配债务, 否则以外部缓冲区为主的分配
+    // 会远远跑在回收前面; 这里不推进回收 (调用者可能持有尚未成为根的新对象), 由下一次
+    // kgc_alloc 偿还
+    if (delta > 0 && heap->config.incremental && heap->phase != KGC_PHASE_IDLE) {
+        heap->debt += delta / 100 * heap->config.step_multiplier;
+    }
+}
+
+void kgc_visit_object(KGCTracer* tracer, KGCObject** slot) {
+    if (tracer->mode == KGC_TRACE_EDGES) {
+        // 共享对象不在本堆中, 快照里不出现
+        if (*slot && !((*slot)->flags & KGC_FLAG_SHARED)) tracer->edge(tracer, *slot);
+        return;
+    }
+    if (tracer->mode == KGC_TRACE_UPDATE) {
+        KGCObject* obj = *slot;
+        if (obj && (obj->flags & KGC_FLAG_FORWARDED)) {
+            *slot = ((KGCForward*)obj)->to;
+        }
+        return;
+    }
+    tracer->slots++;
+    if (tracer->marker) {
+        parallel_mark(tracer->marker, *slot);
+    } else {
+        mark_object(tracer->heap, *slot);
+    }
+}
+
+bool kgc_step(KGCHeap* heap) {
+    return timed_steps(heap, heap->config.step_work, heap->config.step_time_us);
+}
+
+void kgc_collect(KGCHeap* heap) {
+    uint64_t start = kgc_now_ns();
+    collect(heap);
+    record_pause(heap, start);
+}
+
+void kgc_barrier_slow(KGCHeap* heap, KGCObject* parent, const KGCObject* child) {
+    // 前向屏障: 重新扫描大对象的代价与它的大小成正比, 改为把 child 置灰, parent 保持黑色
+    if (parent == heap->scan_object || is_large(parent)) {
+        mark_object(heap, (KGCObject*)child);
+        return;
+    }
+    // 后向屏障: parent 重新变灰, 稍后重新扫描 (适合频繁写入的容器)
+    heap->bytes_marked -= kalloc_usable_size(parent->size);
+    push_gray(heap, parent);
+}
+
+void kgc_push_root(KGCHeap* heap, KGCObject* obj) {
+    if (heap->temp_root_count == heap->temp_root_capacity) {
+        size_t new_capacity = heap->temp_root_capacity ? heap->temp_root_capacity * 2 : 16;
+        KGCObject** new_roots = realloc(heap->temp_roots, new_capacity * sizeof(KGCObject*));
+        if (!new_roots) {
+            fprintf(stderr, "Error: realloc failed in kgc_push_root\n");
+            exit(EXIT_FAILURE);
+        }
+        heap->temp_roots = new_roots;
+        heap->temp_root_capacity = new_capacity;
+    }
+    heap->temp_roots[heap->temp_root_count++] = obj;
+}
+
+void kgc_pop_roots(KGCHeap* heap, size_t count) {
+    heap->temp_root_count = count > heap->temp_root_count ? 0 : heap->temp_root_count - count;
+}
+
+KGCHandle* kgc_handle_new(KGCHeap* heap, KGCObject* obj) {
+    KGCHandle* handle = malloc(sizeof(KGCHandle));
+    if (!handle) {
+        fprintf(stderr, "Error: malloc failed in kgc_handle_new\n");
+        exit(EXIT_FAILURE);
+    }
+    handle->object = obj;
+    handle->prev = NULL;
+    handle->next = heap->handles;
+    if (heap->handles) heap->handles->prev = handle;
+    heap->handles = handle;
+    return handle;
+}
+
+void kgc_handle_free(KGCHeap* heap, KGCHandle* handle) {
+    if (handle->prev) {
+        handle->prev->next = handle->next;
+    } else {
+        heap->handles = handle->next;
+    }
+    if (handle->next) handle->next->prev = handle->prev;
+    free(handle);
+}
+
+double kgc_fragmentation(KGCHeap* heap) {
+    size_t capacity = kalloc_small_capacity(&heap->allocator);
+    if (capacity == 0) return 0.0;
+    size_t live = heap->bytes_allocated - heap->bytes_external - heap->allocator.large_bytes;
+    if (live >= capacity) return 0.0;
+    return 1.0 - (double)live / (double)capacity;
+}
+
+// kalloc 遍历回调: 把对象变为共享对象
+static void freeze_cell(void* cell, size_t cell_size, void* userdata) {
+    (void)cell_size;
+    (void)userdata;
+    KGCObject* obj = cell;
+    obj->color = KGC_BLACK;
+    obj->flags |= KGC_FLAG_PINNED | KGC_FLAG_SHARED;
+}
+
+void kgc_freeze(KGCHeap* heap) {
+    if (heap->phase != KGC_PHASE_IDLE) {
+        fprintf(stderr, "Error: kgc_freeze called during a collection\n");
+        exit(EXIT_FAILURE);
+    }
+    kalloc_for_each(&heap->allocator, freeze_cell, NULL);
+    // 不会再有分配, 也就不会再触发回收
+    heap->threshold = SIZE_MAX;
+    heap->config.incremental = false;
+}
+
+// =============================================================================
+// 共享区
+// =============================================================================
+
+KGCRegion* kgc_region_new(void) {
+    KGCRegion* region = calloc(1, sizeof(KGCRegion));
+    if (!region) {
+        fprintf(stderr, "Error: calloc failed in kgc_region_new\n");
+        exit(EXIT_FAILURE);
+    }
+    region->refs = 1;
+    return region;
+}
+
+// 辅助函数：申请一个至少 size 字节的块; 单独成块的大分配不改变当前块
+static char* region_chunk(KGCRegion* region, size_t size, bool dedicated) {
+    // 只装一条消息 (或一个小值) 的共享区不必占用整块
+    size_t chunk_size = region->bytes < KGC_REGION_FIRST_CHUNK ? KGC_REGION_FIRST_CHUNK : region->bytes;
+    if (chunk_size > KGC_REGION_CHUNK) chunk_size = KGC_REGION_CHUNK;
+    if (dedicated || size > chunk_size) chunk_size = size;
+    KGCRegionChunk* chunk = malloc(sizeof(KGCRegionChunk) + chunk_size);
+    if (!chunk) {
+        fprintf(stderr, "Error: malloc failed in region_chunk\n");
+        exit(EXIT_FAILURE);
+    }
+    chunk->next = region->chunks;
+    chunk->size = chunk_size;
+    region->chunks = chunk;
+    region->bytes += sizeof(KGCRegionChunk) + chunk_size;
+    if (!dedicated) {
+        region->cursor = chunk->data + size;
+        region->limit = chunk->data + chunk_size;
+    }
+    return chunk->data;
+}
+
+void* kgc_region_bytes(KGCRegion* region, size_t size) {
+    size = (size + 15) & ~(size_t)15;
+    if (size > KGC_REGION_CHUNK / 4) return region_chunk(region, size, true);
+    if ((size_t)(region->limit - region->cursor) < size) return region_chunk(region, size, false);
+    char* memory = region->cursor;
+    region->cursor += size;
+    return memory;
+}
+
+KGCObject* kgc_region_alloc(KGCRegion* region, uint16_t type, size_t size) {
+    KGCRegionPrefix* prefix = kgc_region_bytes(region, sizeof(KGCRegionPrefix) + size);
+    prefix->region = region;
+    prefix->reserved = 0;
+    KGCObject* obj = (KGCObject*)(prefix + 1);
+    obj->size = (uint32_t)size;
+    obj->type = type;
+    obj->color = KGC_BLACK;
+    obj->flags = KGC_FLAG_PINNED | KGC_FLAG_SHARED | KGC_FLAG_COUNTED;
+    return obj;
+}
+
+size_t kgc_region_size(const KGCRegion* region) {
+    return region->bytes;
+}
+
+void kgc_region_retain(KGCRegion* region) {
+    __atomic_fetch_add(&region->refs, 1, __ATOMIC_RELAXED);
+}
+
+void kgc_region_release(KGCRegion* region) {
+    if (__atomic_sub_fetch(&region->refs, 1, __ATOMIC_ACQ_REL) != 0) return;
+    KGCRegionChunk* chunk = region->chunks;
+    while (chunk) {
+        KGCRegionChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(region);
+}
+
+KGCRegion* kgc_region_of(const KGCObject* obj) {
+    return ((const KGCRegionPrefix*)obj - 1)->region;
+}
+
+void kgc_hold(KGCHeap* heap, KGCObject* obj) {
+    KGCRegion* region = kgc_region_of(obj);
+    KGCHeld* held = find_held(heap, region);
+    if (held) {
+        // 标记阶段中登记的对象本轮视为已标记 (调用者随后让它可达, 写入时不一定经过屏障)
+        if (heap->phase == KGC_PHASE_MARK) held->epoch = heap->held_epoch;
+        return;
+    }
+    // 与 kgc_alloc 一样先偿还债务: 只收发共享对象而不分配的线程也要回收不再引用的共享区
+    pay_debt(heap, region->bytes);
+    if ((heap->held_count + 1) * 2 > heap->held_capacity) {
+        held_resize(heap, held_capacity_for(heap->held_count + 1));
+    }
+    // 空闲或清扫阶段登记的项带着上一轮的轮次, 下一轮标记不到时释放
+    KGCHeld entry = {region, heap->held_epoch, region->bytes};
+    held_insert(heap, entry);
+    kgc_region_retain(region);
+    kgc_account_external(heap, (ptrdiff_t)entry.bytes);
+}
+
+size_t kgc_compact(KGCHeap* heap) {
+    uint64_t start = kgc_now_ns();
+    collect(heap);
+    size_t released = compact_heap(heap);
+    record_pause(heap, start);
+    return released;
+}
+
+void kgc_safepoint(KGCHeap* heap) {
+    if (heap->compact_pending && heap->phase == KGC_PHASE_IDLE) {
+        uint64_t start = kgc_now_ns();
+        compact_heap(heap);
+        record_pause(heap, start);
+    }
+}
+
+void kgc_get_stats(KGCHeap* heap, KGCStats* stats, bool per_class) {
+    memset(stats, 0, sizeof(*stats));
+    stats->heap_bytes = heap->bytes_allocated;
+    stats->external_bytes = heap->bytes_external;
+    stats->live_bytes = heap->live_bytes;
+    stats->threshold = heap->threshold;
+    stats->mapped_bytes = heap->allocator.mapped_bytes;
+    stats->large_bytes = heap->allocator.large_bytes;
+    stats->fragmentation = kgc_fragmentation(heap);
+
+    uint64_t now = kgc_now_ns();
+    stats->total_allocated = heap->total_allocated;
+    stats->total_objects = heap->total_objects;
+    if (now > heap->created_ns) {
+        stats->alloc_rate = (double)heap->total_allocated * 1e9 / (double)(now - heap->created_ns);
+    }
+    if (now > heap->cycle_end_ns) {
+        stats->recent_alloc_rate = (double)(heap->total_allocated - heap->cycle_end_allocated) * 1e9 /
+                                   (double)(now - heap->cycle_end_ns);
+    }
+
+    stats->cycles = heap->cycles;
+    stats->full_collections = heap->full_collections;
+    stats->compactions = heap->compactions;
+    stats->bytes_moved = heap->bytes_moved;
+    stats->pages_released = heap->allocator.pages_released;
+
+    stats->pause_count = heap->pause_count;
+    stats->pause_total_ns = heap->pause_total_ns;
+    stats->pause_max_ns = heap->pause_max_ns;
+    stats->mark_ns = heap->mark_ns;
+    memcpy(stats->pause_histogram, heap->pause_histogram, sizeof(stats->pause_histogram));
+
+    if (per_class) {
+        stats->has_classes = true;
+        for (unsigned i = 0; i <= KALLOC_LARGE_CLASS; i++) {
+            kalloc_class_stats(&heap->allocator, i, &stats->classes[i]);
+        }
+    }
+}
+
+void kgc_set_sampling(KGCHeap* heap, size_t interval) {
+    heap->config.sample_interval = interval;
+    heap->sample_countdown = next_sample_countdown(heap);
+}
+
+size_t kgc_alloc_sites(KGCHeap* heap, KGCAllocSite* sites, size_t max) {
+    if (!sites || max == 0) return heap->site_count;
+
+    // 先全部取出排序, 再截取前 max 项
+    KGCAllocSite* all = malloc((heap->site_count ? heap->site_count : 1) * sizeof(KGCAllocSite));
+    if (!all) {
+        fprintf(stderr, "Error: malloc failed in kgc_alloc_sites\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t count = 0;
+    for (size_t i = 0; i < heap->site_capacity; i++) {
+        KGCSiteEntry* entry = &heap->sites[i];
+        if (!entry->used) continue;
+        const KGCTypeInfo* info = kgc_types[entry->type];
+        all[count++] = (KGCAllocSite){
+            .site = entry->site,
+            .type = entry->type,
+            .type_name = info ? info->name : NULL,
+            .samples = entry->samples,
+            .bytes = entry->bytes,
+        };
+    }
+    qsort(all, count, sizeof(KGCAllocSite), compare_sites);
+    memcpy(sites, all, (count < max ? count : max) * sizeof(KGCAllocSite));
+    free(all);
+    return count;
+}
+
+void kgc_reset_alloc_sites(KGCHeap* heap) {
+    free(heap->sites);
+    heap->sites = NULL;
+    heap->site_count = 0;
+    heap->site_capacity = 0;
+}
+
+bool kgc_write_snapshot(KGCHeap* heap, const char* path) {
+    uint64_t start = kgc_now_ns();
+    bool ok = write_snapshot(heap, path);
+    record_pause(heap, start);
+    return ok;
+}
+
+pid_t kgc_write_snapshot_async(KGCHeap* heap, const char* path) {
+    // 子进程只有调用线程; GC 工作线程此时空闲, 不持有任何锁
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid == 0) {
+        _exit(write_snapshot(heap, path) ? 0 : 1);
+    }
+    return pid;
+}
+
+bool kgc_snapshot_wait(pid_t pid) {
+    int status = 0;
+    if (pid <= 0 || waitpid(pid, &status, 0) != pid) return false;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
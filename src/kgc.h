@@ -5,4 +5,567 @@
 #ifndef KORELIN_KGC_H
 #define KORELIN_KGC_H
 
-#endif //KORELIN_KGC_H
\ No newline at end of file
+#include "kalloc.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// =============================================================================
+// Korelin 垃圾回收器 (KGC)
+//
+// 增量三色标记-清扫回收器:
+//   - 白色: 尚未被访问 (两种白色交替使用, 用于区分"本轮新分配"和"上轮遗留")
+//   - 灰色: 已被访问, 但其引用的对象尚未全部访问
+//   - 黑色: 已被访问, 且其引用的对象均已访问
+//
+// 对象内存由 kalloc 按尺寸类分配, 清扫以页面为单位进行。
+//
+// 标记阶段被切分为有界的增量片, 与脚本执行交替进行; 写屏障保证
+// "黑色对象不会直接指向白色对象" 的不变式。清扫阶段同样是惰性的,
+// 每次分配只推进一小段。增量片的工作量按对象大小加上实际扫描的引用槽数计算;
+// 引用槽很多的大对象 (大数组、大哈希表) 分段扫描, 每段 KGC_SCAN_CHUNK 个槽位,
+// 并改用前向屏障 (把写入的子对象置灰), 避免每次写入都让整个对象被重新扫描。
+// 原子阶段重新扫描根集合后若仍有灰色对象, 先回到增量标记, 最多 KGC_MAX_REMARKS 次
+// 之后才一次排空。
+//
+// 长时间运行的进程中, 当小对象页面的碎片率超过阈值时, 一轮回收结束后会
+// 执行一次整理: 把存活率低的页面中的对象疏散到其他页面, 在原位置留下转发
+// 指针, 再更新根集合、句柄与所有对象中的引用, 最后释放疏散完的页面。
+//
+// 完整回收 (kgc_collect) 与原子阶段可以在多个 GC 工作线程上并行执行:
+// 标记使用可窃取的工作队列 (Chase-Lev deque), 清扫按尺寸类的页面链表划分。
+// 线程数由 KGCConfig.threads 或环境变量 KORELIN_GC_THREADS 指定。
+//
+// kgc_get_stats 返回堆大小、分配速率、回收次数与停顿直方图等统计信息。
+// 开启分配点采样 (KGCConfig.sample_interval 或环境变量 KORELIN_GC_SAMPLE) 后,
+// 平均每分配 sample_interval 字节记录一次当前分配点, 用于定位内存的来源;
+// 未开启时分配路径上只多一次减法和比较。
+//
+// kgc_write_snapshot 把对象图 (对象、类型、大小、引用与根) 以流的方式写入
+// 紧凑的二进制文件, 不在内存中构建整个图; kgc_write_snapshot_async 在 fork
+// 出的子进程中写入写时复制的堆副本, 调用者只停顿 fork 本身的时间。
+//
+// kgc_freeze 把一个堆中的对象全部变为只读的共享对象: 它们永远是黑色, 任何堆的回收器
+// 都不会标记、移动或回收它们, 所以多个线程中的堆可以同时引用同一个冻结堆 (如共享的
+// 常量池) 而无需同步。
+//
+// 共享区 (KGCRegion) 是不属于任何堆的、引用计数的只读对象块, 用于在线程之间传递不可变
+// 的值 (见 libs/kchannel.h)。共享区中的对象同样是黑色的共享对象, 另外带有
+// KGC_FLAG_COUNTED: 堆通过 kgc_hold 登记自己引用的共享区并持有一个引用, 每轮标记时记录
+// 标记到的共享区, 原子阶段结束时释放本轮没有标记到的共享区的引用。
+// =============================================================================
+
+// 对象颜色
+typedef enum {
+    KGC_WHITE0 = 0,
+    KGC_WHITE1 = 1,
+    KGC_GRAY = 2,
+    KGC_BLACK = 3,
+} KGCColor;
+
+// 回收器所处的阶段
+typedef enum {
+    KGC_PHASE_IDLE,     // 空闲, 等待分配量达到阈值
+    KGC_PHASE_MARK,     // 增量标记中
+    KGC_PHASE_SWEEP,    // 惰性清扫中
+} KGCPhase;
+
+// 所有受 GC 管理的对象都必须以 KGCObject 作为第一个成员
+// (对象头的第一个机器字非 0, 满足 kalloc 对已分配单元的约定)
+typedef struct KGCObject {
+    uint32_t size;              // 对象本身占用的字节数 (含对象头)
+    uint16_t type;              // 类型 id, 见 kgc_register_type
+    uint8_t color;              // KGCColor
+    uint8_t flags;              // KGC_FLAG_*
+} KGCObject;
+
+// 对象标志
+#define KGC_FLAG_PINNED 0x01        // 地址被 C 代码持有, 整理时不可移动
+#define KGC_FLAG_FORWARDED 0x02     // 已被疏散, 对象头之后存放新地址
+#define KGC_FLAG_SHARED 0x04        // 属于冻结的堆 (见 kgc_freeze), 只读且永远存活
+#define KGC_FLAG_COUNTED 0x08       // 共享对象属于引用计数的共享区 (见 KGCRegion)
+
+// 已被疏散的对象: 原位置变为转发记录
+typedef struct KGCForward {
+    KGCObject obj;
+    KGCObject* to;
+} KGCForward;
+
+// C 代码持有对象的句柄: 句柄是根, 整理移动对象后会被更新
+typedef struct KGCHandle {
+    KGCObject* object;
+    struct KGCHandle* prev;
+    struct KGCHandle* next;
+} KGCHandle;
+
+typedef struct KGCHeap KGCHeap;
+typedef struct KGCRegion KGCRegion;
+typedef struct KGCHeld KGCHeld;
+typedef struct KGCMarker KGCMarker;
+typedef struct KGCWorkers KGCWorkers;
+
+// 追踪模式
+typedef enum {
+    KGC_TRACE_MARK,             // 标记引用的对象
+    KGC_TRACE_UPDATE,           // 整理: 把指向已疏散对象的引用更新为新地址
+    KGC_TRACE_EDGES,            // 把每个非空引用交给 edge 回调 (堆快照)
+} KGCTraceMode;
+
+// 追踪器: 由回收器传给各类型的 trace 回调
+typedef struct KGCTracer {
+    KGCHeap* heap;
+    KGCMarker* marker;          // 并行标记时为当前工作线程的标记器, 串行标记时为 NULL
+    KGCTraceMode mode;
+    void (*edge)(struct KGCTracer* tracer, KGCObject* child);  // KGC_TRACE_EDGES 模式的回调
+    void* userdata;
+    size_t slots;               // 串行标记时累计访问的引用槽数 (计入增量片的工作量)
+} KGCTracer;
+
+// 类型描述: 每种对象类型注册一次
+typedef struct KGCTypeInfo {
+    const char* name;
+    // 访问对象持有的所有引用 (对每个引用槽调用 kgc_visit_object); 可为 NULL
+    void (*trace)(KGCTracer* tracer, KGCObject* obj);
+    // 对象被回收前调用, 用于释放对象持有的外部内存; 可为 NULL
+    void (*finalize)(KGCHeap* heap, KGCObject* obj);
+    // 返回对象持有的外部内存字节数, 计入堆快照中的对象大小; 可为 NULL
+    size_t (*external_size)(const KGCObject* obj);
+    // 返回对象当前的引用槽数; 可为 NULL。超过 KGC_SCAN_CHUNK 的对象分段扫描并使用前向屏障,
+    // 此时必须同时提供 trace_range
+    size_t (*slot_count)(const KGCObject* obj);
+    // 访问槽位 [begin, end) 中的引用 (end 不超过当前的 slot_count); 可为 NULL。
+    // 分段扫描期间容器内部移动元素 (重新散列、删除时前移) 时, 必须对移动的引用调用写屏障
+    void (*trace_range)(KGCTracer* tracer, KGCObject* obj, size_t begin, size_t end);
+} KGCTypeInfo;
+
+// 根集合回调: 对每个根引用槽调用 kgc_visit_object (必须传入真实的槽位地址, 整理时会就地更新)
+typedef void (*KGCRootFn)(KGCTracer* tracer, void* userdata);
+
+#define KGC_MAX_TYPES 64
+
+// 大对象每段扫描的引用槽数; 槽位更多的对象分段扫描并使用前向屏障
+#define KGC_SCAN_CHUNK 1024
+
+// 原子阶段最多回到增量标记的次数, 之后一次排空灰色栈
+#define KGC_MAX_REMARKS 4
+
+// GC 工作线程数上限
+#define KGC_MAX_THREADS 64
+
+// 停顿直方图的桶数: 第 0 个桶为 1 微秒以内, 第 i 个桶为 [2^(i-1), 2^i) 微秒,
+// 最后一个桶收纳所有更长的停顿
+#define KGC_PAUSE_BUCKETS 24
+
+// 回收器配置
+typedef struct KGCConfig {
+    bool incremental;           // false: 达到阈值时直接执行完整的 STW 回收
+    size_t step_work;           // 每个增量片的工作量预算 (标记/清扫的字节数)
+    uint32_t step_time_us;      // 每个增量片的时间预算 (微秒), 0 表示只按工作量限制
+    int pause_percent;          // 存活字节增长到多少百分比时开始下一轮回收 (如 200)
+    int step_multiplier;        // 每分配 1 字节所需偿还的回收工作量 (百分比)
+    size_t min_threshold;       // 触发回收的最小堆大小 (字节)
+    int threads;                // 并行标记/清扫使用的线程数 (含调用线程), 1 表示串行
+    double compact_threshold;   // 碎片率超过该值时在回收结束后整理, 0 表示不自动整理
+    double compact_page_live;   // 存活率不超过该值的页面会被疏散
+    size_t compact_min_bytes;   // 小对象页面总容量达到该值才考虑自动整理
+    size_t sample_interval;     // 分配点采样的平均间隔 (字节), 0 表示不采样
+} KGCConfig;
+
+// 堆统计信息 (见 kgc_get_stats)
+// 回收器不分代, 所有对象都在同一代中, 因此没有"晋升字节数"
+typedef struct KGCStats {
+    size_t heap_bytes;          // 当前堆占用 (含外部内存与尚未清扫的死对象)
+    size_t external_bytes;      // 其中对象持有的外部内存
+    size_t live_bytes;          // 最近一轮完成的回收之后存活的字节数 (含外部内存)
+    size_t threshold;           // 下一轮回收的触发阈值
+    size_t mapped_bytes;        // 从操作系统映射的字节数
+    size_t large_bytes;         // 大对象占用的字节数
+    double fragmentation;       // 小对象页面的碎片率
+
+    uint64_t total_allocated;   // 累计分配的字节数
+    uint64_t total_objects;     // 累计分配的对象数
+    double alloc_rate;          // 堆创建以来的平均分配速率 (字节/秒)
+    double recent_alloc_rate;   // 最近一轮回收结束以来的分配速率 (字节/秒)
+
+    uint64_t cycles;            // 完成的回收轮数 (增量与完整回收)
+    uint64_t full_collections;  // 其中完整 (STW) 回收的次数
+    uint64_t compactions;       // 整理次数
+    uint64_t bytes_moved;       // 整理累计移动的字节数
+    uint64_t pages_released;    // 累计归还给操作系统的页面数
+
+    uint64_t pause_count;       // 停顿次数 (每个增量片、完整回收或整理算一次)
+    uint64_t pause_total_ns;
+    uint64_t pause_max_ns;
+    uint64_t pause_histogram[KGC_PAUSE_BUCKETS];
+    uint64_t mark_ns;           // 最近一轮完成的回收在标记阶段 (含原子阶段) 的耗时, 不含清扫
+
+    bool has_classes;           // 是否填充了 classes (见 kgc_get_stats 的 per_class 参数)
+    KAllocClassStats classes[KALLOC_CLASS_COUNT + 1];   // 各尺寸类, 最后一项为大对象
+} KGCStats;
+
+// 分配点采样结果 (见 kgc_alloc_sites)
+typedef struct KGCAllocSite {
+    const char* site;           // 分配点, NULL 表示未设置分配点 (如 C 代码中的分配)
+    uint16_t type;              // 对象类型 id
+    const char* type_name;
+    uint64_t samples;           // 采样次数
+    uint64_t bytes;             // 估算的累计分配字节数 (采样次数 × 采样间隔)
+} KGCAllocSite;
+
+typedef struct KGCSiteEntry KGCSiteEntry;
+
+// 堆快照文件格式
+//   头部: 8 字节魔数 KGC_SNAPSHOT_MAGIC, 之后是一系列记录;
+//   每条记录以 1 字节标签开头, 整数均为 LEB128 变长编码;
+//   对象 id 为对象地址右移 4 位 (对象按 16 字节对齐)。
+//
+//   'T' type name_length name             类型名 (在所有对象之前)
+//   'R' kind id                           根引用, kind 见 KGCSnapshotRoot
+//   'O' id type size edge_count edges...  对象, size 含外部内存; 每条边为目标 id
+//                                         与前一个 id (第一条边为对象自身 id) 之差的
+//                                         zig-zag 编码
+//   'E' object_count                      文件结束
+#define KGC_SNAPSHOT_MAGIC "KGCSNAP1"
+
+typedef enum {
+    KGC_SNAPSHOT_ROOT_SOURCE = 0,   // 根集合来源 (VM 栈、全局变量等)
+    KGC_SNAPSHOT_ROOT_TEMP = 1,     // 临时根
+    KGC_SNAPSHOT_ROOT_HANDLE = 2,   // C 句柄
+} KGCSnapshotRoot;
+
+struct KGCHeap {
+    KGCConfig config;
+
+    KAllocator allocator;       // 对象内存 (按尺寸类分页)
+
+    KGCObject** gray;           // 灰色对象栈
+    size_t gray_count;
+    size_t gray_capacity;
+    KGCObject* scan_object;     // 正在分段扫描的大对象 (已是黑色), 没有时为 NULL
+    size_t scan_next;           // 它下一段的起始槽位
+    unsigned remarks;           // 本轮原子阶段回到增量标记的次数
+
+    KGCPhase phase;
+    uint8_t current_white;      // 当前白色 (KGC_WHITE0 或 KGC_WHITE1)
+
+    size_t bytes_allocated;     // 当前堆中 (含尚未清扫的死对象) 占用的字节数, 按单元大小计
+    size_t bytes_external;      // 其中对象持有的外部内存
+    size_t bytes_marked;        // 本轮标记到的存活字节数 (按单元大小计, 与 bytes_allocated 相同)
+    size_t live_bytes;          // 最近一轮完成的回收结束时的存活字节数 (含外部内存)
+    size_t threshold;           // 达到该字节数后开始新一轮回收
+    ptrdiff_t debt;             // 分配债务, 大于 0 时执行一个增量片
+
+    struct {
+        KGCRootFn fn;
+        void* userdata;
+    }* root_sources;            // 根集合来源 (VM 栈、全局变量等)
+    size_t root_source_count;
+
+    KGCObject** temp_roots;     // C 代码持有的临时根
+    size_t temp_root_count;
+    size_t temp_root_capacity;
+
+    KGCHandle* handles;         // C 代码持有的句柄
+
+    bool compact_pending;       // 碎片率超过阈值, 等待在安全点整理
+    size_t compactions;         // 已执行的整理次数
+    size_t bytes_moved;         // 整理累计移动的字节数
+
+    KGCWorkers* workers;        // GC 工作线程池 (首次并行回收时创建)
+
+    // 统计信息 (分配路径上只做计数, 不读时钟)
+    uint64_t total_allocated;
+    uint64_t total_objects;
+    uint64_t cycles;
+    uint64_t full_collections;
+    uint64_t pause_count;
+    uint64_t pause_total_ns;
+    uint64_t pause_max_ns;
+    uint64_t pause_histogram[KGC_PAUSE_BUCKETS];
+    uint64_t cycle_mark_ns;     // 本轮回收至今在标记阶段花费的时间 (各增量片之和)
+    uint64_t mark_ns;           // 最近一轮完成的回收的标记耗时
+    uint64_t created_ns;        // 堆创建时间
+    uint64_t cycle_end_ns;      // 最近一轮回收结束的时间
+    uint64_t cycle_end_allocated;   // 最近一轮回收结束时的 total_allocated
+
+    // 分配点采样: 每分配约 sample_interval 字节采样一次, 记录当时的 alloc_site
+    ptrdiff_t sample_countdown; // 减到负数时采样; 未开启采样时为 PTRDIFF_MAX
+    uint64_t sample_seed;
+    const char* alloc_site;     // 当前分配点, 由 VM 设置 (须在采样结果被读取期间保持有效)
+    KGCSiteEntry* sites;        // 采样结果哈希表 (开放寻址)
+    size_t site_count;
+    size_t site_capacity;
+
+    // 引用的共享区 (见 kgc_hold): 开放寻址表, 每项记录最近一次标记到它的回收轮次
+    KGCHeld* held;
+    size_t held_count;
+    size_t held_capacity;
+    uint32_t held_epoch;        // 每轮标记开始时加一
+};
+
+// --- 函数声明 ---
+
+/**
+ * @brief 注册一个对象类型。所有类型需在创建堆之前注册。
+ * @param id 类型 id (1 ~ KGC_MAX_TYPES-1, 0 保留)。
+ * @param info 类型描述, 必须在程序运行期间保持有效。
+ */
+void kgc_register_type(uint16_t id, const KGCTypeInfo* info);
+
+/**
+ * @brief 使用默认参数填充回收器配置。线程数读取环境变量 KORELIN_GC_THREADS (默认 1)。
+ * @param config 要填充的配置。
+ */
+void kgc_default_config(KGCConfig* config);
+
+/**
+ * @brief 创建一个新的 GC 堆。
+ * @param config 回收器配置, 为 NULL 时使用默认配置。
+ * @return 新建的堆。调用者需要负责调用 kgc_heap_free 释放。
+ */
+KGCHeap* kgc_heap_new(const KGCConfig* config);
+
+/**
+ * @brief 释放堆以及堆中所有对象。
+ * @param heap 要释放的堆。
+ */
+void kgc_heap_free(KGCHeap* heap);
+
+/**
+ * @brief 注册一个根集合来源, 每轮标记开始和结束时都会调用。
+ * @param heap 堆。
+ * @param fn 根集合回调。
+ * @param userdata 传给回调的用户数据。
+ */
+void kgc_add_root_source(KGCHeap* heap, KGCRootFn fn, void* userdata);
+
+/**
+ * @brief 分配一个新的 GC 对象, 必要时先推进一个增量片。
+ * @param heap 堆。
+ * @param type 已注册的类型 id。
+ * @param size 对象大小 (字节, 含 KGCObject 对象头)。
+ * @return 新对象, 对象头之后的内存未初始化。
+ */
+KGCObject* kgc_alloc(KGCHeap* heap, uint16_t type, size_t size);
+
+/**
+ * @brief 记录对象持有的外部内存 (如数组的元素缓冲区) 的变化, 用于回收节奏控制。
+ * @param heap 堆。
+ * @param delta 增加 (正数) 或减少 (负数) 的字节数。
+ */
+void kgc_account_external(KGCHeap* heap, ptrdiff_t delta);
+
+/**
+ * @brief 在追踪回调中访问一个引用槽。
+ * @param tracer 追踪器。
+ * @param slot 指向对象引用的指针, *slot 可以为 NULL。
+ */
+void kgc_visit_object(KGCTracer* tracer, KGCObject** slot);
+
+/**
+ * @brief 执行一个有界的增量片 (受 step_work 和 step_time_us 限制)。
+ * @param heap 堆。
+ * @return 本轮回收是否已经结束 (回到空闲阶段)。
+ */
+bool kgc_step(KGCHeap* heap);
+
+/**
+ * @brief 执行一次完整的回收 (STW), 会先完成正在进行中的增量回收。
+ *        threads 大于 1 时标记与清扫在工作线程上并行执行。
+ * @param heap 堆。
+ */
+void kgc_collect(KGCHeap* heap);
+
+/**
+ * @brief 写屏障的慢路径, 请使用 kgc_write_barrier。
+ */
+void kgc_barrier_slow(KGCHeap* heap, KGCObject* parent, const KGCObject* child);
+
+/**
+ * @brief 写屏障: 在把 child 的引用写入 parent 之后调用。
+ *        标记阶段中若黑色的 parent 指向了白色的 child (或共享区中的对象), 则把 parent 重新置灰
+ *        (后向屏障); parent 是分段扫描的大对象时改为把 child 置灰 (前向屏障)。
+ */
+static inline void kgc_write_barrier(KGCHeap* heap, KGCObject* parent, const KGCObject* child) {
+    // 共享区的对象总是黑色, 但同样需要在本轮被标记到, 否则共享区的引用会被提前释放
+    if (child && parent->color == KGC_BLACK &&
+        (child->color <= KGC_WHITE1 || (child->flags & KGC_FLAG_COUNTED)) && heap->phase == KGC_PHASE_MARK) {
+        kgc_barrier_slow(heap, parent, child);
+    }
+}
+
+/**
+ * @brief 把对象压入临时根栈, 防止 C 代码持有的中间结果被回收。
+ * @param heap 堆。
+ * @param obj 要保护的对象。
+ */
+void kgc_push_root(KGCHeap* heap, KGCObject* obj);
+
+/**
+ * @brief 弹出临时根栈顶部的 count 个对象。
+ * @param heap 堆。
+ * @param count 要弹出的数量。
+ */
+void kgc_pop_roots(KGCHeap* heap, size_t count);
+
+/**
+ * @brief 固定对象, 使其在整理时不会被移动 (用于地址被 C 代码长期持有的对象)。
+ */
+static inline void kgc_pin(KGCObject* obj) {
+    // 共享对象已经固定, 不能再写入 (其他线程可能同时读取)
+    if (!(obj->flags & KGC_FLAG_PINNED)) obj->flags |= KGC_FLAG_PINNED;
+}
+
+/**
+ * @brief 创建一个持有对象的句柄。句柄是根, 对象被移动后 handle->object 会被更新。
+ * @param heap 堆。
+ * @param obj 要持有的对象。
+ * @return 新的句柄, 需要调用 kgc_handle_free 释放。
+ */
+KGCHandle* kgc_handle_new(KGCHeap* heap, KGCObject* obj);
+
+/**
+ * @brief 释放句柄。
+ * @param heap 堆。
+ * @param handle 要释放的句柄。
+ */
+void kgc_handle_free(KGCHeap* heap, KGCHandle* handle);
+
+/**
+ * @brief 冻结堆: 其中的所有对象变为共享对象 (黑色、固定并带有 KGC_FLAG_SHARED)。
+ *        其他堆中的对象可以引用共享对象, 它们的回收器只读取共享对象的对象头。
+ *        冻结后不能再在该堆中分配或回收, 对象的内容也不能再修改; 堆必须在所有引用它的
+ *        堆之后用 kgc_heap_free 释放。
+ * @param heap 堆, 必须处于空闲阶段。
+ */
+void kgc_freeze(KGCHeap* heap);
+
+/**
+ * @brief 创建空的共享区, 调用者持有一个引用。
+ */
+KGCRegion* kgc_region_new(void);
+
+/**
+ * @brief 在共享区中分配一个对象。对象头已初始化为黑色的共享对象
+ *        (KGC_FLAG_PINNED | KGC_FLAG_SHARED | KGC_FLAG_COUNTED), 之后的内存未初始化。
+ *        共享区释放时不调用终结器: 对象需要的外部内存应当用 kgc_region_bytes 分配。
+ *        共享区被其他线程看到之前只能由创建它的线程分配和写入, 之后只读。
+ */
+KGCObject* kgc_region_alloc(KGCRegion* region, uint16_t type, size_t size);
+
+/**
+ * @brief 在共享区中分配 size 字节的缓冲区 (16 字节对齐), 随共享区一起释放。
+ */
+void* kgc_region_bytes(KGCRegion* region, size_t size);
+
+/**
+ * @brief 共享区占用的字节数。
+ */
+size_t kgc_region_size(const KGCRegion* region);
+
+/**
+ * @brief 增加或释放共享区的一个引用 (可以在任何线程中调用), 最后一个引用释放时销毁共享区。
+ */
+void kgc_region_retain(KGCRegion* region);
+void kgc_region_release(KGCRegion* region);
+
+/**
+ * @brief 共享区中的对象 (带有 KGC_FLAG_COUNTED) 所属的共享区。
+ */
+KGCRegion* kgc_region_of(const KGCObject* obj);
+
+/**
+ * @brief 登记堆开始引用共享区中的对象 obj: 堆持有共享区的一个引用, 直到某轮回收结束时
+ *        堆中不再有指向该共享区的引用。共享区的大小计入堆的外部内存。
+ *        与 kgc_alloc 一样可能先推进回收 (调用者此时持有的新对象须已登记为根);
+ *        调用者必须在下一次分配之前让 obj 可达 (如放到虚拟机栈上或写入带屏障的容器)。
+ */
+void kgc_hold(KGCHeap* heap, KGCObject* obj);
+
+/**
+ * @brief 返回小对象页面的碎片率: 1 - 存活字节数 / 页面容量。
+ * @param heap 堆。
+ */
+double kgc_fragmentation(KGCHeap* heap);
+
+/**
+ * @brief 执行一次完整回收并整理堆, 不论当前碎片率是多少。
+ *        调用者必须保证没有 C 局部变量持有未登记为根或句柄的对象指针。
+ * @param heap 堆。
+ * @return 释放的页面数。
+ */
+size_t kgc_compact(KGCHeap* heap);
+
+/**
+ * @brief 安全点: 若上一轮回收判定需要整理, 则在此处执行。
+ *        由 VM 在不持有裸对象指针的位置 (如语句之间) 调用。
+ * @param heap 堆。
+ */
+void kgc_safepoint(KGCHeap* heap);
+
+/**
+ * @brief 获取堆的统计信息。
+ * @param heap 堆。
+ * @param stats 输出统计信息。
+ * @param per_class 是否统计各尺寸类的使用情况 (需要扫描所有页面, 开销与堆大小成正比)。
+ */
+void kgc_get_stats(KGCHeap* heap, KGCStats* stats, bool per_class);
+
+/**
+ * @brief 开启或关闭分配点采样。关闭采样不会清除已有的采样结果。
+ * @param heap 堆。
+ * @param interval 平均采样间隔 (字节), 0 表示关闭。
+ */
+void kgc_set_sampling(KGCHeap* heap, size_t interval);
+
+/**
+ * @brief 设置当前分配点, 之后被采样到的分配都记在该分配点名下。
+ * @param heap 堆。
+ * @param site 分配点描述 (如 "main.kri:12"), 按指针区分; NULL 表示未知分配点。
+ */
+static inline void kgc_set_alloc_site(KGCHeap* heap, const char* site) {
+    heap->alloc_site = site;
+}
+
+/**
+ * @brief 读取分配点采样结果, 按估算字节数从大到小排序。
+ * @param heap 堆。
+ * @param sites 输出数组, 可为 NULL。
+ * @param max sites 的容量。
+ * @return 采样到的分配点总数 (可能大于 max)。
+ */
+size_t kgc_alloc_sites(KGCHeap* heap, KGCAllocSite* sites, size_t max);
+
+/**
+ * @brief 清除所有分配点采样结果。
+ * @param heap 堆。
+ */
+void kgc_reset_alloc_sites(KGCHeap* heap);
+
+/**
+ * @brief 把堆快照以流的方式写入文件 (在写入期间停顿)。
+ *        进行中的回收不受影响: 尚未清扫的死对象也会被写入, 分析时它们不可达。
+ * @param heap 堆。
+ * @param path 输出文件路径。
+ * @return 写入成功返回 true。
+ */
+bool kgc_write_snapshot(KGCHeap* heap, const char* path);
+
+/**
+ * @brief 在 fork 出的子进程中写入堆快照, 调用者立即返回继续执行。
+ *        子进程看到的是 fork 时刻写时复制的堆, 因此快照是一致的。
+ * @param heap 堆。
+ * @param path 输出文件路径。
+ * @return 子进程 pid, 失败时返回 -1。需要调用 kgc_snapshot_wait 回收子进程。
+ */
+pid_t kgc_write_snapshot_async(KGCHeap* heap, const char* path);
+
+/**
+ * @brief 等待后台快照写入结束。
+ * @param pid kgc_write_snapshot_async 返回的 pid。
+ * @return 写入成功返回 true。
+ */
+bool kgc_snapshot_wait(pid_t pid);
+
+#endif //KORELIN_KGC_H
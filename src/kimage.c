@@ -0,0 +1,1037 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#define _GNU_SOURCE
+
+#include "kimage.h"
+#include "kbigint.h"
+#include "kric.h"
+#include "kstruct.h"
+#include "libs/kchannel.h"
+#include "libs/kmap.h"
+#include "libs/kpersist.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 写入与恢复的最大嵌套深度, 更深的值不能写入镜像
+#define KIMAGE_MAX_DEPTH 4096
+
+// 字节序标记: 载入时按原生字节序读出的值不同说明镜像来自另一种平台
+#define KIMAGE_BYTE_ORDER 0x0102030405060708ull
+
+// 格式版本: 镜像的编码方式改变时递增
+#define KIMAGE_VERSION 2
+
+// 构建标识: 镜像只能由写入它的同一次构建载入 (字节码与对象布局在构建之间可能改变)。
+// 默认取本文件的编译时间, 字节码格式与对象布局所在的头文件改变时本文件都会重新编译;
+// 可以在编译时用 -DKORELIN_BUILD_ID="..." 指定
+#ifndef KORELIN_BUILD_ID
+#define KORELIN_BUILD_ID __DATE__ " " __TIME__
+#endif
+
+// 文件头: 魔数、字节序标记、格式版本、构建标识的哈希、对象数、内容的校验和
+#define KIMAGE_HEADER_SIZE 48
+
+// =============================================================================
+// 镜像的格式
+//
+// 整数与长度都是原生字节序的 8 字节, 字符串是长度加内容。校验和覆盖对象数与文件头
+// 之后的全部内容。载入时先比较构建标识与校验和, 再检查字节码 (kric_module_verify)。
+// 文件头之后依次是:
+//   编译单元: 文件名; 各原型的名字、分配点、参数个数、字节码、行号、常量、内联缓存数与
+//            栈深度; 顶层代码的原型下标; 全局变量的名字与是否绑定原生函数; 结构体类型
+//            的名字与字段 (嵌套的结构体类型写为下标)
+//   状态: 全局变量的值; 栈中的值; 下一条指令在顶层代码中的偏移
+// 每个值以 1 字节标签开头, 对象按第一次出现的顺序编号, 再次出现时只写编号 (TAG_REF)。
+// 容器在内容之前编号, 所以循环引用总是指向已经创建的对象。
+// =============================================================================
+
+enum {
+    TAG_NULL,
+    TAG_FALSE,
+    TAG_TRUE,
+    TAG_INT,
+    TAG_DOUBLE,
+    TAG_REF,            // 编号
+    TAG_CONSTANT,       // 程序中的常量: 原型下标 << 32 | 常量下标
+    TAG_NATIVE,         // 原生函数名
+    TAG_FROZEN,         // 冻结的值: 随后是它的内容 (占用下一个编号), 恢复时再冻结
+    TAG_STRING,         // 编码方式、长度、内容
+    TAG_BIGINT,         // 符号、limb 个数、limbs
+    TAG_ARRAY,          // 元素形式、个数, 然后是原始数值或逐个写入的元素
+    TAG_TYPED_ARRAY,    // 元素形式、个数、原始数值
+    TAG_STRUCT,         // 类型下标、数据 (引用处为 0), 然后是各个字符串引用
+    TAG_STRUCT_ARRAY,   // 类型下标、个数、所有元素的数据, 然后是各元素的字符串引用
+    TAG_FUNCTION,       // 原型下标、已创建的嵌套函数的个数, 然后是 (常量下标, 函数) 对
+    TAG_MAP,            // 个数, 然后是键、值交替
+    TAG_PMAP,           // 个数, 然后是键、值交替
+    TAG_PVECTOR,        // 个数, 然后是元素
+    TAG_BUILDER,        // 长度、内容
+};
+
+// 辅助函数：按 8 字节为单位的乘法哈希, 用于构建标识与内容的校验和
+static uint64_t image_hash(const void* data, size_t length, uint64_t seed) {
+    const uint8_t* bytes = data;
+    uint64_t h = seed ^ 0xCBF29CE484222325ull ^ length;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        h = (h ^ word) * 0x100000001B3ull;
+        h ^= h >> 29;
+    }
+    for (; i < length; i++) {
+        h = (h ^ bytes[i]) * 0x100000001B3ull;
+    }
+    h ^= h >> 32;
+    return h * 0x9E3779B97F4A7C15ull;
+}
+
+static uint64_t build_hash(void) {
+    static const char build_id[] = KORELIN_BUILD_ID;
+    return image_hash(build_id, sizeof(build_id) - 1, KIMAGE_VERSION);
+}
+
+// =============================================================================
+// 地址表: 写入时记录已出现的对象与程序中的常量
+// =============================================================================
+
+typedef struct ImageEntry {
+    const void* key;            // NULL 表示空槽
+    uint64_t value;
+} ImageEntry;
+
+typedef struct ImageMap {
+    ImageEntry* entries;
+    size_t count;
+    size_t capacity;            // 0 或 2 的幂
+} ImageMap;
+
+static size_t map_start(const void* key, size_t mask) {
+    return (size_t)(((uintptr_t)key >> 4) * 0x9E3779B97F4A7C15ull >> 32) & mask;
+}
+
+static ImageEntry* map_find(const ImageMap* map, const void* key) {
+    if (map->capacity == 0) return NULL;
+    size_t mask = map->capacity - 1;
+    for (size_t index = map_start(key, mask);; index = (index + 1) & mask) {
+        ImageEntry* entry = &map->entries[index];
+        if (entry->key == key) return entry;
+        if (!entry->key) return NULL;
+    }
+}
+
+static void map_insert(ImageMap* map, const void* key, uint64_t value) {
+    if ((map->count + 1) * 2 > map->capacity) {
+        ImageEntry* old = map->entries;
+        size_t old_capacity = map->capacity;
+        map->capacity = old_capacity ? old_capacity * 2 : 64;
+        map->entries = calloc(map->capacity, sizeof(ImageEntry));
+        if (!map->entries) {
+            fprintf(stderr, "Error: calloc failed in map_insert\n");
+            exit(EXIT_FAILURE);
+        }
+        map->count = 0;
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old[i].key) map_insert(map, old[i].key, old[i].value);
+        }
+        free(old);
+    }
+    size_t mask = map->capacity - 1;
+    size_t index = map_start(key, mask);
+    while (map->entries[index].key) index = (index + 1) & mask;
+    map->entries[index] = (ImageEntry){key, value};
+    map->count++;
+}
+
+// 辅助函数：结构体类型在编译单元中的下标, 不属于它时返回 SIZE_MAX
+static size_t struct_index(const KModule* module, const KStructType* type) {
+    for (size_t i = 0; i < module->struct_count; i++) {
+        if (module->structs[i] == type) return i;
+    }
+    return SIZE_MAX;
+}
+
+// =============================================================================
+// 写入
+// =============================================================================
+
+typedef struct Writer {
+    KorelinVM* vm;
+    uint8_t* data;
+    size_t length;
+    size_t capacity;
+    uint64_t object_count;
+    ImageMap seen;              // 已写入的对象 -> 编号
+    ImageMap constants;         // 程序中的常量对象 -> 原型下标 << 32 | 常量下标
+} Writer;
+
+static void emit(Writer* w, const void* bytes, size_t size) {
+    if (w->length + size > w->capacity) {
+        size_t capacity = w->capacity ? w->capacity * 2 : 4096;
+        while (capacity < w->length + size) capacity *= 2;
+        uint8_t* data = realloc(w->data, capacity);
+        if (!data) {
+            fprintf(stderr, "Error: realloc failed in emit\n");
+            exit(EXIT_FAILURE);
+        }
+        w->data = data;
+        w->capacity = capacity;
+    }
+    if (size) memcpy(w->data + w->length, bytes, size);
+    w->length += size;
+}
+
+static void emit_u8(Writer* w, uint8_t value) {
+    emit(w, &value, 1);
+}
+
+static void emit_u64(Writer* w, uint64_t value) {
+    emit(w, &value, sizeof(value));
+}
+
+static void emit_string(Writer* w, const char* chars, size_t length) {
+    emit_u64(w, length);
+    emit(w, chars, length);
+}
+
+static void emit_name(Writer* w, const char* name) {
+    if (!name) name = "";
+    emit_string(w, name, strlen(name));
+}
+
+static void write_module(Writer* w, const KModule* module) {
+    emit_name(w, module->name);
+    emit_u64(w, module->proto_count);
+    for (size_t i = 0; i < module->proto_count; i++) {
+        const KProto* proto = module->protos[i];
+        emit_name(w, proto->name);
+        emit_name(w, proto->site);
+        emit_u64(w, (uint64_t)(int64_t)proto->arity);
+        emit_u64(w, proto->code_count);
+        emit(w, proto->code, proto->code_count);
+        emit(w, proto->lines, proto->code_count * sizeof(int));
+        emit_u64(w, proto->cache_count);
+        emit_u64(w, proto->max_stack);
+        emit_u64(w, proto->constant_count);
+        for (size_t j = 0; j < proto->constant_count; j++) {
+            const KConstant* constant = &proto->constants[j];
+            emit_u8(w, (uint8_t)constant->kind);
+            switch (constant->kind) {
+                case KCONST_INT:
+                    emit_u64(w, (uint64_t)constant->as.integer);
+                    break;
+                case KCONST_DOUBLE:
+                    emit(w, &constant->as.number, sizeof(double));
+                    break;
+                case KCONST_FUNCTION:
+                    emit_u64(w, constant->as.proto->index);
+                    break;
+                case KCONST_STRING:
+                case KCONST_PATH:
+                case KCONST_BIGINT:
+                    emit_string(w, constant->as.string.chars, constant->as.string.length);
+                    break;
+            }
+        }
+    }
+    emit_u64(w, module->main->index);
+    emit_u64(w, module->global_count);
+    for (size_t i = 0; i < module->global_count; i++) {
+        emit_name(w, module->globals[i]);
+        emit_u8(w, module->global_natives[i] ? 1 : 0);
+    }
+    emit_u64(w, module->struct_count);
+    for (size_t i = 0; i < module->struct_count; i++) {
+        const KStructType* type = module->structs[i];
+        emit_name(w, type->name);
+        emit_u64(w, type->field_count);
+        for (size_t j = 0; j < type->field_count; j++) {
+            const KStructField* field = &type->fields[j];
+            emit_name(w, field->name);
+            emit_u8(w, (uint8_t)field->kind);
+            emit_u64(w, field->struct_type ? struct_index(module, field->struct_type) : UINT64_MAX);
+        }
+    }
+}
+
+static bool write_value(Writer* w, KValue value, int depth);
+
+// 辅助函数：写入 count 个连续的结构体值: 先是数据 (引用处清零), 再逐个写入引用的字符串
+static bool write_struct_data(Writer* w, const KStructType* type, const unsigned char* data, size_t count,
+                              int depth) {
+    size_t start = w->length;
+    emit(w, data, count * type->size);
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = 0; j < type->ref_count; j++) {
+            memset(w->data + start + i * type->size + type->ref_offsets[j], 0, sizeof(KGCObject*));
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = 0; j < type->ref_count; j++) {
+            KGCObject* ref;
+            memcpy(&ref, data + i * type->size + type->ref_offsets[j], sizeof(ref));
+            if (!write_value(w, ref ? KVALUE_OBJECT(ref) : KVALUE_NULL, depth + 1)) return false;
+        }
+    }
+    return true;
+}
+
+// 辅助函数：写入对象的内容 (标签与数据), 对象不能写入镜像时返回 false
+static bool write_body(Writer* w, KGCObject* obj, int depth) {
+    const KModule* module = w->vm->module;
+    switch (obj->type) {
+        case KOBJ_STRING: {
+            const KString* str = (const KString*)obj;
+            emit_u8(w, TAG_STRING);
+            emit_u8(w, str->encoding);
+            emit_string(w, str->chars, str->length);
+            return true;
+        }
+        case KOBJ_BIGINT: {
+            const KBigInt* big = (const KBigInt*)obj;
+            emit_u8(w, TAG_BIGINT);
+            emit_u8(w, big->negative ? 1 : 0);
+            emit_u64(w, big->length);
+            emit(w, big->limbs, big->length * sizeof(uint64_t));
+            return true;
+        }
+        case KOBJ_ARRAY:
+        case KOBJ_TYPED_ARRAY: {
+            const KArray* array = (const KArray*)obj;
+            emit_u8(w, obj->type == KOBJ_ARRAY ? TAG_ARRAY : TAG_TYPED_ARRAY);
+            emit_u8(w, (uint8_t)array->kind);
+            emit_u64(w, array->count);
+            if (array->kind != KELEM_VALUE) {
+                emit(w, array->items.data, array->count * kelement_size(array->kind));
+                return true;
+            }
+            for (size_t i = 0; i < array->count; i++) {
+                if (!write_value(w, array->items.values[i], depth + 1)) return false;
+            }
+            return true;
+        }
+        case KOBJ_STRUCT: {
+            const KStruct* value = (const KStruct*)obj;
+            size_t index = struct_index(module, value->type);
+            if (index == SIZE_MAX) return false;
+            emit_u8(w, TAG_STRUCT);
+            emit_u64(w, index);
+            return write_struct_data(w, value->type, value->data, 1, depth);
+        }
+        case KOBJ_STRUCT_ARRAY: {
+            const KStructArray* array = (const KStructArray*)obj;
+            size_t index = struct_index(module, array->type);
+            if (index == SIZE_MAX) return false;
+            emit_u8(w, TAG_STRUCT_ARRAY);
+            emit_u64(w, index);
+            emit_u64(w, array->count);
+            return write_struct_data(w, array->type, array->data, array->count, depth);
+        }
+        case KOBJ_FUNCTION: {
+            const KFunction* fn = (const KFunction*)obj;
+            // 其他程序 (之前的 kvm_run) 的函数不在镜像的编译单元中
+            if (fn->program != w->vm->program) return false;
+            emit_u8(w, TAG_FUNCTION);
+            emit_u64(w, fn->proto->index);
+            size_t count = 0;
+            for (size_t i = 0; fn->functions && i < fn->proto->constant_count; i++) {
+                if (fn->functions[i]) count++;
+            }
+            emit_u64(w, count);
+            for (size_t i = 0; fn->functions && i < fn->proto->constant_count; i++) {
+                if (!fn->functions[i]) continue;
+                emit_u64(w, i);
+                if (!write_value(w, KVALUE_OBJECT(fn->functions[i]), depth + 1)) return false;
+            }
+            return true;
+        }
+        case KOBJ_MAP: {
+            const KMap* map = (const KMap*)obj;
+            emit_u8(w, TAG_MAP);
+            emit_u64(w, map->count);
+            size_t cursor = 0;
+            KValue key, item;
+            while (kmap_next(map, &cursor, &key, &item)) {
+                if (!write_value(w, key, depth + 1) || !write_value(w, item, depth + 1)) return false;
+            }
+            return true;
+        }
+        case KOBJ_PMAP: {
+            const KPMap* map = (const KPMap*)obj;
+            emit_u8(w, TAG_PMAP);
+            emit_u64(w, map->count);
+            KPMapIter iter;
+            KValue key, item;
+            kpmap_iter_init(map, &iter);
+            while (kpmap_iter_next(&iter, &key, &item)) {
+                if (!write_value(w, key, depth + 1) || !write_value(w, item, depth + 1)) return false;
+            }
+            return true;
+        }
+        case KOBJ_PVECTOR: {
+            const KPVector* vector = (const KPVector*)obj;
+            emit_u8(w, TAG_PVECTOR);
+            emit_u64(w, vector->count);
+            for (size_t i = 0; i < vector->count; i++) {
+                if (!write_value(w, kpvector_get(vector, i), depth + 1)) return false;
+            }
+            return true;
+        }
+        case KOBJ_STRING_BUILDER: {
+            const KStringBuilder* builder = (const KStringBuilder*)obj;
+            emit_u8(w, TAG_BUILDER);
+            emit_string(w, builder->data, builder->length);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+static bool write_object(Writer* w, KValue value, int depth) {
+    if (depth > KIMAGE_MAX_DEPTH) return false;
+    if (value.as.object->type == KOBJ_ROPE) {
+        value = KVALUE_OBJECT(kstring_flatten(w->vm->heap, value));
+    }
+    KGCObject* obj = value.as.object;
+    if (obj->type == KOBJ_NATIVE) {
+        emit_u8(w, TAG_NATIVE);
+        emit_name(w, ((const KNative*)obj)->native->name);
+        return true;
+    }
+    bool frozen = (obj->flags & KGC_FLAG_COUNTED) != 0;
+    if ((obj->flags & KGC_FLAG_SHARED) && !frozen) {
+        ImageEntry* entry = map_find(&w->constants, obj);
+        if (!entry) return false;
+        emit_u8(w, TAG_CONSTANT);
+        emit_u64(w, entry->value);
+        return true;
+    }
+
+    ImageEntry* entry = map_find(&w->seen, obj);
+    if (entry) {
+        emit_u8(w, TAG_REF);
+        emit_u64(w, entry->value);
+        return true;
+    }
+    map_insert(&w->seen, obj, w->object_count++);
+    if (frozen) {
+        // 内容在恢复时先作为普通对象重建, 占用下一个编号
+        emit_u8(w, TAG_FROZEN);
+        w->object_count++;
+    }
+    return write_body(w, obj, depth);
+}
+
+static bool write_value(Writer* w, KValue value, int depth) {
+    switch (value.type) {
+        case KVAL_NULL: emit_u8(w, TAG_NULL); return true;
+        case KVAL_BOOL: emit_u8(w, value.as.boolean ? TAG_TRUE : TAG_FALSE); return true;
+        case KVAL_INT:
+            emit_u8(w, TAG_INT);
+            emit_u64(w, (uint64_t)value.as.integer);
+            return true;
+        case KVAL_DOUBLE:
+            emit_u8(w, TAG_DOUBLE);
+            emit(w, &value.as.number, sizeof(double));
+            return true;
+        case KVAL_OBJECT:
+            return write_object(w, value, depth);
+    }
+    return false;
+}
+
+bool kimage_write(KorelinVM* vm, const char* path, size_t stack_count) {
+    const KModule* module = vm->module;
+    const KProgram* program = vm->program;
+    Writer w = {.vm = vm};
+    for (size_t i = 0; i < module->proto_count; i++) {
+        for (size_t j = 0; j < module->protos[i]->constant_count; j++) {
+            KValue constant = program->constants[i][j];
+            if (constant.type != KVAL_OBJECT || map_find(&w.constants, constant.as.object)) continue;
+            map_insert(&w.constants, constant.as.object, (uint64_t)i << 32 | j);
+        }
+    }
+
+    emit(&w, KIMAGE_MAGIC, 8);
+    emit_u64(&w, KIMAGE_BYTE_ORDER);
+    emit_u64(&w, KIMAGE_VERSION);
+    emit_u64(&w, build_hash());
+    emit_u64(&w, 0);
+    emit_u64(&w, 0);
+    write_module(&w, module);
+    bool ok = true;
+    for (size_t i = 0; ok && i < vm->global_count; i++) {
+        ok = write_value(&w, kvm_get_global(vm, i), 0);
+    }
+    emit_u64(&w, stack_count);
+    for (size_t i = 0; ok && i < stack_count; i++) {
+        ok = write_value(&w, vm->stack[i], 0);
+    }
+    emit_u64(&w, (uint64_t)(vm->frames[0].ip - module->main->code));
+    uint64_t object_count = w.object_count;
+    uint64_t checksum = image_hash(w.data + KIMAGE_HEADER_SIZE, w.length - KIMAGE_HEADER_SIZE, object_count);
+    memcpy(w.data + 32, &object_count, sizeof(uint64_t));
+    memcpy(w.data + 40, &checksum, sizeof(uint64_t));
+
+    if (ok) {
+        FILE* file = fopen(path, "wb");
+        ok = file && fwrite(w.data, 1, w.length, file) == w.length;
+        if (file && fclose(file) != 0) ok = false;
+    }
+    free(w.seen.entries);
+    free(w.constants.entries);
+    free(w.data);
+    return ok;
+}
+
+// =============================================================================
+// 载入
+// =============================================================================
+
+typedef struct Reader {
+    const uint8_t* data;        // 映射的文件
+    size_t length;
+    size_t pos;
+    bool failed;                // 文件被截断或内容无效, 之后的读取都返回 0
+    KorelinVM* vm;
+    KGCObject** objects;        // 按编号排列的已创建对象
+    size_t object_count;
+    size_t object_capacity;     // 文件头中的对象数
+} Reader;
+
+// 辅助函数：取出 size 个字节, 超出文件时标记失败并返回 NULL
+static const uint8_t* take(Reader* r, size_t size) {
+    if (r->failed || size > r->length - r->pos) {
+        r->failed = true;
+        return NULL;
+    }
+    const uint8_t* bytes = r->data + r->pos;
+    r->pos += size;
+    return bytes;
+}
+
+static uint8_t read_u8(Reader* r) {
+    const uint8_t* bytes = take(r, 1);
+    return bytes ? bytes[0] : 0;
+}
+
+static uint64_t read_u64(Reader* r) {
+    uint64_t value = 0;
+    const uint8_t* bytes = take(r, sizeof(value));
+    if (bytes) memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+// 辅助函数：读取个数, 剩余的字节不足以容纳 count 个至少 unit 字节的元素时标记失败
+static size_t read_count(Reader* r, size_t unit) {
+    uint64_t count = read_u64(r);
+    if (count > (r->length - r->pos) / unit) {
+        r->failed = true;
+        return 0;
+    }
+    return (size_t)count;
+}
+
+// 辅助函数：读取字符串并复制为以 '\0' 结尾的新缓冲区, 失败时返回 NULL
+static char* read_string(Reader* r, size_t* length) {
+    size_t count = read_count(r, 1);
+    const uint8_t* bytes = take(r, count);
+    if (!bytes) return NULL;
+    char* chars = malloc(count + 1);
+    if (!chars) {
+        fprintf(stderr, "Error: malloc failed in read_string\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(chars, bytes, count);
+    chars[count] = '\0';
+    if (length) *length = count;
+    return chars;
+}
+
+// 辅助函数：分配 count 个元素的数组 (至少 1 个), 内容为零
+static void* alloc_array(size_t count, size_t size) {
+    void* array = calloc(count ? count : 1, size);
+    if (!array) {
+        fprintf(stderr, "Error: calloc failed in alloc_array\n");
+        exit(EXIT_FAILURE);
+    }
+    return array;
+}
+
+static bool read_proto(Reader* r, KModule* module, KProto* proto) {
+    proto->name = read_string(r, NULL);
+    proto->site = read_string(r, NULL);
+    proto->arity = (int)(int64_t)read_u64(r);
+    size_t code_count = read_count(r, 1 + sizeof(int));
+    proto->code = alloc_array(code_count, 1);
+    proto->lines = alloc_array(code_count, sizeof(int));
+    proto->code_count = code_count;
+    proto->code_capacity = code_count;
+    const uint8_t* code = take(r, code_count);
+    const uint8_t* lines = take(r, code_count * sizeof(int));
+    if (!code || !lines) return false;
+    memcpy(proto->code, code, code_count);
+    memcpy(proto->lines, lines, code_count * sizeof(int));
+    proto->cache_count = (size_t)read_u64(r);
+    proto->max_stack = (size_t)read_u64(r);
+
+    size_t constant_count = read_count(r, 1);
+    proto->constants = alloc_array(constant_count, sizeof(KConstant));
+    proto->constant_capacity = constant_count;
+    // 逐个计数, 失败时 kric_module_free 只释放已读入的常量
+    for (size_t i = 0; i < constant_count && !r->failed; i++) {
+        KConstant* constant = &proto->constants[i];
+        constant->kind = (KConstantKind)read_u8(r);
+        switch (constant->kind) {
+            case KCONST_INT:
+                constant->as.integer = (long long)read_u64(r);
+                break;
+            case KCONST_DOUBLE: {
+                const uint8_t* bytes = take(r, sizeof(double));
+                if (bytes) memcpy(&constant->as.number, bytes, sizeof(double));
+                break;
+            }
+            case KCONST_FUNCTION: {
+                uint64_t index = read_u64(r);
+                if (index >= module->proto_count) return false;
+                constant->as.proto = module->protos[index];
+                break;
+            }
+            case KCONST_STRING:
+            case KCONST_PATH:
+            case KCONST_BIGINT:
+                constant->as.string.chars = read_string(r, &constant->as.string.length);
+                if (!constant->as.string.chars) return false;
+                break;
+            default:
+                return false;
+        }
+        proto->constant_count = i + 1;
+    }
+    return !r->failed;
+}
+
+static bool read_struct(Reader* r, KModule* module, size_t index) {
+    char* name = read_string(r, NULL);
+    if (!name) return false;
+    KStructType* type = kstruct_type_new(name);
+    free(name);
+    module->structs[index] = type;
+    module->struct_count = index + 1;
+    size_t field_count = read_count(r, 1);
+    for (size_t i = 0; i < field_count; i++) {
+        char* field_name = read_string(r, NULL);
+        KFieldKind kind = (KFieldKind)read_u8(r);
+        uint64_t struct_type = read_u64(r);
+        // 嵌套的结构体类型总是先于外层声明
+        bool valid = field_name && kind <= KFIELD_STRUCT &&
+                     (kind == KFIELD_STRUCT ? struct_type < index : struct_type == UINT64_MAX);
+        valid = valid && kstruct_type_add_field(type, field_name, kind,
+                                                kind == KFIELD_STRUCT ? module->structs[struct_type] : NULL);
+        free(field_name);
+        if (!valid) return false;
+    }
+    kstruct_type_finish(type);
+    return !r->failed;
+}
+
+// 辅助函数：重建编译单元, 镜像无效时返回 NULL
+static KModule* read_module(Reader* r) {
+    KModule* module = calloc(1, sizeof(KModule));
+    if (!module) {
+        fprintf(stderr, "Error: calloc failed in read_module\n");
+        exit(EXIT_FAILURE);
+    }
+    module->name = read_string(r, NULL);
+    // 先创建所有原型, 函数常量按下标引用它们
+    size_t proto_count = read_count(r, 1);
+    module->protos = alloc_array(proto_count, sizeof(KProto*));
+    for (size_t i = 0; i < proto_count; i++) {
+        module->protos[i] = alloc_array(1, sizeof(KProto));
+        module->protos[i]->index = i;
+    }
+    module->proto_count = proto_count;
+    bool ok = proto_count > 0;
+    for (size_t i = 0; ok && i < proto_count; i++) {
+        ok = read_proto(r, module, module->protos[i]);
+    }
+    uint64_t main = read_u64(r);
+    ok = ok && main < proto_count;
+    if (ok) module->main = module->protos[main];
+
+    size_t global_count = ok ? read_count(r, 9) : 0;
+    module->globals = alloc_array(global_count, sizeof(char*));
+    module->global_natives = alloc_array(global_count, sizeof(bool));
+    for (size_t i = 0; ok && i < global_count; i++) {
+        module->globals[i] = read_string(r, NULL);
+        module->global_natives[i] = read_u8(r) != 0;
+        module->global_count = i + 1;
+        ok = module->globals[i] != NULL;
+    }
+
+    size_t struct_count = ok ? read_count(r, 16) : 0;
+    module->structs = alloc_array(struct_count, sizeof(KStructType*));
+    for (size_t i = 0; ok && i < struct_count; i++) {
+        ok = read_struct(r, module, i);
+    }
+    if (!ok || r->failed) {
+        kric_module_free(module);
+        return NULL;
+    }
+    return module;
+}
+
+// 辅助函数：新对象按顺序编号
+static void decoded(Reader* r, KGCObject* obj) {
+    if (r->object_count >= r->object_capacity) {
+        r->failed = true;
+        return;
+    }
+    r->objects[r->object_count++] = obj;
+}
+
+static KValue read_value(Reader* r, int depth);
+
+// 辅助函数：读取 count 个连续的结构体值的数据与其中的字符串引用
+static void read_struct_data(Reader* r, KGCObject* owner, const KStructType* type, unsigned char* data,
+                             size_t count, int depth) {
+    const uint8_t* bytes = take(r, count * type->size);
+    if (!bytes) return;
+    memcpy(data, bytes, count * type->size);
+    for (size_t i = 0; i < count && !r->failed; i++) {
+        for (size_t j = 0; j < type->ref_count && !r->failed; j++) {
+            KValue ref = read_value(r, depth + 1);
+            if (ref.type != KVAL_NULL && !kvalue_is_object_type(ref, KOBJ_STRING)) {
+                r->failed = true;
+                return;
+            }
+            KGCObject* obj = ref.type == KVAL_NULL ? NULL : ref.as.object;
+            memcpy(data + i * type->size + type->ref_offsets[j], &obj, sizeof(obj));
+            kgc_write_barrier(r->vm->heap, owner, obj);
+        }
+    }
+}
+
+static KValue read_object(Reader* r, uint8_t tag, int depth) {
+    KorelinVM* vm = r->vm;
+    KGCHeap* heap = vm->heap;
+    const KModule* module = vm->module;
+    switch (tag) {
+        case TAG_REF: {
+            uint64_t id = read_u64(r);
+            if (id >= r->object_count || !r->objects[id]) break;
+            return KVALUE_OBJECT(r->objects[id]);
+        }
+        case TAG_CONSTANT: {
+            uint64_t packed = read_u64(r);
+            size_t proto = (size_t)(packed >> 32), index = (size_t)(packed & UINT32_MAX);
+            if (proto >= module->proto_count || index >= module->protos[proto]->constant_count) break;
+            KValue constant = vm->program->constants[proto][index];
+            if (constant.type != KVAL_OBJECT) break;
+            return constant;
+        }
+        case TAG_NATIVE: {
+            char* name = read_string(r, NULL);
+            const KriNative* native = name ? kri_find_native(name) : NULL;
+            free(name);
+            // 原生函数对象属于程序, 按名字绑定在全局变量的初始值中
+            for (size_t i = 0; native && i < module->global_count; i++) {
+                KValue global = vm->program->globals[i];
+                if (kvalue_is_object_type(global, KOBJ_NATIVE) && ((KNative*)global.as.object)->native == native) {
+                    return global;
+                }
+            }
+            break;
+        }
+        case TAG_FROZEN: {
+            size_t id = r->object_count;
+            decoded(r, NULL);
+            KValue body = read_value(r, depth + 1);
+            KValue frozen;
+            if (r->failed || body.type != KVAL_OBJECT || !kvalue_freeze(heap, body, &frozen)) break;
+            r->objects[id] = frozen.as.object;
+            return frozen;
+        }
+        case TAG_STRING: {
+            uint8_t encoding = read_u8(r);
+            size_t length = read_count(r, 1);
+            const uint8_t* chars = take(r, length);
+            if (!chars) break;
+            KString* str = kstring_alloc(heap, length);
+            memcpy(str->chars, chars, length);
+            kstring_seal(str);
+            str->encoding = encoding;
+            decoded(r, &str->obj);
+            return KVALUE_OBJECT(str);
+        }
+        case TAG_BIGINT: {
+            bool negative = read_u8(r) != 0;
+            size_t length = read_count(r, sizeof(uint64_t));
+            const uint8_t* limbs = take(r, length * sizeof(uint64_t));
+            if (!limbs) break;
+            KValue big = kbigint_from_bytes(heap, limbs, length, negative);
+            if (big.type != KVAL_OBJECT) break;
+            decoded(r, big.as.object);
+            return big;
+        }
+        case TAG_ARRAY:
+        case TAG_TYPED_ARRAY: {
+            KElementKind kind = (KElementKind)read_u8(r);
+            if (kind > KELEM_UINT8 || (tag == TAG_TYPED_ARRAY && kind == KELEM_VALUE)) break;
+            size_t count = read_count(r, kind == KELEM_VALUE ? 1 : kelement_size(kind));
+            if (r->failed) break;
+            KArray shape = {.obj.type = tag == TAG_ARRAY ? KOBJ_ARRAY : KOBJ_TYPED_ARRAY, .kind = kind};
+            KArray* array = karray_new_like(heap, &shape, kind == KELEM_VALUE ? 0 : count);
+            decoded(r, &array->obj);
+            if (kind != KELEM_VALUE) {
+                size_t size = count * kelement_size(kind);
+                const uint8_t* items = take(r, size);
+                if (items && size) memcpy(array->items.data, items, size);
+                return KVALUE_OBJECT(array);
+            }
+            karray_reserve(heap, array, count);
+            for (size_t i = 0; i < count && !r->failed; i++) {
+                KValue item = read_value(r, depth + 1);
+                array->items.values[array->count++] = item;
+                kvalue_write_barrier(heap, &array->obj, item);
+            }
+            return KVALUE_OBJECT(array);
+        }
+        case TAG_STRUCT: {
+            uint64_t index = read_u64(r);
+            if (index >= module->struct_count) break;
+            KStruct* value = kstruct_new(heap, module->structs[index]);
+            decoded(r, &value->obj);
+            read_struct_data(r, &value->obj, value->type, value->data, 1, depth);
+            return KVALUE_OBJECT(value);
+        }
+        case TAG_STRUCT_ARRAY: {
+            uint64_t index = read_u64(r);
+            if (index >= module->struct_count) break;
+            const KStructType* type = module->structs[index];
+            size_t count = read_count(r, type->size ? type->size : 1);
+            if (r->failed) break;
+            KStructArray* array = kstruct_array_new(heap, type, count);
+            decoded(r, &array->obj);
+            read_struct_data(r, &array->obj, type, array->data, count, depth);
+            return KVALUE_OBJECT(array);
+        }
+        case TAG_FUNCTION: {
+            uint64_t index = read_u64(r);
+            if (index >= module->proto_count) break;
+            const KProto* proto = module->protos[index];
+            KFunction* fn = kvm_function_new(vm, proto);
+            decoded(r, &fn->obj);
+            size_t count = read_count(r, 9);
+            for (size_t i = 0; i < count && !r->failed; i++) {
+                uint64_t constant = read_u64(r);
+                KValue nested = read_value(r, depth + 1);
+                if (constant >= proto->constant_count || proto->constants[constant].kind != KCONST_FUNCTION ||
+                    !kvalue_is_object_type(nested, KOBJ_FUNCTION)) {
+                    r->failed = true;
+                    break;
+                }
+                kvm_function_set_nested(vm, fn, (size_t)constant, (KFunction*)nested.as.object);
+            }
+            return KVALUE_OBJECT(fn);
+        }
+        case TAG_MAP: {
+            size_t count = read_count(r, 2);
+            KMap* map = kmap_new(heap, count);
+            decoded(r, &map->obj);
+            for (size_t i = 0; i < count && !r->failed; i++) {
+                KValue key = read_value(r, depth + 1);
+                KValue item = read_value(r, depth + 1);
+                kmap_set(heap, map, key, item);
+            }
+            return KVALUE_OBJECT(map);
+        }
+        case TAG_PMAP: {
+            size_t count = read_count(r, 2);
+            KPMap* map = kpmap_transient(heap, NULL);
+            decoded(r, &map->obj);
+            for (size_t i = 0; i < count && !r->failed; i++) {
+                KValue key = read_value(r, depth + 1);
+                KValue item = read_value(r, depth + 1);
+                kpmap_assoc(heap, map, key, item);
+            }
+            map->edit = 0;
+            return KVALUE_OBJECT(map);
+        }
+        case TAG_PVECTOR: {
+            size_t count = read_count(r, 1);
+            KPVector* vector = kpvector_transient(heap, NULL);
+            decoded(r, &vector->obj);
+            for (size_t i = 0; i < count && !r->failed; i++) {
+                kpvector_conj(heap, vector, read_value(r, depth + 1));
+            }
+            vector->edit = 0;
+            return KVALUE_OBJECT(vector);
+        }
+        case TAG_BUILDER: {
+            size_t length = read_count(r, 1);
+            const uint8_t* chars = take(r, length);
+            if (!chars) break;
+            KStringBuilder* builder = kstring_builder_new(heap, length);
+            kstring_builder_append(heap, builder, (const char*)chars, length);
+            decoded(r, &builder->obj);
+            return KVALUE_OBJECT(builder);
+        }
+        default:
+            break;
+    }
+    r->failed = true;
+    return KVALUE_NULL;
+}
+
+static KValue read_value(Reader* r, int depth) {
+    uint8_t tag = read_u8(r);
+    if (r->failed) return KVALUE_NULL;
+    switch (tag) {
+        case TAG_NULL: return KVALUE_NULL;
+        case TAG_FALSE: return KVALUE_BOOL(false);
+        case TAG_TRUE: return KVALUE_BOOL(true);
+        case TAG_INT: return KVALUE_INT((long long)read_u64(r));
+        case TAG_DOUBLE: {
+            double number = 0;
+            const uint8_t* bytes = take(r, sizeof(number));
+            if (bytes) memcpy(&number, bytes, sizeof(number));
+            return KVALUE_DOUBLE(number);
+        }
+        default:
+            if (depth > KIMAGE_MAX_DEPTH) {
+                r->failed = true;
+                return KVALUE_NULL;
+            }
+            return read_object(r, tag, depth);
+    }
+}
+
+bool kimage_probe(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    char magic[8];
+    bool ok = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, KIMAGE_MAGIC, 8) == 0;
+    fclose(file);
+    return ok;
+}
+
+int kimage_run(const char* path) {
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        if (fd >= 0) close(fd);
+        fprintf(stderr, "Could not read file '%s'.\n", path);
+        return 74;
+    }
+    size_t length = (size_t)info.st_size;
+    void* mapped = length >= KIMAGE_HEADER_SIZE ? mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        fprintf(stderr, "Invalid image '%s'.\n", path);
+        return 65;
+    }
+
+    Reader r = {.data = mapped, .length = length, .pos = 8};
+    uint64_t byte_order = read_u64(&r);
+    uint64_t version = read_u64(&r);
+    uint64_t build = read_u64(&r);
+    uint64_t object_count = read_u64(&r);
+    uint64_t checksum = read_u64(&r);
+    if (memcmp(mapped, KIMAGE_MAGIC, 8) != 0 || byte_order != KIMAGE_BYTE_ORDER || version != KIMAGE_VERSION ||
+        build != build_hash()) {
+        munmap(mapped, length);
+        fprintf(stderr, "Image '%s' was written by a different build of korelin.\n", path);
+        return 65;
+    }
+    if (checksum != image_hash(r.data + KIMAGE_HEADER_SIZE, length - KIMAGE_HEADER_SIZE, object_count)) {
+        munmap(mapped, length);
+        fprintf(stderr, "Image '%s' is corrupt (checksum mismatch).\n", path);
+        return 65;
+    }
+    // 每个对象在文件中至少占 1 字节
+    KModule* module = object_count <= length ? read_module(&r) : NULL;
+    // 字节码在创建任何函数对象之前检查
+    if (module && !kric_module_verify(module)) {
+        kric_module_free(module);
+        module = NULL;
+    }
+    if (!module) {
+        munmap(mapped, length);
+        fprintf(stderr, "Invalid image '%s'.\n", path);
+        return 65;
+    }
+
+    // 没有经过编译: 原生函数表在这里注册, 程序才能按名字绑定它们
+    kri_init_builtins();
+    KProgram* program = kvm_program_new(module);
+    KorelinVM* vm = kvm_new(NULL);
+    kvm_bind(vm, program);
+    // 重建中的对象要到恢复执行时才全部可达 (栈中的值不是根): 重建期间暂停回收
+    KGCHeap* heap = vm->heap;
+    heap->threshold = SIZE_MAX;
+    r.vm = vm;
+    r.objects = alloc_array((size_t)object_count, sizeof(KGCObject*));
+    r.object_capacity = (size_t)object_count;
+
+    for (size_t i = 0; i < vm->global_count && !r.failed; i++) {
+        *kvm_global_slot(vm, i) = read_value(&r, 0);
+    }
+    size_t stack_count = read_count(&r, 1);
+    KValue* stack = alloc_array(stack_count, sizeof(KValue));
+    for (size_t i = 0; i < stack_count && !r.failed; i++) {
+        stack[i] = read_value(&r, 0);
+    }
+    uint64_t offset = read_u64(&r);
+    bool valid = !r.failed && r.pos == length && stack_count > 0 &&
+                 kvalue_is_object_type(stack[0], KOBJ_FUNCTION) &&
+                 ((const KFunction*)stack[0].as.object)->proto == module->main &&
+                 offset < module->main->code_count && kric_verify_resume(module, (size_t)offset, stack_count + 1);
+    munmap(mapped, length);
+    free(r.objects);
+    heap->threshold = heap->config.min_threshold;
+
+    bool ok = false;
+    if (valid) {
+        ok = kvm_resume(vm, stack, stack_count, (size_t)offset, KVALUE_BOOL(true));
+    } else {
+        fprintf(stderr, "Invalid image '%s'.\n", path);
+    }
+    free(stack);
+    kvm_free(vm);
+    kvm_program_free(program);
+    kric_module_free(module);
+    if (!valid) return 65;
+    return ok ? 0 : 70;
+}
+
+// =============================================================================
+// 原生函数
+// =============================================================================
+
+// snapshot(path) -> bool | null
+static KValue native_snapshot(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    if (!kvalue_is_object_type(argv[0], KOBJ_STRING)) return KVALUE_NULL;
+    // 恢复时只重建顶层代码这一个调用帧: 不能在函数、回调或协程中调用
+    if (vm->fiber != vm->main || vm->nested > 0 || vm->frame_count != 1) return KVALUE_NULL;
+    if (vm->fibers != vm->main || vm->main->next_live || vm->net) return KVALUE_NULL;
+    // 写入的栈不含这次调用本身 (被调用的函数与参数), 恢复时在它之上压入返回值
+    size_t stack_count = (size_t)(argv - vm->stack) - 1;
+    const KString* path = (const KString*)argv[0].as.object;
+    return kimage_write(vm, path->chars, stack_count) ? KVALUE_BOOL(false) : KVALUE_NULL;
+}
+
+const KriNative kri_image_natives[] = {
+    {"snapshot", 1, native_snapshot},
+    {NULL, 0, NULL},
+};
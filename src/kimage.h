@@ -0,0 +1,62 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#ifndef KORELIN_KIMAGE_H
+#define KORELIN_KIMAGE_H
+
+#include "krilib.h"
+#include "kvm.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// =============================================================================
+// 启动镜像
+//
+// 初始化开销大的脚本 (构建查找表、解析配置等) 可以在初始化完成后调用 snapshot(path),
+// 把编译单元连同此刻的全局变量、顶层代码的栈与它们引用的所有对象写入镜像文件。之后
+// korelin run <镜像> 不再编译与初始化: 文件被 mmap 后逐个重建对象, 顶层代码从 snapshot
+// 返回处继续执行, 这一次 snapshot 返回 true。
+//
+// 镜像中没有地址: 对象按第一次出现的顺序编号, 引用写为编号 (与通道消息的编码相同,
+// 见 libs/kchannel.h), 共享与循环的结构保持不变; 程序中的常量写为 (原型, 常量下标),
+// 原生函数写为名字, 结构体类型写为声明的下标, 载入时在新的程序中找到对应的对象。
+// 冻结的值恢复后仍是冻结的 (位于新的共享区中)。
+//
+// 只能在主程序的顶层代码中直接调用 snapshot, 并且没有其他未结束的协程、没有使用过
+// 网络与定时器; 协程、通道与并发哈希表不能写入镜像。镜像使用原生字节序, 只能由同一
+// 次构建的 korelin 在同一种平台上载入 (文件头中记录构建标识与内容的校验和, 载入时还会
+// 检查字节码, 见 kric_module_verify)。
+// =============================================================================
+
+#define KIMAGE_MAGIC "KRIIMG01"
+
+// --- 函数声明 ---
+
+/**
+ * @brief 把 vm 的状态写入镜像, 由 snapshot 调用。
+ * @param vm 虚拟机, 正在执行顶层代码。
+ * @param path 镜像文件路径。
+ * @param stack_count 写入的栈槽位数: 暂停处的调用之下的部分。
+ * @return 成功返回 true; 状态中含有不能写入的对象或写文件失败时返回 false。
+ */
+bool kimage_write(KorelinVM* vm, const char* path, size_t stack_count);
+
+/**
+ * @brief 文件是否以镜像的魔数开头。
+ */
+bool kimage_probe(const char* path);
+
+/**
+ * @brief 命令行入口: 载入镜像并从 snapshot 返回处继续执行。
+ * @param path 镜像文件路径。
+ * @return 进程退出码, 与 korelin run 执行源文件时相同 (镜像无效、来自其他构建或已损坏时为 65)。
+ */
+int kimage_run(const char* path);
+
+// 镜像相关的原生函数:
+//   snapshot(path) -> bool | null    写入镜像并返回 false; 从镜像恢复时返回 true;
+//                                    不在顶层代码中、状态不能写入或写文件失败时返回 null
+extern const KriNative kri_image_natives[];
+
+#endif //KORELIN_KIMAGE_H
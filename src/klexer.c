@@ -10,7 +10,10 @@
 
 // 辅助函数：将 lexer 的指针向前移动一位
 static void advance(KorelinLexer* lexer) {
-    if (lexer->read_position >= strlen(lexer->input)) {
+    if (lexer->current_char == '\n') {
+        lexer->line++;
+    }
+    if (lexer->read_position >= lexer->length) {
         lexer->current_char = '\0'; // 到达文件末尾
     } else {
         lexer->current_char = lexer->input[lexer->read_position];
@@ -21,7 +24,7 @@ static void advance(KorelinLexer* lexer) {
 
 // 辅助函数：查看下一个字符，但不移动指针
 static char peek(const KorelinLexer* lexer) {
-    if (lexer->read_position >= strlen(lexer->input)) {
+    if (lexer->read_position >= lexer->length) {
         return '\0';
     }
     return lexer->input[lexer->read_position];
@@ -120,10 +123,50 @@ static KorelinToken read_identifier(KorelinLexer* lexer) {
     return token;
 }
 
-// 辅助函数：读取一个完整的数字 (当前只支持整数)
+// 辅助函数：查看再下一个字符，但不移动指针
+static char peek2(const KorelinLexer* lexer) {
+    if (lexer->read_position + 1 >= lexer->length) {
+        return '\0';
+    }
+    return lexer->input[lexer->read_position + 1];
+}
+
+// 辅助函数：读取一个完整的数字
+// 整数可以是十进制、0x 十六进制或 0b 二进制, 浮点数带小数部分和/或指数 (1.5、2e10、
+// 1.5e-7), 数字之间可以用 '_' 分隔。字面量是否合法由解析器检查 (knumber_parse),
+// 这里把紧跟的字母、数字和 '_' 一并读入, 使 12abc、0x 这样的错误成为一个 Token。
 static KorelinToken read_number(KorelinLexer* lexer) {
     size_t start_pos = lexer->position;
-    while (isdigit(lexer->current_char)) {
+    KorelinTokenType type = KORELIN_INT;
+    char prefix = (char)tolower(peek(lexer));
+    if (lexer->current_char == '0' && (prefix == 'x' || prefix == 'b')) {
+        advance(lexer);
+        advance(lexer);
+    } else {
+        while (isdigit(lexer->current_char) || lexer->current_char == '_') {
+            advance(lexer);
+        }
+        // 小数点后必须跟数字, 否则 '.' 是成员访问 (如 1.x 不合法, 但 a[1].x 合法)
+        if (lexer->current_char == '.' && isdigit(peek(lexer))) {
+            type = KORELIN_DOUBLE;
+            advance(lexer);
+            while (isdigit(lexer->current_char) || lexer->current_char == '_') {
+                advance(lexer);
+            }
+        }
+        // 指数: e 或 E, 可以带正负号, 之后必须是数字
+        if (lexer->current_char == 'e' || lexer->current_char == 'E') {
+            char next = peek(lexer);
+            if (isdigit(next) || ((next == '+' || next == '-') && isdigit(peek2(lexer)))) {
+                type = KORELIN_DOUBLE;
+                advance(lexer);
+                if (next == '+' || next == '-') {
+                    advance(lexer);
+                }
+            }
+        }
+    }
+    while (isalnum(lexer->current_char) || lexer->current_char == '_') {
         advance(lexer);
     }
     size_t len = lexer->position - start_pos;
@@ -135,13 +178,14 @@ static KorelinToken read_number(KorelinLexer* lexer) {
     strncpy(literal, lexer->input + start_pos, len);
     literal[len] = '\0';
 
-    KorelinToken token = {.type = KORELIN_INT, .value = literal, .length = len, .needs_free = 1};
+    KorelinToken token = {.type = type, .value = literal, .length = len, .needs_free = 1};
     return token;
 }
 
 // 核心函数：获取下一个 Token (已优化)
-KorelinToken next_korelin_token(KorelinLexer* lexer) {
+static KorelinToken scan_token(KorelinLexer* lexer) {
     skip_whitespace(lexer);
+    lexer->token_line = lexer->line;
 
     KorelinToken token;
 
@@ -226,8 +270,28 @@ KorelinToken next_korelin_token(KorelinLexer* lexer) {
         // ... 在这里可以继续添加其他双字符运算符的处理，如 *=, /= 等
 
         // --- 单字符运算符和分隔符 ---
-        case '*': token = new_token(KORELIN_MUL, "*", 1); break;
-        case '/': token = new_token(KORELIN_DIV, "/", 1); break;
+        case '*':
+            if (peek(lexer) == '=') {
+                token = new_token(KORELIN_MUL_ASSIGN, "*=", 2);
+                advance(lexer);
+            } else {
+                token = new_token(KORELIN_MUL, "*", 1);
+            }
+            break;
+        case '/':
+            if (peek(lexer) == '/') {
+                // 单行注释: 跳到行尾后读取下一个 Token
+                while (lexer->current_char != '\n' && lexer->current_char != '\0') {
+                    advance(lexer);
+                }
+                return scan_token(lexer);
+            } else if (peek(lexer) == '=') {
+                token = new_token(KORELIN_DIV_ASSIGN, "/=", 2);
+                advance(lexer);
+            } else {
+                token = new_token(KORELIN_DIV, "/", 1);
+            }
+            break;
         case '%': token = new_token(KORELIN_MOD, "%", 1); break;
         case '^': token = new_token(KORELIN_POW, "^", 1); break;
         case ',': token = new_token(KORELIN_COMMA, ",", 1); break;
@@ -238,6 +302,8 @@ KorelinToken next_korelin_token(KorelinLexer* lexer) {
         case ']': token = new_token(KORELIN_RBRACKET, "]", 1); break;
         case '{': token = new_token(KORELIN_LBRACE, "{", 1); break;
         case '}': token = new_token(KORELIN_RBRACE, "}", 1); break;
+        case '.': token = new_token(KORELIN_DOT, ".", 1); break;
+        case ':': token = new_token(KORELIN_COLON, ":", 1); break;
 
         // --- 文件结束 ---
         case '\0':
@@ -256,8 +322,8 @@ KorelinToken next_korelin_token(KorelinLexer* lexer) {
             } else if (isdigit(lexer->current_char)) {
                 return read_number(lexer); // 直接返回，无需 advance
             } else {
-                // 无法识别的字符
-                token = new_token(KORELIN_ERROR, (const char[]){lexer->current_char, '\0'}, 1);
+                // 无法识别的字符 (value 指向输入中的该字符)
+                token = new_token(KORELIN_ERROR, lexer->input + lexer->position, 1);
             }
             break;
     }
@@ -266,9 +332,18 @@ KorelinToken next_korelin_token(KorelinLexer* lexer) {
     return token;
 }
 
+KorelinToken next_korelin_token(KorelinLexer* lexer) {
+    KorelinToken token = scan_token(lexer);
+    token.line = lexer->token_line;
+    return token;
+}
+
 // 初始化 Lexer
 void init_korelin_lexer(KorelinLexer* lexer, const char* input) {
     lexer->input = input;
+    lexer->length = strlen(input);
+    lexer->line = 1;
+    lexer->token_line = 1;
     lexer->position = 0;
     lexer->read_position = 0;
     lexer->current_char = '\0';
@@ -277,10 +352,10 @@ void init_korelin_lexer(KorelinLexer* lexer, const char* input) {
 
 // 释放 Token 的 value 内存
 void free_korelin_token(KorelinToken* token) {
-    // 只有动态分配的内存才需要释放
-    if (token->type == KORELIN_IDENT || token->type == KORELIN_INT ||
-        token->type == KORELIN_DOUBLE || token->type == KORELIN_STRING) {
+    // 只有动态分配的内存才需要释放 (关键字由 read_identifier 读取, 同样是动态分配的)
+    if (token->needs_free) {
         free((void*)token->value);
         token->value = NULL; // 防止悬挂指针
+        token->needs_free = 0;
     }
 }
\ No newline at end of file
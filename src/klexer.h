@@ -28,6 +28,8 @@ typedef enum {
     KORELIN_RBRACKET,       // ]
     KORELIN_LBRACE,         // {
     KORELIN_RBRACE,         // }
+    KORELIN_DOT,            // .
+    KORELIN_COLON,          // :
 
     // 运算符
     // 单字符
@@ -105,14 +107,18 @@ typedef struct {
     const char* value;      // 指向动态分配的Token文本值的指针，需要手动释放
     size_t length;          // 值的长度
     int needs_free;        // 标志位：是否需要释放 value 内存 (1: needs free, 0: static)
+    int line;               // Token 所在的行号 (从 1 开始)
 } KorelinToken;
 
 // 词法分析器 (Lexer) 结构体
 typedef struct {
     const char* input;
+    size_t length;          // 输入的长度
     size_t position;        // 当前正在检查的字符的索引
     size_t read_position;   // 下一个要检查的字符的索引
     char current_char;      // 当前正在检查的字符
+    int line;               // 当前行号
+    int token_line;         // 正在读取的 Token 的起始行号
 } KorelinLexer;
 
 // --- 函数声明 ---
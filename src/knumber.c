@@ -0,0 +1,594 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "knumber.h"
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+__extension__ typedef unsigned __int128 KUint128;
+
+// =============================================================================
+// 128 位的 5 的幂表
+// =============================================================================
+
+#define LEMIRE_MIN_Q (-342)         // 更小的十进制指数一定下溢为 0
+#define LEMIRE_MAX_Q 308            // 更大的十进制指数一定上溢为无穷大
+#define RYU_POW5_COUNT 326
+#define RYU_POW5_INV_COUNT 342
+#define RYU_POW5_BITS 125           // Ryu 表项的有效位数
+
+// Eisel-Lemire: 5^q 的最高 128 位 (q < 0 时为 2^b / 5^-q), [0] 为高 64 位
+static uint64_t lemire_table[LEMIRE_MAX_Q - LEMIRE_MIN_Q + 1][2];
+// Ryu: 5^i 的最高 125 位与 2^k / 5^i 的 125 位近似值, [0] 为低 64 位
+static uint64_t ryu_pow5[RYU_POW5_COUNT][2];
+static uint64_t ryu_pow5_inv[RYU_POW5_INV_COUNT][2];
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+// 生成表用的定长大整数 (小端序的 32 位字)
+#define BIG_WORDS 58
+#define BIG_TOP_BIT (BIG_WORDS * 32 - 1)
+
+typedef struct BigInt {
+    uint32_t words[BIG_WORDS];
+} BigInt;
+
+static int big_bit_length(const BigInt* x) {
+    for (int i = BIG_WORDS - 1; i >= 0; i--) {
+        if (x->words[i]) return i * 32 + 32 - __builtin_clz(x->words[i]);
+    }
+    return 0;
+}
+
+static void big_mul_small(BigInt* x, uint32_t factor) {
+    uint64_t carry = 0;
+    for (int i = 0; i < BIG_WORDS; i++) {
+        uint64_t t = (uint64_t)x->words[i] * factor + carry;
+        x->words[i] = (uint32_t)t;
+        carry = t >> 32;
+    }
+}
+
+// 辅助函数：x = floor(x / divisor)
+static void big_div_small(BigInt* x, uint32_t divisor) {
+    uint64_t remainder = 0;
+    for (int i = BIG_WORDS - 1; i >= 0; i--) {
+        uint64_t current = remainder << 32 | x->words[i];
+        x->words[i] = (uint32_t)(current / divisor);
+        remainder = current % divisor;
+    }
+}
+
+// 辅助函数：out = floor(x / 2^shift), shift >= 0
+static void big_shift_right(const BigInt* x, int shift, BigInt* out) {
+    int words = shift / 32;
+    int bits = shift % 32;
+    for (int i = 0; i < BIG_WORDS; i++) {
+        uint64_t low = i + words < BIG_WORDS ? x->words[i + words] : 0;
+        uint64_t high = i + words + 1 < BIG_WORDS ? x->words[i + words + 1] : 0;
+        out->words[i] = (uint32_t)((high << 32 | low) >> bits);
+    }
+}
+
+static void big_add_one(BigInt* x) {
+    for (int i = 0; i < BIG_WORDS && ++x->words[i] == 0; i++) {
+    }
+}
+
+// 辅助函数：floor(x / 2^shift) 的低 128 位, shift 可以为负 (左移)
+static void big_extract(const BigInt* x, int shift, uint64_t* high, uint64_t* low) {
+    *high = 0;
+    *low = 0;
+    for (int bit = 0; bit < 128; bit++) {
+        int source = shift + bit;
+        if (source < 0 || source >= BIG_WORDS * 32 || !((x->words[source / 32] >> (source % 32)) & 1)) continue;
+        if (bit >= 64) *high |= 1ull << (bit - 64);
+        else *low |= 1ull << bit;
+    }
+}
+
+static void build_tables(void) {
+    // 正的幂: 5^i 左对齐后截断
+    int bit_lengths[RYU_POW5_INV_COUNT + 1];
+    BigInt power = {{1}};
+    for (int i = 0; i <= RYU_POW5_INV_COUNT; i++) {
+        int length = big_bit_length(&power);
+        bit_lengths[i] = length;
+        if (i < RYU_POW5_COUNT) big_extract(&power, length - RYU_POW5_BITS, &ryu_pow5[i][1], &ryu_pow5[i][0]);
+        if (i <= LEMIRE_MAX_Q) {
+            uint64_t* entry = lemire_table[i - LEMIRE_MIN_Q];
+            big_extract(&power, length - 128, &entry[0], &entry[1]);
+        }
+        big_mul_small(&power, 5);
+    }
+
+    // 负的幂: 由 floor(2^M / 5^k) 右移得到 floor(2^b / 5^k) (两次向下取整等于一次)
+    BigInt quotient = {{0}};
+    quotient.words[BIG_TOP_BIT / 32] = 1u << (BIG_TOP_BIT % 32);
+    ryu_pow5_inv[0][0] = 1;
+    ryu_pow5_inv[0][1] = 1ull << (RYU_POW5_BITS - 64);
+    for (int k = 1; k <= -LEMIRE_MIN_Q; k++) {
+        big_div_small(&quotient, 5);
+        int length = bit_lengths[k];
+        if (k < RYU_POW5_INV_COUNT) {
+            // floor(2^(length - 1 + 125) / 5^k) + 1
+            uint64_t* entry = ryu_pow5_inv[k];
+            big_extract(&quotient, BIG_TOP_BIT - (length - 1 + RYU_POW5_BITS), &entry[1], &entry[0]);
+            if (++entry[0] == 0) entry[1]++;
+        }
+        // floor(2^b / 5^k) + 1, 截断到最高 128 位
+        int b = k <= 27 ? length + 127 : 2 * length + 128;
+        BigInt c;
+        big_shift_right(&quotient, BIG_TOP_BIT - b, &c);
+        big_add_one(&c);
+        int c_length = big_bit_length(&c);
+        uint64_t* entry = lemire_table[-k - LEMIRE_MIN_Q];
+        big_extract(&c, c_length > 128 ? c_length - 128 : 0, &entry[0], &entry[1]);
+    }
+}
+
+// =============================================================================
+// 解析
+// =============================================================================
+
+// 十进制数字的累加状态
+typedef struct DigitScan {
+    uint64_t mantissa;          // 前 19 位有效数字
+    int digits;                 // mantissa 中的有效数字位数
+    long long exponent;         // mantissa 的最后一位对应的十进制指数
+    bool inexact;               // 第 19 位之后还有非 0 数字
+    uint64_t integer;           // 整数部分的精确值 (作为整数字面量时使用)
+    bool overflow;              // integer 超出 64 位
+} DigitScan;
+
+// 辅助函数：扫描一段十进制数字 ('_' 只能出现在两个数字之间), 没有数字或 '_' 位置不对时返回 NULL
+static const char* scan_digits(const char* p, const char* end, DigitScan* scan, bool fraction) {
+    const char* start = p;
+    for (; p < end; p++) {
+        if (*p == '_') {
+            if (p == start || p + 1 == end || p[-1] == '_' || p[1] < '0' || p[1] > '9') return NULL;
+            continue;
+        }
+        if (*p < '0' || *p > '9') break;
+        unsigned digit = (unsigned)(*p - '0');
+        if (!fraction) {
+            if (scan->integer > (UINT64_MAX - digit) / 10) scan->overflow = true;
+            scan->integer = scan->integer * 10 + digit;
+        }
+        if (scan->digits == 0 && digit == 0) {
+            if (fraction) scan->exponent--;     // 有效数字之前的 0
+        } else if (scan->digits < 19) {
+            scan->mantissa = scan->mantissa * 10 + digit;
+            scan->digits++;
+            if (fraction) scan->exponent--;
+        } else {
+            if (digit) scan->inexact = true;
+            if (!fraction) scan->exponent++;
+        }
+    }
+    return p == start ? NULL : p;
+}
+
+// 辅助函数：解析 0x / 0b 之后的数字, 超过 64 位时返回 KNUMBER_OVERFLOW (仍然检查完所有字符)
+static KNumberKind parse_radix(const char* p, const char* end, unsigned shift, uint64_t* out) {
+    uint64_t value = 0;
+    bool overflow = false;
+    const char* start = p;
+    for (; p < end; p++) {
+        if (*p == '_') {
+            if (p == start || p + 1 == end || p[-1] == '_' || p[1] == '_') return KNUMBER_INVALID;
+            continue;
+        }
+        unsigned digit;
+        if (*p >= '0' && *p <= '9') digit = (unsigned)(*p - '0');
+        else if ((*p | 0x20) >= 'a' && (*p | 0x20) <= 'f') digit = (unsigned)((*p | 0x20) - 'a' + 10);
+        else return KNUMBER_INVALID;
+        if (digit >= 1u << shift) return KNUMBER_INVALID;
+        if (value >> (64 - shift)) overflow = true;
+        value = value << shift | digit;
+    }
+    if (p == start) return KNUMBER_INVALID;
+    *out = value;
+    return overflow ? KNUMBER_OVERFLOW : KNUMBER_INT;
+}
+
+// 辅助函数：Eisel-Lemire 算法, 计算 w * 10^q 的正确舍入结果 (w 不为 0, 最多 19 位)。
+// 128 位的近似积对 19 位以内的 w 总是足够 (Mushtak 与 Lemire 的证明), 不需要后备路径
+static double eisel_lemire(uint64_t w, long long q) {
+    if (q < LEMIRE_MIN_Q) return 0.0;
+    if (q > LEMIRE_MAX_Q) return HUGE_VAL;
+    pthread_once(&tables_once, build_tables);
+    const uint64_t* power = lemire_table[q - LEMIRE_MIN_Q];
+
+    int lz = __builtin_clzll(w);
+    w <<= lz;
+    KUint128 first = (KUint128)w * power[0];
+    uint64_t high = (uint64_t)(first >> 64);
+    uint64_t low = (uint64_t)first;
+    if ((high & 0x1FF) == 0x1FF) {
+        // 截断的位可能影响舍入, 加上低 64 位的积
+        uint64_t second = (uint64_t)(((KUint128)w * power[1]) >> 64);
+        low += second;
+        if (second > low) high++;
+    }
+
+    int upper_bit = (int)(high >> 63);
+    int shift = upper_bit + 9;
+    uint64_t mantissa = high >> shift;
+    // 以 2 为底的指数: floor(log2(10^q)) + 63 + upper_bit - lz, 加上偏置 1023
+    int power2 = (int)((((152170 + 65536) * q) >> 16) + 63) + upper_bit - lz + 1023;
+    if (power2 <= 0) {
+        // 非规格化数
+        if (-power2 + 1 >= 64) return 0.0;
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        power2 = mantissa < (1ull << 52) ? 0 : 1;
+    } else {
+        // 恰好位于两个浮点数正中间时舍入到偶数 (只可能在 5^q 能放入 64 位时发生)
+        if (low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == high) {
+            mantissa &= ~1ull;
+        }
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        if (mantissa >= 2ull << 52) {
+            mantissa = 1ull << 52;
+            power2++;
+        }
+        mantissa &= ~(1ull << 52);
+        if (power2 >= 0x7FF) return HUGE_VAL;
+    }
+    uint64_t bits = (uint64_t)power2 << 52 | mantissa;
+    double result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+// 辅助函数：有效数字超过 19 位时交给 strtod (C 库的实现是正确舍入的)
+static double parse_with_strtod(const char* text, const char* end) {
+    char* copy = malloc((size_t)(end - text) + 1);
+    if (!copy) {
+        fprintf(stderr, "Error: malloc failed in parse_with_strtod\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t length = 0;
+    for (const char* p = text; p < end; p++) {
+        if (*p != '_') copy[length++] = *p;
+    }
+    copy[length] = '\0';
+    double result = strtod(copy, NULL);
+    free(copy);
+    return result;
+}
+
+KNumberKind knumber_parse(const char* text, size_t length, long long* integer, double* number) {
+    const char* p = text;
+    const char* end = text + length;
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-')) negative = *p++ == '-';
+    if (p == end) return KNUMBER_INVALID;
+
+    if (end - p > 2 && p[0] == '0' && ((p[1] | 0x20) == 'x' || (p[1] | 0x20) == 'b')) {
+        uint64_t value;
+        KNumberKind kind = parse_radix(p + 2, end, (p[1] | 0x20) == 'x' ? 4 : 1, &value);
+        if (kind != KNUMBER_INT) return kind;
+        if (value > (negative ? (uint64_t)LLONG_MAX + 1 : (uint64_t)LLONG_MAX)) return KNUMBER_OVERFLOW;
+        *integer = (long long)(negative ? 0 - value : value);
+        return KNUMBER_INT;
+    }
+
+    const char* digits_start = p;
+    DigitScan scan = {0};
+    if (!(p = scan_digits(p, end, &scan, false))) return KNUMBER_INVALID;
+    bool is_double = false;
+    if (p < end && *p == '.') {
+        is_double = true;
+        if (!(p = scan_digits(p + 1, end, &scan, true))) return KNUMBER_INVALID;
+    }
+    if (p < end && (*p | 0x20) == 'e') {
+        is_double = true;
+        p++;
+        bool exponent_negative = false;
+        if (p < end && (*p == '+' || *p == '-')) exponent_negative = *p++ == '-';
+        if (p == end || *p < '0' || *p > '9') return KNUMBER_INVALID;
+        long long exponent = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            if (exponent < 100000) exponent = exponent * 10 + (*p - '0');   // 更大的指数结果相同
+        }
+        scan.exponent += exponent_negative ? -exponent : exponent;
+    }
+    if (p != end) return KNUMBER_INVALID;
+
+    if (!is_double) {
+        uint64_t limit = negative ? (uint64_t)LLONG_MAX + 1 : (uint64_t)LLONG_MAX;
+        if (scan.overflow || scan.integer > limit) return KNUMBER_OVERFLOW;
+        *integer = (long long)(negative ? 0 - scan.integer : scan.integer);
+        return KNUMBER_INT;
+    }
+
+    static const double exact_powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                          1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    double value;
+    if (scan.inexact) {
+        value = parse_with_strtod(digits_start, end);
+    } else if (scan.mantissa == 0) {
+        value = 0.0;
+    } else if (scan.mantissa <= 1ull << 53 && scan.exponent >= -22 && scan.exponent <= 22) {
+        // Clinger 快速路径: 有效数字与 10 的幂都能精确表示, 一次乘除法只舍入一次
+        value = (double)scan.mantissa;
+        value = scan.exponent < 0 ? value / exact_powers[-scan.exponent] : value * exact_powers[scan.exponent];
+    } else {
+        value = eisel_lemire(scan.mantissa, scan.exponent);
+    }
+    *number = negative ? -value : value;
+    return KNUMBER_DOUBLE;
+}
+
+// =============================================================================
+// 格式化
+// =============================================================================
+
+static const char digit_pairs[] =
+    "0001020304050607080910111213141516171819202122232425262728293031323334353637383940414243444546474849"
+    "5051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+// 辅助函数：把 value 的十进制数字写入 [out - n, out), 返回位数 n
+static size_t write_digits_backward(uint64_t value, char* out) {
+    char* p = out;
+    while (value >= 100) {
+        unsigned pair = (unsigned)(value % 100);
+        value /= 100;
+        p -= 2;
+        memcpy(p, digit_pairs + 2 * pair, 2);
+    }
+    if (value >= 10) {
+        p -= 2;
+        memcpy(p, digit_pairs + 2 * value, 2);
+    } else {
+        *--p = (char)('0' + value);
+    }
+    return (size_t)(out - p);
+}
+
+size_t knumber_format_int(long long value, char* buffer) {
+    char digits[24];
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    size_t count = write_digits_backward(magnitude, digits + sizeof(digits));
+    size_t length = 0;
+    if (value < 0) buffer[length++] = '-';
+    memcpy(buffer + length, digits + sizeof(digits) - count, count);
+    length += count;
+    buffer[length] = '\0';
+    return length;
+}
+
+// 十进制浮点数 mantissa * 10^exponent
+typedef struct Decimal {
+    uint64_t mantissa;
+    int exponent;
+} Decimal;
+
+static int pow5_bits(int e) {
+    return (int)(((uint32_t)e * 1217359) >> 19) + 1;     // ceil(log2(5^e)), e > 0
+}
+
+static int log10_pow2(int e) {
+    return (int)(((uint32_t)e * 78913) >> 18);           // floor(log10(2^e))
+}
+
+static int log10_pow5(int e) {
+    return (int)(((uint32_t)e * 732923) >> 20);          // floor(log10(5^e))
+}
+
+static int pow5_factor(uint64_t value) {
+    int count = 0;
+    while (value % 5 == 0) {
+        value /= 5;
+        count++;
+    }
+    return count;
+}
+
+// 辅助函数：(m * mul) >> j, mul 为 128 位, j >= 64
+static uint64_t mul_shift(uint64_t m, const uint64_t* mul, int j) {
+    KUint128 low = (KUint128)m * mul[0];
+    KUint128 high = (KUint128)m * mul[1];
+    return (uint64_t)(((low >> 64) + high) >> (j - 64));
+}
+
+// 辅助函数：整数值且小于 2^53 的浮点数直接取出整数, 去掉末尾的 0
+static bool small_int_decimal(uint64_t ieee_mantissa, uint32_t ieee_exponent, Decimal* out) {
+    uint64_t m2 = 1ull << 52 | ieee_mantissa;
+    int e2 = (int)ieee_exponent - 1023 - 52;
+    if (e2 > 0 || e2 < -52) return false;
+    if (m2 & ((1ull << -e2) - 1)) return false;
+    out->mantissa = m2 >> -e2;
+    out->exponent = 0;
+    while (out->mantissa % 10 == 0) {
+        out->mantissa /= 10;
+        out->exponent++;
+    }
+    return true;
+}
+
+// 辅助函数：Ryu 算法。取舍入区间 (两侧相邻浮点数的中点之间) 内位数最少的十进制数,
+// 位数相同时取最接近原值的一个。区间端点以 128 位的 5 的幂近似值计算, 只在少数
+// 可能有末尾 0 的情况下逐位确认
+static Decimal ryu_decimal(uint64_t ieee_mantissa, uint32_t ieee_exponent) {
+    pthread_once(&tables_once, build_tables);
+    int e2;
+    uint64_t m2;
+    if (ieee_exponent == 0) {
+        e2 = 1 - 1023 - 52 - 2;
+        m2 = ieee_mantissa;
+    } else {
+        e2 = (int)ieee_exponent - 1023 - 52 - 2;
+        m2 = 1ull << 52 | ieee_mantissa;
+    }
+    bool accept_bounds = (m2 & 1) == 0;
+
+    // 区间 [mv - mm_shift - 1, mv + 2] / 4 * 2^e2: 尾数为 2 的幂时下侧间隔只有一半
+    uint64_t mv = 4 * m2;
+    uint32_t mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+    uint64_t vr, vp, vm;
+    int e10;
+    bool vm_trailing_zeros = false;
+    bool vr_trailing_zeros = false;
+    if (e2 >= 0) {
+        int q = log10_pow2(e2) - (e2 > 3);
+        e10 = q;
+        int k = RYU_POW5_BITS + pow5_bits(q) - 1;
+        int i = -e2 + q + k;
+        vr = mul_shift(4 * m2, ryu_pow5_inv[q], i);
+        vp = mul_shift(4 * m2 + 2, ryu_pow5_inv[q], i);
+        vm = mul_shift(4 * m2 - 1 - mm_shift, ryu_pow5_inv[q], i);
+        if (q <= 21) {
+            // 只有 mv 能被 5^q 整除时除法才是精确的, 才可能有末尾的 0
+            if (mv % 5 == 0) {
+                vr_trailing_zeros = pow5_factor(mv) >= q;
+            } else if (accept_bounds) {
+                vm_trailing_zeros = pow5_factor(mv - 1 - mm_shift) >= q;
+            } else {
+                vp -= pow5_factor(mv + 2) >= q;
+            }
+        }
+    } else {
+        int q = log10_pow5(-e2) - (-e2 > 1);
+        e10 = q + e2;
+        int i = -e2 - q;
+        int k = pow5_bits(i) - RYU_POW5_BITS;
+        int j = q - k;
+        vr = mul_shift(4 * m2, ryu_pow5[i], j);
+        vp = mul_shift(4 * m2 + 2, ryu_pow5[i], j);
+        vm = mul_shift(4 * m2 - 1 - mm_shift, ryu_pow5[i], j);
+        if (q <= 1) {
+            vr_trailing_zeros = true;
+            if (accept_bounds) vm_trailing_zeros = mm_shift == 1;
+            else vp--;
+        } else if (q < 63) {
+            vr_trailing_zeros = (mv & ((1ull << q) - 1)) == 0;
+        }
+    }
+
+    // 去掉区间内不需要的低位数字
+    int removed = 0;
+    uint8_t last_removed = 0;
+    uint64_t output;
+    if (vm_trailing_zeros || vr_trailing_zeros) {
+        while (vp / 10 > vm / 10) {
+            vm_trailing_zeros &= vm % 10 == 0;
+            vr_trailing_zeros &= last_removed == 0;
+            last_removed = (uint8_t)(vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        if (vm_trailing_zeros) {
+            while (vm % 10 == 0) {
+                vr_trailing_zeros &= last_removed == 0;
+                last_removed = (uint8_t)(vr % 10);
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
+            }
+        }
+        // 恰好是 ...50..0 时舍入到偶数
+        if (vr_trailing_zeros && last_removed == 5 && vr % 2 == 0) last_removed = 4;
+        output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) || last_removed >= 5);
+    } else {
+        // 常见情况: 不需要跟踪末尾的 0
+        bool round_up = false;
+        if (vp / 100 > vm / 100) {
+            round_up = vr % 100 >= 50;
+            vr /= 100;
+            vp /= 100;
+            vm /= 100;
+            removed += 2;
+        }
+        while (vp / 10 > vm / 10) {
+            round_up = vr % 10 >= 5;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        output = vr + (vr == vm || round_up);
+    }
+    return (Decimal){output, e10 + removed};
+}
+
+size_t knumber_format_double(double value, char* buffer) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bool negative = bits >> 63;
+    uint64_t ieee_mantissa = bits & ((1ull << 52) - 1);
+    uint32_t ieee_exponent = (uint32_t)(bits >> 52) & 0x7FF;
+    char* out = buffer;
+    if (ieee_exponent == 0x7FF) {
+        const char* text = ieee_mantissa ? "nan" : negative ? "-inf" : "inf";
+        size_t length = strlen(text);
+        memcpy(buffer, text, length + 1);
+        return length;
+    }
+    if (negative) *out++ = '-';
+    if (ieee_exponent == 0 && ieee_mantissa == 0) {
+        memcpy(out, "0.0", 4);
+        return (size_t)(out - buffer) + 3;
+    }
+
+    Decimal decimal;
+    if (!small_int_decimal(ieee_mantissa, ieee_exponent, &decimal)) {
+        decimal = ryu_decimal(ieee_mantissa, ieee_exponent);
+    }
+    char digits[20];
+    int count = (int)write_digits_backward(decimal.mantissa, digits + sizeof(digits));
+    const char* d = digits + sizeof(digits) - count;
+    int point = decimal.exponent + count - 1;      // 第一位数字的十进制指数
+
+    if (point < -4 || point >= 16) {
+        // 科学计数法, 指数至少两位 (与 printf 的 %g 相同)
+        *out++ = d[0];
+        if (count > 1) {
+            *out++ = '.';
+            memcpy(out, d + 1, (size_t)count - 1);
+            out += count - 1;
+        }
+        *out++ = 'e';
+        *out++ = point < 0 ? '-' : '+';
+        int magnitude = point < 0 ? -point : point;
+        if (magnitude >= 100) *out++ = (char)('0' + magnitude / 100);
+        memcpy(out, digit_pairs + 2 * (magnitude % 100), 2);
+        out += 2;
+    } else if (decimal.exponent >= 0) {
+        // 整数值: 补上末尾的 0 与 ".0"
+        memcpy(out, d, (size_t)count);
+        out += count;
+        memset(out, '0', (size_t)decimal.exponent);
+        out += decimal.exponent;
+        memcpy(out, ".0", 2);
+        out += 2;
+    } else if (point >= 0) {
+        memcpy(out, d, (size_t)point + 1);
+        out += point + 1;
+        *out++ = '.';
+        memcpy(out, d + point + 1, (size_t)(count - point - 1));
+        out += count - point - 1;
+    } else {
+        memcpy(out, "0.", 2);
+        out += 2;
+        memset(out, '0', (size_t)(-point - 1));
+        out += -point - 1;
+        memcpy(out, d, (size_t)count);
+        out += count;
+    }
+    *out = '\0';
+    return (size_t)(out - buffer);
+}
@@ -0,0 +1,62 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#ifndef KORELIN_KNUMBER_H
+#define KORELIN_KNUMBER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// =============================================================================
+// 数值字面量的解析与数值的格式化
+//
+// 解析: 十进制整数、0x 十六进制与 0b 二进制整数、带小数部分或指数的浮点数, 数字
+// 之间可以用 '_' 分隔 (如 1_000_000)。浮点数按 IEEE 就近舍入得到正确结果: 有效
+// 数字与指数都较小时直接用精确的浮点运算 (Clinger 快速路径), 否则用 Eisel-Lemire
+// 算法以 128 位的 5 的幂近似值计算; 有效数字超过 19 位时交给 strtod。
+//
+// 格式化: 浮点数输出能够精确还原的最短十进制形式 (Ryu 算法), 整数值的浮点数带
+// ".0"; 十进制指数小于 -4 或不小于 16 时使用科学计数法 (如 1e+16、1.5e-07)。
+// 两种算法使用的 128 位幂表在第一次使用时以大整数运算生成。
+// =============================================================================
+
+#define KNUMBER_BUFFER_SIZE 32      // 格式化一个数值所需的缓冲区大小 (含 '\0')
+
+// 解析结果
+typedef enum {
+    KNUMBER_INVALID,    // 不是合法的数值字面量
+    KNUMBER_INT,
+    KNUMBER_DOUBLE,
+    KNUMBER_OVERFLOW,   // 合法的整数, 但超出 long long 的范围 (由大整数表示, 见 kbigint.h)
+} KNumberKind;
+
+// --- 函数声明 ---
+
+/**
+ * @brief 解析数值字面量 (可以带一个正负号)。
+ *        十六进制与二进制整数与十进制相同, 按数值解释 (0xFFFFFFFFFFFFFFFF 超出 long long 的范围)。
+ * @param text 字面量, 不要求以 '\0' 结尾。
+ * @param length 字节数。
+ * @param integer 结果为 KNUMBER_INT 时写入的值。
+ * @param number 结果为 KNUMBER_DOUBLE 时写入的值。
+ * @return 字面量的类型。
+ */
+KNumberKind knumber_parse(const char* text, size_t length, long long* integer, double* number);
+
+/**
+ * @brief 把整数格式化为十进制。
+ * @param buffer 至少 KNUMBER_BUFFER_SIZE 字节。
+ * @return 写入的字节数 (不含 '\0')。
+ */
+size_t knumber_format_int(long long value, char* buffer);
+
+/**
+ * @brief 把浮点数格式化为能够精确还原的最短形式 (inf、-inf 与 nan 原样输出)。
+ * @param buffer 至少 KNUMBER_BUFFER_SIZE 字节。
+ * @return 写入的字节数 (不含 '\0')。
+ */
+size_t knumber_format_double(double value, char* buffer);
+
+#endif //KORELIN_KNUMBER_H
@@ -0,0 +1,723 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "kobject.h"
+#include "kbigint.h"
+#include "knumber.h"
+#include "kric.h"
+#include "krilib.h"
+#include "ksimd.h"
+#include "kstruct.h"
+#include "libs/kchannel.h"
+#include "libs/kmap.h"
+#include "libs/kpersist.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// =============================================================================
+// 字符串
+// =============================================================================
+
+uint32_t kstring_hash(const char* chars, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (uint8_t)chars[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+KString* kstring_alloc(KGCHeap* heap, size_t length) {
+    KString* str = (KString*)kgc_alloc(heap, KOBJ_STRING, sizeof(KString) + length + 1);
+    str->length = length;
+    str->chars[length] = '\0';
+    return str;
+}
+
+void kstring_seal(KString* str) {
+    str->hash = kstring_hash(str->chars, str->length);
+    str->encoding = (uint8_t)ksimd_utf8_classify(str->chars, str->length);
+}
+
+KString* kstring_new(KGCHeap* heap, const char* chars, size_t length) {
+    KString* str = kstring_alloc(heap, length);
+    memcpy(str->chars, chars, length);
+    kstring_seal(str);
+    return str;
+}
+
+// 辅助函数：rope 结点已展平时返回展平的 KString, 否则原样返回
+static KGCObject* rope_resolve(KGCObject* obj) {
+    if (obj->type == KOBJ_ROPE && !((KRope*)obj)->right) return ((KRope*)obj)->left;
+    return obj;
+}
+
+// 辅助函数：字符串对象 (KString 或 rope) 的长度
+static size_t string_length(const KGCObject* obj) {
+    return obj->type == KOBJ_ROPE ? ((const KRope*)obj)->length : ((const KString*)obj)->length;
+}
+
+// 辅助函数：拼接结果的编码。两个合法的 UTF-8 字符串拼接后仍然合法; 有一侧不合法时
+// 结果可能合法 (被截断的多字节字符重新接上), 返回 KSTRING_BINARY 表示需要重新检查
+static uint8_t join_encoding(const KGCObject* left, const KGCObject* right) {
+    uint8_t a = left->type == KOBJ_ROPE ? ((const KRope*)left)->encoding : ((const KString*)left)->encoding;
+    uint8_t b = right->type == KOBJ_ROPE ? ((const KRope*)right)->encoding : ((const KString*)right)->encoding;
+    return a > b ? a : b;
+}
+
+// 辅助函数：按从左到右的顺序访问 rope 的所有片段。rope 可能非常深 (循环中追加形成的
+// 左倾链), 所以用显式的栈代替递归; 遍历期间不分配 GC 对象
+static void rope_for_each(const KGCObject* root, void (*visit)(const KString* piece, void* context),
+                          void* context) {
+    size_t capacity = 64;
+    size_t count = 0;
+    const KGCObject** stack = (const KGCObject**)malloc(capacity * sizeof(*stack));
+    if (!stack) {
+        fprintf(stderr, "Error: malloc failed in rope_for_each\n");
+        exit(EXIT_FAILURE);
+    }
+    stack[count++] = root;
+    while (count > 0) {
+        const KGCObject* node = rope_resolve((KGCObject*)stack[--count]);
+        if (node->type == KOBJ_STRING) {
+            visit((const KString*)node, context);
+            continue;
+        }
+        if (count + 2 > capacity) {
+            capacity *= 2;
+            const KGCObject** grown = (const KGCObject**)realloc(stack, capacity * sizeof(*stack));
+            if (!grown) {
+                fprintf(stderr, "Error: realloc failed in rope_for_each\n");
+                exit(EXIT_FAILURE);
+            }
+            stack = grown;
+        }
+        // 先压入右侧, 左侧先出栈
+        stack[count++] = ((const KRope*)node)->right;
+        stack[count++] = ((const KRope*)node)->left;
+    }
+    free(stack);
+}
+
+// 辅助函数：展平时把片段依次复制到目标缓冲区
+static void copy_piece(const KString* piece, void* context) {
+    char** cursor = (char**)context;
+    memcpy(*cursor, piece->chars, piece->length);
+    *cursor += piece->length;
+}
+
+// 辅助函数：创建 left + right 两段内容组成的 KString
+static KString* string_join(KGCHeap* heap, const KString* left, const KString* right) {
+    KString* str = kstring_alloc(heap, left->length + right->length);
+    memcpy(str->chars, left->chars, left->length);
+    memcpy(str->chars + left->length, right->chars, right->length);
+    uint8_t encoding = join_encoding(&left->obj, &right->obj);
+    if (encoding == KSTRING_BINARY) {
+        kstring_seal(str);
+    } else {
+        str->hash = kstring_hash(str->chars, str->length);
+        str->encoding = encoding;
+    }
+    return str;
+}
+
+// 辅助函数：创建 rope 结点
+static KRope* rope_new(KGCHeap* heap, KGCObject* left, KGCObject* right) {
+    KRope* rope = (KRope*)kgc_alloc(heap, KOBJ_ROPE, sizeof(KRope));
+    rope->length = string_length(left) + string_length(right);
+    rope->encoding = join_encoding(left, right);
+    rope->left = left;
+    rope->right = right;
+    return rope;
+}
+
+KValue kstring_concat(KGCHeap* heap, KValue left, KValue right) {
+    KGCObject* a = rope_resolve(left.as.object);
+    KGCObject* b = rope_resolve(right.as.object);
+    if (string_length(a) == 0) return KVALUE_OBJECT(b);
+    if (string_length(b) == 0) return KVALUE_OBJECT(a);
+
+    // 分配期间 a 与 b 可能只被调用者的局部变量引用
+    kgc_push_root(heap, a);
+    kgc_push_root(heap, b);
+    KGCObject* result;
+    if (string_length(a) + string_length(b) <= KROPE_FLAT_MAX) {
+        // 不超过 KROPE_FLAT_MAX 的 rope 不存在, 两侧都是 KString
+        result = &string_join(heap, (KString*)a, (KString*)b)->obj;
+    } else if (a->type == KOBJ_ROPE && b->type == KOBJ_STRING && ((KRope*)a)->right->type == KOBJ_STRING &&
+               string_length(((KRope*)a)->right) + string_length(b) <= KROPE_FLAT_MAX) {
+        // 逐段追加短字符串时把它合并到左侧最右端的短片段中, 避免每个字符都成为一个结点
+        KString* tail = string_join(heap, (KString*)((KRope*)a)->right, (KString*)b);
+        kgc_push_root(heap, &tail->obj);
+        result = &rope_new(heap, ((KRope*)a)->left, &tail->obj)->obj;
+        kgc_pop_roots(heap, 1);
+    } else {
+        result = &rope_new(heap, a, b)->obj;
+    }
+    kgc_pop_roots(heap, 2);
+    return KVALUE_OBJECT(result);
+}
+
+KString* kstring_flatten(KGCHeap* heap, KValue value) {
+    KGCObject* obj = rope_resolve(value.as.object);
+    if (obj->type == KOBJ_STRING) return (KString*)obj;
+
+    KRope* rope = (KRope*)obj;
+    kgc_push_root(heap, &rope->obj);
+    KString* str = kstring_alloc(heap, rope->length);
+    kgc_pop_roots(heap, 1);
+    char* cursor = str->chars;
+    rope_for_each(&rope->obj, copy_piece, &cursor);
+    if (rope->encoding == KSTRING_BINARY) {
+        kstring_seal(str);
+    } else {
+        str->hash = kstring_hash(str->chars, str->length);
+        str->encoding = rope->encoding;
+    }
+
+    // 记录展平的结果, 两侧的片段不再被引用
+    rope->left = &str->obj;
+    rope->right = NULL;
+    kgc_write_barrier(heap, &rope->obj, &str->obj);
+    return str;
+}
+
+static void rope_trace(KGCTracer* tracer, KGCObject* obj) {
+    KRope* rope = (KRope*)obj;
+    kgc_visit_object(tracer, &rope->left);
+    if (rope->right) kgc_visit_object(tracer, &rope->right);
+}
+
+// =============================================================================
+// 字符串构造器
+// =============================================================================
+
+static size_t string_builder_external_size(const KGCObject* obj) {
+    return ((const KStringBuilder*)obj)->capacity;
+}
+
+static void string_builder_finalize(KGCHeap* heap, KGCObject* obj) {
+    KStringBuilder* builder = (KStringBuilder*)obj;
+    kgc_account_external(heap, -(ptrdiff_t)builder->capacity);
+    free(builder->data);
+}
+
+// 辅助函数：确保构造器至少能容纳 capacity 个字节
+static void string_builder_reserve(KGCHeap* heap, KStringBuilder* builder, size_t capacity) {
+    if (capacity <= builder->capacity) return;
+    size_t new_capacity = builder->capacity ? builder->capacity : 16;
+    while (new_capacity < capacity) new_capacity *= 2;
+    char* data = (char*)realloc(builder->data, new_capacity);
+    if (!data) {
+        fprintf(stderr, "Error: realloc failed in string_builder_reserve\n");
+        exit(EXIT_FAILURE);
+    }
+    kgc_account_external(heap, (ptrdiff_t)(new_capacity - builder->capacity));
+    builder->data = data;
+    builder->capacity = new_capacity;
+}
+
+KStringBuilder* kstring_builder_new(KGCHeap* heap, size_t capacity) {
+    KStringBuilder* builder = (KStringBuilder*)kgc_alloc(heap, KOBJ_STRING_BUILDER, sizeof(KStringBuilder));
+    builder->data = NULL;
+    builder->length = 0;
+    builder->capacity = 0;
+    string_builder_reserve(heap, builder, capacity);
+    return builder;
+}
+
+void kstring_builder_append(KGCHeap* heap, KStringBuilder* builder, const char* chars, size_t length) {
+    string_builder_reserve(heap, builder, builder->length + length);
+    memcpy(builder->data + builder->length, chars, length);
+    builder->length += length;
+}
+
+// =============================================================================
+// 数组
+// =============================================================================
+
+static void array_trace(KGCTracer* tracer, KGCObject* obj) {
+    KArray* array = (KArray*)obj;
+    if (array->kind != KELEM_VALUE) return;
+    for (size_t i = 0; i < array->count; i++) {
+        kvalue_visit(tracer, &array->items.values[i]);
+    }
+}
+
+// 只有装箱的元素是引用槽
+static size_t array_slot_count(const KGCObject* obj) {
+    const KArray* array = (const KArray*)obj;
+    return array->kind == KELEM_VALUE ? array->count : 0;
+}
+
+static void array_trace_range(KGCTracer* tracer, KGCObject* obj, size_t begin, size_t end) {
+    KArray* array = (KArray*)obj;
+    for (size_t i = begin; i < end; i++) {
+        kvalue_visit(tracer, &array->items.values[i]);
+    }
+}
+
+static size_t array_external_size(const KGCObject* obj) {
+    const KArray* array = (const KArray*)obj;
+    return array->capacity * kelement_size(array->kind);
+}
+
+static void array_finalize(KGCHeap* heap, KGCObject* obj) {
+    KArray* array = (KArray*)obj;
+    kgc_account_external(heap, -(ptrdiff_t)array_external_size(obj));
+    free(array->items.data);
+}
+
+void karray_reserve(KGCHeap* heap, KArray* array, size_t capacity) {
+    if (capacity <= array->capacity) return;
+    size_t new_capacity = array->capacity ? array->capacity : 8;
+    while (new_capacity < capacity) new_capacity *= 2;
+
+    size_t element_size = kelement_size(array->kind);
+    void* new_items = realloc(array->items.data, new_capacity * element_size);
+    if (!new_items) {
+        fprintf(stderr, "Error: realloc failed in karray_reserve\n");
+        exit(EXIT_FAILURE);
+    }
+    kgc_account_external(heap, (ptrdiff_t)((new_capacity - array->capacity) * element_size));
+    array->items.data = new_items;
+    array->capacity = new_capacity;
+}
+
+KArray* karray_new(KGCHeap* heap, size_t capacity) {
+    KArray* array = (KArray*)kgc_alloc(heap, KOBJ_ARRAY, sizeof(KArray));
+    array->kind = KELEM_VALUE;
+    array->items.data = NULL;
+    array->count = 0;
+    array->capacity = 0;
+    karray_reserve(heap, array, capacity);
+    return array;
+}
+
+KArray* ktyped_array_new(KGCHeap* heap, KElementKind kind, size_t count) {
+    KArray* array = (KArray*)kgc_alloc(heap, KOBJ_TYPED_ARRAY, sizeof(KArray));
+    array->kind = kind;
+    array->items.data = NULL;
+    array->count = 0;
+    array->capacity = 0;
+    karray_reserve(heap, array, count);
+    if (count > 0) memset(array->items.data, 0, count * kelement_size(kind));
+    array->count = count;
+    return array;
+}
+
+KArray* karray_new_like(KGCHeap* heap, const KArray* source, size_t count) {
+    KArray* array = (KArray*)kgc_alloc(heap, source->obj.type, sizeof(KArray));
+    array->kind = source->kind;
+    array->items.data = NULL;
+    array->count = 0;
+    array->capacity = 0;
+    karray_reserve(heap, array, count);
+    array->count = count;
+    return array;
+}
+
+// 能够精确表示为 double 的整数的绝对值上界
+#define KARRAY_EXACT_INT ((long long)1 << 53)
+
+// 辅助函数：整数能否精确表示为 double
+static bool exact_in_double(long long value) {
+    return value >= -KARRAY_EXACT_INT && value <= KARRAY_EXACT_INT;
+}
+
+// 辅助函数：把普通数组转换为 kind 形式。非空数组只会由 KELEM_INT64 扩宽为 KELEM_FLOAT64
+// 或转换为 KELEM_VALUE, 空数组可以转换为任意形式
+static void array_convert(KGCHeap* heap, KArray* array, KElementKind kind) {
+    size_t old_size = kelement_size(array->kind);
+    size_t new_size = kelement_size(kind);
+    void* items = NULL;
+    if (array->capacity > 0) {
+        items = malloc(array->capacity * new_size);
+        if (!items) {
+            fprintf(stderr, "Error: malloc failed in array_convert\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (kind == KELEM_FLOAT64) {
+        for (size_t i = 0; i < array->count; i++) {
+            ((double*)items)[i] = (double)array->items.i64[i];
+        }
+    } else {
+        // 数值装箱后不引用任何对象, 不需要写屏障
+        for (size_t i = 0; i < array->count; i++) {
+            ((KValue*)items)[i] = karray_get(array, i);
+        }
+    }
+    free(array->items.data);
+    kgc_account_external(heap, (ptrdiff_t)(array->capacity * new_size) - (ptrdiff_t)(array->capacity * old_size));
+    array->items.data = items;
+    array->kind = kind;
+}
+
+// 辅助函数：int64 形式的数组能否不损失精度地扩宽为 double
+static bool array_widens(const KArray* array) {
+    KSimdScalar min, max;
+    ksimd_min_max(KELEM_INT64, array->items.data, array->count, &min, &max);
+    return exact_in_double(min.i64) && exact_in_double(max.i64);
+}
+
+// 辅助函数：写入 value 之前调整普通数组的存储形式。int 与 double 混合时存为 double,
+// 只有整数无法精确表示为 double 时才装箱
+static void array_adapt(KGCHeap* heap, KArray* array, KValue value) {
+    KElementKind wanted = value.type == KVAL_INT      ? KELEM_INT64
+                          : value.type == KVAL_DOUBLE ? KELEM_FLOAT64
+                                                      : KELEM_VALUE;
+    if (wanted == array->kind) return;
+    if (array->count == 0) {
+        array_convert(heap, array, wanted);
+    } else if (array->kind == KELEM_FLOAT64 && wanted == KELEM_INT64 && exact_in_double(value.as.integer)) {
+        return;     // 由 array_store 转换为 double
+    } else if (array->kind == KELEM_INT64 && wanted == KELEM_FLOAT64 && array_widens(array)) {
+        array_convert(heap, array, KELEM_FLOAT64);
+    } else if (array->kind != KELEM_VALUE) {
+        array_convert(heap, array, KELEM_VALUE);
+    }
+}
+
+// 辅助函数：按元素形式写入一个值, 类型不匹配时返回 false。整数按元素宽度回绕
+static bool array_store(KArray* array, size_t index, KValue value) {
+    switch (array->kind) {
+        case KELEM_VALUE:
+            array->items.values[index] = value;
+            return true;
+        case KELEM_FLOAT64:
+            if (value.type == KVAL_DOUBLE) {
+                array->items.f64[index] = value.as.number;
+                return true;
+            }
+            if (value.type != KVAL_INT) return false;
+            array->items.f64[index] = (double)value.as.integer;
+            return true;
+        case KELEM_INT64:
+            if (value.type != KVAL_INT) return false;
+            array->items.i64[index] = value.as.integer;
+            return true;
+        case KELEM_INT32:
+            if (value.type != KVAL_INT) return false;
+            array->items.i32[index] = (int32_t)(uint32_t)value.as.integer;
+            return true;
+        case KELEM_UINT8:
+            if (value.type != KVAL_INT) return false;
+            array->items.u8[index] = (uint8_t)value.as.integer;
+            return true;
+    }
+    return false;
+}
+
+bool karray_push(KGCHeap* heap, KArray* array, KValue value) {
+    if (array->obj.flags & KGC_FLAG_SHARED) return false;
+    if (array->obj.type == KOBJ_ARRAY) {
+        array_adapt(heap, array, value);
+    }
+    karray_reserve(heap, array, array->count + 1);
+    if (!array_store(array, array->count, value)) return false;
+    array->count++;
+    if (array->kind == KELEM_VALUE) kvalue_write_barrier(heap, &array->obj, value);
+    return true;
+}
+
+bool karray_set(KGCHeap* heap, KArray* array, size_t index, KValue value) {
+    if (array->obj.flags & KGC_FLAG_SHARED) return false;
+    if (array->obj.type == KOBJ_ARRAY) {
+        array_adapt(heap, array, value);
+    }
+    if (!array_store(array, index, value)) return false;
+    if (array->kind == KELEM_VALUE) kvalue_write_barrier(heap, &array->obj, value);
+    return true;
+}
+
+const char* kelement_kind_name(KElementKind kind) {
+    switch (kind) {
+        case KELEM_VALUE: return "value";
+        case KELEM_INT64: return "int64";
+        case KELEM_FLOAT64: return "float64";
+        case KELEM_INT32: return "int32";
+        case KELEM_UINT8: return "uint8";
+    }
+    return "?";
+}
+
+// =============================================================================
+// 值的比较与输出
+// =============================================================================
+
+bool kvalue_equals(KValue a, KValue b) {
+    if (a.type == KVAL_INT && b.type == KVAL_DOUBLE) return (double)a.as.integer == b.as.number;
+    if (a.type == KVAL_DOUBLE && b.type == KVAL_INT) return a.as.number == (double)b.as.integer;
+    // 大整数一定超出 int 的范围, 只可能与大整数或 double 相等
+    if (kvalue_is_object_type(a, KOBJ_BIGINT) && b.type == KVAL_DOUBLE) {
+        return kbigint_to_double((const KBigInt*)a.as.object) == b.as.number;
+    }
+    if (a.type == KVAL_DOUBLE && kvalue_is_object_type(b, KOBJ_BIGINT)) {
+        return a.as.number == kbigint_to_double((const KBigInt*)b.as.object);
+    }
+    if (a.type != b.type) return false;
+
+    switch (a.type) {
+        case KVAL_NULL: return true;
+        case KVAL_BOOL: return a.as.boolean == b.as.boolean;
+        case KVAL_INT: return a.as.integer == b.as.integer;
+        case KVAL_DOUBLE: return a.as.number == b.as.number;
+        case KVAL_OBJECT: break;
+    }
+    if (a.as.object == b.as.object) return true;
+    if (a.as.object->type != b.as.object->type) return false;
+    if (a.as.object->type == KOBJ_STRING) {
+        const KString* x = (const KString*)a.as.object;
+        const KString* y = (const KString*)b.as.object;
+        return x->length == y->length && x->hash == y->hash && memcmp(x->chars, y->chars, x->length) == 0;
+    }
+    if (a.as.object->type == KOBJ_STRUCT) {
+        const KStruct* x = (const KStruct*)a.as.object;
+        const KStruct* y = (const KStruct*)b.as.object;
+        return x->type == y->type && kstruct_equals(x->type, x->data, y->data);
+    }
+    if (a.as.object->type == KOBJ_BIGINT) return kbigint_compare(a, b) == 0;
+    return false;
+}
+
+const char* kvalue_type_name(KValue value) {
+    switch (value.type) {
+        case KVAL_NULL: return "null";
+        case KVAL_BOOL: return "bool";
+        case KVAL_INT: return "int";
+        case KVAL_DOUBLE: return "double";
+        case KVAL_OBJECT: break;
+    }
+    switch (value.as.object->type) {
+        case KOBJ_STRING: case KOBJ_ROPE: return "string";
+        case KOBJ_BIGINT: return "int";
+        case KOBJ_STRING_BUILDER: return "string builder";
+        case KOBJ_ARRAY: return "array";
+        case KOBJ_STRUCT: return ((const KStruct*)value.as.object)->type->name;
+        case KOBJ_STRUCT_ARRAY: return "struct array";
+        case KOBJ_FUNCTION: return "function";
+        case KOBJ_NATIVE: return "native function";
+        case KOBJ_COROUTINE: return "coroutine";
+        case KOBJ_MAP: return "map";
+        case KOBJ_CONCURRENT_MAP: return "concurrent map";
+        case KOBJ_CHANNEL: return "channel";
+        case KOBJ_PMAP: return ((const KPMap*)value.as.object)->edit ? "transient map" : "persistent map";
+        case KOBJ_PVECTOR: return ((const KPVector*)value.as.object)->edit ? "transient vector" : "persistent vector";
+        case KOBJ_TYPED_ARRAY:
+            switch (((const KArray*)value.as.object)->kind) {
+                case KELEM_INT64: return "int64 array";
+                case KELEM_FLOAT64: return "float64 array";
+                case KELEM_INT32: return "int32 array";
+                case KELEM_UINT8: return "uint8 array";
+                default: return "array";
+            }
+        default: return "object";
+    }
+}
+
+// 辅助函数：输出 rope 的一个片段
+static void print_piece(const KString* piece, void* context) {
+    fwrite(piece->chars, 1, piece->length, (FILE*)context);
+}
+
+// 辅助函数：输出一个值, depth 限制嵌套数组的输出深度 (数组可能包含自身)
+static void print_value(FILE* out, KValue value, int depth) {
+    switch (value.type) {
+        case KVAL_NULL: fputs("null", out); return;
+        case KVAL_BOOL: fputs(value.as.boolean ? "true" : "false", out); return;
+        case KVAL_INT: {
+            char buffer[KNUMBER_BUFFER_SIZE];
+            fwrite(buffer, 1, knumber_format_int(value.as.integer, buffer), out);
+            return;
+        }
+        case KVAL_DOUBLE: {
+            // 能够精确还原的最短形式, 整数值的浮点数带上 ".0", 与整数区分
+            char buffer[KNUMBER_BUFFER_SIZE];
+            fwrite(buffer, 1, knumber_format_double(value.as.number, buffer), out);
+            return;
+        }
+        case KVAL_OBJECT: break;
+    }
+
+    KGCObject* obj = value.as.object;
+    switch (obj->type) {
+        case KOBJ_STRING: {
+            const KString* str = (const KString*)obj;
+            fwrite(str->chars, 1, str->length, out);
+            break;
+        }
+        case KOBJ_ROPE:
+            rope_for_each(obj, print_piece, out);
+            break;
+        case KOBJ_STRING_BUILDER: {
+            const KStringBuilder* builder = (const KStringBuilder*)obj;
+            fwrite(builder->data, 1, builder->length, out);
+            break;
+        }
+        case KOBJ_BIGINT: {
+            size_t length;
+            char* digits = kbigint_to_chars((const KBigInt*)obj, &length);
+            fwrite(digits, 1, length, out);
+            free(digits);
+            break;
+        }
+        case KOBJ_ARRAY: case KOBJ_TYPED_ARRAY: {
+            const KArray* array = (const KArray*)obj;
+            if (depth > 16) {
+                fputs("[...]", out);
+                break;
+            }
+            fputc('[', out);
+            for (size_t i = 0; i < array->count; i++) {
+                if (i) fputs(", ", out);
+                print_value(out, karray_get(array, i), depth + 1);
+            }
+            fputc(']', out);
+            break;
+        }
+        case KOBJ_MAP: {
+            const KMap* map = (const KMap*)obj;
+            if (depth > 16) {
+                fputs("{...}", out);
+                break;
+            }
+            fputc('{', out);
+            size_t cursor = 0;
+            KValue key, item;
+            for (bool first = true; kmap_next(map, &cursor, &key, &item); first = false) {
+                if (!first) fputs(", ", out);
+                print_value(out, key, depth + 1);
+                fputs(": ", out);
+                print_value(out, item, depth + 1);
+            }
+            fputc('}', out);
+            break;
+        }
+        case KOBJ_PMAP: {
+            if (depth > 16) {
+                fputs("{...}", out);
+                break;
+            }
+            fputc('{', out);
+            KPMapIter iter;
+            KValue key, item;
+            kpmap_iter_init((const KPMap*)obj, &iter);
+            for (bool first = true; kpmap_iter_next(&iter, &key, &item); first = false) {
+                if (!first) fputs(", ", out);
+                print_value(out, key, depth + 1);
+                fputs(": ", out);
+                print_value(out, item, depth + 1);
+            }
+            fputc('}', out);
+            break;
+        }
+        case KOBJ_PVECTOR: {
+            const KPVector* vector = (const KPVector*)obj;
+            if (depth > 16) {
+                fputs("[...]", out);
+                break;
+            }
+            fputc('[', out);
+            for (size_t i = 0; i < vector->count; i++) {
+                if (i) fputs(", ", out);
+                print_value(out, kpvector_get(vector, i), depth + 1);
+            }
+            fputc(']', out);
+            break;
+        }
+        case KOBJ_STRUCT: {
+            const KStruct* st = (const KStruct*)obj;
+            kstruct_print(out, st->type, st->data);
+            break;
+        }
+        case KOBJ_STRUCT_ARRAY: {
+            const KStructArray* array = (const KStructArray*)obj;
+            fprintf(out, "<%s[%zu]>", array->type->name, array->count);
+            break;
+        }
+        case KOBJ_CONCURRENT_MAP:
+            fprintf(out, "<concurrent map (%zu)>", kcmap_count(((const KConcurrentMap*)obj)->shared));
+            break;
+        case KOBJ_CHANNEL:
+            fprintf(out, "<channel (%zu)>", kchan_count(((const KChannel*)obj)->shared));
+            break;
+        case KOBJ_FUNCTION:
+            fprintf(out, "<func %s>", ((const KFunction*)obj)->proto->name);
+            break;
+        case KOBJ_NATIVE:
+            fprintf(out, "<native %s>", ((const KNative*)obj)->native->name);
+            break;
+        case KOBJ_COROUTINE:
+            fputs(((const KCoroutine*)obj)->done ? "<coroutine (done)>" : "<coroutine>", out);
+            break;
+        default:
+            fprintf(out, "<object %p>", (void*)obj);
+            break;
+    }
+}
+
+void kvalue_print(FILE* out, KValue value) {
+    print_value(out, value, 0);
+}
+
+KString* kvalue_to_string(KGCHeap* heap, KValue value) {
+    if (kvalue_is_string(value)) return kstring_flatten(heap, value);
+
+    char* buffer = NULL;
+    size_t length = 0;
+    FILE* out = open_memstream(&buffer, &length);
+    if (!out) {
+        fprintf(stderr, "Error: open_memstream failed in kvalue_to_string\n");
+        exit(EXIT_FAILURE);
+    }
+    kvalue_print(out, value);
+    fclose(out);
+    KString* str = kstring_new(heap, buffer, length);
+    free(buffer);
+    return str;
+}
+
+// =============================================================================
+// 类型注册
+// =============================================================================
+
+static const KGCTypeInfo string_type = {.name = "string", .trace = NULL, .finalize = NULL};
+static const KGCTypeInfo rope_type = {.name = "rope", .trace = rope_trace, .finalize = NULL};
+static const KGCTypeInfo string_builder_type = {
+    .name = "string builder",
+    .trace = NULL,
+    .finalize = string_builder_finalize,
+    .external_size = string_builder_external_size,
+};
+static const KGCTypeInfo array_type = {
+    .name = "array",
+    .trace = array_trace,
+    .finalize = array_finalize,
+    .external_size = array_external_size,
+    .slot_count = array_slot_count,
+    .trace_range = array_trace_range,
+};
+static const KGCTypeInfo typed_array_type = {
+    .name = "typed array",
+    .trace = NULL,
+    .finalize = array_finalize,
+    .external_size = array_external_size,
+};
+
+void kobject_init_types(void) {
+    kgc_register_type(KOBJ_STRING, &string_type);
+    kgc_register_type(KOBJ_ROPE, &rope_type);
+    kgc_register_type(KOBJ_STRING_BUILDER, &string_builder_type);
+    kgc_register_type(KOBJ_ARRAY, &array_type);
+    kgc_register_type(KOBJ_TYPED_ARRAY, &typed_array_type);
+    kbigint_init_types();
+    kstruct_init_types();
+    kmap_init_types();
+    kpersist_init_types();
+    kchannel_init_types();
+}
@@ -0,0 +1,364 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#ifndef KORELIN_KOBJECT_H
+#define KORELIN_KOBJECT_H
+
+#include "kgc.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// =============================================================================
+// 运行时值与对象模型
+// =============================================================================
+
+// 运行时值的类型
+typedef enum {
+    KVAL_NULL,
+    KVAL_BOOL,
+    KVAL_INT,
+    KVAL_DOUBLE,
+    KVAL_OBJECT,    // 指向 GC 堆中的对象
+} KValueType;
+
+// 运行时值 (小值直接内联存储, 其余为堆对象引用)
+typedef struct KValue {
+    KValueType type;
+    union {
+        bool boolean;
+        long long integer;
+        double number;
+        KGCObject* object;
+    } as;
+} KValue;
+
+// GC 对象类型 id
+typedef enum {
+    KOBJ_STRING = 1,
+    KOBJ_ARRAY,
+    KOBJ_STRUCT,        // 单独的结构体值, 见 kstruct.h
+    KOBJ_STRUCT_ARRAY,  // 元素内联存放的结构体数组
+    KOBJ_FUNCTION,      // 脚本函数
+    KOBJ_NATIVE,        // 原生函数
+    KOBJ_TYPED_ARRAY,   // 元素类型固定的数值数组, 与 KOBJ_ARRAY 共用 KArray
+    KOBJ_MAP,           // 哈希表, 见 libs/kmap.h
+    KOBJ_PMAP,          // 持久化字典, 见 libs/kpersist.h
+    KOBJ_PVECTOR,       // 持久化向量
+    KOBJ_HAMT_NODE,     // 持久化字典的节点
+    KOBJ_VECTOR_NODE,   // 持久化向量的节点
+    KOBJ_CONCURRENT_MAP, // 并发哈希表的句柄, 见 libs/kmap.h
+    KOBJ_ROPE,          // 尚未展平的拼接字符串
+    KOBJ_STRING_BUILDER, // 字符串构造器
+    KOBJ_BIGINT,        // 超出 64 位的整数, 见 kbigint.h
+    KOBJ_COROUTINE,     // spawn 返回的协程句柄, 见 kvm.h
+    KOBJ_CHANNEL,       // 跨虚拟机通道的句柄, 见 libs/kchannel.h
+} KObjectType;
+
+// 字符串内容的编码, 创建时检查一次并记录在字符串中
+typedef enum {
+    KSTRING_ASCII,      // 只含 ASCII 字符: 字节下标就是字符下标
+    KSTRING_UTF8,       // 合法的 UTF-8, 含多字节字符
+    KSTRING_BINARY,     // 不是合法的 UTF-8 (任意字节)
+} KStringEncoding;
+
+// 字符串对象 (不可变, 内容紧跟在对象头之后)
+typedef struct KString {
+    KGCObject obj;
+    size_t length;
+    uint32_t hash;
+    uint8_t encoding;   // KStringEncoding
+    char chars[];       // 以 '\0' 结尾
+} KString;
+
+// 拼接字符串 (rope): 字符串拼接只创建一个引用两侧的结点, 不复制内容, 循环中反复追加
+// 的总开销是线性的。结点在第一次按下标访问、作为键哈希或比较时展平为 KString, 展平
+// 的结果记录在结点中 (left 指向它, right 为 NULL), 之后直接使用。
+// rope 只出现在虚拟机的栈、变量与容器中: 原生函数收到的参数和结构体的字符串字段都已展平。
+#define KROPE_FLAT_MAX 256      // 拼接结果不超过这个长度时直接复制为 KString
+
+typedef struct KRope {
+    KGCObject obj;
+    size_t length;
+    uint8_t encoding;   // 由两侧推出; KSTRING_BINARY 表示展平时需要重新检查
+    KGCObject* left;    // KString 或 KRope
+    KGCObject* right;   // KString 或 KRope, 已展平时为 NULL
+} KRope;
+
+// 字符串构造器: 可变的字符缓冲区, 容量按倍数增长, 追加的均摊开销为 O(1)
+typedef struct KStringBuilder {
+    KGCObject obj;
+    char* data;         // 单独分配
+    size_t length;
+    size_t capacity;
+} KStringBuilder;
+
+// 数组元素的存储形式
+typedef enum {
+    KELEM_VALUE,        // 装箱的 KValue, 普通数组的通用形式
+    KELEM_INT64,        // 原始的 int64_t
+    KELEM_FLOAT64,      // 原始的 double
+    KELEM_INT32,        // 以下两种只用于类型数组
+    KELEM_UINT8,
+} KElementKind;
+
+// 数组对象 (元素缓冲区单独分配)
+//
+// 普通数组 (KOBJ_ARRAY) 只含 int 或只含 double 时以 KELEM_INT64/KELEM_FLOAT64
+// 的形式存放原始数值, 不装箱、不需要追踪。int 与 double 混合时存为 double: 写入 double
+// 时 int64 形式整体扩宽, 写入 double 形式的 int 转换为 double (之后读出的是 double);
+// 只有整数超出 ±2^53、无法精确表示时才装箱。写入其他类型的值时整体转换为
+// KELEM_VALUE, 之后不再转换回来。空数组的形式由第一个追加的元素决定。
+// 类型数组 (KOBJ_TYPED_ARRAY) 的元素类型创建后不变, 写入的值按元素类型转换。
+// 冻结的类型数组 (带有 KGC_FLAG_SHARED, 见 libs/kchannel.h) 只读, 写入与追加都会失败。
+typedef struct KArray {
+    KGCObject obj;
+    KElementKind kind;
+    union {
+        void* data;
+        KValue* values;     // KELEM_VALUE
+        int64_t* i64;       // KELEM_INT64
+        double* f64;        // KELEM_FLOAT64
+        int32_t* i32;       // KELEM_INT32
+        uint8_t* u8;        // KELEM_UINT8
+    } items;
+    size_t count;
+    size_t capacity;        // 以元素个数计
+} KArray;
+
+struct KProto;
+struct KProgram;
+struct KFieldCache;
+struct KriNative;
+
+// 脚本函数: 共享只读的 KProto 与常量表, 嵌套的函数对象和字段内联缓存则属于各自的虚拟机
+typedef struct KFunction {
+    KGCObject obj;
+    const struct KProto* proto;
+    const struct KProgram* program; // 所属的程序 (见 kvm.h)
+    const KValue* constants;        // 程序中实例化好的常量表, 函数常量为 null
+    KGCObject** functions;          // 按常量下标存放已创建的嵌套函数, 第一次需要时分配
+    struct KFieldCache* caches;     // proto->cache_count 个字段访问内联缓存
+} KFunction;
+
+// 原生函数
+typedef struct KNative {
+    KGCObject obj;
+    const struct KriNative* native;
+} KNative;
+
+// 协程句柄: 协程结束后只保留结果, 执行状态 (栈与调用帧) 在结束时释放
+typedef struct KCoroutine {
+    KGCObject obj;
+    struct KFiber* fiber;           // 未结束时为协程的执行状态, 结束后为 NULL
+    KValue result;                  // 入口函数的返回值
+    bool done;
+    bool failed;                    // 因运行时错误而结束
+} KCoroutine;
+
+#define KVALUE_NULL ((KValue){.type = KVAL_NULL})
+#define KVALUE_BOOL(v) ((KValue){.type = KVAL_BOOL, .as.boolean = (v)})
+#define KVALUE_INT(v) ((KValue){.type = KVAL_INT, .as.integer = (v)})
+#define KVALUE_DOUBLE(v) ((KValue){.type = KVAL_DOUBLE, .as.number = (v)})
+#define KVALUE_OBJECT(v) ((KValue){.type = KVAL_OBJECT, .as.object = (KGCObject*)(v)})
+
+// 判断值是否为指定类型的对象
+static inline bool kvalue_is_object_type(KValue value, KObjectType type) {
+    return value.type == KVAL_OBJECT && value.as.object && value.as.object->type == type;
+}
+
+/**
+ * @brief 在追踪回调中访问一个值槽 (只有对象值需要追踪)。
+ * @param tracer 追踪器。
+ * @param slot 指向值的指针。
+ */
+static inline void kvalue_visit(KGCTracer* tracer, KValue* slot) {
+    if (slot->type == KVAL_OBJECT) {
+        kgc_visit_object(tracer, &slot->as.object);
+    }
+}
+
+/**
+ * @brief 把值写入容器对象之后调用的写屏障。
+ */
+static inline void kvalue_write_barrier(KGCHeap* heap, KGCObject* parent, KValue value) {
+    if (value.type == KVAL_OBJECT) {
+        kgc_write_barrier(heap, parent, value.as.object);
+    }
+}
+
+// 判断值是否为数组 (普通数组或类型数组)
+static inline bool kvalue_is_array(KValue value) {
+    return kvalue_is_object_type(value, KOBJ_ARRAY) || kvalue_is_object_type(value, KOBJ_TYPED_ARRAY);
+}
+
+// 元素形式对应的每个元素的字节数
+static inline size_t kelement_size(KElementKind kind) {
+    switch (kind) {
+        case KELEM_VALUE: return sizeof(KValue);
+        case KELEM_INT32: return 4;
+        case KELEM_UINT8: return 1;
+        default: return 8;
+    }
+}
+
+/**
+ * @brief 读取数组元素 (原始数值按需装箱)。
+ * @param array 数组。
+ * @param index 下标, 必须小于 array->count。
+ */
+static inline KValue karray_get(const KArray* array, size_t index) {
+    switch (array->kind) {
+        case KELEM_VALUE: return array->items.values[index];
+        case KELEM_INT64: return KVALUE_INT(array->items.i64[index]);
+        case KELEM_FLOAT64: return KVALUE_DOUBLE(array->items.f64[index]);
+        case KELEM_INT32: return KVALUE_INT(array->items.i32[index]);
+        case KELEM_UINT8: return KVALUE_INT(array->items.u8[index]);
+    }
+    return KVALUE_NULL;
+}
+
+// 判断值是否为字符串 (KString 或尚未展平的 rope)
+static inline bool kvalue_is_string(KValue value) {
+    return value.type == KVAL_OBJECT && value.as.object &&
+           (value.as.object->type == KOBJ_STRING || value.as.object->type == KOBJ_ROPE);
+}
+
+// 条件判断: 只有 null 和 false 为假
+static inline bool kvalue_truthy(KValue value) {
+    return !(value.type == KVAL_NULL || (value.type == KVAL_BOOL && !value.as.boolean));
+}
+
+// --- 函数声明 ---
+
+/**
+ * @brief 向回收器注册所有内置对象类型, 在创建任何堆之前调用一次。
+ */
+void kobject_init_types(void);
+
+/**
+ * @brief 计算字符串内容的哈希 (FNV-1a), 与 KString.hash 相同。
+ */
+uint32_t kstring_hash(const char* chars, size_t length);
+
+/**
+ * @brief 创建一个字符串对象 (复制 chars 的内容)。
+ * @param heap 堆。
+ * @param chars 字符串内容, 不要求以 '\0' 结尾。
+ * @param length 字节数。
+ * @return 新的字符串对象。
+ */
+KString* kstring_new(KGCHeap* heap, const char* chars, size_t length);
+
+/**
+ * @brief 分配一个内容未初始化的字符串, 写入 length 个字节后调用 kstring_seal。
+ */
+KString* kstring_alloc(KGCHeap* heap, size_t length);
+
+/**
+ * @brief 内容写入完成后计算字符串的哈希与编码。
+ */
+void kstring_seal(KString* str);
+
+/**
+ * @brief 拼接两个字符串 (KString 或 rope)。结果较短时复制为 KString, 否则创建 rope 结点。
+ * @return 拼接结果, 一侧为空串时直接返回另一侧。
+ */
+KValue kstring_concat(KGCHeap* heap, KValue left, KValue right);
+
+/**
+ * @brief 返回字符串值 (KString 或 rope) 的展平形式, rope 只在第一次调用时复制内容。
+ */
+KString* kstring_flatten(KGCHeap* heap, KValue value);
+
+/**
+ * @brief 创建一个空的字符串构造器。
+ * @param capacity 初始容量 (字节数)。
+ */
+KStringBuilder* kstring_builder_new(KGCHeap* heap, size_t capacity);
+
+/**
+ * @brief 在构造器末尾追加 length 个字节。
+ */
+void kstring_builder_append(KGCHeap* heap, KStringBuilder* builder, const char* chars, size_t length);
+
+/**
+ * @brief 创建一个空数组。
+ * @param heap 堆。
+ * @param capacity 初始容量。
+ * @return 新的数组对象。
+ */
+KArray* karray_new(KGCHeap* heap, size_t capacity);
+
+/**
+ * @brief 创建一个元素类型固定的类型数组, 元素初始化为 0。
+ * @param heap 堆。
+ * @param kind 元素类型, 不能为 KELEM_VALUE。
+ * @param count 元素个数。
+ * @return 新的类型数组对象。
+ */
+KArray* ktyped_array_new(KGCHeap* heap, KElementKind kind, size_t count);
+
+/**
+ * @brief 创建一个与 source 元素形式相同 (普通数组或同类型的类型数组) 的数组,
+ *        包含 count 个未初始化的元素, 用于批量运算的结果。source 不能为 KELEM_VALUE 形式。
+ */
+KArray* karray_new_like(KGCHeap* heap, const KArray* source, size_t count);
+
+/**
+ * @brief 确保数组至少能容纳 capacity 个元素。
+ */
+void karray_reserve(KGCHeap* heap, KArray* array, size_t capacity);
+
+/**
+ * @brief 在数组末尾追加一个元素。
+ * @param heap 数组所在的堆。
+ * @param array 数组。
+ * @param value 要追加的值。
+ * @return 类型数组无法存放该值或已冻结时返回 false, 普通数组总是成功。
+ */
+bool karray_push(KGCHeap* heap, KArray* array, KValue value);
+
+/**
+ * @brief 设置数组指定位置的元素。
+ * @param heap 数组所在的堆。
+ * @param array 数组。
+ * @param index 下标, 必须小于 array->count。
+ * @param value 新的值。
+ * @return 类型数组无法存放该值或已冻结时返回 false, 普通数组总是成功。
+ */
+bool karray_set(KGCHeap* heap, KArray* array, size_t index, KValue value);
+
+/**
+ * @brief 返回元素类型名 ("int32" 等), 用于类型名与错误信息。
+ */
+const char* kelement_kind_name(KElementKind kind);
+
+/**
+ * @brief 判断两个值是否相等: 数字 (含大整数) 按数值比较, 字符串与结构体按内容比较, 其余对象按引用比较。
+ */
+bool kvalue_equals(KValue a, KValue b);
+
+/**
+ * @brief 返回值的类型名 (结构体返回其类型名), 用于错误信息。
+ */
+const char* kvalue_type_name(KValue value);
+
+/**
+ * @brief 以可读的格式输出一个值 (字符串输出原始内容)。
+ * @param out 输出流。
+ * @param value 要输出的值。
+ */
+void kvalue_print(FILE* out, KValue value);
+
+/**
+ * @brief 把值转换为字符串对象 (格式与 kvalue_print 相同)。
+ * @param heap 堆。
+ * @param value 要转换的值。
+ * @return 字符串对象, 值本身是字符串时直接返回 (rope 返回展平的结果)。
+ */
+KString* kvalue_to_string(KGCHeap* heap, KValue value);
+
+#endif //KORELIN_KOBJECT_H
@@ -1,10 +1,57 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "kimage.h"
 #include "korelin.h"
+#include "kric.h"
+#include "ksnapshot.h"
+#include "kvm.h"
 
+// 辅助函数：读取整个源文件, 失败时返回 NULL
+static char* read_source(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+    char* source = size >= 0 ? malloc((size_t)size + 1) : NULL;
+    if (!source) {
+        fclose(file);
+        return NULL;
+    }
+    size_t length = fread(source, 1, (size_t)size, file);
+    source[length] = '\0';
+    fclose(file);
+    return source;
+}
+
+// kric run <file>: 编译并执行源文件, 或从 snapshot() 写入的镜像恢复执行
+static int run_file(const char* path) {
+    if (kimage_probe(path)) return kimage_run(path);
+    char* source = read_source(path);
+    if (!source) {
+        fprintf(stderr, "Could not read file '%s'.\n", path);
+        return 74;
+    }
+    KModule* module = kric_compile(source, path);
+    free(source);
+    if (!module) return 65;
 
+    KorelinVM* vm = kvm_new(NULL);
+    bool ok = kvm_run(vm, module);
+    kvm_free(vm);
+    kric_module_free(module);
+    return ok ? 0 : 70;
+}
 
 // 这个 main 函数只用于测试
 int main(int argc, char *argv[]) {
+    if (argc >= 3 && strcmp(argv[1], "heap") == 0) {
+        return ksnapshot_main(argc - 2, argv + 2);
+    }
+    if (argc >= 3 && strcmp(argv[1], "run") == 0) {
+        return run_file(argv[2]);
+    }
     if (argc < 2) {
         printf("* Welcome to Korelin\n"
        "* (c) 2026 Nexogic. Licensed under the MIT Open Source License.\n"
@@ -13,8 +60,9 @@ int main(int argc, char *argv[]) {
        "  kric <command> [arguments]\n"
        "\nCommands:\n"
        "  build <file_name>    Compile your code to Korelin bytecode.\n"
-       "  run <file_name>      Execute your .kri/.kric/.kar code.\n"
+       "  run <file_name>      Execute your .kri/.kric/.kar code or a snapshot image.\n"
        "  init <project_name>  Initialize a new Korelin project.\n"
+       "  heap <snapshot> [n]  Analyze a heap snapshot (top n retainers).\n"
        "  version              Show the Korelin SDK version.\n"
        "  path                 Show the Korelin installation path.\n", KORELIN_VERSION);
     }
@@ -4,6 +4,8 @@
 
 #include "ast.h"
 #include "klexer.h"
+#include "knumber.h"
+#include "ksimd.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,12 +18,13 @@ typedef struct {
     KorelinLexer lexer;
     KorelinToken current_token;
     KorelinToken peek_token;
-    // 这里可以添加一个错误数组，用于收集解析过程中的错误
+    size_t error_count;     // 解析过程中报告的错误数
 } KorelinParser;
 
 // 初始化 Parser
 void init_parser(KorelinParser* parser, const char* input) {
     init_korelin_lexer(&parser->lexer, input);
+    parser->error_count = 0;
     // 读取两个 Token 来初始化 current 和 peek
     parser->current_token = next_korelin_token(&parser->lexer);
     parser->peek_token = next_korelin_token(&parser->lexer);
@@ -61,21 +64,45 @@ static bool peek_token_is(const KorelinParser* parser, KorelinTokenType type) {
     return parser->peek_token.type == type;
 }
 
+static void next_token(KorelinParser* parser);
+
 // 辅助函数：如果下一个 Token 是指定类型，则消耗它并返回 true，否则返回 false
 static bool expect_peek(KorelinParser* parser, KorelinTokenType type) {
     if (peek_token_is(parser, type)) {
-        // 前进一个 Token
-        parser->current_token = parser->peek_token;
-        parser->peek_token = next_korelin_token(&parser->lexer);
+        next_token(parser); // 前进一个 Token
         return true;
     }
-    fprintf(stderr, "Expected next token to be %d, got %d instead.\n", type, parser->peek_token.type);
+    fprintf(stderr, "Line %d: expected next token to be %d, got %d instead.\n", parser->peek_token.line, type,
+            parser->peek_token.type);
+    parser->error_count++;
     return false;
 }
 
+// 辅助函数：分配 AST 节点
+static void* new_node(size_t size, NodeType type) {
+    Node* node = calloc(1, size);
+    if (!node) {
+        fprintf(stderr, "Error: calloc failed in new_node\n");
+        exit(EXIT_FAILURE);
+    }
+    node->type = type;
+    return node;
+}
+
+// 辅助函数：向节点数组追加一个元素
+static void append_node(Node*** items, size_t* count, Node* item) {
+    Node** new_items = realloc(*items, (*count + 1) * sizeof(Node*));
+    if (!new_items) {
+        fprintf(stderr, "Error: realloc failed in append_node\n");
+        exit(EXIT_FAILURE);
+    }
+    new_items[(*count)++] = item;
+    *items = new_items;
+}
+
 // 前向声明
 static Node* parse_statement(KorelinParser* parser);
-static void next_token(KorelinParser* parser); // 添加 next_token 前向声明
+static Node* parse_statement_kind(KorelinParser* parser);
 
 // 错误恢复：同步解析器状态
 static void synchronize(KorelinParser* parser) {
@@ -86,6 +113,7 @@ static void synchronize(KorelinParser* parser) {
 
         switch (parser->peek_token.type) {
             case KORELIN_CLASS:
+            case KORELIN_STRUCT:
             case KORELIN_FUNC:
             case KORELIN_VAR:
             case KORELIN_LET:
@@ -105,14 +133,18 @@ static void synchronize(KorelinParser* parser) {
 
 // 解析代码块
 static Node* parse_block_statement(KorelinParser* parser) {
-    BlockStatement* block = malloc(sizeof(BlockStatement));
-    block->node.type = NODE_BLOCK_STATEMENT;
+    BlockStatement* block = new_node(sizeof(BlockStatement), NODE_BLOCK_STATEMENT);
     block->statements = NULL;
     block->statement_count = 0;
 
     next_token(parser); // 跳过 '{'
 
     while (!current_token_is(parser, KORELIN_RBRACE) && !current_token_is(parser, KORELIN_EOF)) {
+        // 忽略空语句 (单独的分号)
+        if (current_token_is(parser, KORELIN_SEMICOLON)) {
+            next_token(parser);
+            continue;
+        }
         Node* stmt = parse_statement(parser);
         if (stmt != NULL) {
             size_t new_size = block->statement_count + 1;
@@ -122,8 +154,10 @@ static Node* parse_block_statement(KorelinParser* parser) {
                 block->statements[block->statement_count++] = stmt;
             } else {
                 // Handle allocation error
-                free(stmt); // Avoid leak
+                free_ast(stmt); // Avoid leak
             }
+        } else {
+            synchronize(parser);
         }
         next_token(parser);
     }
@@ -154,39 +188,37 @@ typedef enum {
     PREC_TERM,        // + -
     PREC_FACTOR,      // * / %
     PREC_UNARY,       // ! -
+    PREC_POWER,       // ^ (右结合, 比一元运算符优先: -2^2 为 -(2^2))
     PREC_CALL,        // myFunction(x)
-    PREC_INDEX        // array[index]
+    PREC_INDEX        // array[index], object.member
 } Precedence;
 
-// 获取给定 Token 类型的优先级
-static Precedence peek_precedence(const KorelinParser* parser) {
-    switch (parser->peek_token.type) {
-        case KORELIN_ASSIGN: return PREC_ASSIGNMENT;
+// 获取 Token 类型对应的优先级
+static Precedence token_precedence(KorelinTokenType type) {
+    switch (type) {
+        case KORELIN_ASSIGN: case KORELIN_ADD_ASSIGN: case KORELIN_SUB_ASSIGN:
+        case KORELIN_MUL_ASSIGN: case KORELIN_DIV_ASSIGN:
+            return PREC_ASSIGNMENT;
         case KORELIN_OR: return PREC_OR;
         case KORELIN_AND: return PREC_AND;
         case KORELIN_EQ: case KORELIN_NOT_EQ: return PREC_EQUALS;
         case KORELIN_LT: case KORELIN_GT: case KORELIN_LE: case KORELIN_GE: return PREC_COMPARISON;
         case KORELIN_ADD: case KORELIN_SUB: return PREC_TERM;
         case KORELIN_MUL: case KORELIN_DIV: case KORELIN_MOD: return PREC_FACTOR;
+        case KORELIN_POW: return PREC_POWER;
         case KORELIN_LPAREN: return PREC_CALL;
-        case KORELIN_LBRACKET: return PREC_INDEX;
+        case KORELIN_LBRACKET: case KORELIN_DOT: return PREC_INDEX;
         default: return PREC_LOWEST;
     }
 }
 
+// 获取给定 Token 类型的优先级
+static Precedence peek_precedence(const KorelinParser* parser) {
+    return token_precedence(parser->peek_token.type);
+}
+
 static Precedence current_precedence(const KorelinParser* parser) {
-    switch (parser->current_token.type) {
-        case KORELIN_ASSIGN: return PREC_ASSIGNMENT;
-        case KORELIN_OR: return PREC_OR;
-        case KORELIN_AND: return PREC_AND;
-        case KORELIN_EQ: case KORELIN_NOT_EQ: return PREC_EQUALS;
-        case KORELIN_LT: case KORELIN_GT: case KORELIN_LE: case KORELIN_GE: return PREC_COMPARISON;
-        case KORELIN_ADD: case KORELIN_SUB: return PREC_TERM;
-        case KORELIN_MUL: case KORELIN_DIV: case KORELIN_MOD: return PREC_FACTOR;
-        case KORELIN_LPAREN: return PREC_CALL;
-        case KORELIN_LBRACKET: return PREC_INDEX;
-        default: return PREC_LOWEST;
-    }
+    return token_precedence(parser->current_token.type);
 }
 
 // 解析主表达式
@@ -196,95 +228,259 @@ static Node* parse_expression(KorelinParser* parser, Precedence precedence);
 static Node* parse_grouped_expression(KorelinParser* parser) {
     next_token(parser); // 跳过 '('
     Node* expr = parse_expression(parser, PREC_LOWEST);
-    if (!expect_peek(parser, KORELIN_RPAREN)) {
+    if (!expr || !expect_peek(parser, KORELIN_RPAREN)) {
+        free_ast(expr);
         return NULL;
     }
     return expr;
 }
 
+// 辅助函数：去掉字符串字面量的引号并处理转义序列 (\n \t \r \0 \\ \" \')
+static char* unescape_string(const char* literal, size_t length) {
+    size_t start = length >= 1 ? 1 : 0;
+    size_t end = length >= 2 ? length - 1 : length;
+    char* result = malloc(end - start + 1);
+    if (!result) {
+        fprintf(stderr, "Error: malloc failed in unescape_string\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t out = 0;
+    for (size_t i = start; i < end; i++) {
+        char c = literal[i];
+        if (c == '\\' && i + 1 < end) {
+            c = literal[++i];
+            switch (c) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case '0': c = '\0'; break;
+                default: break;     // \\ \" \' 以及未知转义保留原字符
+            }
+        }
+        result[out++] = c;
+    }
+    result[out] = '\0';
+    return result;
+}
+
+static Node* parse_function_literal(KorelinParser* parser);
+static Node* parse_block_statement(KorelinParser* parser);
+
+// 辅助函数：解析以逗号分隔、以 end 结尾的表达式列表, 当前 Token 为起始的 '(' 或 '['
+static bool parse_expression_list(KorelinParser* parser, KorelinTokenType end, Node*** items, size_t* count) {
+    *items = NULL;
+    *count = 0;
+    if (peek_token_is(parser, end)) {
+        next_token(parser);
+        return true;
+    }
+    do {
+        next_token(parser); // 跳过 '(' '[' 或 ','
+        Node* item = parse_expression(parser, PREC_LOWEST);
+        if (!item) return false;
+        append_node(items, count, item);
+        if (!peek_token_is(parser, KORELIN_COMMA)) break;
+        next_token(parser);
+    } while (true);
+    return expect_peek(parser, end);
+}
+
+// 解析数组字面量 (e.g., [1, "two", x])
+static Node* parse_array_literal(KorelinParser* parser) {
+    ArrayLiteral* array = new_node(sizeof(ArrayLiteral), NODE_ARRAY_LITERAL);
+    if (!parse_expression_list(parser, KORELIN_RBRACKET, &array->elements, &array->element_count)) {
+        free_ast((Node*)array);
+        return NULL;
+    }
+    return (Node*)array;
+}
+
+// 解析字典字面量 (e.g., {"a": 1, 2: x})
+static Node* parse_map_literal(KorelinParser* parser) {
+    MapLiteral* map = new_node(sizeof(MapLiteral), NODE_MAP_LITERAL);
+    if (peek_token_is(parser, KORELIN_RBRACE)) {
+        next_token(parser);
+        return (Node*)map;
+    }
+    do {
+        next_token(parser); // 跳过 '{' 或 ','
+        Node* key = parse_expression(parser, PREC_LOWEST);
+        if (!key || !expect_peek(parser, KORELIN_COLON)) {
+            free_ast(key);
+            free_ast((Node*)map);
+            return NULL;
+        }
+        next_token(parser);
+        Node* value = parse_expression(parser, PREC_LOWEST);
+        if (!value) {
+            free_ast(key);
+            free_ast((Node*)map);
+            return NULL;
+        }
+        size_t count = map->pair_count;
+        append_node(&map->keys, &count, key);
+        append_node(&map->values, &map->pair_count, value);
+        if (!peek_token_is(parser, KORELIN_COMMA)) break;
+        next_token(parser);
+    } while (true);
+    if (!expect_peek(parser, KORELIN_RBRACE)) {
+        free_ast((Node*)map);
+        return NULL;
+    }
+    return (Node*)map;
+}
+
 // 解析基本表达式 (字面量、标识符、分组表达式)
 static Node* parse_primary(KorelinParser* parser) {
     switch (parser->current_token.type) {
-        case KORELIN_INT: {
-            IntegerLiteral* lit = malloc(sizeof(IntegerLiteral));
-            lit->node.type = NODE_INTEGER_LITERAL;
+        case KORELIN_INT:
+        case KORELIN_DOUBLE: {
+            long long integer = 0;
+            double number = 0.0;
+            KNumberKind kind = knumber_parse(parser->current_token.value, parser->current_token.length,
+                                             &integer, &number);
+            if (kind == KNUMBER_INVALID) {
+                fprintf(stderr, "Line %d: invalid numeric literal '%s'.\n", parser->current_token.line,
+                        parser->current_token.value);
+                parser->error_count++;
+            }
+            if (kind != KNUMBER_DOUBLE) {
+                IntegerLiteral* lit = new_node(sizeof(IntegerLiteral), NODE_INTEGER_LITERAL);
+                copy_token_to_ast(&lit->token, &parser->current_token);
+                lit->value = integer;
+                lit->big = kind == KNUMBER_OVERFLOW;    // 超出 64 位, 运行时按 token 创建大整数
+                return (Node*)lit;
+            }
+            DoubleLiteral* lit = new_node(sizeof(DoubleLiteral), NODE_DOUBLE_LITERAL);
             copy_token_to_ast(&lit->token, &parser->current_token);
-            lit->value = atoll(parser->current_token.value);
+            lit->value = number;
             return (Node*)lit;
         }
         case KORELIN_STRING: {
-            StringLiteral* lit = malloc(sizeof(StringLiteral));
-            lit->node.type = NODE_STRING_LITERAL;
+            StringLiteral* lit = new_node(sizeof(StringLiteral), NODE_STRING_LITERAL);
             copy_token_to_ast(&lit->token, &parser->current_token);
-            // 移除首尾的引号
-            if (parser->current_token.length >= 2) {
-                lit->value = k_strndup(parser->current_token.value + 1, parser->current_token.length - 2);
-            } else {
-                lit->value = k_strndup("", 0);
+            // 移除首尾的引号并处理转义
+            lit->value = unescape_string(parser->current_token.value, parser->current_token.length);
+            if (ksimd_utf8_classify(lit->value, strlen(lit->value)) == KSTRING_BINARY) {
+                fprintf(stderr, "Line %d: string literal is not valid UTF-8.\n", parser->current_token.line);
+                parser->error_count++;
             }
             return (Node*)lit;
         }
         case KORELIN_TRUE: case KORELIN_FALSE: {
-            BooleanLiteral* lit = malloc(sizeof(BooleanLiteral));
-            lit->node.type = NODE_BOOLEAN_LITERAL;
+            BooleanLiteral* lit = new_node(sizeof(BooleanLiteral), NODE_BOOLEAN_LITERAL);
             copy_token_to_ast(&lit->token, &parser->current_token);
             lit->value = (parser->current_token.type == KORELIN_TRUE);
             return (Node*)lit;
         }
         case KORELIN_IDENT: {
-            Identifier* ident = malloc(sizeof(Identifier));
-            ident->node.type = NODE_IDENTIFIER;
+            Identifier* ident = new_node(sizeof(Identifier), NODE_IDENTIFIER);
             copy_token_to_ast(&ident->token, &parser->current_token);
             ident->value = k_strndup(parser->current_token.value, parser->current_token.length);
             return (Node*)ident;
         }
         case KORELIN_LPAREN:
             return parse_grouped_expression(parser);
-        // ... 其他 primary，如 func, class, [ ... ]
+        case KORELIN_LBRACKET:
+            return parse_array_literal(parser);
+        case KORELIN_LBRACE:
+            return parse_map_literal(parser);
+        case KORELIN_FUNC:
+            return parse_function_literal(parser);
+        // ... 其他 primary，如 class
         default:
-            fprintf(stderr, "Unexpected token %d in primary expression.\n", parser->current_token.type);
+            fprintf(stderr, "Line %d: unexpected token %d in primary expression.\n", parser->current_token.line,
+                    parser->current_token.type);
+            parser->error_count++;
             return NULL;
     }
 }
 
 // 解析前缀表达式 (e.g., !x, -y)
 static Node* parse_prefix_expression(KorelinParser* parser) {
-    PrefixExpression* expr = malloc(sizeof(PrefixExpression));
-    expr->node.type = NODE_PREFIX_EXPRESSION;
+    PrefixExpression* expr = new_node(sizeof(PrefixExpression), NODE_PREFIX_EXPRESSION);
     expr->op = parser->current_token;
     next_token(parser); // 消耗前缀运算符
     expr->right = parse_expression(parser, PREC_UNARY);
+    if (!expr->right) {
+        free(expr);
+        return NULL;
+    }
     return (Node*)expr;
 }
 
 // 解析中缀表达式 (e.g., x + y)
 static Node* parse_infix_expression(KorelinParser* parser, Node* left) {
-    InfixExpression* expr = malloc(sizeof(InfixExpression));
-    expr->node.type = NODE_INFIX_EXPRESSION;
+    InfixExpression* expr = new_node(sizeof(InfixExpression), NODE_INFIX_EXPRESSION);
     expr->left = left;
     expr->op = parser->current_token;
     Precedence precedence = current_precedence(parser);
     next_token(parser); // 消耗中缀运算符
-    expr->right = parse_expression(parser, precedence);
+    // '^' 右结合: 右侧以较低的优先级解析, 使 a^b^c 为 a^(b^c)
+    expr->right = parse_expression(parser, expr->op.type == KORELIN_POW ? precedence - 1 : precedence);
+    if (!expr->right) {
+        free_ast((Node*)expr);
+        return NULL;
+    }
     return (Node*)expr;
 }
 
 // 解析赋值表达式 (e.g., x = 42)
 static Node* parse_assignment_expression(KorelinParser* parser, Node* left) {
-    AssignmentExpression* expr = malloc(sizeof(AssignmentExpression));
-    expr->node.type = NODE_ASSIGNMENT_EXPRESSION;
+    AssignmentExpression* expr = new_node(sizeof(AssignmentExpression), NODE_ASSIGNMENT_EXPRESSION);
     expr->left = left;
     copy_token_to_ast(&expr->op, &parser->current_token);
     next_token(parser); // 消耗 '='
     // 使用 PREC_LOWEST 以支持右结合性 (e.g. a = b = c)
     expr->right = parse_expression(parser, PREC_LOWEST);
+    if (!expr->right) {
+        free_ast((Node*)expr);
+        return NULL;
+    }
     return (Node*)expr;
 }
 
 
+// 解析函数调用 (e.g., add(1, 2)), 当前 Token 为 '('
+static Node* parse_call_expression(KorelinParser* parser, Node* function) {
+    CallExpression* call = new_node(sizeof(CallExpression), NODE_CALL_EXPRESSION);
+    call->function = function;
+    if (!parse_expression_list(parser, KORELIN_RPAREN, &call->arguments, &call->arg_count)) {
+        free_ast((Node*)call);
+        return NULL;
+    }
+    return (Node*)call;
+}
+
+// 解析索引表达式 (e.g., array[0]), 当前 Token 为 '['
+static Node* parse_index_expression(KorelinParser* parser, Node* left) {
+    IndexExpression* expr = new_node(sizeof(IndexExpression), NODE_INDEX_EXPRESSION);
+    expr->left = left;
+    next_token(parser); // 跳过 '['
+    expr->index = parse_expression(parser, PREC_LOWEST);
+    if (!expr->index || !expect_peek(parser, KORELIN_RBRACKET)) {
+        free_ast((Node*)expr);
+        return NULL;
+    }
+    return (Node*)expr;
+}
+
+// 解析成员访问 (e.g., point.x), 当前 Token 为 '.'
+static Node* parse_member_access(KorelinParser* parser, Node* object) {
+    MemberAccessExpression* expr = new_node(sizeof(MemberAccessExpression), NODE_MEMBER_ACCESS_EXPRESSION);
+    expr->object = object;
+    if (!expect_peek(parser, KORELIN_IDENT)) {
+        free_ast((Node*)expr);
+        return NULL;
+    }
+    copy_token_to_ast(&expr->property, &parser->current_token);
+    return (Node*)expr;
+}
+
 // 主表达式解析循环
 static Node* parse_expression(KorelinParser* parser, Precedence precedence) {
     Node* left = NULL;
+    int line = parser->current_token.line;
 
     // 1. 解析前缀部分
     switch (parser->current_token.type) {
@@ -297,24 +493,40 @@ static Node* parse_expression(KorelinParser* parser, Precedence precedence) {
     }
 
     if (!left) return NULL;
+    left->line = line;
 
     // 2. 循环解析中缀部分
     while (!peek_token_is(parser, KORELIN_SEMICOLON) && precedence < peek_precedence(parser)) {
         switch (parser->peek_token.type) {
             case KORELIN_ADD: case KORELIN_SUB: case KORELIN_MUL: case KORELIN_DIV: case KORELIN_MOD:
+            case KORELIN_POW:
             case KORELIN_EQ: case KORELIN_NOT_EQ: case KORELIN_LT: case KORELIN_GT: case KORELIN_LE: case KORELIN_GE:
             case KORELIN_AND: case KORELIN_OR:
                 next_token(parser); // 前进到中缀运算符
                 left = parse_infix_expression(parser, left);
                 break;
-            case KORELIN_ASSIGN:
-                next_token(parser); // 前进到 '='
+            case KORELIN_ASSIGN: case KORELIN_ADD_ASSIGN: case KORELIN_SUB_ASSIGN:
+            case KORELIN_MUL_ASSIGN: case KORELIN_DIV_ASSIGN:
+                next_token(parser); // 前进到 '=' 或复合赋值运算符
                 left = parse_assignment_expression(parser, left);
                 break;
-            // ... 其他中缀或后缀表达式，如函数调用、数组索引
+            case KORELIN_LPAREN:
+                next_token(parser);
+                left = parse_call_expression(parser, left);
+                break;
+            case KORELIN_LBRACKET:
+                next_token(parser);
+                left = parse_index_expression(parser, left);
+                break;
+            case KORELIN_DOT:
+                next_token(parser);
+                left = parse_member_access(parser, left);
+                break;
             default:
                 return left; // 没有更多中缀表达式了
         }
+        if (!left) return NULL;
+        left->line = line;
     }
 
     return left;
@@ -327,8 +539,7 @@ static Node* parse_expression(KorelinParser* parser, Precedence precedence) {
 
 // 解析 let 语句
 static Node* parse_let_statement(KorelinParser* parser) {
-    LetStatement* stmt = malloc(sizeof(LetStatement));
-    stmt->node.type = NODE_LET_STATEMENT;
+    LetStatement* stmt = new_node(sizeof(LetStatement), NODE_LET_STATEMENT);
     // stmt->name = parser->current_token; // 'let' token (ignored/overwritten)
 
     if (!expect_peek(parser, KORELIN_IDENT)) {
@@ -337,15 +548,20 @@ static Node* parse_let_statement(KorelinParser* parser) {
     }
     copy_token_to_ast(&stmt->name, &parser->current_token); // identifier token
 
-    if (expect_peek(parser, KORELIN_ASSIGN)) {
+    if (peek_token_is(parser, KORELIN_ASSIGN)) {
+        next_token(parser); // 前进到 '='
         next_token(parser); // 跳过 '='
         stmt->value = parse_expression(parser, PREC_LOWEST);
+        if (!stmt->value) {
+            free_ast((Node*)stmt);
+            return NULL;
+        }
     } else {
         stmt->value = NULL;
     }
 
-    while (!current_token_is(parser, KORELIN_SEMICOLON) && !current_token_is(parser, KORELIN_EOF)) {
-        next_token(parser);
+    if (peek_token_is(parser, KORELIN_SEMICOLON)) {
+        next_token(parser); // 前进到 ';'
     }
 
     return (Node*)stmt;
@@ -353,8 +569,7 @@ static Node* parse_let_statement(KorelinParser* parser) {
 
 // 解析 var 语句 (与 let 类似)
 static Node* parse_var_statement(KorelinParser* parser) {
-    VarStatement* stmt = malloc(sizeof(VarStatement));
-    stmt->node.type = NODE_VAR_STATEMENT;
+    VarStatement* stmt = new_node(sizeof(VarStatement), NODE_VAR_STATEMENT);
     // stmt->name = parser->current_token; // 'var' token (ignored/overwritten)
 
     if (!expect_peek(parser, KORELIN_IDENT)) {
@@ -363,15 +578,20 @@ static Node* parse_var_statement(KorelinParser* parser) {
     }
     copy_token_to_ast(&stmt->name, &parser->current_token); // identifier token
 
-    if (expect_peek(parser, KORELIN_ASSIGN)) {
+    if (peek_token_is(parser, KORELIN_ASSIGN)) {
+        next_token(parser); // 前进到 '='
         next_token(parser); // 跳过 '='
         stmt->value = parse_expression(parser, PREC_LOWEST);
+        if (!stmt->value) {
+            free_ast((Node*)stmt);
+            return NULL;
+        }
     } else {
         stmt->value = NULL;
     }
 
-    while (!current_token_is(parser, KORELIN_SEMICOLON) && !current_token_is(parser, KORELIN_EOF)) {
-        next_token(parser);
+    if (peek_token_is(parser, KORELIN_SEMICOLON)) {
+        next_token(parser); // 前进到 ';'
     }
 
     return (Node*)stmt;
@@ -380,20 +600,27 @@ static Node* parse_var_statement(KorelinParser* parser) {
 
 // 解析 return 语句
 static Node* parse_return_statement(KorelinParser* parser) {
-    ReturnStatement* stmt = malloc(sizeof(ReturnStatement));
-    stmt->node.type = NODE_RETURN_STATEMENT;
+    ReturnStatement* stmt = new_node(sizeof(ReturnStatement), NODE_RETURN_STATEMENT);
+    // 不带返回值的 return
+    if (peek_token_is(parser, KORELIN_SEMICOLON) || peek_token_is(parser, KORELIN_RBRACE)) {
+        if (peek_token_is(parser, KORELIN_SEMICOLON)) next_token(parser);
+        return (Node*)stmt;
+    }
     next_token(parser); // 跳过 'return'
     stmt->return_value = parse_expression(parser, PREC_LOWEST);
-    while (!current_token_is(parser, KORELIN_SEMICOLON) && !current_token_is(parser, KORELIN_EOF)) {
-        next_token(parser);
+    if (!stmt->return_value) {
+        free(stmt);
+        return NULL;
+    }
+    if (peek_token_is(parser, KORELIN_SEMICOLON)) {
+        next_token(parser); // 前进到 ';'
     }
     return (Node*)stmt;
 }
 
 // 解析表达式语句
 static Node* parse_expression_statement(KorelinParser* parser) {
-    ExpressionStatement* stmt = malloc(sizeof(ExpressionStatement));
-    stmt->node.type = NODE_EXPRESSION_STATEMENT;
+    ExpressionStatement* stmt = new_node(sizeof(ExpressionStatement), NODE_EXPRESSION_STATEMENT);
     stmt->expression = parse_expression(parser, PREC_LOWEST);
 
     if (stmt->expression == NULL) {
@@ -409,8 +636,7 @@ static Node* parse_expression_statement(KorelinParser* parser) {
 
 // 解析 if 语句
 static Node* parse_if_statement(KorelinParser* parser) {
-    IfStatement* stmt = malloc(sizeof(IfStatement));
-    stmt->node.type = NODE_IF_STATEMENT;
+    IfStatement* stmt = new_node(sizeof(IfStatement), NODE_IF_STATEMENT);
 
     if (!expect_peek(parser, KORELIN_LPAREN)) {
         free(stmt);
@@ -447,8 +673,182 @@ static Node* parse_if_statement(KorelinParser* parser) {
 }
 
 
+// 解析函数字面量或函数声明: func [name](a, b) { ... }, 当前 Token 为 'func'
+static Node* parse_function_literal(KorelinParser* parser) {
+    FunctionLiteral* func = new_node(sizeof(FunctionLiteral), NODE_FUNCTION_LITERAL);
+    func->token = parser->current_token;
+    func->token.value = "func";
+    func->token.needs_free = 0;
+
+    if (peek_token_is(parser, KORELIN_IDENT)) {
+        next_token(parser);
+        copy_token_to_ast(&func->name, &parser->current_token);
+    }
+    if (!expect_peek(parser, KORELIN_LPAREN)) {
+        free_ast((Node*)func);
+        return NULL;
+    }
+    while (!peek_token_is(parser, KORELIN_RPAREN)) {
+        if (!expect_peek(parser, KORELIN_IDENT)) {
+            free_ast((Node*)func);
+            return NULL;
+        }
+        KorelinToken* new_params = realloc(func->parameters, (func->param_count + 1) * sizeof(KorelinToken));
+        if (!new_params) {
+            fprintf(stderr, "Error: realloc failed in parse_function_literal\n");
+            exit(EXIT_FAILURE);
+        }
+        func->parameters = new_params;
+        copy_token_to_ast(&func->parameters[func->param_count++], &parser->current_token);
+        if (peek_token_is(parser, KORELIN_COMMA)) next_token(parser);
+    }
+    next_token(parser); // 前进到 ')'
+    if (!expect_peek(parser, KORELIN_LBRACE)) {
+        free_ast((Node*)func);
+        return NULL;
+    }
+    func->body = parse_block_statement(parser);
+    return (Node*)func;
+}
+
+// 解析结构体声明: struct Point { double x; double y; }, 同类型的字段可以写成 double x, y;
+static Node* parse_struct_declaration(KorelinParser* parser) {
+    StructDeclaration* decl = new_node(sizeof(StructDeclaration), NODE_STRUCT_DECLARATION);
+    if (!expect_peek(parser, KORELIN_IDENT)) {
+        free(decl);
+        return NULL;
+    }
+    copy_token_to_ast(&decl->name, &parser->current_token);
+    if (!expect_peek(parser, KORELIN_LBRACE)) {
+        free_ast((Node*)decl);
+        return NULL;
+    }
+
+    while (!peek_token_is(parser, KORELIN_RBRACE)) {
+        next_token(parser); // 前进到字段类型
+        KorelinTokenType type = parser->current_token.type;
+        if (type != KORELIN_TYPE_INT32 && type != KORELIN_TYPE_LONG64 && type != KORELIN_TYPE_DOUBLE &&
+            type != KORELIN_TYPE_BOOL && type != KORELIN_TYPE_STRING && type != KORELIN_IDENT) {
+            fprintf(stderr, "Line %d: expected a field type in struct declaration.\n", parser->current_token.line);
+            parser->error_count++;
+            free_ast((Node*)decl);
+            return NULL;
+        }
+        KorelinToken type_token;
+        copy_token_to_ast(&type_token, &parser->current_token);
+        do {
+            if (!expect_peek(parser, KORELIN_IDENT)) {
+                free_korelin_token(&type_token);
+                free_ast((Node*)decl);
+                return NULL;
+            }
+            StructField* new_fields = realloc(decl->fields, (decl->field_count + 1) * sizeof(StructField));
+            if (!new_fields) {
+                fprintf(stderr, "Error: realloc failed in parse_struct_declaration\n");
+                exit(EXIT_FAILURE);
+            }
+            decl->fields = new_fields;
+            StructField* field = &decl->fields[decl->field_count++];
+            copy_token_to_ast(&field->type, &type_token);
+            copy_token_to_ast(&field->name, &parser->current_token);
+        } while (peek_token_is(parser, KORELIN_COMMA) && (next_token(parser), true));
+        free_korelin_token(&type_token);
+        if (peek_token_is(parser, KORELIN_SEMICOLON)) next_token(parser);
+    }
+    next_token(parser); // 前进到 '}'
+    return (Node*)decl;
+}
+
+// 解析 while 语句: while (condition) { ... }
+static Node* parse_while_statement(KorelinParser* parser) {
+    WhileStatement* stmt = new_node(sizeof(WhileStatement), NODE_WHILE_STATEMENT);
+    if (!expect_peek(parser, KORELIN_LPAREN)) {
+        free(stmt);
+        return NULL;
+    }
+    next_token(parser); // 跳过 '('
+    stmt->condition = parse_expression(parser, PREC_LOWEST);
+    if (!stmt->condition || !expect_peek(parser, KORELIN_RPAREN) || !expect_peek(parser, KORELIN_LBRACE)) {
+        free_ast((Node*)stmt);
+        return NULL;
+    }
+    stmt->body = parse_block_statement(parser);
+    return (Node*)stmt;
+}
+
+// 解析 for 语句: for (init; condition; update) { ... }, 三个部分都可以省略
+static Node* parse_for_statement(KorelinParser* parser) {
+    ForStatement* stmt = new_node(sizeof(ForStatement), NODE_FOR_STATEMENT);
+    if (!expect_peek(parser, KORELIN_LPAREN)) {
+        free(stmt);
+        return NULL;
+    }
+    next_token(parser); // 跳过 '('
+
+    if (!current_token_is(parser, KORELIN_SEMICOLON)) {
+        if (current_token_is(parser, KORELIN_LET) || current_token_is(parser, KORELIN_VAR)) {
+            stmt->initializer = parse_statement(parser); // 停在 ';' 上
+        } else {
+            ExpressionStatement* init = new_node(sizeof(ExpressionStatement), NODE_EXPRESSION_STATEMENT);
+            init->expression = parse_expression(parser, PREC_LOWEST);
+            stmt->initializer = (Node*)init;
+            if (!init->expression || !expect_peek(parser, KORELIN_SEMICOLON)) {
+                free_ast((Node*)stmt);
+                return NULL;
+            }
+        }
+        if (!stmt->initializer) {
+            free_ast((Node*)stmt);
+            return NULL;
+        }
+    }
+    next_token(parser); // 跳过 ';'
+
+    if (!current_token_is(parser, KORELIN_SEMICOLON)) {
+        stmt->condition = parse_expression(parser, PREC_LOWEST);
+        if (!stmt->condition || !expect_peek(parser, KORELIN_SEMICOLON)) {
+            free_ast((Node*)stmt);
+            return NULL;
+        }
+    }
+    next_token(parser); // 跳过 ';'
+
+    if (!current_token_is(parser, KORELIN_RPAREN)) {
+        stmt->update = parse_expression(parser, PREC_LOWEST);
+        if (!stmt->update || !expect_peek(parser, KORELIN_RPAREN)) {
+            free_ast((Node*)stmt);
+            return NULL;
+        }
+    }
+    if (!expect_peek(parser, KORELIN_LBRACE)) {
+        free_ast((Node*)stmt);
+        return NULL;
+    }
+    stmt->body = parse_block_statement(parser);
+    return (Node*)stmt;
+}
+
+// 解析 break / continue 语句
+static Node* parse_jump_statement(KorelinParser* parser, NodeType type) {
+    Node* stmt = new_node(type == NODE_BREAK_STATEMENT ? sizeof(BreakStatement) : sizeof(ContinueStatement), type);
+    if (peek_token_is(parser, KORELIN_SEMICOLON)) {
+        next_token(parser);
+    }
+    return stmt;
+}
+
 // 分发解析单个语句
 static Node* parse_statement(KorelinParser* parser) {
+    int line = parser->current_token.line;
+    Node* stmt = parse_statement_kind(parser);
+    if (stmt && stmt->line == 0) {
+        stmt->line = line;
+    }
+    return stmt;
+}
+
+// 按当前 Token 选择语句的解析函数
+static Node* parse_statement_kind(KorelinParser* parser) {
     switch (parser->current_token.type) {
         case KORELIN_LET:
             return parse_let_statement(parser);
@@ -458,6 +858,24 @@ static Node* parse_statement(KorelinParser* parser) {
             return parse_return_statement(parser);
         case KORELIN_IF:
             return parse_if_statement(parser);
+        case KORELIN_WHILE:
+            return parse_while_statement(parser);
+        case KORELIN_FOR:
+            return parse_for_statement(parser);
+        case KORELIN_BREAK:
+            return parse_jump_statement(parser, NODE_BREAK_STATEMENT);
+        case KORELIN_CONTINUE:
+            return parse_jump_statement(parser, NODE_CONTINUE_STATEMENT);
+        case KORELIN_STRUCT:
+            return parse_struct_declaration(parser);
+        case KORELIN_FUNC:
+            // 具名函数声明作为语句; 匿名函数字面量作为表达式语句
+            if (peek_token_is(parser, KORELIN_IDENT)) {
+                return parse_function_literal(parser);
+            }
+            return parse_expression_statement(parser);
+        case KORELIN_LBRACE:
+            return parse_block_statement(parser);
         // ... 其他语句类型
         default:
             return parse_expression_statement(parser);
@@ -478,8 +896,7 @@ Program* parse_program(const char* input) {
     KorelinParser parser;
     init_parser(&parser, input);
 
-    Program* program = malloc(sizeof(Program));
-    program->node.type = NODE_PROGRAM;
+    Program* program = new_node(sizeof(Program), NODE_PROGRAM);
     program->statements = NULL;
     program->statement_count = 0;
 
@@ -517,5 +934,6 @@ Program* parse_program(const char* input) {
     free_korelin_token(&parser.current_token);
     free_korelin_token(&parser.peek_token);
 
+    program->error_count = parser.error_count;
     return program;
 }
\ No newline at end of file
@@ -0,0 +1,208 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#include "kpool.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// 工作线程的状态, 各占一个缓存行
+typedef struct KPoolWorker {
+    _Alignas(64) _Atomic uint64_t range;    // 尚未领取的块 [低 32 位, 高 32 位)
+    unsigned seed;                          // 选择窃取对象的随机数
+} KPoolWorker;
+
+typedef struct KPool {
+    int count;                  // 工作线程数 (含调用线程)
+    KPoolWorker* workers;
+    pthread_t* threads;
+    pthread_mutex_t run_lock;   // 同一时刻只执行一个任务
+
+    pthread_mutex_t lock;
+    pthread_cond_t start_cond;
+    pthread_cond_t done_cond;
+    unsigned long generation;   // 每个任务加一, 工作线程据此开始
+    int pending;                // 尚未结束当前任务的工作线程数
+
+    // 当前任务
+    KPoolTask task;
+    void* context;
+    size_t item_count;
+    size_t grain;
+} KPool;
+
+static KPool pool;
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+// 当前线程是否正在执行任务 (嵌套的 kpool_run 顺序执行)
+static _Thread_local bool in_task;
+
+static uint64_t pack_range(uint32_t begin, uint32_t end) {
+    return (uint64_t)end << 32 | begin;
+}
+
+// 辅助函数：从自己的区间前端领取一块
+static bool take(KPoolWorker* worker, uint32_t* chunk) {
+    uint64_t range = atomic_load_explicit(&worker->range, memory_order_acquire);
+    for (;;) {
+        uint32_t begin = (uint32_t)range, end = (uint32_t)(range >> 32);
+        if (begin >= end) return false;
+        if (atomic_compare_exchange_weak_explicit(&worker->range, &range, pack_range(begin + 1, end),
+                                                  memory_order_acq_rel, memory_order_acquire)) {
+            *chunk = begin;
+            return true;
+        }
+    }
+}
+
+// 辅助函数：窃取其他线程剩余区间的后一半, 领取其中第一块, 其余作为自己的区间。
+// 所有区间都为空时返回 false: 之后不会再有新的块 (窃取中的块由窃取者处理)
+static bool steal(int index, uint32_t* chunk) {
+    KPoolWorker* self = &pool.workers[index];
+    self->seed = self->seed * 1103515245u + 12345u;
+    int start = (int)((self->seed >> 16) % (unsigned)pool.count);
+    for (int i = 0; i < pool.count; i++) {
+        int victim = (start + i) % pool.count;
+        if (victim == index) continue;
+        KPoolWorker* other = &pool.workers[victim];
+        uint64_t range = atomic_load_explicit(&other->range, memory_order_acquire);
+        for (;;) {
+            uint32_t begin = (uint32_t)range, end = (uint32_t)(range >> 32);
+            if (begin >= end) break;
+            uint32_t middle = begin + (end - begin) / 2;
+            if (atomic_compare_exchange_weak_explicit(&other->range, &range, pack_range(begin, middle),
+                                                      memory_order_acq_rel, memory_order_acquire)) {
+                *chunk = middle;
+                atomic_store_explicit(&self->range, pack_range(middle + 1, end), memory_order_release);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// 辅助函数：作为第 index 个工作线程处理当前任务, 直到没有可以领取或窃取的块
+static void work(int index) {
+    in_task = true;
+    uint32_t chunk;
+    while (take(&pool.workers[index], &chunk) || steal(index, &chunk)) {
+        size_t begin = (size_t)chunk * pool.grain;
+        size_t end = begin + pool.grain < pool.item_count ? begin + pool.grain : pool.item_count;
+        pool.task(pool.context, index, begin, end);
+    }
+    in_task = false;
+}
+
+static void* worker_main(void* arg) {
+    int index = (int)(intptr_t)arg;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&pool.lock);
+    for (;;) {
+        while (pool.generation == seen) {
+            pthread_cond_wait(&pool.start_cond, &pool.lock);
+        }
+        seen = pool.generation;
+        pthread_mutex_unlock(&pool.lock);
+
+        work(index);
+
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.pending == 0) {
+            pthread_cond_signal(&pool.done_cond);
+        }
+    }
+    return NULL;
+}
+
+// 创建线程池; 线程创建失败时按实际创建成功的数量运行
+static void pool_init(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    const char* threads = getenv("KORELIN_THREADS");
+    if (threads && *threads) count = atol(threads);
+    if (count < 1) count = 1;
+    if (count > KPOOL_MAX_WORKERS) count = KPOOL_MAX_WORKERS;
+
+    pool.workers = aligned_alloc(64, (size_t)count * sizeof(KPoolWorker));
+    pool.threads = calloc((size_t)count, sizeof(pthread_t));
+    if (!pool.workers || !pool.threads) {
+        fprintf(stderr, "Error: malloc failed in pool_init\n");
+        exit(EXIT_FAILURE);
+    }
+    for (long i = 0; i < count; i++) {
+        atomic_init(&pool.workers[i].range, 0);
+        pool.workers[i].seed = (unsigned)i * 2654435761u + 1;
+    }
+    pthread_mutex_init(&pool.run_lock, NULL);
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.start_cond, NULL);
+    pthread_cond_init(&pool.done_cond, NULL);
+
+    // 工作线程常驻到进程结束
+    pool.count = 1;
+    for (long i = 1; i < count; i++) {
+        if (pthread_create(&pool.threads[i - 1], NULL, worker_main, (void*)(intptr_t)i) != 0) {
+            fprintf(stderr, "Warning: failed to start worker thread, using %d thread(s)\n", pool.count);
+            break;
+        }
+        pthread_detach(pool.threads[i - 1]);
+        pool.count++;
+    }
+}
+
+int kpool_workers(void) {
+    pthread_once(&pool_once, pool_init);
+    return pool.count;
+}
+
+size_t kpool_grain(size_t count) {
+    size_t grain = count / ((size_t)kpool_workers() * KPOOL_CHUNKS_PER_WORKER);
+    return grain ? grain : 1;
+}
+
+void kpool_run(size_t count, size_t grain, KPoolTask task, void* context) {
+    if (count == 0) return;
+    int workers = kpool_workers();
+    if (grain == 0) grain = kpool_grain(count);
+    // 块号是 32 位的
+    if ((count - 1) / grain >= UINT32_MAX) grain = (count - 1) / (UINT32_MAX - 1) + 1;
+
+    if (in_task || workers == 1 || count <= grain) {
+        for (size_t begin = 0; begin < count; begin += grain) {
+            task(context, 0, begin, count - begin > grain ? begin + grain : count);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool.run_lock);
+    size_t chunks = (count - 1) / grain + 1;
+    for (int i = 0; i < workers; i++) {
+        uint32_t begin = (uint32_t)(chunks * (size_t)i / (size_t)workers);
+        uint32_t end = (uint32_t)(chunks * (size_t)(i + 1) / (size_t)workers);
+        atomic_store_explicit(&pool.workers[i].range, pack_range(begin, end), memory_order_relaxed);
+    }
+    pthread_mutex_lock(&pool.lock);
+    pool.task = task;
+    pool.context = context;
+    pool.item_count = count;
+    pool.grain = grain;
+    pool.pending = workers - 1;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.start_cond);
+    pthread_mutex_unlock(&pool.lock);
+
+    work(0);
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.pending > 0) {
+        pthread_cond_wait(&pool.done_cond, &pool.lock);
+    }
+    pthread_mutex_unlock(&pool.lock);
+    pthread_mutex_unlock(&pool.run_lock);
+}
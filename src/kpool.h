@@ -0,0 +1,50 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#ifndef KORELIN_KPOOL_H
+#define KORELIN_KPOOL_H
+
+#include <stddef.h>
+
+// =============================================================================
+// 数据并行的线程池
+//
+// 进程内只有一个线程池, 第一次使用时创建 KORELIN_THREADS 个工作线程 (默认为 CPU 数,
+// 调用线程也算一个)。一次任务把下标区间 [0, count) 切成若干块, 按块号连续地平均分给各
+// 工作线程; 每个线程从自己的区间的前端逐块领取, 自己的区间取完后随机选择其他线程,
+// 窃取它剩余区间的后一半。区间的起止打包在一个 64 位原子变量中, 领取与窃取各是一次 CAS。
+//
+// 同一时刻只执行一个任务, 其他线程的 kpool_run 排队等待; 在任务中再调用 kpool_run
+// (嵌套的并行) 时在当前线程中顺序执行。
+// =============================================================================
+
+#define KPOOL_MAX_WORKERS 256
+
+// 自动选择块大小时每个工作线程平均分到的块数: 块越多负载越均衡, 领取的开销也越大
+#define KPOOL_CHUNKS_PER_WORKER 16
+
+// 处理一块下标 [begin, end); worker 是执行它的工作线程的编号 (0 到 kpool_workers() - 1),
+// 同一个编号同时只在一个线程中使用
+typedef void (*KPoolTask)(void* context, int worker, size_t begin, size_t end);
+
+// --- 函数声明 ---
+
+/**
+ * @brief 工作线程数 (含调用线程), 第一次调用时创建线程池。
+ */
+int kpool_workers(void);
+
+/**
+ * @brief 自动选择的块大小: 每个工作线程平均分到 KPOOL_CHUNKS_PER_WORKER 块。
+ */
+size_t kpool_grain(size_t count);
+
+/**
+ * @brief 并行处理下标 [0, count), 所有块都处理完后返回。
+ *        第 k 块是 [k * grain, min((k + 1) * grain, count))。
+ * @param grain 每块的下标数, 为 0 时使用 kpool_grain(count)。
+ */
+void kpool_run(size_t count, size_t grain, KPoolTask task, void* context);
+
+#endif //KORELIN_KPOOL_H
@@ -2,4 +2,1225 @@
 // Created by Helix on 2025/12/28.
 //
 
-#include "kric.h"
\ No newline at end of file
+#include "kric.h"
+#include "kparser.h"
+#include "krilib.h"
+#include <stdarg.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KRIC_MAX_U16 0xFFFF
+#define KRIC_MAX_ARGS 255
+
+// 局部变量
+typedef struct Local {
+    const char* name;
+    int depth;                  // 声明所在的作用域深度
+} Local;
+
+// 正在编译的循环, 记录需要回填的 break / continue 跳转
+typedef struct Loop {
+    struct Loop* enclosing;
+    int scope_depth;            // 循环体外的作用域深度, break/continue 时弹出更深的局部变量
+    size_t* breaks;
+    size_t break_count;
+    size_t* continues;
+    size_t continue_count;
+} Loop;
+
+// 正在编译的函数
+typedef struct FuncState {
+    struct FuncState* enclosing;
+    KProto* proto;
+    Local* locals;
+    size_t local_count;
+    size_t local_capacity;
+    int scope_depth;            // 0 表示顶层代码的全局作用域
+    Loop* loop;
+    size_t stack_depth;         // 当前位置的栈深度 (槽位数)
+} FuncState;
+
+typedef struct Compiler {
+    KModule* module;
+    FuncState* fs;
+    const char* file_name;
+    int line;
+    size_t error_count;
+} Compiler;
+
+static void compile_statement(Compiler* c, Node* node);
+static void compile_expression(Compiler* c, Node* node);
+
+// 辅助函数：报告编译错误
+static void compile_error(Compiler* c, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "%s:%d: error: ", c->file_name, c->line);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+    c->error_count++;
+}
+
+// 辅助函数：复制字符串
+static char* copy_string(const char* chars, size_t length) {
+    char* copy = malloc(length + 1);
+    if (!copy) {
+        fprintf(stderr, "Error: malloc failed in copy_string\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(copy, chars, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+// 辅助函数：按需扩容数组
+static void* grow_array(void* items, size_t* capacity, size_t needed, size_t item_size) {
+    if (needed <= *capacity) return items;
+    size_t new_capacity = *capacity ? *capacity * 2 : 8;
+    while (new_capacity < needed) new_capacity *= 2;
+    void* new_items = realloc(items, new_capacity * item_size);
+    if (!new_items) {
+        fprintf(stderr, "Error: realloc failed in grow_array\n");
+        exit(EXIT_FAILURE);
+    }
+    *capacity = new_capacity;
+    return new_items;
+}
+
+// =============================================================================
+// 字节码输出
+// =============================================================================
+
+static void emit_byte(Compiler* c, uint8_t byte) {
+    KProto* proto = c->fs->proto;
+    if (proto->code_count == proto->code_capacity) {
+        size_t capacity = proto->code_capacity;
+        proto->code = grow_array(proto->code, &capacity, proto->code_count + 1, sizeof(uint8_t));
+        proto->lines = grow_array(proto->lines, &proto->code_capacity, proto->code_count + 1, sizeof(int));
+    }
+    proto->code[proto->code_count] = byte;
+    proto->lines[proto->code_count] = c->line;
+    proto->code_count++;
+}
+
+static void emit_u16(Compiler* c, size_t value) {
+    if (value > KRIC_MAX_U16) {
+        compile_error(c, "too many constants, variables or field accesses in one function");
+        value = 0;
+    }
+    emit_byte(c, (uint8_t)(value & 0xFF));
+    emit_byte(c, (uint8_t)(value >> 8));
+}
+
+// 辅助函数：调整编译期的栈深度, 记录最大值
+static void adjust_stack(Compiler* c, int delta) {
+    FuncState* fs = c->fs;
+    fs->stack_depth = (size_t)((ptrdiff_t)fs->stack_depth + delta);
+    if (fs->stack_depth > fs->proto->max_stack) {
+        fs->proto->max_stack = fs->stack_depth;
+    }
+}
+
+// 输出一条指令, effect 为它对栈深度的影响
+static void emit_op(Compiler* c, KOpCode op, int effect) {
+    emit_byte(c, (uint8_t)op);
+    adjust_stack(c, effect);
+}
+
+static void emit_op_u16(Compiler* c, KOpCode op, int effect, size_t operand) {
+    emit_op(c, op, effect);
+    emit_u16(c, operand);
+}
+
+// 辅助函数：输出跳转指令, 返回待回填的操作数位置
+static size_t emit_jump(Compiler* c, KOpCode op, int effect) {
+    emit_op(c, op, effect);
+    emit_byte(c, 0xFF);
+    emit_byte(c, 0xFF);
+    return c->fs->proto->code_count - 2;
+}
+
+// 辅助函数：把跳转目标回填为当前位置
+static void patch_jump(Compiler* c, size_t at) {
+    KProto* proto = c->fs->proto;
+    size_t jump = proto->code_count - at - 2;
+    if (jump > KRIC_MAX_U16) {
+        compile_error(c, "too much code to jump over");
+        return;
+    }
+    proto->code[at] = (uint8_t)(jump & 0xFF);
+    proto->code[at + 1] = (uint8_t)(jump >> 8);
+}
+
+// 辅助函数：输出跳回 start 的循环回边
+static void emit_loop(Compiler* c, size_t start) {
+    emit_op(c, KOP_LOOP, 0);
+    size_t offset = c->fs->proto->code_count - start + 2;
+    if (offset > KRIC_MAX_U16) {
+        compile_error(c, "loop body too large");
+        offset = 0;
+    }
+    emit_u16(c, offset);
+}
+
+// 辅助函数：添加常量, 相同的数字、字符串与字段路径只保存一份
+static size_t add_constant(Compiler* c, KConstant constant) {
+    KProto* proto = c->fs->proto;
+    for (size_t i = 0; i < proto->constant_count; i++) {
+        const KConstant* existing = &proto->constants[i];
+        if (existing->kind != constant.kind) continue;
+        switch (constant.kind) {
+            case KCONST_INT:
+                if (existing->as.integer == constant.as.integer) return i;
+                break;
+            case KCONST_DOUBLE:
+                if (memcmp(&existing->as.number, &constant.as.number, sizeof(double)) == 0) return i;
+                break;
+            case KCONST_STRING:
+            case KCONST_PATH:
+            case KCONST_BIGINT:
+                if (existing->as.string.length == constant.as.string.length &&
+                    memcmp(existing->as.string.chars, constant.as.string.chars, constant.as.string.length) == 0) {
+                    free(constant.as.string.chars);
+                    return i;
+                }
+                break;
+            case KCONST_FUNCTION:
+                break;
+        }
+    }
+    proto->constants = grow_array(proto->constants, &proto->constant_capacity, proto->constant_count + 1,
+                                  sizeof(KConstant));
+    proto->constants[proto->constant_count] = constant;
+    return proto->constant_count++;
+}
+
+// =============================================================================
+// 作用域与变量
+// =============================================================================
+
+static void begin_scope(Compiler* c) {
+    c->fs->scope_depth++;
+}
+
+static void end_scope(Compiler* c) {
+    FuncState* fs = c->fs;
+    fs->scope_depth--;
+    while (fs->local_count > 0 && fs->locals[fs->local_count - 1].depth > fs->scope_depth) {
+        emit_op(c, KOP_POP, -1);
+        fs->local_count--;
+    }
+}
+
+// 辅助函数：为 break/continue 弹出比 depth 更深的局部变量 (之后的代码不可达, 不改变编译状态)
+static void pop_locals_above(Compiler* c, int depth) {
+    FuncState* fs = c->fs;
+    for (size_t i = fs->local_count; i > 0 && fs->locals[i - 1].depth > depth; i--) {
+        emit_byte(c, KOP_POP);
+    }
+}
+
+// 辅助函数：在全局作用域中 (顶层代码且不在代码块内)
+static bool is_global_scope(const Compiler* c) {
+    return c->fs->enclosing == NULL && c->fs->scope_depth == 0;
+}
+
+static void declare_local(Compiler* c, const char* name) {
+    FuncState* fs = c->fs;
+    for (size_t i = fs->local_count; i > 0 && fs->locals[i - 1].depth == fs->scope_depth; i--) {
+        if (strcmp(fs->locals[i - 1].name, name) == 0) {
+            compile_error(c, "variable '%s' is already declared in this scope", name);
+            break;
+        }
+    }
+    if (fs->local_count > KRIC_MAX_U16) {
+        compile_error(c, "too many local variables in function");
+    }
+    fs->locals = grow_array(fs->locals, &fs->local_capacity, fs->local_count + 1, sizeof(Local));
+    fs->locals[fs->local_count++] = (Local){.name = name, .depth = fs->scope_depth};
+}
+
+static int resolve_local(const FuncState* fs, const char* name) {
+    for (size_t i = fs->local_count; i > 0; i--) {
+        if (strcmp(fs->locals[i - 1].name, name) == 0) return (int)(i - 1);
+    }
+    return -1;
+}
+
+static int find_global(const KModule* module, const char* name) {
+    for (size_t i = 0; i < module->global_count; i++) {
+        if (strcmp(module->globals[i], name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+static int add_global(Compiler* c, const char* name, bool native) {
+    KModule* module = c->module;
+    int index = find_global(module, name);
+    if (index >= 0) return index;
+
+    char** new_globals = realloc(module->globals, (module->global_count + 1) * sizeof(char*));
+    bool* new_natives = realloc(module->global_natives, (module->global_count + 1) * sizeof(bool));
+    if (!new_globals || !new_natives) {
+        fprintf(stderr, "Error: realloc failed in add_global\n");
+        exit(EXIT_FAILURE);
+    }
+    module->globals = new_globals;
+    module->global_natives = new_natives;
+    module->globals[module->global_count] = copy_string(name, strlen(name));
+    module->global_natives[module->global_count] = native;
+    return (int)module->global_count++;
+}
+
+static int find_struct(const KModule* module, const char* name) {
+    for (size_t i = 0; i < module->struct_count; i++) {
+        if (strcmp(module->structs[i]->name, name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+// 辅助函数：若 node 是未被变量遮蔽的结构体类型名, 返回类型下标, 否则返回 -1
+static int struct_name_of(const Compiler* c, const Node* node) {
+    if (node->type != NODE_IDENTIFIER) return -1;
+    const char* name = ((const Identifier*)node)->value;
+    if (resolve_local(c->fs, name) >= 0 || find_global(c->module, name) >= 0) return -1;
+    return find_struct(c->module, name);
+}
+
+// =============================================================================
+// 顶层声明
+// =============================================================================
+
+static void declare_struct(Compiler* c, const StructDeclaration* decl) {
+    const char* name = decl->name.value;
+    if (find_struct(c->module, name) >= 0 || find_global(c->module, name) >= 0) {
+        compile_error(c, "'%s' is already declared", name);
+        return;
+    }
+    if (c->module->struct_count > KRIC_MAX_U16) {
+        compile_error(c, "too many struct types");
+        return;
+    }
+
+    KStructType* type = kstruct_type_new(name);
+    for (size_t i = 0; i < decl->field_count; i++) {
+        const StructField* field = &decl->fields[i];
+        KFieldKind kind;
+        const KStructType* field_struct = NULL;
+        switch (field->type.type) {
+            case KORELIN_TYPE_BOOL: kind = KFIELD_BOOL; break;
+            case KORELIN_TYPE_INT32: kind = KFIELD_INT; break;
+            case KORELIN_TYPE_LONG64: kind = KFIELD_LONG; break;
+            case KORELIN_TYPE_DOUBLE: kind = KFIELD_DOUBLE; break;
+            case KORELIN_TYPE_STRING: kind = KFIELD_STRING; break;
+            default: {
+                // 只能引用已经声明的结构体, 因此结构体不会 (直接或间接地) 包含自身
+                int index = find_struct(c->module, field->type.value);
+                if (index < 0) {
+                    compile_error(c, "unknown type '%s' for field '%s.%s'", field->type.value, name,
+                                  field->name.value);
+                    continue;
+                }
+                kind = KFIELD_STRUCT;
+                field_struct = c->module->structs[index];
+                break;
+            }
+        }
+        if (!kstruct_type_add_field(type, field->name.value, kind, field_struct)) {
+            compile_error(c, "duplicate field '%s.%s'", name, field->name.value);
+        }
+    }
+    kstruct_type_finish(type);
+
+    KModule* module = c->module;
+    KStructType** new_structs = realloc(module->structs, (module->struct_count + 1) * sizeof(KStructType*));
+    if (!new_structs) {
+        fprintf(stderr, "Error: realloc failed in declare_struct\n");
+        exit(EXIT_FAILURE);
+    }
+    module->structs = new_structs;
+    module->structs[module->struct_count++] = type;
+}
+
+// 辅助函数：声明一个顶层全局变量
+static void declare_global(Compiler* c, const char* name) {
+    if (find_struct(c->module, name) >= 0) {
+        compile_error(c, "'%s' is already declared as a struct type", name);
+        return;
+    }
+    add_global(c, name, false);
+}
+
+// 预先收集顶层的结构体与全局变量, 使函数可以引用在它之后声明的全局变量
+static void declare_top_level(Compiler* c, const Program* program) {
+    for (size_t i = 0; i < program->statement_count; i++) {
+        const Node* node = program->statements[i];
+        if (node->line) c->line = node->line;
+        switch (node->type) {
+            case NODE_STRUCT_DECLARATION:
+                declare_struct(c, (const StructDeclaration*)node);
+                break;
+            case NODE_LET_STATEMENT:
+                declare_global(c, ((const LetStatement*)node)->name.value);
+                break;
+            case NODE_VAR_STATEMENT:
+                declare_global(c, ((const VarStatement*)node)->name.value);
+                break;
+            case NODE_FUNCTION_LITERAL: {
+                const FunctionLiteral* fn = (const FunctionLiteral*)node;
+                if (fn->name.value) declare_global(c, fn->name.value);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+// =============================================================================
+// 函数
+// =============================================================================
+
+static KProto* new_proto(Compiler* c, const char* name) {
+    KProto* proto = calloc(1, sizeof(KProto));
+    if (!proto) {
+        fprintf(stderr, "Error: calloc failed in new_proto\n");
+        exit(EXIT_FAILURE);
+    }
+    proto->name = copy_string(name, strlen(name));
+    size_t site_length = strlen(c->file_name) + 1 + strlen(name);
+    proto->site = malloc(site_length + 1);
+    if (!proto->site) {
+        fprintf(stderr, "Error: malloc failed in new_proto\n");
+        exit(EXIT_FAILURE);
+    }
+    snprintf(proto->site, site_length + 1, "%s:%s", c->file_name, name);
+
+    KModule* module = c->module;
+    KProto** new_protos = realloc(module->protos, (module->proto_count + 1) * sizeof(KProto*));
+    if (!new_protos) {
+        fprintf(stderr, "Error: realloc failed in new_proto\n");
+        exit(EXIT_FAILURE);
+    }
+    module->protos = new_protos;
+    proto->index = module->proto_count;
+    module->protos[module->proto_count++] = proto;
+    return proto;
+}
+
+// 辅助函数：开始编译一个函数, 槽位 0 保留给被调用的函数自身
+static void begin_function(Compiler* c, FuncState* fs, KProto* proto) {
+    memset(fs, 0, sizeof(*fs));
+    fs->enclosing = c->fs;
+    fs->proto = proto;
+    c->fs = fs;
+    declare_local(c, "");
+    adjust_stack(c, 1);
+}
+
+static void end_function(Compiler* c) {
+    emit_op(c, KOP_NULL, 1);
+    emit_op(c, KOP_RETURN, -1);
+    free(c->fs->locals);
+    c->fs = c->fs->enclosing;
+}
+
+// 编译函数字面量, 在外层函数中留下函数常量
+static void compile_function(Compiler* c, const FunctionLiteral* fn) {
+    KProto* proto = new_proto(c, fn->name.value ? fn->name.value : "<anonymous>");
+    if (fn->param_count > KRIC_MAX_ARGS) {
+        compile_error(c, "too many parameters");
+    }
+    proto->arity = (int)fn->param_count;
+
+    FuncState fs;
+    begin_function(c, &fs, proto);
+    fs.scope_depth = 1; // 函数体中的 let/var 都是局部变量 (不支持闭包, 函数只能访问自身的局部变量与全局变量)
+    for (size_t i = 0; i < fn->param_count; i++) {
+        declare_local(c, fn->parameters[i].value);
+        adjust_stack(c, 1);
+    }
+    const BlockStatement* body = (const BlockStatement*)fn->body;
+    for (size_t i = 0; body && i < body->statement_count; i++) {
+        compile_statement(c, body->statements[i]);
+    }
+    end_function(c);
+
+    KConstant constant = {.kind = KCONST_FUNCTION, .as.proto = proto};
+    emit_op_u16(c, KOP_FUNCTION, 1, add_constant(c, constant));
+}
+
+// =============================================================================
+// 表达式
+// =============================================================================
+
+// 编译一个将被存储的值: 变量中的结构体在赋值、传参与返回时复制 (值语义);
+// 字段读取、下标读取与构造产生的都是新值, 无需再复制
+static void compile_value(Compiler* c, Node* node) {
+    compile_expression(c, node);
+    bool shared = node->type == NODE_IDENTIFIER || node->type == NODE_ASSIGNMENT_EXPRESSION;
+    if (node->type == NODE_INFIX_EXPRESSION) {
+        KorelinTokenType op = ((const InfixExpression*)node)->op.type;
+        shared = op == KORELIN_AND || op == KORELIN_OR;
+    }
+    if (shared) emit_op(c, KOP_COPY, 0);
+}
+
+static void compile_identifier(Compiler* c, const Identifier* ident) {
+    int slot = resolve_local(c->fs, ident->value);
+    if (slot >= 0) {
+        emit_op_u16(c, KOP_GET_LOCAL, 1, (size_t)slot);
+        return;
+    }
+    int global = find_global(c->module, ident->value);
+    if (global < 0 && find_struct(c->module, ident->value) >= 0) {
+        compile_error(c, "struct type '%s' is not a value; use %s(...) or %s[n]", ident->value, ident->value,
+                      ident->value);
+        return;
+    }
+    if (global < 0 && kri_find_native(ident->value)) {
+        global = add_global(c, ident->value, true);
+    }
+    if (global < 0) {
+        compile_error(c, "undefined variable '%s'", ident->value);
+        return;
+    }
+    emit_op_u16(c, KOP_GET_GLOBAL, 1, (size_t)global);
+}
+
+// 辅助函数：二元运算符对应的操作码, 不支持时返回 -1
+static int binary_opcode(KorelinTokenType type) {
+    switch (type) {
+        case KORELIN_ADD: case KORELIN_ADD_ASSIGN: return KOP_ADD;
+        case KORELIN_SUB: case KORELIN_SUB_ASSIGN: return KOP_SUB;
+        case KORELIN_MUL: case KORELIN_MUL_ASSIGN: return KOP_MUL;
+        case KORELIN_DIV: case KORELIN_DIV_ASSIGN: return KOP_DIV;
+        case KORELIN_MOD: case KORELIN_MOD_ASSIGN: return KOP_MOD;
+        case KORELIN_POW: return KOP_POW;
+        case KORELIN_EQ: return KOP_EQ;
+        case KORELIN_NOT_EQ: return KOP_NE;
+        case KORELIN_LT: return KOP_LT;
+        case KORELIN_LE: return KOP_LE;
+        case KORELIN_GT: return KOP_GT;
+        case KORELIN_GE: return KOP_GE;
+        default: return -1;
+    }
+}
+
+static void compile_infix(Compiler* c, const InfixExpression* expr) {
+    if (expr->op.type == KORELIN_AND || expr->op.type == KORELIN_OR) {
+        compile_expression(c, expr->left);
+        size_t end = emit_jump(c, expr->op.type == KORELIN_AND ? KOP_AND : KOP_OR, -1);
+        compile_expression(c, expr->right);
+        patch_jump(c, end);
+        return;
+    }
+    int op = binary_opcode(expr->op.type);
+    if (op < 0) {
+        compile_error(c, "unsupported operator '%.*s'", (int)expr->op.length, expr->op.value);
+        return;
+    }
+    compile_expression(c, expr->left);
+    compile_expression(c, expr->right);
+    emit_op(c, (KOpCode)op, -1);
+}
+
+// 辅助函数：把连续的成员访问 a.b.c 拆成基础表达式 a 与字段路径 "b.c"
+static Node* flatten_member(const MemberAccessExpression* expr, char** path_out, size_t* length_out) {
+    size_t size = 0;
+    Node* base = (Node*)expr;
+    while (base->type == NODE_MEMBER_ACCESS_EXPRESSION) {
+        const MemberAccessExpression* member = (const MemberAccessExpression*)base;
+        size += member->property.length + 1;
+        base = member->object;
+    }
+
+    char* path = size > 0 ? malloc(size) : NULL;    // expr 至少有一层成员访问, size 不会为 0
+    if (!path) {
+        fprintf(stderr, "Error: malloc failed in flatten_member\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t pos = size - 1;
+    path[pos] = '\0';
+    for (const Node* node = (const Node*)expr; node != base; node = ((const MemberAccessExpression*)node)->object) {
+        const KorelinToken* property = &((const MemberAccessExpression*)node)->property;
+        pos -= property->length;
+        memcpy(path + pos, property->value, property->length);
+        if (pos > 0) path[--pos] = '.';
+    }
+    *path_out = path;
+    *length_out = size - 1;
+    return base;
+}
+
+// 字段访问的编译结果: 路径常量与内联缓存下标
+typedef struct FieldAccess {
+    size_t path;
+    size_t cache;
+    bool element;       // 对象是 数组[下标] 中的元素 (栈上为数组与下标)
+} FieldAccess;
+
+// 编译成员访问的对象部分, 压入对象 (或数组与下标), 返回字段访问信息
+static FieldAccess compile_field_target(Compiler* c, const MemberAccessExpression* expr) {
+    char* path;
+    size_t length;
+    Node* base = flatten_member(expr, &path, &length);
+
+    FieldAccess access;
+    access.element = base->type == NODE_INDEX_EXPRESSION && struct_name_of(c, ((IndexExpression*)base)->left) < 0;
+    if (access.element) {
+        const IndexExpression* index = (const IndexExpression*)base;
+        compile_expression(c, index->left);
+        compile_expression(c, index->index);
+    } else {
+        compile_expression(c, base);
+    }
+
+    KConstant constant = {.kind = KCONST_PATH, .as.string = {.chars = path, .length = length}};
+    access.path = add_constant(c, constant);
+    access.cache = c->fs->proto->cache_count++;
+    return access;
+}
+
+static void emit_field_op(Compiler* c, KOpCode op, int effect, const FieldAccess* access) {
+    emit_op_u16(c, op, effect, access->path);
+    emit_u16(c, access->cache);
+}
+
+static void compile_member(Compiler* c, const MemberAccessExpression* expr) {
+    FieldAccess access = compile_field_target(c, expr);
+    if (access.element) {
+        emit_field_op(c, KOP_GET_ELEM_FIELD, -1, &access);
+    } else {
+        emit_field_op(c, KOP_GET_FIELD, 0, &access);
+    }
+}
+
+static void compile_assignment(Compiler* c, const AssignmentExpression* expr) {
+    int op = -1;
+    if (expr->op.type != KORELIN_ASSIGN) {
+        op = binary_opcode(expr->op.type);
+        if (op < 0) {
+            compile_error(c, "unsupported assignment operator '%.*s'", (int)expr->op.length, expr->op.value);
+            return;
+        }
+    }
+
+    // 复合赋值先读出旧值, 再与右侧运算
+    switch (expr->left->type) {
+        case NODE_IDENTIFIER: {
+            const Identifier* ident = (const Identifier*)expr->left;
+            int slot = resolve_local(c->fs, ident->value);
+            int global = slot < 0 ? find_global(c->module, ident->value) : -1;
+            if (slot < 0 && global < 0) {
+                compile_error(c, "undefined variable '%s'", ident->value);
+                return;
+            }
+            if (op >= 0) {
+                compile_identifier(c, ident);
+                compile_expression(c, expr->right);
+                emit_op(c, (KOpCode)op, -1);
+            } else {
+                compile_value(c, expr->right);
+            }
+            if (slot >= 0) {
+                emit_op_u16(c, KOP_SET_LOCAL, 0, (size_t)slot);
+            } else {
+                emit_op_u16(c, KOP_SET_GLOBAL, 0, (size_t)global);
+            }
+            return;
+        }
+        case NODE_INDEX_EXPRESSION: {
+            const IndexExpression* index = (const IndexExpression*)expr->left;
+            compile_expression(c, index->left);
+            compile_expression(c, index->index);
+            if (op >= 0) {
+                emit_op(c, KOP_DUP2, 2);
+                emit_op(c, KOP_GET_INDEX, -1);
+                compile_expression(c, expr->right);
+                emit_op(c, (KOpCode)op, -1);
+            } else {
+                compile_value(c, expr->right);
+            }
+            emit_op(c, KOP_SET_INDEX, -2);
+            return;
+        }
+        case NODE_MEMBER_ACCESS_EXPRESSION: {
+            FieldAccess access = compile_field_target(c, (const MemberAccessExpression*)expr->left);
+            if (op >= 0) {
+                if (access.element) {
+                    emit_op(c, KOP_DUP2, 2);
+                    emit_field_op(c, KOP_GET_ELEM_FIELD, -1, &access);
+                } else {
+                    emit_op(c, KOP_DUP, 1);
+                    emit_field_op(c, KOP_GET_FIELD, 0, &access);
+                }
+                compile_expression(c, expr->right);
+                emit_op(c, (KOpCode)op, -1);
+            } else {
+                compile_value(c, expr->right);
+            }
+            if (access.element) {
+                emit_field_op(c, KOP_SET_ELEM_FIELD, -2, &access);
+            } else {
+                emit_field_op(c, KOP_SET_FIELD, -1, &access);
+            }
+            return;
+        }
+        default:
+            compile_error(c, "invalid assignment target");
+            return;
+    }
+}
+
+static void compile_call(Compiler* c, const CallExpression* call) {
+    if (call->arg_count > KRIC_MAX_ARGS) {
+        compile_error(c, "too many arguments");
+        return;
+    }
+
+    // Point(1, 2): 按字段声明顺序构造结构体值
+    int type = struct_name_of(c, call->function);
+    if (type >= 0) {
+        for (size_t i = 0; i < call->arg_count; i++) {
+            compile_value(c, call->arguments[i]);
+        }
+        emit_op_u16(c, KOP_NEW_STRUCT, 1 - (int)call->arg_count, (size_t)type);
+        emit_byte(c, (uint8_t)call->arg_count);
+        return;
+    }
+
+    compile_expression(c, call->function);
+    for (size_t i = 0; i < call->arg_count; i++) {
+        compile_value(c, call->arguments[i]);
+    }
+    emit_op(c, KOP_CALL, -(int)call->arg_count);
+    emit_byte(c, (uint8_t)call->arg_count);
+}
+
+static void compile_expression(Compiler* c, Node* node) {
+    if (node->line) c->line = node->line;
+
+    switch (node->type) {
+        case NODE_INTEGER_LITERAL: {
+            const IntegerLiteral* lit = (const IntegerLiteral*)node;
+            KConstant constant = {.kind = KCONST_INT, .as.integer = lit->value};
+            if (lit->big) {
+                constant.kind = KCONST_BIGINT;
+                constant.as.string.chars = copy_string(lit->token.value, lit->token.length);
+                constant.as.string.length = lit->token.length;
+            }
+            emit_op_u16(c, KOP_CONST, 1, add_constant(c, constant));
+            break;
+        }
+        case NODE_DOUBLE_LITERAL: {
+            KConstant constant = {.kind = KCONST_DOUBLE, .as.number = ((const DoubleLiteral*)node)->value};
+            emit_op_u16(c, KOP_CONST, 1, add_constant(c, constant));
+            break;
+        }
+        case NODE_STRING_LITERAL: {
+            const char* value = ((const StringLiteral*)node)->value;
+            size_t length = strlen(value);
+            KConstant constant = {.kind = KCONST_STRING, .as.string = {copy_string(value, length), length}};
+            emit_op_u16(c, KOP_CONST, 1, add_constant(c, constant));
+            break;
+        }
+        case NODE_BOOLEAN_LITERAL:
+            emit_op(c, ((const BooleanLiteral*)node)->value ? KOP_TRUE : KOP_FALSE, 1);
+            break;
+        case NODE_IDENTIFIER:
+            compile_identifier(c, (const Identifier*)node);
+            break;
+        case NODE_PREFIX_EXPRESSION: {
+            const PrefixExpression* expr = (const PrefixExpression*)node;
+            compile_expression(c, expr->right);
+            emit_op(c, expr->op.type == KORELIN_NOT ? KOP_NOT : KOP_NEG, 0);
+            break;
+        }
+        case NODE_INFIX_EXPRESSION:
+            compile_infix(c, (const InfixExpression*)node);
+            break;
+        case NODE_ASSIGNMENT_EXPRESSION:
+            compile_assignment(c, (const AssignmentExpression*)node);
+            break;
+        case NODE_FUNCTION_LITERAL:
+            compile_function(c, (const FunctionLiteral*)node);
+            break;
+        case NODE_CALL_EXPRESSION:
+            compile_call(c, (const CallExpression*)node);
+            break;
+        case NODE_ARRAY_LITERAL: {
+            const ArrayLiteral* array = (const ArrayLiteral*)node;
+            for (size_t i = 0; i < array->element_count; i++) {
+                compile_value(c, array->elements[i]);
+            }
+            emit_op_u16(c, KOP_NEW_ARRAY, 1 - (int)array->element_count, array->element_count);
+            break;
+        }
+        case NODE_MAP_LITERAL: {
+            const MapLiteral* map = (const MapLiteral*)node;
+            for (size_t i = 0; i < map->pair_count; i++) {
+                compile_value(c, map->keys[i]);
+                compile_value(c, map->values[i]);
+            }
+            emit_op_u16(c, KOP_NEW_MAP, 1 - 2 * (int)map->pair_count, map->pair_count);
+            break;
+        }
+        case NODE_INDEX_EXPRESSION: {
+            const IndexExpression* expr = (const IndexExpression*)node;
+            // Point[n]: 创建元素内联存放的结构体数组
+            int type = struct_name_of(c, expr->left);
+            if (type >= 0) {
+                compile_expression(c, expr->index);
+                emit_op_u16(c, KOP_NEW_STRUCT_ARRAY, 0, (size_t)type);
+                break;
+            }
+            compile_expression(c, expr->left);
+            compile_expression(c, expr->index);
+            emit_op(c, KOP_GET_INDEX, -1);
+            break;
+        }
+        case NODE_MEMBER_ACCESS_EXPRESSION:
+            compile_member(c, (const MemberAccessExpression*)node);
+            break;
+        default:
+            compile_error(c, "unsupported expression (%s)", node_type_to_string(node->type));
+            emit_op(c, KOP_NULL, 1);
+            break;
+    }
+}
+
+// =============================================================================
+// 语句
+// =============================================================================
+
+// let/var 声明: 全局作用域中写入全局变量, 否则值留在栈上成为局部变量
+static void compile_variable(Compiler* c, const KorelinToken* name, Node* value) {
+    if (value) {
+        compile_value(c, value);
+    } else {
+        emit_op(c, KOP_NULL, 1);
+    }
+    if (is_global_scope(c)) {
+        emit_op_u16(c, KOP_SET_GLOBAL, 0, (size_t)add_global(c, name->value, false));
+        emit_op(c, KOP_POP, -1);
+    } else {
+        declare_local(c, name->value);
+    }
+}
+
+static void begin_loop(Compiler* c, Loop* loop) {
+    memset(loop, 0, sizeof(*loop));
+    loop->enclosing = c->fs->loop;
+    loop->scope_depth = c->fs->scope_depth;
+    c->fs->loop = loop;
+}
+
+// 辅助函数：回填一组跳转并释放列表
+static void patch_jumps(Compiler* c, size_t* jumps, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        patch_jump(c, jumps[i]);
+    }
+    free(jumps);
+}
+
+static void compile_jump_statement(Compiler* c, bool is_break) {
+    Loop* loop = c->fs->loop;
+    if (!loop) {
+        compile_error(c, "'%s' outside of a loop", is_break ? "break" : "continue");
+        return;
+    }
+    pop_locals_above(c, loop->scope_depth);
+    size_t jump = emit_jump(c, KOP_JUMP, 0);
+    size_t capacity = is_break ? loop->break_count : loop->continue_count;
+    if (is_break) {
+        loop->breaks = grow_array(loop->breaks, &capacity, loop->break_count + 1, sizeof(size_t));
+        loop->breaks[loop->break_count++] = jump;
+    } else {
+        loop->continues = grow_array(loop->continues, &capacity, loop->continue_count + 1, sizeof(size_t));
+        loop->continues[loop->continue_count++] = jump;
+    }
+}
+
+static void compile_while(Compiler* c, const WhileStatement* stmt) {
+    size_t start = c->fs->proto->code_count;
+    compile_expression(c, stmt->condition);
+    size_t exit_jump = emit_jump(c, KOP_JUMP_IF_FALSE, -1);
+
+    Loop loop;
+    begin_loop(c, &loop);
+    compile_statement(c, stmt->body);
+    patch_jumps(c, loop.continues, loop.continue_count);
+    emit_loop(c, start);
+    patch_jump(c, exit_jump);
+    patch_jumps(c, loop.breaks, loop.break_count);
+    c->fs->loop = loop.enclosing;
+}
+
+static void compile_for(Compiler* c, const ForStatement* stmt) {
+    begin_scope(c);     // 初始化语句中声明的变量只在循环内可见
+    if (stmt->initializer) compile_statement(c, stmt->initializer);
+
+    size_t start = c->fs->proto->code_count;
+    size_t exit_jump = 0;
+    if (stmt->condition) {
+        compile_expression(c, stmt->condition);
+        exit_jump = emit_jump(c, KOP_JUMP_IF_FALSE, -1);
+    }
+
+    Loop loop;
+    begin_loop(c, &loop);
+    compile_statement(c, stmt->body);
+    patch_jumps(c, loop.continues, loop.continue_count);
+    if (stmt->update) {
+        compile_expression(c, stmt->update);
+        emit_op(c, KOP_POP, -1);
+    }
+    emit_loop(c, start);
+    if (stmt->condition) patch_jump(c, exit_jump);
+    patch_jumps(c, loop.breaks, loop.break_count);
+    c->fs->loop = loop.enclosing;
+    end_scope(c);
+}
+
+static void compile_statement(Compiler* c, Node* node) {
+    if (node->line) c->line = node->line;
+
+    switch (node->type) {
+        case NODE_LET_STATEMENT: {
+            const LetStatement* stmt = (const LetStatement*)node;
+            compile_variable(c, &stmt->name, stmt->value);
+            break;
+        }
+        case NODE_VAR_STATEMENT: {
+            const VarStatement* stmt = (const VarStatement*)node;
+            compile_variable(c, &stmt->name, stmt->value);
+            break;
+        }
+        case NODE_EXPRESSION_STATEMENT:
+            compile_expression(c, ((const ExpressionStatement*)node)->expression);
+            emit_op(c, KOP_POP, -1);
+            break;
+        case NODE_BLOCK_STATEMENT: {
+            const BlockStatement* block = (const BlockStatement*)node;
+            begin_scope(c);
+            for (size_t i = 0; i < block->statement_count; i++) {
+                compile_statement(c, block->statements[i]);
+            }
+            end_scope(c);
+            break;
+        }
+        case NODE_IF_STATEMENT: {
+            const IfStatement* stmt = (const IfStatement*)node;
+            compile_expression(c, stmt->condition);
+            size_t else_jump = emit_jump(c, KOP_JUMP_IF_FALSE, -1);
+            compile_statement(c, stmt->consequence);
+            if (stmt->alternative) {
+                size_t end_jump = emit_jump(c, KOP_JUMP, 0);
+                patch_jump(c, else_jump);
+                compile_statement(c, stmt->alternative);
+                patch_jump(c, end_jump);
+            } else {
+                patch_jump(c, else_jump);
+            }
+            break;
+        }
+        case NODE_WHILE_STATEMENT:
+            compile_while(c, (const WhileStatement*)node);
+            break;
+        case NODE_FOR_STATEMENT:
+            compile_for(c, (const ForStatement*)node);
+            break;
+        case NODE_BREAK_STATEMENT:
+            compile_jump_statement(c, true);
+            break;
+        case NODE_CONTINUE_STATEMENT:
+            compile_jump_statement(c, false);
+            break;
+        case NODE_RETURN_STATEMENT: {
+            const ReturnStatement* stmt = (const ReturnStatement*)node;
+            if (stmt->return_value) {
+                compile_value(c, stmt->return_value);
+            } else {
+                emit_op(c, KOP_NULL, 1);
+            }
+            emit_op(c, KOP_RETURN, -1);
+            break;
+        }
+        case NODE_STRUCT_DECLARATION:
+            // 顶层的结构体已在 declare_top_level 中处理
+            if (!is_global_scope(c)) {
+                compile_error(c, "struct declarations are only allowed at the top level");
+            }
+            break;
+        case NODE_FUNCTION_LITERAL: {
+            const FunctionLiteral* fn = (const FunctionLiteral*)node;
+            compile_function(c, fn);
+            if (!fn->name.value) {
+                emit_op(c, KOP_POP, -1);
+            } else if (is_global_scope(c)) {
+                emit_op_u16(c, KOP_SET_GLOBAL, 0, (size_t)add_global(c, fn->name.value, false));
+                emit_op(c, KOP_POP, -1);
+            } else {
+                declare_local(c, fn->name.value);
+            }
+            break;
+        }
+        default:
+            compile_error(c, "unsupported statement (%s)", node_type_to_string(node->type));
+            break;
+    }
+}
+
+// =============================================================================
+// 编译入口
+// =============================================================================
+
+KModule* kric_compile(const char* source, const char* file_name) {
+    kri_init_builtins();
+
+    Program* program = parse_program(source);
+    if (!program) return NULL;
+    if (program->error_count > 0) {
+        fprintf(stderr, "%s: %zu syntax error(s)\n", file_name, program->error_count);
+        free_ast((Node*)program);
+        return NULL;
+    }
+
+    KModule* module = calloc(1, sizeof(KModule));
+    if (!module) {
+        fprintf(stderr, "Error: calloc failed in kric_compile\n");
+        exit(EXIT_FAILURE);
+    }
+    module->name = copy_string(file_name, strlen(file_name));
+
+    Compiler c = {.module = module, .fs = NULL, .file_name = file_name, .line = 1, .error_count = 0};
+    declare_top_level(&c, program);
+
+    FuncState fs;
+    module->main = new_proto(&c, "<main>");
+    begin_function(&c, &fs, module->main);
+    for (size_t i = 0; i < program->statement_count; i++) {
+        compile_statement(&c, program->statements[i]);
+    }
+    end_function(&c);
+    free_ast((Node*)program);
+
+    if (c.error_count > 0) {
+        kric_module_free(module);
+        return NULL;
+    }
+    return module;
+}
+
+// 辅助函数：指令的操作数字节数, 不是有效的操作码时返回 -1
+static int operand_size(uint8_t op) {
+    switch ((KOpCode)op) {
+        case KOP_CONST: case KOP_FUNCTION: case KOP_GET_LOCAL: case KOP_SET_LOCAL:
+        case KOP_GET_GLOBAL: case KOP_SET_GLOBAL: case KOP_JUMP: case KOP_JUMP_IF_FALSE:
+        case KOP_AND: case KOP_OR: case KOP_LOOP: case KOP_NEW_ARRAY: case KOP_NEW_MAP:
+        case KOP_NEW_STRUCT_ARRAY:
+            return 2;
+        case KOP_CALL:
+            return 1;
+        case KOP_NEW_STRUCT:
+            return 3;
+        case KOP_GET_FIELD: case KOP_SET_FIELD: case KOP_GET_ELEM_FIELD: case KOP_SET_ELEM_FIELD:
+            return 4;
+        case KOP_NULL: case KOP_TRUE: case KOP_FALSE: case KOP_POP: case KOP_DUP: case KOP_DUP2:
+        case KOP_ADD: case KOP_SUB: case KOP_MUL: case KOP_DIV: case KOP_MOD: case KOP_POW:
+        case KOP_NEG: case KOP_NOT: case KOP_EQ: case KOP_NE: case KOP_LT: case KOP_LE:
+        case KOP_GT: case KOP_GE: case KOP_RETURN: case KOP_GET_INDEX: case KOP_SET_INDEX:
+        case KOP_COPY:
+            return 0;
+    }
+    return -1;
+}
+
+// 辅助函数：指令执行前至少需要的栈深度 (*needs) 与执行后 (不跳转时) 深度的变化, 与编译时的
+// adjust_stack 一致
+static long stack_effect(const uint8_t* code, long* needs) {
+    long a = operand_size(code[0]) >= 1 ? code[1] : 0;
+    long n = operand_size(code[0]) >= 2 ? (long)kric_read_u16(code + 1) : 0;
+    switch ((KOpCode)code[0]) {
+        case KOP_CONST: case KOP_FUNCTION: case KOP_NULL: case KOP_TRUE: case KOP_FALSE:
+        case KOP_GET_LOCAL: case KOP_GET_GLOBAL:
+            *needs = 0; return 1;
+        case KOP_DUP: *needs = 1; return 1;
+        case KOP_DUP2: *needs = 2; return 2;
+        case KOP_POP: case KOP_JUMP_IF_FALSE: case KOP_AND: case KOP_OR: *needs = 1; return -1;
+        case KOP_SET_LOCAL: case KOP_SET_GLOBAL: case KOP_NEG: case KOP_NOT: case KOP_COPY:
+        case KOP_NEW_STRUCT_ARRAY: case KOP_GET_FIELD:
+            *needs = 1; return 0;
+        case KOP_ADD: case KOP_SUB: case KOP_MUL: case KOP_DIV: case KOP_MOD: case KOP_POW:
+        case KOP_EQ: case KOP_NE: case KOP_LT: case KOP_LE: case KOP_GT: case KOP_GE:
+        case KOP_GET_INDEX: case KOP_SET_FIELD: case KOP_GET_ELEM_FIELD:
+            *needs = 2; return -1;
+        case KOP_SET_INDEX: case KOP_SET_ELEM_FIELD: *needs = 3; return -2;
+        case KOP_CALL: *needs = a + 1; return -a;
+        case KOP_NEW_ARRAY: *needs = n; return 1 - n;
+        case KOP_NEW_MAP: *needs = 2 * n; return 1 - 2 * n;
+        case KOP_NEW_STRUCT: *needs = code[3]; return 1 - (long)code[3];
+        case KOP_RETURN: *needs = 1; return -1;
+        case KOP_JUMP: case KOP_LOOP: *needs = 0; return 0;
+    }
+    *needs = LONG_MAX;
+    return 0;
+}
+
+// 辅助函数：记录 target 处的栈深度并加入工作表; 不同路径到达同一条指令时深度必须相同
+static bool reach(long* depths, size_t* work, size_t* work_count, size_t target, long depth) {
+    if (depths[target] == depth) return true;
+    if (depths[target] >= 0) return false;
+    depths[target] = depth;
+    work[(*work_count)++] = target;
+    return true;
+}
+
+// 辅助函数：检查一个原型的字节码。depths 的长度为 code_count, 返回时记录每条可达指令执行前的
+// 栈深度 (相对于调用帧, 含被调函数自身), 不可达或不是指令起始位置的为 -1
+static bool verify_proto(const KModule* module, const KProto* proto, long* depths) {
+    const uint8_t* code = proto->code;
+    size_t count = proto->code_count;
+    // 每个字段访问指令最多一个内联缓存; 参数个数由 u8 操作数传入; 每个字节的指令最多
+    // 压入两个值 (DUP2), 更大的 max_stack 不可能由编译器产生
+    if (count == 0 || proto->cache_count > count || proto->arity < 0 || proto->arity > UINT8_MAX ||
+        proto->max_stack > 2 * count + (size_t)proto->arity + 1) {
+        return false;
+    }
+    for (size_t pos = 0; pos < count;) {
+        depths[pos] = -1;
+        int size = operand_size(code[pos]);
+        if (size < 0 || (size_t)size >= count - pos) return false;
+        for (int i = 1; i <= size; i++) depths[pos + (size_t)i] = -2;
+        pos += 1 + (size_t)size;
+    }
+
+    // 从入口开始沿所有路径推进栈深度 (每条指令只处理一次, 工作表不超过 count 项)
+    size_t* work = malloc(count * sizeof(size_t));
+    if (!work) {
+        fprintf(stderr, "Error: malloc failed in verify_proto\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t work_count = 0;
+    bool ok = reach(depths, work, &work_count, 0, proto->arity + 1);
+    while (ok && work_count > 0) {
+        size_t pos = work[--work_count];
+        const uint8_t* at = code + pos;
+        KOpCode op = (KOpCode)at[0];
+        long depth = depths[pos];
+        long needs;
+        long after = depth + stack_effect(at, &needs);
+        size_t next = pos + 1 + (size_t)operand_size(op);
+        uint16_t operand = operand_size(op) >= 2 ? kric_read_u16(at + 1) : 0;
+        ok = depth >= needs && after <= (long)proto->max_stack;
+        switch (op) {
+            case KOP_CONST:
+                ok = ok && operand < proto->constant_count;
+                break;
+            case KOP_FUNCTION:
+                ok = ok && operand < proto->constant_count && proto->constants[operand].kind == KCONST_FUNCTION;
+                break;
+            case KOP_GET_LOCAL: case KOP_SET_LOCAL:
+                ok = ok && operand < depth;
+                break;
+            case KOP_GET_GLOBAL: case KOP_SET_GLOBAL:
+                ok = ok && operand < module->global_count;
+                break;
+            case KOP_NEW_STRUCT: case KOP_NEW_STRUCT_ARRAY:
+                ok = ok && operand < module->struct_count;
+                break;
+            case KOP_GET_FIELD: case KOP_SET_FIELD: case KOP_GET_ELEM_FIELD: case KOP_SET_ELEM_FIELD:
+                ok = ok && operand < proto->constant_count && proto->constants[operand].kind == KCONST_PATH &&
+                     kric_read_u16(at + 3) < proto->cache_count;
+                break;
+            default:
+                break;
+        }
+        if (!ok) break;
+        switch (op) {
+            case KOP_JUMP:
+                ok = operand < count - next && reach(depths, work, &work_count, next + operand, depth);
+                continue;
+            case KOP_LOOP:
+                ok = operand <= next && next - operand < count &&
+                     reach(depths, work, &work_count, next - operand, depth);
+                continue;
+            case KOP_JUMP_IF_FALSE:
+                ok = operand < count - next && reach(depths, work, &work_count, next + operand, after);
+                break;
+            case KOP_AND: case KOP_OR:
+                // 跳转时保留栈顶
+                ok = operand < count - next && reach(depths, work, &work_count, next + operand, depth);
+                break;
+            case KOP_RETURN:
+                continue;
+            default:
+                break;
+        }
+        // 顺序执行不能越过字节码的末尾
+        ok = ok && next < count && reach(depths, work, &work_count, next, after);
+    }
+    free(work);
+    return ok;
+}
+
+// 辅助函数：为原型分配深度表并检查
+static bool verify_with_depths(const KModule* module, const KProto* proto, size_t offset, long* depth) {
+    long* depths = malloc((proto->code_count ? proto->code_count : 1) * sizeof(long));
+    if (!depths) {
+        fprintf(stderr, "Error: malloc failed in verify_with_depths\n");
+        exit(EXIT_FAILURE);
+    }
+    bool ok = verify_proto(module, proto, depths);
+    if (ok && depth) *depth = offset < proto->code_count ? depths[offset] : -1;
+    free(depths);
+    return ok;
+}
+
+bool kric_module_verify(const KModule* module) {
+    bool ok = module->main != NULL;
+    for (size_t i = 0; ok && i < module->proto_count; i++) {
+        ok = verify_with_depths(module, module->protos[i], 0, NULL);
+    }
+    return ok;
+}
+
+bool kric_verify_resume(const KModule* module, size_t offset, size_t depth) {
+    long reached = -1;
+    return verify_with_depths(module, module->main, offset, &reached) && reached >= 0 && (size_t)reached == depth;
+}
+
+void kric_module_free(KModule* module) {
+    if (!module) return;
+    for (size_t i = 0; i < module->proto_count; i++) {
+        KProto* proto = module->protos[i];
+        for (size_t j = 0; j < proto->constant_count; j++) {
+            KConstantKind kind = proto->constants[j].kind;
+            if (kind == KCONST_STRING || kind == KCONST_PATH || kind == KCONST_BIGINT) {
+                free(proto->constants[j].as.string.chars);
+            }
+        }
+        free(proto->constants);
+        free(proto->code);
+        free(proto->lines);
+        free(proto->name);
+        free(proto->site);
+        free(proto);
+    }
+    free(module->protos);
+    for (size_t i = 0; i < module->global_count; i++) {
+        free(module->globals[i]);
+    }
+    free(module->globals);
+    free(module->global_natives);
+    for (size_t i = 0; i < module->struct_count; i++) {
+        kstruct_type_free(module->structs[i]);
+    }
+    free(module->structs);
+    free(module->name);
+    free(module);
+}
@@ -5,4 +5,164 @@
 #ifndef KORELIN_KRIC_H
 #define KORELIN_KRIC_H
 
-#endif //KORELIN_KRIC_H
\ No newline at end of file
+#include "kstruct.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// =============================================================================
+// 字节码编译器
+//
+// 把 AST 编译为基于栈的字节码。编译结果 (KModule 及其中的 KProto) 只读,
+// 不引用任何 GC 对象, 可以被多个虚拟机共享; 字符串与大整数常量在创建 KProgram
+// 时实例化到共享的冻结堆中, 函数常量在虚拟机第一次执行 KOP_FUNCTION 时才实例化
+// (见 kvm.h)。
+//
+// 局部变量存放在栈槽位中, 编译期解析为槽位下标; 顶层的 let/var/func 为全局
+// 变量, 同样在编译期解析为全局表下标。结构体的字段访问编译为带内联缓存的
+// GET_FIELD/SET_FIELD 指令, 连续的成员访问 (a.b.c) 合并为一条指令、一次偏移读写。
+// =============================================================================
+
+// 操作码, 操作数紧跟在操作码之后 (u16 为小端序的 2 字节)
+typedef enum {
+    KOP_CONST,              // u16 常量下标
+    KOP_FUNCTION,           // u16 函数常量下标: 第一次执行时在虚拟机中创建函数对象
+    KOP_NULL,
+    KOP_TRUE,
+    KOP_FALSE,
+    KOP_POP,
+    KOP_DUP,                // 复制栈顶
+    KOP_DUP2,               // 复制栈顶的两个值
+    KOP_GET_LOCAL,          // u16 槽位
+    KOP_SET_LOCAL,          // u16 槽位, 赋值后保留栈顶
+    KOP_GET_GLOBAL,         // u16 全局下标
+    KOP_SET_GLOBAL,         // u16 全局下标, 赋值后保留栈顶
+    KOP_ADD,
+    KOP_SUB,
+    KOP_MUL,
+    KOP_DIV,
+    KOP_MOD,
+    KOP_POW,
+    KOP_NEG,
+    KOP_NOT,
+    KOP_EQ,
+    KOP_NE,
+    KOP_LT,
+    KOP_LE,
+    KOP_GT,
+    KOP_GE,
+    KOP_JUMP,               // u16 向前跳转的偏移
+    KOP_JUMP_IF_FALSE,      // u16 偏移, 弹出条件
+    KOP_AND,                // u16 偏移: 栈顶为假时保留并跳转, 否则弹出
+    KOP_OR,                 // u16 偏移: 栈顶为真时保留并跳转, 否则弹出
+    KOP_LOOP,               // u16 向后跳转的偏移 (循环回边, 也是 GC 安全点)
+    KOP_CALL,               // u8 参数个数
+    KOP_RETURN,
+    KOP_NEW_ARRAY,          // u16 元素个数
+    KOP_NEW_MAP,            // u16 键值对个数, 栈上键与值交替存放
+    KOP_GET_INDEX,
+    KOP_SET_INDEX,
+    KOP_NEW_STRUCT,         // u16 结构体类型下标, u8 参数个数
+    KOP_NEW_STRUCT_ARRAY,   // u16 结构体类型下标, 元素个数在栈顶
+    KOP_GET_FIELD,          // u16 字段路径常量, u16 内联缓存下标
+    KOP_SET_FIELD,          // u16 字段路径常量, u16 内联缓存下标
+    KOP_GET_ELEM_FIELD,     // 同上, 对象为 数组[下标] 中的元素
+    KOP_SET_ELEM_FIELD,     // 同上
+    KOP_COPY,               // 栈顶为结构体时替换为它的副本 (值语义)
+} KOpCode;
+
+// 常量类型
+typedef enum {
+    KCONST_INT,
+    KCONST_DOUBLE,
+    KCONST_STRING,
+    KCONST_FUNCTION,
+    KCONST_PATH,            // 字段路径, 只由字段访问指令使用, 不实例化
+    KCONST_BIGINT,          // 超出 64 位的整数字面量, 以源码文本保存, 实例化时解析
+} KConstantKind;
+
+struct KProto;
+
+// 常量
+typedef struct KConstant {
+    KConstantKind kind;
+    union {
+        long long integer;
+        double number;
+        struct {
+            char* chars;
+            size_t length;
+        } string;               // KCONST_STRING、KCONST_PATH 与 KCONST_BIGINT
+        struct KProto* proto;   // KCONST_FUNCTION
+    } as;
+} KConstant;
+
+// 函数原型: 一个函数编译后的字节码
+typedef struct KProto {
+    char* name;
+    size_t index;           // 在 KModule.protos 中的下标
+    char* site;             // 分配点描述 "file:name", 用于分配采样
+    int arity;
+    uint8_t* code;
+    int* lines;             // 每个字节对应的源代码行号
+    size_t code_count;
+    size_t code_capacity;
+    KConstant* constants;
+    size_t constant_count;
+    size_t constant_capacity;
+    size_t cache_count;     // 字段访问内联缓存的数量
+    size_t max_stack;       // 运行时最多占用的栈槽位 (含被调函数自身与局部变量)
+} KProto;
+
+// 编译单元
+typedef struct KModule {
+    char* name;             // 源文件名
+    KProto* main;           // 顶层代码
+    KProto** protos;        // 所有函数原型 (含 main)
+    size_t proto_count;
+    char** globals;         // 全局变量名
+    bool* global_natives;   // 全局变量是否绑定到同名原生函数
+    size_t global_count;
+    KStructType** structs;  // 结构体类型, 按声明顺序
+    size_t struct_count;
+} KModule;
+
+// --- 函数声明 ---
+
+/**
+ * @brief 编译一段源代码。
+ * @param source 源代码。
+ * @param file_name 源文件名, 用于错误信息与分配点描述。
+ * @return 编译结果, 有语法或编译错误时向 stderr 输出并返回 NULL。需要调用 kric_module_free 释放。
+ */
+KModule* kric_compile(const char* source, const char* file_name);
+
+/**
+ * @brief 释放编译结果。使用它的虚拟机必须先被释放。
+ * @param module 编译结果。
+ */
+void kric_module_free(KModule* module);
+
+/**
+ * @brief 检查编译单元的字节码能否安全执行 (用于从镜像等外部来源载入的编译单元): 操作码
+ *        有效、操作数不越界, 常量、全局变量、结构体类型与内联缓存的下标在范围内, 跳转目标
+ *        是指令的起始位置, 执行不会越过字节码的末尾; 并沿所有路径推算栈深度, 确认每条
+ *        指令的操作数都在栈上、局部槽位已经存在、深度不超过 max_stack。
+ * @return 通过检查时返回 true。
+ */
+bool kric_module_verify(const KModule* module);
+
+/**
+ * @brief 顶层代码能否从 offset 处以 depth 个栈槽位继续执行 (offset 是可达指令的起始位置,
+ *        并且推算的栈深度等于 depth)。编译单元必须已经通过 kric_module_verify。
+ */
+bool kric_verify_resume(const KModule* module, size_t offset, size_t depth);
+
+/**
+ * @brief 读取 u16 操作数。
+ */
+static inline uint16_t kric_read_u16(const uint8_t* code) {
+    return (uint16_t)(code[0] | (code[1] << 8));
+}
+
+#endif //KORELIN_KRIC_H
@@ -2,4 +2,226 @@
 // Created by Helix on 2025/12/28.
 //
 
-#include "krilib.h"
\ No newline at end of file
+#include "krilib.h"
+#include "kimage.h"
+#include "kvm.h"
+#include "libs/karray.h"
+#include "libs/kchannel.h"
+#include "libs/kmap.h"
+#include "libs/kmath.h"
+#include "libs/kparallel.h"
+#include "libs/knet.h"
+#include "libs/kpersist.h"
+#include "libs/kstring.h"
+#include "libs/stdlib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// 已注册的原生函数表
+#define KRI_MAX_NATIVE_TABLES 64
+static const KriNative* native_tables[KRI_MAX_NATIVE_TABLES];
+static size_t native_table_count;
+
+void kri_register_natives(const KriNative* natives) {
+    for (size_t i = 0; i < native_table_count; i++) {
+        if (native_tables[i] == natives) return;
+    }
+    if (native_table_count == KRI_MAX_NATIVE_TABLES) {
+        fprintf(stderr, "Error: too many native tables in kri_register_natives\n");
+        exit(EXIT_FAILURE);
+    }
+    native_tables[native_table_count++] = natives;
+}
+
+const KriNative* kri_find_native(const char* name) {
+    for (size_t i = 0; i < native_table_count; i++) {
+        for (const KriNative* native = native_tables[i]; native->name; native++) {
+            if (strcmp(native->name, name) == 0) return native;
+        }
+    }
+    return NULL;
+}
+
+// =============================================================================
+// gc 模块: 回收器统计与分配点采样
+// =============================================================================
+
+// 辅助函数：向数组追加一个字符串
+static void push_string(KGCHeap* heap, KArray* array, const char* chars) {
+    KString* str = kstring_new(heap, chars, strlen(chars));
+    karray_push(heap, array, KVALUE_OBJECT(str));
+}
+
+// 辅助函数：向结果数组追加一个 [name, value] 对
+static void push_pair(KGCHeap* heap, KArray* result, const char* name, KValue value) {
+    KArray* pair = karray_new(heap, 2);
+    karray_push(heap, result, KVALUE_OBJECT(pair));
+    push_string(heap, pair, name);
+    karray_push(heap, pair, value);
+}
+
+#define STAT_INT(v) KVALUE_INT((long long)(v))
+
+// 辅助函数：进程当前的常驻内存 (字节), 读取 /proc/self/statm, 不可用时返回 0
+static size_t process_rss(void) {
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (!file) return 0;
+    unsigned long long size = 0;
+    unsigned long long resident = 0;
+    int read = fscanf(file, "%llu %llu", &size, &resident);
+    fclose(file);
+    if (read != 2) return 0;
+    return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+// gcStats() -> [[name, value], ...]
+static KValue native_gc_stats(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    (void)argv;
+    KGCHeap* heap = vm->heap;
+    KGCStats stats;
+    kgc_get_stats(heap, &stats, false);
+
+    KArray* result = karray_new(heap, 24);
+    kgc_push_root(heap, &result->obj);
+    push_pair(heap, result, "heap_bytes", STAT_INT(stats.heap_bytes));
+    push_pair(heap, result, "external_bytes", STAT_INT(stats.external_bytes));
+    push_pair(heap, result, "live_bytes", STAT_INT(stats.live_bytes));
+    push_pair(heap, result, "threshold", STAT_INT(stats.threshold));
+    push_pair(heap, result, "mapped_bytes", STAT_INT(stats.mapped_bytes));
+    push_pair(heap, result, "rss_bytes", STAT_INT(process_rss()));
+    push_pair(heap, result, "large_bytes", STAT_INT(stats.large_bytes));
+    push_pair(heap, result, "fragmentation", KVALUE_DOUBLE(stats.fragmentation));
+    push_pair(heap, result, "total_allocated", STAT_INT(stats.total_allocated));
+    push_pair(heap, result, "total_objects", STAT_INT(stats.total_objects));
+    push_pair(heap, result, "alloc_rate", KVALUE_DOUBLE(stats.alloc_rate));
+    push_pair(heap, result, "recent_alloc_rate", KVALUE_DOUBLE(stats.recent_alloc_rate));
+    push_pair(heap, result, "cycles", STAT_INT(stats.cycles));
+    push_pair(heap, result, "full_collections", STAT_INT(stats.full_collections));
+    push_pair(heap, result, "compactions", STAT_INT(stats.compactions));
+    push_pair(heap, result, "bytes_moved", STAT_INT(stats.bytes_moved));
+    push_pair(heap, result, "pages_released", STAT_INT(stats.pages_released));
+    push_pair(heap, result, "pause_count", STAT_INT(stats.pause_count));
+    push_pair(heap, result, "pause_total_ns", STAT_INT(stats.pause_total_ns));
+    push_pair(heap, result, "pause_max_ns", STAT_INT(stats.pause_max_ns));
+    push_pair(heap, result, "mark_ns", STAT_INT(stats.mark_ns));
+    kgc_pop_roots(heap, 1);
+    return KVALUE_OBJECT(result);
+}
+
+// gcPauseHistogram() -> [count, ...], 第 i 项为 [2^(i-1), 2^i) 微秒的停顿次数
+static KValue native_gc_pause_histogram(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    (void)argv;
+    KGCStats stats;
+    kgc_get_stats(vm->heap, &stats, false);
+    KArray* result = karray_new(vm->heap, KGC_PAUSE_BUCKETS);
+    for (unsigned i = 0; i < KGC_PAUSE_BUCKETS; i++) {
+        karray_push(vm->heap, result, STAT_INT(stats.pause_histogram[i]));
+    }
+    return KVALUE_OBJECT(result);
+}
+
+// gcClassStats() -> [[cell_size, pages, cells, cells_used, bytes_used], ...], 最后一项为大对象
+static KValue native_gc_class_stats(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    (void)argv;
+    KGCHeap* heap = vm->heap;
+    KGCStats stats;
+    kgc_get_stats(heap, &stats, true);
+
+    KArray* result = karray_new(heap, KALLOC_CLASS_COUNT + 1);
+    kgc_push_root(heap, &result->obj);
+    for (unsigned i = 0; i <= KALLOC_LARGE_CLASS; i++) {
+        const KAllocClassStats* klass = &stats.classes[i];
+        KArray* row = karray_new(heap, 5);
+        karray_push(heap, result, KVALUE_OBJECT(row));
+        karray_push(heap, row, STAT_INT(klass->cell_size));
+        karray_push(heap, row, STAT_INT(klass->pages));
+        karray_push(heap, row, STAT_INT(klass->cells));
+        karray_push(heap, row, STAT_INT(klass->cells_used));
+        karray_push(heap, row, STAT_INT(klass->bytes_used));
+    }
+    kgc_pop_roots(heap, 1);
+    return KVALUE_OBJECT(result);
+}
+
+// gcSampling(interval): 开启 (interval > 0) 或关闭分配点采样
+static KValue native_gc_sampling(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    if (argv[0].type != KVAL_INT || argv[0].as.integer < 0) return KVALUE_NULL;
+    kgc_set_sampling(vm->heap, (size_t)argv[0].as.integer);
+    return KVALUE_NULL;
+}
+
+// gcAllocSites() -> [[site, type, samples, bytes], ...], 按估算字节数从大到小
+static KValue native_gc_alloc_sites(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    (void)argv;
+    KGCHeap* heap = vm->heap;
+    size_t count = kgc_alloc_sites(heap, NULL, 0);
+    KGCAllocSite* sites = malloc((count ? count : 1) * sizeof(KGCAllocSite));
+    if (!sites) {
+        fprintf(stderr, "Error: malloc failed in native_gc_alloc_sites\n");
+        exit(EXIT_FAILURE);
+    }
+    count = kgc_alloc_sites(heap, sites, count);
+
+    // 先取出结果再分配: 本函数自身的分配也可能被采样, 修改采样表
+    KArray* result = karray_new(heap, count);
+    kgc_push_root(heap, &result->obj);
+    for (size_t i = 0; i < count; i++) {
+        KArray* row = karray_new(heap, 4);
+        karray_push(heap, result, KVALUE_OBJECT(row));
+        push_string(heap, row, sites[i].site ? sites[i].site : "<native>");
+        push_string(heap, row, sites[i].type_name ? sites[i].type_name : "<unknown>");
+        karray_push(heap, row, STAT_INT(sites[i].samples));
+        karray_push(heap, row, STAT_INT(sites[i].bytes));
+    }
+    kgc_pop_roots(heap, 1);
+    free(sites);
+    return KVALUE_OBJECT(result);
+}
+
+// gcSnapshot(path) -> bool: 写入堆快照
+static KValue native_gc_snapshot(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    if (!kvalue_is_object_type(argv[0], KOBJ_STRING)) return KVALUE_BOOL(false);
+    return KVALUE_BOOL(kgc_write_snapshot(vm->heap, ((KString*)argv[0].as.object)->chars));
+}
+
+// gcCollect(): 执行一次完整回收
+static KValue native_gc_collect(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    (void)argv;
+    kgc_collect(vm->heap);
+    return KVALUE_NULL;
+}
+
+static const KriNative gc_natives[] = {
+    {"gcStats", 0, native_gc_stats},
+    {"gcPauseHistogram", 0, native_gc_pause_histogram},
+    {"gcClassStats", 0, native_gc_class_stats},
+    {"gcSampling", 1, native_gc_sampling},
+    {"gcAllocSites", 0, native_gc_alloc_sites},
+    {"gcSnapshot", 1, native_gc_snapshot},
+    {"gcCollect", 0, native_gc_collect},
+    {NULL, 0, NULL},
+};
+
+void kri_init_builtins(void) {
+    kri_register_natives(kri_stdlib_natives);
+    kri_register_natives(kri_array_natives);
+    kri_register_natives(kri_channel_natives);
+    kri_register_natives(kri_image_natives);
+    kri_register_natives(kri_map_natives);
+    kri_register_natives(kri_math_natives);
+    kri_register_natives(kri_parallel_natives);
+    kri_register_natives(kri_net_natives);
+    kri_register_natives(kri_persist_natives);
+    kri_register_natives(kri_string_natives);
+    kri_register_natives(gc_natives);
+    kri_register_natives(kvm_coroutine_natives);
+}
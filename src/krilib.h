@@ -5,4 +5,45 @@
 #ifndef KORELIN_KRILIB_H
 #define KORELIN_KRILIB_H
 
-#endif //KORELIN_KRILIB_H
\ No newline at end of file
+#include "kobject.h"
+#include <stddef.h>
+
+// =============================================================================
+// 运行时内置函数 (原生函数) 注册表
+//
+// 各模块把原生函数以 NULL 结尾的表的形式注册进来, VM 按名字查找并绑定为
+// 脚本中的全局函数。
+// =============================================================================
+
+typedef struct KorelinVM KorelinVM;
+
+// 原生函数: 参数个数已按 arity 检查
+typedef KValue (*KriNativeFn)(KorelinVM* vm, int argc, const KValue* argv);
+
+typedef struct KriNative {
+    const char* name;
+    int arity;              // 参数个数, -1 表示不定
+    KriNativeFn fn;
+} KriNative;
+
+// --- 函数声明 ---
+
+/**
+ * @brief 注册一组原生函数。
+ * @param natives 以 name 为 NULL 的项结尾的表, 必须在程序运行期间保持有效。
+ */
+void kri_register_natives(const KriNative* natives);
+
+/**
+ * @brief 注册所有内置模块的原生函数 (可重复调用)。
+ */
+void kri_init_builtins(void);
+
+/**
+ * @brief 按名字查找原生函数。
+ * @param name 函数名。
+ * @return 找到的原生函数, 不存在时返回 NULL。
+ */
+const KriNative* kri_find_native(const char* name);
+
+#endif //KORELIN_KRILIB_H
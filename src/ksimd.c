@@ -0,0 +1,1524 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#include "ksimd.h"
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define KSIMD_X86 1
+#include <immintrin.h>
+// AVX2 实现按函数单独开启指令集, 不要求整个程序以 -mavx2 编译
+#define KSIMD_AVX2_FN __attribute__((target("avx2")))
+#else
+#define KSIMD_X86 0
+#endif
+
+// 当前级别, -1 表示尚未检测 (多个线程同时检测得到的结果相同)
+static int simd_level = -1;
+
+// 辅助函数：CPU 支持的最高级别
+static KSimdLevel detect_level(void) {
+#if KSIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return KSIMD_AVX2;
+    return KSIMD_SSE2;
+#else
+    return KSIMD_SCALAR;
+#endif
+}
+
+KSimdLevel ksimd_level(void) {
+    int level = __atomic_load_n(&simd_level, __ATOMIC_RELAXED);
+    if (level < 0) {
+        level = (int)detect_level();
+        __atomic_store_n(&simd_level, level, __ATOMIC_RELAXED);
+    }
+    return (KSimdLevel)level;
+}
+
+void ksimd_set_level(KSimdLevel level) {
+    KSimdLevel supported = detect_level();
+    __atomic_store_n(&simd_level, (int)(level < supported ? level : supported), __ATOMIC_RELAXED);
+}
+
+// =============================================================================
+// 标量实现 (所有平台的后备, 也用于向量实现的尾部)
+// =============================================================================
+
+static double sum_f64_scalar(const double* a, size_t n) {
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++) sum += a[i];
+    return sum;
+}
+
+// 整数求和按 uint64 累加, 溢出时回绕
+static uint64_t sum_int_scalar(KElementKind kind, const void* data, size_t n) {
+    uint64_t sum = 0;
+    switch (kind) {
+        case KELEM_INT64:
+            for (size_t i = 0; i < n; i++) sum += (uint64_t)((const int64_t*)data)[i];
+            break;
+        case KELEM_INT32:
+            for (size_t i = 0; i < n; i++) sum += (uint64_t)(int64_t)((const int32_t*)data)[i];
+            break;
+        case KELEM_UINT8:
+            for (size_t i = 0; i < n; i++) sum += ((const uint8_t*)data)[i];
+            break;
+        default:
+            break;
+    }
+    return sum;
+}
+
+static double dot_f64_scalar(const double* a, const double* b, size_t n) {
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+static uint64_t dot_int_scalar(KElementKind kind, const void* a, const void* b, size_t n) {
+    uint64_t sum = 0;
+    switch (kind) {
+        case KELEM_INT64:
+            for (size_t i = 0; i < n; i++) {
+                sum += (uint64_t)((const int64_t*)a)[i] * (uint64_t)((const int64_t*)b)[i];
+            }
+            break;
+        case KELEM_INT32:
+            for (size_t i = 0; i < n; i++) {
+                sum += (uint64_t)((int64_t)((const int32_t*)a)[i] * ((const int32_t*)b)[i]);
+            }
+            break;
+        case KELEM_UINT8:
+            for (size_t i = 0; i < n; i++) {
+                sum += (uint64_t)((const uint8_t*)a)[i] * ((const uint8_t*)b)[i];
+            }
+            break;
+        default:
+            break;
+    }
+    return sum;
+}
+
+// 浮点的最值忽略 NaN: 与 NaN 的比较总是为假
+static void min_max_f64_scalar(const double* a, size_t n, double* min, double* max) {
+    for (size_t i = 0; i < n; i++) {
+        if (a[i] < *min) *min = a[i];
+        if (a[i] > *max) *max = a[i];
+    }
+}
+
+#define MIN_MAX_SCALAR(name, type)                                          \
+    static void name(const type* a, size_t n, type* min, type* max) {       \
+        for (size_t i = 0; i < n; i++) {                                    \
+            if (a[i] < *min) *min = a[i];                                   \
+            if (a[i] > *max) *max = a[i];                                   \
+        }                                                                   \
+    }
+MIN_MAX_SCALAR(min_max_i64_scalar, int64_t)
+MIN_MAX_SCALAR(min_max_i32_scalar, int32_t)
+MIN_MAX_SCALAR(min_max_u8_scalar, uint8_t)
+#undef MIN_MAX_SCALAR
+
+// 逐元素运算: 整数以无符号运算回绕后截断为元素宽度
+#define MAP_SCALAR(name, type, utype)                                                               \
+    static void name(KSimdOp op, type* dst, const type* a, const type* b, bool broadcast, size_t n) { \
+        for (size_t i = 0; i < n; i++) {                                                            \
+            utype x = (utype)a[i];                                                                  \
+            utype y = (utype)(broadcast ? b[0] : b[i]);                                             \
+            dst[i] = (type)(op == KSIMD_ADD ? (utype)(x + y) : (utype)(x * y));                     \
+        }                                                                                           \
+    }
+MAP_SCALAR(map_i64_scalar, int64_t, uint64_t)
+MAP_SCALAR(map_i32_scalar, int32_t, uint32_t)
+MAP_SCALAR(map_u8_scalar, uint8_t, uint32_t)
+#undef MAP_SCALAR
+
+static void map_f64_scalar(KSimdOp op, double* dst, const double* a, const double* b, bool broadcast, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        double y = broadcast ? b[0] : b[i];
+        dst[i] = op == KSIMD_ADD ? a[i] + y : a[i] * y;
+    }
+}
+
+static size_t mismatch_scalar(const unsigned char* a, const unsigned char* b, size_t size) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t x, y;
+        memcpy(&x, a + i, 8);
+        memcpy(&y, b + i, 8);
+        if (x != y) break;
+    }
+    while (i < size && a[i] == b[i]) i++;
+    return i;
+}
+
+// 辅助函数：从 s 开始的一个多字节 UTF-8 字符 (s[0] >= 0x80) 的字节数, 不合法时返回 0。
+// 按 Unicode 表 3-7 检查: 拒绝过长编码、代理项与超过 U+10FFFF 的码点
+static size_t utf8_sequence(const unsigned char* s, size_t n) {
+    unsigned char c = s[0];
+    size_t length;
+    unsigned char low = 0x80, high = 0xBF;     // 第二个字节的范围
+    if (c < 0xC2) return 0;
+    if (c < 0xE0) {
+        length = 2;
+    } else if (c < 0xF0) {
+        length = 3;
+        if (c == 0xE0) low = 0xA0;
+        if (c == 0xED) high = 0x9F;
+    } else if (c < 0xF5) {
+        length = 4;
+        if (c == 0xF0) low = 0x90;
+        if (c == 0xF4) high = 0x8F;
+    } else {
+        return 0;
+    }
+    if (n < length || s[1] < low || s[1] > high) return 0;
+    for (size_t i = 2; i < length; i++) {
+        if ((s[i] & 0xC0) != 0x80) return 0;
+    }
+    return length;
+}
+
+static KStringEncoding utf8_scalar(const unsigned char* s, size_t n) {
+    KStringEncoding encoding = KSTRING_ASCII;
+    size_t i = 0;
+    while (i < n) {
+        // 一次跳过 8 个 ASCII 字节
+        uint64_t word;
+        if (i + 8 <= n && (memcpy(&word, s + i, 8), (word & 0x8080808080808080ull) == 0)) {
+            i += 8;
+            continue;
+        }
+        if (s[i] < 0x80) {
+            i++;
+            continue;
+        }
+        size_t length = utf8_sequence(s + i, n - i);
+        if (length == 0) return KSTRING_BINARY;
+        encoding = KSTRING_UTF8;
+        i += length;
+    }
+    return encoding;
+}
+
+static size_t find_scalar(const unsigned char* s, size_t n, const unsigned char* needle, size_t m) {
+    // 用 memchr 定位首字节 (C 库的实现本身是向量化的), 再比较其余字节
+    if (n < m) return n;
+    const unsigned char* p = s;
+    const unsigned char* end = s + n - m + 1;
+    while (p < end && (p = memchr(p, needle[0], (size_t)(end - p))) != NULL) {
+        if (memcmp(p + 1, needle + 1, m - 1) == 0) return (size_t)(p - s);
+        p++;
+    }
+    return n;
+}
+
+static void ascii_case_scalar(unsigned char* dst, const unsigned char* src, size_t n, bool upper) {
+    unsigned char first = upper ? 'a' : 'A';
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = src[i];
+        dst[i] = (unsigned char)(c - first) < 26 ? (unsigned char)(c ^ 0x20) : c;
+    }
+}
+
+// --- 数学函数 ---
+// exp、log 与 sin/cos 的约减及多项式来自 fdlibm (e_exp.c、e_log.c、k_sin.c、k_cos.c,
+// 系数为 minimax 近似)。向量实现逐条对应这里的运算, 不使用 FMA, 两者的结果逐位相同
+
+#define EXP_LIMIT 708.0             // |x| 不超过此值时 exp(x) 与 2^k 都是规格化数
+#define TRIG_LIMIT 1.0e6            // |x| 不超过此值时 n = round(x·2/π) < 2^20, n 与 π/2 各部分的乘积精确
+
+static const double INV_LN2 = 1.44269504088896338700e+00;
+static const double LN2_HI = 6.93147180369123816490e-01;   // 低 32 位为 0, 与 |k| < 2^20 的乘积精确
+static const double LN2_LO = 1.90821492927058770002e-10;
+static const double EXP_P1 = 1.66666666666666019037e-01;
+static const double EXP_P2 = -2.77777777770155933842e-03;
+static const double EXP_P3 = 6.61375632143793436117e-05;
+static const double EXP_P4 = -1.65339022054652515390e-06;
+static const double EXP_P5 = 4.13813679705723846039e-08;
+
+static const double LOG_LG1 = 6.666666666666735130e-01;
+static const double LOG_LG2 = 3.999999999940941908e-01;
+static const double LOG_LG3 = 2.857142874366239149e-01;
+static const double LOG_LG4 = 2.222219843214978396e-01;
+static const double LOG_LG5 = 1.818357216161805012e-01;
+static const double LOG_LG6 = 1.531383769920937332e-01;
+static const double LOG_LG7 = 1.479819860511658591e-01;
+static const double SQRT2 = 1.41421356237309514547e+00;
+
+// π/2 = PIO2_1 + PIO2_2 + PIO2_3 + PIO2_3T, 前三部分各有 33 位有效数字
+static const double TWO_OVER_PI = 6.36619772367581382433e-01;
+static const double PIO2_1 = 1.57079632673412561417e+00;
+static const double PIO2_2 = 6.07710050630396597660e-11;
+static const double PIO2_3 = 2.02226624871116645580e-21;
+static const double PIO2_3T = 8.47842766036889956997e-32;
+static const double SIN_S1 = -1.66666666666666324348e-01;
+static const double SIN_S2 = 8.33333333332248946124e-03;
+static const double SIN_S3 = -1.98412698298579493134e-04;
+static const double SIN_S4 = 2.75573137070700676789e-06;
+static const double SIN_S5 = -2.50507602534068634195e-08;
+static const double SIN_S6 = 1.58969099521155010221e-10;
+static const double COS_C1 = 4.16666666666666019037e-02;
+static const double COS_C2 = -1.38888888888741095749e-03;
+static const double COS_C3 = 2.48015872894767294178e-05;
+static const double COS_C4 = -2.75573143513906633035e-07;
+static const double COS_C5 = 2.08757232129817482790e-09;
+static const double COS_C6 = -1.13596475577881948265e-11;
+
+static double exp_scalar(double x) {
+    if (!(fabs(x) <= EXP_LIMIT)) return exp(x);
+    // x = k·ln2 + r, |r| <= ln2/2; r = hi - lo 以两个 double 表示
+    double k = nearbyint(x * INV_LN2);
+    double hi = x - k * LN2_HI;
+    double lo = k * LN2_LO;
+    double r = hi - lo;
+    double t = r * r;
+    double c = r - t * (EXP_P1 + t * (EXP_P2 + t * (EXP_P3 + t * (EXP_P4 + t * EXP_P5))));
+    double y = 1.0 - ((lo - (r * c) / (2.0 - c)) - hi);
+    uint64_t bits = (uint64_t)((int64_t)k + 1023) << 52;
+    double scale;
+    memcpy(&scale, &bits, sizeof(scale));
+    return y * scale;
+}
+
+static double log_scalar(double x) {
+    if (!(x >= DBL_MIN && x <= DBL_MAX)) return log(x);
+    // x = 2^k·m, m 在 [√2/2, √2) 内; log(m) = log(1+f) 由 s = f/(2+f) 的奇函数展开
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    double k = (double)((int64_t)(bits >> 52) - 1023);
+    bits = (bits & 0x000FFFFFFFFFFFFFULL) | 0x3FF0000000000000ULL;
+    double m;
+    memcpy(&m, &bits, sizeof(m));
+    if (m > SQRT2) {
+        m *= 0.5;
+        k += 1.0;
+    }
+    double f = m - 1.0;
+    double s = f / (2.0 + f);
+    double z = s * s;
+    double w = z * z;
+    double t1 = w * (LOG_LG2 + w * (LOG_LG4 + w * LOG_LG6));
+    double t2 = z * (LOG_LG1 + w * (LOG_LG3 + w * (LOG_LG5 + w * LOG_LG7)));
+    double hfsq = 0.5 * f * f;
+    return k * LN2_HI - ((hfsq - (s * (hfsq + (t1 + t2)) + k * LN2_LO)) - f);
+}
+
+// 辅助函数：a + b 的舍入结果与舍入误差 (2Sum, 不要求 |a| >= |b|)
+static inline double two_sum(double a, double b, double* error) {
+    double s = a + b;
+    double bb = s - a;
+    *error = (a - (s - bb)) + (b - bb);
+    return s;
+}
+
+static double sin_cos_scalar(double x, bool cosine) {
+    if (!(fabs(x) <= TRIG_LIMIT)) return cosine ? cos(x) : sin(x);
+    // x - n·π/2 = y0 + y1, |y0| <= π/4: 依次减去 π/2 的各部分, 减法的舍入误差累积到 y1
+    double n = nearbyint(x * TWO_OVER_PI);
+    double e2, e3;
+    double r = x - n * PIO2_1;
+    r = two_sum(r, -(n * PIO2_2), &e2);
+    r = two_sum(r, -(n * PIO2_3), &e3);
+    double tail = (e2 + e3) - n * PIO2_3T;
+    double y0 = r + tail;
+    double y1 = (r - y0) + tail;
+    double z = y0 * y0;
+    double w = z * z;
+    double v = z * y0;
+    double rs = SIN_S2 + z * (SIN_S3 + z * (SIN_S4 + z * (SIN_S5 + z * SIN_S6)));
+    double sin_y = y0 - ((z * (0.5 * y1 - v * rs) - y1) - v * SIN_S1);
+    double rc = z * (COS_C1 + z * (COS_C2 + z * COS_C3)) + w * w * (COS_C4 + z * (COS_C5 + z * COS_C6));
+    double hz = 0.5 * z;
+    double one_hz = 1.0 - hz;
+    double cos_y = one_hz + (((1.0 - one_hz) - hz) + (z * rc - y0 * y1));
+    // 按象限选择 sin(y) 或 cos(y) 并取符号
+    int64_t quadrant = (int64_t)n + (cosine ? 1 : 0);
+    double result = (quadrant & 1) ? cos_y : sin_y;
+    result = (quadrant & 2) ? -result : result;
+    return x == 0.0 && !cosine ? x : result;     // 保留 sin(-0) 的符号
+}
+
+static void math_f64_scalar(KSimdMathFn fn, double* dst, const double* src, size_t n) {
+    switch (fn) {
+        case KSIMD_SQRT:
+            for (size_t i = 0; i < n; i++) dst[i] = sqrt(src[i]);
+            break;
+        case KSIMD_EXP:
+            for (size_t i = 0; i < n; i++) dst[i] = exp_scalar(src[i]);
+            break;
+        case KSIMD_LOG:
+            for (size_t i = 0; i < n; i++) dst[i] = log_scalar(src[i]);
+            break;
+        case KSIMD_SIN:
+        case KSIMD_COS:
+            for (size_t i = 0; i < n; i++) dst[i] = sin_cos_scalar(src[i], fn == KSIMD_COS);
+            break;
+    }
+}
+
+// 补偿求和 (Neumaier 对 Kahan 算法的改进): c 累积每次加法的舍入误差, 较大的加数不必在前
+typedef struct {
+    double sum;
+    double c;
+} KahanSum;
+
+static inline void kahan_add(KahanSum* s, double x) {
+    double t = s->sum + x;
+    s->c += fabs(s->sum) >= fabs(x) ? (s->sum - t) + x : (x - t) + s->sum;
+    s->sum = t;
+}
+
+// 辅助函数：补偿后的和; 出现 inf 或 NaN 时补偿项无意义, 返回直接相加的结果
+static double kahan_result(KahanSum s) {
+    return isfinite(s.sum) ? s.sum + s.c : s.sum;
+}
+
+static void fsum_scalar(const double* a, size_t n, KahanSum* s) {
+    for (size_t i = 0; i < n; i++) kahan_add(s, a[i]);
+}
+
+static void fsum_squares_scalar(const double* a, size_t n, double center, KahanSum* deviation, KahanSum* squares) {
+    for (size_t i = 0; i < n; i++) {
+        double d = a[i] - center;
+        kahan_add(deviation, d);
+        kahan_add(squares, d * d);
+    }
+}
+
+#if KSIMD_X86
+
+// =============================================================================
+// SSE2 实现 (x86-64 的基线)
+// =============================================================================
+
+static double sum_f64_sse2(const double* a, size_t n) {
+    __m128d s0 = _mm_setzero_pd();
+    __m128d s1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 = _mm_add_pd(s0, _mm_loadu_pd(a + i));
+        s1 = _mm_add_pd(s1, _mm_loadu_pd(a + i + 2));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(s0, s1));
+    return lanes[0] + lanes[1] + sum_f64_scalar(a + i, n - i);
+}
+
+static uint64_t sum_i64_sse2(const int64_t* a, size_t n) {
+    __m128i s = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        s = _mm_add_epi64(s, _mm_loadu_si128((const __m128i*)(a + i)));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, s);
+    return lanes[0] + lanes[1] + sum_int_scalar(KELEM_INT64, a + i, n - i);
+}
+
+static uint64_t sum_i32_sse2(const int32_t* a, size_t n) {
+    // 符号扩展为 int64 后累加
+    __m128i s = _mm_setzero_si128();
+    __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i sign = _mm_cmpgt_epi32(zero, x);
+        s = _mm_add_epi64(s, _mm_unpacklo_epi32(x, sign));
+        s = _mm_add_epi64(s, _mm_unpackhi_epi32(x, sign));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, s);
+    return lanes[0] + lanes[1] + sum_int_scalar(KELEM_INT32, a + i, n - i);
+}
+
+static uint64_t sum_u8_sse2(const uint8_t* a, size_t n) {
+    // psadbw 把每 8 个字节的和放进一个 64 位通道
+    __m128i s = _mm_setzero_si128();
+    __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        s = _mm_add_epi64(s, _mm_sad_epu8(_mm_loadu_si128((const __m128i*)(a + i)), zero));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, s);
+    return lanes[0] + lanes[1] + sum_int_scalar(KELEM_UINT8, a + i, n - i);
+}
+
+static double dot_f64_sse2(const double* a, const double* b, size_t n) {
+    __m128d s0 = _mm_setzero_pd();
+    __m128d s1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(s0, s1));
+    return lanes[0] + lanes[1] + dot_f64_scalar(a + i, b + i, n - i);
+}
+
+static uint64_t dot_u8_sse2(const uint8_t* a, const uint8_t* b, size_t n) {
+    // 扩展为 int16 后用 pmaddwd 两两相乘相加; int32 通道在溢出之前并入 int64 累加器
+    __m128i zero = _mm_setzero_si128();
+    __m128i total = _mm_setzero_si128();
+    size_t i = 0;
+    while (i + 16 <= n) {
+        __m128i s = _mm_setzero_si128();
+        // 每轮每个通道最多增加 4 * 255 * 255, 8192 轮不会溢出 int32
+        size_t end = n - i > 16 * 8192 ? i + 16 * 8192 : n;
+        for (; i + 16 <= end; i += 16) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+            __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+            s = _mm_add_epi32(s, _mm_madd_epi16(_mm_unpacklo_epi8(x, zero), _mm_unpacklo_epi8(y, zero)));
+            s = _mm_add_epi32(s, _mm_madd_epi16(_mm_unpackhi_epi8(x, zero), _mm_unpackhi_epi8(y, zero)));
+        }
+        total = _mm_add_epi64(total, _mm_unpacklo_epi32(s, zero));
+        total = _mm_add_epi64(total, _mm_unpackhi_epi32(s, zero));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, total);
+    return lanes[0] + lanes[1] + dot_int_scalar(KELEM_UINT8, a + i, b + i, n - i);
+}
+
+static void min_max_f64_sse2(const double* a, size_t n, double* min, double* max) {
+    // minpd/maxpd 在一侧为 NaN 时返回第二个操作数, 把累加器放在第二个操作数即可忽略 NaN
+    __m128d lo = _mm_set1_pd(*min);
+    __m128d hi = _mm_set1_pd(*max);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d x = _mm_loadu_pd(a + i);
+        lo = _mm_min_pd(x, lo);
+        hi = _mm_max_pd(x, hi);
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, lo);
+    for (size_t k = 0; k < 2; k++) *min = lanes[k] < *min ? lanes[k] : *min;
+    _mm_storeu_pd(lanes, hi);
+    for (size_t k = 0; k < 2; k++) *max = lanes[k] > *max ? lanes[k] : *max;
+    min_max_f64_scalar(a + i, n - i, min, max);
+}
+
+static void min_max_i32_sse2(const int32_t* a, size_t n, int32_t* min, int32_t* max) {
+    // SSE2 没有 pminsd, 用比较掩码选择
+    __m128i lo = _mm_set1_epi32(*min);
+    __m128i hi = _mm_set1_epi32(*max);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i less = _mm_cmplt_epi32(x, lo);
+        lo = _mm_or_si128(_mm_and_si128(less, x), _mm_andnot_si128(less, lo));
+        __m128i greater = _mm_cmpgt_epi32(x, hi);
+        hi = _mm_or_si128(_mm_and_si128(greater, x), _mm_andnot_si128(greater, hi));
+    }
+    int32_t lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, lo);
+    for (size_t k = 0; k < 4; k++) *min = lanes[k] < *min ? lanes[k] : *min;
+    _mm_storeu_si128((__m128i*)lanes, hi);
+    for (size_t k = 0; k < 4; k++) *max = lanes[k] > *max ? lanes[k] : *max;
+    min_max_i32_scalar(a + i, n - i, min, max);
+}
+
+static void min_max_u8_sse2(const uint8_t* a, size_t n, uint8_t* min, uint8_t* max) {
+    __m128i lo = _mm_set1_epi8((char)*min);
+    __m128i hi = _mm_set1_epi8((char)*max);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+        lo = _mm_min_epu8(x, lo);
+        hi = _mm_max_epu8(x, hi);
+    }
+    uint8_t lanes[16];
+    _mm_storeu_si128((__m128i*)lanes, lo);
+    for (size_t k = 0; k < 16; k++) *min = lanes[k] < *min ? lanes[k] : *min;
+    _mm_storeu_si128((__m128i*)lanes, hi);
+    for (size_t k = 0; k < 16; k++) *max = lanes[k] > *max ? lanes[k] : *max;
+    min_max_u8_scalar(a + i, n - i, min, max);
+}
+
+static void map_f64_sse2(KSimdOp op, double* dst, const double* a, const double* b, bool broadcast, size_t n) {
+    __m128d scalar = _mm_set1_pd(b[0]);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d x = _mm_loadu_pd(a + i);
+        __m128d y = broadcast ? scalar : _mm_loadu_pd(b + i);
+        _mm_storeu_pd(dst + i, op == KSIMD_ADD ? _mm_add_pd(x, y) : _mm_mul_pd(x, y));
+    }
+    map_f64_scalar(op, dst + i, a + i, broadcast ? b : b + i, broadcast, n - i);
+}
+
+// 整数加法的向量版本; 乘法没有对应的 SSE2 指令, 由调用者使用标量实现
+#define ADD_INT_SSE2(name, type, add, lanes, scalar_fn)                                     \
+    static void name(type* dst, const type* a, const type* b, bool broadcast, size_t n) {  \
+        type pattern[lanes];                                                               \
+        for (size_t k = 0; k < (lanes); k++) pattern[k] = b[0];                            \
+        __m128i splat = _mm_loadu_si128((const __m128i*)pattern);                          \
+        size_t i = 0;                                                                      \
+        for (; i + (lanes) <= n; i += (lanes)) {                                           \
+            __m128i x = _mm_loadu_si128((const __m128i*)(a + i));                          \
+            __m128i y = broadcast ? splat : _mm_loadu_si128((const __m128i*)(b + i));      \
+            _mm_storeu_si128((__m128i*)(dst + i), add(x, y));                              \
+        }                                                                                  \
+        scalar_fn(KSIMD_ADD, dst + i, a + i, broadcast ? b : b + i, broadcast, n - i);      \
+    }
+ADD_INT_SSE2(add_i64_sse2, int64_t, _mm_add_epi64, 2, map_i64_scalar)
+ADD_INT_SSE2(add_i32_sse2, int32_t, _mm_add_epi32, 4, map_i32_scalar)
+ADD_INT_SSE2(add_u8_sse2, uint8_t, _mm_add_epi8, 16, map_u8_scalar)
+#undef ADD_INT_SSE2
+
+static size_t mismatch_sse2(const unsigned char* a, const unsigned char* b, size_t size) {
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y));
+        if (mask != 0xFFFF) return i + (size_t)__builtin_ctz(~mask);
+    }
+    return i + mismatch_scalar(a + i, b + i, size - i);
+}
+
+static KStringEncoding utf8_sse2(const unsigned char* s, size_t n) {
+    // SSE2 没有字节查表指令, 只向量化 ASCII 的部分, 多字节字符逐个检查
+    KStringEncoding encoding = KSTRING_ASCII;
+    size_t i = 0;
+    while (i < n) {
+        if (i + 16 <= n && _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(s + i))) == 0) {
+            i += 16;
+            continue;
+        }
+        if (s[i] < 0x80) {
+            i++;
+            continue;
+        }
+        size_t length = utf8_sequence(s + i, n - i);
+        if (length == 0) return KSTRING_BINARY;
+        encoding = KSTRING_UTF8;
+        i += length;
+    }
+    return encoding;
+}
+
+// 查找 (m >= 2): 同时比较每个候选位置的首字节与末字节, 两者都相同的位置才比较中间部分
+static size_t find_sse2(const unsigned char* s, size_t n, const unsigned char* needle, size_t m) {
+    __m128i first = _mm_set1_epi8((char)needle[0]);
+    __m128i last = _mm_set1_epi8((char)needle[m - 1]);
+    size_t i = 0;
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        __m128i a = _mm_cmpeq_epi8(first, _mm_loadu_si128((const __m128i*)(s + i)));
+        __m128i b = _mm_cmpeq_epi8(last, _mm_loadu_si128((const __m128i*)(s + i + m - 1)));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(a, b));
+        while (mask) {
+            size_t at = i + (size_t)__builtin_ctz(mask);
+            if (memcmp(s + at + 1, needle + 1, m - 2) == 0) return at;
+            mask &= mask - 1;
+        }
+    }
+    size_t rest = find_scalar(s + i, n - i, needle, m);
+    return rest == n - i ? n : i + rest;
+}
+
+// 大小写转换: 把字节平移到有符号范围的底部, 一次有符号比较选出 26 个字母
+static void ascii_case_sse2(unsigned char* dst, const unsigned char* src, size_t n, bool upper) {
+    __m128i shift = _mm_set1_epi8((char)(0x80 - (upper ? 'a' : 'A')));
+    __m128i limit = _mm_set1_epi8((char)(-128 + 26));
+    __m128i flip = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i letter = _mm_cmplt_epi8(_mm_add_epi8(x, shift), limit);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(x, _mm_and_si128(letter, flip)));
+    }
+    ascii_case_scalar(dst + i, src + i, n - i, upper);
+}
+
+// =============================================================================
+// AVX2 实现
+// =============================================================================
+
+KSIMD_AVX2_FN static double sum_f64_avx2(const double* a, size_t n) {
+    // 4 个累加器掩盖加法延迟
+    __m256d s0 = _mm256_setzero_pd();
+    __m256d s1 = _mm256_setzero_pd();
+    __m256d s2 = _mm256_setzero_pd();
+    __m256d s3 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        s0 = _mm256_add_pd(s0, _mm256_loadu_pd(a + i));
+        s1 = _mm256_add_pd(s1, _mm256_loadu_pd(a + i + 4));
+        s2 = _mm256_add_pd(s2, _mm256_loadu_pd(a + i + 8));
+        s3 = _mm256_add_pd(s3, _mm256_loadu_pd(a + i + 12));
+    }
+    for (; i + 4 <= n; i += 4) {
+        s0 = _mm256_add_pd(s0, _mm256_loadu_pd(a + i));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3)));
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + sum_f64_scalar(a + i, n - i);
+}
+
+KSIMD_AVX2_FN static uint64_t sum_i64_avx2(const int64_t* a, size_t n) {
+    __m256i s0 = _mm256_setzero_si256();
+    __m256i s1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm256_add_epi64(s0, _mm256_loadu_si256((const __m256i*)(a + i)));
+        s1 = _mm256_add_epi64(s1, _mm256_loadu_si256((const __m256i*)(a + i + 4)));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, _mm256_add_epi64(s0, s1));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum_int_scalar(KELEM_INT64, a + i, n - i);
+}
+
+KSIMD_AVX2_FN static uint64_t sum_i32_avx2(const int32_t* a, size_t n) {
+    __m256i s0 = _mm256_setzero_si256();
+    __m256i s1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm256_add_epi64(s0, _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)(a + i))));
+        s1 = _mm256_add_epi64(s1, _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)(a + i + 4))));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, _mm256_add_epi64(s0, s1));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum_int_scalar(KELEM_INT32, a + i, n - i);
+}
+
+KSIMD_AVX2_FN static uint64_t sum_u8_avx2(const uint8_t* a, size_t n) {
+    __m256i s = _mm256_setzero_si256();
+    __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        s = _mm256_add_epi64(s, _mm256_sad_epu8(_mm256_loadu_si256((const __m256i*)(a + i)), zero));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, s);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum_int_scalar(KELEM_UINT8, a + i, n - i);
+}
+
+KSIMD_AVX2_FN static double dot_f64_avx2(const double* a, const double* b, size_t n) {
+    // 不使用 FMA: 保持与 SSE2 和标量实现相同的逐次舍入
+    __m256d s0 = _mm256_setzero_pd();
+    __m256d s1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm256_add_pd(s0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        s1 = _mm256_add_pd(s1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(s0, s1));
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + dot_f64_scalar(a + i, b + i, n - i);
+}
+
+KSIMD_AVX2_FN static uint64_t dot_i32_avx2(const int32_t* a, const int32_t* b, size_t n) {
+    // 符号扩展为 int64 后 vpmuldq 得到精确的 64 位乘积
+    __m256i s = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)(a + i)));
+        __m256i y = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)(b + i)));
+        s = _mm256_add_epi64(s, _mm256_mul_epi32(x, y));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, s);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + dot_int_scalar(KELEM_INT32, a + i, b + i, n - i);
+}
+
+KSIMD_AVX2_FN static void min_max_f64_avx2(const double* a, size_t n, double* min, double* max) {
+    __m256d lo = _mm256_set1_pd(*min);
+    __m256d hi = _mm256_set1_pd(*max);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_loadu_pd(a + i);
+        lo = _mm256_min_pd(x, lo);
+        hi = _mm256_max_pd(x, hi);
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, lo);
+    for (size_t k = 0; k < 4; k++) *min = lanes[k] < *min ? lanes[k] : *min;
+    _mm256_storeu_pd(lanes, hi);
+    for (size_t k = 0; k < 4; k++) *max = lanes[k] > *max ? lanes[k] : *max;
+    min_max_f64_scalar(a + i, n - i, min, max);
+}
+
+KSIMD_AVX2_FN static void min_max_i64_avx2(const int64_t* a, size_t n, int64_t* min, int64_t* max) {
+    __m256i lo = _mm256_set1_epi64x(*min);
+    __m256i hi = _mm256_set1_epi64x(*max);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        lo = _mm256_blendv_epi8(lo, x, _mm256_cmpgt_epi64(lo, x));
+        hi = _mm256_blendv_epi8(hi, x, _mm256_cmpgt_epi64(x, hi));
+    }
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, lo);
+    for (size_t k = 0; k < 4; k++) *min = lanes[k] < *min ? lanes[k] : *min;
+    _mm256_storeu_si256((__m256i*)lanes, hi);
+    for (size_t k = 0; k < 4; k++) *max = lanes[k] > *max ? lanes[k] : *max;
+    min_max_i64_scalar(a + i, n - i, min, max);
+}
+
+KSIMD_AVX2_FN static void min_max_i32_avx2(const int32_t* a, size_t n, int32_t* min, int32_t* max) {
+    __m256i lo = _mm256_set1_epi32(*min);
+    __m256i hi = _mm256_set1_epi32(*max);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        lo = _mm256_min_epi32(x, lo);
+        hi = _mm256_max_epi32(x, hi);
+    }
+    int32_t lanes[8];
+    _mm256_storeu_si256((__m256i*)lanes, lo);
+    for (size_t k = 0; k < 8; k++) *min = lanes[k] < *min ? lanes[k] : *min;
+    _mm256_storeu_si256((__m256i*)lanes, hi);
+    for (size_t k = 0; k < 8; k++) *max = lanes[k] > *max ? lanes[k] : *max;
+    min_max_i32_scalar(a + i, n - i, min, max);
+}
+
+KSIMD_AVX2_FN static void min_max_u8_avx2(const uint8_t* a, size_t n, uint8_t* min, uint8_t* max) {
+    __m256i lo = _mm256_set1_epi8((char)*min);
+    __m256i hi = _mm256_set1_epi8((char)*max);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        lo = _mm256_min_epu8(x, lo);
+        hi = _mm256_max_epu8(x, hi);
+    }
+    uint8_t lanes[32];
+    _mm256_storeu_si256((__m256i*)lanes, lo);
+    for (size_t k = 0; k < 32; k++) *min = lanes[k] < *min ? lanes[k] : *min;
+    _mm256_storeu_si256((__m256i*)lanes, hi);
+    for (size_t k = 0; k < 32; k++) *max = lanes[k] > *max ? lanes[k] : *max;
+    min_max_u8_scalar(a + i, n - i, min, max);
+}
+
+KSIMD_AVX2_FN static void map_f64_avx2(KSimdOp op, double* dst, const double* a, const double* b, bool broadcast,
+                                       size_t n) {
+    __m256d scalar = _mm256_set1_pd(b[0]);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_loadu_pd(a + i);
+        __m256d y = broadcast ? scalar : _mm256_loadu_pd(b + i);
+        _mm256_storeu_pd(dst + i, op == KSIMD_ADD ? _mm256_add_pd(x, y) : _mm256_mul_pd(x, y));
+    }
+    map_f64_scalar(op, dst + i, a + i, broadcast ? b : b + i, broadcast, n - i);
+}
+
+KSIMD_AVX2_FN static void map_i32_avx2(KSimdOp op, int32_t* dst, const int32_t* a, const int32_t* b, bool broadcast,
+                                       size_t n) {
+    __m256i scalar = _mm256_set1_epi32(b[0]);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = broadcast ? scalar : _mm256_loadu_si256((const __m256i*)(b + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), op == KSIMD_ADD ? _mm256_add_epi32(x, y) : _mm256_mullo_epi32(x, y));
+    }
+    map_i32_scalar(op, dst + i, a + i, broadcast ? b : b + i, broadcast, n - i);
+}
+
+KSIMD_AVX2_FN static void add_i64_avx2(int64_t* dst, const int64_t* a, const int64_t* b, bool broadcast, size_t n) {
+    __m256i scalar = _mm256_set1_epi64x(b[0]);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = broadcast ? scalar : _mm256_loadu_si256((const __m256i*)(b + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_add_epi64(x, y));
+    }
+    map_i64_scalar(KSIMD_ADD, dst + i, a + i, broadcast ? b : b + i, broadcast, n - i);
+}
+
+KSIMD_AVX2_FN static void add_u8_avx2(uint8_t* dst, const uint8_t* a, const uint8_t* b, bool broadcast, size_t n) {
+    __m256i scalar = _mm256_set1_epi8((char)b[0]);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = broadcast ? scalar : _mm256_loadu_si256((const __m256i*)(b + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_add_epi8(x, y));
+    }
+    map_u8_scalar(KSIMD_ADD, dst + i, a + i, broadcast ? b : b + i, broadcast, n - i);
+}
+
+KSIMD_AVX2_FN static size_t mismatch_avx2(const unsigned char* a, const unsigned char* b, size_t size) {
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+        if (mask != 0xFFFFFFFFu) return i + (size_t)__builtin_ctz(~mask);
+    }
+    return i + mismatch_sse2(a + i, b + i, size - i);
+}
+
+// UTF-8 检查 (Keiser 与 Lemire 的查表算法): 每个字节与它前面的字节组成的字节对, 用两个
+// 字节的高 4 位与前一字节的低 4 位查三张表, 三个结果按位与之后非 0 即为错误 (过短、
+// 过长、过长编码、代理项、超出范围)。三、四字节字符中第二个之后的续字节另外检查
+#define UTF8_TOO_SHORT (1 << 0)
+#define UTF8_TOO_LONG (1 << 1)
+#define UTF8_OVERLONG_3 (1 << 2)
+#define UTF8_TOO_LARGE (1 << 3)
+#define UTF8_SURROGATE (1 << 4)
+#define UTF8_OVERLONG_2 (1 << 5)
+#define UTF8_TOO_LARGE_1000 (1 << 6)
+#define UTF8_OVERLONG_4 (1 << 6)
+#define UTF8_TWO_CONTS (-0x80)     // 第 7 位, 写成负数以便作为 char 参数
+#define UTF8_CARRY (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+#define UTF8_TABLE(...) _mm256_setr_epi8(__VA_ARGS__, __VA_ARGS__)
+
+typedef struct Utf8State {
+    __m256i previous;       // 上一块
+    __m256i incomplete;     // 上一块末尾未完成的多字节字符
+    __m256i error;
+    __m256i any;            // 所有字节按位或, 判断是否全为 ASCII
+} Utf8State;
+
+KSIMD_AVX2_FN static inline __m256i high_nibbles(__m256i x) {
+    return _mm256_and_si256(_mm256_srli_epi16(x, 4), _mm256_set1_epi8(0x0F));
+}
+
+// 辅助函数：把 input 与上一块拼接后右移 n 个字节, 得到每个位置前面第 n 个字节
+#define UTF8_PREV(input, previous, n) \
+    _mm256_alignr_epi8(input, _mm256_permute2x128_si256(previous, input, 0x21), 16 - (n))
+
+KSIMD_AVX2_FN static void utf8_block_avx2(Utf8State* state, __m256i input) {
+    state->any = _mm256_or_si256(state->any, input);
+    if (_mm256_movemask_epi8(input) == 0) {
+        // 全是 ASCII: 只需要确认上一块没有未完成的字符
+        state->error = _mm256_or_si256(state->error, state->incomplete);
+        state->previous = input;
+        return;
+    }
+    const __m256i byte1_high = UTF8_TABLE(
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+        UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+        UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+        UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4);
+    const __m256i byte1_low = UTF8_TABLE(
+        UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+        UTF8_CARRY | UTF8_OVERLONG_2,
+        UTF8_CARRY, UTF8_CARRY,
+        UTF8_CARRY | UTF8_TOO_LARGE,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000);
+    const __m256i byte2_high = UTF8_TABLE(
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT);
+
+    __m256i prev1 = UTF8_PREV(input, state->previous, 1);
+    __m256i special = _mm256_and_si256(
+        _mm256_and_si256(_mm256_shuffle_epi8(byte1_high, high_nibbles(prev1)),
+                         _mm256_shuffle_epi8(byte1_low, _mm256_and_si256(prev1, _mm256_set1_epi8(0x0F)))),
+        _mm256_shuffle_epi8(byte2_high, high_nibbles(input)));
+    // 前面第 2 个字节 >= 0xE0 或第 3 个字节 >= 0xF0 的位置必须是续字节, 查表只标记了
+    // 两个续字节相邻 (TWO_CONTS), 两者异或后不一致的位置为错误
+    __m256i prev2 = UTF8_PREV(input, state->previous, 2);
+    __m256i prev3 = UTF8_PREV(input, state->previous, 3);
+    __m256i must_continue = _mm256_or_si256(_mm256_subs_epu8(prev2, _mm256_set1_epi8((char)(0xE0 - 0x80))),
+                                            _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xF0 - 0x80))));
+    must_continue = _mm256_and_si256(must_continue, _mm256_set1_epi8((char)0x80));
+    state->error = _mm256_or_si256(state->error, _mm256_xor_si256(must_continue, special));
+
+    // 最后 3 个字节中开始了但在本块内没有结束的多字节字符
+    const __m256i max_value = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+    state->incomplete = _mm256_subs_epu8(input, max_value);
+    state->previous = input;
+}
+
+KSIMD_AVX2_FN static KStringEncoding utf8_avx2(const unsigned char* s, size_t n) {
+    Utf8State state = {_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256(),
+                       _mm256_setzero_si256()};
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        utf8_block_avx2(&state, _mm256_loadu_si256((const __m256i*)(s + i)));
+    }
+    if (i < n) {
+        // 末尾不满一块的部分补 0 (ASCII), 末尾未完成的字符在补齐部分被发现
+        unsigned char tail[32] = {0};
+        memcpy(tail, s + i, n - i);
+        utf8_block_avx2(&state, _mm256_loadu_si256((const __m256i*)tail));
+    }
+    __m256i error = _mm256_or_si256(state.error, state.incomplete);
+    if (!_mm256_testz_si256(error, error)) return KSTRING_BINARY;
+    return _mm256_movemask_epi8(state.any) == 0 ? KSTRING_ASCII : KSTRING_UTF8;
+}
+
+#undef UTF8_PREV
+#undef UTF8_TABLE
+
+KSIMD_AVX2_FN static size_t find_avx2(const unsigned char* s, size_t n, const unsigned char* needle, size_t m) {
+    __m256i first = _mm256_set1_epi8((char)needle[0]);
+    __m256i last = _mm256_set1_epi8((char)needle[m - 1]);
+    size_t i = 0;
+    for (; i + m - 1 + 32 <= n; i += 32) {
+        __m256i a = _mm256_cmpeq_epi8(first, _mm256_loadu_si256((const __m256i*)(s + i)));
+        __m256i b = _mm256_cmpeq_epi8(last, _mm256_loadu_si256((const __m256i*)(s + i + m - 1)));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(a, b));
+        while (mask) {
+            size_t at = i + (size_t)__builtin_ctz(mask);
+            if (memcmp(s + at + 1, needle + 1, m - 2) == 0) return at;
+            mask &= mask - 1;
+        }
+    }
+    size_t rest = find_sse2(s + i, n - i, needle, m);
+    return rest == n - i ? n : i + rest;
+}
+
+KSIMD_AVX2_FN static void ascii_case_avx2(unsigned char* dst, const unsigned char* src, size_t n, bool upper) {
+    __m256i shift = _mm256_set1_epi8((char)(0x80 - (upper ? 'a' : 'A')));
+    __m256i limit = _mm256_set1_epi8((char)(-128 + 26));
+    __m256i flip = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i letter = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(x, shift));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_xor_si256(x, _mm256_and_si256(letter, flip)));
+    }
+    ascii_case_sse2(dst + i, src + i, n - i, upper);
+}
+
+// --- 数学函数 (与标量实现逐条对应) ---
+
+// 辅助函数：整数值的 double (|k| < 2^51) 转换为 int64: 加上 1.5·2^52 后整数位于尾数的低位
+KSIMD_AVX2_FN static inline __m256i to_int64_avx2(__m256d k) {
+    __m256d magic = _mm256_set1_pd(6755399441055744.0);
+    return _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(k, magic)), _mm256_castpd_si256(magic));
+}
+
+KSIMD_AVX2_FN static inline __m256d abs_avx2(__m256d x) {
+    return _mm256_andnot_pd(_mm256_set1_pd(-0.0), x);
+}
+
+KSIMD_AVX2_FN static inline __m256d two_sum_avx2(__m256d a, __m256d b, __m256d* error) {
+    __m256d s = _mm256_add_pd(a, b);
+    __m256d bb = _mm256_sub_pd(s, a);
+    *error = _mm256_add_pd(_mm256_sub_pd(a, _mm256_sub_pd(s, bb)), _mm256_sub_pd(b, bb));
+    return s;
+}
+
+KSIMD_AVX2_FN static inline __m256d exp_avx2(__m256d x) {
+    __m256d k = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(INV_LN2)),
+                                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d hi = _mm256_sub_pd(x, _mm256_mul_pd(k, _mm256_set1_pd(LN2_HI)));
+    __m256d lo = _mm256_mul_pd(k, _mm256_set1_pd(LN2_LO));
+    __m256d r = _mm256_sub_pd(hi, lo);
+    __m256d t = _mm256_mul_pd(r, r);
+    __m256d p = _mm256_add_pd(_mm256_set1_pd(EXP_P4), _mm256_mul_pd(t, _mm256_set1_pd(EXP_P5)));
+    p = _mm256_add_pd(_mm256_set1_pd(EXP_P3), _mm256_mul_pd(t, p));
+    p = _mm256_add_pd(_mm256_set1_pd(EXP_P2), _mm256_mul_pd(t, p));
+    p = _mm256_add_pd(_mm256_set1_pd(EXP_P1), _mm256_mul_pd(t, p));
+    __m256d c = _mm256_sub_pd(r, _mm256_mul_pd(t, p));
+    __m256d q = _mm256_div_pd(_mm256_mul_pd(r, c), _mm256_sub_pd(_mm256_set1_pd(2.0), c));
+    __m256d y = _mm256_sub_pd(_mm256_set1_pd(1.0), _mm256_sub_pd(_mm256_sub_pd(lo, q), hi));
+    __m256i bits = _mm256_slli_epi64(_mm256_add_epi64(to_int64_avx2(k), _mm256_set1_epi64x(1023)), 52);
+    return _mm256_mul_pd(y, _mm256_castsi256_pd(bits));
+}
+
+KSIMD_AVX2_FN static inline __m256d log_avx2(__m256d x) {
+    __m256d two52 = _mm256_set1_pd(4503599627370496.0);
+    __m256i bits = _mm256_castpd_si256(x);
+    // 指数位与 2^52 的尾数拼接后减去 2^52 + 1023 得到 k
+    __m256i exponent = _mm256_srli_epi64(bits, 52);
+    __m256d k = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(exponent, _mm256_castpd_si256(two52))),
+                              _mm256_set1_pd(4503599627370496.0 + 1023.0));
+    __m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL)),
+                                                    _mm256_set1_epi64x(0x3FF0000000000000LL)));
+    __m256d big = _mm256_cmp_pd(m, _mm256_set1_pd(SQRT2), _CMP_GT_OQ);
+    m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), big);
+    k = _mm256_add_pd(k, _mm256_and_pd(big, _mm256_set1_pd(1.0)));
+    __m256d f = _mm256_sub_pd(m, _mm256_set1_pd(1.0));
+    __m256d s = _mm256_div_pd(f, _mm256_add_pd(_mm256_set1_pd(2.0), f));
+    __m256d z = _mm256_mul_pd(s, s);
+    __m256d w = _mm256_mul_pd(z, z);
+    __m256d t1 = _mm256_add_pd(_mm256_set1_pd(LOG_LG4), _mm256_mul_pd(w, _mm256_set1_pd(LOG_LG6)));
+    t1 = _mm256_mul_pd(w, _mm256_add_pd(_mm256_set1_pd(LOG_LG2), _mm256_mul_pd(w, t1)));
+    __m256d t2 = _mm256_add_pd(_mm256_set1_pd(LOG_LG5), _mm256_mul_pd(w, _mm256_set1_pd(LOG_LG7)));
+    t2 = _mm256_add_pd(_mm256_set1_pd(LOG_LG3), _mm256_mul_pd(w, t2));
+    t2 = _mm256_mul_pd(z, _mm256_add_pd(_mm256_set1_pd(LOG_LG1), _mm256_mul_pd(w, t2)));
+    __m256d hfsq = _mm256_mul_pd(_mm256_mul_pd(_mm256_set1_pd(0.5), f), f);
+    __m256d inner = _mm256_add_pd(_mm256_mul_pd(s, _mm256_add_pd(hfsq, _mm256_add_pd(t1, t2))),
+                                  _mm256_mul_pd(k, _mm256_set1_pd(LN2_LO)));
+    return _mm256_sub_pd(_mm256_mul_pd(k, _mm256_set1_pd(LN2_HI)),
+                         _mm256_sub_pd(_mm256_sub_pd(hfsq, inner), f));
+}
+
+KSIMD_AVX2_FN static inline __m256d sin_cos_avx2(__m256d x, bool cosine) {
+    __m256d n = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(TWO_OVER_PI)),
+                                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d e2, e3;
+    __m256d r = _mm256_sub_pd(x, _mm256_mul_pd(n, _mm256_set1_pd(PIO2_1)));
+    r = two_sum_avx2(r, _mm256_sub_pd(_mm256_setzero_pd(), _mm256_mul_pd(n, _mm256_set1_pd(PIO2_2))), &e2);
+    r = two_sum_avx2(r, _mm256_sub_pd(_mm256_setzero_pd(), _mm256_mul_pd(n, _mm256_set1_pd(PIO2_3))), &e3);
+    __m256d tail = _mm256_sub_pd(_mm256_add_pd(e2, e3), _mm256_mul_pd(n, _mm256_set1_pd(PIO2_3T)));
+    __m256d y0 = _mm256_add_pd(r, tail);
+    __m256d y1 = _mm256_add_pd(_mm256_sub_pd(r, y0), tail);
+    __m256d z = _mm256_mul_pd(y0, y0);
+    __m256d w = _mm256_mul_pd(z, z);
+    __m256d v = _mm256_mul_pd(z, y0);
+    __m256d half = _mm256_set1_pd(0.5);
+    __m256d one = _mm256_set1_pd(1.0);
+
+    __m256d rs = _mm256_add_pd(_mm256_set1_pd(SIN_S5), _mm256_mul_pd(z, _mm256_set1_pd(SIN_S6)));
+    rs = _mm256_add_pd(_mm256_set1_pd(SIN_S4), _mm256_mul_pd(z, rs));
+    rs = _mm256_add_pd(_mm256_set1_pd(SIN_S3), _mm256_mul_pd(z, rs));
+    rs = _mm256_add_pd(_mm256_set1_pd(SIN_S2), _mm256_mul_pd(z, rs));
+    __m256d sin_y = _mm256_mul_pd(z, _mm256_sub_pd(_mm256_mul_pd(half, y1), _mm256_mul_pd(v, rs)));
+    sin_y = _mm256_sub_pd(_mm256_sub_pd(sin_y, y1), _mm256_mul_pd(v, _mm256_set1_pd(SIN_S1)));
+    sin_y = _mm256_sub_pd(y0, sin_y);
+
+    __m256d rc = _mm256_add_pd(_mm256_set1_pd(COS_C2), _mm256_mul_pd(z, _mm256_set1_pd(COS_C3)));
+    rc = _mm256_mul_pd(z, _mm256_add_pd(_mm256_set1_pd(COS_C1), _mm256_mul_pd(z, rc)));
+    __m256d rc2 = _mm256_add_pd(_mm256_set1_pd(COS_C5), _mm256_mul_pd(z, _mm256_set1_pd(COS_C6)));
+    rc2 = _mm256_mul_pd(_mm256_mul_pd(w, w), _mm256_add_pd(_mm256_set1_pd(COS_C4), _mm256_mul_pd(z, rc2)));
+    rc = _mm256_add_pd(rc, rc2);
+    __m256d hz = _mm256_mul_pd(half, z);
+    __m256d one_hz = _mm256_sub_pd(one, hz);
+    __m256d cos_y = _mm256_sub_pd(_mm256_mul_pd(z, rc), _mm256_mul_pd(y0, y1));
+    cos_y = _mm256_add_pd(one_hz, _mm256_add_pd(_mm256_sub_pd(_mm256_sub_pd(one, one_hz), hz), cos_y));
+
+    __m256i quadrant = to_int64_avx2(n);
+    if (cosine) quadrant = _mm256_add_epi64(quadrant, _mm256_set1_epi64x(1));
+    __m256i odd = _mm256_slli_epi64(quadrant, 63);
+    __m256d result = _mm256_blendv_pd(sin_y, cos_y, _mm256_castsi256_pd(odd));
+    __m256i sign = _mm256_slli_epi64(_mm256_srli_epi64(quadrant, 1), 63);
+    result = _mm256_xor_pd(result, _mm256_castsi256_pd(sign));
+    if (!cosine) result = _mm256_blendv_pd(result, x, _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_EQ_OQ));
+    return result;
+}
+
+// 每次计算 4 个元素; need_scalar 中的元素 (超出约减范围) 重新用标量实现计算
+#define MATH_LOOP_AVX2(kernel, need_scalar, scalar)                                         \
+    for (; i + 4 <= n; i += 4) {                                                            \
+        __m256d x = _mm256_loadu_pd(src + i);                                               \
+        __m256d y = kernel;                                                                 \
+        int lanes = _mm256_movemask_pd(need_scalar);                                        \
+        if (lanes) {                                                                        \
+            double in[4], out[4];                                                           \
+            _mm256_storeu_pd(in, x);                                                        \
+            _mm256_storeu_pd(out, y);                                                       \
+            for (int j = 0; j < 4; j++) {                                                   \
+                if (lanes & (1 << j)) out[j] = scalar(in[j]);                               \
+            }                                                                               \
+            y = _mm256_loadu_pd(out);                                                       \
+        }                                                                                   \
+        _mm256_storeu_pd(dst + i, y);                                                       \
+    }
+
+KSIMD_AVX2_FN static void math_f64_avx2(KSimdMathFn fn, double* dst, const double* src, size_t n) {
+    size_t i = 0;
+    switch (fn) {
+        case KSIMD_SQRT:
+            for (; i + 4 <= n; i += 4) _mm256_storeu_pd(dst + i, _mm256_sqrt_pd(_mm256_loadu_pd(src + i)));
+            break;
+        case KSIMD_EXP:
+            MATH_LOOP_AVX2(exp_avx2(x), _mm256_cmp_pd(abs_avx2(x), _mm256_set1_pd(EXP_LIMIT), _CMP_NLE_UQ),
+                           exp)
+            break;
+        case KSIMD_LOG:
+            MATH_LOOP_AVX2(log_avx2(x),
+                           _mm256_or_pd(_mm256_cmp_pd(x, _mm256_set1_pd(DBL_MIN), _CMP_NGE_UQ),
+                                        _mm256_cmp_pd(x, _mm256_set1_pd(DBL_MAX), _CMP_NLE_UQ)),
+                           log)
+            break;
+        case KSIMD_SIN:
+            MATH_LOOP_AVX2(sin_cos_avx2(x, false),
+                           _mm256_cmp_pd(abs_avx2(x), _mm256_set1_pd(TRIG_LIMIT), _CMP_NLE_UQ), sin)
+            break;
+        case KSIMD_COS:
+            MATH_LOOP_AVX2(sin_cos_avx2(x, true),
+                           _mm256_cmp_pd(abs_avx2(x), _mm256_set1_pd(TRIG_LIMIT), _CMP_NLE_UQ), cos)
+            break;
+    }
+    math_f64_scalar(fn, dst + i, src + i, n - i);
+}
+#undef MATH_LOOP_AVX2
+
+KSIMD_AVX2_FN static inline void kahan_add_avx2(__m256d* sum, __m256d* c, __m256d x) {
+    __m256d t = _mm256_add_pd(*sum, x);
+    __m256d sum_larger = _mm256_cmp_pd(abs_avx2(*sum), abs_avx2(x), _CMP_GE_OQ);
+    __m256d big = _mm256_blendv_pd(x, *sum, sum_larger);
+    __m256d small = _mm256_blendv_pd(*sum, x, sum_larger);
+    *c = _mm256_add_pd(*c, _mm256_add_pd(_mm256_sub_pd(big, t), small));
+    *sum = t;
+}
+
+// 辅助函数：把各通道的部分和并入 s (补偿项直接累加, 避免 inf 产生的 NaN 进入和)
+KSIMD_AVX2_FN static void kahan_merge_avx2(KahanSum* s, __m256d sum, __m256d c) {
+    double sums[4], cs[4];
+    _mm256_storeu_pd(sums, sum);
+    _mm256_storeu_pd(cs, c);
+    for (int j = 0; j < 4; j++) {
+        kahan_add(s, sums[j]);
+        s->c += cs[j];
+    }
+}
+
+KSIMD_AVX2_FN static void fsum_avx2(const double* a, size_t n, KahanSum* s) {
+    // 两组累加器交替使用, 掩盖加法链的延迟
+    __m256d s0 = _mm256_setzero_pd(), c0 = _mm256_setzero_pd();
+    __m256d s1 = _mm256_setzero_pd(), c1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        kahan_add_avx2(&s0, &c0, _mm256_loadu_pd(a + i));
+        kahan_add_avx2(&s1, &c1, _mm256_loadu_pd(a + i + 4));
+    }
+    kahan_merge_avx2(s, s0, c0);
+    kahan_merge_avx2(s, s1, c1);
+    fsum_scalar(a + i, n - i, s);
+}
+
+KSIMD_AVX2_FN static void fsum_squares_avx2(const double* a, size_t n, double center, KahanSum* deviation,
+                                            KahanSum* squares) {
+    __m256d shift = _mm256_set1_pd(center);
+    __m256d d_sum = _mm256_setzero_pd(), d_c = _mm256_setzero_pd();
+    __m256d q_sum = _mm256_setzero_pd(), q_c = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d d = _mm256_sub_pd(_mm256_loadu_pd(a + i), shift);
+        kahan_add_avx2(&d_sum, &d_c, d);
+        kahan_add_avx2(&q_sum, &q_c, _mm256_mul_pd(d, d));
+    }
+    kahan_merge_avx2(deviation, d_sum, d_c);
+    kahan_merge_avx2(squares, q_sum, q_c);
+    fsum_squares_scalar(a + i, n - i, center, deviation, squares);
+}
+
+#endif // KSIMD_X86
+
+// =============================================================================
+// 按指令集级别分派
+// =============================================================================
+
+// 辅助函数：整数求和 (按级别分派)
+static uint64_t sum_int(KElementKind kind, const void* data, size_t n, KSimdLevel level) {
+#if KSIMD_X86
+    if (level >= KSIMD_AVX2) {
+        switch (kind) {
+            case KELEM_INT64: return sum_i64_avx2(data, n);
+            case KELEM_INT32: return sum_i32_avx2(data, n);
+            case KELEM_UINT8: return sum_u8_avx2(data, n);
+            default: return 0;
+        }
+    }
+    if (level >= KSIMD_SSE2) {
+        switch (kind) {
+            case KELEM_INT64: return sum_i64_sse2(data, n);
+            case KELEM_INT32: return sum_i32_sse2(data, n);
+            case KELEM_UINT8: return sum_u8_sse2(data, n);
+            default: return 0;
+        }
+    }
+#else
+    (void)level;
+#endif
+    return sum_int_scalar(kind, data, n);
+}
+
+KSimdScalar ksimd_sum(KElementKind kind, const void* data, size_t count) {
+    KSimdLevel level = ksimd_level();
+    KSimdScalar result;
+    if (kind == KELEM_FLOAT64) {
+#if KSIMD_X86
+        if (level >= KSIMD_AVX2) {
+            result.f64 = sum_f64_avx2(data, count);
+        } else if (level >= KSIMD_SSE2) {
+            result.f64 = sum_f64_sse2(data, count);
+        } else
+#endif
+        {
+            result.f64 = sum_f64_scalar(data, count);
+        }
+        return result;
+    }
+    result.i64 = (int64_t)sum_int(kind, data, count, level);
+    return result;
+}
+
+KSimdScalar ksimd_dot(KElementKind kind, const void* a, const void* b, size_t count) {
+    KSimdLevel level = ksimd_level();
+    KSimdScalar result;
+    if (kind == KELEM_FLOAT64) {
+#if KSIMD_X86
+        if (level >= KSIMD_AVX2) {
+            result.f64 = dot_f64_avx2(a, b, count);
+        } else if (level >= KSIMD_SSE2) {
+            result.f64 = dot_f64_sse2(a, b, count);
+        } else
+#endif
+        {
+            result.f64 = dot_f64_scalar(a, b, count);
+        }
+        return result;
+    }
+#if KSIMD_X86
+    if (kind == KELEM_INT32 && level >= KSIMD_AVX2) {
+        result.i64 = (int64_t)dot_i32_avx2(a, b, count);
+        return result;
+    }
+    if (kind == KELEM_UINT8 && level >= KSIMD_SSE2) {
+        result.i64 = (int64_t)dot_u8_sse2(a, b, count);
+        return result;
+    }
+#endif
+    result.i64 = (int64_t)dot_int_scalar(kind, a, b, count);
+    return result;
+}
+
+void ksimd_min_max(KElementKind kind, const void* data, size_t count, KSimdScalar* min, KSimdScalar* max) {
+    KSimdLevel level = ksimd_level();
+#if !KSIMD_X86
+    (void)level;
+#endif
+    switch (kind) {
+        case KELEM_FLOAT64: {
+            double lo = INFINITY, hi = -INFINITY;
+#if KSIMD_X86
+            if (level >= KSIMD_AVX2) {
+                min_max_f64_avx2(data, count, &lo, &hi);
+            } else if (level >= KSIMD_SSE2) {
+                min_max_f64_sse2(data, count, &lo, &hi);
+            } else
+#endif
+            {
+                min_max_f64_scalar(data, count, &lo, &hi);
+            }
+            if (lo > hi) lo = hi = NAN;     // 没有非 NaN 的元素
+            min->f64 = lo;
+            max->f64 = hi;
+            return;
+        }
+        case KELEM_INT64: {
+            int64_t lo = INT64_MAX, hi = INT64_MIN;
+#if KSIMD_X86
+            if (level >= KSIMD_AVX2) {
+                min_max_i64_avx2(data, count, &lo, &hi);
+            } else
+#endif
+            {
+                min_max_i64_scalar(data, count, &lo, &hi);
+            }
+            min->i64 = lo;
+            max->i64 = hi;
+            return;
+        }
+        case KELEM_INT32: {
+            int32_t lo = INT32_MAX, hi = INT32_MIN;
+#if KSIMD_X86
+            if (level >= KSIMD_AVX2) {
+                min_max_i32_avx2(data, count, &lo, &hi);
+            } else if (level >= KSIMD_SSE2) {
+                min_max_i32_sse2(data, count, &lo, &hi);
+            } else
+#endif
+            {
+                min_max_i32_scalar(data, count, &lo, &hi);
+            }
+            min->i64 = lo;
+            max->i64 = hi;
+            return;
+        }
+        case KELEM_UINT8: {
+            uint8_t lo = UINT8_MAX, hi = 0;
+#if KSIMD_X86
+            if (level >= KSIMD_AVX2) {
+                min_max_u8_avx2(data, count, &lo, &hi);
+            } else if (level >= KSIMD_SSE2) {
+                min_max_u8_sse2(data, count, &lo, &hi);
+            } else
+#endif
+            {
+                min_max_u8_scalar(data, count, &lo, &hi);
+            }
+            min->i64 = lo;
+            max->i64 = hi;
+            return;
+        }
+        default:
+            return;
+    }
+}
+
+void ksimd_map(KSimdOp op, KElementKind kind, void* dst, const void* a, const void* b, bool broadcast,
+               size_t count) {
+    KSimdLevel level = ksimd_level();
+#if KSIMD_X86
+    if (level >= KSIMD_AVX2) {
+        switch (kind) {
+            case KELEM_FLOAT64: map_f64_avx2(op, dst, a, b, broadcast, count); return;
+            case KELEM_INT32: map_i32_avx2(op, dst, a, b, broadcast, count); return;
+            case KELEM_INT64:
+                if (op == KSIMD_ADD) {
+                    add_i64_avx2(dst, a, b, broadcast, count);
+                    return;
+                }
+                break;
+            case KELEM_UINT8:
+                if (op == KSIMD_ADD) {
+                    add_u8_avx2(dst, a, b, broadcast, count);
+                    return;
+                }
+                break;
+            default:
+                return;
+        }
+    } else if (level >= KSIMD_SSE2) {
+        switch (kind) {
+            case KELEM_FLOAT64: map_f64_sse2(op, dst, a, b, broadcast, count); return;
+            case KELEM_INT64:
+                if (op == KSIMD_ADD) {
+                    add_i64_sse2(dst, a, b, broadcast, count);
+                    return;
+                }
+                break;
+            case KELEM_INT32:
+                if (op == KSIMD_ADD) {
+                    add_i32_sse2(dst, a, b, broadcast, count);
+                    return;
+                }
+                break;
+            case KELEM_UINT8:
+                if (op == KSIMD_ADD) {
+                    add_u8_sse2(dst, a, b, broadcast, count);
+                    return;
+                }
+                break;
+            default:
+                return;
+        }
+    }
+#else
+    (void)level;
+#endif
+    switch (kind) {
+        case KELEM_FLOAT64: map_f64_scalar(op, dst, a, b, broadcast, count); break;
+        case KELEM_INT64: map_i64_scalar(op, dst, a, b, broadcast, count); break;
+        case KELEM_INT32: map_i32_scalar(op, dst, a, b, broadcast, count); break;
+        case KELEM_UINT8: map_u8_scalar(op, dst, a, b, broadcast, count); break;
+        default: break;
+    }
+}
+
+void ksimd_fill(KElementKind kind, void* dst, const void* value, size_t count) {
+    if (count == 0) return;
+    size_t size = kelement_size(kind);
+    if (size == 1) {
+        memset(dst, *(const unsigned char*)value, count);
+        return;
+    }
+    // 写入第一个元素后成倍复制已填充的部分, 由 memcpy 完成向量化的写入
+    unsigned char* out = dst;
+    size_t total = count * size;
+    memcpy(out, value, size);
+    size_t filled = size;
+    while (filled < total) {
+        size_t chunk = filled < total - filled ? filled : total - filled;
+        memcpy(out + filled, out, chunk);
+        filled += chunk;
+    }
+}
+
+size_t ksimd_mismatch(const void* a, const void* b, size_t size) {
+#if KSIMD_X86
+    KSimdLevel level = ksimd_level();
+    if (level >= KSIMD_AVX2) return mismatch_avx2(a, b, size);
+    if (level >= KSIMD_SSE2) return mismatch_sse2(a, b, size);
+#endif
+    return mismatch_scalar(a, b, size);
+}
+
+KStringEncoding ksimd_utf8_classify(const void* data, size_t size) {
+#if KSIMD_X86
+    // 短字符串 (常见的键与单个字符) 不值得准备查表
+    KSimdLevel level = ksimd_level();
+    if (level >= KSIMD_AVX2 && size >= 32) return utf8_avx2(data, size);
+    if (level >= KSIMD_SSE2) return utf8_sse2(data, size);
+#endif
+    return utf8_scalar(data, size);
+}
+
+size_t ksimd_find(const void* haystack, size_t size, const void* needle, size_t needle_size) {
+    if (needle_size == 0) return 0;
+    if (needle_size > size) return size;
+    if (needle_size == 1) {
+        const unsigned char* p = memchr(haystack, *(const unsigned char*)needle, size);
+        return p ? (size_t)(p - (const unsigned char*)haystack) : size;
+    }
+#if KSIMD_X86
+    KSimdLevel level = ksimd_level();
+    if (level >= KSIMD_AVX2) return find_avx2(haystack, size, needle, needle_size);
+    if (level >= KSIMD_SSE2) return find_sse2(haystack, size, needle, needle_size);
+#endif
+    return find_scalar(haystack, size, needle, needle_size);
+}
+
+void ksimd_ascii_case(void* dst, const void* src, size_t size, bool upper) {
+#if KSIMD_X86
+    KSimdLevel level = ksimd_level();
+    if (level >= KSIMD_AVX2) {
+        ascii_case_avx2(dst, src, size, upper);
+        return;
+    }
+    if (level >= KSIMD_SSE2) {
+        ascii_case_sse2(dst, src, size, upper);
+        return;
+    }
+#endif
+    ascii_case_scalar(dst, src, size, upper);
+}
+
+void ksimd_math(KSimdMathFn fn, double* dst, const double* src, size_t count) {
+#if KSIMD_X86
+    if (ksimd_level() >= KSIMD_AVX2) {
+        math_f64_avx2(fn, dst, src, count);
+        return;
+    }
+#endif
+    math_f64_scalar(fn, dst, src, count);
+}
+
+double ksimd_fsum(const double* data, size_t count) {
+    KahanSum s = {0.0, 0.0};
+#if KSIMD_X86
+    if (ksimd_level() >= KSIMD_AVX2) {
+        fsum_avx2(data, count, &s);
+        return kahan_result(s);
+    }
+#endif
+    fsum_scalar(data, count, &s);
+    return kahan_result(s);
+}
+
+double ksimd_fsum_squares(const double* data, size_t count, double center, double* deviation) {
+    KahanSum d = {0.0, 0.0};
+    KahanSum q = {0.0, 0.0};
+#if KSIMD_X86
+    if (ksimd_level() >= KSIMD_AVX2) {
+        fsum_squares_avx2(data, count, center, &d, &q);
+    } else
+#endif
+    {
+        fsum_squares_scalar(data, count, center, &d, &q);
+    }
+    if (deviation) *deviation = kahan_result(d);
+    return kahan_result(q);
+}
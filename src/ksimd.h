@@ -0,0 +1,140 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#ifndef KORELIN_KSIMD_H
+#define KORELIN_KSIMD_H
+
+#include "kobject.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// =============================================================================
+// 数值数组的批量运算内核与字符串内核
+//
+// 数值内核作用于连续存放的原始数值 (KArray 的非 KELEM_VALUE 形式)。x86-64 上
+// 以 SSE2 为基线, 运行时检测到 AVX2 时使用 256 位的实现; 其他平台使用标量实现。
+// 整数运算按元素宽度回绕, 求和与点积在 int64 中累加。浮点求和与点积在多个
+// 累加器中并行累加, 舍入结果可能与逐个相加略有不同。
+// =============================================================================
+
+// 指令集级别
+typedef enum {
+    KSIMD_SCALAR,
+    KSIMD_SSE2,
+    KSIMD_AVX2,
+} KSimdLevel;
+
+// 逐元素运算
+typedef enum {
+    KSIMD_ADD,
+    KSIMD_MUL,
+} KSimdOp;
+
+// 逐元素的数学函数 (ksimd_math)
+typedef enum {
+    KSIMD_SQRT,
+    KSIMD_EXP,
+    KSIMD_LOG,
+    KSIMD_SIN,
+    KSIMD_COS,
+} KSimdMathFn;
+
+// 数值归约结果: 浮点数组使用 f64, 整数数组使用 i64
+typedef union KSimdScalar {
+    int64_t i64;
+    double f64;
+} KSimdScalar;
+
+// --- 函数声明 ---
+
+/**
+ * @brief 返回当前使用的指令集级别 (首次调用时检测 CPU)。
+ */
+KSimdLevel ksimd_level(void);
+
+/**
+ * @brief 限制使用的指令集级别, 用于对比不同实现, 超过 CPU 支持的级别时取支持的最高级别。
+ * @param level 指令集级别。
+ */
+void ksimd_set_level(KSimdLevel level);
+
+/**
+ * @brief 求和。
+ * @param kind 元素类型, 不能为 KELEM_VALUE。
+ * @param data 元素数据。
+ * @param count 元素个数。
+ * @return 浮点数组返回 f64, 整数数组返回按 int64 回绕的 i64。
+ */
+KSimdScalar ksimd_sum(KElementKind kind, const void* data, size_t count);
+
+/**
+ * @brief 点积 sum(a[i] * b[i]), 累加方式同 ksimd_sum。
+ */
+KSimdScalar ksimd_dot(KElementKind kind, const void* a, const void* b, size_t count);
+
+/**
+ * @brief 同时求最小值与最大值。浮点数组忽略 NaN, 元素全为 NaN 时两者均为 NaN。
+ * @param count 元素个数, 必须大于 0。
+ */
+void ksimd_min_max(KElementKind kind, const void* data, size_t count, KSimdScalar* min, KSimdScalar* max);
+
+/**
+ * @brief 逐元素运算 dst[i] = a[i] op b[i]。dst 可以与 a 或 b 相同。
+ * @param b 第二个操作数; broadcast 为 true 时指向单个元素, 与 a 的每个元素运算。
+ */
+void ksimd_map(KSimdOp op, KElementKind kind, void* dst, const void* a, const void* b, bool broadcast,
+               size_t count);
+
+/**
+ * @brief 用 value 指向的单个元素填充 dst 的 count 个元素。
+ */
+void ksimd_fill(KElementKind kind, void* dst, const void* value, size_t count);
+
+/**
+ * @brief 按字节查找第一个不同的位置。
+ * @return 第一个不同字节的下标, 完全相同时返回 size。
+ */
+size_t ksimd_mismatch(const void* a, const void* b, size_t size);
+
+/**
+ * @brief 检查字节序列的编码: 全为 ASCII、合法的 UTF-8 或二者都不是。
+ *        AVX2 上使用查表的向量化算法, 其他级别向量化地跳过 ASCII 部分。
+ */
+KStringEncoding ksimd_utf8_classify(const void* data, size_t size);
+
+/**
+ * @brief 查找子串第一次出现的位置 (按字节比较)。
+ * @return 子串的起始下标, 不存在时返回 size; needle_size 为 0 时返回 0。
+ */
+size_t ksimd_find(const void* haystack, size_t size, const void* needle, size_t needle_size);
+
+/**
+ * @brief 把 ASCII 字母转换为大写 (upper 为 true) 或小写, 其他字节 (包括 UTF-8 的多字节字符) 不变。
+ *        dst 可以与 src 相同。
+ */
+void ksimd_ascii_case(void* dst, const void* src, size_t size, bool upper);
+
+/**
+ * @brief 逐元素计算数学函数 dst[i] = fn(src[i]), dst 可以与 src 相同。
+ *        sqrt 为正确舍入。exp、log、sin、cos 使用 fdlibm 的约减与多项式, AVX2 上每次计算 4 个
+ *        元素, 其他级别使用运算顺序相同的标量实现 (结果逐位相同), 误差不超过 1 ulp。
+ *        超出约减范围的元素 (exp 的 |x| > 708、log 的 x 不是正的规格化数、sin 与 cos 的
+ *        |x| > 1e6, 以及 inf 与 NaN) 由 libm 计算。
+ */
+void ksimd_math(KSimdMathFn fn, double* dst, const double* src, size_t count);
+
+/**
+ * @brief 补偿求和 (Kahan-Babuška-Neumaier): 误差约为 2 ulp 加上 n·ε²·sum(|x|), 与元素个数基本无关。
+ *        和为 inf 或 NaN 时返回直接相加的结果。
+ */
+double ksimd_fsum(const double* data, size_t count);
+
+/**
+ * @brief 以补偿求和计算 sum((x - center)^2), 用于两遍算法的方差。
+ * @param deviation 写入 sum(x - center), 用于修正 center 与均值之差, 可以为 NULL。
+ */
+double ksimd_fsum_squares(const double* data, size_t count, double center, double* deviation);
+
+#endif //KORELIN_KSIMD_H
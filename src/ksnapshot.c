@@ -0,0 +1,641 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#include "ksnapshot.h"
+#include <stdlib.h>
+#include <string.h>
+
+// 按 id 排序的查找表项
+typedef struct KSnapshotEntry {
+    uint64_t id;
+    uint32_t index;
+} KSnapshotEntry;
+
+// =============================================================================
+// 读取
+// =============================================================================
+
+// 辅助函数：按需扩大数组
+static void* grow_array(void* array, size_t* capacity, size_t needed, size_t element_size) {
+    if (needed <= *capacity) return array;
+    size_t new_capacity = *capacity ? *capacity * 2 : 1024;
+    while (new_capacity < needed) new_capacity *= 2;
+    void* new_array = realloc(array, new_capacity * element_size);
+    if (!new_array) {
+        fprintf(stderr, "Error: realloc failed in grow_array\n");
+        exit(EXIT_FAILURE);
+    }
+    *capacity = new_capacity;
+    return new_array;
+}
+
+static bool read_varint(FILE* file, uint64_t* value) {
+    uint64_t result = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        int c = getc(file);
+        if (c == EOF) return false;
+        result |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static int compare_entries(const void* a, const void* b) {
+    const KSnapshotEntry* x = a;
+    const KSnapshotEntry* y = b;
+    return x->id < y->id ? -1 : x->id > y->id;
+}
+
+// 辅助函数：按 id 查找对象下标
+static uint32_t lookup_id(const KSnapshotEntry* entries, size_t count, uint64_t id) {
+    size_t lo = 0, hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (entries[mid].id < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < count && entries[lo].id == id ? entries[lo].index : KSNAPSHOT_NONE;
+}
+
+// 第一遍: 读取类型、根与对象头, 跳过引用
+static bool load_headers(KSnapshot* snapshot, FILE* file, uint64_t** root_ids) {
+    size_t id_capacity = 0, type_capacity = 0, size_capacity = 0, start_capacity = 0;
+    size_t root_capacity = 0, kind_capacity = 0;
+    size_t edge_total = 0;
+    snapshot->edge_start = NULL;
+
+    for (;;) {
+        int tag = getc(file);
+        uint64_t a, b, c, d;
+        if (tag == 'T') {
+            if (!read_varint(file, &a) || !read_varint(file, &b) || a == 0 || a >= KGC_MAX_TYPES) return false;
+            char* name = malloc(b + 1);
+            if (!name) {
+                fprintf(stderr, "Error: malloc failed in load_headers\n");
+                exit(EXIT_FAILURE);
+            }
+            if (fread(name, 1, b, file) != b) {
+                free(name);
+                return false;
+            }
+            name[b] = '\0';
+            free(snapshot->type_names[a]);
+            snapshot->type_names[a] = name;
+        } else if (tag == 'R') {
+            int kind = getc(file);
+            if (kind == EOF || !read_varint(file, &a)) return false;
+            *root_ids = grow_array(*root_ids, &root_capacity, snapshot->root_count + 1, sizeof(uint64_t));
+            snapshot->root_kinds = grow_array(snapshot->root_kinds, &kind_capacity, snapshot->root_count + 1, 1);
+            (*root_ids)[snapshot->root_count] = a;
+            snapshot->root_kinds[snapshot->root_count] = (uint8_t)kind;
+            snapshot->root_count++;
+        } else if (tag == 'O') {
+            if (!read_varint(file, &a) || !read_varint(file, &b) || !read_varint(file, &c) ||
+                !read_varint(file, &d) || b >= KGC_MAX_TYPES) {
+                return false;
+            }
+            for (uint64_t i = 0; i < d; i++) {
+                uint64_t skip;
+                if (!read_varint(file, &skip)) return false;
+            }
+            size_t n = snapshot->object_count;
+            if (n + 1 >= KSNAPSHOT_NONE) return false;
+            snapshot->ids = grow_array(snapshot->ids, &id_capacity, n + 1, sizeof(uint64_t));
+            snapshot->types = grow_array(snapshot->types, &type_capacity, n + 1, sizeof(uint16_t));
+            snapshot->sizes = grow_array(snapshot->sizes, &size_capacity, n + 1, sizeof(uint64_t));
+            snapshot->edge_start = grow_array(snapshot->edge_start, &start_capacity, n + 2, sizeof(size_t));
+            snapshot->ids[n] = a;
+            snapshot->types[n] = (uint16_t)b;
+            snapshot->sizes[n] = c;
+            snapshot->edge_start[n] = edge_total;
+            edge_total += d;
+            snapshot->object_count = n + 1;
+        } else if (tag == 'E') {
+            if (!read_varint(file, &a) || a != snapshot->object_count) return false;
+            snapshot->edge_start = grow_array(snapshot->edge_start, &start_capacity, snapshot->object_count + 1,
+                                              sizeof(size_t));
+            snapshot->edge_start[snapshot->object_count] = edge_total;
+            return true;
+        } else {
+            return false;
+        }
+    }
+}
+
+// 第二遍: 读取引用, 转换为对象下标
+static bool load_edges(KSnapshot* snapshot, FILE* file, const KSnapshotEntry* entries) {
+    size_t edge_total = snapshot->edge_start[snapshot->object_count];
+    snapshot->edges = malloc((edge_total ? edge_total : 1) * sizeof(uint32_t));
+    if (!snapshot->edges) {
+        fprintf(stderr, "Error: malloc failed in load_edges\n");
+        exit(EXIT_FAILURE);
+    }
+
+    size_t index = 0;
+    for (;;) {
+        int tag = getc(file);
+        uint64_t a, b;
+        if (tag == 'T') {
+            if (!read_varint(file, &a) || !read_varint(file, &b) || fseek(file, (long)b, SEEK_CUR) != 0) return false;
+        } else if (tag == 'R') {
+            if (getc(file) == EOF || !read_varint(file, &a)) return false;
+        } else if (tag == 'O') {
+            uint64_t id, count;
+            if (!read_varint(file, &id) || !read_varint(file, &a) || !read_varint(file, &b) ||
+                !read_varint(file, &count)) {
+                return false;
+            }
+            uint64_t prev = id;
+            size_t base = snapshot->edge_start[index];
+            for (uint64_t i = 0; i < count; i++) {
+                uint64_t zigzag;
+                if (!read_varint(file, &zigzag)) return false;
+                int64_t delta = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+                uint64_t target = prev + (uint64_t)delta;
+                snapshot->edges[base + i] = lookup_id(entries, snapshot->object_count, target);
+                prev = target;
+            }
+            index++;
+        } else if (tag == 'E') {
+            return index == snapshot->object_count;
+        } else {
+            return false;
+        }
+    }
+}
+
+bool ksnapshot_load(KSnapshot* snapshot, const char* path) {
+    memset(snapshot, 0, sizeof(*snapshot));
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: cannot open snapshot '%s'\n", path);
+        return false;
+    }
+    setvbuf(file, NULL, _IOFBF, 1 << 20);
+
+    char magic[8];
+    if (fread(magic, 1, 8, file) != 8 || memcmp(magic, KGC_SNAPSHOT_MAGIC, 8) != 0) {
+        fprintf(stderr, "Error: '%s' is not a Korelin heap snapshot\n", path);
+        fclose(file);
+        return false;
+    }
+
+    uint64_t* root_ids = NULL;
+    KSnapshotEntry* entries = NULL;
+    bool ok = load_headers(snapshot, file, &root_ids);
+
+    if (ok) {
+        entries = malloc((snapshot->object_count ? snapshot->object_count : 1) * sizeof(KSnapshotEntry));
+        if (!entries) {
+            fprintf(stderr, "Error: malloc failed in ksnapshot_load\n");
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = 0; i < snapshot->object_count; i++) {
+            entries[i].id = snapshot->ids[i];
+            entries[i].index = (uint32_t)i;
+        }
+        qsort(entries, snapshot->object_count, sizeof(KSnapshotEntry), compare_entries);
+
+        ok = fseek(file, 8, SEEK_SET) == 0 && load_edges(snapshot, file, entries);
+    }
+
+    if (ok) {
+        snapshot->roots = malloc((snapshot->root_count ? snapshot->root_count : 1) * sizeof(uint32_t));
+        if (!snapshot->roots) {
+            fprintf(stderr, "Error: malloc failed in ksnapshot_load\n");
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = 0; i < snapshot->root_count; i++) {
+            snapshot->roots[i] = lookup_id(entries, snapshot->object_count, root_ids[i]);
+        }
+    } else {
+        fprintf(stderr, "Error: snapshot '%s' is truncated or corrupt\n", path);
+        ksnapshot_free(snapshot);
+    }
+
+    free(entries);
+    free(root_ids);
+    fclose(file);
+    return ok;
+}
+
+void ksnapshot_free(KSnapshot* snapshot) {
+    free(snapshot->ids);
+    free(snapshot->types);
+    free(snapshot->sizes);
+    free(snapshot->edge_start);
+    free(snapshot->edges);
+    free(snapshot->roots);
+    free(snapshot->root_kinds);
+    for (size_t i = 0; i < KGC_MAX_TYPES; i++) {
+        free(snapshot->type_names[i]);
+    }
+    memset(snapshot, 0, sizeof(*snapshot));
+}
+
+// =============================================================================
+// 支配树 (Lengauer-Tarjan, 带路径压缩的简单版本)
+//
+// 图中加入一个虚拟根 (下标 object_count), 它引用所有根对象。
+// 为了处理上亿个对象, DFS 与路径压缩都用显式栈实现。
+// =============================================================================
+
+typedef struct KDominatorState {
+    uint32_t* dfn;              // DFS 序号, 未访问为 KSNAPSHOT_NONE
+    uint32_t* vertex;           // DFS 序号 -> 节点
+    uint32_t* parent;           // DFS 树上的父节点
+    uint32_t* semi;             // 半支配者的 DFS 序号
+    uint32_t* ancestor;         // 森林中的祖先
+    uint32_t* label;
+    uint32_t* bucket_head;
+    uint32_t* bucket_next;
+    uint32_t* stack;
+    size_t* pred_start;         // 反向边 (CSR)
+    uint32_t* preds;
+} KDominatorState;
+
+static void* alloc_array(size_t count, size_t element_size) {
+    void* array = malloc((count ? count : 1) * element_size);
+    if (!array) {
+        fprintf(stderr, "Error: malloc failed in alloc_array\n");
+        exit(EXIT_FAILURE);
+    }
+    return array;
+}
+
+// 辅助函数：节点的后继 (虚拟根的后继为所有根对象)
+static const uint32_t* successors(const KSnapshot* snapshot, uint32_t node, size_t* count) {
+    if (node == snapshot->object_count) {
+        *count = snapshot->root_count;
+        return snapshot->roots;
+    }
+    *count = snapshot->edge_start[node + 1] - snapshot->edge_start[node];
+    return snapshot->edges + snapshot->edge_start[node];
+}
+
+// 辅助函数：构建反向边
+static void build_predecessors(const KSnapshot* snapshot, KDominatorState* state) {
+    size_t nodes = snapshot->object_count + 1;
+    state->pred_start = calloc(nodes + 1, sizeof(size_t));
+    if (!state->pred_start) {
+        fprintf(stderr, "Error: calloc failed in build_predecessors\n");
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t u = 0; u < nodes; u++) {
+        size_t count;
+        const uint32_t* succ = successors(snapshot, u, &count);
+        for (size_t i = 0; i < count; i++) {
+            if (succ[i] != KSNAPSHOT_NONE) state->pred_start[succ[i] + 1]++;
+        }
+    }
+    for (size_t i = 0; i < nodes; i++) {
+        state->pred_start[i + 1] += state->pred_start[i];
+    }
+    state->preds = alloc_array(state->pred_start[nodes], sizeof(uint32_t));
+    size_t* fill = alloc_array(nodes, sizeof(size_t));
+    memcpy(fill, state->pred_start, nodes * sizeof(size_t));
+    for (uint32_t u = 0; u < nodes; u++) {
+        size_t count;
+        const uint32_t* succ = successors(snapshot, u, &count);
+        for (size_t i = 0; i < count; i++) {
+            if (succ[i] != KSNAPSHOT_NONE) state->preds[fill[succ[i]]++] = u;
+        }
+    }
+    free(fill);
+}
+
+// 辅助函数：从虚拟根开始的迭代 DFS, 返回访问到的节点数
+static size_t depth_first(const KSnapshot* snapshot, KDominatorState* state) {
+    size_t nodes = snapshot->object_count + 1;
+    size_t* positions = alloc_array(nodes, sizeof(size_t));
+    uint32_t root = (uint32_t)snapshot->object_count;
+    size_t count = 0, depth = 0;
+
+    state->dfn[root] = (uint32_t)count;
+    state->vertex[count++] = root;
+    state->parent[root] = KSNAPSHOT_NONE;
+    state->stack[depth] = root;
+    positions[depth++] = 0;
+
+    while (depth > 0) {
+        uint32_t node = state->stack[depth - 1];
+        size_t succ_count;
+        const uint32_t* succ = successors(snapshot, node, &succ_count);
+        size_t* position = &positions[depth - 1];
+        while (*position < succ_count &&
+               (succ[*position] == KSNAPSHOT_NONE || state->dfn[succ[*position]] != KSNAPSHOT_NONE)) {
+            (*position)++;
+        }
+        if (*position == succ_count) {
+            depth--;
+            continue;
+        }
+        uint32_t next = succ[(*position)++];
+        state->dfn[next] = (uint32_t)count;
+        state->vertex[count++] = next;
+        state->parent[next] = node;
+        state->stack[depth] = next;
+        positions[depth++] = 0;
+    }
+    free(positions);
+    return count;
+}
+
+// 辅助函数：带路径压缩的 eval
+static uint32_t eval_node(KDominatorState* state, uint32_t v) {
+    if (state->ancestor[v] == KSNAPSHOT_NONE) return v;
+
+    // 收集需要压缩的路径, 再从靠近森林根的一端开始压缩
+    size_t depth = 0;
+    uint32_t x = v;
+    while (state->ancestor[state->ancestor[x]] != KSNAPSHOT_NONE) {
+        state->stack[depth++] = x;
+        x = state->ancestor[x];
+    }
+    while (depth > 0) {
+        uint32_t y = state->stack[--depth];
+        uint32_t a = state->ancestor[y];
+        if (state->semi[state->label[a]] < state->semi[state->label[y]]) {
+            state->label[y] = state->label[a];
+        }
+        state->ancestor[y] = state->ancestor[a];
+    }
+    return state->label[v];
+}
+
+// 辅助函数：计算直接支配者, vertex 为 DFS 序, count 为可达节点数
+static void compute_idom(KDominatorState* state, uint32_t* idom, size_t count) {
+    for (size_t i = count; i-- > 1;) {
+        uint32_t w = state->vertex[i];
+        for (size_t j = state->pred_start[w]; j < state->pred_start[w + 1]; j++) {
+            uint32_t v = state->preds[j];
+            if (state->dfn[v] == KSNAPSHOT_NONE) continue;
+            uint32_t u = eval_node(state, v);
+            if (state->semi[u] < state->semi[w]) state->semi[w] = state->semi[u];
+        }
+
+        uint32_t s = state->vertex[state->semi[w]];
+        state->bucket_next[w] = state->bucket_head[s];
+        state->bucket_head[s] = w;
+
+        uint32_t p = state->parent[w];
+        state->ancestor[w] = p;
+        for (uint32_t v = state->bucket_head[p]; v != KSNAPSHOT_NONE; v = state->bucket_next[v]) {
+            uint32_t u = eval_node(state, v);
+            idom[v] = state->semi[u] < state->semi[v] ? u : p;
+        }
+        state->bucket_head[p] = KSNAPSHOT_NONE;
+    }
+
+    for (size_t i = 1; i < count; i++) {
+        uint32_t w = state->vertex[i];
+        if (idom[w] != state->vertex[state->semi[w]]) {
+            idom[w] = idom[idom[w]];
+        }
+    }
+}
+
+// 辅助函数：广度优先搜索, 记录每个可达对象在最短根路径上的前驱
+static void shortest_paths(const KSnapshot* snapshot, uint32_t* path_parent, uint32_t* queue) {
+    size_t nodes = snapshot->object_count + 1;
+    uint32_t root = (uint32_t)snapshot->object_count;
+    for (size_t i = 0; i < nodes; i++) path_parent[i] = KSNAPSHOT_NONE;
+
+    size_t head = 0, tail = 0;
+    queue[tail++] = root;
+    path_parent[root] = root;
+    while (head < tail) {
+        uint32_t node = queue[head++];
+        size_t count;
+        const uint32_t* succ = successors(snapshot, node, &count);
+        for (size_t i = 0; i < count; i++) {
+            uint32_t next = succ[i];
+            if (next == KSNAPSHOT_NONE || path_parent[next] != KSNAPSHOT_NONE) continue;
+            path_parent[next] = node;
+            queue[tail++] = next;
+        }
+    }
+}
+
+void ksnapshot_analyze(const KSnapshot* snapshot, KSnapshotAnalysis* analysis) {
+    size_t nodes = snapshot->object_count + 1;
+    uint32_t root = (uint32_t)snapshot->object_count;
+    KDominatorState state;
+    build_predecessors(snapshot, &state);
+    state.dfn = alloc_array(nodes, sizeof(uint32_t));
+    state.vertex = alloc_array(nodes, sizeof(uint32_t));
+    state.parent = alloc_array(nodes, sizeof(uint32_t));
+    state.semi = alloc_array(nodes, sizeof(uint32_t));
+    state.ancestor = alloc_array(nodes, sizeof(uint32_t));
+    state.label = alloc_array(nodes, sizeof(uint32_t));
+    state.bucket_head = alloc_array(nodes, sizeof(uint32_t));
+    state.bucket_next = alloc_array(nodes, sizeof(uint32_t));
+    state.stack = alloc_array(nodes, sizeof(uint32_t));
+
+    analysis->idom = alloc_array(nodes, sizeof(uint32_t));
+    analysis->retained = alloc_array(nodes, sizeof(uint64_t));
+    analysis->path_parent = alloc_array(nodes, sizeof(uint32_t));
+
+    for (size_t i = 0; i < nodes; i++) {
+        state.dfn[i] = KSNAPSHOT_NONE;
+        state.ancestor[i] = KSNAPSHOT_NONE;
+        state.bucket_head[i] = KSNAPSHOT_NONE;
+        state.label[i] = (uint32_t)i;
+        analysis->idom[i] = KSNAPSHOT_NONE;
+        analysis->retained[i] = i < snapshot->object_count ? snapshot->sizes[i] : 0;
+    }
+
+    size_t count = depth_first(snapshot, &state);
+    for (size_t i = 0; i < count; i++) {
+        state.semi[state.vertex[i]] = (uint32_t)i;
+    }
+    compute_idom(&state, analysis->idom, count);
+    analysis->idom[root] = KSNAPSHOT_NONE;
+
+    // 按 DFS 逆序把保留大小累加到直接支配者 (支配者的 DFS 序号总是更小)
+    for (size_t i = count; i-- > 1;) {
+        uint32_t w = state.vertex[i];
+        analysis->retained[analysis->idom[w]] += analysis->retained[w];
+    }
+    analysis->reachable_count = count - 1;
+    analysis->reachable_bytes = analysis->retained[root];
+
+    shortest_paths(snapshot, analysis->path_parent, state.stack);
+
+    free(state.dfn);
+    free(state.vertex);
+    free(state.parent);
+    free(state.semi);
+    free(state.ancestor);
+    free(state.label);
+    free(state.bucket_head);
+    free(state.bucket_next);
+    free(state.stack);
+    free(state.pred_start);
+    free(state.preds);
+}
+
+void ksnapshot_analysis_free(KSnapshotAnalysis* analysis) {
+    free(analysis->idom);
+    free(analysis->retained);
+    free(analysis->path_parent);
+    memset(analysis, 0, sizeof(*analysis));
+}
+
+// =============================================================================
+// 报告
+// =============================================================================
+
+// 辅助函数：格式化字节数
+static const char* format_bytes(char* buffer, size_t size, uint64_t bytes) {
+    static const char* units[] = {"B", "KB", "MB", "GB", "TB"};
+    double value = (double)bytes;
+    unsigned unit = 0;
+    while (value >= 1024.0 && unit < 4) {
+        value /= 1024.0;
+        unit++;
+    }
+    if (unit == 0) {
+        snprintf(buffer, size, "%llu B", (unsigned long long)bytes);
+    } else {
+        snprintf(buffer, size, "%.1f %s", value, units[unit]);
+    }
+    return buffer;
+}
+
+static const char* type_name(const KSnapshot* snapshot, uint16_t type) {
+    return snapshot->type_names[type] ? snapshot->type_names[type] : "?";
+}
+
+// 辅助函数：输出从根到对象的最短路径 (过长时省略中间部分)
+static void print_path(const KSnapshot* snapshot, const KSnapshotAnalysis* analysis, FILE* out, uint32_t node) {
+    enum { MAX_SHOWN = 12 };
+    uint32_t path[MAX_SHOWN];
+    size_t shown = 0, length = 0;
+    uint32_t root = (uint32_t)snapshot->object_count;
+    for (uint32_t x = node; x != root; x = analysis->path_parent[x]) {
+        if (shown < MAX_SHOWN) path[shown++] = x;
+        length++;
+    }
+
+    fprintf(out, "      path: <root>");
+    if (length > shown) {
+        fprintf(out, " -> ... (%zu more)", length - shown);
+    }
+    for (size_t i = shown; i-- > 0;) {
+        fprintf(out, " -> %s@%llx", type_name(snapshot, snapshot->types[path[i]]),
+                (unsigned long long)snapshot->ids[path[i]] << 4);
+    }
+    fprintf(out, "\n");
+}
+
+void ksnapshot_report(const KSnapshot* snapshot, const KSnapshotAnalysis* analysis, FILE* out, size_t top) {
+    char b1[32], b2[32], b3[32];
+    size_t n = snapshot->object_count;
+    uint64_t total_bytes = 0;
+    for (size_t i = 0; i < n; i++) total_bytes += snapshot->sizes[i];
+
+    fprintf(out, "Objects:     %zu (%s)\n", n, format_bytes(b1, sizeof(b1), total_bytes));
+    fprintf(out, "Reachable:   %zu (%s)\n", analysis->reachable_count,
+            format_bytes(b1, sizeof(b1), analysis->reachable_bytes));
+    fprintf(out, "Unreachable: %zu (%s, garbage not yet swept)\n", n - analysis->reachable_count,
+            format_bytes(b1, sizeof(b1), total_bytes - analysis->reachable_bytes));
+    fprintf(out, "Roots:       %zu\n\n", snapshot->root_count);
+
+    // 按类型汇总; 某类型的保留大小只计入支配链上没有同类型祖先的对象, 避免重复计算
+    uint64_t type_count[KGC_MAX_TYPES] = {0};
+    uint64_t type_self[KGC_MAX_TYPES] = {0};
+    uint64_t type_retained[KGC_MAX_TYPES] = {0};
+    uint64_t* masks = alloc_array(n + 1, sizeof(uint64_t));
+    masks[n] = 0;
+
+    // masks[i] 为对象 i 的所有严格支配者的类型集合, 沿支配链向上求解并记忆
+    for (size_t i = 0; i < n; i++) masks[i] = UINT64_MAX;
+    uint32_t* chain = alloc_array(n + 1, sizeof(uint32_t));
+    for (size_t i = 0; i < n; i++) {
+        if (analysis->idom[i] == KSNAPSHOT_NONE || masks[i] != UINT64_MAX) continue;
+        size_t depth = 0;
+        uint32_t x = (uint32_t)i;
+        while (x != n && masks[x] == UINT64_MAX) {
+            chain[depth++] = x;
+            x = analysis->idom[x];
+        }
+        while (depth > 0) {
+            uint32_t y = chain[--depth];
+            uint32_t d = analysis->idom[y];
+            masks[y] = masks[d] | (d == n ? 0 : (uint64_t)1 << snapshot->types[d]);
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        uint16_t type = snapshot->types[i];
+        type_count[type]++;
+        type_self[type] += snapshot->sizes[i];
+        if (analysis->idom[i] != KSNAPSHOT_NONE && !(masks[i] & ((uint64_t)1 << type))) {
+            type_retained[type] += analysis->retained[i];
+        }
+    }
+    free(chain);
+    free(masks);
+
+    fprintf(out, "%-16s %12s %14s %14s\n", "Type", "Count", "Self", "Retained");
+    for (uint16_t t = 0; t < KGC_MAX_TYPES; t++) {
+        if (!type_count[t]) continue;
+        fprintf(out, "%-16s %12llu %14s %14s\n", type_name(snapshot, t), (unsigned long long)type_count[t],
+                format_bytes(b1, sizeof(b1), type_self[t]), format_bytes(b2, sizeof(b2), type_retained[t]));
+    }
+
+    // 保留大小最大的 top 个对象 (有序插入, top 通常很小)
+    uint32_t* best = alloc_array(top + 1, sizeof(uint32_t));
+    size_t best_count = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (analysis->idom[i] == KSNAPSHOT_NONE) continue;
+        uint64_t retained = analysis->retained[i];
+        if (best_count == top && (top == 0 || retained <= analysis->retained[best[top - 1]])) continue;
+        size_t j = best_count < top ? best_count++ : top - 1;
+        while (j > 0 && analysis->retained[best[j - 1]] < retained) {
+            best[j] = best[j - 1];
+            j--;
+        }
+        best[j] = i;
+    }
+
+    fprintf(out, "\nTop %zu objects by retained size:\n", best_count);
+    for (size_t i = 0; i < best_count; i++) {
+        uint32_t node = best[i];
+        fprintf(out, "  %12s %12s  %s@%llx\n", format_bytes(b1, sizeof(b1), analysis->retained[node]),
+                format_bytes(b3, sizeof(b3), snapshot->sizes[node]), type_name(snapshot, snapshot->types[node]),
+                (unsigned long long)snapshot->ids[node] << 4);
+        print_path(snapshot, analysis, out, node);
+    }
+    free(best);
+}
+
+int ksnapshot_main(int argc, char* argv[]) {
+    if (argc < 1) {
+        fprintf(stderr, "Usage: kric heap <snapshot> [top]\n");
+        return EXIT_FAILURE;
+    }
+    size_t top = 20;
+    if (argc >= 2) {
+        long long value = atoll(argv[1]);
+        top = value > 0 ? (size_t)value : 0;
+    }
+
+    KSnapshot snapshot;
+    if (!ksnapshot_load(&snapshot, argv[0])) {
+        return EXIT_FAILURE;
+    }
+    KSnapshotAnalysis analysis;
+    ksnapshot_analyze(&snapshot, &analysis);
+    ksnapshot_report(&snapshot, &analysis, stdout, top);
+    ksnapshot_analysis_free(&analysis);
+    ksnapshot_free(&snapshot);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#ifndef KORELIN_KSNAPSHOT_H
+#define KORELIN_KSNAPSHOT_H
+
+#include "kgc.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// =============================================================================
+// 堆快照分析器
+//
+// 读取 kgc_write_snapshot 写出的快照 (格式见 kgc.h), 用 Lengauer-Tarjan 算法
+// 计算支配树, 得到每个对象的保留大小 (回收该对象后能一并释放的字节数),
+// 并给出从根到大对象的最短引用路径。
+//
+// 文件被读取两遍: 第一遍只读对象头, 第二遍读入引用并转换为紧凑的下标,
+// 对象图以 CSR 数组存放 (每个对象约 40 字节, 每条边 8 字节)。
+// =============================================================================
+
+#define KSNAPSHOT_NONE UINT32_MAX
+
+typedef struct KSnapshot {
+    size_t object_count;
+    uint64_t* ids;              // 对象 id (文件中的顺序)
+    uint16_t* types;
+    uint64_t* sizes;            // 对象大小 (含外部内存)
+
+    size_t* edge_start;         // CSR: 对象 i 的引用为 edges[edge_start[i] .. edge_start[i+1])
+    uint32_t* edges;            // 目标对象下标, 指向快照中不存在的对象时为 KSNAPSHOT_NONE
+
+    uint32_t* roots;            // 根引用的对象下标
+    uint8_t* root_kinds;        // KGCSnapshotRoot
+    size_t root_count;
+
+    char* type_names[KGC_MAX_TYPES];
+} KSnapshot;
+
+// 支配树分析结果
+typedef struct KSnapshotAnalysis {
+    uint32_t* idom;             // 直接支配者, 根直接引用的对象为 object_count (虚拟根), 不可达为 KSNAPSHOT_NONE
+    uint64_t* retained;         // 保留大小
+    uint32_t* path_parent;      // 最短根路径上的前驱, 根直接引用的对象为 object_count
+    size_t reachable_count;
+    uint64_t reachable_bytes;
+} KSnapshotAnalysis;
+
+// --- 函数声明 ---
+
+/**
+ * @brief 读取快照文件。
+ * @param snapshot 输出的快照。
+ * @param path 快照文件路径。
+ * @return 成功返回 true; 失败时向 stderr 输出原因。
+ */
+bool ksnapshot_load(KSnapshot* snapshot, const char* path);
+
+/**
+ * @brief 释放快照占用的内存。
+ */
+void ksnapshot_free(KSnapshot* snapshot);
+
+/**
+ * @brief 计算支配树、保留大小与最短根路径。
+ * @param snapshot 快照。
+ * @param analysis 输出的分析结果。
+ */
+void ksnapshot_analyze(const KSnapshot* snapshot, KSnapshotAnalysis* analysis);
+
+/**
+ * @brief 释放分析结果。
+ */
+void ksnapshot_analysis_free(KSnapshotAnalysis* analysis);
+
+/**
+ * @brief 输出分析报告: 总体统计、按类型汇总以及保留大小最大的对象。
+ * @param snapshot 快照。
+ * @param analysis 分析结果。
+ * @param out 输出流。
+ * @param top 列出的对象数。
+ */
+void ksnapshot_report(const KSnapshot* snapshot, const KSnapshotAnalysis* analysis, FILE* out, size_t top);
+
+/**
+ * @brief 命令行入口: kric heap <snapshot> [top]。
+ * @return 进程退出码。
+ */
+int ksnapshot_main(int argc, char* argv[]);
+
+#endif //KORELIN_KSNAPSHOT_H
@@ -2,4 +2,391 @@
 // Created by Helix on 2025/12/28.
 //
 
-#include "kstruct.h"
\ No newline at end of file
+#include "kstruct.h"
+#include <stdlib.h>
+#include <string.h>
+
+_Static_assert(offsetof(KStruct, data) % 8 == 0, "KStruct data must be 8-byte aligned");
+
+// 辅助函数：复制字符串
+static char* copy_name(const char* name) {
+    size_t length = strlen(name);
+    char* copy = malloc(length + 1);
+    if (!copy) {
+        fprintf(stderr, "Error: malloc failed in copy_name\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(copy, name, length + 1);
+    return copy;
+}
+
+// 辅助函数：向上对齐
+static uint32_t align_up(uint32_t value, uint32_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+// =============================================================================
+// 类型与布局
+// =============================================================================
+
+KStructType* kstruct_type_new(const char* name) {
+    KStructType* type = calloc(1, sizeof(KStructType));
+    if (!type) {
+        fprintf(stderr, "Error: calloc failed in kstruct_type_new\n");
+        exit(EXIT_FAILURE);
+    }
+    type->name = copy_name(name);
+    type->align = 1;
+    return type;
+}
+
+bool kstruct_type_add_field(KStructType* type, const char* name, KFieldKind kind, const KStructType* struct_type) {
+    for (size_t i = 0; i < type->field_count; i++) {
+        if (strcmp(type->fields[i].name, name) == 0) return false;
+    }
+
+    uint32_t size;
+    uint32_t align;
+    switch (kind) {
+        case KFIELD_BOOL: size = align = 1; break;
+        case KFIELD_INT: size = align = 4; break;
+        case KFIELD_STRUCT: size = struct_type->size; align = struct_type->align; break;
+        default: size = align = 8; break;    // long / double / string 引用
+    }
+
+    KStructField* new_fields = realloc(type->fields, (type->field_count + 1) * sizeof(KStructField));
+    if (!new_fields) {
+        fprintf(stderr, "Error: realloc failed in kstruct_type_add_field\n");
+        exit(EXIT_FAILURE);
+    }
+    type->fields = new_fields;
+    KStructField* field = &type->fields[type->field_count++];
+    field->name = copy_name(name);
+    field->kind = kind;
+    field->struct_type = kind == KFIELD_STRUCT ? struct_type : NULL;
+    field->offset = align_up(type->size, align);
+    field->size = size;
+    type->size = field->offset + size;
+    if (align > type->align) type->align = align;
+    return true;
+}
+
+// 辅助函数：追加一个引用偏移
+static void add_ref_offset(KStructType* type, uint32_t offset) {
+    uint32_t* new_offsets = realloc(type->ref_offsets, (type->ref_count + 1) * sizeof(uint32_t));
+    if (!new_offsets) {
+        fprintf(stderr, "Error: realloc failed in add_ref_offset\n");
+        exit(EXIT_FAILURE);
+    }
+    type->ref_offsets = new_offsets;
+    type->ref_offsets[type->ref_count++] = offset;
+}
+
+void kstruct_type_finish(KStructType* type) {
+    type->size = align_up(type->size, type->align);
+    for (size_t i = 0; i < type->field_count; i++) {
+        const KStructField* field = &type->fields[i];
+        if (field->kind == KFIELD_STRING) {
+            add_ref_offset(type, field->offset);
+        } else if (field->kind == KFIELD_STRUCT) {
+            for (size_t j = 0; j < field->struct_type->ref_count; j++) {
+                add_ref_offset(type, field->offset + field->struct_type->ref_offsets[j]);
+            }
+        }
+    }
+}
+
+void kstruct_type_free(KStructType* type) {
+    if (!type) return;
+    for (size_t i = 0; i < type->field_count; i++) {
+        free(type->fields[i].name);
+    }
+    free(type->fields);
+    free(type->ref_offsets);
+    free(type->name);
+    free(type);
+}
+
+const KStructField* kstruct_resolve_path(const KStructType* type, const char* path, uint32_t* offset) {
+    const KStructField* field = NULL;
+    uint32_t total = 0;
+    const char* segment = path;
+    while (true) {
+        if (!type) return NULL;     // 对非结构体字段继续访问成员
+        const char* end = strchr(segment, '.');
+        size_t length = end ? (size_t)(end - segment) : strlen(segment);
+
+        field = NULL;
+        for (size_t i = 0; i < type->field_count; i++) {
+            if (strncmp(type->fields[i].name, segment, length) == 0 && type->fields[i].name[length] == '\0') {
+                field = &type->fields[i];
+                break;
+            }
+        }
+        if (!field) return NULL;
+        total += field->offset;
+        if (!end) break;
+        type = field->struct_type;
+        segment = end + 1;
+    }
+    *offset = total;
+    return field;
+}
+
+// =============================================================================
+// 字段读写
+// =============================================================================
+
+KValue kstruct_load(KGCHeap* heap, const KStructField* field, const unsigned char* data) {
+    switch (field->kind) {
+        case KFIELD_BOOL:
+            return KVALUE_BOOL(*data != 0);
+        case KFIELD_INT: {
+            int32_t value;
+            memcpy(&value, data, sizeof(value));
+            return KVALUE_INT(value);
+        }
+        case KFIELD_LONG: {
+            int64_t value;
+            memcpy(&value, data, sizeof(value));
+            return KVALUE_INT(value);
+        }
+        case KFIELD_DOUBLE: {
+            double value;
+            memcpy(&value, data, sizeof(value));
+            return KVALUE_DOUBLE(value);
+        }
+        case KFIELD_STRING: {
+            KGCObject* str;
+            memcpy(&str, data, sizeof(str));
+            return str ? KVALUE_OBJECT(str) : KVALUE_NULL;
+        }
+        case KFIELD_STRUCT: {
+            // data 指向的对象在分配期间不会被移动 (整理只在安全点进行)
+            KStruct* copy = kstruct_new(heap, field->struct_type);
+            memcpy(copy->data, data, field->size);
+            return KVALUE_OBJECT(copy);
+        }
+    }
+    return KVALUE_NULL;
+}
+
+bool kstruct_store(KGCHeap* heap, KGCObject* owner, const KStructField* field, unsigned char* data, KValue value) {
+    switch (field->kind) {
+        case KFIELD_BOOL:
+            if (value.type != KVAL_BOOL) return false;
+            *data = value.as.boolean ? 1 : 0;
+            return true;
+        case KFIELD_INT: {
+            if (value.type != KVAL_INT) return false;
+            int32_t v = (int32_t)(uint32_t)value.as.integer;   // 与 C 一样截断到 32 位
+            memcpy(data, &v, sizeof(v));
+            return true;
+        }
+        case KFIELD_LONG: {
+            if (value.type != KVAL_INT) return false;
+            int64_t v = value.as.integer;
+            memcpy(data, &v, sizeof(v));
+            return true;
+        }
+        case KFIELD_DOUBLE: {
+            double v;
+            if (value.type == KVAL_DOUBLE) v = value.as.number;
+            else if (value.type == KVAL_INT) v = (double)value.as.integer;
+            else return false;
+            memcpy(data, &v, sizeof(v));
+            return true;
+        }
+        case KFIELD_STRING: {
+            KGCObject* str = NULL;
+            if (kvalue_is_object_type(value, KOBJ_STRING)) str = value.as.object;
+            else if (value.type != KVAL_NULL) return false;
+            memcpy(data, &str, sizeof(str));
+            kgc_write_barrier(heap, owner, str);
+            return true;
+        }
+        case KFIELD_STRUCT: {
+            if (!kvalue_is_object_type(value, KOBJ_STRUCT)) return false;
+            const KStruct* src = (const KStruct*)value.as.object;
+            if (src->type != field->struct_type) return false;
+            kstruct_assign(heap, owner, src->type, data, src->data);
+            return true;
+        }
+    }
+    return false;
+}
+
+void kstruct_assign(KGCHeap* heap, KGCObject* owner, const KStructType* type, unsigned char* dst,
+                    const unsigned char* src) {
+    memmove(dst, src, type->size);
+    for (size_t i = 0; i < type->ref_count; i++) {
+        KGCObject* ref;
+        memcpy(&ref, dst + type->ref_offsets[i], sizeof(ref));
+        kgc_write_barrier(heap, owner, ref);
+    }
+}
+
+bool kstruct_equals(const KStructType* type, const unsigned char* a, const unsigned char* b) {
+    for (size_t i = 0; i < type->field_count; i++) {
+        const KStructField* field = &type->fields[i];
+        const unsigned char* fa = a + field->offset;
+        const unsigned char* fb = b + field->offset;
+        switch (field->kind) {
+            case KFIELD_DOUBLE: {
+                double x, y;
+                memcpy(&x, fa, sizeof(x));
+                memcpy(&y, fb, sizeof(y));
+                if (x != y) return false;
+                break;
+            }
+            case KFIELD_STRING: {
+                const KString* x;
+                const KString* y;
+                memcpy(&x, fa, sizeof(x));
+                memcpy(&y, fb, sizeof(y));
+                if (x == y) break;
+                if (!x || !y || x->length != y->length || memcmp(x->chars, y->chars, x->length) != 0) return false;
+                break;
+            }
+            case KFIELD_STRUCT:
+                if (!kstruct_equals(field->struct_type, fa, fb)) return false;
+                break;
+            default:
+                if (memcmp(fa, fb, field->size) != 0) return false;
+                break;
+        }
+    }
+    return true;
+}
+
+void kstruct_print(FILE* out, const KStructType* type, const unsigned char* data) {
+    fprintf(out, "%s{", type->name);
+    for (size_t i = 0; i < type->field_count; i++) {
+        const KStructField* field = &type->fields[i];
+        fprintf(out, "%s%s: ", i ? ", " : "", field->name);
+        if (field->kind == KFIELD_STRUCT) {
+            kstruct_print(out, field->struct_type, data + field->offset);
+        } else {
+            // 标量字段的读取不会分配对象
+            kvalue_print(out, kstruct_load(NULL, field, data + field->offset));
+        }
+    }
+    fputc('}', out);
+}
+
+// =============================================================================
+// 结构体对象
+// =============================================================================
+
+static void struct_trace(KGCTracer* tracer, KGCObject* obj) {
+    KStruct* value = (KStruct*)obj;
+    for (size_t i = 0; i < value->type->ref_count; i++) {
+        kgc_visit_object(tracer, (KGCObject**)(void*)(value->data + value->type->ref_offsets[i]));
+    }
+}
+
+KStruct* kstruct_new(KGCHeap* heap, const KStructType* type) {
+    KStruct* value = (KStruct*)kgc_alloc(heap, KOBJ_STRUCT, sizeof(KStruct) + type->size);
+    value->type = type;
+    memset(value->data, 0, type->size);
+    return value;
+}
+
+KStruct* kstruct_copy(KGCHeap* heap, const KStruct* src) {
+    KStruct* copy = kstruct_new(heap, src->type);
+    memcpy(copy->data, src->data, src->type->size);
+    return copy;
+}
+
+// =============================================================================
+// 结构体数组
+// =============================================================================
+
+static void struct_array_trace(KGCTracer* tracer, KGCObject* obj) {
+    KStructArray* array = (KStructArray*)obj;
+    const KStructType* type = array->type;
+    if (type->ref_count == 0) return;
+    for (size_t i = 0; i < array->count; i++) {
+        unsigned char* element = kstruct_array_at(array, i);
+        for (size_t j = 0; j < type->ref_count; j++) {
+            kgc_visit_object(tracer, (KGCObject**)(void*)(element + type->ref_offsets[j]));
+        }
+    }
+}
+
+static void struct_array_finalize(KGCHeap* heap, KGCObject* obj) {
+    KStructArray* array = (KStructArray*)obj;
+    kgc_account_external(heap, -(ptrdiff_t)(array->capacity * array->type->size));
+    free(array->data);
+}
+
+static size_t struct_array_external_size(const KGCObject* obj) {
+    const KStructArray* array = (const KStructArray*)obj;
+    return array->capacity * array->type->size;
+}
+
+// 辅助函数：确保结构体数组至少能容纳 capacity 个元素, 新增部分清零
+static void struct_array_reserve(KGCHeap* heap, KStructArray* array, size_t capacity) {
+    if (capacity <= array->capacity) return;
+    size_t new_capacity = array->capacity ? array->capacity : 8;
+    while (new_capacity < capacity) new_capacity *= 2;
+
+    size_t size = array->type->size;
+    unsigned char* new_data = realloc(array->data, new_capacity * size + 1);
+    if (!new_data) {
+        fprintf(stderr, "Error: realloc failed in struct_array_reserve\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(new_data + array->capacity * size, 0, (new_capacity - array->capacity) * size);
+    kgc_account_external(heap, (ptrdiff_t)((new_capacity - array->capacity) * size));
+    array->data = new_data;
+    array->capacity = new_capacity;
+}
+
+KStructArray* kstruct_array_new(KGCHeap* heap, const KStructType* type, size_t count) {
+    KStructArray* array = (KStructArray*)kgc_alloc(heap, KOBJ_STRUCT_ARRAY, sizeof(KStructArray));
+    array->type = type;
+    array->count = 0;
+    array->capacity = 0;
+    array->data = NULL;
+    if (count > 0) {
+        // 直接按需分配: 大数组不做 2 的幂取整, 1M 个 16 字节的元素恰好占 16 MB
+        array->data = calloc(count * type->size + 1, 1);
+        if (!array->data) {
+            fprintf(stderr, "Error: calloc failed in kstruct_array_new\n");
+            exit(EXIT_FAILURE);
+        }
+        array->capacity = count;
+        kgc_account_external(heap, (ptrdiff_t)(count * type->size));
+    }
+    array->count = count;
+    return array;
+}
+
+bool kstruct_array_push(KGCHeap* heap, KStructArray* array, KValue value) {
+    if (!kvalue_is_object_type(value, KOBJ_STRUCT) || ((KStruct*)value.as.object)->type != array->type) {
+        return false;
+    }
+    struct_array_reserve(heap, array, array->count + 1);
+    kstruct_assign(heap, &array->obj, array->type, kstruct_array_at(array, array->count),
+                   ((KStruct*)value.as.object)->data);
+    array->count++;
+    return true;
+}
+
+// =============================================================================
+// 类型注册
+// =============================================================================
+
+static const KGCTypeInfo struct_type = {.name = "struct", .trace = struct_trace, .finalize = NULL};
+static const KGCTypeInfo struct_array_type = {
+    .name = "struct_array",
+    .trace = struct_array_trace,
+    .finalize = struct_array_finalize,
+    .external_size = struct_array_external_size,
+};
+
+void kstruct_init_types(void) {
+    kgc_register_type(KOBJ_STRUCT, &struct_type);
+    kgc_register_type(KOBJ_STRUCT_ARRAY, &struct_array_type);
+}
@@ -5,4 +5,221 @@
 #ifndef KORELIN_KSTRUCT_H
 #define KORELIN_KSTRUCT_H
 
-#endif //KORELIN_KSTRUCT_H
\ No newline at end of file
+#include "kobject.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// =============================================================================
+// 值类型结构体
+//
+// struct 声明在编译期确定字段布局: 字段按声明顺序排列, 按 C 的自然对齐规则
+// 插入填充 (bool 1 字节, int 4 字节, long/double/string 8 字节), 嵌套的结构体
+// 字段直接内联在外层结构体中。结构体是值: 赋值、传参和返回时复制整个数据块。
+//
+// 单独的结构体值装在 KStruct 中; Point[n] 创建的 KStructArray 把所有元素连续
+// 存放在一块外部缓冲区里 (n * size 字节), 元素本身不是堆对象。字段访问按
+// 固定偏移读写, VM 用内联缓存记住 (类型 -> 偏移) 的解析结果。
+// =============================================================================
+
+// 字段类型
+typedef enum {
+    KFIELD_BOOL,        // bool: 1 字节
+    KFIELD_INT,         // int: 32 位有符号整数
+    KFIELD_LONG,        // long: 64 位有符号整数
+    KFIELD_DOUBLE,      // double
+    KFIELD_STRING,      // string: KString 引用, 可以为 null
+    KFIELD_STRUCT,      // 内联的结构体
+} KFieldKind;
+
+typedef struct KStructType KStructType;
+
+// 字段描述
+typedef struct KStructField {
+    char* name;
+    KFieldKind kind;
+    const KStructType* struct_type; // KFIELD_STRUCT 时为字段的结构体类型
+    uint32_t offset;                // 相对结构体起始位置的字节偏移
+    uint32_t size;
+} KStructField;
+
+// 结构体类型 (编译期创建, 只读, 可以被多个虚拟机共享)
+struct KStructType {
+    char* name;
+    KStructField* fields;
+    size_t field_count;
+    uint32_t size;          // 含尾部填充, 即数组中相邻元素的步长
+    uint32_t align;
+    uint32_t* ref_offsets;  // 所有字符串引用 (含嵌套结构体中的) 的偏移, 供 GC 追踪
+    size_t ref_count;
+};
+
+// 单独的结构体值
+typedef struct KStruct {
+    KGCObject obj;
+    const KStructType* type;
+    unsigned char data[];   // type->size 字节, 8 字节对齐
+} KStruct;
+
+// 结构体数组: 元素连续存放在 data 中
+typedef struct KStructArray {
+    KGCObject obj;
+    const KStructType* type;
+    size_t count;
+    size_t capacity;
+    unsigned char* data;    // capacity * type->size 字节
+} KStructArray;
+
+// 字段访问的内联缓存: 记录上一次访问的结构体类型及解析出的字段与偏移
+typedef struct KFieldCache {
+    const KStructType* type;
+    const KStructField* field;
+    uint32_t offset;
+} KFieldCache;
+
+// --- 函数声明 ---
+
+/**
+ * @brief 向回收器注册结构体相关的对象类型。
+ */
+void kstruct_init_types(void);
+
+/**
+ * @brief 创建一个没有字段的结构体类型。
+ * @param name 类型名。
+ * @return 新的类型, 添加完字段后调用 kstruct_type_finish。
+ */
+KStructType* kstruct_type_new(const char* name);
+
+/**
+ * @brief 在结构体末尾追加一个字段。
+ * @param type 结构体类型。
+ * @param name 字段名。
+ * @param kind 字段类型。
+ * @param struct_type kind 为 KFIELD_STRUCT 时的内联结构体类型 (必须已完成布局)。
+ * @return 字段名重复时返回 false。
+ */
+bool kstruct_type_add_field(KStructType* type, const char* name, KFieldKind kind, const KStructType* struct_type);
+
+/**
+ * @brief 完成布局: 填充尾部对齐并收集引用偏移。
+ * @param type 结构体类型。
+ */
+void kstruct_type_finish(KStructType* type);
+
+/**
+ * @brief 释放结构体类型。
+ */
+void kstruct_type_free(KStructType* type);
+
+/**
+ * @brief 解析以 '.' 分隔的字段路径 (如 "a.b.x"), 得到最终字段及其相对偏移。
+ * @param type 结构体类型。
+ * @param path 字段路径。
+ * @param offset 输出的字节偏移。
+ * @return 最终字段, 路径无效时返回 NULL。
+ */
+const KStructField* kstruct_resolve_path(const KStructType* type, const char* path, uint32_t* offset);
+
+/**
+ * @brief 通过内联缓存查找字段路径, 缓存未命中时解析并更新缓存。
+ */
+static inline const KStructField* kstruct_lookup(KFieldCache* cache, const KStructType* type, const char* path,
+                                                 uint32_t* offset) {
+    if (cache->type == type) {
+        *offset = cache->offset;
+        return cache->field;
+    }
+    const KStructField* field = kstruct_resolve_path(type, path, offset);
+    if (field) {
+        cache->type = type;
+        cache->field = field;
+        cache->offset = *offset;
+    }
+    return field;
+}
+
+/**
+ * @brief 读取字段的值。结构体字段会被复制到新的 KStruct 中。
+ * @param heap 堆。
+ * @param field 字段。
+ * @param data 字段所在的地址。
+ * @return 字段的值。
+ */
+KValue kstruct_load(KGCHeap* heap, const KStructField* field, const unsigned char* data);
+
+/**
+ * @brief 写入字段的值 (int/double 之间按字段类型转换)。
+ * @param heap 堆。
+ * @param owner 持有 data 的对象, 用于写屏障。
+ * @param field 字段。
+ * @param data 字段所在的地址。
+ * @param value 新的值。
+ * @return 值的类型与字段不匹配时返回 false。
+ */
+bool kstruct_store(KGCHeap* heap, KGCObject* owner, const KStructField* field, unsigned char* data, KValue value);
+
+/**
+ * @brief 创建一个所有字段为零值的结构体。
+ * @param heap 堆。
+ * @param type 结构体类型。
+ * @return 新的结构体。
+ */
+KStruct* kstruct_new(KGCHeap* heap, const KStructType* type);
+
+/**
+ * @brief 复制一个结构体值。
+ * @param heap 堆。
+ * @param src 要复制的结构体。
+ * @return 新的结构体。
+ */
+KStruct* kstruct_copy(KGCHeap* heap, const KStruct* src);
+
+/**
+ * @brief 把整个结构体值写入 dst (dst 属于 owner), 并对其中的引用执行写屏障。
+ * @param heap 堆。
+ * @param owner 持有 dst 的对象。
+ * @param type 结构体类型。
+ * @param dst 目标地址。
+ * @param src 源数据。
+ */
+void kstruct_assign(KGCHeap* heap, KGCObject* owner, const KStructType* type, unsigned char* dst,
+                    const unsigned char* src);
+
+/**
+ * @brief 比较两个同类型结构体值的所有字段。
+ */
+bool kstruct_equals(const KStructType* type, const unsigned char* a, const unsigned char* b);
+
+/**
+ * @brief 以 Point{x: 1, y: 2} 的格式输出结构体值。
+ */
+void kstruct_print(FILE* out, const KStructType* type, const unsigned char* data);
+
+/**
+ * @brief 创建一个包含 count 个零值元素的结构体数组。
+ * @param heap 堆。
+ * @param type 元素类型。
+ * @param count 元素个数。
+ * @return 新的结构体数组。
+ */
+KStructArray* kstruct_array_new(KGCHeap* heap, const KStructType* type, size_t count);
+
+/**
+ * @brief 返回第 index 个元素的地址, index 必须小于 array->count。
+ */
+static inline unsigned char* kstruct_array_at(const KStructArray* array, size_t index) {
+    return array->data + index * array->type->size;
+}
+
+/**
+ * @brief 在结构体数组末尾追加一个元素。
+ * @param heap 堆。
+ * @param array 结构体数组。
+ * @param value 同类型的结构体值。
+ * @return 类型不匹配时返回 false。
+ */
+bool kstruct_array_push(KGCHeap* heap, KStructArray* array, KValue value);
+
+#endif //KORELIN_KSTRUCT_H
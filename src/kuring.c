@@ -0,0 +1,244 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#define _GNU_SOURCE
+
+#include "kuring.h"
+#include <errno.h>
+#include <linux/time_types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define KURING_PROBE_OPS 256
+
+static int sys_setup(unsigned entries, struct io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_enter(int fd, unsigned submit, unsigned wait, unsigned flags, const void* arg, size_t size) {
+    return (int)syscall(__NR_io_uring_enter, fd, submit, wait, flags, arg, size);
+}
+
+// 辅助函数：依次尝试更少的 setup 标志, 兼容较旧的内核
+static int setup_ring(unsigned entries, struct io_uring_params* params) {
+    static const unsigned attempts[] = {
+        // 只由一个线程提交, 完成处理推迟到 io_uring_enter 中进行, 避免打断运行中的脚本
+        IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_SUBMIT_ALL,
+        IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SUBMIT_ALL,
+        0,
+    };
+    for (size_t i = 0; i < sizeof(attempts) / sizeof(attempts[0]); i++) {
+        memset(params, 0, sizeof(*params));
+        params->flags = attempts[i];
+        int fd = sys_setup(entries, params);
+        if (fd >= 0) return fd;
+        if (errno != EINVAL) return -1;
+    }
+    return -1;
+}
+
+bool kuring_init(KURing* ring, unsigned entries) {
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+    struct io_uring_params params;
+    int fd = setup_ring(entries, &params);
+    if (fd < 0) return false;
+    if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP) ||
+        !(params.features & IORING_FEAT_SINGLE_MMAP)) {
+        close(fd);
+        return false;
+    }
+    ring->fd = fd;
+    ring->features = params.features;
+
+    // IORING_FEAT_SINGLE_MMAP: 提交环与完成环共用一次映射
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    size_t size = sq_size > cq_size ? sq_size : cq_size;
+    void* rings = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (rings == MAP_FAILED) {
+        close(fd);
+        ring->fd = -1;
+        return false;
+    }
+    ring->rings = rings;
+    ring->rings_size = size;
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        munmap(rings, size);
+        close(fd);
+        ring->fd = -1;
+        return false;
+    }
+
+    char* sq = rings;
+    ring->sq_head = (unsigned*)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sq_mask = *(unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+    ring->sq_local_tail = *ring->sq_tail;
+    char* cq = rings;
+    ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cq_mask = *(unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    // 提交队列项与 sq_array 一一对应, 之后不再改动 sq_array
+    for (unsigned i = 0; i <= ring->sq_mask; i++) ring->sq_array[i] = i;
+    return true;
+}
+
+void kuring_free(KURing* ring) {
+    if (ring->fd < 0) return;
+    munmap(ring->sqes, ring->sqes_size);
+    munmap(ring->rings, ring->rings_size);
+    close(ring->fd);
+    ring->fd = -1;
+}
+
+bool kuring_supports(KURing* ring, unsigned opcode) {
+    size_t size = sizeof(struct io_uring_probe) + KURING_PROBE_OPS * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe* probe = calloc(1, size);
+    if (!probe) {
+        fprintf(stderr, "Error: calloc failed in kuring_supports\n");
+        exit(EXIT_FAILURE);
+    }
+    bool supported = kuring_register(ring, IORING_REGISTER_PROBE, probe, KURING_PROBE_OPS) >= 0 &&
+                     opcode <= probe->last_op && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+    return supported;
+}
+
+// 辅助函数：把已填写的项发布给内核
+static void publish(KURing* ring) {
+    __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+}
+
+struct io_uring_sqe* kuring_get_sqe(KURing* ring) {
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->sq_local_tail - head > ring->sq_mask) {
+        // 队列已满: 只提交, 不等待
+        kuring_enter(ring, 0, 0);
+        head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        if (ring->sq_local_tail - head > ring->sq_mask) {
+            fprintf(stderr, "Error: io_uring submission queue is stuck in kuring_get_sqe\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    struct io_uring_sqe* sqe = &ring->sqes[ring->sq_local_tail & ring->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_local_tail++;
+    ring->pending++;
+    return sqe;
+}
+
+bool kuring_enter(KURing* ring, unsigned wait, long long timeout_ms) {
+    publish(ring);
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    // 即使 wait 为 0 也带上 GETEVENTS: 推迟的完成处理 (DEFER_TASKRUN) 只在这时运行
+    unsigned flags = IORING_ENTER_EXT_ARG | IORING_ENTER_GETEVENTS;
+    if (wait > 0 && timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (timeout_ms % 1000) * 1000000;
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+    }
+    for (;;) {
+        ring->enters++;
+        int n = sys_enter(ring->fd, ring->pending, wait, flags, &arg, sizeof(arg));
+        if (n >= 0) {
+            ring->pending -= (unsigned)n < ring->pending ? (unsigned)n : ring->pending;
+            return true;
+        }
+        if (errno == EINTR) continue;
+        // 超时或完成队列暂时溢出都不是错误
+        if (errno == ETIME || errno == EBUSY) return true;
+        return false;
+    }
+}
+
+struct io_uring_cqe* kuring_peek(KURing* ring) {
+    unsigned head = *ring->cq_head;
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) return NULL;
+    return &ring->cqes[head & ring->cq_mask];
+}
+
+void kuring_advance(KURing* ring) {
+    __atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+int kuring_register(KURing* ring, unsigned opcode, const void* arg, unsigned count) {
+    return (int)syscall(__NR_io_uring_register, ring->fd, opcode, arg, count);
+}
+
+// =============================================================================
+// 提供缓冲环
+// =============================================================================
+
+bool kuring_buffers_init(KURing* ring, KURingBuffers* buffers, uint16_t group, unsigned count, unsigned size) {
+    memset(buffers, 0, sizeof(*buffers));
+    buffers->ring_size = count * sizeof(struct io_uring_buf);
+    void* memory = mmap(NULL, buffers->ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return false;
+    buffers->ring = memory;
+    buffers->data = malloc((size_t)count * size);
+    if (!buffers->data) {
+        fprintf(stderr, "Error: malloc failed in kuring_buffers_init\n");
+        exit(EXIT_FAILURE);
+    }
+    buffers->count = count;
+    buffers->size = size;
+    buffers->group = group;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)memory;
+    reg.ring_entries = count;
+    reg.bgid = group;
+    if (kuring_register(ring, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        munmap(memory, buffers->ring_size);
+        free(buffers->data);
+        memset(buffers, 0, sizeof(*buffers));
+        return false;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        struct io_uring_buf* buf = &buffers->ring->bufs[i];
+        buf->addr = (uint64_t)(uintptr_t)(buffers->data + (size_t)i * size);
+        buf->len = size;
+        buf->bid = (uint16_t)i;
+    }
+    __atomic_store_n(&buffers->ring->tail, (uint16_t)count, __ATOMIC_RELEASE);
+    return true;
+}
+
+void kuring_buffers_free(KURing* ring, KURingBuffers* buffers) {
+    if (!buffers->ring) return;
+    if (ring->fd >= 0) {
+        struct io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof(reg));
+        reg.bgid = buffers->group;
+        kuring_register(ring, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    }
+    munmap(buffers->ring, buffers->ring_size);
+    free(buffers->data);
+    memset(buffers, 0, sizeof(*buffers));
+}
+
+char* kuring_buffer(const KURingBuffers* buffers, unsigned id) {
+    return buffers->data + (size_t)id * buffers->size;
+}
+
+void kuring_buffer_recycle(KURingBuffers* buffers, unsigned id) {
+    uint16_t tail = buffers->ring->tail;
+    struct io_uring_buf* buf = &buffers->ring->bufs[tail & (buffers->count - 1)];
+    buf->addr = (uint64_t)(uintptr_t)kuring_buffer(buffers, id);
+    buf->len = buffers->size;
+    buf->bid = (uint16_t)id;
+    __atomic_store_n(&buffers->ring->tail, (uint16_t)(tail + 1), __ATOMIC_RELEASE);
+}
@@ -0,0 +1,124 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#ifndef KORELIN_KURING_H
+#define KORELIN_KURING_H
+
+#include <linux/io_uring.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// =============================================================================
+// io_uring 的最小封装 (不依赖 liburing)
+//
+// 提交队列项在调用者填写后留在队列中, 由 kuring_enter 一次提交并等待完成, 队列满时
+// kuring_get_sqe 先提交已有的项。完成队列项由 kuring_peek / kuring_advance 逐个取出。
+// 提供缓冲环 (provided buffer ring) 是注册到内核的一组等长缓冲, 多发 (multishot) 的
+// recv 每次完成时从中取一块, 处理完后由 kuring_buffer_recycle 归还。
+//
+// 内核不支持 io_uring (旧内核、seccomp 或 io_uring_disabled) 时 kuring_init 返回 false,
+// 调用者应退回到 epoll。
+// =============================================================================
+
+typedef struct KURing {
+    int fd;
+    unsigned features;
+    // 提交队列
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned sq_mask;
+    unsigned* sq_array;
+    struct io_uring_sqe* sqes;
+    unsigned sq_local_tail;     // 已填写但尚未发布给内核的项之后的位置
+    unsigned pending;           // 尚未提交的项数
+    // 完成队列
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe* cqes;
+    // 映射 (提交环与完成环共用)
+    void* rings;
+    size_t rings_size;
+    size_t sqes_size;
+    uint64_t enters;            // io_uring_enter 的调用次数
+} KURing;
+
+// 提供缓冲环
+typedef struct KURingBuffers {
+    struct io_uring_buf_ring* ring;
+    char* data;                 // count 块, 每块 size 字节
+    size_t ring_size;
+    unsigned count;
+    unsigned size;
+    uint16_t group;
+} KURingBuffers;
+
+// --- 函数声明 ---
+
+/**
+ * @brief 创建 io_uring 实例。
+ * @param entries 提交队列的项数 (会被内核取整为 2 的幂)。
+ * @return 内核不支持或缺少所需特性 (IORING_FEAT_EXT_ARG、IORING_FEAT_NODROP) 时返回 false。
+ */
+bool kuring_init(KURing* ring, unsigned entries);
+
+/**
+ * @brief 关闭实例并解除映射; 内核中未完成的请求随之取消。
+ */
+void kuring_free(KURing* ring);
+
+/**
+ * @brief 内核是否支持某个操作 (IORING_REGISTER_PROBE)。
+ */
+bool kuring_supports(KURing* ring, unsigned opcode);
+
+/**
+ * @brief 取得一个清零的提交队列项; 队列已满时先提交已有的项。
+ */
+struct io_uring_sqe* kuring_get_sqe(KURing* ring);
+
+/**
+ * @brief 提交所有待提交的项, 并等待至少 wait 个完成项或超时。
+ * @param timeout_ms 等待的毫秒数, 小于 0 表示不限时。
+ * @return 成功或超时时返回 true; 出错 (EINTR 除外) 时返回 false 并设置 errno。
+ */
+bool kuring_enter(KURing* ring, unsigned wait, long long timeout_ms);
+
+/**
+ * @brief 取下一个完成项, 没有时返回 NULL; 处理完后调用 kuring_advance。
+ */
+struct io_uring_cqe* kuring_peek(KURing* ring);
+
+void kuring_advance(KURing* ring);
+
+/**
+ * @brief 调用 io_uring_register。
+ * @return 系统调用的返回值, 出错时为 -1 并设置 errno。
+ */
+int kuring_register(KURing* ring, unsigned opcode, const void* arg, unsigned count);
+
+/**
+ * @brief 分配并注册提供缓冲环, 所有缓冲初始时都可用。
+ * @param count 缓冲的数目, 必须是 2 的幂且不超过 32768。
+ * @return 内核不支持时返回 false。
+ */
+bool kuring_buffers_init(KURing* ring, KURingBuffers* buffers, uint16_t group, unsigned count, unsigned size);
+
+/**
+ * @brief 注销并释放提供缓冲环。
+ */
+void kuring_buffers_free(KURing* ring, KURingBuffers* buffers);
+
+/**
+ * @brief 取得完成项选中的缓冲 (cqe->flags 的高 16 位是缓冲编号)。
+ */
+char* kuring_buffer(const KURingBuffers* buffers, unsigned id);
+
+/**
+ * @brief 把缓冲归还给内核。
+ */
+void kuring_buffer_recycle(KURingBuffers* buffers, unsigned id);
+
+#endif //KORELIN_KURING_H
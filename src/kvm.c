@@ -3,7 +3,1554 @@
 //
 
 #include "kvm.h"
+#include "kbigint.h"
+#include "krilib.h"
+#include "kstruct.h"
+#include "libs/kmap.h"
+#include "libs/knet.h"
+#include "libs/kpersist.h"
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// =============================================================================
+// 函数对象
+// =============================================================================
+
+// 共享常量表中只有共享对象, 不需要追踪
+static void function_trace(KGCTracer* tracer, KGCObject* obj) {
+    KFunction* fn = (KFunction*)obj;
+    if (!fn->functions) return;
+    for (size_t i = 0; i < fn->proto->constant_count; i++) {
+        kgc_visit_object(tracer, &fn->functions[i]);
+    }
+}
+
+static size_t function_external_size(const KGCObject* obj) {
+    const KFunction* fn = (const KFunction*)obj;
+    size_t size = fn->proto->cache_count * sizeof(KFieldCache);
+    if (fn->functions) size += fn->proto->constant_count * sizeof(KGCObject*);
+    return size;
+}
+
+static void function_finalize(KGCHeap* heap, KGCObject* obj) {
+    KFunction* fn = (KFunction*)obj;
+    kgc_account_external(heap, -(ptrdiff_t)function_external_size(obj));
+    free(fn->functions);
+    free(fn->caches);
+}
+
+static const KGCTypeInfo function_type = {
+    .name = "function",
+    .trace = function_trace,
+    .finalize = function_finalize,
+    .external_size = function_external_size,
+};
+static const KGCTypeInfo native_type = {.name = "native", .trace = NULL, .finalize = NULL};
+
+static void coroutine_trace(KGCTracer* tracer, KGCObject* obj) {
+    kvalue_visit(tracer, &((KCoroutine*)obj)->result);
+}
+
+// 未结束的协程是根 (见 vm_roots), 句柄被回收时协程一定已经结束
+static const KGCTypeInfo coroutine_type = {.name = "coroutine", .trace = coroutine_trace, .finalize = NULL};
+
+// 为原型创建函数对象: 常量表直接使用程序中共享的, 只分配字段内联缓存
+static KFunction* function_new(KorelinVM* vm, const KProgram* program, const KProto* proto) {
+    KGCHeap* heap = vm->heap;
+    KFunction* fn = (KFunction*)kgc_alloc(heap, KOBJ_FUNCTION, sizeof(KFunction));
+    fn->proto = proto;
+    fn->program = program;
+    fn->constants = program->constants[proto->index];
+    fn->functions = NULL;
+    fn->caches = calloc(proto->cache_count ? proto->cache_count : 1, sizeof(KFieldCache));
+    if (!fn->caches) {
+        fprintf(stderr, "Error: calloc failed in function_new\n");
+        exit(EXIT_FAILURE);
+    }
+    kgc_account_external(heap, (ptrdiff_t)function_external_size(&fn->obj));
+    return fn;
+}
+
+// 辅助函数：分配 fn 的嵌套函数表 (第一次需要时)
+static void nested_table(KorelinVM* vm, KFunction* fn) {
+    if (fn->functions) return;
+    size_t count = fn->proto->constant_count;
+    fn->functions = calloc(count, sizeof(KGCObject*));
+    if (!fn->functions) {
+        fprintf(stderr, "Error: calloc failed in nested_table\n");
+        exit(EXIT_FAILURE);
+    }
+    kgc_account_external(vm->heap, (ptrdiff_t)(count * sizeof(KGCObject*)));
+}
+
+// 辅助函数：取得 fn 的第 index 个常量 (函数常量) 在本虚拟机中的函数对象, 第一次时创建
+static KGCObject* nested_function(KorelinVM* vm, KFunction* fn, uint16_t index) {
+    nested_table(vm, fn);
+    // 分配不会移动对象 (整理只在安全点进行), fn 在调用帧中, 不会被回收
+    KFunction* nested = function_new(vm, fn->program, fn->proto->constants[index].as.proto);
+    fn->functions[index] = &nested->obj;
+    kgc_write_barrier(vm->heap, &fn->obj, &nested->obj);
+    return &nested->obj;
+}
+
+KFunction* kvm_function_new(KorelinVM* vm, const KProto* proto) {
+    return function_new(vm, vm->program, proto);
+}
+
+void kvm_function_set_nested(KorelinVM* vm, KFunction* fn, size_t index, KFunction* nested) {
+    nested_table(vm, fn);
+    fn->functions[index] = &nested->obj;
+    kgc_write_barrier(vm->heap, &fn->obj, &nested->obj);
+}
+
+// =============================================================================
+// 虚拟机
+// =============================================================================
+
+// 辅助函数：第 page 页中的全局变量个数
+static size_t global_page_end(size_t count, size_t page) {
+    size_t rest = count - page * KVM_GLOBAL_PAGE;
+    return rest < KVM_GLOBAL_PAGE ? rest : KVM_GLOBAL_PAGE;
+}
+
+// 辅助函数：释放复制过的页表与页 (其余的页属于程序)
+static void release_globals(KorelinVM* vm) {
+    if (vm->globals_owned) {
+        for (size_t page = 0; page * KVM_GLOBAL_PAGE < vm->global_count; page++) {
+            if (vm->globals[page] != vm->program->global_pages[page]) free(vm->globals[page]);
+        }
+        free(vm->globals);
+    }
+    vm->globals = NULL;
+    vm->global_count = 0;
+    vm->globals_owned = false;
+}
+
+// 根集合: 栈、全局变量、调用帧中的函数与所有未结束的协程 (程序中的常量是共享对象, 不需要访问)
+static void vm_roots(KGCTracer* tracer, void* userdata) {
+    KorelinVM* vm = userdata;
+    for (size_t i = 0; i < vm->stack_top; i++) {
+        kvalue_visit(tracer, &vm->stack[i]);
+    }
+    // 与程序共享的页中只有冻结的对象, 不需要访问 (也不能写入)
+    for (size_t page = 0; vm->globals_owned && page * KVM_GLOBAL_PAGE < vm->global_count; page++) {
+        if (vm->globals[page] == vm->program->global_pages[page]) continue;
+        size_t end = global_page_end(vm->global_count, page);
+        for (size_t i = 0; i < end; i++) {
+            kvalue_visit(tracer, &vm->globals[page][i]);
+        }
+    }
+    for (size_t i = 0; i < vm->frame_count; i++) {
+        kgc_visit_object(tracer, &vm->frames[i].function);
+    }
+    for (KFiber* fiber = vm->fibers; fiber; fiber = fiber->next_live) {
+        if (fiber->coroutine) kgc_visit_object(tracer, &fiber->coroutine);
+        kvalue_visit(tracer, &fiber->resume_value);
+        // 正在执行的协程的栈就是 vm->stack
+        if (fiber == vm->fiber) continue;
+        for (size_t i = 0; i < fiber->stack_top; i++) {
+            kvalue_visit(tracer, &fiber->stack[i]);
+        }
+        for (size_t i = 0; i < fiber->frame_count; i++) {
+            kgc_visit_object(tracer, &fiber->frames[i].function);
+        }
+    }
+}
+
+// 辅助函数：分配协程的执行状态并登记为未结束
+static KFiber* fiber_new(KorelinVM* vm) {
+    KFiber* fiber = calloc(1, sizeof(KFiber));
+    if (!fiber) {
+        fprintf(stderr, "Error: calloc failed in fiber_new\n");
+        exit(EXIT_FAILURE);
+    }
+    fiber->next_live = vm->fibers;
+    if (vm->fibers) vm->fibers->prev_live = fiber;
+    vm->fibers = fiber;
+    return fiber;
+}
+
+// 辅助函数：注销并释放协程的执行状态 (不能是正在执行的协程)
+static void fiber_free(KorelinVM* vm, KFiber* fiber) {
+    if (fiber->prev_live) {
+        fiber->prev_live->next_live = fiber->next_live;
+    } else {
+        vm->fibers = fiber->next_live;
+    }
+    if (fiber->next_live) fiber->next_live->prev_live = fiber->prev_live;
+    if (fiber->coroutine) ((KCoroutine*)fiber->coroutine)->fiber = NULL;
+    free(fiber->stack);
+    free(fiber->frames);
+    free(fiber);
+}
+
+// 类型表是进程内共享的, 多个线程同时创建虚拟机时只注册一次
+static pthread_once_t types_once = PTHREAD_ONCE_INIT;
+
+static void register_types(void) {
+    kobject_init_types();
+    kgc_register_type(KOBJ_FUNCTION, &function_type);
+    kgc_register_type(KOBJ_NATIVE, &native_type);
+    kgc_register_type(KOBJ_COROUTINE, &coroutine_type);
+}
+
+KorelinVM* kvm_new(const KGCConfig* config) {
+    KorelinVM* vm = calloc(1, sizeof(KorelinVM));
+    if (!vm) {
+        fprintf(stderr, "Error: calloc failed in kvm_new\n");
+        exit(EXIT_FAILURE);
+    }
+    pthread_once(&types_once, register_types);
+    vm->heap = kgc_heap_new(config);
+    kgc_add_root_source(vm->heap, vm_roots, vm);
+    vm->main = fiber_new(vm);
+    vm->main->state = KFIBER_RUNNING;
+    vm->fiber = vm->main;
+    return vm;
+}
+
+void kvm_free(KorelinVM* vm) {
+    if (!vm) return;
+    // 事件循环先释放: 其中的定时器与连接可能还引用挂起的协程
+    knet_loop_free(vm);
+    while (vm->fibers) {
+        KFiber* fiber = vm->fibers;
+        // 正在执行的协程的栈与调用帧在虚拟机中
+        if (fiber == vm->fiber) {
+            fiber->stack = NULL;
+            fiber->frames = NULL;
+        }
+        fiber_free(vm, fiber);
+    }
+    kgc_heap_free(vm->heap);
+    release_globals(vm);
+    // 程序在引用它的堆之后释放
+    for (size_t i = 0; i < vm->owned_count; i++) {
+        kvm_program_free(vm->owned[i]);
+    }
+    free(vm->owned);
+    free(vm->stack);
+    free(vm->frames);
+    free(vm->error);
+    free(vm->unavailable);
+    free(vm);
+}
+
+// =============================================================================
+// 程序
+// =============================================================================
+
+// 辅助函数：在常量堆中驻留字符串, 同一程序中内容相同的常量是同一个对象 (哈希表的键比较可以直接按地址命中)
+static KString* intern_string(KGCHeap* heap, KMap* strings, const char* chars, size_t length) {
+    uint32_t hash = kstring_hash(chars, length);
+    KString* str = kmap_find_string(strings, chars, length, hash);
+    if (str) return str;
+    str = kstring_new(heap, chars, length);
+    kmap_set(heap, strings, KVALUE_OBJECT(str), KVALUE_BOOL(true));
+    return str;
+}
+
+KProgram* kvm_program_new(const KModule* module) {
+    pthread_once(&types_once, register_types);
+    size_t total = 0;
+    for (size_t i = 0; i < module->proto_count; i++) {
+        total += module->protos[i]->constant_count;
+    }
+    KProgram* program = calloc(1, sizeof(KProgram));
+    KValue* values = calloc(total ? total : 1, sizeof(KValue));
+    KValue** constants = malloc(module->proto_count * sizeof(KValue*));
+    KValue* globals = calloc(module->global_count ? module->global_count : 1, sizeof(KValue));
+    size_t page_count = module->global_count / KVM_GLOBAL_PAGE + 1;
+    KValue** global_pages = malloc(page_count * sizeof(KValue*));
+    if (!program || !values || !constants || !globals || !global_pages) {
+        fprintf(stderr, "Error: calloc failed in kvm_program_new\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t page = 0; page < page_count; page++) {
+        global_pages[page] = globals + page * KVM_GLOBAL_PAGE;
+    }
+    program->module = module;
+    program->constants = constants;
+    program->globals = globals;
+    program->global_pages = global_pages;
+
+    // 常量堆只分配不回收, 最后整体冻结; 其中的对象没有根, 所以构建期间不能触发回收
+    KGCConfig config;
+    kgc_default_config(&config);
+    config.incremental = false;
+    config.min_threshold = SIZE_MAX;
+    config.threads = 1;
+    config.sample_interval = 0;
+    KGCHeap* heap = kgc_heap_new(&config);
+    program->heap = heap;
+    KMap* strings = kmap_new(heap, 64);
+
+    // 所有原型的常量表连续存放在 values 中 (protos[0] 的在最前面)
+    for (size_t i = 0; i < module->proto_count; i++) {
+        const KProto* proto = module->protos[i];
+        constants[i] = values;
+        for (size_t j = 0; j < proto->constant_count; j++) {
+            const KConstant* constant = &proto->constants[j];
+            switch (constant->kind) {
+                case KCONST_INT:
+                    values[j] = KVALUE_INT(constant->as.integer);
+                    break;
+                case KCONST_DOUBLE:
+                    values[j] = KVALUE_DOUBLE(constant->as.number);
+                    break;
+                case KCONST_STRING:
+                    values[j] = KVALUE_OBJECT(
+                        intern_string(heap, strings, constant->as.string.chars, constant->as.string.length));
+                    break;
+                case KCONST_BIGINT:
+                    values[j] = kbigint_parse(heap, constant->as.string.chars, constant->as.string.length);
+                    break;
+                case KCONST_FUNCTION:
+                case KCONST_PATH:
+                    break;
+            }
+        }
+        values += proto->constant_count;
+    }
+
+    for (size_t i = 0; i < module->global_count; i++) {
+        if (!module->global_natives[i]) continue;
+        const KriNative* native = kri_find_native(module->globals[i]);
+        if (!native) continue;
+        KNative* obj = (KNative*)kgc_alloc(heap, KOBJ_NATIVE, sizeof(KNative));
+        obj->native = native;
+        globals[i] = KVALUE_OBJECT(obj);
+    }
+    kgc_freeze(heap);
+    return program;
+}
+
+void kvm_program_free(KProgram* program) {
+    if (!program) return;
+    kgc_heap_free(program->heap);
+    free(program->constants[0]);
+    free(program->constants);
+    free(program->globals);
+    free(program->global_pages);
+    free(program);
+}
+
+// 辅助函数：确保栈至少有 needed 个槽位 (扩容后栈中的地址失效, 下标仍然有效)
+static void ensure_stack(KorelinVM* vm, size_t needed) {
+    if (needed <= vm->stack_capacity) return;
+    size_t new_capacity = vm->stack_capacity ? vm->stack_capacity : 256;
+    while (new_capacity < needed) new_capacity *= 2;
+    KValue* new_stack = realloc(vm->stack, new_capacity * sizeof(KValue));
+    if (!new_stack) {
+        fprintf(stderr, "Error: realloc failed in ensure_stack\n");
+        exit(EXIT_FAILURE);
+    }
+    vm->stack = new_stack;
+    vm->stack_capacity = new_capacity;
+}
+
+// 辅助函数：压入调用帧, 调用者需要先检查 KVM_MAX_FRAMES
+static void push_frame(KorelinVM* vm, KFunction* fn, size_t base) {
+    if (vm->frame_count == vm->frame_capacity) {
+        size_t new_capacity = vm->frame_capacity ? vm->frame_capacity * 2 : 64;
+        KCallFrame* new_frames = realloc(vm->frames, new_capacity * sizeof(KCallFrame));
+        if (!new_frames) {
+            fprintf(stderr, "Error: realloc failed in push_frame\n");
+            exit(EXIT_FAILURE);
+        }
+        vm->frames = new_frames;
+        vm->frame_capacity = new_capacity;
+    }
+    vm->frames[vm->frame_count++] = (KCallFrame){.function = &fn->obj, .ip = fn->proto->code, .base = base};
+}
+
+// 辅助函数：格式化运行时错误: 信息之后每个调用帧一行 (各帧的 ip 必须已保存), 末尾没有换行
+static char* format_error(KorelinVM* vm, const char* format, va_list args) {
+    char* buffer = NULL;
+    size_t length = 0;
+    FILE* out = open_memstream(&buffer, &length);
+    if (!out) {
+        fprintf(stderr, "Error: open_memstream failed in format_error\n");
+        exit(EXIT_FAILURE);
+    }
+    vfprintf(out, format, args);
+    for (size_t i = vm->frame_count; i > 0; i--) {
+        // 深递归时只输出栈顶的若干帧与最外层的几帧
+        if (vm->frame_count > 24 && i == vm->frame_count - 16) {
+            fprintf(out, "\n    ... %zu more frame(s)", vm->frame_count - 24);
+            i = 9;
+        }
+        const KCallFrame* frame = &vm->frames[i - 1];
+        const KProto* proto = ((const KFunction*)frame->function)->proto;
+        size_t offset = (size_t)(frame->ip - proto->code);
+        int line = offset > 0 ? proto->lines[offset - 1] : 0;
+        fprintf(out, "\n    at %s (%s:%d)", proto->name, vm->module->name, line);
+    }
+    fclose(out);
+    return buffer;
+}
+
+// 辅助函数：输出运行时错误及调用栈; 隔离实例只记录第一个错误
+static void report_error(KorelinVM* vm, const char* format, va_list args) {
+    char* text = format_error(vm, format, args);
+    if (!vm->isolated) {
+        fprintf(stderr, "Runtime error: %s\n", text);
+        free(text);
+    } else if (!vm->error) {
+        vm->error = text;
+    } else {
+        free(text);
+    }
+}
+
+// 输出运行时错误及调用栈 (各帧的 ip 必须已保存)
+static void runtime_error(KorelinVM* vm, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    report_error(vm, format, args);
+    va_end(args);
+}
+
+void kvm_raise(KorelinVM* vm, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    report_error(vm, format, args);
+    va_end(args);
+    vm->raised = true;
+}
+
+// 辅助函数：字段类型名, 用于错误信息
+static const char* field_kind_name(const KStructField* field) {
+    switch (field->kind) {
+        case KFIELD_BOOL: return "bool";
+        case KFIELD_INT: return "int";
+        case KFIELD_LONG: return "long";
+        case KFIELD_DOUBLE: return "double";
+        case KFIELD_STRING: return "string";
+        case KFIELD_STRUCT: return field->struct_type->name;
+    }
+    return "?";
+}
+
+// 辅助函数：把 int、大整数或 double 转为 double
+static bool to_number(KValue value, double* out) {
+    if (value.type == KVAL_INT) {
+        *out = (double)value.as.integer;
+        return true;
+    }
+    if (value.type == KVAL_DOUBLE) {
+        *out = value.as.number;
+        return true;
+    }
+    if (kvalue_is_object_type(value, KOBJ_BIGINT)) {
+        *out = kbigint_to_double((const KBigInt*)value.as.object);
+        return true;
+    }
+    return false;
+}
+
+// 辅助函数：整数乘方, exponent 非负; 溢出时返回 false
+static bool int_pow(long long base, long long exponent, long long* out) {
+    long long result = 1;
+    while (true) {
+        if ((exponent & 1) && __builtin_mul_overflow(result, base, &result)) return false;
+        exponent >>= 1;
+        if (exponent == 0) break;
+        if (__builtin_mul_overflow(base, base, &base)) return false;
+    }
+    *out = result;
+    return true;
+}
+
+// 整数运算的快速路径: 溢出 (以及除数为 0、负指数) 时返回 false, 交给慢路径处理
+static inline bool arith_int(KOpCode op, long long a, long long b, KValue* out) {
+    long long result;
+    switch (op) {
+        case KOP_ADD:
+            if (__builtin_add_overflow(a, b, &result)) return false;
+            break;
+        case KOP_SUB:
+            if (__builtin_sub_overflow(a, b, &result)) return false;
+            break;
+        case KOP_MUL:
+            if (__builtin_mul_overflow(a, b, &result)) return false;
+            break;
+        case KOP_DIV:
+            if (b == 0 || (b == -1 && a == LLONG_MIN)) return false;
+            result = a / b;
+            break;
+        case KOP_MOD:
+            if (b == 0) return false;
+            result = b == -1 ? 0 : a % b;
+            break;
+        case KOP_POW:
+            if (b < 0 || !int_pow(a, b, &result)) return false;
+            break;
+        default:
+            return false;
+    }
+    *out = KVALUE_INT(result);
+    return true;
+}
+
+// 两个整数 (int 或大整数) 的运算, 结果超出 64 位时为大整数
+static const char* arith_integer(KGCHeap* heap, KOpCode op, KValue a, KValue b, KValue* out) {
+    switch (op) {
+        case KOP_ADD: *out = kbigint_add(heap, a, b); return NULL;
+        case KOP_SUB: *out = kbigint_sub(heap, a, b); return NULL;
+        case KOP_MUL: *out = kbigint_mul(heap, a, b); return NULL;
+        case KOP_DIV: return kbigint_divmod(heap, a, b, out, NULL) ? NULL : "division by zero";
+        case KOP_MOD: return kbigint_divmod(heap, a, b, NULL, out) ? NULL : "division by zero";
+        case KOP_POW: break;
+        default: return "unknown arithmetic operator";
+    }
+    // 负指数的结果为 double
+    if (kbigint_compare(b, KVALUE_INT(0)) < 0) {
+        double x = 0.0, y = 0.0;
+        to_number(a, &x);
+        to_number(b, &y);
+        *out = KVALUE_DOUBLE(pow(x, y));
+        return NULL;
+    }
+    if (b.type != KVAL_INT) {
+        // 指数超出 64 位时只有 0、1、-1 的乘方不会过大
+        if (a.type != KVAL_INT || a.as.integer < -1 || a.as.integer > 1) return "exponent of '^' is too large";
+        bool odd = ((const KBigInt*)b.as.object)->limbs[0] & 1;
+        *out = KVALUE_INT(a.as.integer == -1 && !odd ? 1 : a.as.integer);
+        return NULL;
+    }
+    return kbigint_pow(heap, a, b.as.integer, out);
+}
+
+// 算术运算的慢路径 (至少一个操作数不是 int, 或者 int 运算溢出), 出错时返回错误信息。
+// a 与 b 仍在栈上, 分配期间不会被回收
+static const char* arith_slow(KorelinVM* vm, KOpCode op, KValue a, KValue b, KValue* out) {
+    if (op == KOP_ADD && (kvalue_is_string(a) || kvalue_is_string(b))) {
+        // 字符串拼接: 另一侧的值按 print 的格式转换。
+        // 较长的结果是 rope, 循环中反复追加不会每次复制整个字符串
+        KGCHeap* heap = vm->heap;
+        if (!kvalue_is_string(a)) {
+            a = KVALUE_OBJECT(kvalue_to_string(heap, a));
+        } else if (!kvalue_is_string(b)) {
+            b = KVALUE_OBJECT(kvalue_to_string(heap, b));
+        }
+        *out = kstring_concat(heap, a, b);
+        return NULL;
+    }
+    if (kvalue_is_integer(a) && kvalue_is_integer(b)) return arith_integer(vm->heap, op, a, b, out);
+
+    double x, y;
+    if (!to_number(a, &x) || !to_number(b, &y)) return "operands must be numbers";
+    switch (op) {
+        case KOP_ADD: *out = KVALUE_DOUBLE(x + y); return NULL;
+        case KOP_SUB: *out = KVALUE_DOUBLE(x - y); return NULL;
+        case KOP_MUL: *out = KVALUE_DOUBLE(x * y); return NULL;
+        case KOP_DIV: *out = KVALUE_DOUBLE(x / y); return NULL;
+        case KOP_POW: *out = KVALUE_DOUBLE(pow(x, y)); return NULL;
+        case KOP_MOD: return "operands of '%' must be integers";
+        default: return "unknown arithmetic operator";
+    }
+}
+
+// 辅助函数：把栈槽中的 rope 替换为展平的字符串 (需要哈希、按下标访问或比较内容时调用)
+static inline void flatten_slot(KGCHeap* heap, KValue* slot) {
+    if (kvalue_is_object_type(*slot, KOBJ_ROPE)) *slot = KVALUE_OBJECT(kstring_flatten(heap, *slot));
+}
+
+// 比较运算, 出错时返回错误信息
+static const char* compare(KOpCode op, KValue a, KValue b, bool* out) {
+    int order;
+    if (a.type == KVAL_INT && b.type == KVAL_INT) {
+        order = (a.as.integer > b.as.integer) - (a.as.integer < b.as.integer);
+    } else if (kvalue_is_integer(a) && kvalue_is_integer(b)) {
+        order = kbigint_compare(a, b);
+    } else if (kvalue_is_object_type(a, KOBJ_STRING) && kvalue_is_object_type(b, KOBJ_STRING)) {
+        const KString* x = (const KString*)a.as.object;
+        const KString* y = (const KString*)b.as.object;
+        size_t length = x->length < y->length ? x->length : y->length;
+        order = memcmp(x->chars, y->chars, length);
+        if (order == 0) order = (x->length > y->length) - (x->length < y->length);
+    } else {
+        double x, y;
+        if (!to_number(a, &x) || !to_number(b, &y)) return "operands must be numbers or strings";
+        if (x != x || y != y) {     // NaN 与任何值比较都为假
+            *out = false;
+            return NULL;
+        }
+        order = (x > y) - (x < y);
+    }
+    switch (op) {
+        case KOP_LT: *out = order < 0; break;
+        case KOP_LE: *out = order <= 0; break;
+        case KOP_GT: *out = order > 0; break;
+        default: *out = order >= 0; break;
+    }
+    return NULL;
+}
+
+// 辅助函数：检查下标并转换为 size_t
+static const char* check_index(KValue index, size_t count, size_t* out) {
+    if (index.type != KVAL_INT) return "index must be an integer";
+    if (index.as.integer < 0 || (unsigned long long)index.as.integer >= count) return "index out of range";
+    *out = (size_t)index.as.integer;
+    return NULL;
+}
+
+// 辅助函数：定位 数组[下标] (或 字典[键]) 中结构体元素的数据; 结构体数组的元素就地存放, 普通数组中存放的是 KStruct。
+// 持久化字典与向量中的结构体可能被多个版本共享, 只能读取 (write 为 false)
+static const char* element_data(KValue array, KValue index, bool write, const KStructType** type,
+                                unsigned char** data, KGCObject** owner) {
+    size_t i;
+    const char* error;
+    if (kvalue_is_object_type(array, KOBJ_PMAP) || kvalue_is_object_type(array, KOBJ_PVECTOR)) {
+        KValue value;
+        if (write) return "persistent collections cannot be modified in place; use assoc";
+        if (array.as.object->type == KOBJ_PMAP) {
+            if (!kmap_valid_key(index)) return "invalid map key";
+            if (!kpmap_get((KPMap*)array.as.object, index, &value)) return "map has no such key";
+        } else {
+            KPVector* vector = (KPVector*)array.as.object;
+            if ((error = check_index(index, vector->count, &i))) return error;
+            value = kpvector_get(vector, i);
+        }
+        if (!kvalue_is_object_type(value, KOBJ_STRUCT)) return "element is not a struct";
+        KStruct* element = (KStruct*)value.as.object;
+        *type = element->type;
+        *data = element->data;
+        *owner = &element->obj;
+        return NULL;
+    }
+    if (kvalue_is_object_type(array, KOBJ_STRUCT_ARRAY)) {
+        KStructArray* structs = (KStructArray*)array.as.object;
+        if ((error = check_index(index, structs->count, &i))) return error;
+        *type = structs->type;
+        *data = kstruct_array_at(structs, i);
+        *owner = &structs->obj;
+        return NULL;
+    }
+    if (kvalue_is_object_type(array, KOBJ_ARRAY)) {
+        KArray* items = (KArray*)array.as.object;
+        if ((error = check_index(index, items->count, &i))) return error;
+        if (items->kind != KELEM_VALUE || !kvalue_is_object_type(items->items.values[i], KOBJ_STRUCT)) {
+            return "array element is not a struct";
+        }
+        KStruct* element = (KStruct*)items->items.values[i].as.object;
+        *type = element->type;
+        *data = element->data;
+        *owner = &element->obj;
+        return NULL;
+    }
+    if (kvalue_is_object_type(array, KOBJ_MAP)) {
+        KValue value;
+        if (!kmap_valid_key(index)) return "invalid map key";
+        if (!kmap_get((KMap*)array.as.object, index, &value)) return "map has no such key";
+        if (!kvalue_is_object_type(value, KOBJ_STRUCT)) return "map value is not a struct";
+        KStruct* element = (KStruct*)value.as.object;
+        *type = element->type;
+        *data = element->data;
+        *owner = &element->obj;
+        return NULL;
+    }
+    return "value is not an array";
+}
+
+// 执行到调用帧数回到 base_frame 为止; 最后返回的值留在栈顶
+static bool run(KorelinVM* vm, size_t base_frame) {
+    KGCHeap* heap = vm->heap;
+    KCallFrame* frame;
+    KFunction* fn;
+    const uint8_t* ip;
+    KValue* slots;
+
+#define LOAD_FRAME()                                        \
+    do {                                                    \
+        frame = &vm->frames[vm->frame_count - 1];           \
+        fn = (KFunction*)frame->function;                   \
+        ip = frame->ip;                                     \
+        slots = vm->stack + frame->base;                    \
+    } while (0)
+#define READ_BYTE() (*ip++)
+#define READ_U16() (ip += 2, kric_read_u16(ip - 2))
+#define PUSH(value) (vm->stack[vm->stack_top++] = (value))
+#define PEEK(n) (vm->stack[vm->stack_top - 1 - (n)])
+#define RUNTIME_ERROR(...)                                  \
+    do {                                                    \
+        frame->ip = ip;                                     \
+        runtime_error(vm, __VA_ARGS__);                     \
+        return false;                                       \
+    } while (0)
+// 安全点: 整理可能移动当前函数对象, 之后从调用帧重新读取
+#define SAFEPOINT()                                         \
+    do {                                                    \
+        frame->ip = ip;                                     \
+        kgc_safepoint(heap);                                \
+        fn = (KFunction*)frame->function;                   \
+    } while (0)
+
+    LOAD_FRAME();
+    while (true) {
+        KOpCode op = (KOpCode)READ_BYTE();
+        switch (op) {
+            case KOP_CONST:
+                PUSH(fn->constants[READ_U16()]);
+                break;
+            case KOP_FUNCTION: {
+                uint16_t index = READ_U16();
+                KGCObject* nested = fn->functions ? fn->functions[index] : NULL;
+                if (!nested) nested = nested_function(vm, fn, index);
+                PUSH(KVALUE_OBJECT(nested));
+                break;
+            }
+            case KOP_NULL:
+                PUSH(KVALUE_NULL);
+                break;
+            case KOP_TRUE:
+                PUSH(KVALUE_BOOL(true));
+                break;
+            case KOP_FALSE:
+                PUSH(KVALUE_BOOL(false));
+                break;
+            case KOP_POP:
+                vm->stack_top--;
+                break;
+            case KOP_DUP: {
+                KValue value = PEEK(0);
+                PUSH(value);
+                break;
+            }
+            case KOP_DUP2: {
+                KValue a = PEEK(1);
+                KValue b = PEEK(0);
+                PUSH(a);
+                PUSH(b);
+                break;
+            }
+            case KOP_GET_LOCAL:
+                PUSH(slots[READ_U16()]);
+                break;
+            case KOP_SET_LOCAL:
+                slots[READ_U16()] = PEEK(0);
+                break;
+            case KOP_GET_GLOBAL: {
+                uint16_t index = READ_U16();
+                if (vm->unavailable && vm->unavailable[index]) {
+                    RUNTIME_ERROR("global '%s' (%s) is not available in a parallel worker; only scalars, functions "
+                                  "and frozen values are shared (see freeze)",
+                                  vm->module->globals[index], vm->unavailable[index]);
+                }
+                PUSH(kvm_get_global(vm, index));
+                break;
+            }
+            case KOP_SET_GLOBAL: {
+                uint16_t index = READ_U16();
+                if (vm->isolated) {
+                    RUNTIME_ERROR("cannot assign to global '%s' in a parallel worker", vm->module->globals[index]);
+                }
+                *kvm_global_slot(vm, index) = PEEK(0);
+                break;
+            }
+
+            case KOP_ADD: case KOP_SUB: case KOP_MUL: case KOP_DIV: case KOP_MOD: case KOP_POW: {
+                KValue b = PEEK(0);
+                KValue a = PEEK(1);
+                KValue result;
+                const char* error = NULL;
+                if (a.type != KVAL_INT || b.type != KVAL_INT || !arith_int(op, a.as.integer, b.as.integer, &result)) {
+                    error = arith_slow(vm, op, a, b, &result);
+                }
+                if (error) {
+                    RUNTIME_ERROR("%s (%s and %s)", error, kvalue_type_name(a), kvalue_type_name(b));
+                }
+                vm->stack_top--;
+                PEEK(0) = result;
+                break;
+            }
+            case KOP_NEG: {
+                KValue value = PEEK(0);
+                if (value.type == KVAL_INT && value.as.integer != LLONG_MIN) {
+                    PEEK(0) = KVALUE_INT(-value.as.integer);
+                } else if (kvalue_is_integer(value)) {
+                    PEEK(0) = kbigint_neg(heap, value);
+                } else if (value.type == KVAL_DOUBLE) {
+                    PEEK(0) = KVALUE_DOUBLE(-value.as.number);
+                } else {
+                    RUNTIME_ERROR("operand of '-' must be a number (%s)", kvalue_type_name(value));
+                }
+                break;
+            }
+            case KOP_NOT:
+                PEEK(0) = KVALUE_BOOL(!kvalue_truthy(PEEK(0)));
+                break;
+            case KOP_EQ: case KOP_NE: {
+                flatten_slot(heap, &PEEK(1));
+                flatten_slot(heap, &PEEK(0));
+                bool equal = kvalue_equals(PEEK(1), PEEK(0));
+                vm->stack_top--;
+                PEEK(0) = KVALUE_BOOL(op == KOP_EQ ? equal : !equal);
+                break;
+            }
+            case KOP_LT: case KOP_LE: case KOP_GT: case KOP_GE: {
+                bool result;
+                flatten_slot(heap, &PEEK(1));
+                flatten_slot(heap, &PEEK(0));
+                const char* error = compare(op, PEEK(1), PEEK(0), &result);
+                if (error) {
+                    RUNTIME_ERROR("%s (%s and %s)", error, kvalue_type_name(PEEK(1)), kvalue_type_name(PEEK(0)));
+                }
+                vm->stack_top--;
+                PEEK(0) = KVALUE_BOOL(result);
+                break;
+            }
+
+            case KOP_JUMP: {
+                uint16_t offset = READ_U16();
+                ip += offset;
+                break;
+            }
+            case KOP_JUMP_IF_FALSE: {
+                uint16_t offset = READ_U16();
+                if (!kvalue_truthy(vm->stack[--vm->stack_top])) ip += offset;
+                break;
+            }
+            case KOP_AND: case KOP_OR: {
+                uint16_t offset = READ_U16();
+                if (kvalue_truthy(PEEK(0)) == (op == KOP_OR)) {
+                    ip += offset;
+                } else {
+                    vm->stack_top--;
+                }
+                break;
+            }
+            case KOP_LOOP: {
+                uint16_t offset = READ_U16();
+                ip -= offset;
+                SAFEPOINT();
+                break;
+            }
+
+            case KOP_CALL: {
+                int argc = READ_BYTE();
+                KValue callee = PEEK(argc);
+                if (kvalue_is_object_type(callee, KOBJ_FUNCTION)) {
+                    KFunction* target = (KFunction*)callee.as.object;
+                    const KProto* proto = target->proto;
+                    if (argc != proto->arity) {
+                        RUNTIME_ERROR("%s expects %d argument(s) but got %d", proto->name, proto->arity, argc);
+                    }
+                    if (vm->frame_count >= KVM_MAX_FRAMES) {
+                        RUNTIME_ERROR("stack overflow");
+                    }
+                    size_t base = vm->stack_top - (size_t)argc - 1;
+                    ensure_stack(vm, base + proto->max_stack + 1);
+                    frame->ip = ip;
+                    push_frame(vm, target, base);
+                    kgc_set_alloc_site(heap, proto->site);
+                    LOAD_FRAME();
+                    SAFEPOINT();
+                } else if (kvalue_is_object_type(callee, KOBJ_NATIVE)) {
+                    const KriNative* native = ((KNative*)callee.as.object)->native;
+                    if (native->arity >= 0 && argc != native->arity) {
+                        RUNTIME_ERROR("%s expects %d argument(s) but got %d", native->name, native->arity, argc);
+                    }
+                    // 原生函数按 KString 处理字符串参数
+                    for (size_t i = vm->stack_top - (size_t)argc; i < vm->stack_top; i++) {
+                        flatten_slot(heap, &vm->stack[i]);
+                    }
+                    frame->ip = ip;
+                    KValue result = native->fn(vm, argc, &vm->stack[vm->stack_top - (size_t)argc]);
+                    // 原生函数可能经 kvm_call 回调脚本: 栈与调用帧可能已扩容, 函数对象可能已移动
+                    LOAD_FRAME();
+                    vm->stack_top -= (size_t)argc + 1;
+                    PUSH(result);
+                    // 原生函数挂起了协程: 恢复时替换这个返回值, 从下一条指令继续
+                    if (vm->suspending) return true;
+                    // 原生函数报告了运行时错误 (已经输出)
+                    if (vm->raised) {
+                        vm->raised = false;
+                        return false;
+                    }
+                } else {
+                    RUNTIME_ERROR("cannot call a value of type %s", kvalue_type_name(callee));
+                }
+                break;
+            }
+            case KOP_RETURN: {
+                KValue result = vm->stack[--vm->stack_top];
+                size_t base = frame->base;
+                vm->frame_count--;
+                vm->stack_top = base;
+                PUSH(result);
+                if (vm->frame_count == base_frame) return true;
+                LOAD_FRAME();
+                kgc_set_alloc_site(heap, fn->proto->site);
+                SAFEPOINT();
+                break;
+            }
+
+            case KOP_NEW_ARRAY: {
+                size_t count = READ_U16();
+                KArray* array = karray_new(heap, count);
+                for (size_t i = 0; i < count; i++) {
+                    karray_push(heap, array, vm->stack[vm->stack_top - count + i]);
+                }
+                vm->stack_top -= count;
+                PUSH(KVALUE_OBJECT(array));
+                break;
+            }
+            case KOP_NEW_MAP: {
+                size_t count = READ_U16();
+                KValue* pairs = &vm->stack[vm->stack_top - 2 * count];
+                for (size_t i = 0; i < count; i++) {
+                    flatten_slot(heap, &pairs[2 * i]);
+                    if (!kmap_valid_key(pairs[2 * i])) {
+                        RUNTIME_ERROR("invalid map key (%s)", kvalue_type_name(pairs[2 * i]));
+                    }
+                }
+                // 键值对在写入完成之前一直留在栈上, kmap_set 不会分配堆对象
+                KMap* map = kmap_new(heap, count);
+                pairs = &vm->stack[vm->stack_top - 2 * count];
+                for (size_t i = 0; i < count; i++) {
+                    kmap_set(heap, map, pairs[2 * i], pairs[2 * i + 1]);
+                }
+                vm->stack_top -= 2 * count;
+                PUSH(KVALUE_OBJECT(map));
+                break;
+            }
+            case KOP_GET_INDEX: {
+                flatten_slot(heap, &PEEK(1));
+                flatten_slot(heap, &PEEK(0));
+                KValue index = PEEK(0);
+                KValue target = PEEK(1);
+                KValue result;
+                size_t i;
+                const char* error = NULL;
+                if (kvalue_is_array(target)) {
+                    KArray* array = (KArray*)target.as.object;
+                    if (!(error = check_index(index, array->count, &i))) {
+                        result = karray_get(array, i);
+                        // 读出的结构体是副本, 修改它不会影响数组中的元素
+                        if (kvalue_is_object_type(result, KOBJ_STRUCT)) {
+                            result = KVALUE_OBJECT(kstruct_copy(heap, (KStruct*)result.as.object));
+                        }
+                    }
+                } else if (kvalue_is_object_type(target, KOBJ_MAP)) {
+                    // 不存在的键读出 null; int 键走不需要通用比较的快速路径
+                    KMap* map = (KMap*)target.as.object;
+                    bool found = index.type == KVAL_INT ? kmap_get_int(map, index.as.integer, &result)
+                                 : kmap_valid_key(index) ? kmap_get(map, index, &result)
+                                                         : (error = "invalid map key", false);
+                    if (!found) {
+                        result = KVALUE_NULL;
+                    } else if (kvalue_is_object_type(result, KOBJ_STRUCT)) {
+                        result = KVALUE_OBJECT(kstruct_copy(heap, (KStruct*)result.as.object));
+                    }
+                } else if (kvalue_is_object_type(target, KOBJ_CONCURRENT_MAP)) {
+                    if (!kmap_valid_key(index)) {
+                        error = "invalid map key";
+                    } else if (!kcmap_get(((KConcurrentMap*)target.as.object)->shared, heap, index, &result)) {
+                        result = KVALUE_NULL;
+                    }
+                } else if (kvalue_is_object_type(target, KOBJ_PMAP) || kvalue_is_object_type(target, KOBJ_PVECTOR)) {
+                    if (target.as.object->type == KOBJ_PMAP) {
+                        if (!kmap_valid_key(index)) {
+                            error = "invalid map key";
+                        } else if (!kpmap_get((KPMap*)target.as.object, index, &result)) {
+                            result = KVALUE_NULL;
+                        }
+                    } else {
+                        KPVector* vector = (KPVector*)target.as.object;
+                        if (!(error = check_index(index, vector->count, &i))) result = kpvector_get(vector, i);
+                    }
+                    if (!error && kvalue_is_object_type(result, KOBJ_STRUCT)) {
+                        result = KVALUE_OBJECT(kstruct_copy(heap, (KStruct*)result.as.object));
+                    }
+                } else if (kvalue_is_object_type(target, KOBJ_STRUCT_ARRAY)) {
+                    KStructArray* array = (KStructArray*)target.as.object;
+                    if (!(error = check_index(index, array->count, &i))) {
+                        KStruct* element = kstruct_new(heap, array->type);
+                        memcpy(element->data, kstruct_array_at(array, i), array->type->size);
+                        result = KVALUE_OBJECT(element);
+                    }
+                } else if (kvalue_is_object_type(target, KOBJ_STRING)) {
+                    KString* str = (KString*)target.as.object;
+                    if (!(error = check_index(index, str->length, &i))) {
+                        result = KVALUE_OBJECT(kstring_new(heap, str->chars + i, 1));
+                    }
+                } else {
+                    error = "value cannot be indexed";
+                }
+                if (error) RUNTIME_ERROR("%s (%s)", error, kvalue_type_name(target));
+                vm->stack_top -= 2;
+                PUSH(result);
+                break;
+            }
+            case KOP_SET_INDEX: {
+                flatten_slot(heap, &PEEK(1));
+                if (kvalue_is_object_type(PEEK(2), KOBJ_CONCURRENT_MAP)) flatten_slot(heap, &PEEK(0));
+                KValue value = PEEK(0);
+                KValue index = PEEK(1);
+                KValue target = PEEK(2);
+                size_t i;
+                const char* error = NULL;
+                if (kvalue_is_array(target)) {
+                    KArray* array = (KArray*)target.as.object;
+                    if (array->obj.flags & KGC_FLAG_SHARED) {
+                        RUNTIME_ERROR("cannot modify frozen %s", kvalue_type_name(target));
+                    }
+                    if (!(error = check_index(index, array->count, &i)) && !karray_set(heap, array, i, value)) {
+                        RUNTIME_ERROR("cannot store %s in %s", kvalue_type_name(value), kvalue_type_name(target));
+                    }
+                } else if (kvalue_is_object_type(target, KOBJ_MAP)) {
+                    if (!kmap_valid_key(index)) {
+                        RUNTIME_ERROR("invalid map key (%s)", kvalue_type_name(index));
+                    }
+                    kmap_set(heap, (KMap*)target.as.object, index, value);
+                } else if (kvalue_is_object_type(target, KOBJ_CONCURRENT_MAP)) {
+                    if (!kmap_valid_key(index)) {
+                        RUNTIME_ERROR("invalid map key (%s)", kvalue_type_name(index));
+                    }
+                    if (!kcmap_set(((KConcurrentMap*)target.as.object)->shared, index, value)) {
+                        RUNTIME_ERROR("cannot store %s in concurrent map", kvalue_type_name(value));
+                    }
+                } else if (kvalue_is_object_type(target, KOBJ_PMAP)) {
+                    // 只有 transient 可以就地修改
+                    KPMap* map = (KPMap*)target.as.object;
+                    if (!map->edit) RUNTIME_ERROR("cannot modify persistent map; use assoc or transient");
+                    if (!kmap_valid_key(index)) {
+                        RUNTIME_ERROR("invalid map key (%s)", kvalue_type_name(index));
+                    }
+                    kpmap_assoc(heap, map, index, value);
+                } else if (kvalue_is_object_type(target, KOBJ_PVECTOR)) {
+                    KPVector* vector = (KPVector*)target.as.object;
+                    if (!vector->edit) RUNTIME_ERROR("cannot modify persistent vector; use assoc or transient");
+                    if (!(error = check_index(index, vector->count, &i))) kpvector_assoc(heap, vector, i, value);
+                } else if (kvalue_is_object_type(target, KOBJ_STRUCT_ARRAY)) {
+                    KStructArray* array = (KStructArray*)target.as.object;
+                    if (!(error = check_index(index, array->count, &i))) {
+                        if (!kvalue_is_object_type(value, KOBJ_STRUCT) ||
+                            ((KStruct*)value.as.object)->type != array->type) {
+                            RUNTIME_ERROR("cannot store %s in %s[]", kvalue_type_name(value), array->type->name);
+                        }
+                        kstruct_assign(heap, &array->obj, array->type, kstruct_array_at(array, i),
+                                       ((KStruct*)value.as.object)->data);
+                    }
+                } else {
+                    error = "value does not support index assignment";
+                }
+                if (error) RUNTIME_ERROR("%s (%s)", error, kvalue_type_name(target));
+                vm->stack_top -= 3;
+                PUSH(value);
+                break;
+            }
+
+            case KOP_NEW_STRUCT: {
+                const KStructType* type = vm->module->structs[READ_U16()];
+                size_t argc = READ_BYTE();
+                if (argc > type->field_count) {
+                    RUNTIME_ERROR("%s has %zu field(s) but got %zu argument(s)", type->name, type->field_count, argc);
+                }
+                // 结构体的字符串字段只存放展平的字符串
+                for (size_t i = vm->stack_top - argc; i < vm->stack_top; i++) flatten_slot(heap, &vm->stack[i]);
+                KStruct* value = kstruct_new(heap, type);
+                for (size_t i = 0; i < argc; i++) {
+                    const KStructField* field = &type->fields[i];
+                    KValue arg = vm->stack[vm->stack_top - argc + i];
+                    if (!kstruct_store(heap, &value->obj, field, value->data + field->offset, arg)) {
+                        RUNTIME_ERROR("cannot initialize %s.%s (%s) with %s", type->name, field->name,
+                                      field_kind_name(field), kvalue_type_name(arg));
+                    }
+                }
+                vm->stack_top -= argc;
+                PUSH(KVALUE_OBJECT(value));
+                break;
+            }
+            case KOP_NEW_STRUCT_ARRAY: {
+                const KStructType* type = vm->module->structs[READ_U16()];
+                KValue count = PEEK(0);
+                if (count.type != KVAL_INT || count.as.integer < 0) {
+                    RUNTIME_ERROR("%s[n] requires a non-negative integer length", type->name);
+                }
+                if (type->size > 0 && (unsigned long long)count.as.integer > SIZE_MAX / 2 / type->size) {
+                    RUNTIME_ERROR("%s[%lld] is too large", type->name, count.as.integer);
+                }
+                PEEK(0) = KVALUE_OBJECT(kstruct_array_new(heap, type, (size_t)count.as.integer));
+                break;
+            }
+            case KOP_GET_FIELD: case KOP_SET_FIELD: {
+                const char* path = fn->proto->constants[READ_U16()].as.string.chars;
+                KFieldCache* cache = &fn->caches[READ_U16()];
+                KValue target = PEEK(op == KOP_SET_FIELD ? 1 : 0);
+                if (!kvalue_is_object_type(target, KOBJ_STRUCT)) {
+                    RUNTIME_ERROR("cannot access field '%s' of %s", path, kvalue_type_name(target));
+                }
+                KStruct* object = (KStruct*)target.as.object;
+                uint32_t offset;
+                const KStructField* field = kstruct_lookup(cache, object->type, path, &offset);
+                if (!field) RUNTIME_ERROR("%s has no field '%s'", object->type->name, path);
+
+                if (op == KOP_GET_FIELD) {
+                    PEEK(0) = kstruct_load(heap, field, object->data + offset);
+                } else {
+                    flatten_slot(heap, &PEEK(0));
+                    KValue value = PEEK(0);
+                    if (!kstruct_store(heap, &object->obj, field, object->data + offset, value)) {
+                        RUNTIME_ERROR("cannot assign %s to %s.%s (%s)", kvalue_type_name(value), object->type->name,
+                                      path, field_kind_name(field));
+                    }
+                    vm->stack_top -= 2;
+                    PUSH(value);
+                }
+                break;
+            }
+            case KOP_GET_ELEM_FIELD: case KOP_SET_ELEM_FIELD: {
+                const char* path = fn->proto->constants[READ_U16()].as.string.chars;
+                KFieldCache* cache = &fn->caches[READ_U16()];
+                size_t operands = op == KOP_SET_ELEM_FIELD ? 1 : 0;
+                flatten_slot(heap, &PEEK(operands));
+                if (operands) flatten_slot(heap, &PEEK(0));
+                const KStructType* type;
+                unsigned char* data;
+                KGCObject* owner;
+                const char* error = element_data(PEEK(operands + 1), PEEK(operands), op == KOP_SET_ELEM_FIELD, &type,
+                                                 &data, &owner);
+                if (error) RUNTIME_ERROR("%s (%s)", error, kvalue_type_name(PEEK(operands + 1)));
+                uint32_t offset;
+                const KStructField* field = kstruct_lookup(cache, type, path, &offset);
+                if (!field) RUNTIME_ERROR("%s has no field '%s'", type->name, path);
+
+                KValue value;
+                if (op == KOP_GET_ELEM_FIELD) {
+                    value = kstruct_load(heap, field, data + offset);
+                    vm->stack_top -= 2;
+                } else {
+                    value = PEEK(0);
+                    if (!kstruct_store(heap, owner, field, data + offset, value)) {
+                        RUNTIME_ERROR("cannot assign %s to %s.%s (%s)", kvalue_type_name(value), type->name, path,
+                                      field_kind_name(field));
+                    }
+                    vm->stack_top -= 3;
+                }
+                PUSH(value);
+                break;
+            }
+            case KOP_COPY:
+                if (kvalue_is_object_type(PEEK(0), KOBJ_STRUCT)) {
+                    PEEK(0) = KVALUE_OBJECT(kstruct_copy(heap, (KStruct*)PEEK(0).as.object));
+                }
+                break;
+            default:
+                RUNTIME_ERROR("unknown opcode %d", (int)op);
+        }
+    }
+
+#undef LOAD_FRAME
+#undef READ_BYTE
+#undef READ_U16
+#undef PUSH
+#undef PEEK
+#undef RUNTIME_ERROR
+#undef SAFEPOINT
+}
+
+// =============================================================================
+// 协程
+//
+// 协程在同一个虚拟机中由运行队列先进先出地调度: 被调度的协程换上自己的栈与调用帧,
+// 执行到挂起或结束后换回。挂起只发生在协程直接调用的原生函数返回之后, 此时 run 直接
+// 返回, C 栈上不留下协程的状态, 所以挂起的协程只占用它自己的值栈与调用帧。
+// =============================================================================
+
+#define KVM_FIBER_STACK 16      // 新协程的初始栈槽数, 不足时倍增
+#define KVM_FIBER_FRAMES 4      // 新协程的初始调用帧数
+
+// 辅助函数：换上协程 to 的栈与调用帧, 保存当前协程的
+static void fiber_switch(KorelinVM* vm, KFiber* to) {
+    KFiber* from = vm->fiber;
+    if (from == to) return;
+    from->stack = vm->stack;
+    from->stack_top = vm->stack_top;
+    from->stack_capacity = vm->stack_capacity;
+    from->frames = vm->frames;
+    from->frame_count = vm->frame_count;
+    from->frame_capacity = vm->frame_capacity;
+    from->nested = vm->nested;
+    vm->stack = to->stack;
+    vm->stack_top = to->stack_top;
+    vm->stack_capacity = to->stack_capacity;
+    vm->frames = to->frames;
+    vm->frame_count = to->frame_count;
+    vm->frame_capacity = to->frame_capacity;
+    vm->nested = to->nested;
+    vm->fiber = to;
+    const KFunction* top = vm->frame_count ? (const KFunction*)vm->frames[vm->frame_count - 1].function : NULL;
+    kgc_set_alloc_site(vm->heap, top ? top->proto->site : NULL);
+}
+
+static void enqueue(KorelinVM* vm, KFiber* fiber) {
+    fiber->state = KFIBER_RUNNABLE;
+    fiber->next = NULL;
+    if (vm->run_tail) {
+        vm->run_tail->next = fiber;
+    } else {
+        vm->run_head = fiber;
+    }
+    vm->run_tail = fiber;
+}
+
+KFiber* kvm_park(KorelinVM* vm) {
+    if (vm->nested > 0 || vm->suspending) return NULL;
+    vm->suspending = true;
+    vm->fiber->state = KFIBER_PARKED;
+    return vm->fiber;
+}
+
+void kvm_wake(KorelinVM* vm, KFiber* fiber, KValue value) {
+    if (fiber->state != KFIBER_PARKED) return;
+    fiber->resumed = true;
+    fiber->resume_value = value;
+    enqueue(vm, fiber);
+}
+
+// 辅助函数：正在执行的协程的 run 已返回: 挂起时保持原样, 结束时记录结果并唤醒等待它的协程
+static void fiber_stopped(KorelinVM* vm, KFiber* fiber, bool ok) {
+    bool suspended = ok && vm->suspending;
+    vm->suspending = false;
+    if (suspended) return;
+    KValue result = ok ? vm->stack[0] : KVALUE_NULL;
+    fiber->state = ok ? KFIBER_DONE : KFIBER_FAILED;
+    if (!ok && fiber != vm->main) vm->failures++;
+    if (fiber->coroutine) {
+        KCoroutine* co = (KCoroutine*)fiber->coroutine;
+        co->result = result;
+        kvalue_write_barrier(vm->heap, &co->obj, result);
+        co->done = true;
+        co->failed = !ok;
+    }
+    // 等待出错的协程得到 null
+    KFiber* waiter = fiber->waiters;
+    fiber->waiters = NULL;
+    while (waiter) {
+        KFiber* next = waiter->next;
+        kvm_wake(vm, waiter, result);
+        waiter = next;
+    }
+    vm->stack_top = 0;
+    vm->frame_count = 0;
+}
+
+// 辅助函数：执行协程直到它挂起或结束, 然后换回原来的协程
+static void fiber_step(KorelinVM* vm, KFiber* fiber) {
+    KFiber* previous = vm->fiber;
+    fiber_switch(vm, fiber);
+    if (fiber->resumed) {
+        vm->stack[vm->stack_top - 1] = fiber->resume_value;
+        fiber->resumed = false;
+        fiber->resume_value = KVALUE_NULL;
+    }
+    fiber->state = KFIBER_RUNNING;
+    bool ok = run(vm, 0);
+    fiber_stopped(vm, fiber, ok);
+    fiber_switch(vm, previous);
+    if ((fiber->state == KFIBER_DONE || fiber->state == KFIBER_FAILED) && fiber != vm->main) {
+        fiber_free(vm, fiber);
+    }
+}
+
+bool kvm_run_fibers(KorelinVM* vm) {
+    // 本轮只执行调用时已在队列中的协程, 其间重新入队的留到下一轮
+    KFiber* last = vm->run_tail;
+    while (vm->run_head) {
+        KFiber* fiber = vm->run_head;
+        vm->run_head = fiber->next;
+        if (!vm->run_head) vm->run_tail = NULL;
+        fiber->next = NULL;
+        fiber_step(vm, fiber);
+        if (vm->main->state == KFIBER_FAILED) return false;
+        if (fiber == last) break;
+    }
+    return true;
+}
+
+// 辅助函数：主程序挂起后调度所有协程, 直到没有可以继续执行的协程; 主程序出错或永远
+// 无法恢复时返回 false
+static bool schedule(KorelinVM* vm) {
+    while (true) {
+        if (!kvm_run_fibers(vm)) return false;
+        // 没有可运行的协程时阻塞在事件循环上, 等待定时器或网络唤醒挂起的协程
+        bool waiting = knet_poll(vm, vm->run_head == NULL);
+        if (!waiting && !vm->run_head) break;
+    }
+    if (vm->main->state != KFIBER_DONE) {
+        fputs("Runtime error: deadlock: the main program is waiting for a coroutine that can never resume\n", stderr);
+        return false;
+    }
+    return true;
+}
+
+// spawn(fn, ...args) -> coroutine | null
+static KValue native_spawn(KorelinVM* vm, int argc, const KValue* argv) {
+    if (argc < 1 || !kvalue_is_object_type(argv[0], KOBJ_FUNCTION)) return KVALUE_NULL;
+    const KProto* proto = ((const KFunction*)argv[0].as.object)->proto;
+    if (argc - 1 != proto->arity) return KVALUE_NULL;
+    // argv 在虚拟机的栈上, 分配期间被移动的对象会在栈中就地更新
+    KCoroutine* co = (KCoroutine*)kgc_alloc(vm->heap, KOBJ_COROUTINE, sizeof(KCoroutine));
+    co->result = KVALUE_NULL;
+    co->done = false;
+    co->failed = false;
+
+    KFiber* fiber = fiber_new(vm);
+    size_t capacity = proto->max_stack + 1 > KVM_FIBER_STACK ? proto->max_stack + 1 : KVM_FIBER_STACK;
+    fiber->stack = malloc(capacity * sizeof(KValue));
+    fiber->frames = malloc(KVM_FIBER_FRAMES * sizeof(KCallFrame));
+    if (!fiber->stack || !fiber->frames) {
+        fprintf(stderr, "Error: malloc failed in native_spawn\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(fiber->stack, argv, (size_t)argc * sizeof(KValue));
+    fiber->stack_top = (size_t)argc;
+    fiber->stack_capacity = capacity;
+    fiber->frames[0] = (KCallFrame){.function = argv[0].as.object, .ip = proto->code, .base = 0};
+    fiber->frame_count = 1;
+    fiber->frame_capacity = KVM_FIBER_FRAMES;
+    fiber->coroutine = &co->obj;
+    co->fiber = fiber;
+    enqueue(vm, fiber);
+    return KVALUE_OBJECT(co);
+}
+
+// await(coroutine) -> value | null
+static KValue native_await(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    if (!kvalue_is_object_type(argv[0], KOBJ_COROUTINE)) return KVALUE_NULL;
+    KCoroutine* co = (KCoroutine*)argv[0].as.object;
+    if (co->done) return co->failed ? KVALUE_NULL : co->result;
+    KFiber* target = co->fiber;
+    if (target == vm->fiber) return KVALUE_NULL;
+    KFiber* fiber = kvm_park(vm);
+    if (!fiber) return KVALUE_NULL;
+    fiber->next = target->waiters;
+    target->waiters = fiber;
+    return KVALUE_NULL;
+}
+
+// yield(): 让运行队列中的其他协程先执行
+static KValue native_yield(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    (void)argv;
+    KFiber* fiber = kvm_park(vm);
+    if (fiber) kvm_wake(vm, fiber, KVALUE_NULL);
+    return KVALUE_NULL;
+}
+
+const KriNative kvm_coroutine_natives[] = {
+    {"spawn", -1, native_spawn},
+    {"await", 1, native_await},
+    {"yield", 0, native_yield},
+    {NULL, 0, NULL},
+};
+
+KValue kvm_get_global(const KorelinVM* vm, size_t index) {
+    return vm->globals[index / KVM_GLOBAL_PAGE][index % KVM_GLOBAL_PAGE];
+}
+
+KValue* kvm_global_slot(KorelinVM* vm, size_t index) {
+    size_t page = index / KVM_GLOBAL_PAGE;
+    KValue** shared = vm->program->global_pages;
+    if (!vm->globals_owned) {
+        size_t page_count = vm->global_count / KVM_GLOBAL_PAGE + 1;
+        KValue** pages = malloc(page_count * sizeof(KValue*));
+        if (!pages) {
+            fprintf(stderr, "Error: malloc failed in kvm_global_slot\n");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(pages, shared, page_count * sizeof(KValue*));
+        vm->globals = pages;
+        vm->globals_owned = true;
+    }
+    if (vm->globals[page] == shared[page]) {
+        KValue* copy = malloc(KVM_GLOBAL_PAGE * sizeof(KValue));
+        if (!copy) {
+            fprintf(stderr, "Error: malloc failed in kvm_global_slot\n");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(copy, shared[page], global_page_end(vm->global_count, page) * sizeof(KValue));
+        vm->globals[page] = copy;
+    }
+    return &vm->globals[page][index % KVM_GLOBAL_PAGE];
+}
+
+void kvm_bind(KorelinVM* vm, const KProgram* program) {
+    release_globals(vm);
+    vm->program = program;
+    vm->module = program->module;
+    // 全局变量: 直接使用程序中的初始值 (原生函数是共享对象), 写入时才复制
+    vm->globals = program->global_pages;
+    vm->global_count = program->module->global_count;
+}
+
+// 辅助函数：执行已压入调用帧的顶层代码, 之后调度其余的协程
+static bool execute_main(KorelinVM* vm) {
+    KGCHeap* heap = vm->heap;
+    kgc_set_alloc_site(heap, vm->module->main->site);
+    vm->main->state = KFIBER_RUNNING;
+    vm->failures = 0;
+    bool ok = run(vm, 0);
+    fiber_stopped(vm, vm->main, ok);
+    // 主程序挂起或返回后继续调度其余的协程; 有协程因运行时错误结束时也返回 false
+    if (ok) ok = schedule(vm) && vm->failures == 0;
+    vm->stack_top = 0;
+    vm->frame_count = 0;
+    kgc_set_alloc_site(heap, NULL);
+    return ok;
+}
+
+bool kvm_execute(KorelinVM* vm) {
+    const KModule* module = vm->module;
+    KFunction* main = function_new(vm, vm->program, module->main);
+    vm->stack_top = 0;
+    vm->frame_count = 0;
+    ensure_stack(vm, module->main->max_stack + 1);
+    vm->stack[vm->stack_top++] = KVALUE_OBJECT(main);
+    push_frame(vm, main, 0);
+    return execute_main(vm);
+}
+
+bool kvm_resume(KorelinVM* vm, const KValue* stack, size_t count, size_t offset, KValue value) {
+    const KProto* main = vm->module->main;
+    vm->stack_top = 0;
+    vm->frame_count = 0;
+    ensure_stack(vm, (count > main->max_stack ? count : main->max_stack) + 1);
+    memcpy(vm->stack, stack, count * sizeof(KValue));
+    vm->stack_top = count;
+    push_frame(vm, (KFunction*)stack[0].as.object, 0);
+    vm->frames[0].ip = main->code + offset;
+    vm->stack[vm->stack_top++] = value;
+    return execute_main(vm);
+}
+
+bool kvm_run(KorelinVM* vm, const KModule* module) {
+    KProgram** owned = realloc(vm->owned, (vm->owned_count + 1) * sizeof(KProgram*));
+    if (!owned) {
+        fprintf(stderr, "Error: realloc failed in kvm_run\n");
+        exit(EXIT_FAILURE);
+    }
+    vm->owned = owned;
+    KProgram* program = kvm_program_new(module);
+    vm->owned[vm->owned_count++] = program;
+    kvm_bind(vm, program);
+    return kvm_execute(vm);
+}
+
+bool kvm_call(KorelinVM* vm, KValue callee, int argc, const KValue* argv, KValue* result) {
+    KGCHeap* heap = vm->heap;
+    size_t base = vm->stack_top;
+    size_t base_frame = vm->frame_count;
+    bool ok = true;
+    vm->nested++;
+    ensure_stack(vm, base + (size_t)argc + 1);
+    vm->stack[vm->stack_top++] = callee;
+    for (int i = 0; i < argc; i++) {
+        vm->stack[vm->stack_top++] = argv[i];
+    }
+
+    if (kvalue_is_object_type(callee, KOBJ_FUNCTION)) {
+        KFunction* target = (KFunction*)callee.as.object;
+        const KProto* proto = target->proto;
+        if (argc != proto->arity) {
+            runtime_error(vm, "%s expects %d argument(s) but got %d", proto->name, proto->arity, argc);
+            ok = false;
+        } else if (vm->frame_count >= KVM_MAX_FRAMES) {
+            runtime_error(vm, "stack overflow");
+            ok = false;
+        } else {
+            ensure_stack(vm, base + proto->max_stack + 1);
+            push_frame(vm, target, base);
+            kgc_set_alloc_site(heap, proto->site);
+            ok = run(vm, base_frame);
+            if (ok && result) *result = vm->stack[base];
+        }
+    } else if (kvalue_is_object_type(callee, KOBJ_NATIVE)) {
+        const KriNative* native = ((KNative*)callee.as.object)->native;
+        if (native->arity >= 0 && argc != native->arity) {
+            runtime_error(vm, "%s expects %d argument(s) but got %d", native->name, native->arity, argc);
+            ok = false;
+        } else {
+            for (size_t i = base + 1; i < vm->stack_top; i++) {
+                flatten_slot(heap, &vm->stack[i]);
+            }
+            KValue value = native->fn(vm, argc, &vm->stack[base + 1]);
+            if (result) *result = value;
+            ok = !vm->raised;
+            vm->raised = false;
+        }
+    } else {
+        runtime_error(vm, "cannot call a value of type %s", kvalue_type_name(callee));
+        ok = false;
+    }
+
+    // 出错时丢弃被调用者留下的调用帧
+    vm->nested--;
+    vm->frame_count = base_frame;
+    vm->stack_top = base;
+    const KFunction* caller = base_frame ? (const KFunction*)vm->frames[base_frame - 1].function : NULL;
+    kgc_set_alloc_site(heap, caller ? caller->proto->site : NULL);
+    return ok;
+}
+
+bool kvm_import(KorelinVM* vm, KValue value, KValue* out) {
+    *out = value;
+    if (value.type != KVAL_OBJECT) return true;
+    KGCObject* obj = value.as.object;
+    if (obj->flags & KGC_FLAG_COUNTED) {
+        kgc_hold(vm->heap, obj);
+        return true;
+    }
+    if (obj->flags & KGC_FLAG_SHARED) return true;
+    if (obj->type == KOBJ_FUNCTION) {
+        const KFunction* fn = (const KFunction*)obj;
+        *out = KVALUE_OBJECT(function_new(vm, fn->program, fn->proto));
+        return true;
+    }
+    *out = KVALUE_NULL;
+    return false;
+}
+
+KorelinVM* kvm_isolate(const KorelinVM* vm) {
+    // 隔离实例本身就在工作线程中并行执行, 回收时不再使用并行标记
+    KGCConfig config = vm->heap->config;
+    config.threads = 1;
+    KorelinVM* isolate = kvm_new(&config);
+    kvm_bind(isolate, vm->program);
+    isolate->isolated = true;
+    // 导入时的分配可能触发回收: 已导入的全局变量是根, 其余仍是程序中的初始值。
+    // 与初始值相同的全局变量 (未赋值的与原生函数) 不写入, 所在的页保持共享
+    for (size_t i = 0; i < vm->global_count; i++) {
+        KValue value;
+        bool imported = kvm_import(isolate, kvm_get_global(vm, i), &value);
+        KValue initial = kvm_get_global(isolate, i);
+        bool unchanged = value.type == initial.type &&
+                         (value.type == KVAL_NULL || (value.type == KVAL_OBJECT && value.as.object == initial.as.object));
+        if (!unchanged) {
+            *kvm_global_slot(isolate, i) = value;
+        }
+        if (imported) continue;
+        if (!isolate->unavailable) {
+            isolate->unavailable = calloc(vm->global_count, sizeof(const char*));
+            if (!isolate->unavailable) {
+                fprintf(stderr, "Error: calloc failed in kvm_isolate\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        isolate->unavailable[i] = kvalue_type_name(kvm_get_global(vm, i));
+    }
+    return isolate;
+}
 
 void KorelinVMMain() {
 
-}
\ No newline at end of file
+}
@@ -5,6 +5,260 @@
 #ifndef KORELIN_KVM_H
 #define KORELIN_KVM_H
 
+#include "kgc.h"
+#include "kobject.h"
+#include "kric.h"
+#include "krilib.h"
+#include <stdbool.h>
+
+// 调用帧的最大嵌套深度
+#define KVM_MAX_FRAMES 16384
+
+// 程序: 编译单元加上实例化好的常量, 创建后只读, 可以被多个线程中的虚拟机同时使用。
+//
+// 字符串 (按内容驻留)、大整数与全局变量绑定的原生函数在创建程序时实例化一次, 放在冻结
+// 的堆中 (见 kgc_freeze), 各虚拟机的堆直接引用它们。脚本函数对象带有各虚拟机自己的
+// 字段内联缓存, 在虚拟机第一次执行到函数定义时才创建。因此在程序上创建虚拟机 (隔离
+// 实例) 的开销与程序的大小无关。全局变量的初始值也由各虚拟机共享: 虚拟机通过页表
+// 访问全局变量, 绑定时直接使用程序的页表, 第一次写入时才复制页表与被写入的那一页
+// (见 kvm_global_slot)。
+#define KVM_GLOBAL_PAGE 64
+
+typedef struct KProgram {
+    const KModule* module;  // 不归程序所有
+    KGCHeap* heap;          // 冻结的常量堆
+    KValue** constants;     // 各原型的常量表, 按 KProto.index 排列; 函数常量为 null
+    KValue* globals;        // 全局变量的初始值: 绑定的原生函数, 其余为 null
+    KValue** global_pages;  // 初始值的页表, 每页 KVM_GLOBAL_PAGE 个槽位 (指向 globals)
+} KProgram;
+
+// 调用帧: 槽位以下标保存, 栈扩容后依然有效
+typedef struct KCallFrame {
+    KGCObject* function;    // 正在执行的 KFunction (GC 根, 整理时就地更新)
+    const uint8_t* ip;      // 下一条指令 (指向只读的 KProto, 不会移动)
+    size_t base;            // 槽位 0 (被调用的函数自身) 在栈中的下标
+} KCallFrame;
+
+// 协程 (green thread): 拥有独立的、按需增长的值栈与调用帧, 在同一个虚拟机中轮流执行。
+//
+//   spawn(fn, ...args) -> coroutine | null
+//                      创建执行 fn(...args) 的协程并放入运行队列, fn 必须是脚本函数
+//   await(coroutine) -> value | null
+//                      挂起直到协程结束, 返回 fn 的返回值 (协程出错时为 null)
+//   yield()            让运行队列中的其他协程先执行
+//
+// 协程只在原生函数 (await、yield、sleep、netRecv) 中挂起, 挂起时 C 栈上没有它的状态,
+// 所以只有协程直接调用的原生函数可以挂起它; 经 kvm_call 回调的脚本 (如网络处理函数)
+// 不能挂起, 其中的 await 返回 null。主程序也是一个协程, 它结束后 kvm_run 继续调度其余
+// 的协程, 直到它们全部结束或都在等待永远不会发生的事件。
+typedef enum {
+    KFIBER_RUNNABLE,        // 在运行队列中
+    KFIBER_RUNNING,
+    KFIBER_PARKED,          // 挂起, 等待 kvm_wake
+    KFIBER_DONE,
+    KFIBER_FAILED,
+} KFiberState;
+
+typedef struct KFiber {
+    KValue* stack;          // 不在执行时保存虚拟机的栈与调用帧
+    size_t stack_top;
+    size_t stack_capacity;
+    KCallFrame* frames;
+    size_t frame_count;
+    size_t frame_capacity;
+    size_t nested;
+    KGCObject* coroutine;   // KCoroutine 句柄, 主程序为 NULL
+    KFiberState state;
+    bool resumed;           // 恢复时用 resume_value 替换挂起它的原生函数的返回值
+    KValue resume_value;
+    struct KFiber* next;    // 运行队列
+    struct KFiber* waiters; // 等待它结束的协程 (以 next 链接)
+    struct KFiber* prev_live;
+    struct KFiber* next_live;
+} KFiber;
+
+// 虚拟机实例, 每个实例拥有独立的 GC 堆。不同的虚拟机可以在不同的线程中同时执行
+// (包括同一个程序), 但同一个虚拟机同时只能被一个线程使用
+typedef struct KorelinVM {
+    KGCHeap* heap;
+    const KModule* module;  // 正在执行的编译单元 (不归虚拟机所有)
+    const KProgram* program; // 正在执行的程序
+    KProgram** owned;       // kvm_run 为编译单元创建的程序, 随虚拟机释放
+    size_t owned_count;
+    KValue** globals;       // 全局变量的页表, 未写入过的页与程序共享 (只读)
+    size_t global_count;
+    bool globals_owned;     // 页表已经复制 (写入过全局变量)
+    KValue* stack;
+    size_t stack_top;
+    size_t stack_capacity;
+    KCallFrame* frames;
+    size_t frame_count;
+    size_t frame_capacity;
+    struct KNetLoop* net;   // 事件循环 (第一次使用网络函数时创建, 见 libs/knet.h)
+    KFiber* fiber;          // 正在执行的协程, 它的栈与调用帧就是上面的 stack 与 frames
+    KFiber* main;           // 主程序
+    KFiber* fibers;         // 所有未结束的协程
+    KFiber* run_head;       // 运行队列 (先进先出)
+    KFiber* run_tail;
+    size_t nested;          // 当前协程中进行中的 kvm_call 层数, 不为 0 时不能挂起
+    size_t failures;        // 因运行时错误而结束的协程数
+    bool suspending;        // 原生函数挂起了当前协程, 它返回后 run 随即退出
+    bool raised;            // 原生函数报告了运行时错误 (kvm_raise; 原生函数中 kvm_call 失败时也可以直接置位), 它返回后 run 随即以错误退出
+    bool isolated;          // 隔离实例 (kvm_isolate): 不能给全局变量赋值, 运行时错误不输出而是记录在 error 中
+    char* error;            // 隔离实例中第一个运行时错误: 信息与各调用帧, 每行一项, 末尾没有换行
+    const char** unavailable; // 隔离实例中不能导入的全局变量原来的类型名, 其余为 NULL
+} KorelinVM;
+
+/**
+ * @brief 创建一个虚拟机实例。
+ * @param config GC 配置, 为 NULL 时使用默认配置。
+ * @return 新的虚拟机, 需要调用 kvm_free 释放。
+ */
+KorelinVM* kvm_new(const KGCConfig* config);
+
+/**
+ * @brief 释放虚拟机及其堆中的所有对象。
+ * @param vm 虚拟机。
+ */
+void kvm_free(KorelinVM* vm);
+
+/**
+ * @brief 为编译单元创建程序: 实例化常量并冻结, 之后可以在任何线程中使用。
+ * @param module kric_compile 的编译结果, 必须在程序释放之前保持有效。
+ * @return 新的程序, 需要调用 kvm_program_free 释放。
+ */
+KProgram* kvm_program_new(const KModule* module);
+
+/**
+ * @brief 释放程序。使用它的虚拟机必须先被释放。
+ * @param program 程序, 可以为 NULL。
+ */
+void kvm_program_free(KProgram* program);
+
+/**
+ * @brief 把虚拟机绑定到程序: 全局变量重新初始化 (同名的原生函数按名字绑定)。
+ *        不执行任何代码, 也不复制全局变量, 开销与程序的大小无关。
+ * @param vm 虚拟机。
+ * @param program 程序, 必须在虚拟机释放之前保持有效。
+ */
+void kvm_bind(KorelinVM* vm, const KProgram* program);
+
+/**
+ * @brief 读取全局变量。
+ */
+KValue kvm_get_global(const KorelinVM* vm, size_t index);
+
+/**
+ * @brief 获取可写的全局变量槽位: 所在的页仍与程序共享时先复制这一页。
+ *        返回的地址在下一次调用 kvm_bind 或释放虚拟机之前有效。
+ */
+KValue* kvm_global_slot(KorelinVM* vm, size_t index);
+
+/**
+ * @brief 执行已绑定的程序的顶层代码 (不重新初始化全局变量)。
+ * @param vm 已经调用过 kvm_bind 的虚拟机。
+ * @return 执行成功返回 true; 运行时错误会连同调用栈输出到 stderr 并返回 false。
+ */
+bool kvm_execute(KorelinVM* vm);
+
+/**
+ * @brief 执行编译单元的顶层代码: 为它创建程序 (随虚拟机释放), 绑定并执行。
+ *        module 必须在虚拟机释放之前保持有效。
+ * @param vm 虚拟机。
+ * @param module kric_compile 的编译结果。
+ * @return 执行成功返回 true; 运行时错误会连同调用栈输出到 stderr 并返回 false。
+ */
+bool kvm_run(KorelinVM* vm, const KModule* module);
+
+/**
+ * @brief 调用脚本函数或原生函数, 可以在原生函数中回调脚本 (如事件处理函数)。
+ *        调用期间虚拟机的栈可能扩容、对象可能被整理移动: 调用者不能再使用原生函数的
+ *        argv 或未登记为句柄的对象指针, 需要的参数应在调用前复制出来。
+ * @param vm 虚拟机, 必须已经执行过 kvm_run (全局变量已绑定)。
+ * @param callee 被调用的函数。
+ * @param argc 参数个数。
+ * @param argv 参数, 不能指向虚拟机的栈。
+ * @param result 写入返回值, 可以为 NULL。
+ * @return 成功返回 true; 运行时错误已连同调用栈输出到 stderr 时返回 false。
+ */
+bool kvm_call(KorelinVM* vm, KValue callee, int argc, const KValue* argv, KValue* result);
+
+/**
+ * @brief 在原生函数中报告运行时错误: 与脚本中的错误一样连同调用栈输出 (隔离实例中记录在
+ *        vm->error), 原生函数返回后调用它的脚本随即以这个错误结束, 返回值被忽略。
+ *        隔离实例记录的错误可以用 "%s" 原样报告, 其中的调用帧位于 vm 的调用栈之上。
+ * @param vm 正在执行原生函数的虚拟机。
+ * @param format 错误信息, printf 格式。
+ */
+void kvm_raise(KorelinVM* vm, const char* format, ...);
+
+/**
+ * @brief 把 vm 之外的值导入 vm, 用于在隔离实例中执行其他虚拟机的函数 (见 kvm_isolate)。
+ *        标量与共享对象 (原生函数、程序中的常量、冻结的值) 原样使用, 脚本函数按同一原型
+ *        在 vm 中重新创建, 其他对象不能导入。
+ * @param vm 导入到的虚拟机。
+ * @param value 另一个虚拟机中的值, 那个虚拟机在导入期间不能执行。
+ * @param out 写入导入的值。
+ * @return 不能导入时返回 false。
+ */
+bool kvm_import(KorelinVM* vm, KValue value, KValue* out);
+
+/**
+ * @brief 创建与 vm 执行同一程序的隔离实例, 全局变量逐个经 kvm_import 从 vm 复制, 不执行
+ *        任何代码。用于在其他线程中执行 vm 的脚本函数 (见 libs/kparallel.h)。可以在多个
+ *        线程中同时为同一个 vm 创建, vm 在此期间不能执行。
+ *        隔离实例中读取不能导入的全局变量、给任何全局变量赋值都是运行时错误, 不会静默地
+ *        读到 null 或丢失写入; 运行时错误不输出, 记录在 error 中由调用者报告 (见 kvm_raise)。
+ * @return 新的虚拟机, 需要调用 kvm_free 释放。
+ */
+KorelinVM* kvm_isolate(const KorelinVM* vm);
+
+/**
+ * @brief 为已绑定程序中的原型创建脚本函数对象, 与执行到函数定义时创建的相同。
+ */
+KFunction* kvm_function_new(KorelinVM* vm, const KProto* proto);
+
+/**
+ * @brief 设置函数对象的第 index 个常量 (函数常量) 对应的嵌套函数对象, 用于恢复镜像 (见 kimage.h)。
+ */
+void kvm_function_set_nested(KorelinVM* vm, KFunction* fn, size_t index, KFunction* nested);
+
+/**
+ * @brief 从暂停处继续执行已绑定程序的顶层代码 (用于恢复镜像, 见 kimage.h), 之后与 kvm_execute 相同。
+ * @param stack 暂停时的栈, 槽位 0 是顶层代码的函数对象; 其中的对象没有登记为根,
+ *              调用者必须保证在调用之前不发生回收。
+ * @param count 栈中的值的个数。
+ * @param offset 下一条指令在顶层代码中的偏移。
+ * @param value 压入栈顶, 作为暂停处的原生函数调用的返回值。
+ * @return 与 kvm_execute 相同。
+ */
+bool kvm_resume(KorelinVM* vm, const KValue* stack, size_t count, size_t offset, KValue value);
+
+/**
+ * @brief 挂起当前协程: 调用它的原生函数返回后协程停止执行, 直到 kvm_wake。
+ * @param vm 虚拟机。
+ * @return 被挂起的协程; 当前协程不能挂起 (在 kvm_call 的回调中) 时返回 NULL。
+ */
+KFiber* kvm_park(KorelinVM* vm);
+
+/**
+ * @brief 把挂起的协程放回运行队列。
+ * @param vm 虚拟机。
+ * @param fiber kvm_park 返回的协程。
+ * @param value 恢复后作为挂起它的原生函数的返回值。
+ */
+void kvm_wake(KorelinVM* vm, KFiber* fiber, KValue value);
+
+/**
+ * @brief 运行一轮运行队列: 调用时已在队列中的协程各执行到下一次挂起或结束。
+ *        原生函数 (如 netRun) 可以在等待事件的间隙调用它。
+ * @param vm 虚拟机。
+ * @return 主程序因运行时错误而结束时返回 false。
+ */
+bool kvm_run_fibers(KorelinVM* vm);
+
+extern const KriNative kvm_coroutine_natives[];
+
 void KorelinVMMain();
 
-#endif //KORELIN_KVM_H
\ No newline at end of file
+#endif //KORELIN_KVM_H
@@ -0,0 +1,137 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#include "kwheel.h"
+#include <stddef.h>
+
+#define KWHEEL_EXPIRED UINT32_MAX
+// 最高层能表示的最大距离, 更远的定时器先按这个距离放置
+#define KWHEEL_MAX_DELTA ((1ull << (KWHEEL_BITS * KWHEEL_LEVELS)) - 1)
+
+static KTimer* slot_head(KWheel* wheel, uint32_t slot) {
+    return &wheel->slots[slot / KWHEEL_SLOTS][slot % KWHEEL_SLOTS];
+}
+
+// 辅助函数：把节点接到链表尾部
+static void list_append(KTimer* list, KTimer* timer) {
+    timer->prev = list->prev;
+    timer->next = list;
+    list->prev->next = timer;
+    list->prev = timer;
+}
+
+// 辅助函数：按到期时间与当前刻度的距离选择层与槽; expires 不早于 wheel->now
+static void place(KWheel* wheel, KTimer* timer) {
+    uint64_t delta = timer->expires - wheel->now;
+    if (delta > KWHEEL_MAX_DELTA) delta = KWHEEL_MAX_DELTA;
+    uint64_t at = wheel->now + delta;
+    int level = 0;
+    while (level < KWHEEL_LEVELS - 1 && delta >= (1ull << (KWHEEL_BITS * (level + 1)))) level++;
+    uint32_t index = (uint32_t)(at >> (KWHEEL_BITS * level)) & (KWHEEL_SLOTS - 1);
+    timer->slot = (uint32_t)level * KWHEEL_SLOTS + index;
+    list_append(&wheel->slots[level][index], timer);
+    wheel->occupied[level][index / 64] |= 1ull << (index % 64);
+}
+
+void kwheel_init(KWheel* wheel, uint64_t now) {
+    wheel->now = now;
+    for (int level = 0; level < KWHEEL_LEVELS; level++) {
+        for (int i = 0; i < KWHEEL_SLOTS; i++) kwheel_list_init(&wheel->slots[level][i]);
+        for (int i = 0; i < KWHEEL_SLOTS / 64; i++) wheel->occupied[level][i] = 0;
+    }
+}
+
+void kwheel_list_init(KTimer* list) {
+    list->next = list;
+    list->prev = list;
+    list->slot = KWHEEL_EXPIRED;
+}
+
+void kwheel_add(KWheel* wheel, KTimer* timer, uint64_t expires) {
+    timer->expires = expires > wheel->now ? expires : wheel->now + 1;
+    place(wheel, timer);
+}
+
+void kwheel_remove(KWheel* wheel, KTimer* timer) {
+    if (!timer->next) return;
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    if (timer->slot != KWHEEL_EXPIRED) {
+        KTimer* head = slot_head(wheel, timer->slot);
+        if (head->next == head) {
+            uint32_t index = timer->slot % KWHEEL_SLOTS;
+            wheel->occupied[timer->slot / KWHEEL_SLOTS][index / 64] &= ~(1ull << (index % 64));
+        }
+    }
+    timer->next = NULL;
+    timer->prev = NULL;
+}
+
+// 辅助函数：从 start 开始循环查找位图中下一个置位的槽, 返回距 start 的偏移; 没有时返回 -1
+static int find_next(const uint64_t* bits, uint32_t start) {
+    for (uint32_t n = 0; n <= KWHEEL_SLOTS / 64; n++) {
+        uint32_t word = ((start / 64) + n) % (KWHEEL_SLOTS / 64);
+        uint64_t mask = bits[word];
+        uint32_t shift = start % 64;
+        // 起点所在的字先查起点之后的位, 绕回一圈后再查起点之前的位
+        if (n == 0) mask &= ~0ull << shift;
+        if (n == KWHEEL_SLOTS / 64) mask = shift == 0 ? 0 : mask & ((1ull << shift) - 1);
+        if (mask) {
+            uint32_t index = word * 64 + (uint32_t)__builtin_ctzll(mask);
+            return (int)((index - start) & (KWHEEL_SLOTS - 1));
+        }
+    }
+    return -1;
+}
+
+bool kwheel_next(const KWheel* wheel, uint64_t* tick) {
+    bool found = false;
+    for (int level = 0; level < KWHEEL_LEVELS; level++) {
+        // 第 level 层当前的槽已经处理过, 从下一个槽开始找
+        uint64_t base = wheel->now >> (KWHEEL_BITS * level);
+        int offset = find_next(wheel->occupied[level], (uint32_t)(base + 1) & (KWHEEL_SLOTS - 1));
+        if (offset < 0) continue;
+        uint64_t at = (base + 1 + (uint64_t)offset) << (KWHEEL_BITS * level);
+        if (!found || at < *tick) *tick = at;
+        found = true;
+    }
+    return found;
+}
+
+// 辅助函数：把第 level 层的一个槽中的定时器重新放到更低的层
+static void cascade(KWheel* wheel, int level, uint32_t index) {
+    KTimer* head = &wheel->slots[level][index];
+    KTimer* timer = head->next;
+    kwheel_list_init(head);
+    wheel->occupied[level][index / 64] &= ~(1ull << (index % 64));
+    while (timer != head) {
+        KTimer* next = timer->next;
+        place(wheel, timer);
+        timer = next;
+    }
+}
+
+void kwheel_advance(KWheel* wheel, uint64_t target, KTimer* expired) {
+    uint64_t tick;
+    while (kwheel_next(wheel, &tick) && tick <= target) {
+        wheel->now = tick;
+        // 从高层到低层级联起点恰好是 tick 的槽
+        for (int level = KWHEEL_LEVELS - 1; level > 0; level--) {
+            if (tick & ((1ull << (KWHEEL_BITS * level)) - 1)) continue;
+            cascade(wheel, level, (uint32_t)(tick >> (KWHEEL_BITS * level)) & (KWHEEL_SLOTS - 1));
+        }
+        // 第 0 层当前槽中的定时器都恰好在 tick 到期
+        uint32_t index = (uint32_t)tick & (KWHEEL_SLOTS - 1);
+        KTimer* head = &wheel->slots[0][index];
+        while (head->next != head) {
+            KTimer* timer = head->next;
+            head->next = timer->next;
+            timer->next->prev = head;
+            timer->slot = KWHEEL_EXPIRED;
+            list_append(expired, timer);
+        }
+        wheel->occupied[0][index / 64] &= ~(1ull << (index % 64));
+    }
+    if (target > wheel->now) wheel->now = target;
+}
@@ -0,0 +1,78 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#ifndef KORELIN_KWHEEL_H
+#define KORELIN_KWHEEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// =============================================================================
+// 分层时间轮
+//
+// 时间以整数刻度表示 (knet 中 1 刻度为 1 毫秒)。共 KWHEEL_LEVELS 层, 每层 KWHEEL_SLOTS 个
+// 槽: 第 0 层的每个槽对应 1 个刻度, 第 l 层的每个槽对应 256^l 个刻度。到期时间距当前
+// 不足 256^(l+1) 个刻度的定时器放在第 l 层 (最远约 49.7 天, 更远的先放在最高层, 到时再
+// 重新放置)。时间推进到第 l 层槽的起点时, 该槽的定时器被重新放到更低的层 (级联), 最终在
+// 第 0 层的槽中到期。
+//
+// 定时器是嵌入在调用者结构体中的链表节点, 插入与取消都是 O(1)。每层用 256 位的位图记录
+// 非空的槽, 推进时直接跳到下一个非空槽, 空闲期间不必逐刻度扫描。
+// =============================================================================
+
+#define KWHEEL_LEVELS 4
+#define KWHEEL_BITS 8
+#define KWHEEL_SLOTS (1 << KWHEEL_BITS)
+
+// 定时器节点; 不在任何链表中时 next 为 NULL
+typedef struct KTimer {
+    struct KTimer* next;
+    struct KTimer* prev;
+    uint64_t expires;       // 到期的刻度
+    uint32_t slot;          // 所在的槽 (层 * KWHEEL_SLOTS + 槽), 在到期链表中时为 UINT32_MAX
+} KTimer;
+
+typedef struct KWheel {
+    uint64_t now;           // 已处理到的刻度, 到期时间不晚于它的定时器都已到期
+    KTimer slots[KWHEEL_LEVELS][KWHEEL_SLOTS];          // 各槽的哨兵节点 (双向循环链表)
+    uint64_t occupied[KWHEEL_LEVELS][KWHEEL_SLOTS / 64]; // 非空槽的位图
+} KWheel;
+
+// --- 函数声明 ---
+
+/**
+ * @brief 初始化时间轮, 当前刻度为 now。
+ */
+void kwheel_init(KWheel* wheel, uint64_t now);
+
+/**
+ * @brief 初始化到期链表 (带哨兵的双向循环链表)。
+ */
+void kwheel_list_init(KTimer* list);
+
+/**
+ * @brief 插入定时器; 不晚于当前刻度的到期时间按下一个刻度处理。定时器不能已在链表中。
+ */
+void kwheel_add(KWheel* wheel, KTimer* timer, uint64_t expires);
+
+/**
+ * @brief 从时间轮或到期链表中取下定时器; 不在链表中时什么也不做。
+ */
+void kwheel_remove(KWheel* wheel, KTimer* timer);
+
+/**
+ * @brief 下一个需要推进时间轮的刻度 (定时器到期或级联)。
+ * @return 时间轮为空时返回 false。
+ */
+bool kwheel_next(const KWheel* wheel, uint64_t* tick);
+
+/**
+ * @brief 把时间轮推进到 target, 到期的定时器按到期时间的顺序追加到 expired 链表。
+ *
+ * 调用者依次取出并处理 expired 中的定时器; 处理期间可以插入或取消任何定时器, 包括仍在
+ * expired 中的定时器。
+ */
+void kwheel_advance(KWheel* wheel, uint64_t target, KTimer* expired);
+
+#endif //KORELIN_KWHEEL_H
@@ -0,0 +1,482 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#include "karray.h"
+#include "../kbigint.h"
+#include "../ksimd.h"
+#include "../kvm.h"
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+// 辅助函数：取出数组参数, 不是数组时返回 NULL
+static KArray* as_array(KValue value) {
+    return kvalue_is_array(value) ? (KArray*)value.as.object : NULL;
+}
+
+// 辅助函数：数值转换为 double, 大整数取最接近的 double; 不是数值时返回 false
+static bool to_number(KValue value, double* out) {
+    if (value.type == KVAL_INT) {
+        *out = (double)value.as.integer;
+        return true;
+    }
+    if (value.type == KVAL_DOUBLE) {
+        *out = value.as.number;
+        return true;
+    }
+    if (kvalue_is_object_type(value, KOBJ_BIGINT)) {
+        *out = kbigint_to_double((const KBigInt*)value.as.object);
+        return true;
+    }
+    return false;
+}
+
+// 辅助函数：数值的二元运算, 规则与 VM 的 + 和 * 相同 (整数溢出时转为大整数, 有 double 时为 double),
+// 操作数不是数值时返回 false。a 与 b 在计算期间必须可达
+static bool arith(KGCHeap* heap, KSimdOp op, KValue a, KValue b, KValue* out) {
+    if (a.type == KVAL_INT && b.type == KVAL_INT) {
+        long long result;
+        bool overflow = op == KSIMD_ADD ? __builtin_add_overflow(a.as.integer, b.as.integer, &result)
+                                        : __builtin_mul_overflow(a.as.integer, b.as.integer, &result);
+        if (!overflow) {
+            *out = KVALUE_INT(result);
+            return true;
+        }
+    }
+    if (kvalue_is_integer(a) && kvalue_is_integer(b)) {
+        *out = op == KSIMD_ADD ? kbigint_add(heap, a, b) : kbigint_mul(heap, a, b);
+        return true;
+    }
+    double x, y;
+    if (!to_number(a, &x) || !to_number(b, &y)) return false;
+    *out = KVALUE_DOUBLE(op == KSIMD_ADD ? x + y : x * y);
+    return true;
+}
+
+// 辅助函数：*total += value。*total 为大整数时作为临时根保持可达, 调用者结束时用 release_total 弹出
+static bool accumulate(KGCHeap* heap, KValue* total, KValue value) {
+    KValue next;
+    if (!arith(heap, KSIMD_ADD, *total, value, &next)) return false;
+    if (total->type == KVAL_OBJECT) kgc_pop_roots(heap, 1);
+    if (next.type == KVAL_OBJECT) kgc_push_root(heap, next.as.object);
+    *total = next;
+    return true;
+}
+
+static void release_total(KGCHeap* heap, KValue total) {
+    if (total.type == KVAL_OBJECT) kgc_pop_roots(heap, 1);
+}
+
+// 辅助函数：x 与 y (两个绝对值上界) 相加或相乘后是否仍在 int64 范围内
+static bool fits_int64(KSimdOp op, uint64_t x, uint64_t y) {
+    uint64_t result;
+    bool overflow = op == KSIMD_ADD ? __builtin_add_overflow(x, y, &result) : __builtin_mul_overflow(x, y, &result);
+    return !overflow && result <= INT64_MAX;
+}
+
+// 辅助函数：整数 x 的绝对值
+static uint64_t magnitude_of(int64_t x) {
+    return x < 0 ? (uint64_t)0 - (uint64_t)x : (uint64_t)x;
+}
+
+// 辅助函数：扫描一遍 (向量化的 min/max) 求整数元素的最大绝对值
+static uint64_t scan_magnitude(const KArray* array) {
+    if (array->count == 0) return 0;
+    KSimdScalar min, max;
+    ksimd_min_max(array->kind, array->items.data, array->count, &min, &max);
+    uint64_t low = magnitude_of(min.i64);
+    uint64_t high = magnitude_of(max.i64);
+    return low > high ? low : high;
+}
+
+// 辅助函数：整数元素数组中元素绝对值的上界; 窄类型取类型的范围, int64 元素需要扫描一遍
+static uint64_t magnitude(const KArray* array) {
+    switch (array->kind) {
+        case KELEM_INT32: return (uint64_t)1 << 31;
+        case KELEM_UINT8: return UINT8_MAX;
+        default: return scan_magnitude(array);
+    }
+}
+
+// 辅助函数：两个数组的元素绝对值上界为 x 与 y 时, count 个乘积之和是否一定不会溢出
+static bool dot_fits(uint64_t x, uint64_t y, size_t count) {
+    return fits_int64(KSIMD_MUL, x, y) && fits_int64(KSIMD_MUL, x * y, count);
+}
+
+// 辅助函数：比较两个数值, NaN 与 NaN 相等且大于其他数值; 不是数值时返回 false
+static bool number_order(KValue a, KValue b, int* order) {
+    if (a.type == KVAL_INT && b.type == KVAL_INT) {
+        *order = (a.as.integer > b.as.integer) - (a.as.integer < b.as.integer);
+        return true;
+    }
+    if ((a.type != KVAL_INT && a.type != KVAL_DOUBLE) || (b.type != KVAL_INT && b.type != KVAL_DOUBLE)) return false;
+    double x = a.type == KVAL_INT ? (double)a.as.integer : a.as.number;
+    double y = b.type == KVAL_INT ? (double)b.as.integer : b.as.number;
+    if (x != x || y != y) {
+        *order = (x != x) - (y != y);
+    } else {
+        *order = (x > y) - (x < y);
+    }
+    return true;
+}
+
+// 单个原始元素
+typedef union RawElement {
+    int64_t i64;
+    double f64;
+    int32_t i32;
+    uint8_t u8;
+} RawElement;
+
+// 辅助函数：把数值转换为 kind 类型的元素, 用于广播运算; 转换会改变运算结果的类型时返回 false
+static bool raw_element(KElementKind kind, KValue value, RawElement* out) {
+    if (kind == KELEM_FLOAT64) {
+        if (value.type == KVAL_DOUBLE) {
+            out->f64 = value.as.number;
+            return true;
+        }
+        if (value.type != KVAL_INT) return false;
+        out->f64 = (double)value.as.integer;
+        return true;
+    }
+    if (value.type != KVAL_INT) return false;
+    switch (kind) {
+        case KELEM_INT64: out->i64 = value.as.integer; return true;
+        case KELEM_INT32: out->i32 = (int32_t)(uint32_t)value.as.integer; return true;
+        case KELEM_UINT8: out->u8 = (uint8_t)value.as.integer; return true;
+        default: return false;
+    }
+}
+
+// 辅助函数：把 ksimd 的归约结果装箱
+static KValue box_scalar(KElementKind kind, KSimdScalar value) {
+    return kind == KELEM_FLOAT64 ? KVALUE_DOUBLE(value.f64) : KVALUE_INT(value.i64);
+}
+
+// 辅助函数：第 i 个元素的地址 (原始数值形式)
+static unsigned char* element_at(const KArray* array, size_t index) {
+    return (unsigned char*)array->items.data + index * kelement_size(array->kind);
+}
+
+// =============================================================================
+// 类型数组的构造
+// =============================================================================
+
+// 辅助函数：x 为长度时创建全 0 的类型数组, x 为数组时逐个元素转换
+static KValue typed_array_from(KorelinVM* vm, KElementKind kind, KValue x) {
+    if (x.type == KVAL_INT) {
+        if (x.as.integer < 0 || (unsigned long long)x.as.integer > SIZE_MAX / 2 / sizeof(KValue)) return KVALUE_NULL;
+        return KVALUE_OBJECT(ktyped_array_new(vm->heap, kind, (size_t)x.as.integer));
+    }
+    KArray* source = as_array(x);
+    if (!source) return KVALUE_NULL;
+
+    KArray* array = ktyped_array_new(vm->heap, kind, source->count);
+    if (source->kind == kind) {
+        memcpy(array->items.data, source->items.data, source->count * kelement_size(kind));
+        return KVALUE_OBJECT(array);
+    }
+    for (size_t i = 0; i < source->count; i++) {
+        if (!karray_set(vm->heap, array, i, karray_get(source, i))) return KVALUE_NULL;
+    }
+    return KVALUE_OBJECT(array);
+}
+
+// Int32Array(x) / Int64Array(x) / Float64Array(x) / Uint8Array(x)
+static KValue native_int32_array(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    return typed_array_from(vm, KELEM_INT32, argv[0]);
+}
+
+static KValue native_int64_array(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    return typed_array_from(vm, KELEM_INT64, argv[0]);
+}
+
+static KValue native_float64_array(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    return typed_array_from(vm, KELEM_FLOAT64, argv[0]);
+}
+
+static KValue native_uint8_array(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    return typed_array_from(vm, KELEM_UINT8, argv[0]);
+}
+
+// =============================================================================
+// 填充与复制
+// =============================================================================
+
+// fill(a, v) -> a, v 无法存入 a 时返回 null
+static KValue native_fill(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    KArray* array = as_array(argv[0]);
+    if (!array) return KVALUE_NULL;
+    if (array->count == 0) return argv[0];
+
+    // 先写入第一个元素: 由 karray_set 完成类型检查与存储形式的转换
+    if (!karray_set(vm->heap, array, 0, argv[1])) return KVALUE_NULL;
+    if (array->kind != KELEM_VALUE) {
+        RawElement first;
+        memcpy(&first, array->items.data, kelement_size(array->kind));
+        ksimd_fill(array->kind, array->items.data, &first, array->count);
+    } else {
+        for (size_t i = 1; i < array->count; i++) {
+            karray_set(vm->heap, array, i, argv[1]);
+        }
+    }
+    return argv[0];
+}
+
+// 辅助函数：读取非负整数参数
+static bool size_arg(KValue value, size_t* out) {
+    if (value.type != KVAL_INT || value.as.integer < 0) return false;
+    *out = (size_t)value.as.integer;
+    return true;
+}
+
+// arrayCopy(dst, dstIndex, src, srcIndex, count) -> bool
+// 元素无法存入类型数组时返回 false, 此时之前的元素已经复制
+static KValue native_array_copy(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    KArray* dst = as_array(argv[0]);
+    KArray* src = as_array(argv[2]);
+    size_t dst_index, src_index, count;
+    if (!dst || !src || !size_arg(argv[1], &dst_index) || !size_arg(argv[3], &src_index) ||
+        !size_arg(argv[4], &count)) {
+        return KVALUE_BOOL(false);
+    }
+    if (dst->obj.flags & KGC_FLAG_SHARED) return KVALUE_BOOL(false);
+    if (dst_index > dst->count || count > dst->count - dst_index || src_index > src->count ||
+        count > src->count - src_index) {
+        return KVALUE_BOOL(false);
+    }
+
+    if (dst->kind == src->kind) {
+        // 同一数组的区间可能重叠, 按内存块整体移动
+        size_t size = kelement_size(dst->kind);
+        memmove(element_at(dst, dst_index), element_at(src, src_index), count * size);
+        if (dst->kind == KELEM_VALUE) {
+            for (size_t i = 0; i < count; i++) {
+                kvalue_write_barrier(vm->heap, &dst->obj, dst->items.values[dst_index + i]);
+            }
+        }
+        return KVALUE_BOOL(true);
+    }
+    // 存储形式不同时两者一定是不同的数组, 不会重叠
+    for (size_t i = 0; i < count; i++) {
+        if (!karray_set(vm->heap, dst, dst_index + i, karray_get(src, src_index + i))) return KVALUE_BOOL(false);
+    }
+    return KVALUE_BOOL(true);
+}
+
+// =============================================================================
+// 归约
+// =============================================================================
+
+// 辅助函数：逐个元素求和, 有非数值时返回 null
+static KValue sum_values(KGCHeap* heap, const KArray* array) {
+    KValue total = KVALUE_INT(0);
+    for (size_t i = 0; i < array->count; i++) {
+        if (!accumulate(heap, &total, karray_get(array, i))) {
+            release_total(heap, total);
+            return KVALUE_NULL;
+        }
+    }
+    release_total(heap, total);
+    return total;
+}
+
+// sum(a) -> int | double, 整数之和超出 int64 时为大整数
+static KValue native_sum(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    KArray* array = as_array(argv[0]);
+    if (!array) return KVALUE_NULL;
+    // 整数元素只在和一定不会溢出时使用向量化内核
+    if (array->kind == KELEM_FLOAT64 ||
+        (array->kind != KELEM_VALUE && fits_int64(KSIMD_MUL, magnitude(array), array->count))) {
+        return box_scalar(array->kind, ksimd_sum(array->kind, array->items.data, array->count));
+    }
+    return sum_values(vm->heap, array);
+}
+
+// 辅助函数：逐个比较求最值, 忽略 NaN (全为 NaN 时返回 NaN), 有非数值时返回 null
+static KValue pick_extreme(const KValue* values, size_t count, bool want_max) {
+    KValue best = KVALUE_NULL;
+    bool saw_nan = false;
+    for (size_t i = 0; i < count; i++) {
+        KValue value = values[i];
+        int order;
+        if (value.type == KVAL_DOUBLE && value.as.number != value.as.number) {
+            saw_nan = true;
+            continue;
+        }
+        if (best.type == KVAL_NULL) {
+            if (value.type != KVAL_INT && value.type != KVAL_DOUBLE) return KVALUE_NULL;
+            best = value;
+            continue;
+        }
+        if (!number_order(value, best, &order)) return KVALUE_NULL;
+        if (want_max ? order > 0 : order < 0) best = value;
+    }
+    if (best.type == KVAL_NULL && saw_nan) return KVALUE_DOUBLE(NAN);
+    return best;
+}
+
+// 辅助函数：min/max 的共同实现, 单个数组参数时求数组的最值
+static KValue min_max(int argc, const KValue* argv, bool want_max) {
+    KArray* array = argc == 1 ? as_array(argv[0]) : NULL;
+    if (!array) return pick_extreme(argv, (size_t)argc, want_max);
+    if (array->count == 0) return KVALUE_NULL;
+    if (array->kind == KELEM_VALUE) return pick_extreme(array->items.values, array->count, want_max);
+
+    KSimdScalar min, max;
+    ksimd_min_max(array->kind, array->items.data, array->count, &min, &max);
+    return box_scalar(array->kind, want_max ? max : min);
+}
+
+// min(a) / min(x, y, ...)
+static KValue native_min(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)vm;
+    return min_max(argc, argv, false);
+}
+
+// max(a) / max(x, y, ...)
+static KValue native_max(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)vm;
+    return min_max(argc, argv, true);
+}
+
+// dot(a, b) -> int | double, 整数结果超出 int64 时为大整数
+static KValue native_dot(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    KArray* a = as_array(argv[0]);
+    KArray* b = as_array(argv[1]);
+    if (!a || !b || a->count != b->count) return KVALUE_NULL;
+    if (a->kind == b->kind && a->kind != KELEM_VALUE) {
+        // 整数元素只在点积一定不会溢出时使用向量化内核
+        bool fits = a->kind == KELEM_FLOAT64;
+        if (!fits) fits = dot_fits(magnitude(a), magnitude(b), a->count);
+        // int32 的类型范围对较长的数组太宽, 再按实际的最大绝对值检查一次
+        if (!fits && a->kind == KELEM_INT32) fits = dot_fits(scan_magnitude(a), scan_magnitude(b), a->count);
+        if (fits) return box_scalar(a->kind, ksimd_dot(a->kind, a->items.data, b->items.data, a->count));
+    }
+    // total 与 product 为大整数时作为临时根保持可达
+    KValue total = KVALUE_INT(0);
+    for (size_t i = 0; i < a->count; i++) {
+        KValue product, next;
+        if (!arith(vm->heap, KSIMD_MUL, karray_get(a, i), karray_get(b, i), &product)) {
+            release_total(vm->heap, total);
+            return KVALUE_NULL;
+        }
+        if (product.type == KVAL_OBJECT) kgc_push_root(vm->heap, product.as.object);
+        arith(vm->heap, KSIMD_ADD, total, product, &next);
+        kgc_pop_roots(vm->heap, (size_t)(total.type == KVAL_OBJECT) + (size_t)(product.type == KVAL_OBJECT));
+        if (next.type == KVAL_OBJECT) kgc_push_root(vm->heap, next.as.object);
+        total = next;
+    }
+    release_total(vm->heap, total);
+    return total;
+}
+
+// 辅助函数：普通数组的整数元素逐个运算是否一定不会溢出; 类型数组按元素宽度回绕, 不需要检查
+static bool elementwise_fits(KSimdOp op, const KArray* a, const KArray* b, const RawElement* scalar) {
+    if (a->kind == KELEM_FLOAT64 || a->obj.type == KOBJ_TYPED_ARRAY) return true;
+    return fits_int64(op, magnitude(a), b ? magnitude(b) : magnitude_of(scalar->i64));
+}
+
+// 辅助函数：add/mul 的共同实现。结果与 a 的存储形式相同; 无法向量化或普通数组的整数结果可能溢出时
+// 逐个运算 (溢出的元素为大整数), 结果为普通数组
+static KValue elementwise(KorelinVM* vm, KSimdOp op, KValue left, KValue right) {
+    KArray* a = as_array(left);
+    KArray* b = as_array(right);
+    if (!a || (b && b->count != a->count)) return KVALUE_NULL;
+
+    if (a->kind != KELEM_VALUE) {
+        RawElement scalar;
+        if (b && b->kind == a->kind && elementwise_fits(op, a, b, NULL)) {
+            KArray* result = karray_new_like(vm->heap, a, a->count);
+            ksimd_map(op, a->kind, result->items.data, a->items.data, b->items.data, false, a->count);
+            return KVALUE_OBJECT(result);
+        }
+        if (!b && raw_element(a->kind, right, &scalar) && elementwise_fits(op, a, NULL, &scalar)) {
+            KArray* result = karray_new_like(vm->heap, a, a->count);
+            ksimd_map(op, a->kind, result->items.data, a->items.data, &scalar, true, a->count);
+            return KVALUE_OBJECT(result);
+        }
+    }
+
+    // 运算可能创建大整数, 结果数组作为临时根; 新的元素在下一次运算之前已经写入结果数组
+    KArray* result = karray_new(vm->heap, a->count);
+    kgc_push_root(vm->heap, &result->obj);
+    for (size_t i = 0; i < a->count; i++) {
+        KValue value;
+        if (!arith(vm->heap, op, karray_get(a, i), b ? karray_get(b, i) : right, &value)) {
+            kgc_pop_roots(vm->heap, 1);
+            return KVALUE_NULL;
+        }
+        karray_push(vm->heap, result, value);
+    }
+    kgc_pop_roots(vm->heap, 1);
+    return KVALUE_OBJECT(result);
+}
+
+// add(a, b) -> array
+static KValue native_add(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    return elementwise(vm, KSIMD_ADD, argv[0], argv[1]);
+}
+
+// mul(a, b) -> array
+static KValue native_mul(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    return elementwise(vm, KSIMD_MUL, argv[0], argv[1]);
+}
+
+// compare(a, b) -> -1 | 0 | 1
+static KValue native_compare(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)vm;
+    (void)argc;
+    KArray* a = as_array(argv[0]);
+    KArray* b = as_array(argv[1]);
+    if (!a || !b) return KVALUE_NULL;
+    size_t count = a->count < b->count ? a->count : b->count;
+    int order = 0;
+
+    if (a->kind == b->kind && a->kind != KELEM_VALUE) {
+        // 按字节跳过相同的前缀; 字节不同但数值相等 (0.0 与 -0.0, 不同的 NaN) 时继续向后查找
+        size_t size = kelement_size(a->kind);
+        size_t start = 0;
+        while (start < count) {
+            size_t i = start + ksimd_mismatch(element_at(a, start), element_at(b, start), (count - start) * size) / size;
+            if (i >= count) break;
+            number_order(karray_get(a, i), karray_get(b, i), &order);
+            if (order) return KVALUE_INT(order);
+            start = i + 1;
+        }
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            if (!number_order(karray_get(a, i), karray_get(b, i), &order)) return KVALUE_NULL;
+            if (order) return KVALUE_INT(order);
+        }
+    }
+    return KVALUE_INT((a->count > b->count) - (a->count < b->count));
+}
+
+const KriNative kri_array_natives[] = {
+    {"Int32Array", 1, native_int32_array},
+    {"Int64Array", 1, native_int64_array},
+    {"Float64Array", 1, native_float64_array},
+    {"Uint8Array", 1, native_uint8_array},
+    {"fill", 2, native_fill},
+    {"arrayCopy", 5, native_array_copy},
+    {"sum", 1, native_sum},
+    {"min", -1, native_min},
+    {"max", -1, native_max},
+    {"dot", 2, native_dot},
+    {"add", 2, native_add},
+    {"mul", 2, native_mul},
+    {"compare", 2, native_compare},
+    {NULL, 0, NULL},
+};
@@ -0,0 +1,33 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#ifndef KORELIN_KARRAY_H
+#define KORELIN_KARRAY_H
+
+#include "../krilib.h"
+
+// =============================================================================
+// 数组批量运算原生函数:
+//   Int32Array(x)      创建 int32 类型数组: x 为长度时元素为 0, x 为数组时逐个转换
+//   Int64Array(x)      同上, 元素为 int64
+//   Float64Array(x)    同上, 元素为 double
+//   Uint8Array(x)      同上, 元素为 uint8
+//   fill(a, v)         把 a 的所有元素设为 v, 返回 a
+//   arrayCopy(dst, di, src, si, n)  把 src[si, si+n) 复制到 dst[di, di+n), 区间可以重叠
+//   sum(a)             元素之和
+//   min(a) / max(a)    最小 / 最大元素, 空数组返回 null; 多个参数时返回参数中的最值
+//   dot(a, b)          点积, 两个数组长度必须相同
+//   add(a, b)          逐元素相加, b 为数组或数值, 返回新数组
+//   mul(a, b)          逐元素相乘, 同上
+//   compare(a, b)      按字典序比较两个数值数组, 返回 -1、0 或 1
+//
+// 元素为原始数值的数组 (只含 int 或只含 double 的普通数组, 以及类型数组) 使用
+// ksimd 中的向量化内核, 其他数组逐个元素处理。参数类型不符时返回 null。
+// 整数运算的规则与 + 和 * 相同: 结果超出 int64 时为大整数 (add/mul 的结果此时为装箱的
+// 普通数组); 只有类型数组的 add/mul 按元素宽度回绕。
+// =============================================================================
+
+extern const KriNative kri_array_natives[];
+
+#endif //KORELIN_KARRAY_H
@@ -0,0 +1,1046 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "kchannel.h"
+#include "../kbigint.h"
+#include "../kvm.h"
+#include "karray.h"
+#include "kmap.h"
+#include "kpersist.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 通道已满 (或为空) 时, 在条件变量上等待之前自旋重试的次数
+#define KCHAN_SPIN 256
+
+// 编码与冻结的最大嵌套深度, 更深的值不能发送
+#define KCHAN_MAX_DEPTH 4096
+
+// 通道容量的上限
+#define KCHAN_MAX_CAPACITY (1u << 24)
+
+#if defined(__x86_64__) || defined(__i386__)
+#define cpu_relax() __builtin_ia32_pause()
+#else
+#define cpu_relax() ((void)0)
+#endif
+
+// =============================================================================
+// 地址表: 编码时记录已出现的对象, 冻结时记录已复制的对象
+// =============================================================================
+
+typedef struct PtrEntry {
+    const void* key;            // NULL 表示空槽
+    void* value;
+    uint32_t id;
+} PtrEntry;
+
+typedef struct PtrMap {
+    PtrEntry* entries;
+    size_t count;
+    size_t capacity;            // 0 或 2 的幂
+} PtrMap;
+
+static size_t ptr_start(const void* key, size_t mask) {
+    return (size_t)(((uintptr_t)key >> 4) * 0x9E3779B97F4A7C15ull >> 32) & mask;
+}
+
+static PtrEntry* ptr_find(const PtrMap* map, const void* key) {
+    if (map->capacity == 0) return NULL;
+    size_t mask = map->capacity - 1;
+    for (size_t index = ptr_start(key, mask);; index = (index + 1) & mask) {
+        PtrEntry* entry = &map->entries[index];
+        if (entry->key == key) return entry;
+        if (!entry->key) return NULL;
+    }
+}
+
+static void ptr_insert(PtrMap* map, const void* key, void* value, uint32_t id) {
+    if ((map->count + 1) * 2 > map->capacity) {
+        PtrEntry* old = map->entries;
+        size_t old_capacity = map->capacity;
+        map->capacity = old_capacity ? old_capacity * 2 : 64;
+        map->entries = calloc(map->capacity, sizeof(PtrEntry));
+        if (!map->entries) {
+            fprintf(stderr, "Error: calloc failed in ptr_insert\n");
+            exit(EXIT_FAILURE);
+        }
+        map->count = 0;
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old[i].key) ptr_insert(map, old[i].key, old[i].value, old[i].id);
+        }
+        free(old);
+    }
+    size_t mask = map->capacity - 1;
+    size_t index = ptr_start(key, mask);
+    while (map->entries[index].key) index = (index + 1) & mask;
+    map->entries[index] = (PtrEntry){key, value, id};
+    map->count++;
+}
+
+// =============================================================================
+// 冻结: 把不可变的值复制到共享区
+// =============================================================================
+
+typedef struct Freezer {
+    KGCHeap* heap;
+    KGCRegion* region;
+    PtrMap copies;              // 原对象 -> 共享区中的副本 (同一对象只复制一次)
+} Freezer;
+
+static bool freeze_value(Freezer* f, KValue value, KValue* out, int depth);
+
+// 辅助函数：在共享区中创建字符串
+static KString* region_string(KGCRegion* region, const KString* str) {
+    KString* copy = (KString*)kgc_region_alloc(region, KOBJ_STRING, sizeof(KString) + str->length + 1);
+    copy->length = str->length;
+    copy->hash = str->hash;
+    copy->encoding = str->encoding;
+    memcpy(copy->chars, str->chars, str->length + 1);
+    return copy;
+}
+
+// 辅助函数：复制一个对象, 对象 (或它包含的值) 可变时返回 NULL
+static KGCObject* freeze_object(Freezer* f, KGCObject* obj, int depth) {
+    if ((obj->flags & KGC_FLAG_COUNTED) && kgc_region_of(obj) == f->region) return obj;
+    PtrEntry* done = ptr_find(&f->copies, obj);
+    if (done) return done->value;
+    if (depth > KCHAN_MAX_DEPTH) return NULL;
+
+    KGCObject* copy = NULL;
+    switch (obj->type) {
+        case KOBJ_STRING:
+            copy = &region_string(f->region, (const KString*)obj)->obj;
+            break;
+        case KOBJ_ROPE:
+            copy = &region_string(f->region, kstring_flatten(f->heap, KVALUE_OBJECT(obj)))->obj;
+            break;
+        case KOBJ_BIGINT: {
+            const KBigInt* big = (const KBigInt*)obj;
+            KBigInt* result = (KBigInt*)kgc_region_alloc(f->region, KOBJ_BIGINT, sizeof(KBigInt));
+            result->length = big->length;
+            result->negative = big->negative;
+            result->limbs = kgc_region_bytes(f->region, big->length * sizeof(uint64_t));
+            memcpy(result->limbs, big->limbs, big->length * sizeof(uint64_t));
+            copy = &result->obj;
+            break;
+        }
+        case KOBJ_TYPED_ARRAY: {
+            const KArray* array = (const KArray*)obj;
+            KArray* result = (KArray*)kgc_region_alloc(f->region, KOBJ_TYPED_ARRAY, sizeof(KArray));
+            size_t size = array->count * kelement_size(array->kind);
+            result->kind = array->kind;
+            result->items.data = size ? kgc_region_bytes(f->region, size) : NULL;
+            if (size) memcpy(result->items.data, array->items.data, size);
+            result->count = array->count;
+            result->capacity = array->count;
+            copy = &result->obj;
+            break;
+        }
+        case KOBJ_PMAP: {
+            const KPMap* map = (const KPMap*)obj;
+            KValue root = KVALUE_NULL;
+            if (map->root && !freeze_value(f, KVALUE_OBJECT(map->root), &root, depth + 1)) return NULL;
+            KPMap* result = (KPMap*)kgc_region_alloc(f->region, KOBJ_PMAP, sizeof(KPMap));
+            result->root = map->root ? (KHamtNode*)root.as.object : NULL;
+            result->count = map->count;
+            result->edit = 0;
+            copy = &result->obj;
+            break;
+        }
+        case KOBJ_HAMT_NODE: {
+            const KHamtNode* node = (const KHamtNode*)obj;
+            KHamtNode* result = (KHamtNode*)kgc_region_alloc(f->region, KOBJ_HAMT_NODE, node->obj.size);
+            result->edit = 0;
+            result->datamap = node->datamap;
+            result->nodemap = node->nodemap;
+            size_t count = (node->obj.size - sizeof(KHamtNode)) / sizeof(KValue);
+            for (size_t i = 0; i < count; i++) {
+                if (!freeze_value(f, node->slots[i], &result->slots[i], depth + 1)) return NULL;
+            }
+            copy = &result->obj;
+            break;
+        }
+        case KOBJ_PVECTOR: {
+            const KPVector* vector = (const KPVector*)obj;
+            KValue root = KVALUE_NULL, tail = KVALUE_NULL;
+            if (vector->root && !freeze_value(f, KVALUE_OBJECT(vector->root), &root, depth + 1)) return NULL;
+            if (vector->tail && !freeze_value(f, KVALUE_OBJECT(vector->tail), &tail, depth + 1)) return NULL;
+            KPVector* result = (KPVector*)kgc_region_alloc(f->region, KOBJ_PVECTOR, sizeof(KPVector));
+            result->root = vector->root ? (KVectorNode*)root.as.object : NULL;
+            result->tail = vector->tail ? (KVectorNode*)tail.as.object : NULL;
+            result->count = vector->count;
+            result->shift = vector->shift;
+            result->edit = 0;
+            copy = &result->obj;
+            break;
+        }
+        case KOBJ_VECTOR_NODE: {
+            const KVectorNode* node = (const KVectorNode*)obj;
+            KVectorNode* result = (KVectorNode*)kgc_region_alloc(f->region, KOBJ_VECTOR_NODE, sizeof(KVectorNode));
+            result->edit = 0;
+            for (size_t i = 0; i < KPERSIST_WIDTH; i++) {
+                if (!freeze_value(f, node->slots[i], &result->slots[i], depth + 1)) return NULL;
+            }
+            copy = &result->obj;
+            break;
+        }
+        default:
+            return NULL;
+    }
+    ptr_insert(&f->copies, obj, copy, 0);
+    return copy;
+}
+
+static bool freeze_value(Freezer* f, KValue value, KValue* out, int depth) {
+    if (value.type != KVAL_OBJECT) {
+        *out = value;
+        return true;
+    }
+    KGCObject* copy = freeze_object(f, value.as.object, depth);
+    if (!copy) return false;
+    *out = KVALUE_OBJECT(copy);
+    return true;
+}
+
+bool kvalue_freeze(KGCHeap* heap, KValue value, KValue* out) {
+    if (value.type != KVAL_OBJECT || (value.as.object->flags & KGC_FLAG_COUNTED)) {
+        *out = value;
+        return true;
+    }
+    Freezer f = {heap, kgc_region_new(), {NULL, 0, 0}};
+    bool ok = freeze_value(&f, value, out, 0);
+    free(f.copies.entries);
+    if (ok) kgc_hold(heap, out->as.object);
+    kgc_region_release(f.region);
+    return ok;
+}
+
+// =============================================================================
+// 消息的编码
+//
+// 除了 null、bool、int、double 与共享区中的对象, 消息中的值被编码为堆外的字节序列。
+// 每个值以 1 字节标签开头, 整数与长度都是原生字节序的 8 字节; 对象按出现顺序编号,
+// 再次出现时只写编号 (TAG_REF), 解码时按同样的顺序编号, 因此共享与循环的结构保持不变。
+// 容器在编码内容之前编号, 所以循环引用总是指向已经创建的对象。
+// =============================================================================
+
+enum {
+    TAG_NULL,
+    TAG_FALSE,
+    TAG_TRUE,
+    TAG_INT,
+    TAG_DOUBLE,
+    TAG_REF,            // 编号
+    TAG_SHARED,         // 共享区中的对象的地址 (消息持有共享区的引用)
+    TAG_CHANNEL,        // 通道的地址 (消息持有通道的引用)
+    TAG_STRING,         // 编码方式、长度、内容
+    TAG_BIGINT,         // 符号、limb 个数、limbs
+    TAG_ARRAY,          // 元素形式、个数, 然后是原始数值或逐个编码的元素
+    TAG_TYPED_ARRAY,    // 元素形式、个数、原始数值
+    TAG_MAP,            // 个数, 然后是键、值交替
+    TAG_PMAP,           // 个数, 然后是键、值交替
+    TAG_PVECTOR,        // 个数, 然后是元素
+};
+
+// 编码后的消息
+struct KChanBlob {
+    uint8_t* data;
+    size_t length;
+    size_t object_count;        // 解码时创建的对象数
+    KGCRegion** regions;        // 消息持有引用的共享区
+    size_t region_count;
+    KChan** channels;           // 消息持有引用的通道
+    size_t channel_count;
+};
+
+typedef struct Encoder {
+    KGCHeap* heap;
+    KChanBlob* blob;
+    size_t capacity;
+    size_t region_capacity;
+    size_t channel_capacity;
+    KGCRegion* strings;         // 长字符串所在的共享区, 第一次需要时创建
+    PtrMap seen;                // 已编码的对象 -> 编号 (或共享区中的副本)
+} Encoder;
+
+static void emit(Encoder* e, const void* bytes, size_t size) {
+    KChanBlob* blob = e->blob;
+    if (blob->length + size > e->capacity) {
+        size_t capacity = e->capacity ? e->capacity * 2 : 256;
+        while (capacity < blob->length + size) capacity *= 2;
+        uint8_t* data = realloc(blob->data, capacity);
+        if (!data) {
+            fprintf(stderr, "Error: realloc failed in emit\n");
+            exit(EXIT_FAILURE);
+        }
+        blob->data = data;
+        e->capacity = capacity;
+    }
+    memcpy(blob->data + blob->length, bytes, size);
+    blob->length += size;
+}
+
+static void emit_tag(Encoder* e, uint8_t tag) {
+    emit(e, &tag, 1);
+}
+
+static void emit_u64(Encoder* e, uint64_t value) {
+    emit(e, &value, sizeof(value));
+}
+
+// 辅助函数：消息持有共享区的一个引用 (同一共享区只记录一次)
+static void keep_region(Encoder* e, KGCRegion* region) {
+    KChanBlob* blob = e->blob;
+    for (size_t i = 0; i < blob->region_count; i++) {
+        if (blob->regions[i] == region) return;
+    }
+    if (blob->region_count == e->region_capacity) {
+        e->region_capacity = e->region_capacity ? e->region_capacity * 2 : 4;
+        KGCRegion** regions = realloc(blob->regions, e->region_capacity * sizeof(KGCRegion*));
+        if (!regions) {
+            fprintf(stderr, "Error: realloc failed in keep_region\n");
+            exit(EXIT_FAILURE);
+        }
+        blob->regions = regions;
+    }
+    kgc_region_retain(region);
+    blob->regions[blob->region_count++] = region;
+}
+
+static void keep_channel(Encoder* e, KChan* chan) {
+    KChanBlob* blob = e->blob;
+    if (blob->channel_count == e->channel_capacity) {
+        e->channel_capacity = e->channel_capacity ? e->channel_capacity * 2 : 4;
+        KChan** channels = realloc(blob->channels, e->channel_capacity * sizeof(KChan*));
+        if (!channels) {
+            fprintf(stderr, "Error: realloc failed in keep_channel\n");
+            exit(EXIT_FAILURE);
+        }
+        blob->channels = channels;
+    }
+    kchan_retain(chan);
+    blob->channels[blob->channel_count++] = chan;
+}
+
+static void emit_shared(Encoder* e, KGCObject* obj) {
+    keep_region(e, kgc_region_of(obj));
+    emit_tag(e, TAG_SHARED);
+    emit(e, &obj, sizeof(obj));
+}
+
+// 辅助函数：对象第一次出现时编号并返回 true, 再次出现时写入引用并返回 false
+static bool first_visit(Encoder* e, const KGCObject* obj) {
+    PtrEntry* entry = ptr_find(&e->seen, obj);
+    if (!entry) {
+        ptr_insert(&e->seen, obj, NULL, (uint32_t)e->blob->object_count++);
+        return true;
+    }
+    if (entry->value) {
+        emit_shared(e, entry->value);
+    } else {
+        emit_tag(e, TAG_REF);
+        emit_u64(e, entry->id);
+    }
+    return false;
+}
+
+static bool encode_value(Encoder* e, KValue value, int depth);
+
+static bool encode_string(Encoder* e, const KString* str) {
+    if (str->length >= KCHAN_SHARE_MIN) {
+        PtrEntry* entry = ptr_find(&e->seen, str);
+        if (!entry) {
+            if (!e->strings) e->strings = kgc_region_new();
+            ptr_insert(&e->seen, str, region_string(e->strings, str), 0);
+            entry = ptr_find(&e->seen, str);
+        }
+        emit_shared(e, entry->value);
+        return true;
+    }
+    if (!first_visit(e, &str->obj)) return true;
+    emit_tag(e, TAG_STRING);
+    emit(e, &str->encoding, 1);
+    emit_u64(e, str->length);
+    emit(e, str->chars, str->length);
+    return true;
+}
+
+static bool encode_object(Encoder* e, KValue value, int depth) {
+    KGCObject* obj = value.as.object;
+    if (obj->flags & KGC_FLAG_COUNTED) {
+        emit_shared(e, obj);
+        return true;
+    }
+    if (depth > KCHAN_MAX_DEPTH) return false;
+    switch (obj->type) {
+        case KOBJ_STRING:
+            return encode_string(e, (const KString*)obj);
+        case KOBJ_ROPE:
+            return encode_string(e, kstring_flatten(e->heap, value));
+        case KOBJ_CHANNEL:
+            keep_channel(e, ((KChannel*)obj)->shared);
+            emit_tag(e, TAG_CHANNEL);
+            emit(e, &((KChannel*)obj)->shared, sizeof(KChan*));
+            return true;
+        case KOBJ_BIGINT: {
+            if (!first_visit(e, obj)) return true;
+            const KBigInt* big = (const KBigInt*)obj;
+            emit_tag(e, TAG_BIGINT);
+            emit(e, &big->negative, 1);
+            emit_u64(e, big->length);
+            emit(e, big->limbs, big->length * sizeof(uint64_t));
+            return true;
+        }
+        case KOBJ_ARRAY:
+        case KOBJ_TYPED_ARRAY: {
+            if (!first_visit(e, obj)) return true;
+            const KArray* array = (const KArray*)obj;
+            uint8_t kind = (uint8_t)array->kind;
+            emit_tag(e, obj->type == KOBJ_ARRAY ? TAG_ARRAY : TAG_TYPED_ARRAY);
+            emit(e, &kind, 1);
+            emit_u64(e, array->count);
+            if (array->kind != KELEM_VALUE) {
+                emit(e, array->items.data, array->count * kelement_size(array->kind));
+                return true;
+            }
+            for (size_t i = 0; i < array->count; i++) {
+                if (!encode_value(e, array->items.values[i], depth + 1)) return false;
+            }
+            return true;
+        }
+        case KOBJ_MAP: {
+            if (!first_visit(e, obj)) return true;
+            const KMap* map = (const KMap*)obj;
+            emit_tag(e, TAG_MAP);
+            emit_u64(e, map->count);
+            size_t cursor = 0;
+            KValue key, item;
+            while (kmap_next(map, &cursor, &key, &item)) {
+                if (!encode_value(e, key, depth + 1) || !encode_value(e, item, depth + 1)) return false;
+            }
+            return true;
+        }
+        case KOBJ_PMAP: {
+            if (!first_visit(e, obj)) return true;
+            const KPMap* map = (const KPMap*)obj;
+            emit_tag(e, TAG_PMAP);
+            emit_u64(e, map->count);
+            KPMapIter iter;
+            KValue key, item;
+            kpmap_iter_init(map, &iter);
+            while (kpmap_iter_next(&iter, &key, &item)) {
+                if (!encode_value(e, key, depth + 1) || !encode_value(e, item, depth + 1)) return false;
+            }
+            return true;
+        }
+        case KOBJ_PVECTOR: {
+            if (!first_visit(e, obj)) return true;
+            const KPVector* vector = (const KPVector*)obj;
+            emit_tag(e, TAG_PVECTOR);
+            emit_u64(e, vector->count);
+            for (size_t i = 0; i < vector->count; i++) {
+                if (!encode_value(e, kpvector_get(vector, i), depth + 1)) return false;
+            }
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+static bool encode_value(Encoder* e, KValue value, int depth) {
+    switch (value.type) {
+        case KVAL_NULL: emit_tag(e, TAG_NULL); return true;
+        case KVAL_BOOL: emit_tag(e, value.as.boolean ? TAG_TRUE : TAG_FALSE); return true;
+        case KVAL_INT:
+            emit_tag(e, TAG_INT);
+            emit_u64(e, (uint64_t)value.as.integer);
+            return true;
+        case KVAL_DOUBLE:
+            emit_tag(e, TAG_DOUBLE);
+            emit(e, &value.as.number, sizeof(double));
+            return true;
+        case KVAL_OBJECT:
+            return encode_object(e, value, depth);
+    }
+    return false;
+}
+
+static void blob_free(KChanBlob* blob) {
+    for (size_t i = 0; i < blob->region_count; i++) kgc_region_release(blob->regions[i]);
+    for (size_t i = 0; i < blob->channel_count; i++) kchan_release(blob->channels[i]);
+    free(blob->regions);
+    free(blob->channels);
+    free(blob->data);
+    free(blob);
+}
+
+// 辅助函数：编码一个值, 含有不能发送的对象时返回 NULL
+static KChanBlob* blob_encode(KGCHeap* heap, KValue value) {
+    KChanBlob* blob = calloc(1, sizeof(KChanBlob));
+    if (!blob) {
+        fprintf(stderr, "Error: calloc failed in blob_encode\n");
+        exit(EXIT_FAILURE);
+    }
+    Encoder e = {.heap = heap, .blob = blob};
+    bool ok = encode_value(&e, value, 0);
+    free(e.seen.entries);
+    // 长字符串的共享区由消息持有 (keep_region 已增加引用), 释放创建时的引用
+    if (e.strings) kgc_region_release(e.strings);
+    if (!ok) {
+        blob_free(blob);
+        return NULL;
+    }
+    return blob;
+}
+
+typedef struct Decoder {
+    KGCHeap* heap;
+    const uint8_t* data;
+    size_t pos;
+    KGCObject** objects;        // 按编号排列的已创建对象
+    size_t object_count;
+    size_t roots;               // 压入的临时根数
+} Decoder;
+
+static uint8_t read_u8(Decoder* d) {
+    return d->data[d->pos++];
+}
+
+static uint64_t read_u64(Decoder* d) {
+    uint64_t value;
+    memcpy(&value, d->data + d->pos, sizeof(value));
+    d->pos += sizeof(value);
+    return value;
+}
+
+static void* read_pointer(Decoder* d) {
+    void* value;
+    memcpy(&value, d->data + d->pos, sizeof(value));
+    d->pos += sizeof(value);
+    return value;
+}
+
+// 辅助函数：新对象编号并作为临时根, 直到整条消息解码完成
+static void decoded(Decoder* d, KGCObject* obj, bool numbered) {
+    kgc_push_root(d->heap, obj);
+    d->roots++;
+    if (numbered) d->objects[d->object_count++] = obj;
+}
+
+static KValue decode_value(Decoder* d) {
+    KGCHeap* heap = d->heap;
+    uint8_t tag = read_u8(d);
+    switch (tag) {
+        case TAG_NULL: return KVALUE_NULL;
+        case TAG_FALSE: return KVALUE_BOOL(false);
+        case TAG_TRUE: return KVALUE_BOOL(true);
+        case TAG_INT: return KVALUE_INT((long long)read_u64(d));
+        case TAG_DOUBLE: {
+            double number;
+            memcpy(&number, d->data + d->pos, sizeof(number));
+            d->pos += sizeof(number);
+            return KVALUE_DOUBLE(number);
+        }
+        case TAG_REF:
+            return KVALUE_OBJECT(d->objects[read_u64(d)]);
+        case TAG_SHARED: {
+            KGCObject* obj = read_pointer(d);
+            kgc_hold(heap, obj);
+            decoded(d, obj, false);
+            return KVALUE_OBJECT(obj);
+        }
+        case TAG_CHANNEL: {
+            KChan* chan = read_pointer(d);
+            kchan_retain(chan);
+            KChannel* handle = kchannel_new(heap, chan);
+            decoded(d, &handle->obj, false);
+            return KVALUE_OBJECT(handle);
+        }
+        case TAG_STRING: {
+            uint8_t encoding = read_u8(d);
+            size_t length = read_u64(d);
+            KString* str = kstring_alloc(heap, length);
+            memcpy(str->chars, d->data + d->pos, length);
+            d->pos += length;
+            kstring_seal(str);
+            str->encoding = encoding;
+            decoded(d, &str->obj, true);
+            return KVALUE_OBJECT(str);
+        }
+        case TAG_BIGINT: {
+            bool negative = read_u8(d) != 0;
+            size_t length = read_u64(d);
+            KValue big = kbigint_from_bytes(heap, d->data + d->pos, length, negative);
+            d->pos += length * sizeof(uint64_t);
+            decoded(d, big.as.object, true);
+            return big;
+        }
+        case TAG_ARRAY:
+        case TAG_TYPED_ARRAY: {
+            KElementKind kind = (KElementKind)read_u8(d);
+            size_t count = read_u64(d);
+            KArray shape = {.obj.type = tag == TAG_ARRAY ? KOBJ_ARRAY : KOBJ_TYPED_ARRAY, .kind = kind};
+            KArray* array = karray_new_like(heap, &shape, kind == KELEM_VALUE ? 0 : count);
+            decoded(d, &array->obj, true);
+            if (kind != KELEM_VALUE) {
+                size_t size = count * kelement_size(kind);
+                if (size) memcpy(array->items.data, d->data + d->pos, size);
+                d->pos += size;
+                return KVALUE_OBJECT(array);
+            }
+            karray_reserve(heap, array, count);
+            for (size_t i = 0; i < count; i++) {
+                KValue item = decode_value(d);
+                array->items.values[array->count++] = item;
+                kvalue_write_barrier(heap, &array->obj, item);
+            }
+            return KVALUE_OBJECT(array);
+        }
+        case TAG_MAP: {
+            size_t count = read_u64(d);
+            KMap* map = kmap_new(heap, count);
+            decoded(d, &map->obj, true);
+            for (size_t i = 0; i < count; i++) {
+                KValue key = decode_value(d);
+                KValue item = decode_value(d);
+                kmap_set(heap, map, key, item);
+            }
+            return KVALUE_OBJECT(map);
+        }
+        case TAG_PMAP: {
+            size_t count = read_u64(d);
+            KPMap* map = kpmap_transient(heap, NULL);
+            decoded(d, &map->obj, true);
+            for (size_t i = 0; i < count; i++) {
+                KValue key = decode_value(d);
+                KValue item = decode_value(d);
+                kpmap_assoc(heap, map, key, item);
+            }
+            map->edit = 0;
+            return KVALUE_OBJECT(map);
+        }
+        case TAG_PVECTOR: {
+            size_t count = read_u64(d);
+            KPVector* vector = kpvector_transient(heap, NULL);
+            decoded(d, &vector->obj, true);
+            for (size_t i = 0; i < count; i++) {
+                kpvector_conj(heap, vector, decode_value(d));
+            }
+            vector->edit = 0;
+            return KVALUE_OBJECT(vector);
+        }
+        default:
+            fprintf(stderr, "Error: corrupted channel message in decode_value\n");
+            exit(EXIT_FAILURE);
+    }
+}
+
+// 辅助函数：在 heap 中重建消息, 并释放消息
+static KValue blob_decode(KGCHeap* heap, KChanBlob* blob) {
+    Decoder d = {heap, blob->data, 0, NULL, 0, 0};
+    if (blob->object_count > 0) {
+        d.objects = malloc(blob->object_count * sizeof(KGCObject*));
+        if (!d.objects) {
+            fprintf(stderr, "Error: malloc failed in blob_decode\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    KValue value = decode_value(&d);
+    kgc_pop_roots(heap, d.roots);
+    free(d.objects);
+    // 解码出的共享对象已由 heap 持有引用
+    blob_free(blob);
+    return value;
+}
+
+bool kchan_pack(KGCHeap* heap, KValue value, KChanMessage* out) {
+    out->type = (uint8_t)value.type;
+    switch (value.type) {
+        case KVAL_NULL: break;
+        case KVAL_BOOL: out->as.boolean = value.as.boolean; break;
+        case KVAL_INT: out->as.integer = value.as.integer; break;
+        case KVAL_DOUBLE: out->as.number = value.as.number; break;
+        case KVAL_OBJECT:
+            if (value.as.object->flags & KGC_FLAG_COUNTED) {
+                out->type = KCHAN_MSG_SHARED;
+                out->as.shared = value.as.object;
+                kgc_region_retain(kgc_region_of(value.as.object));
+            } else {
+                out->type = KCHAN_MSG_BLOB;
+                out->as.blob = blob_encode(heap, value);
+                if (!out->as.blob) {
+                    // 失败的消息可以照常 kchan_discard
+                    out->type = KVAL_NULL;
+                    return false;
+                }
+            }
+            break;
+    }
+    return true;
+}
+
+KValue kchan_unpack(KGCHeap* heap, KChanMessage* message) {
+    switch (message->type) {
+        case KVAL_NULL: return KVALUE_NULL;
+        case KVAL_BOOL: return KVALUE_BOOL(message->as.boolean);
+        case KVAL_INT: return KVALUE_INT(message->as.integer);
+        case KVAL_DOUBLE: return KVALUE_DOUBLE(message->as.number);
+        case KCHAN_MSG_SHARED:
+            kgc_hold(heap, message->as.shared);
+            kgc_region_release(kgc_region_of(message->as.shared));
+            return KVALUE_OBJECT(message->as.shared);
+        default:
+            return blob_decode(heap, message->as.blob);
+    }
+}
+
+void kchan_discard(KChanMessage* message) {
+    if (message->type == KCHAN_MSG_SHARED) kgc_region_release(kgc_region_of(message->as.shared));
+    if (message->type == KCHAN_MSG_BLOB) blob_free(message->as.blob);
+}
+
+// =============================================================================
+// 通道
+// =============================================================================
+
+// 槽位: sequence 等于位置时可以写入, 等于位置加一时可以读取
+typedef struct KChanCell {
+    size_t sequence;
+    KChanMessage message;
+} KChanCell;
+
+struct KChan {
+    _Alignas(64) size_t head;   // 下一个写入的位置 (生产者之间竞争)
+    _Alignas(64) size_t tail;   // 下一个读取的位置 (消费者之间竞争)
+    _Alignas(64) size_t mask;
+    KChanCell* cells;
+    int refs;
+    bool closed;
+    char* name;                 // 匿名通道为 NULL
+    // 只在队列满 (或空) 时使用: 等待者计数在持有锁时修改, 通知者无等待者时不加锁
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    int recv_waiters;
+    int send_waiters;
+};
+
+// 进程内的同名通道
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static KChan** registry;
+static size_t registry_count;
+
+KChan* kchan_open(const char* name, size_t capacity) {
+    if (name) {
+        pthread_mutex_lock(&registry_lock);
+        for (size_t i = 0; i < registry_count; i++) {
+            if (strcmp(registry[i]->name, name) == 0) {
+                __atomic_fetch_add(&registry[i]->refs, 1, __ATOMIC_RELAXED);
+                pthread_mutex_unlock(&registry_lock);
+                return registry[i];
+            }
+        }
+    }
+    size_t cell_count = 2;
+    while (cell_count < capacity && cell_count < KCHAN_MAX_CAPACITY) cell_count *= 2;
+    KChan* chan = aligned_alloc(64, (sizeof(KChan) + 63) & ~(size_t)63);
+    if (chan) {
+        memset(chan, 0, sizeof(KChan));
+        chan->cells = malloc(cell_count * sizeof(KChanCell));
+    }
+    if (!chan || !chan->cells) {
+        fprintf(stderr, "Error: malloc failed in kchan_open\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < cell_count; i++) chan->cells[i].sequence = i;
+    chan->mask = cell_count - 1;
+    chan->refs = 1;
+    pthread_mutex_init(&chan->lock, NULL);
+    pthread_cond_init(&chan->not_empty, NULL);
+    pthread_cond_init(&chan->not_full, NULL);
+    if (name) {
+        // 注册表持有一个引用, 同名的通道一直存在到进程结束
+        KChan** new_registry = realloc(registry, (registry_count + 1) * sizeof(KChan*));
+        chan->name = malloc(strlen(name) + 1);
+        if (!new_registry || !chan->name) {
+            fprintf(stderr, "Error: malloc failed in kchan_open\n");
+            exit(EXIT_FAILURE);
+        }
+        strcpy(chan->name, name);
+        registry = new_registry;
+        registry[registry_count++] = chan;
+        chan->refs++;
+        pthread_mutex_unlock(&registry_lock);
+    }
+    return chan;
+}
+
+void kchan_retain(KChan* chan) {
+    __atomic_fetch_add(&chan->refs, 1, __ATOMIC_RELAXED);
+}
+
+void kchan_release(KChan* chan) {
+    if (__atomic_sub_fetch(&chan->refs, 1, __ATOMIC_ACQ_REL) != 0) return;
+    // 没有其他引用, 也就没有并发的收发; 未取走的消息在 [tail, head) 中
+    for (size_t pos = chan->tail; pos != chan->head; pos++) {
+        kchan_discard(&chan->cells[pos & chan->mask].message);
+    }
+    pthread_mutex_destroy(&chan->lock);
+    pthread_cond_destroy(&chan->not_empty);
+    pthread_cond_destroy(&chan->not_full);
+    free(chan->cells);
+    free(chan);
+}
+
+// 辅助函数：尝试放入一条消息, 队列已满时返回 false
+static bool ring_push(KChan* chan, const KChanMessage* message) {
+    size_t pos = __atomic_load_n(&chan->head, __ATOMIC_RELAXED);
+    for (;;) {
+        KChanCell* cell = &chan->cells[pos & chan->mask];
+        size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&chan->head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                cell->message = *message;
+                __atomic_store_n(&cell->sequence, pos + 1, __ATOMIC_RELEASE);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = __atomic_load_n(&chan->head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// 辅助函数：尝试取出一条消息, 队列为空时返回 false
+static bool ring_pop(KChan* chan, KChanMessage* message) {
+    size_t pos = __atomic_load_n(&chan->tail, __ATOMIC_RELAXED);
+    for (;;) {
+        KChanCell* cell = &chan->cells[pos & chan->mask];
+        size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&chan->tail, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *message = cell->message;
+                __atomic_store_n(&cell->sequence, pos + chan->mask + 1, __ATOMIC_RELEASE);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = __atomic_load_n(&chan->tail, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// 辅助函数：唤醒在 cond 上等待的线程 (如果有)。
+// 与 wait_until 中的栅栏配对: 要么通知者看到等待者计数, 要么等待者看到队列的变化
+static void notify(KChan* chan, int* waiters, pthread_cond_t* cond) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(waiters, __ATOMIC_RELAXED) == 0) return;
+    pthread_mutex_lock(&chan->lock);
+    pthread_cond_signal(cond);
+    pthread_mutex_unlock(&chan->lock);
+}
+
+static bool is_closed(const KChan* chan) {
+    return __atomic_load_n(&chan->closed, __ATOMIC_ACQUIRE);
+}
+
+// 辅助函数：反复尝试 op, 先自旋再在 cond 上等待, 直到成功或通道关闭
+static bool wait_until(KChan* chan, bool (*op)(KChan*, KChanMessage*), KChanMessage* message, int* waiters,
+                       pthread_cond_t* cond) {
+    for (int i = 0; i < KCHAN_SPIN; i++) {
+        if (op(chan, message)) return true;
+        if (is_closed(chan)) return false;
+        cpu_relax();
+    }
+    pthread_mutex_lock(&chan->lock);
+    __atomic_fetch_add(waiters, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    bool done;
+    while (!(done = op(chan, message)) && !is_closed(chan)) {
+        pthread_cond_wait(cond, &chan->lock);
+    }
+    __atomic_fetch_sub(waiters, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&chan->lock);
+    return done;
+}
+
+static bool push_op(KChan* chan, KChanMessage* message) {
+    return ring_push(chan, message);
+}
+
+KChanStatus kchan_send(KChan* chan, KGCHeap* heap, KValue value, bool block) {
+    if (is_closed(chan)) return KCHAN_CLOSED;
+    KChanMessage message;
+    if (!kchan_pack(heap, value, &message)) return KCHAN_UNSENDABLE;
+    bool sent = block ? wait_until(chan, push_op, &message, &chan->send_waiters, &chan->not_full)
+                      : ring_push(chan, &message);
+    if (!sent) {
+        kchan_discard(&message);
+        return is_closed(chan) ? KCHAN_CLOSED : KCHAN_WOULD_BLOCK;
+    }
+    notify(chan, &chan->recv_waiters, &chan->not_empty);
+    return KCHAN_OK;
+}
+
+KChanStatus kchan_recv(KChan* chan, KGCHeap* heap, KValue* out, bool block) {
+    KChanMessage message;
+    bool received = block ? wait_until(chan, ring_pop, &message, &chan->recv_waiters, &chan->not_empty)
+                          : ring_pop(chan, &message);
+    // 关闭之前放入的消息可能在看到关闭标志之后才可见, 再取一次
+    if (!received && is_closed(chan)) received = ring_pop(chan, &message);
+    if (!received) return is_closed(chan) ? KCHAN_CLOSED : KCHAN_WOULD_BLOCK;
+    notify(chan, &chan->send_waiters, &chan->not_full);
+    *out = kchan_unpack(heap, &message);
+    return KCHAN_OK;
+}
+
+void kchan_close(KChan* chan) {
+    pthread_mutex_lock(&chan->lock);
+    __atomic_store_n(&chan->closed, true, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&chan->not_empty);
+    pthread_cond_broadcast(&chan->not_full);
+    pthread_mutex_unlock(&chan->lock);
+}
+
+size_t kchan_count(const KChan* chan) {
+    size_t head = __atomic_load_n(&chan->head, __ATOMIC_RELAXED);
+    size_t tail = __atomic_load_n(&chan->tail, __ATOMIC_RELAXED);
+    return head > tail ? head - tail : 0;
+}
+
+static void channel_finalize(KGCHeap* heap, KGCObject* obj) {
+    (void)heap;
+    kchan_release(((KChannel*)obj)->shared);
+}
+
+static const KGCTypeInfo channel_type = {
+    .name = "channel",
+    .trace = NULL,
+    .finalize = channel_finalize,
+};
+
+void kchannel_init_types(void) {
+    kgc_register_type(KOBJ_CHANNEL, &channel_type);
+}
+
+KChannel* kchannel_new(KGCHeap* heap, KChan* shared) {
+    KChannel* handle = (KChannel*)kgc_alloc(heap, KOBJ_CHANNEL, sizeof(KChannel));
+    handle->shared = shared;
+    return handle;
+}
+
+// =============================================================================
+// 原生函数
+// =============================================================================
+
+static KChan* as_channel(KValue value) {
+    return kvalue_is_object_type(value, KOBJ_CHANNEL) ? ((KChannel*)value.as.object)->shared : NULL;
+}
+
+// Channel(capacity) / Channel(name, capacity) -> 通道句柄
+static KValue native_channel(KorelinVM* vm, int argc, const KValue* argv) {
+    if (argc < 1 || argc > 2) return KVALUE_NULL;
+    KValue capacity = argv[argc - 1];
+    if (capacity.type != KVAL_INT || capacity.as.integer < 1 || capacity.as.integer > KCHAN_MAX_CAPACITY) {
+        return KVALUE_NULL;
+    }
+    if (argc == 2 && !kvalue_is_object_type(argv[0], KOBJ_STRING)) return KVALUE_NULL;
+    KChan* shared = kchan_open(argc == 2 ? ((KString*)argv[0].as.object)->chars : NULL, (size_t)capacity.as.integer);
+    return KVALUE_OBJECT(kchannel_new(vm->heap, shared));
+}
+
+// 辅助函数：chanSend / chanTrySend
+static KValue send(KorelinVM* vm, const KValue* argv, bool block) {
+    KChan* chan = as_channel(argv[0]);
+    if (!chan) return KVALUE_BOOL(false);
+    return KVALUE_BOOL(kchan_send(chan, vm->heap, argv[1], block) == KCHAN_OK);
+}
+
+// chanSend(ch, v) -> bool
+static KValue native_chan_send(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    return send(vm, argv, true);
+}
+
+// chanTrySend(ch, v) -> bool
+static KValue native_chan_try_send(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    return send(vm, argv, false);
+}
+
+// chanRecv(ch) -> value, 通道已关闭且取空时返回 null
+static KValue native_chan_recv(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    KChan* chan = as_channel(argv[0]);
+    KValue value = KVALUE_NULL;
+    if (chan) kchan_recv(chan, vm->heap, &value, true);
+    return value;
+}
+
+// chanTryRecv(ch) -> value, 通道为空时返回 null
+static KValue native_chan_try_recv(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    KChan* chan = as_channel(argv[0]);
+    KValue value = KVALUE_NULL;
+    if (chan) kchan_recv(chan, vm->heap, &value, false);
+    return value;
+}
+
+// chanClose(ch) -> bool
+static KValue native_chan_close(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)vm;
+    (void)argc;
+    KChan* chan = as_channel(argv[0]);
+    if (!chan) return KVALUE_BOOL(false);
+    kchan_close(chan);
+    return KVALUE_BOOL(true);
+}
+
+// chanCount(ch) -> int
+static KValue native_chan_count(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)vm;
+    (void)argc;
+    KChan* chan = as_channel(argv[0]);
+    if (!chan) return KVALUE_NULL;
+    return KVALUE_INT((long long)kchan_count(chan));
+}
+
+// freeze(v) -> 冻结的值 | null
+static KValue native_freeze(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    KValue result;
+    if (!kvalue_freeze(vm->heap, argv[0], &result)) return KVALUE_NULL;
+    return result;
+}
+
+// frozen(v) -> bool
+static KValue native_frozen(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)vm;
+    (void)argc;
+    return KVALUE_BOOL(argv[0].type != KVAL_OBJECT || (argv[0].as.object->flags & KGC_FLAG_COUNTED));
+}
+
+const KriNative kri_channel_natives[] = {
+    {"Channel", -1, native_channel},
+    {"chanSend", 2, native_chan_send},
+    {"chanTrySend", 2, native_chan_try_send},
+    {"chanRecv", 1, native_chan_recv},
+    {"chanTryRecv", 1, native_chan_try_recv},
+    {"chanClose", 1, native_chan_close},
+    {"chanCount", 1, native_chan_count},
+    {"freeze", 1, native_freeze},
+    {"frozen", 1, native_frozen},
+    {NULL, 0, NULL},
+};
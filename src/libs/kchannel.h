@@ -0,0 +1,157 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#ifndef KORELIN_KCHANNEL_H
+#define KORELIN_KCHANNEL_H
+
+#include "../krilib.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// =============================================================================
+// 跨虚拟机的消息通道
+//
+// 通道本身位于所有 GC 堆之外, 各虚拟机 (隔离实例) 通过 KChannel 句柄对象访问, 同名的
+// 通道在进程内只有一个。通道是有界的多生产者多消费者队列 (Vyukov 的环形缓冲区): 每个
+// 槽位带有一个序号, 生产者与消费者各自用一次 CAS 领取位置, 之后只读写自己的槽位,
+// 不加锁; 只有队列满 (或空) 且短暂自旋之后仍未就绪时, 才在条件变量上等待。
+//
+// 消息按值的可变性传递:
+//   - null、bool、int、double 直接存放在槽位中;
+//   - 冻结的值 (见 freeze) 位于引用计数的共享区 (kgc.h 中的 KGCRegion), 发送时只增加
+//     共享区的引用, 接收者的堆直接引用同一份对象, 不复制;
+//   - 其他值 (数组、字典、类型数组、持久化字典与向量、大整数、字符串) 在发送时深复制为
+//     堆外的编码, 接收时在接收者的堆中重建, 同一对象的多次引用与循环引用都保持原样。
+//     其中不短于 KCHAN_SHARE_MIN 的字符串放入随消息一起的共享区, 接收时不再复制。
+// 结构体、函数、协程等属于某个程序或虚拟机的值不能发送。
+//
+// freeze(v) 把字符串、类型数组、大整数、持久化字典与向量 (以及它们包含的值) 复制到
+// 新的共享区中, 结果是深度不可变的: 冻结的类型数组不能写入, 持久化结构的修改照常
+// 返回新的版本。接收者的堆不再引用某个共享区时 (由回收器判定), 释放它的引用。
+// =============================================================================
+
+#define KCHAN_SHARE_MIN 1024    // 不短于该长度的字符串随消息共享而不复制
+
+typedef struct KChan KChan;
+typedef struct KChanBlob KChanBlob;
+
+// 消息的类型: KValueType 之外的两种
+#define KCHAN_MSG_SHARED 0x40   // 共享区中的对象
+#define KCHAN_MSG_BLOB 0x41     // 编码后的值
+
+// 在堆之间传递的一个值 (通道的槽位中存放的就是它), 不属于任何堆
+typedef struct KChanMessage {
+    uint8_t type;               // KValueType 或 KCHAN_MSG_*
+    union {
+        bool boolean;
+        long long integer;
+        double number;
+        KGCObject* shared;      // 消息持有共享区的一个引用
+        KChanBlob* blob;
+    } as;
+} KChanMessage;
+
+// 通道的句柄 (KOBJ_CHANNEL), 被回收时释放对通道的引用
+typedef struct KChannel {
+    KGCObject obj;
+    KChan* shared;
+} KChannel;
+
+// 发送与接收的结果
+typedef enum {
+    KCHAN_OK,
+    KCHAN_WOULD_BLOCK,          // 非阻塞操作时通道已满 (或为空)
+    KCHAN_CLOSED,               // 通道已关闭 (接收时为已关闭且已取空)
+    KCHAN_UNSENDABLE,           // 值中含有不能发送的对象
+} KChanStatus;
+
+// --- 函数声明 ---
+
+/**
+ * @brief 注册通道句柄的对象类型, 由 kobject_init_types 调用。
+ */
+void kchannel_init_types(void);
+
+/**
+ * @brief 打开通道。
+ * @param name 通道名, 同名的通道在进程内共享 (已存在时忽略 capacity); NULL 表示创建匿名的新通道。
+ * @param capacity 最多缓存的消息数, 向上取整为 2 的幂。
+ * @return 通道, 调用者持有一个引用。
+ */
+KChan* kchan_open(const char* name, size_t capacity);
+
+/**
+ * @brief 增加或释放一个引用, 匿名通道的最后一个引用释放时销毁通道 (连同未取走的消息)。
+ */
+void kchan_retain(KChan* chan);
+void kchan_release(KChan* chan);
+
+/**
+ * @brief 创建句柄对象, 接管调用者持有的引用。
+ */
+KChannel* kchannel_new(KGCHeap* heap, KChan* shared);
+
+/**
+ * @brief 发送一个值, 可以与其他线程的发送和接收并发执行。
+ * @param heap 值所在的堆 (编码时展平拼接字符串)。
+ * @param block 通道已满时是否等待。
+ */
+KChanStatus kchan_send(KChan* chan, KGCHeap* heap, KValue value, bool block);
+
+/**
+ * @brief 接收一个值, 在 heap 中重建 (或引用共享区中的对象)。
+ * @param block 通道为空时是否等待, 直到有消息或通道关闭。
+ */
+KChanStatus kchan_recv(KChan* chan, KGCHeap* heap, KValue* out, bool block);
+
+/**
+ * @brief 把值转换为可以交给其他线程的消息, 共享与复制的规则与 kchan_send 相同。
+ * @param heap 值所在的堆。
+ * @return 值中含有不能发送的对象时返回 false, 此时 out 为 null 消息。
+ */
+bool kchan_pack(KGCHeap* heap, KValue value, KChanMessage* out);
+
+/**
+ * @brief 在 heap 中取出消息的值 (重建或引用共享区中的对象), 并释放消息。
+ *        重建的对象没有登记为根, 调用者必须在下一次分配之前让它可达。
+ */
+KValue kchan_unpack(KGCHeap* heap, KChanMessage* message);
+
+/**
+ * @brief 释放没有取出的消息。
+ */
+void kchan_discard(KChanMessage* message);
+
+/**
+ * @brief 关闭通道: 之后的发送失败, 已缓存的消息仍可接收, 等待中的线程被唤醒。
+ */
+void kchan_close(KChan* chan);
+
+/**
+ * @brief 缓存的消息数 (并发修改时为某一时刻的近似值)。
+ */
+size_t kchan_count(const KChan* chan);
+
+/**
+ * @brief 把值深复制到新的共享区中, 已冻结的值原样返回。
+ * @param heap 值所在的堆: 结果被登记为该堆引用的共享区。
+ * @param out 写入冻结的值。null、bool、int、double 原样写入。
+ * @return 值中含有可变的对象 (数组、字典等) 时返回 false。
+ */
+bool kvalue_freeze(KGCHeap* heap, KValue value, KValue* out);
+
+// 通道相关的原生函数:
+//   Channel(capacity) / Channel(name, capacity)  创建匿名通道 / 打开进程内共享的同名通道
+//   chanSend(ch, v) -> bool        阻塞直到放入; 通道已关闭或 v 不能发送时返回 false
+//   chanTrySend(ch, v) -> bool     通道已满时立即返回 false
+//   chanRecv(ch) -> value          阻塞直到取出; 通道已关闭且取空时返回 null
+//   chanTryRecv(ch) -> value       通道为空时立即返回 null (无法与收到的 null 区分)
+//   chanClose(ch)、chanCount(ch)
+//   freeze(v) -> 冻结的值 | null   v 含有可变的对象时返回 null
+//   frozen(v) -> bool              v 是否为 freeze 的结果 (或 null、bool、int、double)
+// chanRecv 阻塞的是整个线程: 同一个虚拟机中的协程之间应当使用 chanTryRecv 与 yield。
+extern const KriNative kri_channel_natives[];
+
+#endif //KORELIN_KCHANNEL_H
@@ -2,4 +2,1031 @@
 // Created by Helix on 2025/12/28.
 //
 
-#include "kmap.h"
\ No newline at end of file
+#define _POSIX_C_SOURCE 200809L
+
+#include "kmap.h"
+#include "kpersist.h"
+#include "../kbigint.h"
+#include "../kstruct.h"
+#include "../kvm.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// 装载因子上限 13/16: 线性探测在更高的装载因子下未命中的探测长度增长很快
+#define KMAP_MAX_LOAD_NUM 13
+#define KMAP_MAX_LOAD_DEN 16
+
+// =============================================================================
+// 哈希与键
+// =============================================================================
+
+// 辅助函数：murmur3 的 fmix32, 让 H1 与 H2 的每一位都依赖整个输入
+static inline uint32_t mix32(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+}
+
+// 辅助函数：整数哈希 (乘法哈希取高 32 位), 小整数键的快速路径只需要一次乘法
+static inline uint32_t hash_int(long long key) {
+    return (uint32_t)(((uint64_t)key * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+// 辅助函数：大整数的哈希, 按符号与绝对值的各个 limb 计算。大整数总是规范化的 (能放进
+// 64 位的值一定是 int), 相等的整数因此只有一种表示, 按绝对值哈希即可保证哈希相同
+static inline uint32_t hash_bigint(const KBigInt* big) {
+    uint64_t h = big->negative ? 0x2D2D2D2D2D2D2D2Dull : 0;
+    for (size_t i = 0; i < big->length; i++) {
+        h = (h ^ big->limbs[i]) * 0x9E3779B97F4A7C15ull;
+        h ^= h >> 29;
+    }
+    return mix32((uint32_t)(h ^ (h >> 32)));
+}
+
+// 辅助函数：两个对象键 (字符串或大整数) 是否相等
+static inline bool object_keys_equal(const KGCObject* a, const KGCObject* b) {
+    if (a == b) return true;
+    if (a->type != b->type) return false;
+    if (a->type == KOBJ_BIGINT) {
+        const KBigInt* x = (const KBigInt*)a;
+        const KBigInt* y = (const KBigInt*)b;
+        return x->negative == y->negative && x->length == y->length &&
+               memcmp(x->limbs, y->limbs, x->length * sizeof(uint64_t)) == 0;
+    }
+    const KString* x = (const KString*)a;
+    const KString* y = (const KString*)b;
+    return x->length == y->length && memcmp(x->chars, y->chars, x->length) == 0;
+}
+
+// 辅助函数：整数值的 double 转换为 int 键, 与 Lua 相同, 使 m[1] 与 m[1.0] 指向同一个键
+static inline KValue normalize_key(KValue key) {
+    if (key.type == KVAL_DOUBLE && key.as.number >= -9223372036854775808.0 && key.as.number < 9223372036854775808.0) {
+        long long integer = (long long)key.as.number;
+        if ((double)integer == key.as.number) return KVALUE_INT(integer);
+    }
+    return key;
+}
+
+// 辅助函数：规范化之后的键的哈希
+static inline uint32_t hash_key(KValue key) {
+    switch (key.type) {
+        case KVAL_NULL: return hash_int(0x6E756C6CLL);
+        case KVAL_BOOL: return hash_int(key.as.boolean ? 0x74727565LL : 0x66616C73LL);
+        case KVAL_INT: return hash_int(key.as.integer);
+        case KVAL_DOUBLE: {
+            long long bits;
+            memcpy(&bits, &key.as.number, sizeof(bits));
+            return hash_int(bits);
+        }
+        case KVAL_OBJECT:
+            if (key.as.object->type == KOBJ_BIGINT) return hash_bigint((const KBigInt*)key.as.object);
+            return mix32(((const KString*)key.as.object)->hash);
+    }
+    return 0;
+}
+
+bool kmap_valid_key(KValue key) {
+    switch (key.type) {
+        case KVAL_NULL: case KVAL_BOOL: case KVAL_INT: return true;
+        case KVAL_DOUBLE: return key.as.number == key.as.number;
+        case KVAL_OBJECT: return key.as.object->type == KOBJ_STRING || key.as.object->type == KOBJ_BIGINT;
+    }
+    return false;
+}
+
+KValue kmap_normalize_key(KValue key) {
+    return normalize_key(key);
+}
+
+uint32_t kmap_hash_key(KValue key) {
+    return hash_key(key);
+}
+
+bool kmap_keys_equal(KValue a, KValue b) {
+    if (a.type != b.type) return false;
+    switch (a.type) {
+        case KVAL_NULL: return true;
+        case KVAL_BOOL: return a.as.boolean == b.as.boolean;
+        case KVAL_INT: return a.as.integer == b.as.integer;
+        case KVAL_DOUBLE: return a.as.number == b.as.number;
+        case KVAL_OBJECT: return object_keys_equal(a.as.object, b.as.object);
+    }
+    return false;
+}
+
+static inline KValue entry_key(const KMapEntry* entry) {
+    KValue key = {.type = (KValueType)entry->key_type};
+    memcpy(&key.as, &entry->key, sizeof(entry->key));
+    return key;
+}
+
+static inline KValue entry_value(const KMapEntry* entry) {
+    KValue value = {.type = (KValueType)entry->value_type};
+    memcpy(&value.as, &entry->value, sizeof(entry->value));
+    return value;
+}
+
+// 辅助函数：槽位移动之后对其中的引用调用写屏障 (分段扫描中的表可能已经越过了新位置)
+static inline void entry_barrier(KGCHeap* heap, KMap* map, const KMapEntry* entry) {
+    kvalue_write_barrier(heap, &map->obj, entry_key(entry));
+    kvalue_write_barrier(heap, &map->obj, entry_value(entry));
+}
+
+// 辅助函数：槽位中的键是否等于 key (调用者已比较过哈希); 字符串先比较地址, 驻留的常量直接命中
+static inline bool entry_key_equals(const KMapEntry* entry, KValue key) {
+    if (entry->key_type != key.type) return false;
+    switch (key.type) {
+        case KVAL_NULL: return true;
+        case KVAL_BOOL: return entry->key.boolean == key.as.boolean;
+        case KVAL_INT: return entry->key.integer == key.as.integer;
+        case KVAL_DOUBLE: return entry->key.number == key.as.number;
+        case KVAL_OBJECT: return object_keys_equal(entry->key.object, key.as.object);
+    }
+    return false;
+}
+
+// =============================================================================
+// 控制字节组
+// =============================================================================
+
+// 辅助函数：比较从 ctrl 开始的一组控制字节, 得到 H2 相同的槽位与空槽的位掩码
+static inline void group_scan(const uint8_t* ctrl, uint8_t h2, uint32_t* match, uint32_t* empty) {
+#if defined(__SSE2__)
+    __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+    *match = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)h2)));
+    *empty = (uint32_t)_mm_movemask_epi8(group);   // 只有空槽的最高位为 1
+#else
+    uint32_t m = 0, e = 0;
+    for (unsigned i = 0; i < KMAP_GROUP; i++) {
+        m |= (uint32_t)(ctrl[i] == h2) << i;
+        e |= (uint32_t)(ctrl[i] >> 7) << i;
+    }
+    *match = m;
+    *empty = e;
+#endif
+}
+
+static inline uint32_t group_empty(const uint8_t* ctrl) {
+#if defined(__SSE2__)
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)ctrl));
+#else
+    uint32_t empty = 0;
+    for (unsigned i = 0; i < KMAP_GROUP; i++) empty |= (uint32_t)(ctrl[i] >> 7) << i;
+    return empty;
+#endif
+}
+
+// 辅助函数：设置控制字节, 开头的一组同时写入末尾的镜像
+static inline void set_ctrl(KMap* map, size_t index, uint8_t value) {
+    map->ctrl[index] = value;
+    if (index < KMAP_GROUP) map->ctrl[map->capacity + index] = value;
+}
+
+// =============================================================================
+// 探测
+// =============================================================================
+
+// 辅助函数：查找键所在的槽位, 不存在时返回 SIZE_MAX 并在 insert_at 中给出应插入的空槽。
+// 内联到各个调用点后, 对类型已知的键 (如 kmap_get_int) 只保留对应的比较分支
+static inline size_t find_slot(const KMap* map, KValue key, uint32_t hash, size_t* insert_at) {
+    size_t mask = map->capacity - 1;
+    size_t pos = (hash >> 7) & mask;
+    uint8_t h2 = (uint8_t)(hash & 0x7F);
+    while (true) {
+        uint32_t match, empty;
+        group_scan(map->ctrl + pos, h2, &match, &empty);
+        // 线性探测: 键一定位于起始位置之后的第一个空槽之前
+        if (empty) match &= (empty & (0u - empty)) - 1;
+        while (match) {
+            size_t index = (pos + (size_t)__builtin_ctz(match)) & mask;
+            const KMapEntry* entry = &map->entries[index];
+            if (entry->hash == hash && entry_key_equals(entry, key)) return index;
+            match &= match - 1;
+        }
+        if (empty) {
+            if (insert_at) *insert_at = (pos + (size_t)__builtin_ctz(empty)) & mask;
+            return SIZE_MAX;
+        }
+        pos = (pos + KMAP_GROUP) & mask;
+    }
+}
+
+// 辅助函数：从哈希的起始位置开始找第一个空槽 (扩容时重新插入, 不需要比较键)
+static inline size_t find_empty(const KMap* map, uint32_t hash) {
+    size_t mask = map->capacity - 1;
+    size_t pos = (hash >> 7) & mask;
+    while (true) {
+        uint32_t empty = group_empty(map->ctrl + pos);
+        if (empty) return (pos + (size_t)__builtin_ctz(empty)) & mask;
+        pos = (pos + KMAP_GROUP) & mask;
+    }
+}
+
+// =============================================================================
+// 表的分配与扩容
+// =============================================================================
+
+// 辅助函数：capacity 个槽位占用的外部内存
+static size_t table_bytes(size_t capacity) {
+    return capacity ? capacity * (sizeof(KMapEntry) + 1) + KMAP_GROUP : 0;
+}
+
+// 辅助函数：能放下 count 个元素的最小容量
+static size_t capacity_for(size_t count) {
+    if (count == 0) return 0;
+    size_t capacity = KMAP_GROUP;
+    while (count * KMAP_MAX_LOAD_DEN > capacity * KMAP_MAX_LOAD_NUM) capacity *= 2;
+    return capacity;
+}
+
+// 辅助函数：换成 capacity 个槽位的新表并重新插入所有元素 (使用缓存的哈希)
+static void table_resize(KGCHeap* heap, KMap* map, size_t capacity) {
+    KMapEntry* old_entries = map->entries;
+    uint8_t* old_ctrl = map->ctrl;
+    size_t old_capacity = map->capacity;
+
+    // 槽位与控制字节位于同一块内存: 槽位在前 (8 字节对齐), 控制字节在后
+    unsigned char* block = malloc(table_bytes(capacity));
+    if (!block) {
+        fprintf(stderr, "Error: malloc failed in table_resize\n");
+        exit(EXIT_FAILURE);
+    }
+    map->entries = (KMapEntry*)block;
+    map->ctrl = block + capacity * sizeof(KMapEntry);
+    map->capacity = capacity;
+    memset(map->ctrl, KMAP_EMPTY, capacity + KMAP_GROUP);
+
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_ctrl[i] == KMAP_EMPTY) continue;
+        size_t index = find_empty(map, old_entries[i].hash);
+        map->entries[index] = old_entries[i];
+        set_ctrl(map, index, old_ctrl[i]);
+        entry_barrier(heap, map, &map->entries[index]);
+    }
+    free(old_entries);
+    kgc_account_external(heap, (ptrdiff_t)table_bytes(capacity) - (ptrdiff_t)table_bytes(old_capacity));
+}
+
+// =============================================================================
+// 对象类型
+// =============================================================================
+
+static void map_trace_range(KGCTracer* tracer, KGCObject* obj, size_t begin, size_t end) {
+    KMap* map = (KMap*)obj;
+    for (size_t i = begin; i < end; i++) {
+        if (map->ctrl[i] == KMAP_EMPTY) continue;
+        KMapEntry* entry = &map->entries[i];
+        if (entry->key_type == KVAL_OBJECT) kgc_visit_object(tracer, &entry->key.object);
+        if (entry->value_type == KVAL_OBJECT) kgc_visit_object(tracer, &entry->value.object);
+    }
+}
+
+static void map_trace(KGCTracer* tracer, KGCObject* obj) {
+    map_trace_range(tracer, obj, 0, ((KMap*)obj)->capacity);
+}
+
+// 每个槽位算一个引用槽 (空槽同样需要检查)
+static size_t map_slot_count(const KGCObject* obj) {
+    return ((const KMap*)obj)->capacity;
+}
+
+static size_t map_external_size(const KGCObject* obj) {
+    return table_bytes(((const KMap*)obj)->capacity);
+}
+
+static void map_finalize(KGCHeap* heap, KGCObject* obj) {
+    KMap* map = (KMap*)obj;
+    kgc_account_external(heap, -(ptrdiff_t)table_bytes(map->capacity));
+    free(map->entries);
+}
+
+static const KGCTypeInfo map_type = {
+    .name = "map",
+    .trace = map_trace,
+    .finalize = map_finalize,
+    .external_size = map_external_size,
+    .slot_count = map_slot_count,
+    .trace_range = map_trace_range,
+};
+
+// =============================================================================
+// 哈希表操作
+// =============================================================================
+
+KMap* kmap_new(KGCHeap* heap, size_t capacity) {
+    KMap* map = (KMap*)kgc_alloc(heap, KOBJ_MAP, sizeof(KMap));
+    map->entries = NULL;
+    map->ctrl = NULL;
+    map->count = 0;
+    map->capacity = 0;
+    if (capacity > 0) table_resize(heap, map, capacity_for(capacity));
+    return map;
+}
+
+bool kmap_get(const KMap* map, KValue key, KValue* out) {
+    if (map->count == 0) return false;
+    key = normalize_key(key);
+    size_t index = find_slot(map, key, hash_key(key), NULL);
+    if (index == SIZE_MAX) return false;
+    if (out) *out = entry_value(&map->entries[index]);
+    return true;
+}
+
+bool kmap_get_int(const KMap* map, long long key, KValue* out) {
+    if (map->count == 0) return false;
+    size_t index = find_slot(map, KVALUE_INT(key), hash_int(key), NULL);
+    if (index == SIZE_MAX) return false;
+    if (out) *out = entry_value(&map->entries[index]);
+    return true;
+}
+
+KString* kmap_find_string(const KMap* map, const char* chars, size_t length, uint32_t hash) {
+    if (map->count == 0) return NULL;
+    uint32_t mixed = mix32(hash);
+    size_t mask = map->capacity - 1;
+    size_t pos = (mixed >> 7) & mask;
+    uint8_t h2 = (uint8_t)(mixed & 0x7F);
+    while (true) {
+        uint32_t match, empty;
+        group_scan(map->ctrl + pos, h2, &match, &empty);
+        if (empty) match &= (empty & (0u - empty)) - 1;
+        while (match) {
+            const KMapEntry* entry = &map->entries[(pos + (size_t)__builtin_ctz(match)) & mask];
+            if (entry->hash == mixed && entry->key_type == KVAL_OBJECT && entry->key.object->type == KOBJ_STRING) {
+                KString* str = (KString*)entry->key.object;
+                if (str->length == length && memcmp(str->chars, chars, length) == 0) return str;
+            }
+            match &= match - 1;
+        }
+        if (empty) return NULL;
+        pos = (pos + KMAP_GROUP) & mask;
+    }
+}
+
+void kmap_set(KGCHeap* heap, KMap* map, KValue key, KValue value) {
+    key = normalize_key(key);
+    uint32_t hash = hash_key(key);
+    size_t insert_at = 0;
+    size_t index = map->capacity ? find_slot(map, key, hash, &insert_at) : SIZE_MAX;
+    if (index == SIZE_MAX) {
+        if ((map->count + 1) * KMAP_MAX_LOAD_DEN > map->capacity * KMAP_MAX_LOAD_NUM) {
+            table_resize(heap, map, map->capacity ? map->capacity * 2 : KMAP_GROUP);
+            insert_at = find_empty(map, hash);
+        }
+        index = insert_at;
+        KMapEntry* entry = &map->entries[index];
+        entry->hash = hash;
+        entry->key_type = (uint8_t)key.type;
+        memcpy(&entry->key, &key.as, sizeof(entry->key));
+        set_ctrl(map, index, (uint8_t)(hash & 0x7F));
+        map->count++;
+        kvalue_write_barrier(heap, &map->obj, key);
+    }
+    KMapEntry* entry = &map->entries[index];
+    entry->value_type = (uint8_t)value.type;
+    memcpy(&entry->value, &value.as, sizeof(entry->value));
+    kvalue_write_barrier(heap, &map->obj, value);
+}
+
+bool kmap_remove(KGCHeap* heap, KMap* map, KValue key) {
+    if (map->count == 0) return false;
+    key = normalize_key(key);
+    size_t hole = find_slot(map, key, hash_key(key), NULL);
+    if (hole == SIZE_MAX) return false;
+
+    // 向后移动删除: 把后续槽位中可以前移的键移入空位, 直到遇到空槽。
+    // j 处的键可以移到 hole, 当且仅当 hole 位于它的起始位置与 j 之间 (循环意义下)
+    size_t mask = map->capacity - 1;
+    size_t j = hole;
+    while (true) {
+        j = (j + 1) & mask;
+        if (map->ctrl[j] == KMAP_EMPTY) break;
+        size_t home = (map->entries[j].hash >> 7) & mask;
+        if (((j - hole) & mask) > ((j - home) & mask)) continue;
+        map->entries[hole] = map->entries[j];
+        set_ctrl(map, hole, map->ctrl[j]);
+        entry_barrier(heap, map, &map->entries[hole]);
+        hole = j;
+    }
+    set_ctrl(map, hole, KMAP_EMPTY);
+    map->count--;
+    return true;
+}
+
+bool kmap_next(const KMap* map, size_t* cursor, KValue* key, KValue* value) {
+    size_t i = *cursor;
+    while (i < map->capacity) {
+        // 一次跳过一整组空槽; 越过末尾的镜像字节不参与遍历
+        uint32_t full = ~group_empty(map->ctrl + i) & ((1u << KMAP_GROUP) - 1);
+        if (map->capacity - i < KMAP_GROUP) full &= (1u << (map->capacity - i)) - 1;
+        if (full) {
+            i += (size_t)__builtin_ctz(full);
+            const KMapEntry* entry = &map->entries[i];
+            *key = entry_key(entry);
+            if (value) *value = entry_value(entry);
+            *cursor = i + 1;
+            return true;
+        }
+        i += KMAP_GROUP;
+    }
+    *cursor = map->capacity;
+    return false;
+}
+
+// =============================================================================
+// 基于纪元的内存回收
+//
+// 每个线程有一条记录, 进入读临界区时写入当前的全局纪元, 离开时清零。被摘下的结点
+// 记下摘下时的纪元, 全局纪元前进两次之后 (所有活跃的读者都已进入更新的纪元) 才释放。
+// 只有所有活跃记录都处于当前纪元时全局纪元才能前进。
+// =============================================================================
+
+#define KCMAP_STRIPES 64        // 写者的分段锁个数, 也是桶数组的最小长度
+#define KCMAP_RETIRE_BATCH 64   // 积累这么多待释放对象后尝试回收
+
+typedef struct KEpochRecord {
+    uint64_t epoch;             // 0 表示不在临界区
+    int in_use;                 // 记录是否属于某个存活的线程
+    struct KEpochRecord* next;
+} KEpochRecord;
+
+typedef struct KRetired {
+    void* ptr;
+    void (*release)(void* ptr);
+    uint64_t epoch;
+} KRetired;
+
+static uint64_t global_epoch = 1;
+static KEpochRecord* epoch_records;     // 只增不减, 线程退出后记录留给新线程复用
+static pthread_key_t epoch_key;
+static pthread_once_t epoch_once = PTHREAD_ONCE_INIT;
+static _Thread_local KEpochRecord* tl_record;
+
+static pthread_mutex_t retire_lock = PTHREAD_MUTEX_INITIALIZER;
+static KRetired* retired;
+static size_t retired_count;
+static size_t retired_capacity;
+
+// 辅助函数：线程退出时归还记录
+static void epoch_thread_exit(void* record) {
+    __atomic_store_n(&((KEpochRecord*)record)->epoch, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&((KEpochRecord*)record)->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static void epoch_init_key(void) {
+    pthread_key_create(&epoch_key, epoch_thread_exit);
+}
+
+// 辅助函数：当前线程的记录, 优先复用已退出线程的记录
+static KEpochRecord* epoch_record(void) {
+    if (tl_record) return tl_record;
+    pthread_once(&epoch_once, epoch_init_key);
+    KEpochRecord* record = NULL;
+    for (KEpochRecord* r = __atomic_load_n(&epoch_records, __ATOMIC_ACQUIRE); r; r = r->next) {
+        int expected = 0;
+        if (__atomic_compare_exchange_n(&r->in_use, &expected, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            record = r;
+            break;
+        }
+    }
+    if (!record) {
+        record = calloc(1, sizeof(KEpochRecord));
+        if (!record) {
+            fprintf(stderr, "Error: calloc failed in epoch_record\n");
+            exit(EXIT_FAILURE);
+        }
+        record->in_use = 1;
+        record->next = __atomic_load_n(&epoch_records, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&epoch_records, &record->next, record, true, __ATOMIC_RELEASE,
+                                            __ATOMIC_RELAXED)) {
+        }
+    }
+    pthread_setspecific(epoch_key, record);
+    tl_record = record;
+    return record;
+}
+
+static KEpochRecord* epoch_enter(void) {
+    KEpochRecord* record = epoch_record();
+    // 顺序一致的写入保证回收线程在看到本记录之前, 本线程不会读到任何表中的指针
+    __atomic_store_n(&record->epoch, __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+    return record;
+}
+
+static void epoch_exit(KEpochRecord* record) {
+    __atomic_store_n(&record->epoch, 0, __ATOMIC_RELEASE);
+}
+
+// 辅助函数：所有活跃的读者都已进入当前纪元时推进全局纪元, 并释放两个纪元之前摘下的对象。
+// 调用者持有 retire_lock
+static void epoch_collect(void) {
+    uint64_t epoch = __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST);
+    bool quiescent = true;
+    for (KEpochRecord* r = __atomic_load_n(&epoch_records, __ATOMIC_ACQUIRE); r; r = r->next) {
+        uint64_t seen = __atomic_load_n(&r->epoch, __ATOMIC_SEQ_CST);
+        if (seen != 0 && seen != epoch) {
+            quiescent = false;
+            break;
+        }
+    }
+    if (quiescent) {
+        __atomic_compare_exchange_n(&global_epoch, &epoch, epoch + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+        epoch = __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST);
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < retired_count; i++) {
+        if (retired[i].epoch + 2 <= epoch) {
+            retired[i].release(retired[i].ptr);
+        } else {
+            retired[kept++] = retired[i];
+        }
+    }
+    retired_count = kept;
+}
+
+// 辅助函数：登记一个已从表中摘下的对象, 等到没有读者能看到它时用 release 释放
+static void epoch_retire(void* ptr, void (*release)(void* ptr)) {
+    pthread_mutex_lock(&retire_lock);
+    if (retired_count == retired_capacity) {
+        size_t new_capacity = retired_capacity ? retired_capacity * 2 : KCMAP_RETIRE_BATCH;
+        KRetired* new_retired = realloc(retired, new_capacity * sizeof(KRetired));
+        if (!new_retired) {
+            fprintf(stderr, "Error: realloc failed in epoch_retire\n");
+            exit(EXIT_FAILURE);
+        }
+        retired = new_retired;
+        retired_capacity = new_capacity;
+    }
+    retired[retired_count++] = (KRetired){ptr, release, __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST)};
+    if (retired_count % KCMAP_RETIRE_BATCH == 0) epoch_collect();
+    pthread_mutex_unlock(&retire_lock);
+}
+
+// =============================================================================
+// 并发哈希表
+// =============================================================================
+
+// 表中的字符串 (位于 GC 堆之外)
+typedef struct KCMapString {
+    size_t length;
+    char chars[];
+} KCMapString;
+
+// 表中的大整数 (位于 GC 堆之外)
+typedef struct KCMapBigInt {
+    size_t length;
+    bool negative;
+    uint64_t limbs[];
+} KCMapBigInt;
+
+// 表中存放的键或值
+typedef struct KCMapItem {
+    uint8_t type;               // KValueType
+    bool bigint;                // type 为 KVAL_OBJECT 时: 大整数 (as.bigint) 还是字符串 (as.string)
+    union {
+        bool boolean;
+        long long integer;
+        double number;
+        KCMapString* string;
+        KCMapBigInt* bigint;
+    } as;
+} KCMapItem;
+
+// 结点创建后只有 next 会被 (持有分段锁的写者) 修改
+typedef struct KCMapNode {
+    struct KCMapNode* next;
+    uint32_t hash;
+    KCMapItem key;
+    KCMapItem value;
+} KCMapNode;
+
+typedef struct KCMapTable {
+    size_t mask;
+    KCMapNode* buckets[];
+} KCMapTable;
+
+struct KCMap {
+    KCMapTable* table;          // 读者原子地读取, 扩容时整体替换
+    size_t count;
+    int refs;
+    char* name;                 // 匿名表为 NULL
+    pthread_mutex_t stripes[KCMAP_STRIPES];
+};
+
+// 进程内的同名表
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static KCMap** registry;
+static size_t registry_count;
+
+bool kcmap_shareable(KValue value) {
+    return value.type != KVAL_OBJECT || value.as.object->type == KOBJ_STRING || value.as.object->type == KOBJ_BIGINT;
+}
+
+// 辅助函数：把可共享的值复制为表中的形式
+static KCMapItem item_from_value(KValue value) {
+    KCMapItem item = {.type = (uint8_t)value.type};
+    switch (value.type) {
+        case KVAL_NULL: break;
+        case KVAL_BOOL: item.as.boolean = value.as.boolean; break;
+        case KVAL_INT: item.as.integer = value.as.integer; break;
+        case KVAL_DOUBLE: item.as.number = value.as.number; break;
+        case KVAL_OBJECT: {
+            if (value.as.object->type == KOBJ_BIGINT) {
+                const KBigInt* big = (const KBigInt*)value.as.object;
+                item.bigint = true;
+                item.as.bigint = malloc(sizeof(KCMapBigInt) + big->length * sizeof(uint64_t));
+                if (!item.as.bigint) {
+                    fprintf(stderr, "Error: malloc failed in item_from_value\n");
+                    exit(EXIT_FAILURE);
+                }
+                item.as.bigint->length = big->length;
+                item.as.bigint->negative = big->negative;
+                memcpy(item.as.bigint->limbs, big->limbs, big->length * sizeof(uint64_t));
+                break;
+            }
+            const KString* str = (const KString*)value.as.object;
+            item.as.string = malloc(sizeof(KCMapString) + str->length);
+            if (!item.as.string) {
+                fprintf(stderr, "Error: malloc failed in item_from_value\n");
+                exit(EXIT_FAILURE);
+            }
+            item.as.string->length = str->length;
+            memcpy(item.as.string->chars, str->chars, str->length);
+            break;
+        }
+    }
+    return item;
+}
+
+// 辅助函数：在 heap 中重新创建表中的值
+static KValue item_to_value(KGCHeap* heap, const KCMapItem* item) {
+    switch ((KValueType)item->type) {
+        case KVAL_NULL: return KVALUE_NULL;
+        case KVAL_BOOL: return KVALUE_BOOL(item->as.boolean);
+        case KVAL_INT: return KVALUE_INT(item->as.integer);
+        case KVAL_DOUBLE: return KVALUE_DOUBLE(item->as.number);
+        case KVAL_OBJECT:
+            if (item->bigint) {
+                return kbigint_from_limbs(heap, item->as.bigint->limbs, item->as.bigint->length,
+                                          item->as.bigint->negative);
+            }
+            return KVALUE_OBJECT(kstring_new(heap, item->as.string->chars, item->as.string->length));
+    }
+    return KVALUE_NULL;
+}
+
+// 辅助函数：表中的键是否等于规范化之后的 key
+static bool item_equals(const KCMapItem* item, KValue key) {
+    if (item->type != key.type) return false;
+    switch (key.type) {
+        case KVAL_NULL: return true;
+        case KVAL_BOOL: return item->as.boolean == key.as.boolean;
+        case KVAL_INT: return item->as.integer == key.as.integer;
+        case KVAL_DOUBLE: return item->as.number == key.as.number;
+        case KVAL_OBJECT: {
+            if (item->bigint != (key.as.object->type == KOBJ_BIGINT)) return false;
+            if (item->bigint) {
+                const KBigInt* big = (const KBigInt*)key.as.object;
+                return item->as.bigint->negative == big->negative && item->as.bigint->length == big->length &&
+                       memcmp(item->as.bigint->limbs, big->limbs, big->length * sizeof(uint64_t)) == 0;
+            }
+            const KString* str = (const KString*)key.as.object;
+            return item->as.string->length == str->length &&
+                   memcmp(item->as.string->chars, str->chars, str->length) == 0;
+        }
+    }
+    return false;
+}
+
+// 辅助函数：释放表中的值在 GC 堆之外的部分
+static void item_free(const KCMapItem* item) {
+    if (item->type != KVAL_OBJECT) return;
+    if (item->bigint) {
+        free(item->as.bigint);
+    } else {
+        free(item->as.string);
+    }
+}
+
+static void free_node(void* ptr) {
+    KCMapNode* node = ptr;
+    item_free(&node->key);
+    item_free(&node->value);
+    free(node);
+}
+
+// 被更新替换的结点: 键的字符串或大整数已转给新结点, 只释放值与结点本身
+static void free_replaced_node(void* ptr) {
+    KCMapNode* node = ptr;
+    item_free(&node->value);
+    free(node);
+}
+
+static KCMapNode* node_new(uint32_t hash, KCMapItem key, KCMapItem value, KCMapNode* next) {
+    KCMapNode* node = malloc(sizeof(KCMapNode));
+    if (!node) {
+        fprintf(stderr, "Error: malloc failed in node_new\n");
+        exit(EXIT_FAILURE);
+    }
+    *node = (KCMapNode){next, hash, key, value};
+    return node;
+}
+
+static KCMapTable* cmap_table_new(size_t bucket_count) {
+    KCMapTable* table = calloc(1, sizeof(KCMapTable) + bucket_count * sizeof(KCMapNode*));
+    if (!table) {
+        fprintf(stderr, "Error: calloc failed in cmap_table_new\n");
+        exit(EXIT_FAILURE);
+    }
+    table->mask = bucket_count - 1;
+    return table;
+}
+
+KCMap* kcmap_open(const char* name) {
+    if (name) {
+        pthread_mutex_lock(&registry_lock);
+        for (size_t i = 0; i < registry_count; i++) {
+            if (strcmp(registry[i]->name, name) == 0) {
+                __atomic_fetch_add(&registry[i]->refs, 1, __ATOMIC_RELAXED);
+                pthread_mutex_unlock(&registry_lock);
+                return registry[i];
+            }
+        }
+    }
+    KCMap* map = calloc(1, sizeof(KCMap));
+    if (!map) {
+        fprintf(stderr, "Error: calloc failed in kcmap_open\n");
+        exit(EXIT_FAILURE);
+    }
+    map->table = cmap_table_new(KCMAP_STRIPES);
+    map->refs = 1;
+    for (size_t i = 0; i < KCMAP_STRIPES; i++) pthread_mutex_init(&map->stripes[i], NULL);
+    if (name) {
+        // 注册表持有一个引用, 同名的表一直存在到进程结束
+        KCMap** new_registry = realloc(registry, (registry_count + 1) * sizeof(KCMap*));
+        map->name = malloc(strlen(name) + 1);
+        if (!new_registry || !map->name) {
+            fprintf(stderr, "Error: malloc failed in kcmap_open\n");
+            exit(EXIT_FAILURE);
+        }
+        strcpy(map->name, name);
+        registry = new_registry;
+        registry[registry_count++] = map;
+        map->refs++;
+        pthread_mutex_unlock(&registry_lock);
+    }
+    return map;
+}
+
+void kcmap_release(KCMap* map) {
+    if (__atomic_sub_fetch(&map->refs, 1, __ATOMIC_ACQ_REL) != 0) return;
+    // 没有其他引用, 也就没有并发的读者, 可以直接释放
+    KCMapTable* table = map->table;
+    for (size_t i = 0; i <= table->mask; i++) {
+        KCMapNode* node = table->buckets[i];
+        while (node) {
+            KCMapNode* next = node->next;
+            free_node(node);
+            node = next;
+        }
+    }
+    free(table);
+    for (size_t i = 0; i < KCMAP_STRIPES; i++) pthread_mutex_destroy(&map->stripes[i]);
+    free(map);
+}
+
+size_t kcmap_count(const KCMap* map) {
+    return __atomic_load_n(&map->count, __ATOMIC_RELAXED);
+}
+
+bool kcmap_get(KCMap* map, KGCHeap* heap, KValue key, KValue* out) {
+    key = normalize_key(key);
+    uint32_t hash = hash_key(key);
+    KEpochRecord* record = epoch_enter();
+    KCMapTable* table = __atomic_load_n(&map->table, __ATOMIC_ACQUIRE);
+    KCMapNode* node = __atomic_load_n(&table->buckets[hash & table->mask], __ATOMIC_ACQUIRE);
+    while (node && !(node->hash == hash && item_equals(&node->key, key))) {
+        node = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+    }
+    // 结点在离开临界区之后可能被释放, 值要在临界区内复制出来
+    if (node && out) *out = item_to_value(heap, &node->value);
+    epoch_exit(record);
+    return node != NULL;
+}
+
+// 辅助函数：桶数组扩大一倍。锁定全部分段, 期间没有并发的写者; 读者继续读旧数组
+static void cmap_grow(KCMap* map, KCMapTable* expected) {
+    for (size_t i = 0; i < KCMAP_STRIPES; i++) pthread_mutex_lock(&map->stripes[i]);
+    KCMapTable* old = map->table;
+    if (old == expected) {
+        KCMapTable* table = cmap_table_new((old->mask + 1) * 2);
+        for (size_t i = 0; i <= old->mask; i++) {
+            for (KCMapNode* node = old->buckets[i]; node; node = node->next) {
+                // 新结点接管键与值的字符串, 旧结点只释放自身
+                KCMapNode** bucket = &table->buckets[node->hash & table->mask];
+                *bucket = node_new(node->hash, node->key, node->value, *bucket);
+            }
+        }
+        __atomic_store_n(&map->table, table, __ATOMIC_RELEASE);
+        for (size_t i = 0; i <= old->mask; i++) {
+            for (KCMapNode* node = old->buckets[i]; node; node = node->next) epoch_retire(node, free);
+        }
+        epoch_retire(old, free);
+    }
+    for (size_t i = KCMAP_STRIPES; i > 0; i--) pthread_mutex_unlock(&map->stripes[i - 1]);
+}
+
+bool kcmap_set(KCMap* map, KValue key, KValue value) {
+    if (!kcmap_shareable(value)) return false;
+    key = normalize_key(key);
+    uint32_t hash = hash_key(key);
+    KCMapItem item = item_from_value(value);
+    pthread_mutex_t* stripe = &map->stripes[hash % KCMAP_STRIPES];
+    pthread_mutex_lock(stripe);
+    // 持有分段锁时桶数组不会被替换, 本分段的桶只有本线程修改
+    KCMapTable* table = map->table;
+    KCMapNode** link = &table->buckets[hash & table->mask];
+    KCMapNode* node = *link;
+    while (node && !(node->hash == hash && item_equals(&node->key, key))) {
+        link = &node->next;
+        node = *link;
+    }
+    bool grow = false;
+    if (node) {
+        // 换上新结点, 正在读旧结点的读者仍然能沿着它的 next 继续遍历
+        KCMapNode* fresh = node_new(hash, node->key, item, node->next);
+        __atomic_store_n(link, fresh, __ATOMIC_RELEASE);
+        epoch_retire(node, free_replaced_node);
+    } else {
+        KCMapNode* fresh = node_new(hash, item_from_value(key), item, *link);
+        __atomic_store_n(link, fresh, __ATOMIC_RELEASE);
+        size_t count = __atomic_add_fetch(&map->count, 1, __ATOMIC_RELAXED);
+        grow = count > table->mask + 1;
+    }
+    pthread_mutex_unlock(stripe);
+    if (grow) cmap_grow(map, table);
+    return true;
+}
+
+bool kcmap_remove(KCMap* map, KValue key) {
+    key = normalize_key(key);
+    uint32_t hash = hash_key(key);
+    pthread_mutex_t* stripe = &map->stripes[hash % KCMAP_STRIPES];
+    pthread_mutex_lock(stripe);
+    KCMapTable* table = map->table;
+    KCMapNode** link = &table->buckets[hash & table->mask];
+    KCMapNode* node = *link;
+    while (node && !(node->hash == hash && item_equals(&node->key, key))) {
+        link = &node->next;
+        node = *link;
+    }
+    if (node) {
+        __atomic_store_n(link, node->next, __ATOMIC_RELEASE);
+        __atomic_sub_fetch(&map->count, 1, __ATOMIC_RELAXED);
+        epoch_retire(node, free_node);
+    }
+    pthread_mutex_unlock(stripe);
+    return node != NULL;
+}
+
+// 辅助函数：在一个纪元临界区内把所有键或值复制到 result 中
+static void cmap_collect(KCMap* map, KGCHeap* heap, KArray* result, bool want_values) {
+    KEpochRecord* record = epoch_enter();
+    KCMapTable* table = __atomic_load_n(&map->table, __ATOMIC_ACQUIRE);
+    for (size_t i = 0; i <= table->mask; i++) {
+        KCMapNode* node = __atomic_load_n(&table->buckets[i], __ATOMIC_ACQUIRE);
+        for (; node; node = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE)) {
+            karray_push(heap, result, item_to_value(heap, want_values ? &node->value : &node->key));
+        }
+    }
+    epoch_exit(record);
+}
+
+static void concurrent_map_finalize(KGCHeap* heap, KGCObject* obj) {
+    (void)heap;
+    kcmap_release(((KConcurrentMap*)obj)->shared);
+}
+
+static const KGCTypeInfo concurrent_map_type = {
+    .name = "concurrent map",
+    .trace = NULL,
+    .finalize = concurrent_map_finalize,
+};
+
+void kmap_init_types(void) {
+    kgc_register_type(KOBJ_MAP, &map_type);
+    kgc_register_type(KOBJ_CONCURRENT_MAP, &concurrent_map_type);
+}
+
+KConcurrentMap* kconcurrent_map_new(KGCHeap* heap, KCMap* shared) {
+    KConcurrentMap* handle = (KConcurrentMap*)kgc_alloc(heap, KOBJ_CONCURRENT_MAP, sizeof(KConcurrentMap));
+    handle->shared = shared;
+    return handle;
+}
+
+// =============================================================================
+// 原生函数
+// =============================================================================
+
+// ConcurrentMap() / ConcurrentMap(name) -> 并发哈希表句柄
+static KValue native_concurrent_map(KorelinVM* vm, int argc, const KValue* argv) {
+    if (argc > 1 || (argc == 1 && !kvalue_is_object_type(argv[0], KOBJ_STRING))) return KVALUE_NULL;
+    KCMap* shared = kcmap_open(argc == 1 ? ((KString*)argv[0].as.object)->chars : NULL);
+    return KVALUE_OBJECT(kconcurrent_map_new(vm->heap, shared));
+}
+
+// has(m, k) -> bool, m 也可以是持久化字典或并发哈希表
+static KValue native_has(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)vm;
+    (void)argc;
+    if (!kmap_valid_key(argv[1])) return KVALUE_BOOL(false);
+    if (kvalue_is_object_type(argv[0], KOBJ_PMAP)) {
+        return KVALUE_BOOL(kpmap_get((KPMap*)argv[0].as.object, argv[1], NULL));
+    }
+    if (kvalue_is_object_type(argv[0], KOBJ_CONCURRENT_MAP)) {
+        return KVALUE_BOOL(kcmap_get(((KConcurrentMap*)argv[0].as.object)->shared, vm->heap, argv[1], NULL));
+    }
+    if (!kvalue_is_object_type(argv[0], KOBJ_MAP)) return KVALUE_BOOL(false);
+    return KVALUE_BOOL(kmap_get((KMap*)argv[0].as.object, argv[1], NULL));
+}
+
+// remove(m, k) -> bool
+static KValue native_remove(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    if (!kmap_valid_key(argv[1])) return KVALUE_BOOL(false);
+    if (kvalue_is_object_type(argv[0], KOBJ_CONCURRENT_MAP)) {
+        return KVALUE_BOOL(kcmap_remove(((KConcurrentMap*)argv[0].as.object)->shared, argv[1]));
+    }
+    if (!kvalue_is_object_type(argv[0], KOBJ_MAP)) return KVALUE_BOOL(false);
+    return KVALUE_BOOL(kmap_remove(vm->heap, (KMap*)argv[0].as.object, argv[1]));
+}
+
+// 辅助函数：把结构体值复制一份 (值语义) 后追加到数组
+static void collect_item(KGCHeap* heap, KArray* result, KValue item) {
+    if (kvalue_is_object_type(item, KOBJ_STRUCT)) {
+        item = KVALUE_OBJECT(kstruct_copy(heap, (KStruct*)item.as.object));
+    }
+    karray_push(heap, result, item);
+}
+
+// 辅助函数：把字典 (或持久化字典、并发哈希表) 的所有键或值收集到数组中
+static KValue collect(KorelinVM* vm, KValue target, bool want_values) {
+    KGCHeap* heap = vm->heap;
+    KValue key, value;
+    if (kvalue_is_object_type(target, KOBJ_CONCURRENT_MAP)) {
+        KCMap* map = ((KConcurrentMap*)target.as.object)->shared;
+        KArray* result = karray_new(heap, kcmap_count(map));
+        kgc_push_root(heap, &result->obj);
+        cmap_collect(map, heap, result, want_values);
+        kgc_pop_roots(heap, 1);
+        return KVALUE_OBJECT(result);
+    }
+    if (kvalue_is_object_type(target, KOBJ_PMAP)) {
+        KPMap* map = (KPMap*)target.as.object;
+        KArray* result = karray_new(heap, map->count);
+        kgc_push_root(heap, &result->obj);
+        KPMapIter iter;
+        kpmap_iter_init(map, &iter);
+        while (kpmap_iter_next(&iter, &key, &value)) collect_item(heap, result, want_values ? value : key);
+        kgc_pop_roots(heap, 1);
+        return KVALUE_OBJECT(result);
+    }
+    if (!kvalue_is_object_type(target, KOBJ_MAP)) return KVALUE_NULL;
+    KMap* map = (KMap*)target.as.object;
+    KArray* result = karray_new(heap, map->count);
+    kgc_push_root(heap, &result->obj);
+    size_t cursor = 0;
+    while (kmap_next(map, &cursor, &key, &value)) collect_item(heap, result, want_values ? value : key);
+    kgc_pop_roots(heap, 1);
+    return KVALUE_OBJECT(result);
+}
+
+// keys(m) -> array
+static KValue native_keys(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    return collect(vm, argv[0], false);
+}
+
+// values(m) -> array
+static KValue native_values(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    return collect(vm, argv[0], true);
+}
+
+const KriNative kri_map_natives[] = {
+    {"has", 2, native_has},
+    {"remove", 2, native_remove},
+    {"keys", 1, native_keys},
+    {"values", 1, native_values},
+    {"ConcurrentMap", -1, native_concurrent_map},
+    {NULL, 0, NULL},
+};
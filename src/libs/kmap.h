@@ -5,4 +5,209 @@
 #ifndef KORELIN_KMAP_H
 #define KORELIN_KMAP_H
 
-#endif //KORELIN_KMAP_H
\ No newline at end of file
+#include "../krilib.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// =============================================================================
+// 哈希表 (SwissTable 式的开放寻址)
+//
+// 每个槽位对应一个控制字节: 空槽为 KMAP_EMPTY, 占用的槽位存放哈希的低 7 位 (H2)。
+// 查找从哈希的其余位 (H1) 决定的起始位置开始, 每次用 SIMD 比较 16 个控制字节,
+// 只有 H2 相同的槽位才比较缓存的完整哈希与键。槽位按线性探测排列 (每个键都在
+// 起始位置之后的第一个空槽之前), 删除时把后续的键向前移动填补空位, 不留墓碑,
+// 查找未命中时遇到空槽即可停止。控制字节数组末尾镜像开头的 16 个字节, 从任意
+// 位置开始的一组都可以直接加载。
+//
+// 键可以是 null、bool、int、double (与数值相等的 int 视为同一个键, NaN 除外) 和
+// 字符串 (按内容比较, 地址相同时直接命中: 虚拟机把字符串常量驻留为同一个对象)。
+// 同一个表既是脚本中的 {k: v} 字典, 也被运行时用作内部表 (如字符串驻留表)。
+// =============================================================================
+
+#define KMAP_GROUP 16           // 一次比较的控制字节数
+#define KMAP_EMPTY 0x80         // 空槽的控制字节
+
+// 槽位: 键与值的类型标记和缓存的哈希压缩在 8 个字节中, 每个槽位 24 字节
+typedef struct KMapEntry {
+    uint32_t hash;
+    uint8_t key_type;           // KValueType
+    uint8_t value_type;         // KValueType
+    union {
+        bool boolean;
+        long long integer;
+        double number;
+        KGCObject* object;
+    } key, value;
+} KMapEntry;
+
+// 哈希表对象
+typedef struct KMap {
+    KGCObject obj;
+    KMapEntry* entries;         // capacity 个槽位, 与控制字节位于同一块外部内存
+    uint8_t* ctrl;              // capacity + KMAP_GROUP 个控制字节
+    size_t count;
+    size_t capacity;            // 0 或 2 的幂 (至少 KMAP_GROUP)
+} KMap;
+
+// --- 函数声明 ---
+
+/**
+ * @brief 注册哈希表对象类型, 由 kobject_init_types 调用。
+ */
+void kmap_init_types(void);
+
+/**
+ * @brief 创建一个空表。
+ * @param heap 堆。
+ * @param capacity 预计的元素个数, 插入这么多元素之前不会扩容。
+ * @return 新的哈希表对象。
+ */
+KMap* kmap_new(KGCHeap* heap, size_t capacity);
+
+/**
+ * @brief 判断值能否作为键 (null、bool、int 与大整数、非 NaN 的 double 与字符串)。
+ */
+bool kmap_valid_key(KValue key);
+
+/**
+ * @brief 把整数值的 double 键规范化为 int 键, 其他键原样返回。
+ */
+KValue kmap_normalize_key(KValue key);
+
+/**
+ * @brief 键的哈希, key 必须是规范化之后的有效键。持久化字典 (kpersist.h) 与本表使用同一个哈希。
+ */
+uint32_t kmap_hash_key(KValue key);
+
+/**
+ * @brief 比较两个规范化之后的键; 字符串按内容比较, 大整数按值比较。
+ */
+bool kmap_keys_equal(KValue a, KValue b);
+
+/**
+ * @brief 查找键。
+ * @param map 哈希表。
+ * @param key 键, 必须满足 kmap_valid_key。
+ * @param out 找到时写入对应的值, 可以为 NULL。
+ * @return 是否找到。
+ */
+bool kmap_get(const KMap* map, KValue key, KValue* out);
+
+/**
+ * @brief 以 int 为键查找, 跳过通用的哈希与比较。
+ */
+bool kmap_get_int(const KMap* map, long long key, KValue* out);
+
+/**
+ * @brief 查找内容为 chars 的字符串键, 不需要先创建字符串对象。
+ * @param hash chars 的哈希, 即 kstring_hash(chars, length)。
+ * @return 找到的键 (字符串对象), 不存在时返回 NULL。
+ */
+KString* kmap_find_string(const KMap* map, const char* chars, size_t length, uint32_t hash);
+
+/**
+ * @brief 插入或更新一个键。
+ * @param heap 哈希表所在的堆。
+ * @param map 哈希表。
+ * @param key 键, 必须满足 kmap_valid_key。
+ * @param value 值。
+ */
+void kmap_set(KGCHeap* heap, KMap* map, KValue key, KValue value);
+
+/**
+ * @brief 删除一个键。
+ * @param heap 哈希表所在的堆 (删除会移动后续的槽位, 需要写屏障)。
+ * @param map 哈希表。
+ * @param key 键。
+ * @return 键存在并已删除时返回 true。
+ */
+bool kmap_remove(KGCHeap* heap, KMap* map, KValue key);
+
+/**
+ * @brief 按槽位顺序遍历。
+ * @param map 哈希表。
+ * @param cursor 遍历位置, 从 0 开始, 由本函数推进。遍历期间不能修改表。
+ * @param key 写入键。
+ * @param value 写入值, 可以为 NULL。
+ * @return 还有元素时返回 true。
+ */
+bool kmap_next(const KMap* map, size_t* cursor, KValue* key, KValue* value);
+
+// =============================================================================
+// 并发哈希表 (多个虚拟机线程共享)
+//
+// 表本身位于所有 GC 堆之外, 各虚拟机通过 KConcurrentMap 句柄对象访问, 同名的表在
+// 进程内只有一个。键与值只能是可以跨堆共享的值: null、bool、int、double 与字符串
+// (复制到表中, 读出时在读者的堆中重新创建)。
+//
+// 桶数组 + 链表: 读者不加锁, 在纪元 (epoch) 临界区中遍历; 写者按哈希锁定 64 个分段锁
+// 之一, 结点不可变, 更新时换上新结点, 被替换或删除的结点在所有可能看到它的读者
+// 离开临界区之后才释放 (基于纪元的内存回收)。扩容时锁定全部分段, 把结点复制到
+// 新的桶数组后整体发布。
+// =============================================================================
+
+typedef struct KCMap KCMap;
+
+// 并发哈希表的句柄 (KOBJ_CONCURRENT_MAP), 被回收时释放对共享表的引用
+typedef struct KConcurrentMap {
+    KGCObject obj;
+    KCMap* shared;
+} KConcurrentMap;
+
+/**
+ * @brief 打开并发哈希表。
+ * @param name 表名, 同名的表在进程内共享; NULL 表示创建匿名的新表。
+ * @return 表, 调用者持有一个引用。
+ */
+KCMap* kcmap_open(const char* name);
+
+/**
+ * @brief 释放一个引用, 匿名表的最后一个引用释放时销毁表。
+ */
+void kcmap_release(KCMap* map);
+
+/**
+ * @brief 创建句柄对象, 接管调用者持有的引用。
+ */
+KConcurrentMap* kconcurrent_map_new(KGCHeap* heap, KCMap* shared);
+
+/**
+ * @brief 判断值能否存入并发哈希表。
+ */
+bool kcmap_shareable(KValue value);
+
+/**
+ * @brief 查找键, 可以与其他线程的读写并发执行。
+ * @param heap 读出的字符串值在这个堆中创建。
+ * @param key 键, 必须满足 kmap_valid_key。
+ * @param out 找到时写入对应的值, 可以为 NULL。
+ * @return 是否找到。
+ */
+bool kcmap_get(KCMap* map, KGCHeap* heap, KValue key, KValue* out);
+
+/**
+ * @brief 插入或更新一个键。
+ * @param key 键, 必须满足 kmap_valid_key。
+ * @return value 不能共享时返回 false, 表不变。
+ */
+bool kcmap_set(KCMap* map, KValue key, KValue value);
+
+/**
+ * @brief 删除一个键。
+ * @return 键存在并已删除时返回 true。
+ */
+bool kcmap_remove(KCMap* map, KValue key);
+
+/**
+ * @brief 元素个数 (并发修改时为某一时刻的近似值)。
+ */
+size_t kcmap_count(const KCMap* map);
+
+// 哈希表相关的原生函数:
+//   has(m, k)、keys(m)、values(m)  m 可以是字典、持久化字典或并发哈希表
+//   remove(m, k)                   m 可以是字典或并发哈希表
+//   ConcurrentMap() / ConcurrentMap(name)  创建匿名的并发哈希表 / 打开进程内共享的同名表
+extern const KriNative kri_map_natives[];
+
+#endif //KORELIN_KMAP_H
@@ -2,4 +2,209 @@
 // Created by Helix on 2025/12/28.
 //
 
-#include "kmath.h"
\ No newline at end of file
+#include "kmath.h"
+#include "../kbigint.h"
+#include "../ksimd.h"
+#include "../kvm.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// 辅助函数：数值转换为 double, 不是数值时返回 false
+static bool number_value(KValue value, double* out) {
+    switch (value.type) {
+        case KVAL_INT: *out = (double)value.as.integer; return true;
+        case KVAL_DOUBLE: *out = value.as.number; return true;
+        default:
+            if (!kvalue_is_object_type(value, KOBJ_BIGINT)) return false;
+            *out = kbigint_to_double((const KBigInt*)value.as.object);
+            return true;
+    }
+}
+
+// 辅助函数：数组元素的 double 形式。double 数组直接返回元素缓冲区, 其他数组转换到 malloc 分配的
+// *buffer 中 (由调用者释放); 有不是数值的元素时返回 NULL
+static const double* array_doubles(const KArray* array, double** buffer) {
+    *buffer = NULL;
+    if (array->kind == KELEM_FLOAT64) return array->items.f64;
+    double* out = malloc((array->count ? array->count : 1) * sizeof(double));
+    if (!out) {
+        fprintf(stderr, "Error: malloc failed in array_doubles\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < array->count; i++) {
+        if (!number_value(karray_get(array, i), &out[i])) {
+            free(out);
+            return NULL;
+        }
+    }
+    *buffer = out;
+    return out;
+}
+
+// 辅助函数：与 source 形式对应的 double 结果数组 (见 kmath.h)
+static KArray* result_like(KorelinVM* vm, const KArray* source) {
+    if (source->kind == KELEM_FLOAT64) return karray_new_like(vm->heap, source, source->count);
+    return ktyped_array_new(vm->heap, KELEM_FLOAT64, source->count);
+}
+
+// =============================================================================
+// 逐元素的数学函数
+// =============================================================================
+
+// 辅助函数：sqrt/exp/log/sin/cos 的共同实现, 数值参数与数组元素使用同一个内核
+static KValue apply(KorelinVM* vm, KSimdMathFn fn, KValue x) {
+    double number;
+    if (number_value(x, &number)) {
+        ksimd_math(fn, &number, &number, 1);
+        return KVALUE_DOUBLE(number);
+    }
+    if (!kvalue_is_array(x)) return KVALUE_NULL;
+    const KArray* array = (const KArray*)x.as.object;
+    double* buffer;
+    const double* input = array_doubles(array, &buffer);
+    if (!input) return KVALUE_NULL;
+    // 结果数组的分配不会回收 x (位于虚拟机栈上), 元素缓冲区不会移动
+    KArray* result = result_like(vm, array);
+    ksimd_math(fn, result->items.f64, input, array->count);
+    free(buffer);
+    return KVALUE_OBJECT(result);
+}
+
+// sqrt(x) / exp(x) / log(x) / sin(x) / cos(x) -> double | array
+static KValue native_sqrt(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    return apply(vm, KSIMD_SQRT, argv[0]);
+}
+
+static KValue native_exp(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    return apply(vm, KSIMD_EXP, argv[0]);
+}
+
+static KValue native_log(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    return apply(vm, KSIMD_LOG, argv[0]);
+}
+
+static KValue native_sin(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    return apply(vm, KSIMD_SIN, argv[0]);
+}
+
+static KValue native_cos(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    return apply(vm, KSIMD_COS, argv[0]);
+}
+
+// pow(x, y) -> double | array
+static KValue native_pow(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    double x, y;
+    bool x_number = number_value(argv[0], &x);
+    bool y_number = number_value(argv[1], &y);
+    if (x_number && y_number) return KVALUE_DOUBLE(pow(x, y));
+
+    const KArray* a = !x_number && kvalue_is_array(argv[0]) ? (const KArray*)argv[0].as.object : NULL;
+    const KArray* b = !y_number && kvalue_is_array(argv[1]) ? (const KArray*)argv[1].as.object : NULL;
+    if ((!x_number && !a) || (!y_number && !b) || (a && b && a->count != b->count)) return KVALUE_NULL;
+
+    double* a_buffer = NULL;
+    double* b_buffer = NULL;
+    const double* base = a ? array_doubles(a, &a_buffer) : &x;
+    const double* exponent = b ? array_doubles(b, &b_buffer) : &y;
+    if (!base || !exponent) {
+        free(a_buffer);
+        free(b_buffer);
+        return KVALUE_NULL;
+    }
+    const KArray* shape = a ? a : b;
+    KArray* result = result_like(vm, shape);
+    double* out = result->items.f64;
+    for (size_t i = 0; i < shape->count; i++) {
+        out[i] = pow(a ? base[i] : x, b ? exponent[i] : y);
+    }
+    free(a_buffer);
+    free(b_buffer);
+    return KVALUE_OBJECT(result);
+}
+
+// =============================================================================
+// 归约
+// =============================================================================
+
+// 辅助函数：variance/stddev 的共同实现, 空数组或有非数值元素时返回 false
+static bool variance_of(KValue value, double* out) {
+    if (!kvalue_is_array(value)) return false;
+    const KArray* array = (const KArray*)value.as.object;
+    if (array->count == 0) return false;
+    double* buffer;
+    const double* data = array_doubles(array, &buffer);
+    if (!data) return false;
+    double n = (double)array->count;
+    double mean = ksimd_fsum(data, array->count) / n;
+    double deviation;
+    double squares = ksimd_fsum_squares(data, array->count, mean, &deviation);
+    free(buffer);
+    *out = (squares - deviation * deviation / n) / n;
+    return true;
+}
+
+// fsum(a) -> double
+static KValue native_fsum(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)vm;
+    (void)argc;
+    if (!kvalue_is_array(argv[0])) return KVALUE_NULL;
+    const KArray* array = (const KArray*)argv[0].as.object;
+    double* buffer;
+    const double* data = array_doubles(array, &buffer);
+    if (!data) return KVALUE_NULL;
+    double sum = ksimd_fsum(data, array->count);
+    free(buffer);
+    return KVALUE_DOUBLE(sum);
+}
+
+// mean(a) -> double | null
+static KValue native_mean(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)vm;
+    (void)argc;
+    if (!kvalue_is_array(argv[0])) return KVALUE_NULL;
+    const KArray* array = (const KArray*)argv[0].as.object;
+    if (array->count == 0) return KVALUE_NULL;
+    double* buffer;
+    const double* data = array_doubles(array, &buffer);
+    if (!data) return KVALUE_NULL;
+    double sum = ksimd_fsum(data, array->count);
+    free(buffer);
+    return KVALUE_DOUBLE(sum / (double)array->count);
+}
+
+// variance(a) -> double | null
+static KValue native_variance(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)vm;
+    (void)argc;
+    double variance;
+    return variance_of(argv[0], &variance) ? KVALUE_DOUBLE(variance) : KVALUE_NULL;
+}
+
+// stddev(a) -> double | null
+static KValue native_stddev(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)vm;
+    (void)argc;
+    double variance;
+    return variance_of(argv[0], &variance) ? KVALUE_DOUBLE(sqrt(variance)) : KVALUE_NULL;
+}
+
+const KriNative kri_math_natives[] = {
+    {"sqrt", 1, native_sqrt},
+    {"exp", 1, native_exp},
+    {"log", 1, native_log},
+    {"sin", 1, native_sin},
+    {"cos", 1, native_cos},
+    {"pow", 2, native_pow},
+    {"fsum", 1, native_fsum},
+    {"mean", 1, native_mean},
+    {"variance", 1, native_variance},
+    {"stddev", 1, native_stddev},
+    {NULL, 0, NULL},
+};
@@ -5,4 +5,26 @@
 #ifndef KORELIN_KMATH_H
 #define KORELIN_KMATH_H
 
-#endif //KORELIN_KMATH_H
\ No newline at end of file
+#include "../krilib.h"
+
+// =============================================================================
+// 数学函数原生函数:
+//   sqrt(x) / exp(x) / log(x) / sin(x) / cos(x)
+//                      x 为数值 (int、double 或大整数) 时返回 double; x 为数组时逐元素
+//                      计算, 返回新数组
+//   pow(x, y)          x^y 的 double 结果; x、y 可以是数值或数组, 都是数组时长度必须相同
+//   fsum(a)            补偿求和, 结果与元素顺序基本无关, 误差不随元素个数增长
+//   mean(a)            算术平均, 空数组返回 null
+//   variance(a)        总体方差 (除以 n), 空数组返回 null
+//   stddev(a)          总体标准差
+//
+// 数组版本的结果与 a 的存储形式相同 (普通 double 数组或 Float64Array), 整数数组与
+// 装箱数组的结果为 Float64Array。sqrt 正确舍入; exp、log、sin、cos 由 ksimd_math 以
+// 向量化的多项式计算, 误差不超过 1 ulp, 数值参数与数组元素的结果逐位相同。pow 逐个
+// 元素调用 libm。方差使用两遍算法: 先以补偿求和得到均值, 再累加与均值之差的平方,
+// 并用差之和修正均值的舍入误差。参数类型不符时返回 null。
+// =============================================================================
+
+extern const KriNative kri_math_natives[];
+
+#endif //KORELIN_KMATH_H
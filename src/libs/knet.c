@@ -2,4 +2,2207 @@
 // Created by Helix on 2025/12/28.
 //
 
-#include "knet.h"
\ No newline at end of file
+#define _GNU_SOURCE
+
+#include "knet.h"
+#include "../ksimd.h"
+#include "../kuring.h"
+#include "../kvm.h"
+#include "../kwheel.h"
+#include "kmap.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define KNET_MAX_EVENTS 256
+#define KNET_MAX_IOV 16
+
+// io_uring 请求的种类, 保存在 user_data 的低 3 位 (高位是套接字的地址); user_data 为 0 的
+// 请求 (取消) 的完成项被忽略
+typedef enum {
+    KNET_OP_ACCEPT = 1,     // 多发的 accept
+    KNET_OP_RECV,           // 多发的 recv, 从提供缓冲环中取缓冲
+    KNET_OP_SEND,           // sendmsg, 发送缓冲头部的若干块
+    KNET_OP_POLL,           // 等待可写: 非阻塞 connect 完成或 sendfile 遇到 EAGAIN
+} KNetOp;
+
+#define KNET_OP_MASK 7
+
+// 事件 (处理函数表的下标)
+typedef enum {
+    KNET_ON_ACCEPT,
+    KNET_ON_CONNECT,
+    KNET_ON_DATA,
+    KNET_ON_DRAIN,
+    KNET_ON_CLOSE,
+    KNET_ON_REQUEST,        // 只用于 httpListen, 不能出现在 handlers 中
+    KNET_EVENT_COUNT,
+} KNetEvent;
+
+static const char* const event_names[KNET_EVENT_COUNT] = {"accept", "connect", "data", "drain", "close", "request"};
+
+// 处理函数表, 由监听器与它接受的连接共享
+typedef struct KNetHandlers {
+    size_t refs;
+    KGCHandle* fn[KNET_EVENT_COUNT];    // NULL 表示未设置
+} KNetHandlers;
+
+// 发送缓冲块
+typedef struct KNetChunk {
+    struct KNetChunk* next;
+    size_t start;           // 未发送部分的起点
+    size_t end;
+    char data[KNET_CHUNK_SIZE];
+} KNetChunk;
+
+typedef struct KNetHttp KNetHttp;
+
+// 监听器或连接
+typedef struct KNetSocket {
+    int fd;
+    uint32_t slot;
+    bool listener;
+    bool http_server;       // httpListen 的监听器, 接受的连接按 HTTP/1.1 处理
+    bool connecting;        // 非阻塞 connect 尚未完成
+    bool readable;          // 上次读取没有读到 EAGAIN (边沿触发下不会再次通知)
+    bool writable;          // 上次写入没有遇到 EAGAIN
+    bool paused;            // netPause
+    bool throttled;         // netSend 返回过 false, 等待发送缓冲回落
+    bool closing;           // 发送完缓冲后关闭
+    bool closed;
+    bool queued;            // 在就绪队列中
+    KNetHandlers* handlers;
+    KNetChunk* head;
+    KNetChunk* tail;
+    size_t pending;         // 待发送的字节数
+    int file_fd;            // 发送缓冲之后由 sendfile 发送的文件, 没有时为 -1
+    off_t file_offset;
+    size_t file_remaining;
+    KNetHttp* http;         // HTTP 连接的状态, 其他套接字为 NULL
+    KFiber* reader;         // 在 netRecv 中等待数据的协程 (只用于没有 data 处理函数的连接)
+    struct KNetSocket* next;    // 就绪队列或待释放链表
+    // 以下只用于 io_uring 后端
+    uint32_t inflight;      // 内核中未完成的请求数, 为 0 之前不能释放
+    bool registered;        // 登记在注册文件表中 (下标为槽位)
+    bool recv_armed;        // 多发的 recv (监听器为 accept) 仍在进行
+    bool recv_cancelling;   // 已经提交了对 recv 的取消
+    bool send_inflight;
+    bool send_queued;       // 在待提交的发送链表中
+    bool poll_armed;
+    bool eof;               // 对端已关闭, 处理完暂存的数据后按 EOF 处理
+    KNetChunk* held_head;   // 暂停读取期间收到的数据
+    KNetChunk* held_tail;
+    struct msghdr send_msg; // 进行中的 sendmsg 的参数, 请求完成前必须保持不变
+    struct iovec send_iov[KNET_MAX_IOV];
+    struct KNetSocket* next_send;
+} KNetSocket;
+
+// setTimeout / setInterval 的定时器, 按块分配, 地址在事件循环的生命期内不变
+typedef struct KNetTimer {
+    KTimer node;
+    KGCHandle* fn;          // 空闲时为 NULL
+    KFiber* fiber;          // sleep 的定时器: 到期时唤醒的协程 (此时 fn 为 NULL)
+    KGCHandle* arg_handle;  // arg 是对象时持有它
+    KValue arg;
+    bool has_arg;
+    long long interval;     // setInterval 的周期 (毫秒), setTimeout 为 0
+    uint32_t index;
+    uint32_t generation;    // 释放时递增使旧 id 失效
+} KNetTimer;
+
+// HTTP 连接的接收缓冲与当前请求
+struct KNetHttp {
+    char* data;             // [start, length) 是尚未处理的数据, 空闲时为 NULL
+    size_t start;
+    size_t length;
+    size_t capacity;
+    KNetChunk* chunk;       // data 取自池中的块时为该块, 扩大后单独分配时为 NULL
+    const struct KHttpRequest* current;     // 处理函数执行期间的请求
+    bool responded;         // 当前请求已经响应
+    bool processing;        // 正在 http_process 中 (处理函数可能间接触发 flush)
+    bool last;              // 不再处理后续请求, 输出完成后关闭
+    bool borrowed;          // data 是 io_uring 提供缓冲环中的缓冲, 处理完前必须复制出来
+};
+
+struct KNetLoop {
+    int epoll_fd;           // epoll 后端; 使用 io_uring 时为 -1
+    KURing* ring;           // io_uring 后端, 不可用时为 NULL
+    KURingBuffers buffers;  // 多发 recv 使用的提供缓冲环
+    bool files_registered;  // 注册文件表可用
+    size_t stalled;         // 因文件描述符耗尽而停止 accept 的监听器数
+    KNetSocket* sends;      // 待提交 sendmsg 的套接字
+    KNetSocket** slots;     // 按槽位下标, 空闲槽位为 NULL
+    uint32_t* generations;  // 槽位的代数, 关闭时递增使旧 id 失效
+    uint32_t* free_slots;
+    size_t slot_count;
+    size_t slot_capacity;
+    size_t free_count;
+    size_t live;            // 未关闭的套接字数
+    KNetSocket* ready;      // 还有数据可读的连接
+    KNetSocket* ready_tail;
+    KNetSocket* dead;       // 已关闭、等待释放的套接字 (同一批事件中可能还引用它们)
+    KNetChunk* pool;
+    size_t pool_count;
+    char* read_buffer;
+    KWheel wheel;           // 定时器 (1 刻度为 1 毫秒)
+    KNetTimer** timer_blocks;   // 每块 KNET_TIMER_BLOCK 个
+    size_t timer_block_count;
+    uint32_t* free_timers;
+    size_t free_timer_count;
+    size_t timers;          // 未到期或未取消的定时器数
+    size_t parked;          // 在 sleep 或 netRecv 中挂起的协程数
+    time_t date_time;       // date 对应的秒数
+    char date[32];          // 缓存的 HTTP Date 头的值
+    bool running;
+    bool stopped;
+    bool failed;            // 处理函数出现运行时错误
+};
+
+// 辅助函数：分配内存, 失败时退出
+static void* net_alloc(size_t size, const char* where) {
+    void* p = malloc(size);
+    if (!p) {
+        fprintf(stderr, "Error: malloc failed in %s\n", where);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+// 辅助函数：单调时钟的毫秒数
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// 辅助函数：尝试启用 io_uring 后端, 内核缺少所需的特性时保持 loop->ring 为 NULL
+static void uring_open(KNetLoop* loop) {
+    KURing* ring = net_alloc(sizeof(KURing), "uring_open");
+    if (!kuring_init(ring, KNET_URING_ENTRIES)) {
+        free(ring);
+        return;
+    }
+    // 多发 recv 与 IORING_OP_SEND_ZC 在同一个内核版本 (6.0) 中加入, 用后者探测前者
+    if (!kuring_supports(ring, IORING_OP_SEND_ZC) ||
+        !kuring_buffers_init(ring, &loop->buffers, 0, KNET_URING_BUFFERS, KNET_CHUNK_SIZE)) {
+        kuring_free(ring);
+        free(ring);
+        return;
+    }
+    // 稀疏的注册文件表, 下标与套接字的槽位相同; 注册失败时直接使用文件描述符
+    int* files = net_alloc(KNET_URING_FILES * sizeof(int), "uring_open");
+    for (int i = 0; i < KNET_URING_FILES; i++) files[i] = -1;
+    loop->files_registered = kuring_register(ring, IORING_REGISTER_FILES, files, KNET_URING_FILES) == 0;
+    free(files);
+    loop->ring = ring;
+}
+
+// 辅助函数：取得虚拟机的事件循环, 第一次使用时创建。默认使用 io_uring, 不可用或环境变量
+// KORELIN_NET_BACKEND 为 "epoll" 时使用 epoll
+static KNetLoop* get_loop(KorelinVM* vm) {
+    if (vm->net) return vm->net;
+    KNetLoop* loop = calloc(1, sizeof(KNetLoop));
+    if (!loop) {
+        fprintf(stderr, "Error: calloc failed in get_loop\n");
+        exit(EXIT_FAILURE);
+    }
+    loop->epoll_fd = -1;
+    const char* backend = getenv("KORELIN_NET_BACKEND");
+    if (!backend || strcmp(backend, "epoll") != 0) uring_open(loop);
+    if (!loop->ring) {
+        loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (loop->epoll_fd < 0) {
+            perror("Error: epoll_create1 failed in get_loop");
+            exit(EXIT_FAILURE);
+        }
+    }
+    loop->read_buffer = net_alloc(KNET_READ_SIZE, "get_loop");
+    kwheel_init(&loop->wheel, (uint64_t)now_ms());
+    vm->net = loop;
+    return loop;
+}
+
+// =============================================================================
+// 发送缓冲块池
+// =============================================================================
+
+static KNetChunk* chunk_get(KNetLoop* loop) {
+    KNetChunk* chunk = loop->pool;
+    if (chunk) {
+        loop->pool = chunk->next;
+        loop->pool_count--;
+    } else {
+        chunk = net_alloc(sizeof(KNetChunk), "chunk_get");
+    }
+    chunk->next = NULL;
+    chunk->start = 0;
+    chunk->end = 0;
+    return chunk;
+}
+
+static void chunk_put(KNetLoop* loop, KNetChunk* chunk) {
+    if (loop->pool_count >= KNET_POOL_MAX) {
+        free(chunk);
+        return;
+    }
+    chunk->next = loop->pool;
+    loop->pool = chunk;
+    loop->pool_count++;
+}
+
+// 辅助函数：把数据追加到块链表
+static void chunks_append(KNetLoop* loop, KNetChunk** head, KNetChunk** tail, const char* data, size_t size) {
+    while (size > 0) {
+        if (!*tail || (*tail)->end == KNET_CHUNK_SIZE) {
+            KNetChunk* chunk = chunk_get(loop);
+            if (*tail) {
+                (*tail)->next = chunk;
+            } else {
+                *head = chunk;
+            }
+            *tail = chunk;
+        }
+        size_t n = KNET_CHUNK_SIZE - (*tail)->end;
+        if (n > size) n = size;
+        memcpy((*tail)->data + (*tail)->end, data, n);
+        (*tail)->end += n;
+        data += n;
+        size -= n;
+    }
+}
+
+static void chunks_clear(KNetLoop* loop, KNetChunk** head, KNetChunk** tail) {
+    while (*head) {
+        KNetChunk* next = (*head)->next;
+        chunk_put(loop, *head);
+        *head = next;
+    }
+    *tail = NULL;
+}
+
+// 辅助函数：把数据追加到发送缓冲
+static void buffer_append(KNetLoop* loop, KNetSocket* s, const char* data, size_t size) {
+    s->pending += size;
+    chunks_append(loop, &s->head, &s->tail, data, size);
+}
+
+// 辅助函数：从发送缓冲头部移除已写出的字节
+static void buffer_consume(KNetLoop* loop, KNetSocket* s, size_t written) {
+    s->pending -= written;
+    while (written > 0) {
+        KNetChunk* chunk = s->head;
+        size_t size = chunk->end - chunk->start;
+        if (written < size) {
+            chunk->start += written;
+            break;
+        }
+        written -= size;
+        s->head = chunk->next;
+        if (!s->head) s->tail = NULL;
+        chunk_put(loop, chunk);
+    }
+}
+
+// 辅助函数：丢弃发送缓冲
+static void buffer_clear(KNetLoop* loop, KNetSocket* s) {
+    chunks_clear(loop, &s->head, &s->tail);
+    s->pending = 0;
+}
+
+// 辅助函数：释放 HTTP 接收缓冲, 缓冲中的数据必须已处理完
+static void http_release_buffer(KNetLoop* loop, KNetHttp* http) {
+    if (http->borrowed) {
+        http->borrowed = false;
+    } else if (http->chunk) {
+        chunk_put(loop, http->chunk);
+    } else {
+        free(http->data);
+    }
+    http->data = NULL;
+    http->chunk = NULL;
+    http->start = 0;
+    http->length = 0;
+    http->capacity = 0;
+}
+
+static void http_free(KNetLoop* loop, KNetHttp* http) {
+    http_release_buffer(loop, http);
+    free(http);
+}
+
+// =============================================================================
+// 处理函数与套接字表
+// =============================================================================
+
+static void handlers_release(KGCHeap* heap, KNetHandlers* handlers) {
+    if (!handlers || --handlers->refs > 0) return;
+    for (int i = 0; i < KNET_EVENT_COUNT; i++) {
+        if (handlers->fn[i]) kgc_handle_free(heap, handlers->fn[i]);
+    }
+    free(handlers);
+}
+
+// 辅助函数：解析处理函数表, 键不是事件名或值不是函数时返回 NULL
+static KNetHandlers* handlers_from(KorelinVM* vm, KValue value) {
+    if (!kvalue_is_object_type(value, KOBJ_MAP)) return NULL;
+    const KMap* map = (const KMap*)value.as.object;
+    KGCObject* fn[KNET_EVENT_COUNT] = {NULL};
+    size_t cursor = 0;
+    KValue key;
+    KValue handler;
+    while (kmap_next(map, &cursor, &key, &handler)) {
+        if (!kvalue_is_object_type(key, KOBJ_STRING)) return NULL;
+        if (!kvalue_is_object_type(handler, KOBJ_FUNCTION) && !kvalue_is_object_type(handler, KOBJ_NATIVE)) {
+            return NULL;
+        }
+        const KString* name = (const KString*)key.as.object;
+        int event = 0;
+        while (event < KNET_ON_REQUEST &&
+               (strlen(event_names[event]) != name->length ||
+                memcmp(event_names[event], name->chars, name->length) != 0)) {
+            event++;
+        }
+        if (event == KNET_ON_REQUEST) return NULL;
+        fn[event] = handler.as.object;
+    }
+
+    KNetHandlers* handlers = net_alloc(sizeof(KNetHandlers), "handlers_from");
+    handlers->refs = 1;
+    for (int i = 0; i < KNET_EVENT_COUNT; i++) {
+        handlers->fn[i] = fn[i] ? kgc_handle_new(vm->heap, fn[i]) : NULL;
+    }
+    return handlers;
+}
+
+static long long socket_id(const KNetLoop* loop, const KNetSocket* s) {
+    return ((long long)loop->generations[s->slot] << 32) | s->slot;
+}
+
+// 辅助函数：按 id 查找未关闭的套接字
+static KNetSocket* find_socket(KorelinVM* vm, KValue id) {
+    KNetLoop* loop = vm->net;
+    if (!loop || id.type != KVAL_INT || id.as.integer < 0) return NULL;
+    uint64_t slot = (uint64_t)id.as.integer & 0xFFFFFFFFu;
+    uint64_t generation = (uint64_t)id.as.integer >> 32;
+    if (slot >= loop->slot_count || loop->generations[slot] != generation) return NULL;
+    KNetSocket* s = loop->slots[slot];
+    return s && !s->closed ? s : NULL;
+}
+
+// =============================================================================
+// 定时器
+//
+// 所有定时器放在事件循环的时间轮中, 插入与取消都是 O(1)。netRun 每次等待事件后把时间轮
+// 推进到当前时间, 一次取出所有到期的定时器, 再依次调用它们的函数。
+// =============================================================================
+
+static KNetTimer* timer_at(const KNetLoop* loop, uint32_t index) {
+    return &loop->timer_blocks[index / KNET_TIMER_BLOCK][index % KNET_TIMER_BLOCK];
+}
+
+// 辅助函数：取得一个空闲的定时器, 没有时分配新的一块
+static KNetTimer* timer_alloc(KNetLoop* loop) {
+    if (loop->free_timer_count == 0) {
+        size_t block = loop->timer_block_count;
+        KNetTimer** blocks = realloc(loop->timer_blocks, (block + 1) * sizeof(KNetTimer*));
+        uint32_t* free_timers = realloc(loop->free_timers, (block + 1) * KNET_TIMER_BLOCK * sizeof(uint32_t));
+        if (!blocks || !free_timers) {
+            fprintf(stderr, "Error: realloc failed in timer_alloc\n");
+            exit(EXIT_FAILURE);
+        }
+        loop->timer_blocks = blocks;
+        loop->free_timers = free_timers;
+        blocks[block] = calloc(KNET_TIMER_BLOCK, sizeof(KNetTimer));
+        if (!blocks[block]) {
+            fprintf(stderr, "Error: calloc failed in timer_alloc\n");
+            exit(EXIT_FAILURE);
+        }
+        loop->timer_block_count++;
+        // 倒序压入, 使下标小的定时器先被使用
+        for (size_t i = KNET_TIMER_BLOCK; i > 0; i--) {
+            uint32_t index = (uint32_t)(block * KNET_TIMER_BLOCK + i - 1);
+            blocks[block][i - 1].index = index;
+            loop->free_timers[loop->free_timer_count++] = index;
+        }
+    }
+    KNetTimer* timer = timer_at(loop, loop->free_timers[--loop->free_timer_count]);
+    loop->timers++;
+    return timer;
+}
+
+// 辅助函数：取消并释放定时器, 它的 id 随之失效
+static void timer_release(KorelinVM* vm, KNetTimer* timer) {
+    KNetLoop* loop = vm->net;
+    kwheel_remove(&loop->wheel, &timer->node);
+    if (timer->fn) kgc_handle_free(vm->heap, timer->fn);
+    if (timer->arg_handle) kgc_handle_free(vm->heap, timer->arg_handle);
+    timer->fn = NULL;
+    timer->fiber = NULL;
+    timer->arg_handle = NULL;
+    timer->generation++;
+    loop->free_timers[loop->free_timer_count++] = timer->index;
+    loop->timers--;
+}
+
+static long long timer_id(const KNetTimer* timer) {
+    return ((long long)timer->generation << 32) | timer->index;
+}
+
+// 辅助函数：按 id 查找未到期或未取消的定时器 (sleep 的定时器不对脚本公开)
+static KNetTimer* find_timer(KorelinVM* vm, KValue id) {
+    KNetLoop* loop = vm->net;
+    if (!loop || id.type != KVAL_INT || id.as.integer < 0) return NULL;
+    uint64_t index = (uint64_t)id.as.integer & 0xFFFFFFFFu;
+    uint64_t generation = (uint64_t)id.as.integer >> 32;
+    if (index >= loop->timer_block_count * KNET_TIMER_BLOCK) return NULL;
+    KNetTimer* timer = timer_at(loop, (uint32_t)index);
+    return timer->fn && timer->generation == generation ? timer : NULL;
+}
+
+// 辅助函数：距下一次需要推进时间轮的毫秒数; 没有定时器时返回 -1
+static long long timer_timeout(KNetLoop* loop) {
+    uint64_t tick;
+    if (loop->timers == 0 || !kwheel_next(&loop->wheel, &tick)) return -1;
+    long long remaining = (long long)tick - now_ms();
+    return remaining > 0 ? remaining : 0;
+}
+
+// 辅助函数：调用所有到期的定时器; 周期定时器在调用前重新插入, 使函数中的 clearInterval 生效
+static void run_timers(KorelinVM* vm) {
+    KNetLoop* loop = vm->net;
+    if (loop->timers == 0) return;
+    long long now = now_ms();
+    KTimer expired;
+    kwheel_list_init(&expired);
+    kwheel_advance(&loop->wheel, (uint64_t)now, &expired);
+    while (expired.next != &expired) {
+        KNetTimer* timer = (KNetTimer*)expired.next;
+        kwheel_remove(&loop->wheel, &timer->node);
+        if (timer->fiber) {
+            // sleep 结束: 协程回到运行队列, 由调度器执行
+            KFiber* fiber = timer->fiber;
+            timer_release(vm, timer);
+            loop->parked--;
+            kvm_wake(vm, fiber, KVALUE_BOOL(true));
+            continue;
+        }
+        if (loop->stopped) {
+            // netStop 或运行时错误: 剩下的定时器留到下一次 netRun
+            kwheel_add(&loop->wheel, &timer->node, timer->node.expires);
+            continue;
+        }
+        // 调用期间函数与参数在虚拟机的栈上, 一次性定时器可以先释放
+        KValue fn = KVALUE_OBJECT(timer->fn->object);
+        KValue arg = timer->arg_handle ? KVALUE_OBJECT(timer->arg_handle->object) : timer->arg;
+        int argc = timer->has_arg ? 1 : 0;
+        if (timer->interval > 0) {
+            // 按原定的节拍续期; 落后太多时从现在起算, 不补发错过的周期
+            long long next = (long long)timer->node.expires + timer->interval;
+            kwheel_add(&loop->wheel, &timer->node, (uint64_t)(next > now ? next : now + timer->interval));
+        } else {
+            timer_release(vm, timer);
+        }
+        if (!kvm_call(vm, fn, argc, &arg, NULL)) {
+            loop->failed = true;
+            loop->stopped = true;
+        }
+    }
+}
+
+// =============================================================================
+// io_uring 请求
+//
+// 请求先留在提交队列中, 由 netRun 在等待完成时一次提交。套接字登记在注册文件表中时以
+// 槽位代替文件描述符 (IOSQE_FIXED_FILE), 内核不必每次查找文件。
+// =============================================================================
+
+static uint64_t op_data(const KNetSocket* s, KNetOp op) {
+    return (uint64_t)(uintptr_t)s | (uint64_t)op;
+}
+
+static struct io_uring_sqe* op_sqe(KNetLoop* loop, KNetSocket* s, uint8_t opcode, KNetOp op) {
+    struct io_uring_sqe* sqe = kuring_get_sqe(loop->ring);
+    sqe->opcode = opcode;
+    if (s->registered) {
+        sqe->fd = (int)s->slot;
+        sqe->flags = IOSQE_FIXED_FILE;
+    } else {
+        sqe->fd = s->fd;
+    }
+    sqe->user_data = op_data(s, op);
+    s->inflight++;
+    return sqe;
+}
+
+// 辅助函数：把套接字登记到注册文件表中槽位对应的位置 (fd 为 -1 时注销)
+static bool uring_update_file(KNetLoop* loop, uint32_t slot, int fd) {
+    if (!loop->files_registered || slot >= KNET_URING_FILES) return false;
+    struct io_uring_files_update update;
+    memset(&update, 0, sizeof(update));
+    update.offset = slot;
+    update.fds = (uint64_t)(uintptr_t)&fd;
+    return kuring_register(loop->ring, IORING_REGISTER_FILES_UPDATE, &update, 1) == 1;
+}
+
+static void uring_arm_accept(KNetLoop* loop, KNetSocket* s) {
+    struct io_uring_sqe* sqe = op_sqe(loop, s, IORING_OP_ACCEPT, KNET_OP_ACCEPT);
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    s->recv_armed = true;
+}
+
+static void uring_arm_recv(KNetLoop* loop, KNetSocket* s) {
+    struct io_uring_sqe* sqe = op_sqe(loop, s, IORING_OP_RECV, KNET_OP_RECV);
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = loop->buffers.group;
+    s->recv_armed = true;
+}
+
+static void uring_arm_poll(KNetLoop* loop, KNetSocket* s) {
+    if (s->poll_armed) return;
+    struct io_uring_sqe* sqe = op_sqe(loop, s, IORING_OP_POLL_ADD, KNET_OP_POLL);
+    sqe->poll32_events = POLLOUT;
+    s->poll_armed = true;
+}
+
+// 辅助函数：取消套接字的某种请求 (取消本身的完成项被忽略)
+static void uring_cancel(KNetLoop* loop, KNetSocket* s, KNetOp op) {
+    struct io_uring_sqe* sqe = kuring_get_sqe(loop->ring);
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = op_data(s, op);
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_ALL;
+}
+
+// 辅助函数：把套接字加入待提交的发送链表; 同一轮中的多次写入合并为一次 sendmsg
+static void uring_queue_send(KNetLoop* loop, KNetSocket* s) {
+    if (s->send_queued || s->send_inflight) return;
+    s->send_queued = true;
+    s->next_send = loop->sends;
+    loop->sends = s;
+}
+
+// 辅助函数：为发送链表中的套接字提交 sendmsg, 每个套接字同时至多一个
+static void uring_submit_sends(KNetLoop* loop) {
+    while (loop->sends) {
+        KNetSocket* s = loop->sends;
+        loop->sends = s->next_send;
+        s->send_queued = false;
+        if (s->closed || s->connecting || s->send_inflight || !s->head) continue;
+        int count = 0;
+        for (KNetChunk* chunk = s->head; chunk && count < KNET_MAX_IOV; chunk = chunk->next) {
+            s->send_iov[count].iov_base = chunk->data + chunk->start;
+            s->send_iov[count].iov_len = chunk->end - chunk->start;
+            count++;
+        }
+        memset(&s->send_msg, 0, sizeof(s->send_msg));
+        s->send_msg.msg_iov = s->send_iov;
+        s->send_msg.msg_iovlen = (size_t)count;
+        struct io_uring_sqe* sqe = op_sqe(loop, s, IORING_OP_SENDMSG, KNET_OP_SEND);
+        sqe->addr = (uint64_t)(uintptr_t)&s->send_msg;
+        sqe->len = 1;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        s->send_inflight = true;
+    }
+}
+
+// =============================================================================
+// 套接字
+// =============================================================================
+
+// 辅助函数：登记新套接字并加入 epoll 或注册文件表, 失败时关闭 fd 并返回 NULL。
+// 使用 io_uring 时监听器立即开始多发的 accept
+static KNetSocket* socket_new(KNetLoop* loop, int fd, bool listener, KNetHandlers* handlers) {
+    uint32_t slot;
+    if (loop->free_count > 0) {
+        slot = loop->free_slots[--loop->free_count];
+    } else {
+        if (loop->slot_count == loop->slot_capacity) {
+            size_t capacity = loop->slot_capacity ? loop->slot_capacity * 2 : 64;
+            KNetSocket** slots = realloc(loop->slots, capacity * sizeof(KNetSocket*));
+            uint32_t* generations = realloc(loop->generations, capacity * sizeof(uint32_t));
+            uint32_t* free_slots = realloc(loop->free_slots, capacity * sizeof(uint32_t));
+            if (!slots || !generations || !free_slots) {
+                fprintf(stderr, "Error: realloc failed in socket_new\n");
+                exit(EXIT_FAILURE);
+            }
+            loop->slots = slots;
+            loop->generations = generations;
+            loop->free_slots = free_slots;
+            loop->slot_capacity = capacity;
+        }
+        slot = (uint32_t)loop->slot_count++;
+        loop->generations[slot] = 1;
+    }
+
+    KNetSocket* s = calloc(1, sizeof(KNetSocket));
+    if (!s) {
+        fprintf(stderr, "Error: calloc failed in socket_new\n");
+        exit(EXIT_FAILURE);
+    }
+    s->fd = fd;
+    s->slot = slot;
+    s->listener = listener;
+    s->handlers = handlers;
+    s->file_fd = -1;
+    handlers->refs++;
+
+    if (loop->ring) {
+        s->registered = uring_update_file(loop, slot, fd);
+        if (listener) uring_arm_accept(loop, s);
+    } else {
+        struct epoll_event event;
+        event.events = listener ? EPOLLIN | EPOLLET : EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.ptr = s;
+        if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            close(fd);
+            handlers->refs--;
+            free(s);
+            loop->free_slots[loop->free_count++] = slot;
+            return NULL;
+        }
+    }
+    loop->slots[slot] = s;
+    loop->live++;
+    return s;
+}
+
+// 辅助函数：加入就绪队列, 下一轮继续读取
+static void queue_ready(KNetLoop* loop, KNetSocket* s) {
+    if (s->queued) return;
+    s->queued = true;
+    s->next = NULL;
+    if (loop->ready_tail) {
+        loop->ready_tail->next = s;
+    } else {
+        loop->ready = s;
+    }
+    loop->ready_tail = s;
+}
+
+// 辅助函数：调用处理函数; 出现运行时错误时停止事件循环
+static void emit(KorelinVM* vm, KNetHandlers* handlers, KNetEvent event, long long id, KValue data) {
+    KNetLoop* loop = vm->net;
+    KGCHandle* handler = handlers->fn[event];
+    if (!handler || loop->failed) return;
+    KValue args[2] = {KVALUE_INT(id), data};
+    int argc = event == KNET_ON_DATA ? 2 : 1;
+    if (!kvm_call(vm, KVALUE_OBJECT(handler->object), argc, args, NULL)) {
+        loop->failed = true;
+        loop->stopped = true;
+    }
+}
+
+// 辅助函数：把收到的数据交给 netRecv 中等待的协程或 data 处理函数
+static void emit_data(KorelinVM* vm, KNetSocket* s, KString* data) {
+    KNetLoop* loop = vm->net;
+    if (s->reader) {
+        KFiber* reader = s->reader;
+        s->reader = NULL;
+        loop->parked--;
+        kvm_wake(vm, reader, KVALUE_OBJECT(data));
+        return;
+    }
+    emit(vm, s->handlers, KNET_ON_DATA, socket_id(loop, s), KVALUE_OBJECT(data));
+}
+
+// 辅助函数：立即关闭套接字; notify 为 true 时调用连接的 close 处理函数
+static void close_socket(KorelinVM* vm, KNetSocket* s, bool notify) {
+    KNetLoop* loop = vm->net;
+    if (s->closed) return;
+    long long id = socket_id(loop, s);
+    s->closed = true;
+    if (loop->ring) {
+        // 内核中的请求持有套接字的引用, 关闭文件描述符不会结束它们
+        if (s->recv_armed) uring_cancel(loop, s, s->listener ? KNET_OP_ACCEPT : KNET_OP_RECV);
+        if (s->send_inflight) uring_cancel(loop, s, KNET_OP_SEND);
+        if (s->poll_armed) uring_cancel(loop, s, KNET_OP_POLL);
+        if (s->registered) uring_update_file(loop, s->slot, -1);
+        s->registered = false;
+        chunks_clear(loop, &s->held_head, &s->held_tail);
+        if (s->listener && s->readable) loop->stalled--;
+    }
+    close(s->fd);
+    // 进行中的 sendmsg 可能还在读取发送缓冲, 由 release_dead 释放
+    if (!s->send_inflight) buffer_clear(loop, s);
+    if (s->file_fd >= 0) {
+        close(s->file_fd);
+        s->file_fd = -1;
+    }
+    loop->slots[s->slot] = NULL;
+    loop->generations[s->slot]++;
+    loop->free_slots[loop->free_count++] = s->slot;
+    loop->live--;
+    // 不在就绪队列中的套接字直接挂到待释放链表; 在队列中的由队列处理时挂上
+    if (!s->queued) {
+        s->next = loop->dead;
+        loop->dead = s;
+    }
+    // 关闭连接释放了文件描述符, 重新启动因描述符耗尽而停止的 accept
+    if (loop->stalled > 0 && !s->listener) {
+        for (size_t i = 0; i < loop->slot_count && loop->stalled > 0; i++) {
+            KNetSocket* server = loop->slots[i];
+            if (server && server->listener && server->readable) {
+                server->readable = false;
+                loop->stalled--;
+                uring_arm_accept(loop, server);
+            }
+        }
+    }
+    if (s->reader) {
+        // netRecv 得到 null
+        kvm_wake(vm, s->reader, KVALUE_NULL);
+        s->reader = NULL;
+        loop->parked--;
+    }
+    if (notify && !s->listener) emit(vm, s->handlers, KNET_ON_CLOSE, id, KVALUE_NULL);
+}
+
+// 辅助函数：释放本轮关闭的套接字; 仍有 io_uring 请求未完成的留到以后
+static void release_dead(KorelinVM* vm) {
+    KNetLoop* loop = vm->net;
+    KNetSocket* waiting = NULL;
+    while (loop->dead) {
+        KNetSocket* s = loop->dead;
+        loop->dead = s->next;
+        if (s->inflight > 0 || s->send_queued) {
+            s->next = waiting;
+            waiting = s;
+            continue;
+        }
+        buffer_clear(loop, s);
+        handlers_release(vm->heap, s->handlers);
+        if (s->http) http_free(loop, s->http);
+        free(s);
+    }
+    loop->dead = waiting;
+}
+
+// =============================================================================
+// 读写
+// =============================================================================
+
+static void http_process(KorelinVM* vm, KNetSocket* s);
+
+// 辅助函数：发送缓冲与待发送的文件是否都已写完
+static bool output_done(const KNetSocket* s) {
+    return !s->head && s->file_fd < 0;
+}
+
+// 辅助函数：套接字现在能否读取并处理数据
+static bool can_consume(const KNetLoop* loop, const KNetSocket* s) {
+    if (s->closed || s->paused || s->throttled || s->closing || loop->stopped) return false;
+    // 没有 data 处理函数的连接只在有协程等待 netRecv 时读取, 其余时间数据留在内核中
+    if (!s->http && !s->handlers->fn[KNET_ON_DATA] && !s->reader) return false;
+    // 等待 sendfile 发送完毕的 HTTP 连接不再读取后续的请求
+    return !s->http || (s->file_fd < 0 && !s->http->last);
+}
+
+// 辅助函数：对端关闭: 发送完缓冲中的数据后关闭
+static void peer_closed(KorelinVM* vm, KNetSocket* s) {
+    s->readable = false;
+    if (!output_done(s)) {
+        s->closing = true;
+    } else {
+        close_socket(vm, s, true);
+    }
+}
+
+// 辅助函数：把 iov 中的数据写到连接: 没有待发送的数据时直接写入套接字, 只把写不完的部分复制
+// 到发送缓冲 (MSG_NOSIGNAL: 对端已关闭时返回 EPIPE 而不是 SIGPIPE)。使用 io_uring 时全部复制
+// 到发送缓冲, 由 netRun 与其他请求一起提交。待发送数据超过高水位时施加背压。套接字因错误
+// 关闭时返回 false。会修改 iov。
+static bool write_out(KorelinVM* vm, KNetSocket* s, struct iovec* iov, int count) {
+    KNetLoop* loop = vm->net;
+    int first = 0;
+    while (first < count && iov[first].iov_len == 0) first++;
+    while (!loop->ring && output_done(s) && s->writable && !s->connecting && first < count) {
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = iov + first;
+        message.msg_iovlen = (size_t)(count - first);
+        ssize_t n = sendmsg(s->fd, &message, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                s->writable = false;
+                break;
+            }
+            close_socket(vm, s, true);
+            return false;
+        }
+        size_t written = (size_t)n;
+        while (first < count && written >= iov[first].iov_len) {
+            written -= iov[first].iov_len;
+            first++;
+        }
+        if (first < count) {
+            iov[first].iov_base = (char*)iov[first].iov_base + written;
+            iov[first].iov_len -= written;
+        }
+    }
+    for (int i = first; i < count; i++) buffer_append(loop, s, iov[i].iov_base, iov[i].iov_len);
+    if (loop->ring && s->head) uring_queue_send(loop, s);
+    if (s->pending > KNET_HIGH_WATER) s->throttled = true;
+    return true;
+}
+
+// 辅助函数：尽量写出发送缓冲, 然后是待发送的文件; 缓冲回落到低水位以下时解除背压
+static void flush(KorelinVM* vm, KNetSocket* s) {
+    KNetLoop* loop = vm->net;
+    if (loop->ring && s->head) uring_queue_send(loop, s);
+    while (!loop->ring && s->head && s->writable) {
+        struct iovec iov[KNET_MAX_IOV];
+        int count = 0;
+        for (KNetChunk* chunk = s->head; chunk && count < KNET_MAX_IOV; chunk = chunk->next) {
+            iov[count].iov_base = chunk->data + chunk->start;
+            iov[count].iov_len = chunk->end - chunk->start;
+            count++;
+        }
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = iov;
+        message.msg_iovlen = (size_t)count;
+        ssize_t n = sendmsg(s->fd, &message, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                s->writable = false;
+                break;
+            }
+            close_socket(vm, s, true);
+            return;
+        }
+        buffer_consume(loop, s, (size_t)n);
+    }
+
+    // 文件由 sendfile 在内核中直接发送, 不经过用户态缓冲
+    while (!s->head && s->file_fd >= 0 && s->writable) {
+        ssize_t n = sendfile(s->fd, s->file_fd, &s->file_offset, s->file_remaining);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                s->writable = false;
+                if (loop->ring) uring_arm_poll(loop, s);
+                break;
+            }
+            close_socket(vm, s, true);
+            return;
+        }
+        if (n == 0) {
+            // 文件在发送期间被截断, 已经发出的 Content-Length 无法兑现
+            close_socket(vm, s, true);
+            return;
+        }
+        s->file_remaining -= (size_t)n;
+        if (s->file_remaining == 0) {
+            close(s->file_fd);
+            s->file_fd = -1;
+        }
+    }
+
+    // 继续处理等待输出而暂停的流水线请求 (对端已半关闭时也要回复已收到的请求)
+    if (s->http && output_done(s)) {
+        s->throttled = false;
+        http_process(vm, s);
+        if (s->closed) return;
+    }
+    if (output_done(s) && s->closing) {
+        close_socket(vm, s, true);
+        return;
+    }
+    if (s->throttled && s->pending <= KNET_LOW_WATER) {
+        s->throttled = false;
+        if (s->readable && !s->paused) queue_ready(loop, s);
+        emit(vm, s->handlers, KNET_ON_DRAIN, socket_id(loop, s), KVALUE_NULL);
+    }
+}
+
+static bool http_reserve(KorelinVM* vm, KNetSocket* s);
+
+// 辅助函数：读取并交给 data 处理函数 (HTTP 连接读入连接的接收缓冲并处理其中的请求),
+// 至多 KNET_READ_BUDGET 次
+static void read_some(KorelinVM* vm, KNetSocket* s) {
+    KNetLoop* loop = vm->net;
+    for (int round = 0; round < KNET_READ_BUDGET; round++) {
+        if (!can_consume(loop, s)) return;
+        char* target = loop->read_buffer;
+        size_t space = KNET_READ_SIZE;
+        if (s->http) {
+            if (!http_reserve(vm, s)) return;
+            target = s->http->data + s->http->length;
+            space = s->http->capacity - s->http->length;
+        }
+        ssize_t n = read(s->fd, target, space);
+        if (n > 0) {
+            // 读到的数据不足一次读取的上限说明内核缓冲已空, 之后到达的数据会产生新的边沿
+            if ((size_t)n < space) s->readable = false;
+            if (s->http) {
+                s->http->length += (size_t)n;
+                http_process(vm, s);
+            } else {
+                emit_data(vm, s, kstring_new(vm->heap, target, (size_t)n));
+            }
+            if (!s->readable) return;
+            continue;
+        }
+        if (n == 0) {
+            peer_closed(vm, s);
+            return;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            s->readable = false;
+            return;
+        }
+        close_socket(vm, s, true);
+        return;
+    }
+    queue_ready(loop, s);
+}
+
+static void uring_resume(KorelinVM* vm, KNetSocket* s);
+
+// 辅助函数：登记监听器接受的连接 (非阻塞的 fd)
+static void accepted(KorelinVM* vm, KNetSocket* server, int fd) {
+    KNetLoop* loop = vm->net;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    KNetSocket* s = socket_new(loop, fd, false, server->handlers);
+    if (!s) return;
+    s->writable = true;
+    if (server->http_server) {
+        s->http = calloc(1, sizeof(KNetHttp));
+        if (!s->http) {
+            fprintf(stderr, "Error: calloc failed in accepted\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (loop->ring) uring_resume(vm, s);
+    if (!s->http) emit(vm, s->handlers, KNET_ON_ACCEPT, socket_id(loop, s), KVALUE_NULL);
+}
+
+// 辅助函数：接受所有等待中的连接
+static void accept_all(KorelinVM* vm, KNetSocket* server) {
+    while (!server->closed && !vm->net->stopped) {
+        int fd = accept4(server->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            // EAGAIN 表示已接受完; 文件描述符耗尽等错误时等待下一个连接再重试
+            return;
+        }
+        accepted(vm, server, fd);
+    }
+}
+
+// 辅助函数：非阻塞 connect 完成 (成功或失败)
+static void finish_connect(KorelinVM* vm, KNetSocket* s) {
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (getsockopt(s->fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+        close_socket(vm, s, true);
+        return;
+    }
+    s->connecting = false;
+    s->writable = true;
+    s->readable = true;
+    emit(vm, s->handlers, KNET_ON_CONNECT, socket_id(vm->net, s), KVALUE_NULL);
+    if (!s->closed) flush(vm, s);
+    if (s->closed) return;
+    if (vm->net->ring) {
+        uring_resume(vm, s);
+    } else {
+        read_some(vm, s);
+    }
+}
+
+static void dispatch(KorelinVM* vm, KNetSocket* s, uint32_t events) {
+    if (s->closed) return;
+    if (s->listener) {
+        accept_all(vm, s);
+        return;
+    }
+    if (s->connecting) {
+        if (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) finish_connect(vm, s);
+        return;
+    }
+    if (events & EPOLLERR) {
+        close_socket(vm, s, true);
+        return;
+    }
+    if (events & EPOLLOUT) {
+        s->writable = true;
+        flush(vm, s);
+        if (s->closed) return;
+    }
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+        s->readable = true;
+        read_some(vm, s);
+    }
+}
+
+// 辅助函数：处理就绪队列中的连接 (只处理本轮开始时已在队列中的)
+static void drain_ready(KorelinVM* vm) {
+    KNetLoop* loop = vm->net;
+    KNetSocket* s = loop->ready;
+    loop->ready = NULL;
+    loop->ready_tail = NULL;
+    while (s) {
+        KNetSocket* next = s->next;
+        s->queued = false;
+        if (s->closed) {
+            s->next = loop->dead;
+            loop->dead = s;
+        } else if (loop->ring) {
+            uring_resume(vm, s);
+        } else if (s->readable) {
+            read_some(vm, s);
+        }
+        s = next;
+    }
+}
+
+// =============================================================================
+// HTTP/1.1
+// =============================================================================
+
+// 接收缓冲中的一段字节, 不以 '\0' 结尾
+typedef struct KHttpSlice {
+    const char* data;
+    size_t length;
+} KHttpSlice;
+
+typedef struct KHttpHeader {
+    KHttpSlice name;
+    KHttpSlice value;
+} KHttpHeader;
+
+// 解析出的请求, 所有切片都指向连接的接收缓冲
+typedef struct KHttpRequest {
+    KHttpSlice method;
+    KHttpSlice target;
+    KHttpSlice body;
+    KHttpHeader headers[KNET_HTTP_MAX_HEADERS];
+    size_t header_count;
+    bool keep_alive;
+    bool http10;            // HTTP/1.0 请求 (默认不保持连接)
+    bool head;              // HEAD 请求: 响应不带消息体
+} KHttpRequest;
+
+// 辅助函数：切片是否与 ASCII 字符串相等 (不区分大小写)
+static bool slice_equals(KHttpSlice slice, const char* text) {
+    size_t length = strlen(text);
+    return slice.length == length && strncasecmp(slice.data, text, length) == 0;
+}
+
+// 辅助函数：逗号分隔的列表 (如 Connection 的值) 中是否含有 token (不区分大小写)
+static bool slice_has_token(KHttpSlice list, const char* token) {
+    const char* p = list.data;
+    const char* end = list.data + list.length;
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == ',')) p++;
+        const char* start = p;
+        while (p < end && *p != ',') p++;
+        const char* stop = p;
+        while (stop > start && (stop[-1] == ' ' || stop[-1] == '\t')) stop--;
+        if (slice_equals((KHttpSlice){start, (size_t)(stop - start)}, token)) return true;
+    }
+    return false;
+}
+
+static bool is_token_char(unsigned char c) {
+    return c > 0x20 && c < 0x7F && !strchr("\"(),/:;<=>?@[\\]{}", c);
+}
+
+// 辅助函数：在 data[0, size) 中原地解析一个请求。
+// @return 请求占用的字节数; 请求还不完整时返回 0 且 *status 为 0, 请求无效时返回 0 且
+//         *status 为应当回复的错误状态码
+static size_t http_parse(const char* data, size_t size, KHttpRequest* request, int* status) {
+    *status = 0;
+    // 请求之前的空行被忽略 (RFC 9112 2.2)
+    size_t skip = 0;
+    while (skip + 1 < size && data[skip] == '\r' && data[skip + 1] == '\n') skip += 2;
+    const char* p = data + skip;
+    size_t available = size - skip;
+
+    size_t end = ksimd_find(p, available, "\r\n\r\n", 4);
+    if (end == available) {
+        if (available >= KNET_HTTP_MAX_HEAD) *status = 431;
+        return 0;
+    }
+    if (end + 4 > KNET_HTTP_MAX_HEAD) {
+        *status = 431;
+        return 0;
+    }
+    const char* head_end = p + end + 2;     // 最后一个头部行的 CRLF 之后
+
+    // 请求行: method SP request-target SP HTTP-version CRLF
+    const char* line_end = memchr(p, '\r', (size_t)(head_end - p));
+    const char* q = p;
+    while (q < line_end && is_token_char((unsigned char)*q)) q++;
+    if (q == p || q == line_end || *q != ' ') goto bad_request;
+    request->method = (KHttpSlice){p, (size_t)(q - p)};
+    const char* target = ++q;
+    while (q < line_end && (unsigned char)*q > 0x20 && *q != 0x7F) q++;
+    if (q == target || q == line_end || *q != ' ') goto bad_request;
+    request->target = (KHttpSlice){target, (size_t)(q - target)};
+    q++;
+    if (line_end - q != 8 || memcmp(q, "HTTP/1.", 7) != 0) {
+        if (line_end - q >= 5 && memcmp(q, "HTTP/", 5) == 0) {
+            *status = 505;
+            return 0;
+        }
+        goto bad_request;
+    }
+    if (q[7] != '0' && q[7] != '1') {
+        *status = 505;
+        return 0;
+    }
+    if (line_end[1] != '\n') goto bad_request;
+    request->http10 = q[7] == '0';
+    request->head = request->method.length == 4 && memcmp(request->method.data, "HEAD", 4) == 0;
+
+    // 头部行: field-name ":" OWS field-value OWS CRLF
+    request->header_count = 0;
+    bool has_length = false;
+    size_t content_length = 0;
+    KHttpSlice connection = {NULL, 0};
+    p = line_end + 2;
+    while (p < head_end) {
+        line_end = memchr(p, '\r', (size_t)(head_end - p));
+        if (line_end[1] != '\n') goto bad_request;
+        q = p;
+        while (q < line_end && is_token_char((unsigned char)*q)) q++;
+        // 名字为空、名字与冒号之间有空白或以空白开头的续行 (obs-fold) 都是错误
+        if (q == p || q == line_end || *q != ':') goto bad_request;
+        KHttpSlice name = {p, (size_t)(q - p)};
+        q++;
+        while (q < line_end && (*q == ' ' || *q == '\t')) q++;
+        const char* value_end = line_end;
+        while (value_end > q && (value_end[-1] == ' ' || value_end[-1] == '\t')) value_end--;
+        for (const char* c = q; c < value_end; c++) {
+            if (((unsigned char)*c < 0x20 && *c != '\t') || *c == 0x7F) goto bad_request;
+        }
+        KHttpSlice value = {q, (size_t)(value_end - q)};
+        if (request->header_count == KNET_HTTP_MAX_HEADERS) {
+            *status = 431;
+            return 0;
+        }
+        request->headers[request->header_count++] = (KHttpHeader){name, value};
+
+        if (slice_equals(name, "Content-Length")) {
+            if (value.length == 0) goto bad_request;
+            size_t length = 0;
+            for (size_t i = 0; i < value.length; i++) {
+                char c = value.data[i];
+                if (c < '0' || c > '9') goto bad_request;
+                if (length > KNET_HTTP_MAX_REQUEST) {
+                    *status = 413;
+                    return 0;
+                }
+                length = length * 10 + (size_t)(c - '0');
+            }
+            // 多个不一致的 Content-Length 可能被用于请求走私
+            if (has_length && length != content_length) goto bad_request;
+            has_length = true;
+            content_length = length;
+        } else if (slice_equals(name, "Transfer-Encoding")) {
+            // 不支持分块的请求体
+            *status = 501;
+            return 0;
+        } else if (slice_equals(name, "Connection")) {
+            connection = value;
+        }
+        p = line_end + 2;
+    }
+
+    size_t head_size = skip + end + 4;
+    if (content_length > KNET_HTTP_MAX_REQUEST - head_size) {
+        *status = 413;
+        return 0;
+    }
+    if (size - head_size < content_length) return 0;
+    request->body = (KHttpSlice){data + head_size, content_length};
+    if (request->http10) {
+        request->keep_alive = connection.data && slice_has_token(connection, "keep-alive");
+    } else {
+        request->keep_alive = !(connection.data && slice_has_token(connection, "close"));
+    }
+    return head_size + content_length;
+
+bad_request:
+    *status = 400;
+    return 0;
+}
+
+static const char* http_reason(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 201: return "Created";
+        case 202: return "Accepted";
+        case 204: return "No Content";
+        case 206: return "Partial Content";
+        case 301: return "Moved Permanently";
+        case 302: return "Found";
+        case 303: return "See Other";
+        case 304: return "Not Modified";
+        case 307: return "Temporary Redirect";
+        case 308: return "Permanent Redirect";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 408: return "Request Timeout";
+        case 409: return "Conflict";
+        case 410: return "Gone";
+        case 411: return "Length Required";
+        case 413: return "Content Too Large";
+        case 414: return "URI Too Long";
+        case 415: return "Unsupported Media Type";
+        case 429: return "Too Many Requests";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 502: return "Bad Gateway";
+        case 503: return "Service Unavailable";
+        case 504: return "Gateway Timeout";
+        case 505: return "HTTP Version Not Supported";
+        default: return "Unknown";
+    }
+}
+
+// 辅助函数：当前的 HTTP Date 值, 每秒格式化一次
+static const char* http_date(KNetLoop* loop) {
+    time_t now = time(NULL);
+    if (now != loop->date_time || !loop->date[0]) {
+        struct tm tm;
+        gmtime_r(&now, &tm);
+        strftime(loop->date, sizeof(loop->date), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        loop->date_time = now;
+    }
+    return loop->date;
+}
+
+// 响应头的构造缓冲: 先使用内嵌的空间, 不够时转到堆上
+typedef struct KHttpHead {
+    char* data;
+    size_t length;
+    size_t capacity;
+    char inline_data[1024];
+} KHttpHead;
+
+static void head_append(KHttpHead* head, const char* data, size_t size) {
+    if (head->length + size > head->capacity) {
+        size_t capacity = head->capacity * 2;
+        while (capacity < head->length + size) capacity *= 2;
+        char* grown = net_alloc(capacity, "head_append");
+        memcpy(grown, head->data, head->length);
+        if (head->data != head->inline_data) free(head->data);
+        head->data = grown;
+        head->capacity = capacity;
+    }
+    memcpy(head->data + head->length, data, size);
+    head->length += size;
+}
+
+static void head_append_str(KHttpHead* head, const char* text) {
+    head_append(head, text, strlen(text));
+}
+
+// 辅助函数：头部的值是否可以原样写出 (不含 CR、LF 等控制字符, 防止响应拆分)
+static bool header_text_valid(const KString* text, bool name) {
+    if (name && text->length == 0) return false;
+    for (size_t i = 0; i < text->length; i++) {
+        unsigned char c = (unsigned char)text->chars[i];
+        if (name ? !is_token_char(c) : ((c < 0x20 && c != '\t') || c == 0x7F)) return false;
+    }
+    return true;
+}
+
+// 辅助函数：写出一个响应: 状态行与头部格式化到一块缓冲, 与消息体一起由一次 sendmsg (writev)
+// 写出; file_fd 不为 -1 时消息体是该文件的 body_size 字节, 之后由 sendfile 发送 (函数接管
+// file_fd)。headers 是额外的头部 (可以为 NULL), 其中的 Content-Length 与 Transfer-Encoding
+// 被忽略。headers 无效时返回 false 且什么都不写。
+static bool http_write_response(KorelinVM* vm, KNetSocket* s, int status, const KMap* headers,
+                                const char* body, size_t body_size, int file_fd) {
+    KNetHttp* http = s->http;
+    const KHttpRequest* request = http->current;
+    bool keep_alive = request && request->keep_alive && !http->last;
+    bool no_body = status == 204 || status == 304;
+
+    KHttpHead head;
+    head.data = head.inline_data;
+    head.length = 0;
+    head.capacity = sizeof(head.inline_data);
+    char line[128];
+    int n = snprintf(line, sizeof(line), "HTTP/1.1 %d %s\r\nDate: %s\r\n", status, http_reason(status),
+                     http_date(vm->net));
+    head_append(&head, line, (size_t)n);
+    if (!no_body) {
+        n = snprintf(line, sizeof(line), "Content-Length: %zu\r\n", body_size);
+        head_append(&head, line, (size_t)n);
+    }
+
+    if (headers) {
+        size_t cursor = 0;
+        KValue key;
+        KValue value;
+        while (kmap_next(headers, &cursor, &key, &value)) {
+            if (!kvalue_is_object_type(key, KOBJ_STRING) || !kvalue_is_object_type(value, KOBJ_STRING)) goto invalid;
+            const KString* name = (const KString*)key.as.object;
+            const KString* text = (const KString*)value.as.object;
+            if (!header_text_valid(name, true) || !header_text_valid(text, false)) goto invalid;
+            KHttpSlice name_slice = {name->chars, name->length};
+            if (slice_equals(name_slice, "Content-Length") || slice_equals(name_slice, "Transfer-Encoding")) {
+                continue;
+            }
+            if (slice_equals(name_slice, "Connection")) {
+                if (slice_has_token((KHttpSlice){text->chars, text->length}, "close")) keep_alive = false;
+                continue;
+            }
+            head_append(&head, name->chars, name->length);
+            head_append(&head, ": ", 2);
+            head_append(&head, text->chars, text->length);
+            head_append(&head, "\r\n", 2);
+        }
+    }
+    if (!keep_alive) {
+        head_append_str(&head, "Connection: close\r\n");
+    } else if (request->http10) {
+        head_append_str(&head, "Connection: keep-alive\r\n");
+    }
+    head_append(&head, "\r\n", 2);
+
+    if (no_body || (request && request->head)) {
+        body_size = 0;
+        if (file_fd >= 0) {
+            close(file_fd);
+            file_fd = -1;
+        }
+    }
+    struct iovec iov[2] = {{head.data, head.length}, {(void*)body, file_fd >= 0 ? 0 : body_size}};
+    http->responded = true;
+    if (!keep_alive) http->last = true;
+    bool open = write_out(vm, s, iov, 2);
+    if (head.data != head.inline_data) free(head.data);
+    if (file_fd >= 0) {
+        if (!open || body_size == 0) {
+            close(file_fd);
+        } else {
+            s->file_fd = file_fd;
+            s->file_offset = 0;
+            s->file_remaining = body_size;
+            if (s->writable) flush(vm, s);
+        }
+    }
+    return true;
+
+invalid:
+    if (head.data != head.inline_data) free(head.data);
+    if (file_fd >= 0) close(file_fd);
+    return false;
+}
+
+// 辅助函数：回复错误并在发送完后关闭连接 (请求无效时无法确定下一个请求的起点)
+static void http_error(KorelinVM* vm, KNetSocket* s, int status) {
+    s->http->current = NULL;
+    s->http->last = true;
+    const char* reason = http_reason(status);
+    http_write_response(vm, s, status, NULL, reason, strlen(reason), -1);
+}
+
+// 辅助函数：确保接收缓冲有空闲空间: 空闲的连接从池中借一块, 已处理的数据被移出,
+// 缓冲被未处理完的请求填满时扩大 (解析器保证请求不超过 KNET_HTTP_MAX_REQUEST)
+static bool http_reserve(KorelinVM* vm, KNetSocket* s) {
+    KNetHttp* http = s->http;
+    if (!http->data) {
+        http->chunk = chunk_get(vm->net);
+        http->data = http->chunk->data;
+        http->capacity = KNET_CHUNK_SIZE;
+        return true;
+    }
+    if (http->length < http->capacity) return true;
+    if (http->start > 0) {
+        memmove(http->data, http->data + http->start, http->length - http->start);
+        http->length -= http->start;
+        http->start = 0;
+        return true;
+    }
+    if (http->capacity >= KNET_HTTP_MAX_REQUEST) return false;
+    size_t capacity = http->capacity * 2;
+    if (capacity > KNET_HTTP_MAX_REQUEST) capacity = KNET_HTTP_MAX_REQUEST;
+    char* data = net_alloc(capacity, "http_reserve");
+    memcpy(data, http->data, http->length);
+    size_t length = http->length;
+    http_release_buffer(vm->net, http);
+    http->data = data;
+    http->length = length;
+    http->capacity = capacity;
+    return true;
+}
+
+// 辅助函数：依次处理接收缓冲中的完整请求 (流水线)。响应按请求的顺序写出; 有文件在等待
+// sendfile 或发送缓冲超过高水位时暂停, 由 flush 在输出完成后继续
+static void http_process(KorelinVM* vm, KNetSocket* s) {
+    KNetLoop* loop = vm->net;
+    KNetHttp* http = s->http;
+    if (http->processing) return;
+    http->processing = true;
+    while (!s->closed && !http->last && !s->throttled && s->file_fd < 0 && !loop->stopped &&
+           http->start < http->length) {
+        KHttpRequest request;
+        int status;
+        size_t size = http_parse(http->data + http->start, http->length - http->start, &request, &status);
+        if (size == 0) {
+            if (status != 0) http_error(vm, s, status);
+            break;
+        }
+        http->current = &request;
+        http->responded = false;
+        emit(vm, s->handlers, KNET_ON_REQUEST, socket_id(loop, s), KVALUE_NULL);
+        if (!s->closed && !http->responded && !loop->failed) {
+            // 处理函数没有回复
+            http_write_response(vm, s, 500, NULL, NULL, 0, -1);
+        }
+        http->current = NULL;
+        if (s->closed) break;
+        http->start += size;
+    }
+    http->processing = false;
+    if (s->closed) return;
+    if (http->data && http->start == http->length) http_release_buffer(loop, http);
+    if (http->last) {
+        s->closing = true;
+        if (output_done(s)) close_socket(vm, s, true);
+    } else if (s->readable && !s->paused && !s->throttled && s->file_fd < 0) {
+        queue_ready(loop, s);
+    }
+}
+
+// =============================================================================
+// io_uring 后端
+//
+// 监听器使用多发的 accept, 连接使用多发的 recv: 一次提交之后每到达一批数据产生一个完成项,
+// 数据位于提供缓冲环的一块缓冲中, 处理完立即归还。连接暂停或施加背压时, 之后到达的数据
+// 暂存在块链表中并取消 recv, 恢复时先交付暂存的数据再重新开始。发送使用 sendmsg, 同一轮中
+// 对一个连接的多次写入合并为一个请求。
+// =============================================================================
+
+// 辅助函数：把 io_uring 收到的数据交给 HTTP 连接。空闲连接直接在提供缓冲中原地解析, 只把
+// 不完整的剩余部分复制到连接的接收缓冲。返回接收的字节数 (连接停止读取时可能少于 size)
+static size_t http_feed(KorelinVM* vm, KNetSocket* s, const char* data, size_t size) {
+    KNetHttp* http = s->http;
+    if (!http->data) {
+        http->data = (char*)data;
+        http->start = 0;
+        http->length = size;
+        http->capacity = size;
+        http->borrowed = true;
+        http_process(vm, s);
+        if (!s->closed && http->borrowed) {
+            // 提供缓冲不大于一块 (KNET_CHUNK_SIZE)
+            size_t rest = http->length - http->start;
+            KNetChunk* chunk = chunk_get(vm->net);
+            memcpy(chunk->data, http->data + http->start, rest);
+            http->borrowed = false;
+            http->chunk = chunk;
+            http->data = chunk->data;
+            http->start = 0;
+            http->length = rest;
+            http->capacity = KNET_CHUNK_SIZE;
+        }
+        return size;
+    }
+    size_t consumed = 0;
+    while (consumed < size && can_consume(vm->net, s)) {
+        // 解析器拒绝超过 KNET_HTTP_MAX_REQUEST 的请求, 可以读取时缓冲不会被占满
+        if (!http_reserve(vm, s)) break;
+        size_t n = http->capacity - http->length;
+        if (n > size - consumed) n = size - consumed;
+        memcpy(http->data + http->length, data + consumed, n);
+        http->length += n;
+        consumed += n;
+        http_process(vm, s);
+    }
+    return consumed;
+}
+
+// 辅助函数：把收到的数据交给 data 处理函数或 HTTP 连接, 返回接收的字节数
+static size_t deliver(KorelinVM* vm, KNetSocket* s, const char* data, size_t size) {
+    if (s->http) return http_feed(vm, s, data, size);
+    emit_data(vm, s, kstring_new(vm->heap, data, size));
+    return size;
+}
+
+// 辅助函数：处理 recv 收到的数据; 不能读取时暂存并取消 recv
+static void uring_input(KorelinVM* vm, KNetSocket* s, const char* data, size_t size) {
+    KNetLoop* loop = vm->net;
+    if (!s->held_head && can_consume(loop, s)) {
+        size_t consumed = deliver(vm, s, data, size);
+        if (consumed == size || s->closed) return;
+        data += consumed;
+        size -= consumed;
+    }
+    if (s->closing) return;
+    chunks_append(loop, &s->held_head, &s->held_tail, data, size);
+    s->readable = true;
+    if (s->recv_armed && !s->recv_cancelling) {
+        uring_cancel(loop, s, KNET_OP_RECV);
+        s->recv_cancelling = true;
+    }
+}
+
+// 辅助函数：恢复读取: 交付暂存的数据, 处理对端的关闭, 需要时重新开始 recv。仍然不能读取时
+// 把 readable 置为 true, 等待 queue_ready 再次调用
+static void uring_resume(KorelinVM* vm, KNetSocket* s) {
+    KNetLoop* loop = vm->net;
+    while (s->held_head && can_consume(loop, s)) {
+        KNetChunk* chunk = s->held_head;
+        size_t consumed = deliver(vm, s, chunk->data + chunk->start, chunk->end - chunk->start);
+        if (s->closed) return;
+        chunk->start += consumed;
+        if (chunk->start < chunk->end) break;
+        s->held_head = chunk->next;
+        if (!s->held_head) s->held_tail = NULL;
+        chunk_put(loop, chunk);
+    }
+    if (s->closed) return;
+    if (s->closing) {
+        chunks_clear(loop, &s->held_head, &s->held_tail);
+        s->readable = false;
+        return;
+    }
+    if (s->held_head || !can_consume(loop, s)) {
+        s->readable = true;
+        return;
+    }
+    if (s->eof) {
+        peer_closed(vm, s);
+        return;
+    }
+    s->readable = false;
+    if (!s->recv_armed) uring_arm_recv(loop, s);
+}
+
+static void uring_complete(KorelinVM* vm, const struct io_uring_cqe* cqe) {
+    KNetLoop* loop = vm->net;
+    if (cqe->user_data == 0) return;
+    KNetSocket* s = (KNetSocket*)(uintptr_t)(cqe->user_data & ~(uint64_t)KNET_OP_MASK);
+    bool more = (cqe->flags & IORING_CQE_F_MORE) != 0;
+    if (!more) s->inflight--;
+
+    switch ((KNetOp)(cqe->user_data & KNET_OP_MASK)) {
+        case KNET_OP_ACCEPT:
+            if (!more) s->recv_armed = false;
+            if (cqe->res >= 0) {
+                if (s->closed) {
+                    close(cqe->res);
+                } else {
+                    accepted(vm, s, cqe->res);
+                }
+            }
+            if (more || s->closed) break;
+            if (cqe->res == -EMFILE || cqe->res == -ENFILE || cqe->res == -ENOBUFS || cqe->res == -ENOMEM) {
+                // 文件描述符耗尽: 立即重新开始只会再次失败, 等待某个连接关闭
+                s->readable = true;
+                loop->stalled++;
+            } else {
+                uring_arm_accept(loop, s);
+            }
+            break;
+        case KNET_OP_RECV:
+            if (!more) {
+                s->recv_armed = false;
+                s->recv_cancelling = false;
+            }
+            if (cqe->flags & IORING_CQE_F_BUFFER) {
+                unsigned id = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+                if (cqe->res > 0 && !s->closed) {
+                    uring_input(vm, s, kuring_buffer(&loop->buffers, id), (size_t)cqe->res);
+                }
+                kuring_buffer_recycle(&loop->buffers, id);
+            }
+            if (s->closed) break;
+            if (cqe->res == 0) {
+                s->eof = true;
+            } else if (cqe->res < 0 && cqe->res != -ECANCELED && cqe->res != -ENOBUFS) {
+                close_socket(vm, s, true);
+                break;
+            }
+            // 多发的 recv 结束 (EOF、取消或提供缓冲暂时用尽)
+            if (!more) uring_resume(vm, s);
+            break;
+        case KNET_OP_SEND:
+            s->send_inflight = false;
+            if (s->closed) break;
+            if (cqe->res <= 0) {
+                close_socket(vm, s, true);
+                break;
+            }
+            buffer_consume(loop, s, (size_t)cqe->res);
+            flush(vm, s);
+            break;
+        case KNET_OP_POLL:
+            s->poll_armed = false;
+            if (s->closed) break;
+            if (s->connecting) {
+                finish_connect(vm, s);
+            } else {
+                s->writable = true;
+                flush(vm, s);
+            }
+            break;
+    }
+}
+
+// 辅助函数：提交积累的请求并等待完成, 然后处理所有完成项
+static bool uring_wait(KorelinVM* vm, int timeout) {
+    KNetLoop* loop = vm->net;
+    uring_submit_sends(loop);
+    if (!kuring_enter(loop->ring, timeout == 0 ? 0 : 1, timeout)) return false;
+    struct io_uring_cqe* cqe;
+    while (!loop->stopped && (cqe = kuring_peek(loop->ring)) != NULL) {
+        // 处理函数可能提交新的请求, 先复制完成项再归还它的位置
+        struct io_uring_cqe copy = *cqe;
+        kuring_advance(loop->ring);
+        uring_complete(vm, &copy);
+    }
+    return true;
+}
+
+// =============================================================================
+// 原生函数
+// =============================================================================
+
+// 辅助函数：解析地址, 成功时返回 getaddrinfo 的结果 (由调用者释放)
+static struct addrinfo* resolve(KValue host, KValue port, bool passive) {
+    if (!kvalue_is_object_type(host, KOBJ_STRING) || port.type != KVAL_INT || port.as.integer < 0 ||
+        port.as.integer > 65535) {
+        return NULL;
+    }
+    const KString* name = (const KString*)host.as.object;
+    char service[8];
+    snprintf(service, sizeof(service), "%lld", port.as.integer);
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICSERV | (passive ? AI_PASSIVE : 0);
+    struct addrinfo* result = NULL;
+    if (getaddrinfo(name->length ? name->chars : NULL, service, &hints, &result) != 0) return NULL;
+    return result;
+}
+
+// 辅助函数：在 host:port 上创建非阻塞的监听套接字, 失败时返回 -1
+static int open_listener(KValue host, KValue port) {
+    struct addrinfo* addresses = resolve(host, port, true);
+    if (!addresses) return -1;
+    int fd = -1;
+    for (struct addrinfo* ai = addresses; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) < 0 || listen(fd, SOMAXCONN) < 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    return fd;
+}
+
+// netListen(host, port, handlers) -> server | null
+static KValue native_listen(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    int fd = open_listener(argv[0], argv[1]);
+    if (fd < 0) return KVALUE_NULL;
+
+    KNetHandlers* handlers = handlers_from(vm, argv[2]);
+    if (!handlers) {
+        close(fd);
+        return KVALUE_NULL;
+    }
+    KNetLoop* loop = get_loop(vm);
+    KNetSocket* s = socket_new(loop, fd, true, handlers);
+    handlers_release(vm->heap, handlers);
+    return s ? KVALUE_INT(socket_id(loop, s)) : KVALUE_NULL;
+}
+
+// netConnect(host, port, handlers) -> conn | null
+static KValue native_connect(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    struct addrinfo* addresses = resolve(argv[0], argv[1], false);
+    if (!addresses) return KVALUE_NULL;
+    int fd = -1;
+    for (struct addrinfo* ai = addresses; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) < 0 && errno != EINPROGRESS) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    if (fd < 0) return KVALUE_NULL;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    KNetHandlers* handlers = handlers_from(vm, argv[2]);
+    if (!handlers) {
+        close(fd);
+        return KVALUE_NULL;
+    }
+    KNetLoop* loop = get_loop(vm);
+    KNetSocket* s = socket_new(loop, fd, false, handlers);
+    handlers_release(vm->heap, handlers);
+    if (!s) return KVALUE_NULL;
+    // 即使已经连接成功, 也由事件循环在第一次可写时调用 connect 处理函数
+    s->connecting = true;
+    if (loop->ring) uring_arm_poll(loop, s);
+    return KVALUE_INT(socket_id(loop, s));
+}
+
+// netSend(conn, string) -> bool | null
+static KValue native_send(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    KNetSocket* s = find_socket(vm, argv[0]);
+    if (!s || s->listener || s->http || s->closing || !kvalue_is_object_type(argv[1], KOBJ_STRING)) {
+        return KVALUE_NULL;
+    }
+    const KString* str = (const KString*)argv[1].as.object;
+    struct iovec iov = {(char*)str->chars, str->length};
+    if (!write_out(vm, s, &iov, 1)) return KVALUE_NULL;
+    return KVALUE_BOOL(s->pending <= KNET_HIGH_WATER);
+}
+
+// netClose(id) -> bool
+static KValue native_close(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    KNetSocket* s = find_socket(vm, argv[0]);
+    if (!s) return KVALUE_BOOL(false);
+    if (!output_done(s) && s->writable) flush(vm, s);
+    if (s->closed) return KVALUE_BOOL(true);
+    if (s->http) s->http->last = true;
+    if (!output_done(s)) {
+        // 等待发送完毕; 不再读取
+        s->closing = true;
+        shutdown(s->fd, SHUT_RD);
+    } else {
+        close_socket(vm, s, true);
+    }
+    return KVALUE_BOOL(true);
+}
+
+// netPause(conn) -> bool
+static KValue native_pause(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    KNetSocket* s = find_socket(vm, argv[0]);
+    if (!s || s->listener) return KVALUE_BOOL(false);
+    s->paused = true;
+    return KVALUE_BOOL(true);
+}
+
+// netResume(conn) -> bool
+static KValue native_resume(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    KNetSocket* s = find_socket(vm, argv[0]);
+    if (!s || s->listener) return KVALUE_BOOL(false);
+    s->paused = false;
+    if (s->readable && !s->throttled) queue_ready(vm->net, s);
+    return KVALUE_BOOL(true);
+}
+
+// netPort(id) -> int | null
+static KValue native_port(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    KNetSocket* s = find_socket(vm, argv[0]);
+    if (!s) return KVALUE_NULL;
+    struct sockaddr_storage address;
+    socklen_t length = sizeof(address);
+    if (getsockname(s->fd, (struct sockaddr*)&address, &length) < 0) return KVALUE_NULL;
+    if (address.ss_family == AF_INET) return KVALUE_INT(ntohs(((struct sockaddr_in*)&address)->sin_port));
+    if (address.ss_family == AF_INET6) return KVALUE_INT(ntohs(((struct sockaddr_in6*)&address)->sin6_port));
+    return KVALUE_NULL;
+}
+
+// 辅助函数：等待至多 timeout 毫秒 (-1 表示不限时), 处理收到的事件、就绪队列与到期的定时器;
+// 等待出错时返回 false
+static bool poll_once(KorelinVM* vm, int timeout) {
+    KNetLoop* loop = vm->net;
+    if (loop->ring) {
+        if (!uring_wait(vm, timeout)) {
+            perror("Error: io_uring_enter failed in poll_once");
+            return false;
+        }
+    } else {
+        struct epoll_event events[KNET_MAX_EVENTS];
+        int count = epoll_wait(loop->epoll_fd, events, KNET_MAX_EVENTS, timeout);
+        if (count < 0) {
+            if (errno == EINTR) return true;
+            perror("Error: epoll_wait failed in poll_once");
+            return false;
+        }
+        for (int i = 0; i < count && !loop->stopped; i++) {
+            dispatch(vm, events[i].data.ptr, events[i].events);
+        }
+    }
+    if (!loop->stopped) drain_ready(vm);
+    run_timers(vm);
+    release_dead(vm);
+    return true;
+}
+
+// 辅助函数：提交处理函数最后写出的数据, 不必等到下一次等待事件
+static void flush_submissions(KNetLoop* loop) {
+    if (!loop->ring) return;
+    uring_submit_sends(loop);
+    kuring_enter(loop->ring, 0, 0);
+}
+
+// netRun([ms]) -> bool | null
+static KValue native_run(KorelinVM* vm, int argc, const KValue* argv) {
+    long long deadline = -1;
+    if (argc > 1) return KVALUE_NULL;
+    if (argc == 1) {
+        if (argv[0].type != KVAL_INT || argv[0].as.integer < 0) return KVALUE_NULL;
+        deadline = now_ms() + argv[0].as.integer;
+    }
+    KNetLoop* loop = get_loop(vm);
+    if (loop->running) return KVALUE_NULL;
+    loop->running = true;
+    loop->stopped = false;
+    loop->failed = false;
+
+    while (!loop->stopped && (loop->live > 0 || loop->timers > 0 || vm->run_head)) {
+        long long wait = timer_timeout(loop);
+        if (loop->ready || vm->run_head) {
+            wait = 0;
+        } else if (deadline >= 0) {
+            long long remaining = deadline - now_ms();
+            if (remaining <= 0) break;
+            if (wait < 0 || remaining < wait) wait = remaining;
+        }
+        if (!poll_once(vm, wait > 1000000 ? 1000000 : (int)wait)) break;
+        // 事件与定时器唤醒的协程在下一次等待之前执行
+        if (!loop->stopped && !kvm_run_fibers(vm)) {
+            loop->failed = true;
+            loop->stopped = true;
+        }
+        if (deadline >= 0 && now_ms() >= deadline) break;
+    }
+    flush_submissions(loop);
+    loop->running = false;
+    return KVALUE_BOOL(!loop->failed);
+}
+
+// netStop()
+static KValue native_stop(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    (void)argv;
+    if (vm->net) vm->net->stopped = true;
+    return KVALUE_NULL;
+}
+
+// netBackend() -> string
+static KValue native_backend(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    (void)argv;
+    const char* name = get_loop(vm)->ring ? "io_uring" : "epoll";
+    return KVALUE_OBJECT(kstring_new(vm->heap, name, strlen(name)));
+}
+
+// sleep(ms) -> bool | null
+static KValue native_sleep(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    if (argv[0].type != KVAL_INT || argv[0].as.integer < 0) return KVALUE_NULL;
+    KNetLoop* loop = get_loop(vm);
+    KFiber* fiber = kvm_park(vm);
+    if (!fiber) return KVALUE_NULL;
+    KNetTimer* timer = timer_alloc(loop);
+    timer->fiber = fiber;
+    timer->has_arg = false;
+    timer->arg = KVALUE_NULL;
+    timer->interval = 0;
+    loop->parked++;
+    kwheel_add(&loop->wheel, &timer->node, (uint64_t)(now_ms() + argv[0].as.integer));
+    return KVALUE_NULL;
+}
+
+// netRecv(conn) -> string | null
+static KValue native_recv(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    KNetSocket* s = find_socket(vm, argv[0]);
+    if (!s || s->listener || s->http || s->handlers->fn[KNET_ON_DATA] || s->reader) return KVALUE_NULL;
+    KFiber* fiber = kvm_park(vm);
+    if (!fiber) return KVALUE_NULL;
+    s->reader = fiber;
+    vm->net->parked++;
+    // 数据可能已经在内核或暂存的块中, 由就绪队列读取
+    queue_ready(vm->net, s);
+    return KVALUE_NULL;
+}
+
+// 辅助函数：setTimeout 与 setInterval 的共同部分
+static KValue add_timer(KorelinVM* vm, int argc, const KValue* argv, bool repeat) {
+    if (argc < 2 || argc > 3) return KVALUE_NULL;
+    if (!kvalue_is_object_type(argv[0], KOBJ_FUNCTION) && !kvalue_is_object_type(argv[0], KOBJ_NATIVE)) {
+        return KVALUE_NULL;
+    }
+    if (argv[1].type != KVAL_INT || argv[1].as.integer < 0 || (repeat && argv[1].as.integer == 0)) {
+        return KVALUE_NULL;
+    }
+    KNetLoop* loop = get_loop(vm);
+    KNetTimer* timer = timer_alloc(loop);
+    timer->fn = kgc_handle_new(vm->heap, argv[0].as.object);
+    timer->has_arg = argc == 3;
+    timer->arg = timer->has_arg ? argv[2] : KVALUE_NULL;
+    timer->arg_handle = timer->arg.type == KVAL_OBJECT ? kgc_handle_new(vm->heap, timer->arg.as.object) : NULL;
+    timer->interval = repeat ? argv[1].as.integer : 0;
+    kwheel_add(&loop->wheel, &timer->node, (uint64_t)(now_ms() + argv[1].as.integer));
+    return KVALUE_INT(timer_id(timer));
+}
+
+// setTimeout(fn, ms[, value]) -> timer | null
+static KValue native_set_timeout(KorelinVM* vm, int argc, const KValue* argv) {
+    return add_timer(vm, argc, argv, false);
+}
+
+// setInterval(fn, ms[, value]) -> timer | null
+static KValue native_set_interval(KorelinVM* vm, int argc, const KValue* argv) {
+    return add_timer(vm, argc, argv, true);
+}
+
+// clearTimeout(timer) / clearInterval(timer) -> bool
+static KValue native_clear_timer(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    KNetTimer* timer = find_timer(vm, argv[0]);
+    if (!timer) return KVALUE_BOOL(false);
+    timer_release(vm, timer);
+    return KVALUE_BOOL(true);
+}
+
+// httpListen(host, port, handler) -> server | null
+static KValue native_http_listen(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    if (!kvalue_is_object_type(argv[2], KOBJ_FUNCTION) && !kvalue_is_object_type(argv[2], KOBJ_NATIVE)) {
+        return KVALUE_NULL;
+    }
+    int fd = open_listener(argv[0], argv[1]);
+    if (fd < 0) return KVALUE_NULL;
+
+    KNetHandlers* handlers = net_alloc(sizeof(KNetHandlers), "native_http_listen");
+    handlers->refs = 1;
+    for (int i = 0; i < KNET_EVENT_COUNT; i++) handlers->fn[i] = NULL;
+    handlers->fn[KNET_ON_REQUEST] = kgc_handle_new(vm->heap, argv[2].as.object);
+    KNetLoop* loop = get_loop(vm);
+    KNetSocket* s = socket_new(loop, fd, true, handlers);
+    handlers_release(vm->heap, handlers);
+    if (!s) return KVALUE_NULL;
+    s->http_server = true;
+    return KVALUE_INT(socket_id(loop, s));
+}
+
+// 辅助函数：取得正在处理的请求, conn 不是正在 request 处理函数中的 HTTP 连接时返回 NULL
+static const KHttpRequest* current_request(KorelinVM* vm, KValue id) {
+    KNetSocket* s = find_socket(vm, id);
+    return s && s->http ? s->http->current : NULL;
+}
+
+static KValue slice_value(KorelinVM* vm, KHttpSlice slice) {
+    return KVALUE_OBJECT(kstring_new(vm->heap, slice.data, slice.length));
+}
+
+// httpMethod(conn) -> string | null
+static KValue native_http_method(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    const KHttpRequest* request = current_request(vm, argv[0]);
+    return request ? slice_value(vm, request->method) : KVALUE_NULL;
+}
+
+// httpTarget(conn) -> string | null
+static KValue native_http_target(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    const KHttpRequest* request = current_request(vm, argv[0]);
+    return request ? slice_value(vm, request->target) : KVALUE_NULL;
+}
+
+// httpHeader(conn, name) -> string | null
+static KValue native_http_header(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    const KHttpRequest* request = current_request(vm, argv[0]);
+    if (!request || !kvalue_is_object_type(argv[1], KOBJ_STRING)) return KVALUE_NULL;
+    const KString* name = (const KString*)argv[1].as.object;
+    for (size_t i = 0; i < request->header_count; i++) {
+        const KHttpSlice* header = &request->headers[i].name;
+        if (header->length == name->length && strncasecmp(header->data, name->chars, name->length) == 0) {
+            return slice_value(vm, request->headers[i].value);
+        }
+    }
+    return KVALUE_NULL;
+}
+
+// httpBody(conn) -> string | null
+static KValue native_http_body(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    const KHttpRequest* request = current_request(vm, argv[0]);
+    return request ? slice_value(vm, request->body) : KVALUE_NULL;
+}
+
+// 辅助函数：检查 httpRespond / httpSendFile 的公共参数, 无效时返回 NULL
+static KNetSocket* response_socket(KorelinVM* vm, const KValue* argv, const KMap** headers) {
+    KNetSocket* s = find_socket(vm, argv[0]);
+    if (!s || !s->http || !s->http->current || s->http->responded) return NULL;
+    if (argv[1].type != KVAL_INT || argv[1].as.integer < 200 || argv[1].as.integer > 599) return NULL;
+    if (argv[2].type == KVAL_NULL) {
+        *headers = NULL;
+    } else if (kvalue_is_object_type(argv[2], KOBJ_MAP)) {
+        *headers = (const KMap*)argv[2].as.object;
+    } else {
+        return NULL;
+    }
+    return s;
+}
+
+// httpRespond(conn, status, headers, body) -> bool | null
+static KValue native_http_respond(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    const KMap* headers;
+    KNetSocket* s = response_socket(vm, argv, &headers);
+    if (!s || !kvalue_is_object_type(argv[3], KOBJ_STRING)) return KVALUE_NULL;
+    const KString* body = (const KString*)argv[3].as.object;
+    if (!http_write_response(vm, s, (int)argv[1].as.integer, headers, body->chars, body->length, -1)) {
+        return KVALUE_NULL;
+    }
+    return KVALUE_BOOL(true);
+}
+
+// httpSendFile(conn, status, headers, path) -> bool | null
+static KValue native_http_send_file(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    const KMap* headers;
+    KNetSocket* s = response_socket(vm, argv, &headers);
+    if (!s || !kvalue_is_object_type(argv[3], KOBJ_STRING)) return KVALUE_NULL;
+    const KString* path = (const KString*)argv[3].as.object;
+    if (memchr(path->chars, '\0', path->length)) return KVALUE_BOOL(false);
+    int fd = open(path->chars, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return KVALUE_BOOL(false);
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return KVALUE_BOOL(false);
+    }
+    if (!http_write_response(vm, s, (int)argv[1].as.integer, headers, NULL, (size_t)st.st_size, fd)) {
+        return KVALUE_NULL;
+    }
+    return KVALUE_BOOL(true);
+}
+
+bool knet_poll(KorelinVM* vm, bool block) {
+    KNetLoop* loop = vm->net;
+    if (!loop || loop->running) return false;
+    if (loop->parked == 0) {
+        flush_submissions(loop);
+        return false;
+    }
+    loop->running = true;
+    loop->stopped = false;
+    loop->failed = false;
+    long long wait = block && !loop->ready ? timer_timeout(loop) : 0;
+    bool ok = poll_once(vm, wait > 1000000 ? 1000000 : (int)wait);
+    // 处理函数的运行时错误与协程的一样计入失败
+    if (loop->failed) vm->failures++;
+    loop->running = false;
+    return ok;
+}
+
+void knet_loop_free(KorelinVM* vm) {
+    KNetLoop* loop = vm->net;
+    if (!loop) return;
+    for (size_t i = 0; i < loop->slot_count; i++) {
+        if (loop->slots[i]) close_socket(vm, loop->slots[i], false);
+    }
+    // 就绪队列中关闭的套接字还没有挂到待释放链表
+    for (KNetSocket* s = loop->ready; s;) {
+        KNetSocket* next = s->next;
+        s->next = loop->dead;
+        loop->dead = s;
+        s = next;
+    }
+    if (loop->ring) {
+        // 关闭 io_uring 实例会取消所有未完成的请求, 之后可以释放所有套接字
+        kuring_free(loop->ring);
+        kuring_buffers_free(loop->ring, &loop->buffers);
+        free(loop->ring);
+        loop->ring = NULL;
+        for (KNetSocket* s = loop->dead; s; s = s->next) {
+            s->inflight = 0;
+            s->send_queued = false;
+        }
+        loop->sends = NULL;
+    }
+    release_dead(vm);
+    for (size_t i = 0; i < loop->timer_block_count; i++) {
+        for (size_t j = 0; j < KNET_TIMER_BLOCK; j++) {
+            KNetTimer* timer = &loop->timer_blocks[i][j];
+            if (timer->fn || timer->fiber) timer_release(vm, timer);
+        }
+        free(loop->timer_blocks[i]);
+    }
+    free(loop->timer_blocks);
+    free(loop->free_timers);
+    while (loop->pool) {
+        KNetChunk* next = loop->pool->next;
+        free(loop->pool);
+        loop->pool = next;
+    }
+    if (loop->epoll_fd >= 0) close(loop->epoll_fd);
+    free(loop->read_buffer);
+    free(loop->slots);
+    free(loop->generations);
+    free(loop->free_slots);
+    free(loop);
+    vm->net = NULL;
+}
+
+const KriNative kri_net_natives[] = {
+    {"netListen", 3, native_listen},
+    {"netConnect", 3, native_connect},
+    {"netSend", 2, native_send},
+    {"netClose", 1, native_close},
+    {"netPause", 1, native_pause},
+    {"netResume", 1, native_resume},
+    {"netPort", 1, native_port},
+    {"netRun", -1, native_run},
+    {"netStop", 0, native_stop},
+    {"netBackend", 0, native_backend},
+    {"setTimeout", -1, native_set_timeout},
+    {"setInterval", -1, native_set_interval},
+    {"clearTimeout", 1, native_clear_timer},
+    {"clearInterval", 1, native_clear_timer},
+    {"sleep", 1, native_sleep},
+    {"netRecv", 1, native_recv},
+    {"httpListen", 3, native_http_listen},
+    {"httpMethod", 1, native_http_method},
+    {"httpTarget", 1, native_http_target},
+    {"httpHeader", 2, native_http_header},
+    {"httpBody", 1, native_http_body},
+    {"httpRespond", 4, native_http_respond},
+    {"httpSendFile", 4, native_http_send_file},
+    {NULL, 0, NULL},
+};
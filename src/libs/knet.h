@@ -5,4 +5,120 @@
 #ifndef KORELIN_KNET_H
 #define KORELIN_KNET_H
 
-#endif //KORELIN_KNET_H
\ No newline at end of file
+#include "../krilib.h"
+
+// =============================================================================
+// 非阻塞网络: 每个虚拟机一个事件循环, 使用 io_uring 或边沿触发 (EPOLLET) 的 epoll
+//
+//   netListen(host, port, handlers) -> server | null
+//                      在 host:port 上监听 (host 为 "" 时监听所有地址, port 为 0 时由系统分配)
+//   netConnect(host, port, handlers) -> conn | null
+//                      发起非阻塞连接, 连接建立后调用 connect 处理函数
+//   netSend(conn, string) -> bool | null
+//                      发送数据: 能立即写出的部分直接写入套接字, 其余复制到发送缓冲。
+//                      待发送数据超过 KNET_HIGH_WATER 时返回 false (背压), 并暂停读取该
+//                      连接; 回落到 KNET_LOW_WATER 以下时调用 drain 并恢复读取
+//   netClose(id)       关闭连接 (先发送完缓冲中的数据) 或监听器
+//   netPause(conn) / netResume(conn)   暂停 / 恢复读取
+//   netPort(id) -> int 本地端口
+//   netRun([ms]) -> bool
+//                      运行事件循环, 直到没有监听器、连接与定时器, 调用了 netStop 或超过 ms 毫秒;
+//                      处理函数出现运行时错误时停止并返回 false
+//   netStop()          让 netRun 在处理完当前事件后返回
+//   netBackend() -> string
+//                      事件循环使用的后端: "io_uring" 或 "epoll"
+//   setTimeout(fn, ms[, value]) -> timer | null
+//   setInterval(fn, ms[, value]) -> timer | null
+//                      ms 毫秒后 (setInterval 为每 ms 毫秒) 在 netRun 中调用 fn(value), 没有
+//                      value 时调用 fn()
+//   clearTimeout(timer) / clearInterval(timer) -> bool
+//                      取消定时器; 已到期或已取消时返回 false
+//   sleep(ms) -> bool | null
+//                      挂起当前协程 ms 毫秒 (见 kvm.h), 之后返回 true
+//   netRecv(conn) -> string | null
+//                      挂起当前协程直到连接收到数据, 连接关闭时返回 null
+//
+// handlers 是以事件名为键、函数为值的 map, 未出现的事件被忽略:
+//   accept(conn)       监听器接受了新连接 (新连接使用监听器的处理函数)
+//   connect(conn)      netConnect 的连接已建立
+//   data(conn, string) 收到数据
+//   drain(conn)        发送缓冲回落到低水位以下 (只在 netSend 返回过 false 之后调用)
+//   close(conn)        连接已关闭 (对端关闭、出错或 netClose), 之后 conn 失效
+//
+// 没有 data 处理函数的连接按需读取: 数据留在内核中, 协程调用 netRecv 时才读取一次并交给它,
+// 读取的速度由协程决定。sleep 与 netRecv 只挂起调用它们的协程, 事件循环照常处理其他连接;
+// 在处理函数 (经 kvm_call 回调) 中调用时返回 null。主程序不调用 netRun 时, 虚拟机的调度器
+// 在所有协程都挂起时通过 knet_poll 驱动事件循环。
+//
+// 监听器与连接以整数 id 表示, 关闭后 id 不会被重用。处理函数在 netRun 中通过 kvm_call
+// 调用, 可以在其中调用上述所有函数 (netRun 除外)。
+//
+// 内核支持时 (Linux 6.0 起) 使用 io_uring: 监听器使用多发的 accept, 连接使用从提供缓冲环
+// 取缓冲的多发 recv, 套接字登记在注册文件表中; 一轮中产生的所有请求 (包括各连接的
+// sendmsg) 在等待完成时一次提交。io_uring 不可用时自动使用 epoll, 设置环境变量
+// KORELIN_NET_BACKEND=epoll 也可以强制使用 epoll。两种后端对脚本的行为相同。
+//
+// 定时器放在分层时间轮 (kwheel.h) 中, 精度为 1 毫秒, 插入与取消都是 O(1), 数十万个连接
+// 各自的超时定时器也不会拖慢事件循环。每次等待的超时取最近的定时器, 醒来后一次取出所有
+// 到期的定时器并依次调用; setInterval 按原定的节拍续期, 不补发因处理函数过慢而错过的周期。
+//
+// epoll 后端中每个连接的每轮读取最多 KNET_READ_BUDGET 次, 仍有数据的连接排到下一轮, 避免
+// 一个快速的发送方占满事件循环。读取使用事件循环共享的缓冲区; 发送缓冲由固定大小的块
+// 组成, 块在事件循环内的池中复用。
+//
+// HTTP/1.1 服务器建立在同一个事件循环上:
+//
+//   httpListen(host, port, handler) -> server | null
+//                      在 host:port 上监听 HTTP 连接, 每个请求调用一次 handler(conn)
+//   httpMethod(conn) / httpTarget(conn) / httpBody(conn) -> string | null
+//   httpHeader(conn, name) -> string | null
+//                      当前请求的方法、请求目标 (路径与查询串)、消息体与头部 (名字不区分
+//                      大小写, 有多个时取第一个)。只能在 handler 执行期间调用
+//   httpRespond(conn, status, headers, body) -> bool | null
+//                      回复当前请求; headers 是额外头部的 map 或 null (Content-Length、
+//                      Date 与 Connection 由服务器生成)
+//   httpSendFile(conn, status, headers, path) -> bool | null
+//                      以文件内容回复当前请求, 由 sendfile 在内核中发送; 文件无法打开
+//                      或不是普通文件时返回 false, 此时仍可以用其他方式回复
+//
+// 请求在连接的接收缓冲中原地解析: 方法、目标、头部名与值都是指向缓冲的切片, 只有脚本
+// 取用的部分才会复制成字符串。一次读取中的多个请求 (流水线) 依次处理, 响应按请求的顺序
+// 写出; 连接默认保持 (HTTP/1.0 需要 Connection: keep-alive)。状态行与头部格式化到一块
+// 缓冲, 与消息体一起由一次 sendmsg 写出。handler 没有回复时服务器回复 500; 无效的请求
+// 回复 4xx/5xx 后关闭连接。不支持分块编码的请求体 (回复 501)。
+// =============================================================================
+
+#define KNET_CHUNK_SIZE 16384               // 发送缓冲块的大小
+#define KNET_POOL_MAX 1024                  // 池中保留的空闲块数上限
+#define KNET_HIGH_WATER (256 * 1024)        // 待发送字节数超过此值时施加背压
+#define KNET_LOW_WATER (64 * 1024)          // 待发送字节数回落到此值以下时解除背压
+#define KNET_READ_SIZE 65536                // 单次读取的最大字节数
+#define KNET_READ_BUDGET 8                  // 每个连接每轮最多读取的次数
+#define KNET_URING_ENTRIES 1024            // io_uring 提交队列的项数
+#define KNET_URING_BUFFERS 256              // 提供缓冲环中的缓冲数 (每块 KNET_CHUNK_SIZE 字节)
+#define KNET_URING_FILES 4096               // 注册文件表的大小, 槽位更大的套接字直接使用 fd
+#define KNET_TIMER_BLOCK 1024              // 定时器按块分配, 每块的定时器数
+#define KNET_HTTP_MAX_HEADERS 64            // 请求头部的最大数目
+#define KNET_HTTP_MAX_HEAD 65536            // 请求行与头部的最大字节数
+#define KNET_HTTP_MAX_REQUEST (1024 * 1024) // 请求 (含消息体) 的最大字节数
+
+typedef struct KNetLoop KNetLoop;
+
+extern const KriNative kri_net_natives[];
+
+// --- 函数声明 ---
+
+/**
+ * @brief 处理一轮事件 (含到期的定时器), 由协程调度器在运行队列为空时调用。
+ * @param vm 虚拟机。
+ * @param block 为 true 时等待到有事件或定时器到期, 否则只处理已经发生的。
+ * @return 没有在 sleep 或 netRecv 中挂起的协程 (再等待也不会唤醒任何协程) 时返回 false。
+ */
+bool knet_poll(KorelinVM* vm, bool block);
+
+/**
+ * @brief 关闭虚拟机的事件循环及其所有套接字 (不调用处理函数), 由 kvm_free 调用。
+ */
+void knet_loop_free(KorelinVM* vm);
+
+#endif //KORELIN_KNET_H
@@ -0,0 +1,352 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#include "kparallel.h"
+#include "../kpool.h"
+#include "../kvm.h"
+#include "kchannel.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    PARALLEL_FOR,
+    PARALLEL_MAP,
+    PARALLEL_FILTER,
+    PARALLEL_REDUCE,
+} ParallelOp;
+
+// 工作线程中第一次出错的调用
+typedef struct ParallelFailure {
+    bool failed;
+    size_t index;                   // 出错的元素下标 (reduce 时为块的起点)
+    char* error;                    // 运行时错误的信息与调用栈, 取自隔离实例; 返回值不能传递时为 NULL
+    const char* type;               // 不能传递的返回值的类型名
+} ParallelFailure;
+
+// 一次数据并行操作; 执行期间调用者的虚拟机停在原生函数中, 它的堆只被读取
+typedef struct ParallelJob {
+    ParallelOp op;
+    const char* name;               // 原生函数名, 用于错误信息
+    KorelinVM* vm;                  // 调用者
+    KValue fn;                      // 调用者中的函数
+    const KArray* array;            // 输入数组, parallelFor 时为 NULL
+    long long start;                // parallelFor 的起点
+    KChanMessage* inputs;           // KELEM_VALUE 数组的元素, 由调用者预先转换; 取出后置为 null
+    KChanMessage* results;          // for/map 的返回值, reduce 的每块的结果
+    bool* keep;                     // filter 的判断结果
+    size_t grain;
+    atomic_bool failed;
+    KorelinVM* isolates[KPOOL_MAX_WORKERS];     // 各工作线程的隔离实例, 第一次领到块时创建
+    KGCHandle* functions[KPOOL_MAX_WORKERS];    // fn 在各隔离实例中的对应函数
+    ParallelFailure failures[KPOOL_MAX_WORKERS];
+} ParallelJob;
+
+// 辅助函数：取出第 index 个参数 (在 isolate 的堆中)
+static KValue job_input(ParallelJob* job, KorelinVM* isolate, size_t index) {
+    if (!job->array) return KVALUE_INT(job->start + (long long)index);
+    if (!job->inputs) return karray_get(job->array, index);
+    KValue value = kchan_unpack(isolate->heap, &job->inputs[index]);
+    job->inputs[index].type = KVAL_NULL;
+    return value;
+}
+
+// 辅助函数：把 isolate 中的返回值转换为消息, 值不能传递时返回 false
+static bool job_output(KorelinVM* isolate, KValue value, KChanMessage* out) {
+    // 转换时展平 rope 需要分配, 返回值不在任何根中
+    bool object = value.type == KVAL_OBJECT;
+    if (object) kgc_push_root(isolate->heap, value.as.object);
+    bool ok = kchan_pack(isolate->heap, value, out);
+    if (object) kgc_pop_roots(isolate->heap, 1);
+    return ok;
+}
+
+// 辅助函数：记录 worker 中第 index 个调用出错; type 不为 NULL 时是返回值不能传递, 否则取出隔离实例中的运行时错误
+static void job_fail(ParallelJob* job, int worker, size_t index, const char* type) {
+    ParallelFailure* failure = &job->failures[worker];
+    KorelinVM* isolate = job->isolates[worker];
+    failure->failed = true;
+    failure->index = index;
+    failure->type = type;
+    if (!type) {
+        failure->error = isolate->error;
+        isolate->error = NULL;
+    }
+    atomic_store_explicit(&job->failed, true, memory_order_relaxed);
+}
+
+static void job_task(void* context, int worker, size_t begin, size_t end) {
+    ParallelJob* job = context;
+    if (atomic_load_explicit(&job->failed, memory_order_relaxed)) return;
+    KorelinVM* isolate = job->isolates[worker];
+    if (!isolate) {
+        // fn 已由 check_callable 检查, 一定能够导入
+        KValue fn;
+        isolate = kvm_isolate(job->vm);
+        job->isolates[worker] = isolate;
+        kvm_import(isolate, job->fn, &fn);
+        job->functions[worker] = kgc_handle_new(isolate->heap, fn.as.object);
+    }
+    KGCHandle* fn = job->functions[worker];
+
+    if (job->op == PARALLEL_REDUCE) {
+        KValue acc = job_input(job, isolate, begin);
+        for (size_t i = begin + 1; i < end; i++) {
+            // 取出参数时可能分配
+            bool object = acc.type == KVAL_OBJECT;
+            if (object) kgc_push_root(isolate->heap, acc.as.object);
+            KValue args[2] = {acc, job_input(job, isolate, i)};
+            if (object) kgc_pop_roots(isolate->heap, 1);
+            if (!kvm_call(isolate, KVALUE_OBJECT(fn->object), 2, args, &acc)) {
+                job_fail(job, worker, i, NULL);
+                return;
+            }
+        }
+        if (!job_output(isolate, acc, &job->results[begin / job->grain])) {
+            job_fail(job, worker, begin, kvalue_type_name(acc));
+        }
+        return;
+    }
+    for (size_t i = begin; i < end; i++) {
+        KValue arg = job_input(job, isolate, i);
+        KValue result;
+        if (!kvm_call(isolate, KVALUE_OBJECT(fn->object), 1, &arg, &result)) {
+            job_fail(job, worker, i, NULL);
+            return;
+        }
+        if (job->op == PARALLEL_FILTER) {
+            job->keep[i] = kvalue_truthy(result);
+        } else if (!job_output(isolate, result, &job->results[i])) {
+            job_fail(job, worker, i, kvalue_type_name(result));
+            return;
+        }
+        if (atomic_load_explicit(&job->failed, memory_order_relaxed)) return;
+    }
+}
+
+// 辅助函数：检查 fn 能否在隔离实例中以 argc 个参数调用, 不能时报告运行时错误
+static bool check_callable(KorelinVM* vm, const char* name, KValue fn, int argc) {
+    if (kvalue_is_object_type(fn, KOBJ_FUNCTION)) {
+        const KProto* proto = ((const KFunction*)fn.as.object)->proto;
+        if (proto->arity == argc) return true;
+        kvm_raise(vm, "%s: %s expects %d argument(s) but is called with %d", name, proto->name, proto->arity, argc);
+        return false;
+    }
+    if (kvalue_is_object_type(fn, KOBJ_NATIVE) && (fn.as.object->flags & KGC_FLAG_SHARED)) {
+        const KriNative* native = ((const KNative*)fn.as.object)->native;
+        if (native->arity < 0 || native->arity == argc) return true;
+        kvm_raise(vm, "%s: %s expects %d argument(s) but is called with %d", name, native->name, native->arity, argc);
+        return false;
+    }
+    kvm_raise(vm, "%s: cannot call a value of type %s", name, kvalue_type_name(fn));
+    return false;
+}
+
+// 辅助函数：在调用者中报告下标最小的出错调用, 释放记录的错误
+static void job_report(ParallelJob* job) {
+    const ParallelFailure* first = NULL;
+    for (int i = 0; i < KPOOL_MAX_WORKERS; i++) {
+        const ParallelFailure* failure = &job->failures[i];
+        if (failure->failed && (!first || failure->index < first->index)) first = failure;
+    }
+    if (first && first->error) {
+        // 工作线程中的调用帧位于调用者的调用栈之上, 与顺序调用时相同
+        kvm_raise(job->vm, "%s", first->error);
+    } else if (first) {
+        kvm_raise(job->vm, "%s: the function returned a value that cannot be passed between threads (%s)", job->name,
+                  first->type);
+    }
+    for (int i = 0; i < KPOOL_MAX_WORKERS; i++) free(job->failures[i].error);
+}
+
+// 辅助函数：执行操作; 出错时返回 false。返回后隔离实例都已释放, job->inputs 已释放
+static bool job_run(ParallelJob* job, size_t count, size_t result_count) {
+    bool ok = true;
+    if (job->array && job->array->kind == KELEM_VALUE) {
+        job->inputs = calloc(count ? count : 1, sizeof(KChanMessage));
+        if (!job->inputs) {
+            fprintf(stderr, "Error: calloc failed in job_run\n");
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = 0; ok && i < count; i++) {
+            ok = kchan_pack(job->vm->heap, job->array->items.values[i], &job->inputs[i]);
+            if (!ok) {
+                kvm_raise(job->vm, "%s: element %zu cannot be passed between threads (%s)", job->name, i,
+                          kvalue_type_name(job->array->items.values[i]));
+            }
+        }
+    }
+    if (result_count > 0) {
+        job->results = calloc(result_count, sizeof(KChanMessage));
+        if (!job->results) {
+            fprintf(stderr, "Error: calloc failed in job_run\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (ok) kpool_run(count, job->grain, job_task, job);
+    if (ok && atomic_load(&job->failed)) {
+        job_report(job);
+        ok = false;
+    }
+
+    for (int i = 0; i < KPOOL_MAX_WORKERS; i++) {
+        if (!job->isolates[i]) continue;
+        kgc_handle_free(job->isolates[i]->heap, job->functions[i]);
+        kvm_free(job->isolates[i]);
+    }
+    if (job->inputs) {
+        for (size_t i = 0; i < count; i++) kchan_discard(&job->inputs[i]);
+        free(job->inputs);
+        job->inputs = NULL;
+    }
+    if (!ok) {
+        for (size_t i = 0; i < result_count; i++) kchan_discard(&job->results[i]);
+    }
+    return ok;
+}
+
+// 辅助函数：按顺序取出 count 个结果, 组成新的数组
+static KValue collect_results(KGCHeap* heap, KChanMessage* results, size_t count) {
+    KArray* array = karray_new(heap, count);
+    kgc_push_root(heap, &array->obj);
+    for (size_t i = 0; i < count; i++) {
+        KValue value = kchan_unpack(heap, &results[i]);
+        // 数组从原始数值转换为 KELEM_VALUE 时需要分配
+        bool object = value.type == KVAL_OBJECT;
+        if (object) kgc_push_root(heap, value.as.object);
+        karray_push(heap, array, value);
+        if (object) kgc_pop_roots(heap, 1);
+    }
+    kgc_pop_roots(heap, 1);
+    return KVALUE_OBJECT(array);
+}
+
+// 辅助函数：parallelFor 与 parallelMap
+static KValue map(KorelinVM* vm, ParallelJob* job, size_t count) {
+    job->grain = kpool_grain(count);
+    if (!job_run(job, count, count)) {
+        free(job->results);
+        return KVALUE_NULL;
+    }
+    KValue result = collect_results(vm->heap, job->results, count);
+    free(job->results);
+    return result;
+}
+
+// parallelFor(start, end, f) -> array | null
+static KValue native_parallel_for(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    if (argv[0].type != KVAL_INT || argv[1].type != KVAL_INT) return KVALUE_NULL;
+    if (!check_callable(vm, "parallelFor", argv[2], 1)) return KVALUE_NULL;
+    long long start = argv[0].as.integer, end = argv[1].as.integer;
+    size_t count = end > start ? (size_t)(end - start) : 0;
+    ParallelJob job = {.op = PARALLEL_FOR, .name = "parallelFor", .vm = vm, .fn = argv[2], .start = start};
+    return map(vm, &job, count);
+}
+
+// parallelMap(a, f) -> array | null
+static KValue native_parallel_map(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    if (!kvalue_is_array(argv[0]) || !check_callable(vm, "parallelMap", argv[1], 1)) return KVALUE_NULL;
+    const KArray* array = (const KArray*)argv[0].as.object;
+    ParallelJob job = {.op = PARALLEL_MAP, .name = "parallelMap", .vm = vm, .fn = argv[1], .array = array};
+    return map(vm, &job, array->count);
+}
+
+// parallelFilter(a, f) -> array | null
+static KValue native_parallel_filter(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    if (!kvalue_is_array(argv[0]) || !check_callable(vm, "parallelFilter", argv[1], 1)) return KVALUE_NULL;
+    const KArray* array = (const KArray*)argv[0].as.object;
+    size_t count = array->count;
+    ParallelJob job = {.op = PARALLEL_FILTER, .name = "parallelFilter", .vm = vm, .fn = argv[1], .array = array};
+    job.grain = kpool_grain(count);
+    job.keep = calloc(count ? count : 1, sizeof(bool));
+    if (!job.keep) {
+        fprintf(stderr, "Error: calloc failed in native_parallel_filter\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!job_run(&job, count, 0)) {
+        free(job.keep);
+        return KVALUE_NULL;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) kept += job.keep[i];
+    // 结果与原数组形式相同; 预留容量后追加不再分配
+    KArray* result;
+    if (array->kind == KELEM_VALUE) {
+        result = karray_new(vm->heap, kept);
+        for (size_t i = 0; i < count; i++) {
+            if (job.keep[i]) karray_push(vm->heap, result, array->items.values[i]);
+        }
+    } else {
+        result = karray_new_like(vm->heap, array, kept);
+        size_t size = kelement_size(array->kind);
+        char* out = result->items.data;
+        for (size_t i = 0; i < count; i++) {
+            if (!job.keep[i]) continue;
+            memcpy(out, (const char*)array->items.data + i * size, size);
+            out += size;
+        }
+    }
+    free(job.keep);
+    return KVALUE_OBJECT(result);
+}
+
+// parallelReduce(a, f, init) -> value
+static KValue native_parallel_reduce(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    if (!kvalue_is_array(argv[0]) || !check_callable(vm, "parallelReduce", argv[1], 2)) return KVALUE_NULL;
+    const KArray* array = (const KArray*)argv[0].as.object;
+    size_t count = array->count;
+    if (count == 0) return argv[2];
+    ParallelJob job = {.op = PARALLEL_REDUCE, .name = "parallelReduce", .vm = vm, .fn = argv[1], .array = array};
+    job.grain = kpool_grain(count);
+    size_t chunks = (count - 1) / job.grain + 1;
+    if (!job_run(&job, count, chunks)) {
+        free(job.results);
+        return KVALUE_NULL;
+    }
+
+    // 在调用者中按顺序归约各块的结果; kvm_call 期间对象可能移动, 函数与累积值放在句柄中
+    KGCHeap* heap = vm->heap;
+    KValue acc = argv[2];
+    KGCHandle* fn = kgc_handle_new(heap, argv[1].as.object);
+    KGCHandle* held = kgc_handle_new(heap, acc.type == KVAL_OBJECT ? acc.as.object : NULL);
+    size_t next = 0;
+    bool ok = true;
+    for (; ok && next < chunks; next++) {
+        KValue args[2] = {acc, kchan_unpack(heap, &job.results[next])};
+        if (args[0].type == KVAL_OBJECT) args[0].as.object = held->object;
+        ok = kvm_call(vm, KVALUE_OBJECT(fn->object), 2, args, &acc);
+        held->object = acc.type == KVAL_OBJECT ? acc.as.object : NULL;
+    }
+    for (; next < chunks; next++) kchan_discard(&job.results[next]);
+    kgc_handle_free(heap, fn);
+    kgc_handle_free(heap, held);
+    free(job.results);
+    // 错误已经输出, 调用者与顺序调用时一样随之结束
+    if (!ok) vm->raised = true;
+    return ok ? acc : KVALUE_NULL;
+}
+
+// parallelWorkers() -> int
+static KValue native_parallel_workers(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)vm;
+    (void)argc;
+    (void)argv;
+    return KVALUE_INT(kpool_workers());
+}
+
+const KriNative kri_parallel_natives[] = {
+    {"parallelFor", 3, native_parallel_for},
+    {"parallelMap", 2, native_parallel_map},
+    {"parallelFilter", 2, native_parallel_filter},
+    {"parallelReduce", 3, native_parallel_reduce},
+    {"parallelWorkers", 0, native_parallel_workers},
+    {NULL, 0, NULL},
+};
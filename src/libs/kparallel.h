@@ -0,0 +1,34 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#ifndef KORELIN_KPARALLEL_H
+#define KORELIN_KPARALLEL_H
+
+#include "../krilib.h"
+
+// =============================================================================
+// 数据并行
+//
+// 在线程池 (见 kpool.h) 的所有工作线程上调用同一个函数, 处理下标区间或数组的各个元素。
+// 虚拟机的堆只能被一个线程使用, 所以每个工作线程在一次操作中使用自己的隔离实例
+// (kvm_isolate): 它的全局变量复制自调用者, 标量、原生函数、脚本函数与冻结的值 (见
+// libs/kchannel.h) 都可以使用; 读取其他全局对象 (如可变的数组, 需要时先 freeze) 或给
+// 全局变量赋值是运行时错误。函数的参数与返回值按通道消息的规则在堆之间传递: 原始数值
+// 的数组与类型数组的元素直接读取, 其他元素与返回值共享 (冻结的值) 或深复制。
+//
+// 函数应当没有副作用。任何一次调用出错时, 已经开始的其他调用照常结束, 然后这个错误
+// (下标最小的一个, 连同工作线程中的调用栈) 在调用者中报告, 调用者与顺序调用时一样
+// 随之结束; 函数不能调用、参数个数不符、元素或返回值不能传递也是运行时错误。
+// =============================================================================
+
+// 数据并行的原生函数:
+//   parallelFor(start, end, f) -> array       [f(start), f(start + 1), ..., f(end - 1)]
+//   parallelMap(a, f) -> array                [f(a[0]), f(a[1]), ...]
+//   parallelFilter(a, f) -> array             f(x) 为真的元素, 保持原来的顺序与数组形式
+//   parallelReduce(a, f, init) -> value       f 必须满足结合律: 每块从第一个元素开始归约,
+//                                             各块的结果再按顺序从 init 开始归约
+//   parallelWorkers() -> int                  工作线程数 (环境变量 KORELIN_THREADS)
+extern const KriNative kri_parallel_natives[];
+
+#endif //KORELIN_KPARALLEL_H
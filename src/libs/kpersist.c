@@ -0,0 +1,816 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#include "kpersist.h"
+#include "kmap.h"
+#include "../kstruct.h"
+#include "../kvm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 哈希共 32 位, 位移超过 30 的层为碰撞节点
+#define HAMT_MAX_SHIFT 30
+
+// 编辑标记全局递增, 每个 transient 得到唯一的标记
+static uint64_t next_edit = 1;
+
+static uint64_t new_edit(void) {
+    return __atomic_fetch_add(&next_edit, 1, __ATOMIC_RELAXED);
+}
+
+// 一次修改操作的上下文: 操作过程中新分配的节点 (以及要写入的键与值) 作为临时根,
+// 直到结果挂到返回的对象上为止
+typedef struct Builder {
+    KGCHeap* heap;
+    uint64_t edit;              // 可以就地修改的节点的标记, 0 表示全部复制
+    size_t roots;
+} Builder;
+
+// 辅助函数：分配对象并压入临时根; 调用者必须在下一次分配之前初始化对象的所有引用
+static void* builder_alloc(Builder* b, uint16_t type, size_t size) {
+    KGCObject* obj = kgc_alloc(b->heap, type, size);
+    kgc_push_root(b->heap, obj);
+    b->roots++;
+    return obj;
+}
+
+// 辅助函数：把操作的参数值也作为临时根 (原生函数中新复制的结构体值只被 C 局部变量引用)
+static void builder_keep(Builder* b, KValue value) {
+    if (value.type != KVAL_OBJECT) return;
+    kgc_push_root(b->heap, value.as.object);
+    b->roots++;
+}
+
+static void builder_finish(Builder* b) {
+    kgc_pop_roots(b->heap, b->roots);
+}
+
+// 辅助函数：写入槽位并执行写屏障 (对象可能在本次操作的某次分配中已被标记)
+static inline void set_slot(Builder* b, KGCObject* owner, KValue* slot, KValue value) {
+    *slot = value;
+    kvalue_write_barrier(b->heap, owner, value);
+}
+
+// =============================================================================
+// HAMT 节点
+// =============================================================================
+
+static inline unsigned popcount(uint32_t x) {
+    return (unsigned)__builtin_popcount(x);
+}
+
+static inline uint32_t branch_bit(uint32_t hash, unsigned shift) {
+    return 1u << ((hash >> shift) & KPERSIST_MASK);
+}
+
+// 辅助函数：分支 bit 的键值对在 slots 中的位置
+static inline unsigned pair_index(const KHamtNode* node, uint32_t bit) {
+    return 2 * popcount(node->datamap & (bit - 1));
+}
+
+// 辅助函数：分支 bit 的子节点在 slots 中的位置
+static inline unsigned child_index(const KHamtNode* node, uint32_t bit) {
+    return 2 * popcount(node->datamap) + popcount(node->nodemap & (bit - 1));
+}
+
+static inline size_t hamt_slot_count(const KHamtNode* node) {
+    return (node->obj.size - sizeof(KHamtNode)) / sizeof(KValue);
+}
+
+static inline KHamtNode* hamt_child(const KHamtNode* node, unsigned index) {
+    return (KHamtNode*)node->slots[index].as.object;
+}
+
+// 辅助函数：创建 slot_count 个槽位的节点, 槽位初始化为 null
+static KHamtNode* hamt_node_new(Builder* b, uint32_t datamap, uint32_t nodemap, size_t slot_count) {
+    KHamtNode* node = builder_alloc(b, KOBJ_HAMT_NODE, sizeof(KHamtNode) + slot_count * sizeof(KValue));
+    node->edit = b->edit;
+    node->datamap = datamap;
+    node->nodemap = nodemap;
+    for (size_t i = 0; i < slot_count; i++) node->slots[i] = KVALUE_NULL;
+    return node;
+}
+
+// 辅助函数：返回可以就地修改的节点, 不属于当前 transient 的节点复制一份
+static KHamtNode* hamt_editable(Builder* b, KHamtNode* node) {
+    if (b->edit && node->edit == b->edit) return node;
+    size_t count = hamt_slot_count(node);
+    KHamtNode* copy = hamt_node_new(b, node->datamap, node->nodemap, count);
+    memcpy(copy->slots, node->slots, count * sizeof(KValue));
+    return copy;
+}
+
+// 辅助函数：复制节点并在 at 处插入 inserted 个槽位 (inserted 为负时删除 -inserted 个), 新槽位为 null
+static KHamtNode* hamt_resize(Builder* b, const KHamtNode* node, uint32_t datamap, uint32_t nodemap, unsigned at,
+                              int inserted) {
+    size_t count = hamt_slot_count(node);
+    KHamtNode* copy = hamt_node_new(b, datamap, nodemap, (size_t)((ptrdiff_t)count + inserted));
+    if (inserted >= 0) {
+        memcpy(copy->slots, node->slots, at * sizeof(KValue));
+        memcpy(copy->slots + at + inserted, node->slots + at, (count - at) * sizeof(KValue));
+    } else {
+        memcpy(copy->slots, node->slots, at * sizeof(KValue));
+        memcpy(copy->slots + at, node->slots + at - inserted, (count - at + (size_t)inserted) * sizeof(KValue));
+    }
+    return copy;
+}
+
+// 辅助函数：分支 bit 的键值对换成子节点 child (两个键在本层落在同一个分支)
+static KHamtNode* hamt_pair_to_child(Builder* b, const KHamtNode* node, uint32_t bit, KHamtNode* child) {
+    size_t count = hamt_slot_count(node);
+    unsigned pairs = 2 * popcount(node->datamap);
+    unsigned index = pair_index(node, bit);
+    unsigned before = popcount(node->nodemap & (bit - 1));   // 新子节点之前的子节点个数
+    KHamtNode* result = hamt_node_new(b, node->datamap & ~bit, node->nodemap | bit, count - 1);
+    memcpy(result->slots, node->slots, index * sizeof(KValue));
+    memcpy(result->slots + index, node->slots + index + 2, (pairs - 2 - index + before) * sizeof(KValue));
+    memcpy(result->slots + pairs - 1 + before, node->slots + pairs + before, (count - pairs - before) * sizeof(KValue));
+    set_slot(b, &result->obj, &result->slots[pairs - 2 + before], KVALUE_OBJECT(child));
+    return result;
+}
+
+// 辅助函数：分支 bit 的子节点换成键值对 (子节点只剩一个键值对时收回到父节点)
+static KHamtNode* hamt_child_to_pair(Builder* b, const KHamtNode* node, uint32_t bit, KValue key, KValue value) {
+    size_t count = hamt_slot_count(node);
+    unsigned at = pair_index(node, bit);
+    unsigned index = child_index(node, bit);
+    KHamtNode* result = hamt_node_new(b, node->datamap | bit, node->nodemap & ~bit, count + 1);
+    memcpy(result->slots, node->slots, at * sizeof(KValue));
+    memcpy(result->slots + at + 2, node->slots + at, (index - at) * sizeof(KValue));
+    memcpy(result->slots + index + 2, node->slots + index + 1, (count - index - 1) * sizeof(KValue));
+    set_slot(b, &result->obj, &result->slots[at], key);
+    set_slot(b, &result->obj, &result->slots[at + 1], value);
+    return result;
+}
+
+// 辅助函数：把两个哈希在 shift 之前的各层都相同的键值对放入以 shift 为起点的新子树
+static KHamtNode* hamt_merge(Builder* b, unsigned shift, KValue k1, uint32_t h1, KValue v1, KValue k2, uint32_t h2,
+                             KValue v2) {
+    if (shift > HAMT_MAX_SHIFT) {
+        KHamtNode* node = hamt_node_new(b, 2, 0, 4);
+        node->slots[0] = k1;
+        node->slots[1] = v1;
+        node->slots[2] = k2;
+        node->slots[3] = v2;
+        return node;
+    }
+    uint32_t bit1 = branch_bit(h1, shift);
+    uint32_t bit2 = branch_bit(h2, shift);
+    if (bit1 == bit2) {
+        KHamtNode* child = hamt_merge(b, shift + KPERSIST_BITS, k1, h1, v1, k2, h2, v2);
+        KHamtNode* node = hamt_node_new(b, 0, bit1, 1);
+        set_slot(b, &node->obj, &node->slots[0], KVALUE_OBJECT(child));
+        return node;
+    }
+    KHamtNode* node = hamt_node_new(b, bit1 | bit2, 0, 4);
+    unsigned first = bit1 < bit2 ? 0 : 2;
+    node->slots[first] = k1;
+    node->slots[first + 1] = v1;
+    node->slots[2 - first] = k2;
+    node->slots[3 - first] = v2;
+    return node;
+}
+
+static bool hamt_get(const KHamtNode* node, KValue key, uint32_t hash, KValue* out) {
+    for (unsigned shift = 0; node; shift += KPERSIST_BITS) {
+        if (shift > HAMT_MAX_SHIFT) {
+            for (unsigned i = 0; i < 2 * node->datamap; i += 2) {
+                if (kmap_keys_equal(node->slots[i], key)) {
+                    if (out) *out = node->slots[i + 1];
+                    return true;
+                }
+            }
+            return false;
+        }
+        uint32_t bit = branch_bit(hash, shift);
+        if (node->datamap & bit) {
+            unsigned index = pair_index(node, bit);
+            if (!kmap_keys_equal(node->slots[index], key)) return false;
+            if (out) *out = node->slots[index + 1];
+            return true;
+        }
+        if (!(node->nodemap & bit)) return false;
+        node = hamt_child(node, child_index(node, bit));
+    }
+    return false;
+}
+
+// 返回插入或更新之后的节点 (就地修改时为 node 本身), added 表示新增了键
+static KHamtNode* hamt_assoc(Builder* b, KHamtNode* node, unsigned shift, KValue key, uint32_t hash, KValue value,
+                             bool* added) {
+    if (!node) {
+        node = hamt_node_new(b, branch_bit(hash, shift), 0, 2);
+        node->slots[0] = key;
+        node->slots[1] = value;
+        *added = true;
+        return node;
+    }
+    if (shift > HAMT_MAX_SHIFT) {
+        unsigned count = 2 * node->datamap;
+        for (unsigned i = 0; i < count; i += 2) {
+            if (kmap_keys_equal(node->slots[i], key)) {
+                KHamtNode* target = hamt_editable(b, node);
+                set_slot(b, &target->obj, &target->slots[i + 1], value);
+                return target;
+            }
+        }
+        KHamtNode* grown = hamt_resize(b, node, node->datamap + 1, 0, count, 2);
+        set_slot(b, &grown->obj, &grown->slots[count], key);
+        set_slot(b, &grown->obj, &grown->slots[count + 1], value);
+        *added = true;
+        return grown;
+    }
+
+    uint32_t bit = branch_bit(hash, shift);
+    if (node->datamap & bit) {
+        unsigned index = pair_index(node, bit);
+        KValue existing = node->slots[index];
+        if (kmap_keys_equal(existing, key)) {
+            KHamtNode* target = hamt_editable(b, node);
+            set_slot(b, &target->obj, &target->slots[index + 1], value);
+            return target;
+        }
+        // 两个键在本层落在同一个分支: 原有的键值对下移到新的子节点中
+        KHamtNode* child = hamt_merge(b, shift + KPERSIST_BITS, existing, kmap_hash_key(existing),
+                                      node->slots[index + 1], key, hash, value);
+        *added = true;
+        return hamt_pair_to_child(b, node, bit, child);
+    }
+    if (node->nodemap & bit) {
+        unsigned index = child_index(node, bit);
+        KHamtNode* child = hamt_child(node, index);
+        KHamtNode* updated = hamt_assoc(b, child, shift + KPERSIST_BITS, key, hash, value, added);
+        if (updated == child) return node;
+        KHamtNode* target = hamt_editable(b, node);
+        set_slot(b, &target->obj, &target->slots[index], KVALUE_OBJECT(updated));
+        return target;
+    }
+    unsigned index = 2 * popcount(node->datamap & (bit - 1));
+    KHamtNode* grown = hamt_resize(b, node, node->datamap | bit, node->nodemap, index, 2);
+    set_slot(b, &grown->obj, &grown->slots[index], key);
+    set_slot(b, &grown->obj, &grown->slots[index + 1], value);
+    *added = true;
+    return grown;
+}
+
+// 辅助函数：节点是否只含一个键值对 (这样的子节点要收回到父节点中)
+static inline bool hamt_single_pair(const KHamtNode* node, unsigned shift) {
+    if (shift > HAMT_MAX_SHIFT) return node->datamap == 1;
+    return node->nodemap == 0 && popcount(node->datamap) == 1;
+}
+
+// 返回删除之后的节点 (变空时为 NULL), removed 表示键存在并已删除
+static KHamtNode* hamt_dissoc(Builder* b, KHamtNode* node, unsigned shift, KValue key, uint32_t hash,
+                              bool* removed) {
+    if (shift > HAMT_MAX_SHIFT) {
+        for (unsigned i = 0; i < 2 * node->datamap; i += 2) {
+            if (!kmap_keys_equal(node->slots[i], key)) continue;
+            *removed = true;
+            if (node->datamap == 1) return NULL;
+            return hamt_resize(b, node, node->datamap - 1, 0, i, -2);
+        }
+        return node;
+    }
+
+    uint32_t bit = branch_bit(hash, shift);
+    if (node->datamap & bit) {
+        unsigned index = pair_index(node, bit);
+        if (!kmap_keys_equal(node->slots[index], key)) return node;
+        *removed = true;
+        if (node->datamap == bit && node->nodemap == 0) return NULL;
+        return hamt_resize(b, node, node->datamap & ~bit, node->nodemap, index, -2);
+    }
+    if (!(node->nodemap & bit)) return node;
+
+    unsigned index = child_index(node, bit);
+    KHamtNode* child = hamt_child(node, index);
+    KHamtNode* updated = hamt_dissoc(b, child, shift + KPERSIST_BITS, key, hash, removed);
+    if (!*removed) return node;
+    if (!updated) {
+        if (node->nodemap == bit && node->datamap == 0) return NULL;
+        return hamt_resize(b, node, node->datamap, node->nodemap & ~bit, index, -1);
+    }
+    if (hamt_single_pair(updated, shift + KPERSIST_BITS)) {
+        // 子节点只剩一个键值对: 收回到本节点的同一个分支, 保持形状唯一
+        return hamt_child_to_pair(b, node, bit, updated->slots[0], updated->slots[1]);
+    }
+    if (updated == child) return node;
+    KHamtNode* target = hamt_editable(b, node);
+    set_slot(b, &target->obj, &target->slots[index], KVALUE_OBJECT(updated));
+    return target;
+}
+
+// =============================================================================
+// 向量节点
+// =============================================================================
+
+static KVectorNode* vector_node_new(Builder* b) {
+    KVectorNode* node = builder_alloc(b, KOBJ_VECTOR_NODE, sizeof(KVectorNode));
+    node->edit = b->edit;
+    for (size_t i = 0; i < KPERSIST_WIDTH; i++) node->slots[i] = KVALUE_NULL;
+    return node;
+}
+
+// 辅助函数：返回可以就地修改的节点, node 为 NULL 时创建空节点
+static KVectorNode* vector_editable(Builder* b, KVectorNode* node) {
+    if (node && b->edit && node->edit == b->edit) return node;
+    KVectorNode* copy = vector_node_new(b);
+    if (node) memcpy(copy->slots, node->slots, sizeof(copy->slots));
+    return copy;
+}
+
+static inline KVectorNode* vector_child(const KVectorNode* node, size_t index) {
+    return (KVectorNode*)node->slots[index].as.object;
+}
+
+// 辅助函数：尾部 (tail) 之前的元素个数, 即 tail 中第一个元素的下标
+static inline size_t tail_offset(const KPVector* vector) {
+    return vector->count < KPERSIST_WIDTH ? 0 : ((vector->count - 1) >> KPERSIST_BITS) << KPERSIST_BITS;
+}
+
+// 辅助函数：下标 index 所在的叶子
+static const KVectorNode* leaf_for(const KPVector* vector, size_t index) {
+    if (index >= tail_offset(vector)) return vector->tail;
+    const KVectorNode* node = vector->root;
+    for (unsigned level = vector->shift; level > 0; level -= KPERSIST_BITS) {
+        node = vector_child(node, (index >> level) & KPERSIST_MASK);
+    }
+    return node;
+}
+
+static KVectorNode* vector_assoc_at(Builder* b, unsigned level, KVectorNode* node, size_t index, KValue value) {
+    KVectorNode* target = vector_editable(b, node);
+    size_t sub = (index >> level) & KPERSIST_MASK;
+    if (level == 0) {
+        set_slot(b, &target->obj, &target->slots[sub], value);
+    } else {
+        KVectorNode* child = vector_assoc_at(b, level - KPERSIST_BITS, vector_child(target, sub), index, value);
+        set_slot(b, &target->obj, &target->slots[sub], KVALUE_OBJECT(child));
+    }
+    return target;
+}
+
+// 辅助函数：从第 level 层到叶子层的一条只有第一个分支的路径, 叶子为 leaf
+static KVectorNode* vector_new_path(Builder* b, unsigned level, KVectorNode* leaf) {
+    if (level == 0) return leaf;
+    KVectorNode* child = vector_new_path(b, level - KPERSIST_BITS, leaf);
+    KVectorNode* node = vector_node_new(b);
+    set_slot(b, &node->obj, &node->slots[0], KVALUE_OBJECT(child));
+    return node;
+}
+
+// 辅助函数：把已满的 tail 作为第 count / 32 个叶子放入树中, count 为放入之前的元素个数
+static KVectorNode* vector_push_tail(Builder* b, size_t count, unsigned level, KVectorNode* parent,
+                                     KVectorNode* leaf) {
+    KVectorNode* target = vector_editable(b, parent);
+    size_t sub = ((count - 1) >> level) & KPERSIST_MASK;
+    KVectorNode* inserted;
+    if (level == KPERSIST_BITS) {
+        inserted = leaf;
+    } else if (target->slots[sub].type == KVAL_OBJECT) {
+        inserted = vector_push_tail(b, count, level - KPERSIST_BITS, vector_child(target, sub), leaf);
+    } else {
+        inserted = vector_new_path(b, level - KPERSIST_BITS, leaf);
+    }
+    set_slot(b, &target->obj, &target->slots[sub], KVALUE_OBJECT(inserted));
+    return target;
+}
+
+// 辅助函数：删除最后一个叶子, count 为删除之前的元素个数; 节点变空时返回 NULL
+static KVectorNode* vector_pop_tail(Builder* b, size_t count, unsigned level, KVectorNode* node) {
+    size_t sub = ((count - 2) >> level) & KPERSIST_MASK;
+    if (level > KPERSIST_BITS) {
+        KVectorNode* child = vector_pop_tail(b, count, level - KPERSIST_BITS, vector_child(node, sub));
+        if (!child && sub == 0) return NULL;
+        KVectorNode* target = vector_editable(b, node);
+        set_slot(b, &target->obj, &target->slots[sub], child ? KVALUE_OBJECT(child) : KVALUE_NULL);
+        return target;
+    }
+    if (sub == 0) return NULL;
+    KVectorNode* target = vector_editable(b, node);
+    target->slots[sub] = KVALUE_NULL;
+    return target;
+}
+
+// =============================================================================
+// 对象类型
+// =============================================================================
+
+static void hamt_node_trace(KGCTracer* tracer, KGCObject* obj) {
+    KHamtNode* node = (KHamtNode*)obj;
+    size_t count = hamt_slot_count(node);
+    for (size_t i = 0; i < count; i++) {
+        if (node->slots[i].type == KVAL_OBJECT) kgc_visit_object(tracer, &node->slots[i].as.object);
+    }
+}
+
+static void vector_node_trace(KGCTracer* tracer, KGCObject* obj) {
+    KVectorNode* node = (KVectorNode*)obj;
+    for (size_t i = 0; i < KPERSIST_WIDTH; i++) {
+        if (node->slots[i].type == KVAL_OBJECT) kgc_visit_object(tracer, &node->slots[i].as.object);
+    }
+}
+
+static void pmap_trace(KGCTracer* tracer, KGCObject* obj) {
+    kgc_visit_object(tracer, (KGCObject**)&((KPMap*)obj)->root);
+}
+
+static void pvector_trace(KGCTracer* tracer, KGCObject* obj) {
+    KPVector* vector = (KPVector*)obj;
+    kgc_visit_object(tracer, (KGCObject**)&vector->root);
+    kgc_visit_object(tracer, (KGCObject**)&vector->tail);
+}
+
+static const KGCTypeInfo hamt_node_type = {.name = "hamt node", .trace = hamt_node_trace, .finalize = NULL};
+static const KGCTypeInfo vector_node_type = {.name = "vector node", .trace = vector_node_trace, .finalize = NULL};
+static const KGCTypeInfo pmap_type = {.name = "persistent map", .trace = pmap_trace, .finalize = NULL};
+static const KGCTypeInfo pvector_type = {.name = "persistent vector", .trace = pvector_trace, .finalize = NULL};
+
+void kpersist_init_types(void) {
+    kgc_register_type(KOBJ_HAMT_NODE, &hamt_node_type);
+    kgc_register_type(KOBJ_VECTOR_NODE, &vector_node_type);
+    kgc_register_type(KOBJ_PMAP, &pmap_type);
+    kgc_register_type(KOBJ_PVECTOR, &pvector_type);
+}
+
+// =============================================================================
+// 持久化字典
+// =============================================================================
+
+KPMap* kpmap_new(KGCHeap* heap) {
+    KPMap* map = (KPMap*)kgc_alloc(heap, KOBJ_PMAP, sizeof(KPMap));
+    map->root = NULL;
+    map->count = 0;
+    map->edit = 0;
+    return map;
+}
+
+KPMap* kpmap_transient(KGCHeap* heap, const KPMap* map) {
+    KPMap* result = kpmap_new(heap);
+    result->root = map ? map->root : NULL;
+    result->count = map ? map->count : 0;
+    result->edit = new_edit();
+    return result;
+}
+
+// 辅助函数：修改的目标: transient 就地修改, 否则复制字典对象本身 (节点由修改操作按需复制)
+static KPMap* pmap_target(Builder* b, KPMap* map) {
+    if (map->edit) return map;
+    KPMap* copy = builder_alloc(b, KOBJ_PMAP, sizeof(KPMap));
+    copy->root = map->root;
+    copy->count = map->count;
+    copy->edit = 0;
+    return copy;
+}
+
+bool kpmap_get(const KPMap* map, KValue key, KValue* out) {
+    if (!map->root) return false;
+    key = kmap_normalize_key(key);
+    return hamt_get(map->root, key, kmap_hash_key(key), out);
+}
+
+KPMap* kpmap_assoc(KGCHeap* heap, KPMap* map, KValue key, KValue value) {
+    Builder b = {heap, map->edit, 0};
+    key = kmap_normalize_key(key);
+    builder_keep(&b, key);
+    builder_keep(&b, value);
+    KPMap* target = pmap_target(&b, map);
+    bool added = false;
+    KHamtNode* root = hamt_assoc(&b, target->root, 0, key, kmap_hash_key(key), value, &added);
+    target->root = root;
+    kgc_write_barrier(heap, &target->obj, &root->obj);
+    if (added) target->count++;
+    builder_finish(&b);
+    return target;
+}
+
+KPMap* kpmap_dissoc(KGCHeap* heap, KPMap* map, KValue key) {
+    if (!map->root) return map;
+    key = kmap_normalize_key(key);
+    uint32_t hash = kmap_hash_key(key);
+    if (!hamt_get(map->root, key, hash, NULL)) return map;
+
+    Builder b = {heap, map->edit, 0};
+    builder_keep(&b, key);
+    KPMap* target = pmap_target(&b, map);
+    bool removed = false;
+    KHamtNode* root = hamt_dissoc(&b, target->root, 0, key, hash, &removed);
+    target->root = root;
+    if (root) kgc_write_barrier(heap, &target->obj, &root->obj);
+    target->count--;
+    builder_finish(&b);
+    return target;
+}
+
+void kpmap_iter_init(const KPMap* map, KPMapIter* iter) {
+    iter->depth = map->root ? 0 : -1;
+    iter->nodes[0] = map->root;
+    iter->positions[0] = 0;
+}
+
+bool kpmap_iter_next(KPMapIter* iter, KValue* key, KValue* value) {
+    while (iter->depth >= 0) {
+        const KHamtNode* node = iter->nodes[iter->depth];
+        unsigned shift = (unsigned)iter->depth * KPERSIST_BITS;
+        unsigned pairs = shift > HAMT_MAX_SHIFT ? node->datamap : popcount(node->datamap);
+        unsigned children = shift > HAMT_MAX_SHIFT ? 0 : popcount(node->nodemap);
+        uint32_t position = iter->positions[iter->depth]++;
+        if (position < pairs) {
+            *key = node->slots[2 * position];
+            if (value) *value = node->slots[2 * position + 1];
+            return true;
+        }
+        if (position < pairs + children) {
+            iter->depth++;
+            iter->nodes[iter->depth] = hamt_child(node, 2 * pairs + (position - pairs));
+            iter->positions[iter->depth] = 0;
+            continue;
+        }
+        iter->depth--;
+    }
+    return false;
+}
+
+// =============================================================================
+// 持久化向量
+// =============================================================================
+
+KPVector* kpvector_new(KGCHeap* heap) {
+    KPVector* vector = (KPVector*)kgc_alloc(heap, KOBJ_PVECTOR, sizeof(KPVector));
+    vector->root = NULL;
+    vector->tail = NULL;
+    vector->count = 0;
+    vector->shift = KPERSIST_BITS;
+    vector->edit = 0;
+    return vector;
+}
+
+KPVector* kpvector_transient(KGCHeap* heap, const KPVector* vector) {
+    KPVector* result = kpvector_new(heap);
+    if (vector) {
+        result->root = vector->root;
+        result->tail = vector->tail;
+        result->count = vector->count;
+        result->shift = vector->shift;
+    }
+    result->edit = new_edit();
+    return result;
+}
+
+static KPVector* pvector_target(Builder* b, KPVector* vector) {
+    if (vector->edit) return vector;
+    KPVector* copy = builder_alloc(b, KOBJ_PVECTOR, sizeof(KPVector));
+    *copy = (KPVector){.obj = copy->obj, .root = vector->root, .tail = vector->tail, .count = vector->count,
+                       .shift = vector->shift, .edit = 0};
+    return copy;
+}
+
+// 辅助函数：设置向量的根与尾部 (带写屏障)
+static void pvector_set_nodes(Builder* b, KPVector* vector, KVectorNode* root, KVectorNode* tail) {
+    vector->root = root;
+    vector->tail = tail;
+    if (root) kgc_write_barrier(b->heap, &vector->obj, &root->obj);
+    if (tail) kgc_write_barrier(b->heap, &vector->obj, &tail->obj);
+}
+
+KValue kpvector_get(const KPVector* vector, size_t index) {
+    return leaf_for(vector, index)->slots[index & KPERSIST_MASK];
+}
+
+KPVector* kpvector_conj(KGCHeap* heap, KPVector* vector, KValue value) {
+    Builder b = {heap, vector->edit, 0};
+    builder_keep(&b, value);
+    KPVector* target = pvector_target(&b, vector);
+    size_t tail_count = target->count - tail_offset(target);
+    if (!target->tail || tail_count < KPERSIST_WIDTH) {
+        KVectorNode* tail = vector_editable(&b, target->tail);
+        set_slot(&b, &tail->obj, &tail->slots[tail_count], value);
+        pvector_set_nodes(&b, target, target->root, tail);
+    } else {
+        // tail 已满: 整块推入树中; 根节点已满时树增高一层
+        KVectorNode* leaf = target->tail;
+        KVectorNode* root;
+        if (target->root && (target->count >> KPERSIST_BITS) > ((size_t)1 << target->shift)) {
+            KVectorNode* path = vector_new_path(&b, target->shift, leaf);
+            root = vector_node_new(&b);
+            set_slot(&b, &root->obj, &root->slots[0], KVALUE_OBJECT(target->root));
+            set_slot(&b, &root->obj, &root->slots[1], KVALUE_OBJECT(path));
+            target->shift += KPERSIST_BITS;
+        } else {
+            root = vector_push_tail(&b, target->count, target->shift, target->root, leaf);
+        }
+        KVectorNode* tail = vector_node_new(&b);
+        set_slot(&b, &tail->obj, &tail->slots[0], value);
+        pvector_set_nodes(&b, target, root, tail);
+    }
+    target->count++;
+    builder_finish(&b);
+    return target;
+}
+
+KPVector* kpvector_assoc(KGCHeap* heap, KPVector* vector, size_t index, KValue value) {
+    if (index == vector->count) return kpvector_conj(heap, vector, value);
+    Builder b = {heap, vector->edit, 0};
+    builder_keep(&b, value);
+    KPVector* target = pvector_target(&b, vector);
+    if (index >= tail_offset(target)) {
+        KVectorNode* tail = vector_editable(&b, target->tail);
+        set_slot(&b, &tail->obj, &tail->slots[index & KPERSIST_MASK], value);
+        pvector_set_nodes(&b, target, target->root, tail);
+    } else {
+        KVectorNode* root = vector_assoc_at(&b, target->shift, target->root, index, value);
+        pvector_set_nodes(&b, target, root, target->tail);
+    }
+    builder_finish(&b);
+    return target;
+}
+
+KPVector* kpvector_pop(KGCHeap* heap, KPVector* vector) {
+    Builder b = {heap, vector->edit, 0};
+    KPVector* target = pvector_target(&b, vector);
+    size_t tail_count = target->count - tail_offset(target);
+    if (target->count == 1) {
+        pvector_set_nodes(&b, target, NULL, NULL);
+        target->shift = KPERSIST_BITS;
+    } else if (tail_count > 1) {
+        KVectorNode* tail = vector_editable(&b, target->tail);
+        tail->slots[tail_count - 1] = KVALUE_NULL;
+        pvector_set_nodes(&b, target, target->root, tail);
+    } else {
+        // tail 只剩一个元素: 树中最后一个叶子成为新的 tail; 根只剩一个分支时树降低一层
+        KVectorNode* tail = (KVectorNode*)leaf_for(target, target->count - 2);
+        KVectorNode* root = vector_pop_tail(&b, target->count, target->shift, target->root);
+        if (root && target->shift > KPERSIST_BITS && root->slots[1].type != KVAL_OBJECT) {
+            root = vector_child(root, 0);
+            target->shift -= KPERSIST_BITS;
+        }
+        pvector_set_nodes(&b, target, root, tail);
+    }
+    target->count--;
+    builder_finish(&b);
+    return target;
+}
+
+// =============================================================================
+// 原生函数
+// =============================================================================
+
+// 辅助函数：从可变容器中取出的结构体复制一份, 之后对原容器的修改不影响持久化结构
+static KValue own_value(KGCHeap* heap, KValue value) {
+    if (kvalue_is_object_type(value, KOBJ_STRUCT)) {
+        return KVALUE_OBJECT(kstruct_copy(heap, (KStruct*)value.as.object));
+    }
+    return value;
+}
+
+// PMap() / PMap(m) -> 持久化字典
+static KValue native_pmap(KorelinVM* vm, int argc, const KValue* argv) {
+    KGCHeap* heap = vm->heap;
+    if (argc > 1) return KVALUE_NULL;
+    if (argc == 1 && kvalue_is_object_type(argv[0], KOBJ_PMAP) && ((KPMap*)argv[0].as.object)->edit == 0) {
+        return argv[0];
+    }
+    if (argc == 1 && !kvalue_is_object_type(argv[0], KOBJ_MAP) && !kvalue_is_object_type(argv[0], KOBJ_PMAP)) {
+        return KVALUE_NULL;
+    }
+    KPMap* map = kpmap_new(heap);
+    if (argc == 0) return KVALUE_OBJECT(map);
+
+    // 在 transient 上批量插入, 最后冻结
+    kgc_push_root(heap, &map->obj);
+    map->edit = new_edit();
+    KValue key, value;
+    if (argv[0].as.object->type == KOBJ_MAP) {
+        size_t cursor = 0;
+        while (kmap_next((KMap*)argv[0].as.object, &cursor, &key, &value)) {
+            kpmap_assoc(heap, map, key, own_value(heap, value));
+        }
+    } else {
+        KPMapIter iter;
+        kpmap_iter_init((KPMap*)argv[0].as.object, &iter);
+        while (kpmap_iter_next(&iter, &key, &value)) kpmap_assoc(heap, map, key, value);
+    }
+    map->edit = 0;
+    kgc_pop_roots(heap, 1);
+    return KVALUE_OBJECT(map);
+}
+
+// PVector() / PVector(a) -> 持久化向量
+static KValue native_pvector(KorelinVM* vm, int argc, const KValue* argv) {
+    KGCHeap* heap = vm->heap;
+    if (argc > 1) return KVALUE_NULL;
+    if (argc == 1 && kvalue_is_object_type(argv[0], KOBJ_PVECTOR) && ((KPVector*)argv[0].as.object)->edit == 0) {
+        return argv[0];
+    }
+    if (argc == 1 && !kvalue_is_array(argv[0]) && !kvalue_is_object_type(argv[0], KOBJ_PVECTOR)) {
+        return KVALUE_NULL;
+    }
+    KPVector* vector = kpvector_new(heap);
+    if (argc == 0) return KVALUE_OBJECT(vector);
+
+    kgc_push_root(heap, &vector->obj);
+    vector->edit = new_edit();
+    if (kvalue_is_array(argv[0])) {
+        const KArray* array = (const KArray*)argv[0].as.object;
+        for (size_t i = 0; i < array->count; i++) {
+            kpvector_conj(heap, vector, own_value(heap, karray_get(array, i)));
+        }
+    } else {
+        const KPVector* source = (const KPVector*)argv[0].as.object;
+        for (size_t i = 0; i < source->count; i++) kpvector_conj(heap, vector, kpvector_get(source, i));
+    }
+    vector->edit = 0;
+    kgc_pop_roots(heap, 1);
+    return KVALUE_OBJECT(vector);
+}
+
+// 辅助函数：向量的下标参数, 允许 0 ~ limit
+static bool vector_index(KValue index, size_t limit, size_t* out) {
+    if (index.type != KVAL_INT || index.as.integer < 0 || (unsigned long long)index.as.integer > limit) return false;
+    *out = (size_t)index.as.integer;
+    return true;
+}
+
+// assoc(c, k, v) -> 新字典或新向量
+static KValue native_assoc(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    if (kvalue_is_object_type(argv[0], KOBJ_PMAP)) {
+        if (!kmap_valid_key(argv[1])) return KVALUE_NULL;
+        return KVALUE_OBJECT(kpmap_assoc(vm->heap, (KPMap*)argv[0].as.object, argv[1], argv[2]));
+    }
+    if (kvalue_is_object_type(argv[0], KOBJ_PVECTOR)) {
+        KPVector* vector = (KPVector*)argv[0].as.object;
+        size_t index;
+        if (!vector_index(argv[1], vector->count, &index)) return KVALUE_NULL;
+        return KVALUE_OBJECT(kpvector_assoc(vm->heap, vector, index, argv[2]));
+    }
+    return KVALUE_NULL;
+}
+
+// dissoc(m, k) -> 新字典
+static KValue native_dissoc(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    if (!kvalue_is_object_type(argv[0], KOBJ_PMAP) || !kmap_valid_key(argv[1])) return KVALUE_NULL;
+    return KVALUE_OBJECT(kpmap_dissoc(vm->heap, (KPMap*)argv[0].as.object, argv[1]));
+}
+
+// conj(v, x) -> 新向量
+static KValue native_conj(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    if (!kvalue_is_object_type(argv[0], KOBJ_PVECTOR)) return KVALUE_NULL;
+    return KVALUE_OBJECT(kpvector_conj(vm->heap, (KPVector*)argv[0].as.object, argv[1]));
+}
+
+// pop(v) -> 新向量
+static KValue native_pop(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    if (!kvalue_is_object_type(argv[0], KOBJ_PVECTOR) || ((KPVector*)argv[0].as.object)->count == 0) {
+        return KVALUE_NULL;
+    }
+    return KVALUE_OBJECT(kpvector_pop(vm->heap, (KPVector*)argv[0].as.object));
+}
+
+// transient(c) -> 可以就地修改的临时版本, 与 c 共享所有节点
+static KValue native_transient(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    if (kvalue_is_object_type(argv[0], KOBJ_PMAP)) {
+        const KPMap* source = (const KPMap*)argv[0].as.object;
+        if (source->edit) return KVALUE_NULL;
+        return KVALUE_OBJECT(kpmap_transient(vm->heap, source));
+    }
+    if (kvalue_is_object_type(argv[0], KOBJ_PVECTOR)) {
+        const KPVector* source = (const KPVector*)argv[0].as.object;
+        if (source->edit) return KVALUE_NULL;
+        return KVALUE_OBJECT(kpvector_transient(vm->heap, source));
+    }
+    return KVALUE_NULL;
+}
+
+// persistent(t) -> t 本身, 此后不可再就地修改
+static KValue native_persistent(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)vm;
+    (void)argc;
+    if (kvalue_is_object_type(argv[0], KOBJ_PMAP)) {
+        ((KPMap*)argv[0].as.object)->edit = 0;
+        return argv[0];
+    }
+    if (kvalue_is_object_type(argv[0], KOBJ_PVECTOR)) {
+        ((KPVector*)argv[0].as.object)->edit = 0;
+        return argv[0];
+    }
+    return KVALUE_NULL;
+}
+
+const KriNative kri_persist_natives[] = {
+    {"PMap", -1, native_pmap},
+    {"PVector", -1, native_pvector},
+    {"assoc", 3, native_assoc},
+    {"dissoc", 2, native_dissoc},
+    {"conj", 2, native_conj},
+    {"pop", 1, native_pop},
+    {"transient", 1, native_transient},
+    {"persistent", 1, native_persistent},
+    {NULL, 0, NULL},
+};
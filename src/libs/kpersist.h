@@ -0,0 +1,171 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#ifndef KORELIN_KPERSIST_H
+#define KORELIN_KPERSIST_H
+
+#include "../krilib.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// =============================================================================
+// 持久化 (不可变) 数据结构
+//
+// 持久化字典是 HAMT (哈希数组映射字典树, CHAMP 布局): 每层取哈希的 5 位选择 32 个
+// 分支之一, 节点用两个位图分别记录直接存放键值对的分支与指向子节点的分支, 只为
+// 存在的分支分配槽位。哈希的 32 位用完之后 (第 8 层) 为碰撞节点, 按顺序存放键值对。
+// 删除后只剩一个键值对的子节点会被收回到父节点中, 相同内容的字典形状唯一。
+//
+// 持久化向量是 32 路的位分区字典树, 末尾不满 32 个元素的部分单独存放在 tail 中,
+// 追加时整块推入树中。
+//
+// 修改操作复制从根到被修改位置的路径 (O(log32 n) 个节点), 其余节点与原结构共享,
+// 原结构保持不变。节点都是 GC 对象, 共享的节点由 GC 负责回收。
+//
+// transient 是可以就地修改的临时版本, 用于批量构造: 它带有一个唯一的编辑标记,
+// 标记相同的节点属于它自己, 可以直接修改; 其他节点 (与持久化版本共享的) 在第一次
+// 修改时复制一份并打上标记。persistent(t) 清除 t 的标记, 使 t 本身变为不可变,
+// 之后对它的修改照常复制路径。
+// =============================================================================
+
+#define KPERSIST_BITS 5
+#define KPERSIST_WIDTH 32       // 每个节点的分支数
+#define KPERSIST_MASK 31
+
+// HAMT 节点 (KOBJ_HAMT_NODE)
+typedef struct KHamtNode {
+    KGCObject obj;
+    uint64_t edit;              // 所属 transient 的编辑标记, 0 表示不可变
+    uint32_t datamap;           // 直接存放键值对的分支; 碰撞节点中为键值对个数
+    uint32_t nodemap;           // 指向子节点的分支; 碰撞节点中为 0
+    KValue slots[];             // 先是键值对 (键、值交替), 然后是子节点, 都按分支号排列
+} KHamtNode;
+
+// 持久化字典 (KOBJ_PMAP), transient 与之共用同一个结构
+typedef struct KPMap {
+    KGCObject obj;
+    KHamtNode* root;            // 空字典为 NULL
+    size_t count;
+    uint64_t edit;              // 非 0 表示 transient
+} KPMap;
+
+// 向量节点 (KOBJ_VECTOR_NODE): 叶子存放元素, 内部节点存放子节点
+typedef struct KVectorNode {
+    KGCObject obj;
+    uint64_t edit;
+    KValue slots[KPERSIST_WIDTH];
+} KVectorNode;
+
+// 持久化向量 (KOBJ_PVECTOR), transient 与之共用同一个结构
+typedef struct KPVector {
+    KGCObject obj;
+    KVectorNode* root;          // 元素不超过 32 个时为 NULL
+    KVectorNode* tail;          // 最后不满一个叶子的元素, 空向量为 NULL
+    size_t count;
+    unsigned shift;             // 根节点所在层的位移 (KPERSIST_BITS 的倍数)
+    uint64_t edit;              // 非 0 表示 transient
+} KPVector;
+
+// 字典的遍历位置, 记录从根到当前节点的路径
+typedef struct KPMapIter {
+    const KHamtNode* nodes[8];
+    uint32_t positions[8];      // 每层下一个要访问的键值对 (或子节点) 序号
+    int depth;
+} KPMapIter;
+
+// --- 函数声明 ---
+
+/**
+ * @brief 注册持久化数据结构的对象类型, 由 kobject_init_types 调用。
+ */
+void kpersist_init_types(void);
+
+/**
+ * @brief 创建空的持久化字典。
+ */
+KPMap* kpmap_new(KGCHeap* heap);
+
+/**
+ * @brief 创建与 map 共享所有节点的 transient (map 为 NULL 时为空的 transient)。
+ *        修改完成后把 edit 置 0 即变为持久化字典。
+ */
+KPMap* kpmap_transient(KGCHeap* heap, const KPMap* map);
+
+/**
+ * @brief 查找键。
+ * @param key 键, 必须满足 kmap_valid_key。
+ * @param out 找到时写入对应的值, 可以为 NULL。
+ * @return 是否找到。
+ */
+bool kpmap_get(const KPMap* map, KValue key, KValue* out);
+
+/**
+ * @brief 设置键的值。map 为 transient 时就地修改并返回 map, 否则返回新的字典。
+ * @param key 键, 必须满足 kmap_valid_key。
+ */
+KPMap* kpmap_assoc(KGCHeap* heap, KPMap* map, KValue key, KValue value);
+
+/**
+ * @brief 删除键, 返回值与 kpmap_assoc 相同; 键不存在时返回 map 本身。
+ */
+KPMap* kpmap_dissoc(KGCHeap* heap, KPMap* map, KValue key);
+
+/**
+ * @brief 开始遍历。遍历期间不能修改 (transient) 字典。
+ */
+void kpmap_iter_init(const KPMap* map, KPMapIter* iter);
+
+/**
+ * @brief 取出下一个键值对。
+ * @param value 写入值, 可以为 NULL。
+ * @return 还有元素时返回 true。
+ */
+bool kpmap_iter_next(KPMapIter* iter, KValue* key, KValue* value);
+
+/**
+ * @brief 创建空的持久化向量。
+ */
+KPVector* kpvector_new(KGCHeap* heap);
+
+/**
+ * @brief 创建与 vector 共享所有节点的 transient (vector 为 NULL 时为空的 transient)。
+ */
+KPVector* kpvector_transient(KGCHeap* heap, const KPVector* vector);
+
+/**
+ * @brief 读取下标 index (必须小于 count) 处的元素。
+ */
+KValue kpvector_get(const KPVector* vector, size_t index);
+
+/**
+ * @brief 替换下标 index 处的元素, index 等于 count 时追加。
+ *        vector 为 transient 时就地修改并返回 vector, 否则返回新的向量。
+ */
+KPVector* kpvector_assoc(KGCHeap* heap, KPVector* vector, size_t index, KValue value);
+
+/**
+ * @brief 在末尾追加一个元素, 返回值与 kpvector_assoc 相同。
+ */
+KPVector* kpvector_conj(KGCHeap* heap, KPVector* vector, KValue value);
+
+/**
+ * @brief 删除最后一个元素 (向量不能为空), 返回值与 kpvector_assoc 相同。
+ */
+KPVector* kpvector_pop(KGCHeap* heap, KPVector* vector);
+
+// 持久化数据结构的原生函数:
+//   PMap() / PMap(m)       创建持久化字典, 可以从字典或另一个持久化字典构造
+//   PVector() / PVector(a) 创建持久化向量, 可以从数组或另一个持久化向量构造
+//   assoc(c, k, v)         返回把 c[k] 设为 v 的新字典或新向量 (k 等于长度时追加)
+//   dissoc(m, k)           返回删除键 k 之后的新字典
+//   conj(v, x)             返回末尾追加 x 的新向量
+//   pop(v)                 返回删除最后一个元素的新向量, 空向量返回 null
+//   transient(c)           返回可以就地修改的临时版本, 对它的 assoc/dissoc/conj/pop
+//                          以及 t[k] = v 直接修改 t 并返回 t
+//   persistent(t)          把 transient 冻结为不可变的版本并返回它
+// 参数类型不符时返回 null。
+extern const KriNative kri_persist_natives[];
+
+#endif //KORELIN_KPERSIST_H
@@ -0,0 +1,162 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#include "kstring.h"
+#include "../ksimd.h"
+#include "../kvm.h"
+#include <string.h>
+
+// 辅助函数：取出字符串参数, 不是字符串时返回 NULL (原生函数的参数中没有 rope)
+static const KString* as_string(KValue value) {
+    return kvalue_is_object_type(value, KOBJ_STRING) ? (const KString*)value.as.object : NULL;
+}
+
+// 辅助函数：在 str 的 [start, length) 中查找 sub, 返回下标, 不存在时返回 str->length
+static size_t find_from(const KString* str, size_t start, const KString* sub) {
+    size_t at = ksimd_find(str->chars + start, str->length - start, sub->chars, sub->length);
+    return at == str->length - start ? str->length : start + at;
+}
+
+// 辅助函数：创建 str 的子串; ASCII 字符串的子串一定是 ASCII, 不需要重新检查编码
+static KString* substring(KGCHeap* heap, const KString* str, size_t start, size_t length) {
+    if (str->encoding != KSTRING_ASCII) return kstring_new(heap, str->chars + start, length);
+    KString* result = kstring_alloc(heap, length);
+    memcpy(result->chars, str->chars + start, length);
+    result->hash = kstring_hash(result->chars, length);
+    result->encoding = KSTRING_ASCII;
+    return result;
+}
+
+// find(s, sub[, start]) -> int | null
+static KValue native_find(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)vm;
+    if (argc < 2 || argc > 3) return KVALUE_NULL;
+    const KString* str = as_string(argv[0]);
+    const KString* sub = as_string(argv[1]);
+    if (!str || !sub) return KVALUE_NULL;
+    size_t start = 0;
+    if (argc == 3) {
+        if (argv[2].type != KVAL_INT || argv[2].as.integer < 0) return KVALUE_NULL;
+        if ((unsigned long long)argv[2].as.integer > str->length) return KVALUE_INT(-1);
+        start = (size_t)argv[2].as.integer;
+    }
+    size_t at = find_from(str, start, sub);
+    if (at == str->length && !(sub->length == 0 && start == str->length)) return KVALUE_INT(-1);
+    return KVALUE_INT((long long)at);
+}
+
+// count(s, sub) -> int | null
+static KValue native_count(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)vm;
+    (void)argc;
+    const KString* str = as_string(argv[0]);
+    const KString* sub = as_string(argv[1]);
+    if (!str || !sub || sub->length == 0) return KVALUE_NULL;
+    long long count = 0;
+    for (size_t at = find_from(str, 0, sub); at < str->length; at = find_from(str, at + sub->length, sub)) {
+        count++;
+    }
+    return KVALUE_INT(count);
+}
+
+// split(s, sep) -> array | null
+static KValue native_split(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    KGCHeap* heap = vm->heap;
+    const KString* str = as_string(argv[0]);
+    const KString* sep = as_string(argv[1]);
+    if (!str || !sep) return KVALUE_NULL;
+
+    KArray* parts = karray_new(heap, 0);
+    kgc_push_root(heap, &parts->obj);
+    if (sep->length == 0) {
+        // 切分为单个字符: 只有含多字节字符的合法 UTF-8 需要按首字节确定字符长度
+        bool utf8 = str->encoding == KSTRING_UTF8;
+        for (size_t i = 0; i < str->length;) {
+            unsigned char lead = (unsigned char)str->chars[i];
+            size_t length = !utf8 || lead < 0x80 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+            karray_push(heap, parts, KVALUE_OBJECT(substring(heap, str, i, length)));
+            i += length;
+        }
+    } else {
+        size_t start = 0;
+        for (;;) {
+            size_t at = find_from(str, start, sep);
+            karray_push(heap, parts, KVALUE_OBJECT(substring(heap, str, start, at - start)));
+            if (at == str->length) break;
+            start = at + sep->length;
+        }
+    }
+    kgc_pop_roots(heap, 1);
+    return KVALUE_OBJECT(parts);
+}
+
+// replace(s, old, new) -> string | null
+static KValue native_replace(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    const KString* str = as_string(argv[0]);
+    const KString* old = as_string(argv[1]);
+    const KString* new_str = as_string(argv[2]);
+    if (!str || !old || !new_str) return KVALUE_NULL;
+    if (old->length == 0) return argv[0];
+
+    // 第一遍计数确定结果长度, 第二遍直接写入结果字符串
+    size_t matches = 0;
+    for (size_t at = find_from(str, 0, old); at < str->length; at = find_from(str, at + old->length, old)) {
+        matches++;
+    }
+    if (matches == 0) return argv[0];
+    KString* result = kstring_alloc(vm->heap, str->length - matches * old->length + matches * new_str->length);
+    char* out = result->chars;
+    size_t start = 0;
+    for (size_t at = find_from(str, 0, old); at < str->length; at = find_from(str, start, old)) {
+        memcpy(out, str->chars + start, at - start);
+        out += at - start;
+        memcpy(out, new_str->chars, new_str->length);
+        out += new_str->length;
+        start = at + old->length;
+    }
+    memcpy(out, str->chars + start, str->length - start);
+    if (str->encoding == KSTRING_ASCII && new_str->encoding == KSTRING_ASCII) {
+        result->hash = kstring_hash(result->chars, result->length);
+        result->encoding = KSTRING_ASCII;
+    } else {
+        kstring_seal(result);
+    }
+    return KVALUE_OBJECT(result);
+}
+
+// 辅助函数：upper 与 lower 的共同实现
+static KValue convert_case(KorelinVM* vm, KValue value, bool upper) {
+    const KString* str = as_string(value);
+    if (!str) return KVALUE_NULL;
+    KString* result = kstring_alloc(vm->heap, str->length);
+    ksimd_ascii_case(result->chars, str->chars, str->length, upper);
+    // 只改变 ASCII 字节, 编码不变
+    result->hash = kstring_hash(result->chars, result->length);
+    result->encoding = str->encoding;
+    return KVALUE_OBJECT(result);
+}
+
+// upper(s) -> string | null
+static KValue native_upper(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    return convert_case(vm, argv[0], true);
+}
+
+// lower(s) -> string | null
+static KValue native_lower(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    return convert_case(vm, argv[0], false);
+}
+
+const KriNative kri_string_natives[] = {
+    {"find", -1, native_find},
+    {"count", 2, native_count},
+    {"split", 2, native_split},
+    {"replace", 3, native_replace},
+    {"upper", 1, native_upper},
+    {"lower", 1, native_lower},
+    {NULL, 0, NULL},
+};
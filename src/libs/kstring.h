@@ -0,0 +1,24 @@
+//
+// Created by Helix on 2026/10/18.
+//
+
+#ifndef KORELIN_KSTRING_H
+#define KORELIN_KSTRING_H
+
+#include "../krilib.h"
+
+// =============================================================================
+// 字符串原生函数:
+//   find(s, sub[, start])  sub 从 start (默认 0) 开始第一次出现的下标, 不存在时返回 -1
+//   count(s, sub)          sub 不重叠地出现的次数, sub 不能为空串
+//   split(s, sep)          按 sep 切分为字符串数组; sep 为空串时切分为单个字符
+//                          (合法的 UTF-8 字符串按码点切分, 其他按字节)
+//   replace(s, old, new)   把所有不重叠的 old 替换为 new, old 为空串时返回 s
+//   upper(s) / lower(s)    把 ASCII 字母转换为大写 / 小写, 其他字符不变
+//
+// 下标与长度都以字节计。查找使用 ksimd 中的向量化内核。参数类型不符时返回 null。
+// =============================================================================
+
+extern const KriNative kri_string_natives[];
+
+#endif //KORELIN_KSTRING_H
@@ -2,4 +2,162 @@
 // Created by Helix on 2025/12/28.
 //
 
-#include "stdlib.h"
\ No newline at end of file
+#define _POSIX_C_SOURCE 200809L
+
+#include "stdlib.h"
+#include "../kbigint.h"
+#include "../knumber.h"
+#include "../kstruct.h"
+#include "../kvm.h"
+#include "kmap.h"
+#include "kpersist.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// print(...)
+static KValue native_print(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)vm;
+    for (int i = 0; i < argc; i++) {
+        if (i) fputc(' ', stdout);
+        kvalue_print(stdout, argv[i]);
+    }
+    fputc('\n', stdout);
+    return KVALUE_NULL;
+}
+
+// input([prompt]) -> string | null
+static KValue native_input(KorelinVM* vm, int argc, const KValue* argv) {
+    if (argc > 0) {
+        kvalue_print(stdout, argv[0]);
+        fflush(stdout);
+    }
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t length = getline(&line, &capacity, stdin);
+    if (length < 0) {
+        free(line);
+        return KVALUE_NULL;
+    }
+    while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) length--;
+    KString* str = kstring_new(vm->heap, line, (size_t)length);
+    free(line);
+    return KVALUE_OBJECT(str);
+}
+
+// len(x) -> int, 不支持的类型返回 null
+static KValue native_len(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)vm;
+    (void)argc;
+    if (kvalue_is_object_type(argv[0], KOBJ_STRING)) return KVALUE_INT((long long)((KString*)argv[0].as.object)->length);
+    if (kvalue_is_array(argv[0])) return KVALUE_INT((long long)((KArray*)argv[0].as.object)->count);
+    if (kvalue_is_object_type(argv[0], KOBJ_MAP)) return KVALUE_INT((long long)((KMap*)argv[0].as.object)->count);
+    if (kvalue_is_object_type(argv[0], KOBJ_CONCURRENT_MAP)) {
+        return KVALUE_INT((long long)kcmap_count(((KConcurrentMap*)argv[0].as.object)->shared));
+    }
+    if (kvalue_is_object_type(argv[0], KOBJ_PMAP)) return KVALUE_INT((long long)((KPMap*)argv[0].as.object)->count);
+    if (kvalue_is_object_type(argv[0], KOBJ_PVECTOR)) {
+        return KVALUE_INT((long long)((KPVector*)argv[0].as.object)->count);
+    }
+    if (kvalue_is_object_type(argv[0], KOBJ_STRUCT_ARRAY)) {
+        return KVALUE_INT((long long)((KStructArray*)argv[0].as.object)->count);
+    }
+    if (kvalue_is_object_type(argv[0], KOBJ_STRING_BUILDER)) {
+        return KVALUE_INT((long long)((KStringBuilder*)argv[0].as.object)->length);
+    }
+    return KVALUE_NULL;
+}
+
+// push(array, x) -> bool: 结构体数组只接受同类型的结构体, 类型数组只接受能转换为元素类型的数值
+static KValue native_push(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    if (kvalue_is_array(argv[0])) {
+        return KVALUE_BOOL(karray_push(vm->heap, (KArray*)argv[0].as.object, argv[1]));
+    }
+    if (kvalue_is_object_type(argv[0], KOBJ_STRUCT_ARRAY)) {
+        return KVALUE_BOOL(kstruct_array_push(vm->heap, (KStructArray*)argv[0].as.object, argv[1]));
+    }
+    return KVALUE_BOOL(false);
+}
+
+// str(x) -> string
+static KValue native_str(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    return KVALUE_OBJECT(kvalue_to_string(vm->heap, argv[0]));
+}
+
+// number(x) -> int/double: 按数值字面量的语法解析字符串 (超出 64 位的整数为大整数), 不合法时返回 null
+static KValue native_number(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    if (kvalue_is_integer(argv[0]) || argv[0].type == KVAL_DOUBLE) return argv[0];
+    if (!kvalue_is_object_type(argv[0], KOBJ_STRING)) return KVALUE_NULL;
+    const KString* str = (const KString*)argv[0].as.object;
+    long long integer = 0;
+    double number = 0.0;
+    switch (knumber_parse(str->chars, str->length, &integer, &number)) {
+        case KNUMBER_INT: return KVALUE_INT(integer);
+        case KNUMBER_DOUBLE: return KVALUE_DOUBLE(number);
+        case KNUMBER_OVERFLOW: return kbigint_parse(vm->heap, str->chars, str->length);
+        default: return KVALUE_NULL;
+    }
+}
+
+// StringBuilder([capacity]) -> string builder
+static KValue native_string_builder(KorelinVM* vm, int argc, const KValue* argv) {
+    size_t capacity = 0;
+    if (argc > 1) return KVALUE_NULL;
+    if (argc == 1) {
+        if (argv[0].type != KVAL_INT || argv[0].as.integer < 0) return KVALUE_NULL;
+        capacity = (size_t)argv[0].as.integer;
+    }
+    return KVALUE_OBJECT(kstring_builder_new(vm->heap, capacity));
+}
+
+// append(sb, x) -> sb: 追加 x 的字符串形式 (与 str(x) 相同)
+static KValue native_append(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    if (!kvalue_is_object_type(argv[0], KOBJ_STRING_BUILDER)) return KVALUE_NULL;
+    KStringBuilder* builder = (KStringBuilder*)argv[0].as.object;
+    if (argv[1].type == KVAL_INT) {
+        // 整数不经过临时字符串
+        char buffer[KNUMBER_BUFFER_SIZE];
+        kstring_builder_append(vm->heap, builder, buffer, knumber_format_int(argv[1].as.integer, buffer));
+    } else {
+        const KString* str = kvalue_to_string(vm->heap, argv[1]);
+        kstring_builder_append(vm->heap, builder, str->chars, str->length);
+    }
+    return argv[0];
+}
+
+// toString(sb) -> string
+static KValue native_to_string(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)argc;
+    if (!kvalue_is_object_type(argv[0], KOBJ_STRING_BUILDER)) return KVALUE_NULL;
+    const KStringBuilder* builder = (const KStringBuilder*)argv[0].as.object;
+    return KVALUE_OBJECT(kstring_new(vm->heap, builder->data ? builder->data : "", builder->length));
+}
+
+// clock() -> double
+static KValue native_clock(KorelinVM* vm, int argc, const KValue* argv) {
+    (void)vm;
+    (void)argc;
+    (void)argv;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return KVALUE_DOUBLE((double)ts.tv_sec + (double)ts.tv_nsec / 1e9);
+}
+
+const KriNative kri_stdlib_natives[] = {
+    {"print", -1, native_print},
+    {"input", -1, native_input},
+    {"len", 1, native_len},
+    {"push", 2, native_push},
+    {"str", 1, native_str},
+    {"number", 1, native_number},
+    {"clock", 0, native_clock},
+    {"StringBuilder", -1, native_string_builder},
+    {"append", 2, native_append},
+    {"toString", 1, native_to_string},
+    {NULL, 0, NULL},
+};
@@ -4,13 +4,25 @@
 
 #ifndef KORELIN_STDLIB_H
 #define KORELIN_STDLIB_H
-#include <stdarg.h>
 
-// print 标准输出
-void KriPrint();
+#include "../krilib.h"
 
-// input 标准输出
-void KriInput();
+// =============================================================================
+// 标准库原生函数:
+//   print(...)         以空格分隔输出所有参数并换行
+//   input([prompt])    读取一行标准输入 (不含换行符), 到达文件末尾时返回 null
+//   len(x)             字符串、数组 (含类型数组)、结构体数组、字典 (含并发哈希表)、持久化字典/向量
+//                      或字符串构造器的长度
+//   push(array, x)     在数组或结构体数组末尾追加元素
+//   str(x)             把值转换为字符串 (浮点数为能够精确还原的最短形式)
+//   number(s)          按数值字面量的语法 (如 "42"、"-0x1F"、"1.5e-7") 解析字符串, 超出 64 位的整数为
+//                      大整数, 不合法时返回 null
+//   clock()            单调时钟的秒数 (double), 用于计时
+//   StringBuilder([n]) 创建字符串构造器, n 为初始容量 (字节数)
+//   append(sb, x)      在构造器末尾追加 x 的字符串形式 (与 str(x) 相同), 返回 sb
+//   toString(sb)       返回构造器当前内容的字符串
+// =============================================================================
 
-//
-#endif //KORELIN_STDLIB_H
\ No newline at end of file
+extern const KriNative kri_stdlib_natives[];
+
+#endif //KORELIN_STDLIB_H